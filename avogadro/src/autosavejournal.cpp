@@ -0,0 +1,402 @@
+/**********************************************************************
+  AutosaveJournal - Crash recovery journal of unsaved changes
+
+  Copyright (C) 2013 Avogadro Developers
+
+  This file is part of the Avogadro molecular editor project.
+  For more information, see <http://avogadro.cc/>
+
+  Avogadro is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  Avogadro is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+  02110-1301, USA.
+ **********************************************************************/
+
+
+#include "autosavejournal.h"
+
+#include <avogadro/molecule.h>
+#include <avogadro/moleculefile.h>
+#include <avogadro/atom.h>
+#include <avogadro/bond.h>
+
+#include <QCoreApplication>
+#include <QDesktopServices>
+#include <QDir>
+#include <QFile>
+#include <QTextStream>
+#include <QVector>
+
+#ifdef Q_OS_WIN
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <sys/types.h>
+#include <signal.h>
+#include <errno.h>
+#endif
+
+using Eigen::Vector3d;
+
+namespace Avogadro {
+
+  namespace {
+    const char *journalMagic = "AvogadroJournal 1";
+
+    bool processRunning(qint64 pid)
+    {
+#ifdef Q_OS_WIN
+      HANDLE process = OpenProcess(SYNCHRONIZE, FALSE, static_cast<DWORD>(pid));
+      if (!process)
+        return false;
+      bool running = WaitForSingleObject(process, 0) == WAIT_TIMEOUT;
+      CloseHandle(process);
+      return running;
+#else
+      return kill(static_cast<pid_t>(pid), 0) == 0 || errno == EPERM;
+#endif
+    }
+
+    QString atomLine(char type, const MoleculeSnapshot &snapshot,
+                     unsigned int index)
+    {
+      const Vector3d &pos = snapshot.atomPos(index);
+      return QString("%1 %2 %3 %4 %5").arg(type)
+        .arg(snapshot.atomicNumber(index))
+        .arg(pos.x(), 0, 'g', 17).arg(pos.y(), 0, 'g', 17)
+        .arg(pos.z(), 0, 'g', 17);
+    }
+
+    bool readAtom(const QStringList &fields, int first, int *atomicNumber,
+                  Vector3d *pos)
+    {
+      if (fields.size() != first + 4)
+        return false;
+      bool ok[4];
+      *atomicNumber = fields.at(first).toInt(&ok[0]);
+      *pos = Vector3d(fields.at(first + 1).toDouble(&ok[1]),
+                      fields.at(first + 2).toDouble(&ok[2]),
+                      fields.at(first + 3).toDouble(&ok[3]));
+      return ok[0] && ok[1] && ok[2] && ok[3];
+    }
+  }
+
+  AutosaveJournal::AutosaveJournal() : m_writtenVersion(0)
+  {
+    static int count = 0;
+    m_journalFile = journalPath() + QString("/%1-%2.journal")
+      .arg(QCoreApplication::applicationPid()).arg(++count);
+  }
+
+  AutosaveJournal::~AutosaveJournal()
+  {
+  }
+
+  QString AutosaveJournal::journalPath()
+  {
+    return QDesktopServices::storageLocation(QDesktopServices::DataLocation)
+      + "/autosave";
+  }
+
+  void AutosaveJournal::setBaseline(const MoleculeSnapshot &baseline,
+                                    const QString &baselineFile,
+                                    const QString &documentName)
+  {
+    remove();
+    m_baseline = baselineFile.isEmpty() ? MoleculeSnapshot() : baseline;
+    m_baselineFile = baselineFile;
+    m_documentName = documentName;
+    m_writtenVersion = baseline.version();
+
+    m_baselineIndex.clear();
+    m_baselineIndex.reserve(m_baseline.numAtoms());
+    for (unsigned int i = 0; i < m_baseline.numAtoms(); ++i)
+      m_baselineIndex.insert(m_baseline.atomId(i), i);
+  }
+
+  bool AutosaveJournal::write(const MoleculeSnapshot &current)
+  {
+    if (current.version() == m_writtenVersion)
+      return true;
+
+    // The baseline index of each atom, or -1 for new atoms. Atoms from the
+    // baseline must keep their relative order and come before any new ones
+    // (which is how Molecule adds them), otherwise write everything out.
+    QVector<int> baseIndex(current.numAtoms(), -1);
+    bool useBaseline = !m_baseline.isNull();
+    int previous = -1;
+    for (unsigned int i = 0; useBaseline && i < current.numAtoms(); ++i) {
+      QHash<unsigned long, int>::const_iterator it =
+        m_baselineIndex.constFind(current.atomId(i));
+      if (it == m_baselineIndex.constEnd()) {
+        previous = m_baseline.numAtoms();
+        continue;
+      }
+      if (it.value() <= previous)
+        useBaseline = false;
+      baseIndex[i] = previous = it.value();
+    }
+    if (!useBaseline)
+      baseIndex.fill(-1);
+
+    // Written next to the journal and moved over it once complete, so a
+    // crash while writing still leaves the previous journal to recover
+    QDir().mkpath(journalPath());
+    const QString newJournalFile = m_journalFile + ".new";
+    QFile file(newJournalFile);
+    if (!file.open(QFile::WriteOnly | QFile::Truncate | QFile::Text))
+      return false;
+
+    QTextStream out(&file);
+    out << journalMagic << '\n'
+        << "name " << m_documentName << '\n'
+        << "file " << (useBaseline ? m_baselineFile : QString()) << '\n'
+        << "baseline " << (useBaseline ? m_baseline.numAtoms() : 0) << '\n'
+        << "atoms " << current.numAtoms() << '\n';
+
+    // Runs of unchanged baseline atoms are written as a range
+    int runStart = -1, runLength = 0;
+    for (unsigned int i = 0; i < current.numAtoms(); ++i) {
+      int base = baseIndex.at(i);
+      bool unchanged = base >= 0
+        && current.atomicNumber(i) == m_baseline.atomicNumber(base)
+        && current.atomPos(i) == m_baseline.atomPos(base);
+      if (unchanged && runLength && base == runStart + runLength) {
+        ++runLength;
+        continue;
+      }
+      if (runLength)
+        out << "k " << runStart << ' ' << runLength << '\n';
+      runLength = 0;
+      if (unchanged) {
+        runStart = base;
+        runLength = 1;
+      }
+      else if (base >= 0) {
+        out << "m " << base << ' '
+            << atomLine('m', current, i).mid(2) << '\n';
+      }
+      else {
+        out << atomLine('a', current, i) << '\n';
+      }
+    }
+    if (runLength)
+      out << "k " << runStart << ' ' << runLength << '\n';
+
+    // Bonds are only written if they differ from the baseline
+    bool keepBonds = useBaseline
+      && current.numBonds() == m_baseline.numBonds();
+    for (unsigned int i = 0; keepBonds && i < current.numBonds(); ++i) {
+      keepBonds = baseIndex.at(current.bondBeginIndex(i))
+        == static_cast<int>(m_baseline.bondBeginIndex(i))
+        && baseIndex.at(current.bondEndIndex(i))
+        == static_cast<int>(m_baseline.bondEndIndex(i))
+        && current.bondOrder(i) == m_baseline.bondOrder(i);
+    }
+    if (keepBonds) {
+      out << "bonds keep\n";
+    }
+    else {
+      out << "bonds " << current.numBonds() << '\n';
+      for (unsigned int i = 0; i < current.numBonds(); ++i)
+        out << "b " << current.bondBeginIndex(i) << ' '
+            << current.bondEndIndex(i) << ' ' << current.bondOrder(i) << '\n';
+    }
+    // Marks a complete journal
+    out << "end\n";
+    out.flush();
+    file.close();
+
+    if (file.error() != QFile::NoError
+        || !MoleculeFile::replaceFile(newJournalFile, m_journalFile)) {
+      QFile::remove(newJournalFile);
+      return false;
+    }
+    m_writtenVersion = current.version();
+    return true;
+  }
+
+  void AutosaveJournal::remove()
+  {
+    QFile::remove(m_journalFile);
+    m_writtenVersion = 0;
+  }
+
+  QStringList AutosaveJournal::orphanedJournals()
+  {
+    QStringList journals;
+    QDir dir(journalPath());
+    foreach (const QString &name,
+             dir.entryList(QStringList() << "*.journal", QDir::Files)) {
+      qint64 pid = name.section('-', 0, 0).toLongLong();
+      if (pid != QCoreApplication::applicationPid() && !processRunning(pid))
+        journals << dir.absoluteFilePath(name);
+    }
+    return journals;
+  }
+
+  QString AutosaveJournal::documentName(const QString &journalFile)
+  {
+    QFile file(journalFile);
+    if (!file.open(QFile::ReadOnly | QFile::Text))
+      return QString();
+    QTextStream in(&file);
+    if (in.readLine() != journalMagic)
+      return QString();
+    QString line = in.readLine();
+    return line.startsWith("name ") ? line.mid(5) : QString();
+  }
+
+  Molecule * AutosaveJournal::recover(const QString &journalFile,
+                                      QString *error)
+  {
+    QFile file(journalFile);
+    if (!file.open(QFile::ReadOnly | QFile::Text)) {
+      if (error)
+        *error = QObject::tr("Could not open %1.").arg(journalFile);
+      return 0;
+    }
+    QTextStream in(&file);
+    QString name, baselineFile;
+    bool ok = in.readLine() == journalMagic;
+    QString line = in.readLine();
+    ok = ok && line.startsWith("name ");
+    name = line.mid(5);
+    line = in.readLine();
+    ok = ok && line.startsWith("file ");
+    baselineFile = line.mid(5);
+    line = in.readLine();
+    ok = ok && line.startsWith("baseline ");
+    int numBaseline = line.mid(9).toInt();
+    line = in.readLine();
+    ok = ok && line.startsWith("atoms ");
+    int numAtoms = line.mid(6).toInt();
+    if (!ok) {
+      if (error)
+        *error = QObject::tr("%1 is not a valid journal.").arg(journalFile);
+      return 0;
+    }
+
+    Molecule *molecule = 0;
+    if (numBaseline) {
+      molecule = MoleculeFile::readMolecule(baselineFile, QString(), QString(),
+                                            error);
+      if (!molecule)
+        return 0;
+      if (molecule->numAtoms() != static_cast<unsigned int>(numBaseline)) {
+        if (error)
+          *error = QObject::tr("%1 changed since the journal was written.")
+            .arg(baselineFile);
+        delete molecule;
+        return 0;
+      }
+    }
+    else {
+      molecule = new Molecule;
+    }
+
+    // Apply the changes to the baseline molecule
+    const QList<Atom *> baseAtoms = molecule->atoms();
+    QVector<bool> kept(numBaseline, false);
+    QList<int> newNumbers;
+    QList<Vector3d> newPositions;
+    int atomCount = 0;
+    bool keepBonds = false;
+    QList<int> bonds; // begin, end and order triplets
+    ok = false;
+    while (!in.atEnd()) {
+      const QStringList fields = in.readLine().split(' ',
+                                                     QString::SkipEmptyParts);
+      if (fields.isEmpty())
+        continue;
+      const QString &type = fields.first();
+      if (type == "k" && fields.size() == 3) {
+        int first = fields.at(1).toInt();
+        int count = fields.at(2).toInt();
+        if (first < 0 || count < 0 || first + count > numBaseline)
+          break;
+        for (int i = first; i < first + count; ++i)
+          kept[i] = true;
+        atomCount += count;
+      }
+      else if (type == "m" && fields.size() == 6) {
+        int base = fields.at(1).toInt();
+        int atomicNumber;
+        Vector3d pos;
+        if (base < 0 || base >= numBaseline
+            || !readAtom(fields, 2, &atomicNumber, &pos))
+          break;
+        kept[base] = true;
+        baseAtoms.at(base)->setAtomicNumber(atomicNumber);
+        baseAtoms.at(base)->setPos(pos);
+        ++atomCount;
+      }
+      else if (type == "a") {
+        int atomicNumber;
+        Vector3d pos;
+        if (!readAtom(fields, 1, &atomicNumber, &pos))
+          break;
+        newNumbers << atomicNumber;
+        newPositions << pos;
+        ++atomCount;
+      }
+      else if (type == "bonds") {
+        keepBonds = fields.size() == 2 && fields.at(1) == "keep";
+      }
+      else if (type == "b" && fields.size() == 4) {
+        bonds << fields.at(1).toInt() << fields.at(2).toInt()
+              << fields.at(3).toInt();
+      }
+      else if (type == "end") {
+        ok = atomCount == numAtoms;
+        break;
+      }
+      else {
+        break;
+      }
+    }
+
+    if (!ok) {
+      if (error)
+        *error = QObject::tr("The journal %1 is incomplete.").arg(journalFile);
+      delete molecule;
+      return 0;
+    }
+
+    for (int i = 0; i < numBaseline; ++i) {
+      if (!kept.at(i))
+        molecule->removeAtom(baseAtoms.at(i));
+    }
+    for (int i = 0; i < newNumbers.size(); ++i)
+      molecule->addAtom(newNumbers.at(i), newPositions.at(i));
+
+    if (!keepBonds) {
+      foreach (Bond *bond, molecule->bonds())
+        molecule->removeBond(bond);
+      const QList<Atom *> atoms = molecule->atoms();
+      for (int i = 0; i + 2 < bonds.size(); i += 3) {
+        if (bonds.at(i) < 0 || bonds.at(i) >= atoms.size()
+            || bonds.at(i + 1) < 0 || bonds.at(i + 1) >= atoms.size())
+          continue;
+        molecule->addBond(atoms.at(bonds.at(i)), atoms.at(bonds.at(i + 1)),
+                          bonds.at(i + 2));
+      }
+    }
+
+    molecule->setFileName(name);
+    return molecule;
+  }
+
+} // End namespace Avogadro
@@ -0,0 +1,110 @@
+/**********************************************************************
+  AutosaveJournal - Crash recovery journal of unsaved changes
+
+  Copyright (C) 2013 Avogadro Developers
+
+  This file is part of the Avogadro molecular editor project.
+  For more information, see <http://avogadro.cc/>
+
+  Avogadro is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  Avogadro is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+  02110-1301, USA.
+ **********************************************************************/
+
+
+#ifndef AUTOSAVEJOURNAL_H
+#define AUTOSAVEJOURNAL_H
+
+#include <avogadro/moleculesnapshot.h>
+
+#include <QHash>
+#include <QString>
+#include <QStringList>
+
+namespace Avogadro {
+
+  class Molecule;
+
+  /**
+   * @class AutosaveJournal autosavejournal.h
+   * @brief Periodically record unsaved edits so they survive a crash.
+   *
+   * The journal is relative to a baseline: the molecule as last loaded from
+   * or saved to a file. Atoms that did not change since are written as
+   * ranges of baseline indices and bonds are only written if they changed,
+   * so journaling a small edit of a large structure stays cheap. When there
+   * is no file to refer to the whole molecule is written.
+   *
+   * Journals are named after the process writing them. Those left behind by
+   * a process that is no longer running are offered for recovery at startup.
+   */
+  class AutosaveJournal
+  {
+  public:
+    AutosaveJournal();
+    ~AutosaveJournal();
+
+    /**
+     * Start journaling relative to @p baseline, the current contents of
+     * @p baselineFile. Any previous journal is removed.
+     * @param baselineFile File that can be read back as @p baseline with
+     * atoms in the same order, or empty if there is none.
+     * @param documentName The name the document is saved under.
+     */
+    void setBaseline(const MoleculeSnapshot &baseline,
+                     const QString &baselineFile,
+                     const QString &documentName);
+
+    /**
+     * Write the changes from the baseline to @p current. Nothing is written
+     * if the molecule did not change since the last call.
+     * @return False if the journal could not be written.
+     */
+    bool write(const MoleculeSnapshot &current);
+
+    /**
+     * Remove the journal, e.g. once the changes were saved or discarded.
+     */
+    void remove();
+
+    /**
+     * @return The journals left behind by processes that are not running.
+     */
+    static QStringList orphanedJournals();
+
+    /**
+     * @return The document name recorded in @p journalFile.
+     */
+    static QString documentName(const QString &journalFile);
+
+    /**
+     * Rebuild the molecule recorded in @p journalFile. The caller owns the
+     * returned molecule, or 0 is returned and @p error set on failure.
+     */
+    static Molecule * recover(const QString &journalFile, QString *error = 0);
+
+  private:
+    QString m_journalFile;
+    QString m_baselineFile;
+    QString m_documentName;
+    MoleculeSnapshot m_baseline;
+    QHash<unsigned long, int> m_baselineIndex; // atom id to baseline index
+    unsigned long m_writtenVersion;
+
+    static QString journalPath();
+  };
+
+} // End namespace Avogadro
+
+#endif
@@ -0,0 +1,318 @@
+/**********************************************************************
+  ClipboardMimeData - Clipboard data serialised on demand
+
+  Copyright (C) 2013 Avogadro Developers
+
+  This file is part of the Avogadro molecular editor project.
+  For more information, see <http://avogadro.cc/>
+
+  Avogadro is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  Avogadro is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+  02110-1301, USA.
+ **********************************************************************/
+
+#include "clipboardmimedata.h"
+
+#include <avogadro/molecule.h>
+#include <avogadro/atom.h>
+#include <avogadro/bond.h>
+#include <avogadro/primitivelist.h>
+
+#include <openbabel/mol.h>
+#include <openbabel/generic.h>
+#include <openbabel/obconversion.h>
+
+#include <QStringList>
+
+#include <cmath>
+
+using namespace OpenBabel;
+using Eigen::Vector3d;
+
+namespace Avogadro {
+
+  namespace {
+    const char *molfileMimeType = "chemical/x-mdl-molfile";
+    const char *textMimeType = "text/plain";
+    const char *imageMimeType = "application/x-qt-image";
+
+    /// @todo this should live in a UnitCell class eventually
+    // Stable sort both ids and coords together to group all entries in
+    // ids together. Entries are not sorted in any particular order,
+    // just grouped. uniqIds and idCounts will contain a unique list of
+    // all ids in same order as in the sorted ids and a list containing
+    // how many of each id is in ids, respectively.
+    void poscarSort(QList<QString> *ids,
+                    QList<Eigen::Vector3d> *coords,
+                    QList<QString> *uniqueIds,
+                    QList<unsigned int> *idCounts)
+    {
+      Q_ASSERT(ids->size() == coords->size());
+      // Get unique list of ids and count them
+      uniqueIds->clear();
+      idCounts->clear();
+      for (QStringList::const_iterator
+             it = ids->constBegin(),
+             it_end = ids->constEnd();
+           it != it_end; ++it) {
+        int ind = uniqueIds->indexOf(*it);
+        if (ind != -1) {
+          ++((*idCounts)[ind]);
+        }
+        else {
+          uniqueIds->append(*it);
+          idCounts->append(1);
+        }
+      }
+
+      // Sort lists
+      QString curId;
+      QStringList::iterator idit;
+      QList<Eigen::Vector3d>::iterator coordit;
+      unsigned int sorted = 0;
+      for (int uniqInd = 0; uniqInd < uniqueIds->size();
+           ++uniqInd) {
+        curId = (*uniqueIds)[uniqInd];
+        unsigned int found = 0;
+        unsigned int count = idCounts->at(uniqInd);
+        idit = ids->begin() + sorted;
+        coordit = coords->begin() + sorted;
+        while (found < count) {
+          // Should never reach the end
+          Q_ASSERT(idit != ids->end());
+          Q_ASSERT(coordit != coords->end());
+          if (idit->compare(curId) == 0) {
+            qSwap(*idit, (*ids)[sorted]);
+            qSwap(*coordit, (*coords)[sorted]);
+            ++found;
+            ++sorted;
+          }
+          ++idit;
+          ++coordit;
+        }
+      }
+    }
+
+    // Remove negative zeros
+    inline double clean(double value)
+    {
+      return fabs(value) < 1e-10 ? 0.0 : value;
+    }
+  }
+
+  ClipboardMimeData::ClipboardMimeData(const Molecule *molecule,
+                                       const PrimitiveList &selectedItems,
+                                       const char *format)
+    : QMimeData(), m_cell(0), m_format(format ? format : ""), m_obmol(0)
+  {
+    // Only record what is needed to write the formats later
+    QList<Atom *> atoms;
+    if (selectedItems.isEmpty()) {
+      atoms = molecule->atoms();
+    }
+    else {
+      foreach(Primitive *item, selectedItems.subList(Primitive::AtomType))
+        atoms.append(static_cast<Atom *>(item));
+    }
+
+    QHash<unsigned long, int> indexMap; // key is the atom id, value our index
+    m_atomicNumbers.reserve(atoms.size());
+    m_formalCharges.reserve(atoms.size());
+    m_positions.reserve(atoms.size());
+    foreach(const Atom *atom, atoms) {
+      indexMap.insert(atom->id(), m_atomicNumbers.size());
+      m_atomicNumbers.append(atom->atomicNumber());
+      m_formalCharges.append(atom->formalCharge());
+      m_positions.push_back(*atom->pos());
+    }
+
+    // Only bonds with both atoms copied
+    foreach(const Bond *bond, molecule->bonds()) {
+      QHash<unsigned long, int>::const_iterator begin =
+        indexMap.constFind(bond->beginAtomId());
+      QHash<unsigned long, int>::const_iterator end =
+        indexMap.constFind(bond->endAtomId());
+      if (begin != indexMap.constEnd() && end != indexMap.constEnd()) {
+        m_bondAtoms << begin.value() << end.value();
+        m_bondOrders << bond->order();
+      }
+    }
+
+    if (molecule->OBUnitCell())
+      m_cell = new OBUnitCell(*(molecule->OBUnitCell()));
+  }
+
+  ClipboardMimeData::~ClipboardMimeData()
+  {
+    delete m_obmol;
+    delete m_cell;
+  }
+
+  void ClipboardMimeData::setSnapshotImage(const QImage &image)
+  {
+    m_image = image;
+  }
+
+  QStringList ClipboardMimeData::formats() const
+  {
+    QStringList list;
+    if (m_format.isEmpty()) {
+      list << molfileMimeType;
+      if (!m_image.isNull())
+        list << imageMimeType;
+    }
+    list << textMimeType;
+    return list;
+  }
+
+  bool ClipboardMimeData::hasFormat(const QString &mimeType) const
+  {
+    return formats().contains(mimeType);
+  }
+
+  QVariant ClipboardMimeData::retrieveData(const QString &mimeType,
+                                           QVariant::Type type) const
+  {
+    if (mimeType == textMimeType) {
+      if (!m_format.isEmpty()) // remove any newlines or whitespace
+        return QString(write(m_format)).trimmed();
+      // XYZ coordinates for finite systems, or POSCAR if a unit cell is
+      // available
+      if (m_cell)
+        return poscar();
+      return QString(write("xyz"));
+    }
+
+    if (!m_format.isEmpty())
+      return QMimeData::retrieveData(mimeType, type);
+
+    if (mimeType == molfileMimeType)
+      return write("mdl");
+
+    if (mimeType == imageMimeType && !m_image.isNull()) {
+      // we embed the molfile into the image
+      // e.g. http://baoilleach.blogspot.com/2007/08/access-embedded-molecular-information.html
+      QImage image(m_image);
+      image.setText("molfile", write("mdl"));
+      QByteArray smiles = write("can");
+      if (!smiles.isEmpty())
+        image.setText("SMILES", smiles);
+      return image;
+    }
+
+    return QMimeData::retrieveData(mimeType, type);
+  }
+
+  QByteArray ClipboardMimeData::write(const QString &format) const
+  {
+    QHash<QString, QByteArray>::const_iterator it = m_cache.constFind(format);
+    if (it != m_cache.constEnd())
+      return it.value();
+
+    QByteArray data;
+    OBConversion conv;
+    OBFormat *obFormat = conv.FindFormat(format.toAscii().data());
+    if (obFormat && conv.SetOutFormat(obFormat)) {
+      const OBMol &mol = obmol();
+      std::string output = conv.WriteString(const_cast<OBMol *>(&mol));
+      data = QByteArray(output.c_str(), output.length());
+    }
+    m_cache.insert(format, data);
+    return data;
+  }
+
+  const OBMol & ClipboardMimeData::obmol() const
+  {
+    if (m_obmol)
+      return *m_obmol;
+
+    m_obmol = new OBMol;
+    m_obmol->BeginModify();
+    for (int i = 0; i < m_atomicNumbers.size(); ++i) {
+      OBAtom *atom = m_obmol->NewAtom();
+      atom->SetAtomicNum(m_atomicNumbers.at(i));
+      atom->SetFormalCharge(m_formalCharges.at(i));
+      const Vector3d &pos = m_positions[i];
+      atom->SetVector(pos.x(), pos.y(), pos.z());
+    }
+    // Open Babel indexes atoms from 1
+    for (int i = 0; i < m_bondOrders.size(); ++i)
+      m_obmol->AddBond(m_bondAtoms.at(2 * i) + 1, m_bondAtoms.at(2 * i + 1) + 1,
+                       m_bondOrders.at(i));
+    m_obmol->EndModify();
+
+    if (m_cell)
+      m_obmol->SetData(m_cell->Clone(m_obmol));
+    return *m_obmol;
+  }
+
+  /// @todo this should live in a UnitCell class eventually
+  QString ClipboardMimeData::poscar() const
+  {
+    if (!m_cell)
+      return "";
+
+    // Atomic symbols and fractional coordinates
+    QStringList ids;
+    QList<Vector3d> fcoords;
+    for (int i = 0; i < m_atomicNumbers.size(); ++i) {
+      ids << etab.GetSymbol(m_atomicNumbers.at(i));
+      const Vector3d &pos = m_positions[i];
+      vector3 obtmp = m_cell->CartesianToFractional(vector3(pos.x(), pos.y(),
+                                                            pos.z()));
+      fcoords << Vector3d(obtmp.x(), obtmp.y(), obtmp.z());
+    }
+
+    // For sorting
+    QStringList uniqueIds;
+    QList<unsigned int> idCounts;
+    poscarSort(&ids, &fcoords, &uniqueIds, &idCounts);
+    Q_ASSERT(uniqueIds.size() == idCounts.size());
+
+    QString poscar;
+    // Comment line: composition
+    for (int i = 0; i < uniqueIds.size(); ++i)
+      poscar += QString("%1%2 ").arg(uniqueIds[i]).arg(idCounts[i]);
+    poscar += "\n";
+    // Scaling factor. Just 1.0
+    poscar += QString::number(1.0);
+    poscar += "\n";
+    // Unit Cell Vectors
+    std::vector<vector3> vecs = m_cell->GetCellVectors();
+    for (unsigned int i = 0; i < vecs.size(); ++i) {
+      poscar += QString("  %1 %2 %3\n")
+        .arg(clean(vecs[i].x()), 12, 'f', 8)
+        .arg(clean(vecs[i].y()), 12, 'f', 8)
+        .arg(clean(vecs[i].z()), 12, 'f', 8);
+    }
+    // Number of each type of atom
+    for (int i = 0; i < idCounts.size(); ++i)
+      poscar += QString::number(idCounts.at(i)) + " ";
+    poscar += "\n";
+    // Use fractional coordinates:
+    poscar += "Direct\n";
+    // Coordinates of each atom
+    for (int i = 0; i < fcoords.size(); ++i) {
+      poscar += QString("  %1 %2 %3\n")
+        .arg(clean(fcoords[i].x()), 12, 'f', 8)
+        .arg(clean(fcoords[i].y()), 12, 'f', 8)
+        .arg(clean(fcoords[i].z()), 12, 'f', 8);
+    }
+
+    return poscar;
+  }
+
+} // End namespace Avogadro
+
+#include "clipboardmimedata.moc"
@@ -0,0 +1,115 @@
+/**********************************************************************
+  ClipboardMimeData - Clipboard data serialised on demand
+
+  Copyright (C) 2013 Avogadro Developers
+
+  This file is part of the Avogadro molecular editor project.
+  For more information, see <http://avogadro.cc/>
+
+  Avogadro is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  Avogadro is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+  02110-1301, USA.
+ **********************************************************************/
+
+#ifndef CLIPBOARDMIMEDATA_H
+#define CLIPBOARDMIMEDATA_H
+
+#include <QMimeData>
+#include <QHash>
+#include <QImage>
+#include <QVector>
+
+#include <Eigen/Core>
+
+#include <vector>
+
+namespace OpenBabel {
+  class OBMol;
+  class OBUnitCell;
+}
+
+namespace Avogadro {
+
+  class Molecule;
+  class PrimitiveList;
+
+  /**
+   * @class ClipboardMimeData clipboardmimedata.h
+   * @brief Mime data for cut and copy which is only serialised when pasted.
+   *
+   * The selected atoms and bonds are recorded as plain arrays when the data
+   * is created. Each format is written the first time it is retrieved by a
+   * paste target and then cached, so copying a large selection does not wait
+   * for conversions that are never used.
+   */
+  class ClipboardMimeData : public QMimeData
+  {
+    Q_OBJECT
+
+  public:
+    /**
+     * Record the selected atoms and bonds of @p molecule, or the whole
+     * molecule if @p selectedItems is empty.
+     * @param format The Open Babel format to offer as plain text only (e.g.
+     * "smi"), or 0 for the default set of formats.
+     */
+    ClipboardMimeData(const Molecule *molecule,
+                      const PrimitiveList &selectedItems,
+                      const char *format = 0);
+    ~ClipboardMimeData();
+
+    /**
+     * Set the image offered to office programs. The molfile and SMILES are
+     * embedded in it when it is first retrieved.
+     */
+    void setSnapshotImage(const QImage &image);
+
+    QStringList formats() const;
+    bool hasFormat(const QString &mimeType) const;
+
+  protected:
+    QVariant retrieveData(const QString &mimeType,
+                          QVariant::Type type) const;
+
+  private:
+    /**
+     * @return The serialised snapshot in Open Babel @p format, written on
+     * first use.
+     */
+    QByteArray write(const QString &format) const;
+
+    /**
+     * @return Fractional coordinates in POSCAR format for the unit cell.
+     */
+    QString poscar() const;
+
+    const OpenBabel::OBMol & obmol() const;
+
+    QVector<int> m_atomicNumbers;
+    QVector<int> m_formalCharges;
+    std::vector<Eigen::Vector3d> m_positions;
+    QVector<int> m_bondAtoms; // Pairs of atom indices
+    QVector<short> m_bondOrders;
+    OpenBabel::OBUnitCell *m_cell;
+
+    QString m_format;
+    QImage m_image;
+
+    mutable OpenBabel::OBMol *m_obmol;
+    mutable QHash<QString, QByteArray> m_cache;
+  };
+
+} // End namespace Avogadro
+
+#endif
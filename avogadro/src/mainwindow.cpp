@@ -30,11 +30,14 @@
 
 #include "aboutdialog.h"
 #include "addenginedialog.h"
+#include "autosavejournal.h"
+#include "clipboardmimedata.h"
 #include "editcommands.h"
 #include "importdialog.h"
 #include "settingsdialog.h"
 #include "pluginsettings.h"
 #include "savedialog.h"
+#include "savefilethread.h"
 
 #include "engineitemmodel.h"
 #include "engineviewwidget.h"
@@ -61,10 +64,13 @@
 #include "projecttreemodel.h"
 
 #include <avogadro/camera.h>
+#include <avogadro/cifreader.h>
 #include <avogadro/extension.h>
 #include <avogadro/engine.h>
 
 #include <avogadro/moleculefile.h>
+#include <avogadro/moleculesnapshot.h>
+#include <avogadro/trajectoryreader.h>
 
 #include <avogadro/primitive.h>
 #include <avogadro/atom.h>
@@ -111,6 +117,7 @@
 #include <QStatusBar>
 #include <QTableWidget>
 #include <QProgressDialog>
+#include <QProgressBar>
 
 #include <QDebug>
 
@@ -258,7 +265,9 @@ protected:
       moleculeFile(0), currentIndex(0),
       progressDialog(0),
       allMoleculesTable(0),
-      allMoleculesDialog(0)
+      allMoleculesDialog(0),
+      saveThread(0), moleculeGeneration(0), savingGeneration(0),
+      saveProgress(0), autosaveTimer(0)
     {}
 
     Molecule  *molecule;
@@ -323,6 +332,15 @@ protected:
     QDialog       *allMoleculesDialog;
 
     QMap<Engine*, QWidget*> engineSettingsWindows;
+
+    // Saving in the background and crash recovery
+    SaveFileThread *saveThread;
+    // Counts setMolecule() calls, a replaced molecule may reuse the address
+    unsigned int moleculeGeneration;
+    unsigned int savingGeneration;
+    QProgressBar *saveProgress;
+    QTimer *autosaveTimer;
+    AutosaveJournal journal;
   };
 
   const int MainWindow::m_configFileVersion = 3;
@@ -382,6 +400,11 @@ protected:
 
     d->undoStack = new QUndoStack( this );
 
+    // Periodically journal unsaved changes, the interval is set in
+    // readSettings()
+    d->autosaveTimer = new QTimer(this);
+    connect(d->autosaveTimer, SIGNAL(timeout()), this, SLOT(autosave()));
+
     d->toolGroup = new ToolGroup( this );
     connect(&(d->pluginManager), SIGNAL(reloadPlugins()),
             this, SLOT(reloadPlugins()));
@@ -686,6 +709,13 @@ protected:
 
       // if we don't have a molecule then load a blank file
       d->initialized = true;
+
+      // Offer to recover work from a previous crash, once per session
+      static bool checkedJournals = false;
+      if (!checkedJournals) {
+        checkedJournals = true;
+        QTimer::singleShot(0, this, SLOT(recoverJournals()));
+      }
     }
 #ifdef Q_WS_MAC
     else if(event->type() == QEvent::ActivationChange
@@ -1078,6 +1108,8 @@ protected:
       if (mol) {
         setFileName(fileName);
         setMolecule(mol);
+        if (formatType.isEmpty() && options.isEmpty())
+          d->journal.setBaseline(mol->snapshot(), d->fileName, d->fileName);
       }
       else {
         QMessageBox::warning(this, tr("Avogadro"),
@@ -1090,6 +1122,30 @@ protected:
     // Other file types appear to work correctly - this should be fixed properly
 #endif
 
+    // CIF, mmCIF and periodic trajectory files have native readers that
+    // are faster than the OpenBabel ones, so they skip the multi-molecule
+    // thread
+    if (CifReader::canRead(fileName, formatType.trimmed())
+        || TrajectoryReader::canRead(fileName, formatType.trimmed())) {
+      QString error;
+      Molecule *mol = MoleculeFile::readMolecule(fileName, formatType.trimmed(),
+                                                 options, &error);
+      QApplication::restoreOverrideCursor();
+      if (!mol) {
+        QMessageBox::warning(this, tr("Avogadro"), error);
+        return false;
+      }
+      setMolecule(mol);
+      setFileName(fileName);
+      setWindowFilePath(fileName); // for MacOS X
+      if (formatType.isEmpty() && options.isEmpty())
+        d->journal.setBaseline(mol->snapshot(), d->fileName, d->fileName);
+      ui.actionAllMolecules->setEnabled(false);
+      statusBar()->showMessage(tr("File Loaded..."), 5000);
+      d->toolGroup->setActiveTool("Navigate");
+      return true;
+    }
+
     // This will work in a background thread -- we want to wait until the firstMolReady() signal appears
     d->moleculeFile = MoleculeFile::readFile(fileName, formatType.trimmed(),
                                              options, false);
@@ -1264,10 +1320,13 @@ protected:
 
     QString errors = d->moleculeFile->errors();
     OBMol *obMolecule = d->moleculeFile->OBMol();
+    // Coordinates generated here do not match the file contents
+    bool coordinatesFromFile = false;
     if (errors.isEmpty() && obMolecule != NULL) { // successful read
 
       qDebug() << " read " << d->moleculeFile->numMolecules() << " molecules.";
 
+      coordinatesFromFile = obMolecule->GetDimension() == 3;
       // e.g. SMILES or MDL molfile, etc.
       check3DCoords(obMolecule);
 
@@ -1322,6 +1381,10 @@ protected:
 
     setFileName( d->moleculeFile->fileName() );
     setWindowFilePath(d->moleculeFile->fileName()); // for MacOS X
+    // Journal relative to the file if reading it again gives the same atoms
+    if (coordinatesFromFile && !d->moleculeFile->isConformerFile()
+        && d->moleculeFile->fileType().isEmpty())
+      d->journal.setBaseline(d->molecule->snapshot(), d->fileName, d->fileName);
 #ifdef Q_WS_MAC
     updateWindowMenu();
 #endif
@@ -1360,7 +1423,8 @@ protected:
 
       if ( ret == QMessageBox::Save ) {
         delete msgBox;
-        return save();
+        // Only carry on once the changes are really on disk
+        return save() && waitForSave();
       }
       else if ( ret == QMessageBox::Cancel ) {
         delete msgBox;
@@ -1375,7 +1439,7 @@ protected:
   // Not used on Mac: the window is closed via closeEvent() instead
   void MainWindow::closeFile()
   {
-    if (maybeSave())
+    if (maybeSave() && waitForSave())
       loadFile();
   }
 
@@ -1388,7 +1452,8 @@ protected:
     unsigned int mainWindowCount = getMainWindowCount();
 
     if ( mainWindowCount == 1 && isVisible() ) {
-      if ( maybeSave() ) {
+      if ( maybeSave() && waitForSave() ) {
+        d->journal.remove();
         writeSettings();
 
         // Clear the undo stack first (or we'll have an enabled Undo command)
@@ -1400,7 +1465,8 @@ protected:
     }
 #endif
 
-    if ( maybeSave() ) {
+    if ( maybeSave() && waitForSave() ) {
+      d->journal.remove();
       emit(windowClosed());
       writeSettings();
       event->accept();
@@ -1468,12 +1534,8 @@ protected:
       d->moleculeFile = 0;
     }
 
-    // we must save the file before we can set the fileName
-    bool result = saveFile( fileName );
-
-    setFileName( fileName );
-
-    return result;
+    // the fileName is set once the file was written, see saveFinished()
+    return saveFile( fileName );
   }
 
   bool MainWindow::saveFile( const QString &fileName, OBFormat *format )
@@ -1483,38 +1545,48 @@ protected:
       formatType = format->GetID();
     }
 
-    if (!d->moleculeFile) {
-      // just save this one molecule
-      QString error;
-      bool result = MoleculeFile::writeMolecule(d->molecule, fileName,
-                                                formatType.trimmed(), "",
-                                                &error);
-      if (!result) { // There was an error saving the file - inform the user
-        QApplication::restoreOverrideCursor();
-        QMessageBox::warning(this, tr("Avogadro"), error);
+    // Only one save at a time, the last one wins
+    if (!waitForSave())
+      return false;
+
+    if (d->moleculeFile && !d->moleculeFile->isConformerFile()) {
+      // use MoleculeFile to save just the current slice of the file
+      bool success = d->moleculeFile->replaceMolecule(d->currentIndex,
+                                                      d->molecule, fileName);
+      QApplication::restoreOverrideCursor();
+      if (!success) {
+        statusBar()->showMessage(tr("Saving molecular file failed."), 5000);
+        QMessageBox::warning(this, tr("Avogadro"),
+                             d->moleculeFile->errors());
         return false;
       }
-      else {
-        QApplication::restoreOverrideCursor();
-        setWindowModified(false);
-        return true;
-      }
+      setWindowModified(false);
+      return true;
     }
-    else { /// FIXME Add error checking
-      if (d->moleculeFile->isConformerFile()) {
-        MoleculeFile::writeConformers(d->molecule, fileName, formatType.trimmed());
-        QApplication::restoreOverrideCursor();
-        setWindowModified(false);
-        return true;
-      }
-      else { /// FIXME Add error checking
-        // use MoleculeFile to save just the current slice of the file
-        d->moleculeFile->replaceMolecule(d->currentIndex, d->molecule, fileName);
-        QApplication::restoreOverrideCursor();
-        setWindowModified(false);
-        return true;
-      }
+
+    // Open Babel writes a converted copy of the molecule in the background.
+    // The window stays modified until saveFinished() gets the result.
+    d->saveThread = new SaveFileThread(d->molecule, fileName,
+                                       formatType.trimmed(),
+                                       d->moleculeFile != 0
+                                       && d->moleculeFile->isConformerFile(),
+                                       this);
+    connect(d->saveThread, SIGNAL(finished()), this, SLOT(saveFinished()));
+    d->savingGeneration = d->moleculeGeneration;
+
+    if (!d->saveProgress) {
+      d->saveProgress = new QProgressBar(this);
+      d->saveProgress->setRange(0, 0); // indeterminate progress
+      d->saveProgress->setMaximumWidth(120);
+      statusBar()->addPermanentWidget(d->saveProgress);
     }
+    d->saveProgress->show();
+    statusBar()->showMessage(tr("Saving %1...", "%1 is a filename")
+                             .arg(QFileInfo(fileName).fileName()));
+
+    d->saveThread->start();
+    return true;
+
     /*
     QFile file(fileName);
     bool replaceExistingFile = file.exists();
@@ -1638,6 +1710,93 @@ protected:
     return false;
   }
 
+  void MainWindow::saveFinished()
+  {
+    // Already handled by waitForSave(), or a later save is still running
+    if (!d->saveThread || d->saveThread->isRunning())
+      return;
+
+    SaveFileThread *thread = d->saveThread;
+    d->saveThread = 0;
+    thread->deleteLater();
+    if (d->saveProgress)
+      d->saveProgress->hide();
+
+    if (!thread->success()) {
+      statusBar()->showMessage(tr("Saving molecular file failed."), 5000);
+      QString error = thread->error();
+      if (error.isEmpty())
+        error = tr("Saving molecular file %1 failed.").arg(thread->fileName());
+      QMessageBox::warning(this, tr("Avogadro"), error);
+      return;
+    }
+
+    statusBar()->showMessage(tr("Save succeeded."), 5000);
+    // The window may have been given another molecule in the meantime
+    if (d->moleculeGeneration != d->savingGeneration)
+      return;
+
+    setFileName(thread->fileName());
+    // Edits made while the file was written still need saving
+    MoleculeSnapshot saved = thread->snapshot();
+    if (d->molecule->snapshot().version() == saved.version())
+      setWindowModified(false);
+    // Only the changes since this save need journaling from now on
+    d->journal.setBaseline(saved,
+                           thread->conformers() ? QString() : d->fileName,
+                           d->fileName);
+  }
+
+  bool MainWindow::waitForSave()
+  {
+    if (!d->saveThread)
+      return true;
+
+    d->saveThread->wait();
+    bool success = d->saveThread->success();
+    saveFinished();
+    return success;
+  }
+
+  void MainWindow::autosave()
+  {
+    if (d->molecule && isWindowModified())
+      d->journal.write(d->molecule->snapshot());
+  }
+
+  void MainWindow::recoverJournals()
+  {
+    foreach (const QString &journal, AutosaveJournal::orphanedJournals()) {
+      QString name = QFileInfo(AutosaveJournal::documentName(journal)).fileName();
+      if (name.isEmpty())
+        name = defaultFileName();
+      int ret = QMessageBox::question(this, tr("Avogadro"),
+          tr("Avogadro did not exit cleanly while editing %1.\n"
+             "Do you want to recover the unsaved changes?",
+             "%1 is a filename").arg(name),
+          QMessageBox::Yes | QMessageBox::No, QMessageBox::Yes);
+
+      if (ret == QMessageBox::Yes) {
+        QString error;
+        Molecule *mol = AutosaveJournal::recover(journal, &error);
+        if (mol) {
+          // Use this window unless it is already in use
+          MainWindow *window = this;
+          if (d->molecule->numAtoms() || isWindowModified()) {
+            window = new MainWindow;
+            window->show();
+          }
+          window->setMolecule(mol);
+          window->documentWasModified();
+        }
+        else {
+          QMessageBox::warning(this, tr("Avogadro"), error);
+        }
+      }
+      QFile::remove(journal);
+    }
+  }
+
   void MainWindow::setIgnoreConfig(bool noConfig)
   {
     m_ignoreConfig = noConfig;
@@ -2200,287 +2359,45 @@ protected:
     return true;
   }
 
-  /// @todo this should live in a UnitCell class eventually
-  // Stable sort both ids and coords together to group all entries in
-  // ids together. Entries are not sorted in any particular order,
-  // just grouped. uniqIds and idCounts will contain a unique list of
-  // all ids in same order as in the sorted ids and a list containing
-  // how many of each id is in ids, respectively.
-  void poscarSort(QList<QString> *ids,
-                  QList<Eigen::Vector3d> *coords,
-                  QList<QString> *uniqueIds,
-                  QList<unsigned int> *idCounts)
-  {
-    Q_ASSERT(ids->size() == coords->size());
-    // Get unique list of ids and count them
-    uniqueIds->clear();
-    idCounts->clear();
-    for (QStringList::const_iterator
-           it = ids->constBegin(),
-           it_end = ids->constEnd();
-         it != it_end; ++it) {
-      int ind = uniqueIds->indexOf(*it);
-      if (ind != -1) {
-        ++((*idCounts)[ind]);
-      }
-      else {
-        uniqueIds->append(*it);
-        idCounts->append(1);
-      }
-    }
-
-    // Sort lists
-    QString curId;
-    QStringList::iterator idit;
-    QList<Eigen::Vector3d>::iterator coordit;
-    unsigned int sorted = 0;
-    for (int uniqInd = 0; uniqInd < uniqueIds->size();
-         ++uniqInd) {
-      curId = (*uniqueIds)[uniqInd];
-      unsigned int found = 0;
-      unsigned int count = idCounts->at(uniqInd);
-      idit = ids->begin() + sorted;
-      coordit = coords->begin() + sorted;
-      while (found < count) {
-        // Should never reach the end
-        Q_ASSERT(idit != ids->end());
-        Q_ASSERT(coordit != coords->end());
-        if (idit->compare(curId) == 0) {
-          qSwap(*idit, (*ids)[sorted]);
-          qSwap(*coordit, (*coords)[sorted]);
-          ++found;
-          ++sorted;
-        }
-        ++idit;
-        ++coordit;
-      }
-    }
-  }
-
-  /// @todo this should live in a UnitCell class eventually
-  QString getPOSCAR(Molecule *mol)
-  {
-    OBUnitCell *cell = mol->OBUnitCell();
-    if (!cell) {
-      return "";
-    }
-
-    QList<Atom*> atoms = mol->atoms();
-
-    // Atomic symbols:
-    QStringList ids;
-    for (QList<Atom*>::const_iterator it = atoms.constBegin(),
-           it_end = atoms.constEnd(); it != it_end; ++it) {
-      ids << OpenBabel::etab.GetSymbol((*it)->atomicNumber());
-    }
-
-    // Fractional coordinates
-    QList<Vector3d> fcoords;
-    const Vector3d *eigenptr;
-    vector3 obtmp;
-    for (QList<Atom*>::const_iterator it = atoms.begin(),
-           it_end = atoms.end(); it != it_end; ++it) {
-      // Convert eigen to OB
-      eigenptr = (*it)->pos();
-      obtmp.x() = eigenptr->x();
-      obtmp.y() = eigenptr->y();
-      obtmp.z() = eigenptr->z();
-      // Convert cartesian -> fractional
-      obtmp = cell->CartesianToFractional(obtmp);
-      // Back to eigen
-      fcoords << Vector3d(obtmp.x(), obtmp.y(), obtmp.z());
-    }
-
-    // For sorting
-    QStringList uniqueIds;
-    QList<unsigned int> idCounts;
-
-    Q_ASSERT(fcoords.size() == ids.size());
-
-    poscarSort(&ids, &fcoords, &uniqueIds, &idCounts);
-
-    Q_ASSERT(uniqueIds.size() == idCounts.size());
-
-    QString poscar;
-
-    // Comment line: composition
-    for (unsigned int i = 0;
-         i < static_cast<unsigned int>(uniqueIds.size());
-         ++i) {
-      poscar += QString("%1%2 ").arg(uniqueIds[i]).arg(idCounts[i]);
-    }
-    poscar += "\n";
-    // Scaling factor. Just 1.0
-    poscar += QString::number(1.0);
-    poscar += "\n";
-    // Unit Cell Vectors
-    std::vector< OpenBabel::vector3 > vecs = cell->GetCellVectors();
-    for (unsigned int i = 0; i < vecs.size(); i++) {
-      OpenBabel::vector3 &vec = vecs[i];
-      // Remove negative zeros
-      if (fabs(vec.x()) < 1e-10) {
-        vec.x() = 0.0;
-      }
-      if (fabs(vec.y()) < 1e-10) {
-        vec.y() = 0.0;
-      }
-      if (fabs(vec.z()) < 1e-10) {
-        vec.z() = 0.0;
-      }
-      poscar += QString("  %1 %2 %3\n")
-        .arg(vec.x(), 12, 'f', 8)
-        .arg(vec.y(), 12, 'f', 8)
-        .arg(vec.z(), 12, 'f', 8);
-    }
-    // Number of each type of atom
-    for (int i = 0; i < idCounts.size(); i++) {
-      poscar += QString::number(idCounts.at(i)) + " ";
-    }
-    poscar += "\n";
-    // Use fractional coordinates:
-    poscar += "Direct\n";
-    // Coordinates of each atom
-    for (int i = 0; i < fcoords.size(); i++) {
-      Eigen::Vector3d &fcoord = fcoords[i];
-      // Remove negative zeros
-      if (fabs(fcoord.x()) < 1e-10) {
-        fcoord.x() = 0.0;
-      }
-      if (fabs(fcoord.y()) < 1e-10) {
-        fcoord.y() = 0.0;
-      }
-      if (fabs(fcoord.z()) < 1e-10) {
-        fcoord.z() = 0.0;
-      }
-      poscar += QString("  %1 %2 %3\n")
-        .arg(fcoord.x(), 12, 'f', 8)
-        .arg(fcoord.y(), 12, 'f', 8)
-        .arg(fcoord.z(), 12, 'f', 8);
-    }
-
-    return poscar;
-  }
-
   // Helper function -- works for "cut" or "copy"
   // FIXME add parameter to set "Copy" or "Cut" in messages
   QMimeData* MainWindow::prepareClipboardData(PrimitiveList selectedItems,
                                               const char* format)
   {
-    QMimeData *mimeData = new QMimeData;
-    QImage clipboardImage;
-
-    Molecule *moleculeCopy = d->molecule;
-    if (!selectedItems.isEmpty()) { // we only want to copy the selected items
-      moleculeCopy = new Molecule;
-      std::map<unsigned int, unsigned int> AtomMap; // key is from old, value from new
-      // copy atoms and create a map of atom indices
-      foreach(Primitive *item, selectedItems.subList(Primitive::AtomType)) {
-        Atom *selected = moleculeCopy->addAtom();
-        *selected = *(static_cast<Atom *>(item));
-        AtomMap[item->id()] = selected->id();
-      }
-
-      // use the atom map to map bonds
-      map<unsigned int, unsigned int>::iterator posBegin, posEnd;
-      QList<Bond*> bonds = d->molecule->bonds();
-      foreach(const Bond *bond, bonds) {
-        posBegin = AtomMap.find(bond->beginAtomId());
-        posEnd = AtomMap.find(bond->endAtomId());
-        // make sure both bonds are in the map (i.e. selected)
-        if ( posBegin != AtomMap.end() && posEnd != AtomMap.end() ) {
-          Bond *bondCopy = moleculeCopy->addBond();
-          bondCopy->setAtoms(posBegin->second, posEnd->second, bond->order());
-        }
-      } // end looping over bonds
-
-      // Copy unit cell, if available
-      if (d->molecule->OBUnitCell()) {
-        moleculeCopy->setOBUnitCell
-          (new OBUnitCell(*(d->molecule->OBUnitCell())));
-      }
-    } // should now have a copy of our selected fragment
-
-    if (!format) {
-      // Default:
-      // we also save an image for copy/paste to office programs, presentations, etc.
-      // we do this first, so we can embed the molecular data too
-      d->glWidget->raise();
-      d->glWidget->repaint();
-      if (QGLFramebufferObject::hasOpenGLFramebufferObjects()) {
-        clipboardImage = d->glWidget->grabFrameBuffer( true );
-      } else {
-        QPixmap pixmap = QPixmap::grabWindow( d->glWidget->winId() );
-        clipboardImage = pixmap.toImage();
-      }
-    }
-
+    // Only check the formats are available, they are written when pasted
     OBConversion conv;
     if (format) {
       // The user specified a format (e.g., SMILES) so use it
-      OBFormat *pFormat = conv.FindFormat(format);
-      if (!pFormat || !conv.SetOutFormat(pFormat)) {
+      if (!conv.FindFormat(format)) {
         statusBar()->showMessage( tr( "Copy failed (format unavailable)." ), 5000 );
         return NULL; // nothing in it yet
       }
-
-      OBMol obmol = moleculeCopy->OBMol();
-      string output = conv.WriteString(&obmol);
-      QString copyData(output.c_str());
-      mimeData->setText(copyData.trimmed()); // remove any newlines or whitespace
+      return new ClipboardMimeData(d->molecule, selectedItems, format);
     }
-    else {
-      // MDL format is used for main copy -- atoms, bonds, chirality
-      // supports either 2D or 3D, generic data
-      // CML is another option, but not as well tested in Open Babel
-      OBFormat *mdlFormat = conv.FindFormat("mdl");
-      if (!mdlFormat || !conv.SetOutFormat(mdlFormat)) {
-        statusBar()->showMessage( tr( "Copy failed (mdl unavailable)." ), 5000 );
-        return NULL; // nothing in it yet
-      }
-
-      // write an MDL file first (with bond orders, radicals, etc.)
-      // (CML might be better in the future, but this works well now)
-      OBMol obmol = moleculeCopy->OBMol();
-      string output = conv.WriteString(&obmol);
-      QByteArray copyData(output.c_str(), output.length());
-      mimeData->setData("chemical/x-mdl-molfile", copyData);
-
-      // we embed the molfile into the image
-      // e.g. http://baoilleach.blogspot.com/2007/08/access-embedded-molecular-information.html
-      clipboardImage.setText("molfile", copyData);
-
-      // save a canonical SMILES too
-      OBFormat *canFormat = conv.FindFormat("can");
-      if ( canFormat && conv.SetOutFormat( canFormat ) ) {
-        output = conv.WriteString(&obmol);
-        copyData = output.c_str();
-        clipboardImage.setText("SMILES", copyData);
-      }
 
-      // Copy XYZ coordinates to the text selection buffer for finite
-      // systems, or POSCAR if a unit cell is available
-      OBUnitCell *cell = moleculeCopy->OBUnitCell();
-      if (!cell) {
-        OBFormat *xyzFormat = conv.FindFormat("xyz");
-        if ( xyzFormat && conv.SetOutFormat(xyzFormat)) {
-          output = conv.WriteString(&obmol);
-          copyData = output.c_str();
-          mimeData->setText(QString(copyData));
-        }
-      }
-      else {
-        QString poscar = getPOSCAR(moleculeCopy);
-        mimeData->setText(poscar);
-      }
-
-      // save the image to the clipboard too
-      mimeData->setImageData(clipboardImage);
+    // MDL format is used for main copy -- atoms, bonds, chirality
+    // supports either 2D or 3D, generic data
+    // CML is another option, but not as well tested in Open Babel
+    if (!conv.FindFormat("mdl")) {
+      statusBar()->showMessage( tr( "Copy failed (mdl unavailable)." ), 5000 );
+      return NULL; // nothing in it yet
     }
 
-    // need to free our temporary moleculeCopy
-    if (!selectedItems.isEmpty()) {
-      delete moleculeCopy;
+    ClipboardMimeData *mimeData = new ClipboardMimeData(d->molecule,
+                                                        selectedItems);
+
+    // we also save an image for copy/paste to office programs, presentations, etc.
+    // this has to be grabbed now, while it still shows the copied structure
+    QImage clipboardImage;
+    d->glWidget->raise();
+    d->glWidget->repaint();
+    if (QGLFramebufferObject::hasOpenGLFramebufferObjects()) {
+      clipboardImage = d->glWidget->grabFrameBuffer( true );
+    } else {
+      QPixmap pixmap = QPixmap::grabWindow( d->glWidget->winId() );
+      clipboardImage = pixmap.toImage();
     }
+    mimeData->setSnapshotImage(clipboardImage);
 
     return mimeData;
   }
@@ -3107,9 +3024,12 @@ protected:
     d->undoStack->clear();
 
     d->molecule = molecule;
+    ++d->moleculeGeneration;
 
     QString newFileName = molecule->fileName();
     setFileName(newFileName);
+    // Until the molecule is known to match a file, journal all of it
+    d->journal.setBaseline(molecule->snapshot(), QString(), d->fileName);
 
     if (newFileName.isEmpty())
       setWindowFilePath(defaultFileName());
@@ -3118,6 +3038,8 @@ protected:
 
     connect(d->molecule, SIGNAL(primitiveAdded(Primitive *)),
              this, SLOT(documentWasModified()));
+    connect(d->molecule, SIGNAL(primitivesAdded(PrimitiveList)),
+             this, SLOT(documentWasModified()));
     connect(d->molecule, SIGNAL(primitiveUpdated(Primitive *)),
              this, SLOT(documentWasModified() ) );
     connect(d->molecule, SIGNAL(primitiveRemoved(Primitive *)),
@@ -3144,12 +3066,9 @@ protected:
     if (!model)
       return;
 
-    ProjectTreeItem *projectItem = model->item(index);
-    if (projectItem) {
-      d->glWidget->clearSelected();
-      d->glWidget->setSelected(projectItem->primitives(), true);
-      d->glWidget->update();
-    }
+    d->glWidget->clearSelected();
+    d->glWidget->setSelected(model->primitives(index), true);
+    d->glWidget->update();
   }
 
   Molecule *MainWindow::molecule() const
@@ -3273,6 +3192,13 @@ protected:
 
     d->fileDialogPath = settings.value("openDialogPath").toString();
 
+    // Minutes between journaling unsaved changes, 0 to disable
+    int autosaveInterval = settings.value("autosaveInterval", 2).toInt();
+    if (autosaveInterval > 0)
+      d->autosaveTimer->start(autosaveInterval * 60000);
+    else
+      d->autosaveTimer->stop();
+
     QByteArray ba = settings.value( "state" ).toByteArray();
     if(!ba.isEmpty())
     {
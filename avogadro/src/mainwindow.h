@@ -95,6 +95,10 @@ namespace Avogadro {
 
       /**
        * @param fileName the filename to save the currently loaded file to
+       * @return False if the file could not be written or the save could not
+       * be started. Most files are written in the background: a failure is
+       * then reported to the user, and the window is only marked as
+       * unmodified once the file was written.
        */
       bool saveFile(const QString &fileName,
             OpenBabel::OBFormat *format = NULL);
@@ -262,6 +266,9 @@ namespace Avogadro {
       void connectUi();
 
       bool maybeSave();
+      //! Wait for a save in the background to finish
+      //! \return false if it failed
+      bool waitForSave();
       void setFileName(const QString &fileName);
       void updateRecentFileActions();
 
@@ -316,6 +323,11 @@ namespace Avogadro {
       void firstMolReady();
       void finishLoadFile();
 
+      // saving in the background and crash recovery
+      void saveFinished();
+      void autosave();
+      void recoverJournals();
+
       // select a molecule out of a multi-molecule file
       void selectMolecule(int index, int column);
 
@@ -33,6 +33,7 @@
 #include <avogadro/residue.h>
 #include <avogadro/molecule.h>
 #include <avogadro/engine.h>
+#include <avogadro/primitivelist.h>
 
 #include <openbabel/mol.h>
 
@@ -97,6 +98,8 @@ namespace Avogadro {
 
     connect(molecule, SIGNAL(primitiveAdded(Primitive *)),
         this, SLOT(addPrimitive(Primitive *)));
+    connect(molecule, SIGNAL(primitivesAdded(PrimitiveList)),
+        this, SLOT(addPrimitives(PrimitiveList)));
     connect(molecule, SIGNAL(primitiveUpdated(Primitive *)),
         this, SLOT(updatePrimitive(Primitive *)));
     connect(molecule, SIGNAL(primitiveRemoved(Primitive *)),
@@ -125,6 +128,12 @@ namespace Avogadro {
     }
   }
 
+  void PrimitiveItemModel::addPrimitives(const PrimitiveList &primitives)
+  {
+    foreach(Primitive *primitive, primitives)
+      addPrimitive(primitive);
+  }
+
   void PrimitiveItemModel::updatePrimitive(Primitive *primitive)
   {
     int parentRow = d->rowTypeMap.key(primitive->type());
@@ -31,6 +31,7 @@ class QTreeView;
 namespace Avogadro {
   class Engine;
   class Primitive;
+  class PrimitiveList;
   class Molecule;
   class PrimitiveItemModelPrivate;
   class PrimitiveItemModel : public QAbstractItemModel
@@ -59,6 +60,7 @@ namespace Avogadro {
     private Q_SLOTS:
       void engineChanged();
       void addPrimitive(Primitive *primitive);
+      void addPrimitives(const PrimitiveList &primitives);
       void updatePrimitive(Primitive *primitive);
       void removePrimitive(Primitive *primitive);
 
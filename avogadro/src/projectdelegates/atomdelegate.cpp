@@ -23,6 +23,7 @@
 
 #include <avogadro/glwidget.h>
 #include <avogadro/molecule.h>
+#include <avogadro/primitivelist.h>
 #include <avogadro/atom.h>
 
 #include <openbabel/mol.h>
@@ -63,6 +64,7 @@ namespace Avogadro
     disconnect(molecule, 0, this, 0);
     // connect some signals to keep track of changes
     connect(molecule, SIGNAL(primitiveAdded(Primitive*)), this, SLOT(primitiveAdded(Primitive*)));
+    connect(molecule, SIGNAL(primitivesAdded(PrimitiveList)), this, SLOT(primitivesAdded(PrimitiveList)));
     connect(molecule, SIGNAL(primitiveUpdated(Primitive*)), this, SLOT(primitiveUpdated(Primitive*)));
     connect(molecule, SIGNAL(primitiveRemoved(Primitive*)), this, SLOT(primitiveRemoved(Primitive*)));
 
@@ -71,24 +73,37 @@ namespace Avogadro
 
   void AtomDelegate::initialize()
   {
-    Molecule *molecule = m_widget->molecule();
+    // the rows are created on demand, only the row count is stored
+    int rows = m_widget->molecule()->numAtoms();
+    model()->setVirtualRowCount(this, m_label, rows);
+    model()->emitDataChanged(m_label, 0, rows - 1);
+  }
 
-    // remove any existing rows
-    if (m_label->childCount())
-      model()->removeRows(m_label, 0, m_label->childCount());
-
-    // add the atoms...  
-    model()->insertRows(m_label, 0, molecule->numAtoms());
-    for (int i = 0; i < m_label->childCount(); ++i) {
-      ProjectTreeItem *item = m_label->child(i);
-      item->setData(0, QString(OpenBabel::etab.GetSymbol(molecule->atom(i)->atomicNumber())));
-      item->setData(1, QString("%1").arg(i));
-      // set the primitive
-      PrimitiveList primitives;
-      primitives.append(molecule->atom(i));
-      item->setPrimitives(primitives);
-    }
+  int AtomDelegate::rowCount(ProjectTreeItem *) const
+  {
+    return m_widget->molecule()->numAtoms();
+  }
 
+  QVariant AtomDelegate::rowData(ProjectTreeItem *, int row, int column) const
+  {
+    Atom *atom = m_widget->molecule()->atom(row);
+    if (!atom)
+      return QVariant();
+
+    if (column == 0)
+      return QString(OpenBabel::etab.GetSymbol(atom->atomicNumber()));
+    if (column == 1)
+      return QString("%1").arg(row);
+    return QVariant();
+  }
+
+  PrimitiveList AtomDelegate::rowPrimitives(ProjectTreeItem *, int row) const
+  {
+    PrimitiveList primitives;
+    Atom *atom = m_widget->molecule()->atom(row);
+    if (atom)
+      primitives.append(atom);
+    return primitives;
   }
   
   void AtomDelegate::primitiveAdded(Primitive *primitive)
@@ -96,37 +111,26 @@ namespace Avogadro
     if (primitive->type() != Primitive::AtomType)
       return;
     
-    Atom *atom = static_cast<Atom*>(primitive);
-    
-    // add the new primitive to the end
-    model()->insertRows(m_label, m_label->childCount(), 1);
-    ProjectTreeItem *item = m_label->child(m_label->childCount() - 1);
-    item->setData(0, QString(OpenBabel::etab.GetSymbol(atom->atomicNumber())));
-    item->setData(1, QString("%1").arg(primitive->index())); 
-    // set the primitive
-    PrimitiveList primitives;
-    primitives.append(primitive);
-    item->setPrimitives(primitives);
+    scheduleUpdate(m_label, primitive->index());
   }
  
+  void AtomDelegate::primitivesAdded(const PrimitiveList &primitives)
+  {
+    foreach(Primitive *primitive, primitives.subList(Primitive::AtomType))
+      primitiveAdded(primitive);
+  }
+
   void AtomDelegate::primitiveUpdated(Primitive *primitive)
   {
     if (primitive->type() == Primitive::MoleculeType) {
-      initialize();
+      scheduleUpdate(m_label, 0);
       return;
     }
 
     if (primitive->type() != Primitive::AtomType) 
       return;
 
-    Atom *atom = static_cast<Atom*>(primitive);
-    
-    ProjectTreeItem *item = m_label->child(primitive->index());
-    item->setData(0, QString(OpenBabel::etab.GetSymbol(atom->atomicNumber())));
-    item->setData(1, QString("%1").arg(primitive->index())); 
- 
-
-    model()->emitDataChanged(m_label, primitive->index());
+    scheduleUpdate(m_label, primitive->index(), primitive->index());
   }
  
   void AtomDelegate::primitiveRemoved(Primitive *primitive)
@@ -134,16 +138,8 @@ namespace Avogadro
     if (primitive->type() != Primitive::AtomType)
       return;
 
-    // remove the row
-    model()->removeRows(m_label, primitive->index(), 1);
-
-    // loop over atoms below to fix their index if needed
-    if ((primitive->index() + 1) < (unsigned long) m_label->childCount()) {
-      for (int i = primitive->index(); i < m_label->childCount(); ++i) {
-        ProjectTreeItem *item = m_label->child(i);
-        item->setData(1, QString("%1").arg(i));
-      }
-    }
+    // the atoms below shift up by one
+    scheduleRemoval(m_label, primitive->index());
   }
  
   void AtomDelegate::writeSettings(QSettings &settings) const
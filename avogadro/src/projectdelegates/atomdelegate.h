@@ -31,6 +31,7 @@
 namespace Avogadro {
 
   class Primitive;
+  class PrimitiveList;
 
   class AtomDelegate : public ProjectTreeModelDelegate
   {
@@ -49,8 +50,13 @@ namespace Avogadro {
       
       void fetchMore(ProjectTreeItem *parent);
 
+      int rowCount(ProjectTreeItem *parent) const;
+      QVariant rowData(ProjectTreeItem *parent, int row, int column) const;
+      PrimitiveList rowPrimitives(ProjectTreeItem *parent, int row) const;
+
     public slots:
       void primitiveAdded(Primitive*);
+      void primitivesAdded(const PrimitiveList &);
       void primitiveUpdated(Primitive*);
       void primitiveRemoved(Primitive*);
 
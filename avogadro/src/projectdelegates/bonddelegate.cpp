@@ -23,6 +23,7 @@
 
 #include <avogadro/glwidget.h>
 #include <avogadro/molecule.h>
+#include <avogadro/primitivelist.h>
 #include <avogadro/bond.h>
 
 #include <QDebug>
@@ -62,6 +63,7 @@ namespace Avogadro
     disconnect(molecule, 0, this, 0);
     // connect some signals to keep track of changes
     connect(molecule, SIGNAL(primitiveAdded(Primitive*)), this, SLOT(primitiveAdded(Primitive*)));
+    connect(molecule, SIGNAL(primitivesAdded(PrimitiveList)), this, SLOT(primitivesAdded(PrimitiveList)));
     connect(molecule, SIGNAL(primitiveUpdated(Primitive*)), this, SLOT(primitiveUpdated(Primitive*)));
     connect(molecule, SIGNAL(primitiveRemoved(Primitive*)), this, SLOT(primitiveRemoved(Primitive*)));
 
@@ -70,23 +72,31 @@ namespace Avogadro
 
   void BondDelegate::initialize()
   {
-    Molecule *molecule = m_widget->molecule();
+    // the rows are created on demand, only the row count is stored
+    int rows = m_widget->molecule()->numBonds();
+    model()->setVirtualRowCount(this, m_label, rows);
+    model()->emitDataChanged(m_label, 0, rows - 1);
+  }
 
-    // remove any existing rows
-    if (m_label->childCount())
-      model()->removeRows(m_label, 0, m_label->childCount());
-
-    // add the bonds...  
-    model()->insertRows(m_label, 0, molecule->numBonds());
-    for (int i = 0; i < m_label->childCount(); ++i) {
-      ProjectTreeItem *item = m_label->child(i);
-      item->setData(0, tr("bond %1").arg(i));
-      // set the primitive
-      PrimitiveList primitives;
-      primitives.append(molecule->bond(i));
-      item->setPrimitives(primitives);
-    }
+  int BondDelegate::rowCount(ProjectTreeItem *) const
+  {
+    return m_widget->molecule()->numBonds();
+  }
+
+  QVariant BondDelegate::rowData(ProjectTreeItem *, int row, int column) const
+  {
+    if (column == 0 && m_widget->molecule()->bond(row))
+      return tr("bond %1").arg(row);
+    return QVariant();
+  }
 
+  PrimitiveList BondDelegate::rowPrimitives(ProjectTreeItem *, int row) const
+  {
+    PrimitiveList primitives;
+    Bond *bond = m_widget->molecule()->bond(row);
+    if (bond)
+      primitives.append(bond);
+    return primitives;
   }
   
   void BondDelegate::primitiveAdded(Primitive *primitive)
@@ -94,29 +104,26 @@ namespace Avogadro
     if (primitive->type() != Primitive::BondType) 
       return;
       
-    // add the new primitive to the end
-    model()->insertRows(m_label, m_label->childCount(), 1); 
-    // get the item
-    ProjectTreeItem *item = m_label->child(m_label->childCount() - 1);
-    item->setData(0, tr("bond %1").arg(primitive->index()));
-    // set the primitive
-    PrimitiveList primitives;
-    primitives.append(primitive);
-    item->setPrimitives(primitives);
+    scheduleUpdate(m_label, primitive->index());
   }
  
+  void BondDelegate::primitivesAdded(const PrimitiveList &primitives)
+  {
+    foreach(Primitive *primitive, primitives.subList(Primitive::BondType))
+      primitiveAdded(primitive);
+  }
+
   void BondDelegate::primitiveUpdated(Primitive *primitive)
   {
     if (primitive->type() == Primitive::MoleculeType) {
-      initialize();
+      scheduleUpdate(m_label, 0);
       return;
     }
 
     if (primitive->type() != Primitive::BondType)
       return;
     
-    ProjectTreeItem *item = m_label->child(primitive->index()); 
-    item->setData(0, tr("bond %1").arg(primitive->index()));
+    scheduleUpdate(m_label, primitive->index(), primitive->index());
   }
  
   void BondDelegate::primitiveRemoved(Primitive *primitive)
@@ -124,16 +131,8 @@ namespace Avogadro
     if (primitive->type() != Primitive::BondType)
       return;
 
-    // remove the row
-    model()->removeRows(m_label, primitive->index(), 1);
-
-    // loop over all atoms to fix their index if needed
-    if ((primitive->index() + 1) < (unsigned long) m_label->childCount()) {
-      for (int i = primitive->index(); i < m_label->childCount(); ++i) {
-        ProjectTreeItem *item = m_label->child(i);
-        item->setData(0, tr("bond %1").arg(i));
-      }
-    }
+    // the bonds below shift up by one
+    scheduleRemoval(m_label, primitive->index());
   }
  
   void BondDelegate::writeSettings(QSettings &settings) const
@@ -23,6 +23,7 @@
 
 #include <avogadro/glwidget.h>
 #include <avogadro/molecule.h>
+#include <avogadro/primitivelist.h>
 #include <avogadro/residue.h>
 #include <avogadro/atom.h>
 #include <avogadro/bond.h>
@@ -65,6 +66,7 @@ namespace Avogadro
     disconnect(molecule, 0, this, 0);
     // connect some signals to keep track of changes
     connect(molecule, SIGNAL(primitiveAdded(Primitive*)), this, SLOT(primitiveAdded(Primitive*)));
+    connect(molecule, SIGNAL(primitivesAdded(PrimitiveList)), this, SLOT(primitivesAdded(PrimitiveList)));
     connect(molecule, SIGNAL(primitiveUpdated(Primitive*)), this, SLOT(primitiveUpdated(Primitive*)));
     connect(molecule, SIGNAL(primitiveRemoved(Primitive*)), this, SLOT(primitiveRemoved(Primitive*)));
 
@@ -73,56 +75,40 @@ namespace Avogadro
 
   void ResidueDelegate::initialize()
   {
-    Molecule *molecule = m_widget->molecule();
+    // the rows are created on demand, only the row count is stored
+    int rows = m_widget->molecule()->numResidues();
+    model()->setVirtualRowCount(this, m_label, rows);
+    model()->emitDataChanged(m_label, 0, rows - 1);
+  }
 
-    // remove any existing rows
-    if (m_label->childCount())
-      model()->removeRows(m_label, 0, m_label->childCount());
-      
-    QList<Residue *> residues(molecule->residues());
-
-    // add the residues...  
-    model()->insertRows(m_label, 0, molecule->numResidues());
-    for (int i = 0; i < m_label->childCount(); ++i) {
-      ProjectTreeItem *item = m_label->child(i);
-      item->setData(0, residues.at(i)->name());
-      item->setData(1, QString("%1").arg(i));
-      
-      // set the primitive
-      PrimitiveList primitives;
-      primitives.append(residues.at(i));
-      foreach (unsigned long id, residues.at(i)->atoms()) {
-        Atom *atom = molecule->atomById(id);
-        if (atom)
-          primitives.append(atom);
-      }
-      foreach (unsigned long id, residues.at(i)->bonds()) {
-        Bond *bond = molecule->bondById(id);
-        if (bond)
-          primitives.append(bond);
-      }
-      item->setPrimitives(primitives);
-    }
+  int ResidueDelegate::rowCount(ProjectTreeItem *) const
+  {
+    return m_widget->molecule()->numResidues();
+  }
 
+  QVariant ResidueDelegate::rowData(ProjectTreeItem *, int row, int column) const
+  {
+    Residue *residue = m_widget->molecule()->residue(row);
+    if (!residue)
+      return QVariant();
+
+    if (column == 0)
+      return residue->name();
+    if (column == 1)
+      return QString("%1").arg(row);
+    return QVariant();
   }
-  
-  void ResidueDelegate::primitiveAdded(Primitive *primitive)
+
+  PrimitiveList ResidueDelegate::rowPrimitives(ProjectTreeItem *, int row) const
   {
-    if (primitive->type() != Primitive::ResidueType)
-      return;
-    
+    // only walk the residue when it is activated, not when it is shown
     Molecule *molecule = m_widget->molecule();
-    Residue *residue = static_cast<Residue*>(primitive);
-    
-    // add the new primitive to the end
-    model()->insertRows(m_label, m_label->childCount(), 1);
-    ProjectTreeItem *item = m_label->child(m_label->childCount() - 1);
-    item->setData(0, residue->name());
-    item->setData(1, QString("%1").arg(primitive->index()));
-
-    // set the primitive
     PrimitiveList primitives;
-      primitives.append(residue);
+    Residue *residue = molecule->residue(row);
+    if (!residue)
+      return primitives;
+
+    primitives.append(residue);
     foreach (unsigned long id, residue->atoms()) {
       Atom *atom = molecule->atomById(id);
       if (atom)
@@ -133,42 +119,34 @@ namespace Avogadro
       if (bond)
         primitives.append(bond);
     }
-    item->setPrimitives(primitives);
+    return primitives;
+  }
+  
+  void ResidueDelegate::primitiveAdded(Primitive *primitive)
+  {
+    if (primitive->type() != Primitive::ResidueType)
+      return;
+    
+    scheduleUpdate(m_label, primitive->index());
   }
  
+  void ResidueDelegate::primitivesAdded(const PrimitiveList &primitives)
+  {
+    foreach(Primitive *primitive, primitives.subList(Primitive::ResidueType))
+      primitiveAdded(primitive);
+  }
+
   void ResidueDelegate::primitiveUpdated(Primitive *primitive)
   {
     if (primitive->type() == Primitive::MoleculeType) {
-      initialize();
+      scheduleUpdate(m_label, 0);
       return;
     }
 
     if (primitive->type() != Primitive::ResidueType) 
       return;
 
-    Molecule *molecule = m_widget->molecule();
-    Residue *residue = static_cast<Residue*>(primitive);
-    
-    ProjectTreeItem *item = m_label->child(primitive->index());
-    item->setData(0, residue->name());
-    item->setData(1, QString("%1").arg(primitive->index()));
-
-    // set the primitive
-    PrimitiveList primitives;
-    primitives.append(residue);
-    foreach (unsigned long id, residue->atoms()) {
-      Atom *atom = molecule->atomById(id);
-      if (atom)
-        primitives.append(atom);
-    }
-    foreach (unsigned long id, residue->bonds()) {
-      Bond *bond = molecule->bondById(id);
-      if (bond)
-        primitives.append(bond);
-    }
-    item->setPrimitives(primitives);
- 
-    model()->emitDataChanged(m_label, primitive->index());
+    scheduleUpdate(m_label, primitive->index(), primitive->index());
   }
  
   void ResidueDelegate::primitiveRemoved(Primitive *primitive)
@@ -176,16 +154,8 @@ namespace Avogadro
     if (primitive->type() != Primitive::ResidueType)
       return;
 
-    // remove the row
-    model()->removeRows(m_label, primitive->index(), 1);
-
-    // loop over residues below to fix their index if needed
-    if ((primitive->index() + 1) < (unsigned long) m_label->childCount()) {
-      for (int i = primitive->index(); i < m_label->childCount(); ++i) {
-        ProjectTreeItem *item = m_label->child(i);
-        item->setData(1, QString("%1").arg(i));
-      }
-    }
+    // the residues below shift up by one
+    scheduleRemoval(m_label, primitive->index());
   }
  
   void ResidueDelegate::writeSettings(QSettings &settings) const
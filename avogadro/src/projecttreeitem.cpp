@@ -33,6 +33,8 @@ namespace Avogadro {
   {
     m_parentItem = parent;
     m_itemData = data;
+    m_rowDelegate = 0;
+    m_virtualRows = 0;
     m_terminal = true;
   }
 
@@ -43,11 +45,18 @@ namespace Avogadro {
 
   ProjectTreeItem *ProjectTreeItem::child(int number)
   {
+    // on demand rows have no item
+    if (m_rowDelegate)
+      return 0;
+
     return m_childItems.value(number);
   }
 
   int ProjectTreeItem::childCount() const
   {
+    if (m_rowDelegate)
+      return m_virtualRows;
+
     return m_childItems.count();
   }
 
@@ -159,6 +168,28 @@ namespace Avogadro {
     m_terminal = terminal;
   }
 
+  bool ProjectTreeItem::hasVirtualRows() const
+  {
+    return m_rowDelegate != 0;
+  }
+
+  ProjectTreeModelDelegate* ProjectTreeItem::rowDelegate() const
+  {
+    return m_rowDelegate;
+  }
+
+  void ProjectTreeItem::setVirtualRows(ProjectTreeModelDelegate *delegate, int rows)
+  {
+    if (!m_rowDelegate) {
+      // virtual rows replace any stored children
+      qDeleteAll(m_childItems);
+      m_childItems.clear();
+    }
+
+    m_rowDelegate = delegate;
+    m_virtualRows = rows;
+  }
+
 
 
 } // end namespace Avogadro
@@ -33,6 +33,8 @@
 class QTreeView;
 namespace Avogadro {
 
+  class ProjectTreeModelDelegate;
+
   class ProjectTreeItem
   {
     friend class ProjectTreeModel;
@@ -42,7 +44,8 @@ namespace Avogadro {
       ~ProjectTreeItem();
 
       /**
-       * @return Child @p number.
+       * @return Child @p number, 0 for the on demand rows of an item with
+       * virtual rows.
        */
       ProjectTreeItem *child(int number);
       /**
@@ -90,6 +93,16 @@ namespace Avogadro {
        */
       void setTerminal(bool terminal);
 
+      /**
+       * @return true if the children of this item are computed on demand
+       * by rowDelegate() instead of being stored as ProjectTreeItems.
+       */
+      bool hasVirtualRows() const;
+      /**
+       * @return The delegate providing the on demand rows for this item.
+       */
+      ProjectTreeModelDelegate* rowDelegate() const;
+
     protected:
       /**
        * Insert @p count children starting at @p position. All items
@@ -108,12 +121,19 @@ namespace Avogadro {
        * Remove columns... (not used at the moment)
        */
       bool removeColumns(int position, int columns);
+      /**
+       * Let @p delegate provide @p rows children for this item on demand.
+       * The rows have no ProjectTreeItem, so no memory is allocated per row.
+       */
+      void setVirtualRows(ProjectTreeModelDelegate *delegate, int rows);
  
     private:
       QList<ProjectTreeItem*>   m_childItems;
       QVector<QVariant>         m_itemData;
       PrimitiveList             m_primitives;
       ProjectTreeItem          *m_parentItem;
+      ProjectTreeModelDelegate *m_rowDelegate;
+      int                       m_virtualRows;
       bool                      m_terminal;
   };
   
@@ -26,6 +26,7 @@
 #include "projecttreemodeldelegate.h"
 
 #include <QTimer>
+#include <QHash>
 #include <QVector>
 #include <QDebug>
 
@@ -43,19 +44,55 @@
 
 namespace Avogadro {
 
+  namespace {
+    // On demand rows have no ProjectTreeItem. Their index stores the id of
+    // the parent in ProjectTreeModelPrivate::virtualParents in place of the
+    // item pointer. The ids are odd to tell them apart from item pointers
+    // (which are always aligned).
+    bool isVirtualRow(const QModelIndex &index)
+    {
+      return index.isValid() && (index.internalId() & 1);
+    }
+  }
+
   class ProjectTreeModelPrivate
   {
     public:
-      ProjectTreeModelPrivate() : glWidget(0), rootItem(0)
+      ProjectTreeModelPrivate() : glWidget(0), rootItem(0), nextVirtualId(1)
       {
       }
 
+      /**
+       * Drop the ids of @p item and its children, called before they are
+       * deleted.
+       */
+      void forgetVirtualParents(ProjectTreeItem *item);
+
       GLWidget *glWidget;
       ProjectTreeItem *rootItem;
 
       QList<ProjectTreeModelDelegate*> delegates;
+      // items with on demand rows by the id in the row indices, and back
+      QHash<quint32, ProjectTreeItem*> virtualParents;
+      QHash<ProjectTreeItem*, quint32> virtualIds;
+      quint32 nextVirtualId;
   };
 
+  void ProjectTreeModelPrivate::forgetVirtualParents(ProjectTreeItem *item)
+  {
+    QHash<ProjectTreeItem*, quint32>::iterator id = virtualIds.find(item);
+    if (id != virtualIds.end()) {
+      virtualParents.remove(id.value());
+      virtualIds.erase(id);
+    }
+
+    // on demand rows have no items
+    if (!item->hasVirtualRows()) {
+      for (int i = 0; i < item->childCount(); ++i)
+        forgetVirtualParents(item->child(i));
+    }
+  }
+
   ProjectTreeModel::ProjectTreeModel(GLWidget *widget, QObject *parent) : 
       QAbstractItemModel(parent), d(new ProjectTreeModelPrivate)
   {
@@ -83,6 +120,9 @@ namespace Avogadro {
 
   ProjectTreeItem* ProjectTreeModel::item(const QModelIndex& index) const
   {
+    if (isVirtualRow(index))
+      return 0;
+
     if (index.isValid()) {
       ProjectTreeItem *item = static_cast<ProjectTreeItem*>(index.internalPointer());
       if (item) 
@@ -91,11 +131,26 @@ namespace Avogadro {
     return d->rootItem;
   }
 
+  ProjectTreeItem* ProjectTreeModel::virtualParent(const QModelIndex& index) const
+  {
+    if (!isVirtualRow(index))
+      return 0;
+
+    return d->virtualParents.value(static_cast<quint32>(index.internalId()));
+  }
+
   QModelIndex ProjectTreeModel::parent( const QModelIndex & index ) const
   {
     if(!index.isValid())
       return QModelIndex();
 
+    if (isVirtualRow(index)) {
+      ProjectTreeItem *parentItem = virtualParent(index);
+      if (!parentItem)
+        return QModelIndex();
+      return createIndex(parentItem->childNumber(), 0, parentItem);
+    }
+
     ProjectTreeItem *childItem = item(index);
     ProjectTreeItem *parentItem = childItem->parent();
 
@@ -107,6 +162,9 @@ namespace Avogadro {
 
   int ProjectTreeModel::rowCount( const QModelIndex & parent ) const
   {
+    if (isVirtualRow(parent))
+      return 0;
+
     ProjectTreeItem *parentItem = item(parent);
     return parentItem->childCount();
   }
@@ -124,6 +182,13 @@ namespace Avogadro {
     if (role != Qt::DisplayRole)
       return QVariant();
 
+    if (isVirtualRow(index)) {
+      ProjectTreeItem *parentItem = virtualParent(index);
+      if (!parentItem)
+        return QVariant();
+      return parentItem->rowDelegate()->rowData(parentItem, index.row(), index.column());
+    }
+
     ProjectTreeItem *projectItem = item(index);
 
     if (projectItem)
@@ -154,7 +219,16 @@ namespace Avogadro {
     if(parent.isValid() && parent.column() != 0)
       return QModelIndex();
 
+    if (isVirtualRow(parent))
+      return QModelIndex();
+
     ProjectTreeItem *parentItem = item(parent);
+    if (parentItem->hasVirtualRows()) {
+      if (row < 0 || row >= parentItem->childCount())
+        return QModelIndex();
+      return createIndex(row, column, d->virtualIds.value(parentItem));
+    }
+
     ProjectTreeItem *childItem = parentItem->child(row);
     if (childItem)
       return createIndex(row, column, childItem);
@@ -245,6 +319,8 @@ namespace Avogadro {
     bool success;
     assert(position > -1);
     beginRemoveRows(createIndex(parentItem->childNumber(),0,parentItem), position, position + rows - 1);
+    for (int row = position; row < position + rows && row < parentItem->childCount(); ++row)
+      d->forgetVirtualParents(parentItem->child(row));
     success = parentItem->removeChildren(position, rows);
     endRemoveRows();
      
@@ -253,26 +329,97 @@ namespace Avogadro {
       
   void ProjectTreeModel::emitDataChanged(ProjectTreeItem *parentItem, int row)
   {
-    QModelIndex left = createIndex(row, 0, parentItem->child(row));
-    QModelIndex right = createIndex(row, d->rootItem->columnCount(), parentItem->child(row));
+    emitDataChanged(parentItem, row, row);
+  }
+   
+  void ProjectTreeModel::emitDataChanged(ProjectTreeItem *parentItem, int first, int last)
+  {
+    if (first < 0 || first > last || last >= parentItem->childCount())
+      return;
+
+    QModelIndex parent;
+    if (parentItem != d->rootItem)
+      parent = createIndex(parentItem->childNumber(), 0, parentItem);
+    QModelIndex left = index(first, 0, parent);
+    QModelIndex right = index(last, d->rootItem->columnCount() - 1, parent);
     emit dataChanged( left, right );
   }
+
+  void ProjectTreeModel::setVirtualRowCount(ProjectTreeModelDelegate *delegate,
+      ProjectTreeItem *parentItem, int rows)
+  {
+    assert(rows > -1);
+    QModelIndex parent = createIndex(parentItem->childNumber(), 0, parentItem);
+    // stored children are replaced by the virtual rows
+    if (!parentItem->hasVirtualRows() && parentItem->childCount())
+      removeRows(parentItem, 0, parentItem->childCount());
+    if (!d->virtualIds.contains(parentItem)) {
+      // skip ids still in use once the counter wraps around
+      while (d->virtualParents.contains(d->nextVirtualId))
+        d->nextVirtualId += 2;
+      d->virtualParents.insert(d->nextVirtualId, parentItem);
+      d->virtualIds.insert(parentItem, d->nextVirtualId);
+      d->nextVirtualId += 2;
+    }
+
+    int current = parentItem->childCount();
+    if (rows > current) {
+      beginInsertRows(parent, current, rows - 1);
+      parentItem->setVirtualRows(delegate, rows);
+      endInsertRows();
+    } else if (rows < current) {
+      beginRemoveRows(parent, rows, current - 1);
+      parentItem->setVirtualRows(delegate, rows);
+      endRemoveRows();
+    } else {
+      parentItem->setVirtualRows(delegate, rows);
+    }
+  }
+
+  void ProjectTreeModel::removeVirtualRows(ProjectTreeItem *parentItem,
+      int position, int rows)
+  {
+    assert(position > -1 && position + rows <= parentItem->childCount());
+    beginRemoveRows(createIndex(parentItem->childNumber(), 0, parentItem),
+                    position, position + rows - 1);
+    parentItem->setVirtualRows(parentItem->rowDelegate(),
+                               parentItem->childCount() - rows);
+    endRemoveRows();
+  }
+
+  PrimitiveList ProjectTreeModel::primitives(const QModelIndex& index) const
+  {
+    if (isVirtualRow(index)) {
+      ProjectTreeItem *parentItem = virtualParent(index);
+      if (!parentItem)
+        return PrimitiveList();
+      return parentItem->rowDelegate()->rowPrimitives(parentItem, index.row());
+    }
+
+    return item(index)->primitives();
+  }
    
   bool ProjectTreeModel::hasChildren(const QModelIndex &parent) const
   {
+    if (isVirtualRow(parent))
+      return false;
+
     ProjectTreeItem *parentItem = item(parent);
     return !parentItem->isTerminal();
   }
 
   bool ProjectTreeModel::canFetchMore(const QModelIndex& parent) const
   {
+    // items with virtual rows are kept up to date by their delegate
+    if (isVirtualRow(parent) || item(parent)->hasVirtualRows())
+      return false;
     // if we might have children, more data could possibly be fetched...
     return hasChildren(parent);
   }
       
   void ProjectTreeModel::fetchMore(const QModelIndex& parent)
   {
-    if(!parent.isValid())
+    if(!parent.isValid() || isVirtualRow(parent))
       return;
     
     ProjectTreeItem *parentItem = item(parent);
@@ -105,9 +105,36 @@ namespace Avogadro {
        */
       void emitDataChanged(ProjectTreeItem *parentItem, int row);
       /**
-       * @return The ProjectTreeItem for @p index
+       * Notify the views that rows @p first to @p last (inclusive) of 
+       * @p parentItem have changed.
+       */
+      void emitDataChanged(ProjectTreeItem *parentItem, int first, int last);
+      /**
+       * Let @p delegate provide the children of @p parentItem on demand. Rows
+       * are added or removed at the end to reach @p rows rows, the data and
+       * primitives are requested from ProjectTreeModelDelegate::rowData() and
+       * ProjectTreeModelDelegate::rowPrimitives() when needed.
+       */
+      void setVirtualRowCount(ProjectTreeModelDelegate *delegate, 
+          ProjectTreeItem *parentItem, int rows);
+      /**
+       * Remove @p rows on demand rows of @p parentItem, starting at
+       * @p position. The rows below move up.
+       */
+      void removeVirtualRows(ProjectTreeItem *parentItem, int position, int rows);
+      /**
+       * @return The ProjectTreeItem for @p index, 0 for an on demand row.
        */
       ProjectTreeItem* item(const QModelIndex& index) const;
+      /**
+       * @return The item @p index is an on demand row of, or 0 if @p index
+       * is not an on demand row. The row is index.row().
+       */
+      ProjectTreeItem* virtualParent(const QModelIndex& index) const;
+      /**
+       * @return The primitives for the item at @p index.
+       */
+      PrimitiveList primitives(const QModelIndex& index) const;
 
 
       /**********************************************************************
@@ -26,6 +26,9 @@
 #include <QDebug>
 #include <QString>
 #include <QObject>
+#include <QTimer>
+#include <QHash>
+#include <QPair>
 
 using namespace std;
 
@@ -38,11 +41,19 @@ namespace Avogadro
       ProjectTreeModel *model;
       QString alias;
       QVector<ProjectTreeItem*> expandableItems;
+      // pending [first, last] row ranges, last == -1 means up to the end
+      QHash<ProjectTreeItem*, QPair<int, int> > pendingUpdates;
+      // pending (first, count) removed rows, numbered as in the model
+      QHash<ProjectTreeItem*, QPair<int, int> > pendingRemovals;
+      QTimer *updateTimer;
   };
 
   ProjectTreeModelDelegate::ProjectTreeModelDelegate(ProjectTreeModel *model) : d(new ProjectTreeModelDelegatePrivate)
   {
     d->model = model;
+    d->updateTimer = new QTimer(this);
+    d->updateTimer->setSingleShot(true);
+    connect(d->updateTimer, SIGNAL(timeout()), this, SLOT(flushUpdates()));
   }
   
   QWidget *ProjectTreeModelDelegate::settingsWidget()
@@ -102,6 +113,115 @@ namespace Avogadro
     d->model->importDelegate(delegate);
   }
 
+  int ProjectTreeModelDelegate::rowCount(ProjectTreeItem *) const
+  {
+    return 0;
+  }
+
+  QVariant ProjectTreeModelDelegate::rowData(ProjectTreeItem *, int, int) const
+  {
+    return QVariant();
+  }
+
+  PrimitiveList ProjectTreeModelDelegate::rowPrimitives(ProjectTreeItem *, int) const
+  {
+    return PrimitiveList();
+  }
+
+  void ProjectTreeModelDelegate::scheduleUpdate(ProjectTreeItem *parent, int first, int last)
+  {
+    QHash<ProjectTreeItem*, QPair<int, int> >::iterator pending = d->pendingUpdates.find(parent);
+    if (pending == d->pendingUpdates.end()) {
+      d->pendingUpdates.insert(parent, qMakePair(first, last));
+    } else {
+      pending->first = qMin(pending->first, first);
+      if (pending->second != -1)
+        pending->second = (last == -1) ? -1 : qMax(pending->second, last);
+    }
+
+    if (!d->updateTimer->isActive())
+      d->updateTimer->start(0);
+  }
+
+  void ProjectTreeModelDelegate::scheduleRemoval(ProjectTreeItem *parent, int row)
+  {
+    if (!parent->hasVirtualRows()) {
+      scheduleUpdate(parent, row);
+      return;
+    }
+
+    // The rows of an earlier removal are still in the model, rows after it
+    // are numbered as if they were gone already
+    QHash<ProjectTreeItem*, QPair<int, int> >::iterator removal = d->pendingRemovals.find(parent);
+    int modelRow = row;
+    if (removal != d->pendingRemovals.end() && row >= removal->first)
+      modelRow += removal->second;
+
+    // Rows appended since the last update are not in the model yet, the
+    // row count is corrected by flushUpdates()
+    if (modelRow < parent->childCount()) {
+      if (removal != d->pendingRemovals.end() && row == removal->first) {
+        // the next row moved up into the gap
+        ++removal->second;
+      } else if (removal != d->pendingRemovals.end() && row == removal->first - 1) {
+        // removing upwards
+        --removal->first;
+        ++removal->second;
+      } else {
+        // not adjacent, send the earlier rows first
+        flushRemoval(parent);
+        d->pendingRemovals.insert(parent, qMakePair(row, 1));
+      }
+    }
+
+    // pending updates refer to rows below the removed one by their old number
+    QHash<ProjectTreeItem*, QPair<int, int> >::iterator pending = d->pendingUpdates.find(parent);
+    if (pending != d->pendingUpdates.end()) {
+      if (pending->first > row)
+        --pending->first;
+      if (pending->second > row)
+        --pending->second;
+    }
+
+    if (!d->updateTimer->isActive())
+      d->updateTimer->start(0);
+  }
+
+  void ProjectTreeModelDelegate::flushRemoval(ProjectTreeItem *parent)
+  {
+    QHash<ProjectTreeItem*, QPair<int, int> >::iterator removal = d->pendingRemovals.find(parent);
+    if (removal == d->pendingRemovals.end())
+      return;
+
+    QPair<int, int> rows = removal.value();
+    d->pendingRemovals.erase(removal);
+    d->model->removeVirtualRows(parent, rows.first, rows.second);
+  }
+
+  void ProjectTreeModelDelegate::flushUpdates()
+  {
+    foreach (ProjectTreeItem *parent, d->pendingRemovals.keys())
+      flushRemoval(parent);
+
+    QHash<ProjectTreeItem*, QPair<int, int> > pendingUpdates = d->pendingUpdates;
+    d->pendingUpdates.clear();
+
+    QHash<ProjectTreeItem*, QPair<int, int> >::const_iterator i;
+    for (i = pendingUpdates.constBegin(); i != pendingUpdates.constEnd(); ++i) {
+      ProjectTreeItem *parent = i.key();
+      int oldRows = parent->childCount();
+      int rows = rowCount(parent);
+      d->model->setVirtualRowCount(this, parent, rows);
+
+      // rows appended above only need to be painted, the remaining rows 
+      // in the range may show another primitive now
+      int last = qMin(oldRows, rows) - 1;
+      if (i.value().second != -1)
+        last = qMin(last, i.value().second);
+      d->model->emitDataChanged(parent, qMax(i.value().first, 0), last);
+    }
+  }
+
 } // end namespace Avogadro
 
 #include "projecttreemodeldelegate.moc"
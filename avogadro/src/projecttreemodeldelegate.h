@@ -95,6 +95,36 @@ namespace Avogadro {
        */
       virtual void fetchMore(ProjectTreeItem *) {}
 
+      /**
+       * @return The number of on demand rows for @p parent. Only used for items
+       * passed to ProjectTreeModel::setVirtualRowCount() or scheduleUpdate().
+       */
+      virtual int rowCount(ProjectTreeItem *parent) const;
+      /**
+       * @return The data for @p column of on demand row @p row in @p parent.
+       * This is called by the model whenever a view needs the row, so it should
+       * be computed cheaply from the molecule indices.
+       */
+      virtual QVariant rowData(ProjectTreeItem *parent, int row, int column) const;
+      /**
+       * @return The primitives for on demand row @p row in @p parent.
+       */
+      virtual PrimitiveList rowPrimitives(ProjectTreeItem *parent, int row) const;
+      /**
+       * Mark rows @p first to @p last of @p parent as changed. A @p last of -1
+       * marks all rows from @p first to the end, use this when rows are added
+       * (see scheduleRemoval() for removed rows). Updates are merged and sent to the model once control
+       * returns to the event loop, so a bulk change results in a single range
+       * update instead of one row insertion or removal per primitive.
+       */
+      void scheduleUpdate(ProjectTreeItem *parent, int first, int last = -1);
+      /**
+       * Remove on demand row @p row of @p parent, call this once the row is
+       * gone from rowCount(). Removals of adjacent rows are merged and sent
+       * to the model as a single range of removed rows.
+       */
+      void scheduleRemoval(ProjectTreeItem *parent, int row);
+
       /**
        * Some delegates may delegate their work to other delegates. However, to keep the
        * model informed about all the delegates, you need to call exportDelegate once you 
@@ -104,7 +134,12 @@ namespace Avogadro {
        */
       void exportDelegate(ProjectTreeModelDelegate *delegate);
 
+    private Q_SLOTS:
+      void flushUpdates();
+
     private:
+      void flushRemoval(ProjectTreeItem *parent);
+
       ProjectTreeModelDelegatePrivate * const d; 
   };
  
@@ -0,0 +1,84 @@
+/**********************************************************************
+  SaveFileThread - Write a copy of a molecule in the background
+
+  Copyright (C) 2013 Avogadro Developers
+
+  This file is part of the Avogadro molecular editor project.
+  For more information, see <http://avogadro.cc/>
+
+  Avogadro is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  Avogadro is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+  02110-1301, USA.
+ **********************************************************************/
+
+
+#include "savefilethread.h"
+
+#include <avogadro/molecule.h>
+#include <avogadro/moleculefile.h>
+#include <avogadro/obmolsnapshot.h>
+
+#include <openbabel/mol.h>
+
+namespace Avogadro {
+
+  SaveFileThread::SaveFileThread(const Molecule *molecule,
+                                 const QString &fileName,
+                                 const QString &fileType, bool conformers,
+                                 QObject *parent)
+    : QThread(parent), m_data(new OBMolSnapshot(molecule)),
+      m_fileName(fileName), m_fileType(fileType),
+      m_writeConformers(conformers), m_success(false)
+  {
+    if (m_writeConformers) {
+      const std::vector<std::vector<Eigen::Vector3d>*> &all =
+        molecule->conformers();
+      m_conformers.reserve(all.size());
+      for (unsigned int i = 0; i < all.size(); ++i)
+        m_conformers.push_back(*all[i]);
+    }
+  }
+
+  SaveFileThread::~SaveFileThread()
+  {
+    wait();
+    delete m_data;
+  }
+
+  MoleculeSnapshot SaveFileThread::snapshot() const
+  {
+    return m_data->snapshot();
+  }
+
+  void SaveFileThread::run()
+  {
+    OpenBabel::OBMol obmol = m_data->OBMol();
+    if (m_writeConformers) {
+      std::vector<std::vector<Eigen::Vector3d>*> conformers;
+      conformers.reserve(m_conformers.size());
+      for (unsigned int i = 0; i < m_conformers.size(); ++i)
+        conformers.push_back(&m_conformers[i]);
+      m_success = MoleculeFile::writeConformers(&obmol, conformers,
+                                                m_fileName, m_fileType,
+                                                &m_error);
+    }
+    else {
+      m_success = MoleculeFile::writeMolecule(&obmol, m_fileName, m_fileType,
+                                              QString(), &m_error);
+    }
+  }
+
+} // End namespace Avogadro
+
+#include "savefilethread.moc"
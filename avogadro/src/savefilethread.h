@@ -0,0 +1,106 @@
+/**********************************************************************
+  SaveFileThread - Write a copy of a molecule in the background
+
+  Copyright (C) 2013 Avogadro Developers
+
+  This file is part of the Avogadro molecular editor project.
+  For more information, see <http://avogadro.cc/>
+
+  Avogadro is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  Avogadro is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+  02110-1301, USA.
+ **********************************************************************/
+
+
+#ifndef SAVEFILETHREAD_H
+#define SAVEFILETHREAD_H
+
+#include <avogadro/moleculesnapshot.h>
+
+#include <QThread>
+#include <QString>
+
+#include <vector>
+#include <Eigen/Core>
+
+namespace Avogadro {
+
+  class Molecule;
+  class OBMolSnapshot;
+
+  /**
+   * @class SaveFileThread savefilethread.h
+   * @brief Serialise a molecule to disk without blocking the GUI.
+   *
+   * The molecule is copied to an OBMolSnapshot when the thread is
+   * constructed, on the thread owning the molecule. The molecule can then
+   * keep being edited while the worker converts the copy to an
+   * OpenBabel::OBMol and writes it. The file is written next to the target
+   * and moved over it once complete (see MoleculeFile::writeMolecule()), so
+   * an existing file is never left half-written.
+   */
+  class SaveFileThread : public QThread
+  {
+    Q_OBJECT
+
+  public:
+    /**
+     * Copy @p molecule to be saved to @p fileName.
+     * @param fileType Optional Open Babel format overriding the extension.
+     * @param conformers Write all conformers rather than only the current
+     * one.
+     */
+    SaveFileThread(const Molecule *molecule, const QString &fileName,
+                   const QString &fileType, bool conformers,
+                   QObject *parent = 0);
+    ~SaveFileThread();
+
+    QString fileName() const { return m_fileName; }
+
+    /**
+     * @return True if all conformers are being written.
+     */
+    bool conformers() const { return m_writeConformers; }
+
+    /**
+     * @return The state of the molecule when the save was started.
+     */
+    MoleculeSnapshot snapshot() const;
+
+    /**
+     * @return True if the file was written, only valid once finished.
+     */
+    bool success() const { return m_success; }
+
+    /**
+     * @return Any errors from writing the file.
+     */
+    QString error() const { return m_error; }
+
+  protected:
+    void run();
+
+  private:
+    OBMolSnapshot *m_data;
+    std::vector<std::vector<Eigen::Vector3d> > m_conformers;
+    QString m_fileName;
+    QString m_fileType;
+    bool m_writeConformers;
+    bool m_success;
+    QString m_error;
+  };
+
+} // End namespace Avogadro
+
+#endif
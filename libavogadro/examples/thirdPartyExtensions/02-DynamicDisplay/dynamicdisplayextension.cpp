@@ -67,6 +67,8 @@ namespace DynamicDisplay {
       if (m_molecule) {
         connect(m_molecule, SIGNAL(atomAdded(Atom*)),
                 this, SLOT(moleculeUpdated()));
+        connect(m_molecule, SIGNAL(primitivesAdded(PrimitiveList)),
+                this, SLOT(moleculeUpdated()));
         connect(m_molecule, SIGNAL(atomRemoved(Atom*)),
                 this, SLOT(moleculeUpdated()));
         connect(m_molecule, SIGNAL(atomUpdated(Atom*)),
@@ -50,6 +50,8 @@ namespace Avogadro {
       bool dynamicBonds;
       bool loop;
       bool paused;
+      // The cells of the original conformers, restored by stop()
+      std::vector<Eigen::Matrix3d> originalCells;
   };
 
   Animation::Animation(QObject *parent) : QObject(parent), d(new AnimationPrivate),
@@ -75,6 +77,7 @@ namespace Avogadro {
       for (unsigned int i = 0; i < molecule->numConformers(); ++i) {
         m_originalConformers.push_back(molecule->conformer(i));
       }
+      d->originalCells = molecule->conformerCells();
     }
   }
 
@@ -193,6 +196,7 @@ namespace Avogadro {
       for (unsigned int i = 0; i < m_molecule->numConformers(); ++i) {
         m_originalConformers.push_back(m_molecule->conformer(i));
       }
+      d->originalCells = m_molecule->conformerCells();
     }
  
     d->framesSet = true;
@@ -210,6 +214,7 @@ namespace Avogadro {
     if (d->framesSet) {
       m_molecule->lock()->lockForWrite();
       m_molecule->setAllConformers(m_originalConformers);
+      m_molecule->setConformerCells(d->originalCells);
       m_molecule->lock()->unlock();
     }
     setFrame(1);
@@ -227,6 +232,8 @@ namespace Avogadro {
       m_molecule->lock()->lockForWrite();
       // don't delete the existing conformers -- we save them as m_originalConformers
       m_molecule->setAllConformers(m_frames, false);
+      // the frames have no cells of their own, the current cell is kept
+      m_molecule->setConformerCells(std::vector<Eigen::Matrix3d>());
       m_molecule->lock()->unlock();
     }
 
@@ -29,6 +29,7 @@
 #include "molecule.h"
 #include "bond.h"
 #include "residue.h"
+#include "obmolsnapshot_p.h"
 
 #include <openbabel/atom.h>
 #include <openbabel/generic.h>
@@ -152,6 +153,8 @@ namespace Avogadro {
    {
      Q_D(const Atom);
      d->partialCharge = charge;
+     if (m_molecule)
+       m_molecule->m_invalidDipoleEstimate = true;
    }
 
    void Atom::setFormalCharge(int charge)
@@ -321,50 +324,44 @@ namespace Avogadro {
 
    OpenBabel::OBAtom Atom::OBAtom()
    {
-     Q_D(Atom);
      // Need to copy all relevant data over to the OBAtom
      OpenBabel::OBAtom obatom;
-     OpenBabel::OBPairData *obproperty;
      const Vector3d *v = m_molecule->atomPos(m_id);
      obatom.SetVector(v->x(), v->y(), v->z());
      obatom.SetAtomicNum(m_atomicNumber);
-     obatom.SetPartialCharge(d->partialCharge);
-     obatom.SetFormalCharge(d->formalCharge);
      obatom.SetId(m_id);
 
+     OBAtomData data;
+     copyOBAtomData(&data);
+     data.copyTo(&obatom);
+     return obatom;
+   }
+
+   void Atom::copyOBAtomData(OBAtomData *data) const
+   {
+     Q_D(const Atom);
+     data->partialCharge = d->partialCharge;
+     data->formalCharge = d->formalCharge;
+     data->pairData.clear();
+
      // Save custom label
-     if (!d->customLabel.isEmpty()) {
-       obproperty = new OpenBabel::OBPairData;
-       obproperty->SetAttribute("label");
-       obproperty->SetValue(d->customLabel.toAscii().data());
-       obatom.SetData(obproperty);
-     }
+     if (!d->customLabel.isEmpty())
+       data->pairData << qMakePair(QByteArray("label"), d->customLabel.toAscii());
 
      // Save custom color
-     if(!d->customColorName.isEmpty()) {
-       obproperty = new OpenBabel::OBPairData;
-       obproperty->SetAttribute("color");
-       obproperty->SetValue(d->customColorName.toAscii().data());
-       obatom.SetData(obproperty);
-     }
+     if (!d->customColorName.isEmpty())
+       data->pairData << qMakePair(QByteArray("color"),
+                                   d->customColorName.toAscii());
 
      // Save custom radius
-     if (d->customRadius) {
-       obproperty = new OpenBabel::OBPairData;
-       obproperty->SetAttribute("radius");
-       obproperty->SetValue(QString::number(d->customRadius).toAscii().data());
-       obatom.SetData(obproperty);
-     }
+     if (d->customRadius)
+       data->pairData << qMakePair(QByteArray("radius"),
+                                   QString::number(d->customRadius).toAscii());
 
      // Add dynamic properties as OBPairData
-     foreach(const QByteArray &propertyName, dynamicPropertyNames()) {
-       obproperty = new OpenBabel::OBPairData;
-       obproperty->SetAttribute(propertyName.data());
-       obproperty->SetValue(property(propertyName).toByteArray().data());
-       obatom.SetData(obproperty);
-     }
-
-     return obatom;
+     foreach(const QByteArray &propertyName, dynamicPropertyNames())
+       data->pairData << qMakePair(propertyName,
+                                   property(propertyName).toByteArray());
    }
 
 /*   const OpenBabel::OBAtom Atom::OBAtom() const
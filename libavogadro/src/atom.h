@@ -50,6 +50,7 @@ namespace Avogadro {
   class Bond;
   class Residue;
   class AtomPrivate;
+  struct OBAtomData;
   class A_EXPORT Atom : public Primitive
   {
   Q_OBJECT
@@ -271,6 +272,12 @@ namespace Avogadro {
      */
     void setResidue(const Residue *residue);
 
+    /**
+     * Copy what OBAtom() writes besides the element, id and position to
+     * @p data, without computing charges.
+     */
+    void copyOBAtomData(OBAtomData *data) const;
+
     AtomPrivate * const d_ptr;
     Molecule *m_molecule; /** Parent molecule - should always be valid. **/
     int m_atomicNumber;
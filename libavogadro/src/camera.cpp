@@ -73,6 +73,7 @@ namespace Avogadro
     d->projection = camera->d->projection;
     d->parent = camera->d->parent;
     d->angleOfViewY = camera->d->angleOfViewY;
+    d->orthoScale = camera->d->orthoScale;
   }
 
   void Camera::setParent(const GLWidget *parent)
@@ -0,0 +1,1253 @@
+/**********************************************************************
+  CifReader - Native reader for CIF and PDBx/mmCIF files
+
+  Copyright (C) 2013 Avogadro Developers
+
+  This file is part of the Avogadro molecular editor project.
+  For more information, see <http://avogadro.cc/>
+
+  Avogadro is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  Avogadro is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+  02110-1301, USA.
+ **********************************************************************/
+
+#include "cifreader.h"
+#include "connectthedots_p.h"
+
+#include <avogadro/molecule.h>
+#include <avogadro/atom.h>
+#include <avogadro/bond.h>
+#include <avogadro/residue.h>
+#include <avogadro/primitivelist.h>
+
+#include <openbabel/data.h>
+#include <openbabel/generic.h>
+#include <openbabel/math/spacegroup.h>
+
+#include <Eigen/Core>
+#include <Eigen/Geometry>
+
+#include <QFileInfo>
+#include <QHash>
+#include <QIODevice>
+#include <QMap>
+#include <QRegExp>
+#include <QSet>
+#include <QVariant>
+#include <QVector>
+
+#include <cctype>
+#include <cmath>
+#include <vector>
+
+using Eigen::Matrix3d;
+using Eigen::Vector3d;
+using Eigen::Vector3i;
+
+namespace Avogadro {
+
+  namespace {
+
+    /**
+     * Splits a CIF file into tokens as it is read, following the CIF 1.1
+     * syntax. The token data is only valid until the next call of next().
+     */
+    class CifTokenizer
+    {
+    public:
+      enum Type {
+        End,
+        Data,   // data_ block header
+        Loop,   // loop_
+        Tag,    // _name
+        Value,
+        Other   // global_, save_ and stop_
+      };
+
+      explicit CifTokenizer(QIODevice *device) : m_device(device), m_pos(0),
+        m_data(0), m_size(0), m_null(false) { }
+
+      Type next();
+
+      const char * data() const { return m_data; }
+      int size() const { return m_size; }
+      QByteArray token() const { return QByteArray(m_data, m_size); }
+
+      /**
+       * @return True for the unquoted values . (inapplicable) and ? (unknown).
+       */
+      bool isNull() const { return m_null; }
+
+    private:
+      bool readLine();
+
+      QIODevice *m_device;
+      QByteArray m_line;
+      QByteArray m_text;  // the last semicolon delimited text field
+      int m_pos;
+      const char *m_data;
+      int m_size;
+      bool m_null;
+    };
+
+    inline bool isSpace(char c)
+    {
+      return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+    }
+
+    bool CifTokenizer::readLine()
+    {
+      if (m_device->atEnd())
+        return false;
+      m_line = m_device->readLine();
+      int size = m_line.size();
+      while (size > 0 && (m_line.at(size - 1) == '\n' || m_line.at(size - 1) == '\r'))
+        --size;
+      m_line.truncate(size);
+      m_pos = 0;
+      return true;
+    }
+
+    CifTokenizer::Type CifTokenizer::next()
+    {
+      m_null = false;
+      for (;;) {
+        const char *line = m_line.constData();
+        const int size = m_line.size();
+        while (m_pos < size && isSpace(line[m_pos]))
+          ++m_pos;
+
+        if (m_pos >= size || line[m_pos] == '#') {
+          if (!readLine())
+            return End;
+          // A semicolon in the first column opens a text field that is
+          // closed by the next line starting with a semicolon
+          if (m_line.startsWith(';')) {
+            m_text = m_line.mid(1);
+            bool closed = false;
+            while (readLine()) {
+              if (m_line.startsWith(';')) {
+                m_pos = 1;
+                closed = true;
+                break;
+              }
+              if (!m_text.isEmpty())
+                m_text += '\n';
+              m_text += m_line;
+            }
+            if (!closed) {
+              m_line.clear();
+              m_pos = 0;
+            }
+            m_data = m_text.constData();
+            m_size = m_text.size();
+            return Value;
+          }
+          continue;
+        }
+
+        const char c = line[m_pos];
+        if (c == '\'' || c == '"') {
+          // The quote only ends at the same quote followed by white space
+          int end = m_pos + 1;
+          while (end < size && !(line[end] == c && (end + 1 == size || isSpace(line[end + 1]))))
+            ++end;
+          m_data = line + m_pos + 1;
+          m_size = end - m_pos - 1;
+          m_pos = qMin(end + 1, size);
+          return Value;
+        }
+
+        int end = m_pos;
+        while (end < size && !isSpace(line[end]))
+          ++end;
+        m_data = line + m_pos;
+        m_size = end - m_pos;
+        m_pos = end;
+
+        if (c == '_')
+          return Tag;
+        if (m_size == 1 && (c == '.' || c == '?')) {
+          m_null = true;
+          return Value;
+        }
+        if (m_size >= 5 && qstrnicmp(m_data, "data_", 5) == 0)
+          return Data;
+        if (m_size == 5 && qstrnicmp(m_data, "loop_", 5) == 0)
+          return Loop;
+        if ((m_size == 7 && qstrnicmp(m_data, "global_", 7) == 0)
+            || (m_size >= 5 && qstrnicmp(m_data, "save_", 5) == 0)
+            || (m_size == 5 && qstrnicmp(m_data, "stop_", 5) == 0))
+          return Other;
+        return Value;
+      }
+    }
+
+    /**
+     * The CIF 1 (DDL1) and mmCIF (DDL2) names of the same item only differ
+     * by the separator after the category, _cell_length_a and
+     * _cell.length_a, and the case. Both are stored as _cell_length_a.
+     */
+    QByteArray normalizedTag(const char *data, int size)
+    {
+      QByteArray tag(data, size);
+      char *c = tag.data();
+      for (int i = 0; i < size; ++i) {
+        if (c[i] == '.')
+          c[i] = '_';
+        else
+          c[i] = tolower(static_cast<unsigned char>(c[i]));
+      }
+      return tag;
+    }
+
+    /**
+     * @return The number in @p data, ignoring a standard uncertainty in
+     * parentheses as in 0.1234(5).
+     */
+    double toDouble(const char *data, int size, bool *ok = 0)
+    {
+      int length = 0;
+      while (length < size && data[length] != '(')
+        ++length;
+      return QByteArray::fromRawData(data, length).toDouble(ok);
+    }
+
+    double toDouble(const QByteArray &value, bool *ok = 0)
+    {
+      return toDouble(value.constData(), value.size(), ok);
+    }
+
+    struct SymmetryOperator
+    {
+      Matrix3d rotation;
+      Vector3d translation;
+    };
+
+    /**
+     * Parse a symmetry operator in the xyz notation, e.g. -x+1/2,y,-z.
+     */
+    bool parseOperator(const QByteArray &text, SymmetryOperator &op)
+    {
+      QByteArray compact = text.toLower();
+      compact.replace(' ', "");
+      const QList<QByteArray> rows = compact.split(',');
+      if (rows.size() != 3)
+        return false;
+
+      op.rotation.setZero();
+      op.translation.setZero();
+      for (int row = 0; row < 3; ++row) {
+        const QByteArray &p = rows.at(row);
+        const int size = p.size();
+        if (size == 0)
+          return false;
+        int i = 0;
+        while (i < size) {
+          double sign = 1.0;
+          if (p.at(i) == '+' || p.at(i) == '-') {
+            sign = p.at(i) == '-' ? -1.0 : 1.0;
+            ++i;
+          }
+          double value = 1.0;
+          bool hasNumber = false;
+          int start = i;
+          while (i < size && (isdigit(static_cast<unsigned char>(p.at(i))) || p.at(i) == '.'))
+            ++i;
+          if (i > start) {
+            hasNumber = true;
+            value = p.mid(start, i - start).toDouble();
+            if (i < size && p.at(i) == '/') {
+              start = ++i;
+              while (i < size && isdigit(static_cast<unsigned char>(p.at(i))))
+                ++i;
+              const double denominator = p.mid(start, i - start).toDouble();
+              if (denominator == 0.0)
+                return false;
+              value /= denominator;
+            }
+          }
+          if (i < size && p.at(i) == '*')
+            ++i;
+          if (i < size && p.at(i) >= 'x' && p.at(i) <= 'z') {
+            op.rotation(row, p.at(i) - 'x') += sign * value;
+            ++i;
+          }
+          else if (hasNumber)
+            op.translation(row) += sign * value;
+          else
+            return false;
+        }
+      }
+      return true;
+    }
+
+    /**
+     * @return The Cartesian cell vectors as columns, a along x and b in the
+     * xy plane, as OpenBabel::OBUnitCell::SetData() and PDB files.
+     */
+    Matrix3d cellMatrix(double a, double b, double c,
+                        double alpha, double beta, double gamma)
+    {
+      const double degree = M_PI / 180.0;
+      const double ca = cos(alpha * degree);
+      const double cb = cos(beta * degree);
+      const double cg = cos(gamma * degree);
+      const double sg = sin(gamma * degree);
+      Matrix3d m = Matrix3d::Zero();
+      m(0, 0) = a;
+      m(0, 1) = b * cg;
+      m(1, 1) = b * sg;
+      m(0, 2) = c * cb;
+      m(1, 2) = c * (ca - cb * cg) / sg;
+      m(2, 2) = sqrt(qMax(0.0, c * c - m(0, 2) * m(0, 2) - m(1, 2) * m(1, 2)));
+      return m;
+    }
+
+    /**
+     * @return True for the amino acids, nucleotides and waters, whose atom
+     * names always start with a one letter element.
+     */
+    bool isPolymerResidue(const QByteArray &residue)
+    {
+      static const char *names[] = {
+        "ALA", "ARG", "ASN", "ASP", "CYS", "GLN", "GLU", "GLY", "HIS", "ILE",
+        "LEU", "LYS", "MET", "PHE", "PRO", "SER", "THR", "TRP", "TYR", "VAL",
+        "ASH", "CYX", "GLH", "HID", "HIE", "HIP", "HSD", "HSE", "HSP", "LYN",
+        "MSE", "SEC", "PYL", "A", "C", "G", "I", "U", "T", "DA", "DC", "DG",
+        "DI", "DT", "DU", "HOH", "WAT", "DOD", 0 };
+      static QSet<QByteArray> set;
+      if (set.isEmpty())
+        for (int i = 0; names[i]; ++i)
+          set.insert(names[i]);
+      return set.contains(residue.toUpper());
+    }
+
+    /**
+     * @return The element symbol in the atom @p name, for sites without a
+     * type symbol. The PDB column alignment that tells CA (alpha carbon)
+     * from CA (calcium) is lost in CIF files, so leading digits are
+     * skipped (1HB) and the first letter is the element, except for single
+     * atom residues named like their atom (CA, ZN) and the halogens of
+     * ligands (CL1, BR2).
+     */
+    QByteArray nameSymbol(const QByteArray &name, const QByteArray &residue)
+    {
+      int start = 0;
+      while (start < name.size() && isdigit(static_cast<unsigned char>(name.at(start))))
+        ++start;
+      int letters = 0;
+      while (start + letters < name.size() && letters < 2
+             && isalpha(static_cast<unsigned char>(name.at(start + letters))))
+        ++letters;
+
+      const QByteArray symbol = name.mid(start, letters).toUpper();
+      if (letters < 2 || isPolymerResidue(residue))
+        return symbol.left(1);
+      if (name.mid(start).toUpper() == residue.toUpper() || symbol == "CL" || symbol == "BR")
+        return symbol;
+      return symbol.left(1);
+    }
+
+  } // End anonymous namespace
+
+  class CifReaderPrivate
+  {
+  public:
+    CifReaderPrivate() : fillMode(CifReader::FillAutomatic), tolerance(0.05) { }
+
+    // An atom site as read from the file, the strings are interned
+    struct CifAtom
+    {
+      Vector3d position;  // fractional if CifReaderPrivate::fractional
+      int atomicNumber;
+      int formalCharge;
+      int model;
+      QByteArray name;
+      QByteArray residue;
+      QByteArray number;  // author sequence number and insertion code
+      QByteArray chain;   // author chain id
+      QByteArray asym;    // label chain id, used by the assemblies
+      QByteArray entity;
+    };
+
+    // A small loop kept as text
+    struct Table
+    {
+      QList<QByteArray> tags;
+      QList<QList<QByteArray> > rows;
+      int column(const char *tag) const { return tags.indexOf(QByteArray(tag)); }
+    };
+
+    // Column indices of the atom_site loop, -1 if missing
+    struct AtomSiteColumns
+    {
+      int symbol, label, atomId, authAtomId, compId, authCompId, asymId,
+        authAsymId, seqId, authSeqId, insCode, entityId, altId, calcFlag,
+        charge, model;
+      int position[3];
+      bool fractional;
+    };
+
+    void clear();
+
+    void parse(QIODevice *device);
+    CifTokenizer::Type parseLoop(CifTokenizer &tokens);
+    void addAtomSite(const AtomSiteColumns &columns, const std::vector<char> &buffer,
+                     const QVector<int> &offsets, const QVector<int> &sizes);
+
+    QByteArray intern(const char *data, int size);
+    int element(const char *data, int size, int *charge);
+
+    QByteArray item(const char *tag) const { return items.value(QByteArray(tag)); }
+    Table table(const char *tag) const;
+
+    QList<QByteArray> operatorTexts() const;
+    bool hasCell() const;
+    Matrix3d cell() const;
+    const OpenBabel::SpaceGroup * spaceGroup() const;
+
+    void fillUnitCell(const QList<SymmetryOperator> &operators, const Matrix3d &cell);
+    bool assemblyOperators(QList<SymmetryOperator> &operators,
+                           const QString &expression, const Table &operatorList) const;
+    bool buildAssembly(Molecule *molecule, const std::vector<int> &selected);
+    void build(Molecule *molecule, const std::vector<int> &selected);
+
+    QList<int> models;
+    QStringList chains;
+    QString assembly;
+    CifReader::FillMode fillMode;
+    double tolerance;
+    QString error;
+
+    QHash<QByteArray, QByteArray> items;
+    QList<Table> tables;
+    std::vector<CifAtom> atoms;
+    bool fractional;
+    int firstModel;
+    QHash<QByteArray, QByteArray> altIds; // first alternate location of each site
+    QSet<QByteArray> strings;
+    QHash<QByteArray, int> elements;
+    QSet<QByteArray> chainFilter;
+  };
+
+  void CifReaderPrivate::clear()
+  {
+    error.clear();
+    items.clear();
+    tables.clear();
+    atoms.clear();
+    fractional = false;
+    firstModel = -1;
+    altIds.clear();
+    strings.clear();
+    chainFilter.clear();
+    foreach (const QString &chain, chains)
+      chainFilter.insert(chain.toAscii());
+  }
+
+  void CifReaderPrivate::parse(QIODevice *device)
+  {
+    CifTokenizer tokens(device);
+    bool inBlock = false;
+    CifTokenizer::Type type = tokens.next();
+    while (type != CifTokenizer::End) {
+      switch (type) {
+      case CifTokenizer::Data:
+        // Only the first data block is read
+        if (inBlock)
+          return;
+        inBlock = true;
+        type = tokens.next();
+        break;
+      case CifTokenizer::Tag: {
+        const QByteArray tag = normalizedTag(tokens.data(), tokens.size());
+        type = tokens.next();
+        if (type == CifTokenizer::Value) {
+          items.insert(tag, tokens.isNull() ? QByteArray() : tokens.token());
+          type = tokens.next();
+        }
+        break;
+      }
+      case CifTokenizer::Loop:
+        type = parseLoop(tokens);
+        break;
+      default:
+        type = tokens.next();
+      }
+    }
+  }
+
+  CifTokenizer::Type CifReaderPrivate::parseLoop(CifTokenizer &tokens)
+  {
+    QList<QByteArray> tags;
+    CifTokenizer::Type type = tokens.next();
+    while (type == CifTokenizer::Tag) {
+      tags.append(normalizedTag(tokens.data(), tokens.size()));
+      type = tokens.next();
+    }
+    if (tags.isEmpty())
+      return type;
+    const int numColumns = tags.size();
+
+    // The atom sites are converted row by row, the values of a row are
+    // copied into one buffer as a row may span several lines
+    if (tags.contains("_atom_site_cartn_x") || tags.contains("_atom_site_fract_x")) {
+      AtomSiteColumns c;
+      c.symbol = tags.indexOf("_atom_site_type_symbol");
+      c.label = tags.indexOf("_atom_site_label");
+      c.atomId = tags.indexOf("_atom_site_label_atom_id");
+      c.authAtomId = tags.indexOf("_atom_site_auth_atom_id");
+      c.compId = tags.indexOf("_atom_site_label_comp_id");
+      c.authCompId = tags.indexOf("_atom_site_auth_comp_id");
+      c.asymId = tags.indexOf("_atom_site_label_asym_id");
+      c.authAsymId = tags.indexOf("_atom_site_auth_asym_id");
+      c.seqId = tags.indexOf("_atom_site_label_seq_id");
+      c.authSeqId = tags.indexOf("_atom_site_auth_seq_id");
+      c.insCode = tags.indexOf("_atom_site_pdbx_pdb_ins_code");
+      c.entityId = tags.indexOf("_atom_site_label_entity_id");
+      c.altId = tags.indexOf("_atom_site_label_alt_id");
+      if (c.altId < 0)
+        c.altId = tags.indexOf("_atom_site_disorder_group");
+      c.calcFlag = tags.indexOf("_atom_site_calc_flag");
+      c.charge = tags.indexOf("_atom_site_pdbx_formal_charge");
+      c.model = tags.indexOf("_atom_site_pdbx_pdb_model_num");
+      c.fractional = !tags.contains("_atom_site_cartn_x");
+      const char *axes[3] = { "x", "y", "z" };
+      for (int i = 0; i < 3; ++i)
+        c.position[i] = tags.indexOf((c.fractional ? "_atom_site_fract_"
+                                      : "_atom_site_cartn_") + QByteArray(axes[i]));
+      if (c.position[0] < 0 || c.position[1] < 0 || c.position[2] < 0) {
+        while (type == CifTokenizer::Value)
+          type = tokens.next();
+        return type;
+      }
+      fractional = c.fractional;
+
+      std::vector<char> buffer;
+      QVector<int> offsets(numColumns), sizes(numColumns);
+      int column = 0;
+      while (type == CifTokenizer::Value) {
+        offsets[column] = buffer.size();
+        sizes[column] = tokens.isNull() ? -1 : tokens.size();
+        buffer.insert(buffer.end(), tokens.data(), tokens.data() + tokens.size());
+        if (++column == numColumns) {
+          addAtomSite(c, buffer, offsets, sizes);
+          buffer.clear();
+          column = 0;
+        }
+        type = tokens.next();
+      }
+      return type;
+    }
+
+    // Keep the small loops needed for the symmetry and the assemblies
+    const QByteArray &first = tags.first();
+    if (first.startsWith("_symmetry_equiv_") || first.startsWith("_space_group_symop_")
+        || first.startsWith("_pdbx_struct_assembly_gen_")
+        || first.startsWith("_pdbx_struct_oper_list_")) {
+      Table table;
+      table.tags = tags;
+      QList<QByteArray> row;
+      while (type == CifTokenizer::Value) {
+        row.append(tokens.isNull() ? QByteArray() : tokens.token());
+        if (row.size() == numColumns) {
+          table.rows.append(row);
+          row.clear();
+        }
+        type = tokens.next();
+      }
+      tables.append(table);
+      return type;
+    }
+
+    while (type == CifTokenizer::Value)
+      type = tokens.next();
+    return type;
+  }
+
+  QByteArray CifReaderPrivate::intern(const char *data, int size)
+  {
+    if (size <= 0)
+      return QByteArray();
+    // Most strings repeat, e.g. residue and atom names, so each is stored once
+    const QByteArray raw = QByteArray::fromRawData(data, size);
+    QSet<QByteArray>::const_iterator it = strings.constFind(raw);
+    if (it != strings.constEnd())
+      return *it;
+    const QByteArray copy(data, size);
+    strings.insert(copy);
+    return copy;
+  }
+
+  int CifReaderPrivate::element(const char *data, int size, int *charge)
+  {
+    // Leading letters give the element, a trailing 2+ or 1- the charge
+    int letters = 0;
+    while (letters < size && letters < 2 && isalpha(static_cast<unsigned char>(data[letters])))
+      ++letters;
+    if (charge) {
+      *charge = 0;
+      const char last = size > letters ? data[size - 1] : 0;
+      if (last == '+' || last == '-') {
+        int value = 1;
+        if (size - letters > 1 && isdigit(static_cast<unsigned char>(data[size - 2])))
+          value = data[size - 2] - '0';
+        *charge = last == '-' ? -value : value;
+      }
+    }
+    if (!letters)
+      return 0;
+
+    const QByteArray key(data, letters);
+    QHash<QByteArray, int>::const_iterator it = elements.constFind(key);
+    if (it != elements.constEnd())
+      return it.value();
+
+    // Try the two letter symbol first, then the first letter alone
+    QByteArray symbol = key.toLower();
+    symbol[0] = toupper(symbol.at(0));
+    int atomicNumber = OpenBabel::etab.GetAtomicNum(symbol.constData());
+    if (!atomicNumber && letters == 2)
+      atomicNumber = OpenBabel::etab.GetAtomicNum(symbol.left(1).constData());
+    elements.insert(key, atomicNumber);
+    return atomicNumber;
+  }
+
+  void CifReaderPrivate::addAtomSite(const AtomSiteColumns &c,
+                                     const std::vector<char> &buffer,
+                                     const QVector<int> &offsets,
+                                     const QVector<int> &sizes)
+  {
+    const char *base = buffer.empty() ? 0 : &buffer[0];
+#define CIF_VALUE(column) (base + offsets.at(column))
+#define CIF_SIZE(column) ((column) < 0 ? -1 : sizes.at(column))
+
+    // Dummy atoms are dropped
+    if (CIF_SIZE(c.calcFlag) == 3 && qstrnicmp(CIF_VALUE(c.calcFlag), "dum", 3) == 0)
+      return;
+
+    // Selected models and chains
+    int model = 1;
+    if (CIF_SIZE(c.model) > 0)
+      model = qRound(toDouble(CIF_VALUE(c.model), sizes.at(c.model)));
+    if (models.isEmpty()) {
+      if (firstModel < 0)
+        firstModel = model;
+      else if (model != firstModel)
+        return;
+    }
+    else if (!models.contains(model))
+      return;
+
+    const QByteArray chain = CIF_SIZE(c.authAsymId) > 0 ?
+      intern(CIF_VALUE(c.authAsymId), sizes.at(c.authAsymId)) : QByteArray();
+    const QByteArray asym = CIF_SIZE(c.asymId) > 0 ?
+      intern(CIF_VALUE(c.asymId), sizes.at(c.asymId)) : QByteArray();
+    if (!chainFilter.isEmpty() && !chainFilter.contains(chain) && !chainFilter.contains(asym))
+      return;
+
+    CifAtom atom;
+    atom.model = model;
+    atom.formalCharge = 0;
+    atom.chain = chain.isEmpty() ? asym : chain;
+    atom.asym = asym.isEmpty() ? chain : asym;
+    bool ok = true;
+    for (int i = 0; i < 3 && ok; ++i)
+      atom.position[i] = CIF_SIZE(c.position[i]) > 0 ?
+        toDouble(CIF_VALUE(c.position[i]), sizes.at(c.position[i]), &ok) : 0.0;
+    if (!ok)
+      return;
+
+    int nameColumn = CIF_SIZE(c.authAtomId) > 0 ? c.authAtomId
+      : (CIF_SIZE(c.atomId) > 0 ? c.atomId : c.label);
+    if (CIF_SIZE(nameColumn) > 0)
+      atom.name = intern(CIF_VALUE(nameColumn), sizes.at(nameColumn));
+    int residueColumn = CIF_SIZE(c.authCompId) > 0 ? c.authCompId : c.compId;
+    if (CIF_SIZE(residueColumn) > 0)
+      atom.residue = intern(CIF_VALUE(residueColumn), sizes.at(residueColumn));
+
+    // The element from the type symbol, or else from the atom name
+    if (CIF_SIZE(c.symbol) > 0) {
+      atom.atomicNumber = element(CIF_VALUE(c.symbol), sizes.at(c.symbol),
+                                  &atom.formalCharge);
+    }
+    else {
+      const QByteArray symbol = nameSymbol(atom.name, atom.residue);
+      atom.atomicNumber = element(symbol.constData(), symbol.size(), 0);
+    }
+    if (CIF_SIZE(c.charge) > 0)
+      atom.formalCharge = qRound(toDouble(CIF_VALUE(c.charge), sizes.at(c.charge)));
+
+    int numberColumn = CIF_SIZE(c.authSeqId) > 0 ? c.authSeqId : c.seqId;
+    if (CIF_SIZE(numberColumn) > 0) {
+      QByteArray number(CIF_VALUE(numberColumn), sizes.at(numberColumn));
+      if (CIF_SIZE(c.insCode) > 0)
+        number.append(CIF_VALUE(c.insCode), sizes.at(c.insCode));
+      atom.number = intern(number.constData(), number.size());
+    }
+    if (CIF_SIZE(c.entityId) > 0)
+      atom.entity = intern(CIF_VALUE(c.entityId), sizes.at(c.entityId));
+
+    // Sites without an alternate location are always kept, of the others
+    // only the first location listed for each atom of a residue
+    if (CIF_SIZE(c.altId) > 0) {
+      QByteArray site = QByteArray::number(model);
+      site.append(' ').append(atom.chain).append(' ').append(atom.number)
+        .append(' ').append(atom.residue).append(' ').append(atom.name);
+      const QByteArray alt(CIF_VALUE(c.altId), sizes.at(c.altId));
+      QHash<QByteArray, QByteArray>::const_iterator it = altIds.constFind(site);
+      if (it == altIds.constEnd())
+        altIds.insert(site, alt);
+      else if (it.value() != alt)
+        return;
+    }
+
+#undef CIF_VALUE
+#undef CIF_SIZE
+
+    atoms.push_back(atom);
+  }
+
+  CifReaderPrivate::Table CifReaderPrivate::table(const char *tag) const
+  {
+    foreach (const Table &t, tables)
+      if (t.column(tag) >= 0)
+        return t;
+
+    // A category with a single row is usually written as items
+    Table t;
+    if (items.contains(QByteArray(tag))) {
+      QList<QByteArray> row;
+      for (QHash<QByteArray, QByteArray>::const_iterator it = items.constBegin();
+           it != items.constEnd(); ++it) {
+        t.tags.append(it.key());
+        row.append(it.value());
+      }
+      t.rows.append(row);
+    }
+    return t;
+  }
+
+  QList<QByteArray> CifReaderPrivate::operatorTexts() const
+  {
+    QList<QByteArray> texts;
+    const char *tags[2] = { "_space_group_symop_operation_xyz",
+                            "_symmetry_equiv_pos_as_xyz" };
+    for (int i = 0; i < 2 && texts.isEmpty(); ++i) {
+      const Table t = table(tags[i]);
+      const int column = t.column(tags[i]);
+      foreach (const QList<QByteArray> &row, t.rows)
+        if (!row.at(column).isEmpty())
+          texts.append(row.at(column));
+    }
+    return texts;
+  }
+
+  bool CifReaderPrivate::hasCell() const
+  {
+    return toDouble(item("_cell_length_a")) > 0.0
+      && toDouble(item("_cell_length_b")) > 0.0
+      && toDouble(item("_cell_length_c")) > 0.0;
+  }
+
+  Matrix3d CifReaderPrivate::cell() const
+  {
+    const QByteArray alpha = item("_cell_angle_alpha");
+    const QByteArray beta = item("_cell_angle_beta");
+    const QByteArray gamma = item("_cell_angle_gamma");
+    return cellMatrix(toDouble(item("_cell_length_a")),
+                      toDouble(item("_cell_length_b")),
+                      toDouble(item("_cell_length_c")),
+                      alpha.isEmpty() ? 90.0 : toDouble(alpha),
+                      beta.isEmpty() ? 90.0 : toDouble(beta),
+                      gamma.isEmpty() ? 90.0 : toDouble(gamma));
+  }
+
+  const OpenBabel::SpaceGroup * CifReaderPrivate::spaceGroup() const
+  {
+    QByteArray hm = item("_space_group_name_h-m_alt");
+    if (hm.isEmpty())
+      hm = item("_symmetry_space_group_name_h-m");
+    QByteArray hall = item("_space_group_name_hall");
+    if (hall.isEmpty())
+      hall = item("_symmetry_space_group_name_hall");
+
+    // The operators are the most reliable, the names come in many spellings
+    const QList<QByteArray> texts = operatorTexts();
+    if (!texts.isEmpty()) {
+      OpenBabel::SpaceGroup *group = new OpenBabel::SpaceGroup;
+      if (!hm.isEmpty())
+        group->SetHMName(hm.constData());
+      foreach (const QByteArray &text, texts)
+        group->AddTransform(text.constData());
+      const OpenBabel::SpaceGroup *found = OpenBabel::SpaceGroup::Find(group);
+      if (found != group)
+        delete group;
+      if (found)
+        return found;
+    }
+    if (!hall.isEmpty())
+      if (const OpenBabel::SpaceGroup *found = OpenBabel::SpaceGroup::GetSpaceGroup(hall.constData()))
+        return found;
+    if (!hm.isEmpty())
+      return OpenBabel::SpaceGroup::GetSpaceGroup(hm.constData());
+    return 0;
+  }
+
+  void CifReaderPrivate::fillUnitCell(const QList<SymmetryOperator> &operators,
+                                      const Matrix3d &cell)
+  {
+    // The images are hashed on a grid in fractional coordinates whose
+    // spacing is at least the tolerance along each cell vector, so a
+    // duplicate is in the same or a neighboring (periodic) grid cell
+    const double volume = fabs(cell.determinant());
+    Vector3i grid;
+    for (int i = 0; i < 3; ++i) {
+      const double height = volume / cell.col((i + 1) % 3).cross(cell.col((i + 2) % 3)).norm();
+      grid[i] = qBound(1, static_cast<int>(height / tolerance), 1024);
+    }
+    const double tolerance2 = tolerance * tolerance;
+
+    std::vector<CifAtom> filled;
+    filled.reserve(atoms.size() * operators.size());
+    QMultiHash<qint64, int> cells;
+    cells.reserve(atoms.size() * operators.size());
+
+    for (std::vector<CifAtom>::const_iterator atom = atoms.begin(); atom != atoms.end(); ++atom) {
+      foreach (const SymmetryOperator &op, operators) {
+        Vector3d f = op.rotation * atom->position + op.translation;
+        Vector3i index;
+        for (int i = 0; i < 3; ++i) {
+          f[i] -= floor(f[i]);
+          if (f[i] >= 1.0)
+            f[i] = 0.0;
+          index[i] = qMin(static_cast<int>(f[i] * grid[i]), grid[i] - 1);
+        }
+
+        bool duplicate = false;
+        for (int dx = -1; dx <= 1 && !duplicate; ++dx)
+          for (int dy = -1; dy <= 1 && !duplicate; ++dy)
+            for (int dz = -1; dz <= 1 && !duplicate; ++dz) {
+              const qint64 key =
+                (qint64((index[0] + dx + grid[0]) % grid[0]) * grid[1]
+                 + (index[1] + dy + grid[1]) % grid[1]) * grid[2]
+                + (index[2] + dz + grid[2]) % grid[2];
+              QMultiHash<qint64, int>::const_iterator it = cells.constFind(key);
+              for (; it != cells.constEnd() && it.key() == key; ++it) {
+                const CifAtom &other = filled[it.value()];
+                if (other.atomicNumber != atom->atomicNumber)
+                  continue;
+                Vector3d delta = f - other.position;
+                for (int i = 0; i < 3; ++i)
+                  delta[i] -= floor(delta[i] + 0.5);
+                if ((cell * delta).squaredNorm() < tolerance2) {
+                  duplicate = true;
+                  break;
+                }
+              }
+            }
+        if (duplicate)
+          continue;
+
+        cells.insert((qint64(index[0]) * grid[1] + index[1]) * grid[2] + index[2],
+                     filled.size());
+        filled.push_back(*atom);
+        filled.back().position = f;
+      }
+    }
+    atoms.swap(filled);
+  }
+
+  bool CifReaderPrivate::assemblyOperators(QList<SymmetryOperator> &operators,
+                                           const QString &expression,
+                                           const Table &operatorList) const
+  {
+    // The operators by id
+    QHash<QString, SymmetryOperator> byId;
+    const int idColumn = operatorList.column("_pdbx_struct_oper_list_id");
+    if (idColumn < 0)
+      return false;
+    int matrixColumns[3][3];
+    int vectorColumns[3];
+    for (int i = 0; i < 3; ++i) {
+      for (int j = 0; j < 3; ++j)
+        matrixColumns[i][j] = operatorList.column(QString("_pdbx_struct_oper_list_matrix[%1][%2]")
+                                                  .arg(i + 1).arg(j + 1).toAscii().constData());
+      vectorColumns[i] = operatorList.column(QString("_pdbx_struct_oper_list_vector[%1]")
+                                             .arg(i + 1).toAscii().constData());
+    }
+    foreach (const QList<QByteArray> &row, operatorList.rows) {
+      SymmetryOperator op;
+      for (int i = 0; i < 3; ++i) {
+        for (int j = 0; j < 3; ++j)
+          op.rotation(i, j) = matrixColumns[i][j] < 0 ? double(i == j)
+            : toDouble(row.at(matrixColumns[i][j]));
+        op.translation[i] = vectorColumns[i] < 0 ? 0.0 : toDouble(row.at(vectorColumns[i]));
+      }
+      byId.insert(QString(row.at(idColumn)), op);
+    }
+
+    // The expression is a list like 1,2,5 or 1-60, or a product of lists
+    // in parentheses like (X0)(1-60) where the last list is applied first
+    QStringList groups;
+    QRegExp parenthesized("\\(([^)]*)\\)");
+    int pos = 0;
+    while ((pos = parenthesized.indexIn(expression, pos)) != -1) {
+      groups.append(parenthesized.cap(1));
+      pos += parenthesized.matchedLength();
+    }
+    if (groups.isEmpty())
+      groups.append(expression);
+
+    operators.clear();
+    SymmetryOperator identity;
+    identity.rotation.setIdentity();
+    identity.translation.setZero();
+    operators.append(identity);
+    foreach (const QString &group, groups) {
+      QList<SymmetryOperator> factors;
+      foreach (const QString &item, group.split(',', QString::SkipEmptyParts)) {
+        const QStringList range = item.trimmed().split('-');
+        bool okFirst = false, okLast = false;
+        const int first = range.first().toInt(&okFirst);
+        const int last = range.size() == 2 ? range.last().toInt(&okLast) : 0;
+        QStringList ids;
+        if (range.size() == 2 && okFirst && okLast)
+          for (int i = first; i <= last; ++i)
+            ids.append(QString::number(i));
+        else
+          ids.append(item.trimmed());
+        foreach (const QString &id, ids) {
+          if (!byId.contains(id))
+            return false;
+          factors.append(byId.value(id));
+        }
+      }
+      QList<SymmetryOperator> products;
+      foreach (const SymmetryOperator &left, operators)
+        foreach (const SymmetryOperator &right, factors) {
+          SymmetryOperator op;
+          op.rotation = left.rotation * right.rotation;
+          op.translation = left.rotation * right.translation + left.translation;
+          products.append(op);
+        }
+      operators = products;
+    }
+    return !operators.isEmpty();
+  }
+
+  bool CifReaderPrivate::buildAssembly(Molecule *molecule, const std::vector<int> &selected)
+  {
+    const Table gen = table("_pdbx_struct_assembly_gen_assembly_id");
+    const Table operatorList = table("_pdbx_struct_oper_list_id");
+    const int idColumn = gen.column("_pdbx_struct_assembly_gen_assembly_id");
+    const int expressionColumn = gen.column("_pdbx_struct_assembly_gen_oper_expression");
+    const int asymColumn = gen.column("_pdbx_struct_assembly_gen_asym_id_list");
+    if (idColumn < 0 || expressionColumn < 0 || asymColumn < 0) {
+      error = QObject::tr("The file has no assemblies.");
+      return false;
+    }
+
+    bool found = false;
+    unsigned int chainOffset = 0;
+    foreach (const QList<QByteArray> &row, gen.rows) {
+      if (QString(row.at(idColumn)) != assembly)
+        continue;
+      found = true;
+
+      QList<SymmetryOperator> operators;
+      if (!assemblyOperators(operators, QString(row.at(expressionColumn)), operatorList)) {
+        error = QObject::tr("The operators of assembly %1 are not valid.").arg(assembly);
+        return false;
+      }
+
+      // The chains are built once, with their bonds, and then copied in
+      // bulk by each operator
+      QSet<QByteArray> asymIds;
+      foreach (const QByteArray &id, row.at(asymColumn).split(','))
+        asymIds.insert(id.trimmed());
+      std::vector<int> part;
+      for (std::vector<int>::const_iterator i = selected.begin(); i != selected.end(); ++i)
+        if (asymIds.contains(atoms[*i].asym))
+          part.push_back(*i);
+      if (part.empty())
+        continue;
+      Molecule unit;
+      build(&unit, part);
+      const QList<Residue *> unitResidues = unit.residues();
+      unsigned int numChains = 0;
+      foreach (Residue *residue, unitResidues)
+        numChains = qMax(numChains, residue->chainNumber() + 1);
+
+      foreach (const SymmetryOperator &op, operators) {
+        const PrimitiveList added = molecule->merge(unit, op.rotation, op.translation);
+        // Every copy of a chain is a chain of its own
+        const QList<Primitive *> residues = added.subList(Primitive::ResidueType);
+        for (int i = 0; i < residues.size() && i < unitResidues.size(); ++i) {
+          Residue *residue = static_cast<Residue *>(residues.at(i));
+          residue->setChainNumber(unitResidues.at(i)->chainNumber() + chainOffset);
+          residue->setProperty("entity", unitResidues.at(i)->property("entity"));
+        }
+        chainOffset += numChains;
+      }
+    }
+
+    if (!found)
+      error = QObject::tr("Assembly %1 not found.").arg(assembly);
+    else if (!molecule->numAtoms())
+      error = QObject::tr("Assembly %1 has no atoms.").arg(assembly);
+    return found && molecule->numAtoms();
+  }
+
+  void CifReaderPrivate::build(Molecule *molecule, const std::vector<int> &selected)
+  {
+    QHash<QByteArray, unsigned int> chainNumbers;
+    Residue *residue = 0;
+    const CifAtom *previous = 0;
+    QList<QString> atomIds;
+
+    for (std::vector<int>::const_iterator i = selected.begin(); i != selected.end(); ++i) {
+      const CifAtom &a = atoms[*i];
+      Atom *atom = molecule->addAtom(a.atomicNumber, a.position);
+      if (a.formalCharge)
+        atom->setFormalCharge(a.formalCharge);
+      if (a.residue.isEmpty())
+        continue;
+
+      // The interned strings of the same residue share their data
+      if (!residue || a.residue != previous->residue || a.number != previous->number
+          || a.asym != previous->asym || a.chain != previous->chain) {
+        if (residue)
+          residue->setAtomIds(atomIds);
+        atomIds.clear();
+        residue = molecule->addResidue();
+        residue->setName(a.residue);
+        residue->setNumber(a.number);
+        if (!chainNumbers.contains(a.asym))
+          chainNumbers.insert(a.asym, chainNumbers.size());
+        residue->setChainNumber(chainNumbers.value(a.asym));
+        residue->setChainID(a.chain.isEmpty() ? ' ' : a.chain.at(0));
+        if (!a.entity.isEmpty())
+          residue->setProperty("entity", QString(a.entity));
+      }
+      residue->addAtom(atom->id());
+      atomIds.append(a.name);
+      previous = &a;
+    }
+    if (residue)
+      residue->setAtomIds(atomIds);
+
+    connectTheDots(molecule);
+  }
+
+  CifReader::CifReader() : d(new CifReaderPrivate)
+  {
+  }
+
+  CifReader::~CifReader()
+  {
+    delete d;
+  }
+
+  bool CifReader::canRead(const QString &fileName, const QString &fileType)
+  {
+    const QString type = fileType.isEmpty() ? QFileInfo(fileName).suffix().toLower()
+      : fileType.toLower();
+    return type == "cif" || type == "mmcif" || type == "mcif";
+  }
+
+  void CifReader::setOptions(const QString &options)
+  {
+    foreach (const QString &line, options.split('\n', QString::SkipEmptyParts)) {
+      QStringList words = line.simplified().split(' ', QString::SkipEmptyParts);
+      if (words.isEmpty())
+        continue;
+      const QString key = words.takeFirst().toLower();
+      if (key == "model" || key == "models") {
+        QList<int> models;
+        foreach (const QString &word, words)
+          models.append(word.toInt());
+        setModels(models);
+      }
+      else if (key == "chain" || key == "chains")
+        setChains(words);
+      else if (key == "assembly")
+        setAssembly(words.value(0));
+      else if (key == "fill") {
+        const QString mode = words.value(0).toLower();
+        setFillMode(mode == "always" ? FillAlways
+                    : (mode == "never" ? FillNever : FillAutomatic));
+      }
+    }
+  }
+
+  void CifReader::setModels(const QList<int> &models)
+  {
+    d->models = models;
+  }
+
+  QList<int> CifReader::models() const
+  {
+    return d->models;
+  }
+
+  void CifReader::setChains(const QStringList &chains)
+  {
+    d->chains = chains;
+  }
+
+  QStringList CifReader::chains() const
+  {
+    return d->chains;
+  }
+
+  void CifReader::setAssembly(const QString &assembly)
+  {
+    d->assembly = assembly;
+  }
+
+  QString CifReader::assembly() const
+  {
+    return d->assembly;
+  }
+
+  void CifReader::setFillMode(FillMode mode)
+  {
+    d->fillMode = mode;
+  }
+
+  CifReader::FillMode CifReader::fillMode() const
+  {
+    return d->fillMode;
+  }
+
+  void CifReader::setSymmetryTolerance(double tolerance)
+  {
+    d->tolerance = tolerance;
+  }
+
+  double CifReader::symmetryTolerance() const
+  {
+    return d->tolerance;
+  }
+
+  QString CifReader::errorString() const
+  {
+    return d->error;
+  }
+
+  bool CifReader::read(QIODevice *device, Molecule *molecule)
+  {
+    d->clear();
+    if (!device || !molecule) {
+      d->error = QObject::tr("No file or molecule to read into.");
+      return false;
+    }
+    if (!device->isOpen() && !device->open(QIODevice::ReadOnly)) {
+      d->error = device->errorString();
+      return false;
+    }
+
+    d->parse(device);
+    d->strings.clear();
+    if (d->atoms.empty()) {
+      d->error = QObject::tr("No atoms found.");
+      return false;
+    }
+
+    const bool hasCell = d->hasCell();
+    if (d->fractional && !hasCell) {
+      d->error = QObject::tr("Fractional coordinates without a unit cell.");
+      return false;
+    }
+    const Matrix3d cell = hasCell ? d->cell() : Matrix3d::Identity();
+
+    // Crystal structures are expanded to the whole unit cell, by default
+    // only if they are not molecular crystals as in Molecule::setOBMol()
+    if (d->fractional && d->fillMode != CifReader::FillNever) {
+      QList<SymmetryOperator> operators;
+      foreach (const QByteArray &text, d->operatorTexts()) {
+        SymmetryOperator op;
+        if (parseOperator(text, op))
+          operators.append(op);
+      }
+      bool fill = operators.size() > 1;
+      if (fill && d->fillMode == CifReader::FillAutomatic) {
+        int numCarbons = 0;
+        int numHydrogens = 0;
+        for (std::vector<CifReaderPrivate::CifAtom>::const_iterator a = d->atoms.begin();
+             a != d->atoms.end(); ++a) {
+          if (a->atomicNumber == 6)
+            ++numCarbons;
+          else if (a->atomicNumber == 1)
+            ++numHydrogens;
+        }
+        fill = numCarbons < 4 && !(numCarbons && numHydrogens);
+      }
+      if (fill)
+        d->fillUnitCell(operators, cell);
+    }
+    if (d->fractional)
+      for (std::vector<CifReaderPrivate::CifAtom>::iterator a = d->atoms.begin();
+           a != d->atoms.end(); ++a)
+        a->position = cell * a->position;
+
+    // The first model read gives the atoms, the others are conformers
+    const int primaryModel = d->atoms.front().model;
+    std::vector<int> selected;
+    QMap<int, std::vector<int> > otherModels;
+    for (unsigned int i = 0; i < d->atoms.size(); ++i) {
+      if (d->atoms[i].model == primaryModel)
+        selected.push_back(i);
+      else
+        otherModels[d->atoms[i].model].push_back(i);
+    }
+
+    if (!d->assembly.isEmpty()) {
+      const bool ok = d->buildAssembly(molecule, selected);
+      d->atoms.clear();
+      return ok;
+    }
+
+    d->build(molecule, selected);
+    foreach (const std::vector<int> &model, otherModels) {
+      if (model.size() != selected.size())
+        continue;
+      std::vector<Vector3d> conformer(model.size());
+      for (unsigned int i = 0; i < model.size(); ++i)
+        conformer[i] = d->atoms[model[i]].position;
+      molecule->addConformer(conformer, molecule->numConformers());
+    }
+    d->atoms.clear();
+
+    if (hasCell) {
+      OpenBabel::OBUnitCell *unitCell = new OpenBabel::OBUnitCell;
+      const QByteArray alpha = d->item("_cell_angle_alpha");
+      const QByteArray beta = d->item("_cell_angle_beta");
+      const QByteArray gamma = d->item("_cell_angle_gamma");
+      unitCell->SetData(toDouble(d->item("_cell_length_a")),
+                        toDouble(d->item("_cell_length_b")),
+                        toDouble(d->item("_cell_length_c")),
+                        alpha.isEmpty() ? 90.0 : toDouble(alpha),
+                        beta.isEmpty() ? 90.0 : toDouble(beta),
+                        gamma.isEmpty() ? 90.0 : toDouble(gamma));
+      if (const OpenBabel::SpaceGroup *group = d->spaceGroup())
+        unitCell->SetSpaceGroup(group);
+      molecule->setOBUnitCell(unitCell);
+    }
+    return true;
+  }
+
+} // End namespace Avogadro
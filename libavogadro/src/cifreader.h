@@ -0,0 +1,147 @@
+/**********************************************************************
+  CifReader - Native reader for CIF and PDBx/mmCIF files
+
+  Copyright (C) 2013 Avogadro Developers
+
+  This file is part of the Avogadro molecular editor project.
+  For more information, see <http://avogadro.cc/>
+
+  Avogadro is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  Avogadro is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+  02110-1301, USA.
+ **********************************************************************/
+
+#ifndef CIFREADER_H
+#define CIFREADER_H
+
+#include <avogadro/global.h>
+
+#include <QList>
+#include <QString>
+#include <QStringList>
+
+class QIODevice;
+
+namespace Avogadro {
+
+  class Molecule;
+  class CifReaderPrivate;
+
+  /**
+   * @class CifReader cifreader.h <avogadro/cifreader.h>
+   * @brief Reads small molecule CIF and macromolecular PDBx/mmCIF files.
+   *
+   * The file is tokenized as it is read, only the atom sites and the few
+   * small categories describing the cell, the symmetry and the biological
+   * assemblies are kept, so large entries are read in one pass without
+   * holding the text in memory.
+   *
+   * The atoms, residues (with chain, entity and atom names), the unit cell
+   * and the bonds are filled in directly, OpenBabel is only used for the
+   * element and space group tables.
+   *
+   * For crystals given in fractional coordinates the symmetry operators
+   * are applied to the whole asymmetric unit and the images that fall on
+   * an atom already in the cell are dropped. For macromolecules a
+   * biological assembly can be built from the operators of the file.
+   * Loading can be restricted to some models and chains.
+   *
+   * @code
+   * CifReader reader;
+   * reader.setAssembly("1");
+   * if (!reader.read(&file, molecule))
+   *   qDebug() << reader.errorString();
+   * @endcode
+   */
+  class A_EXPORT CifReader
+  {
+  public:
+    /**
+     * When to fill the unit cell of a crystal by the symmetry operators.
+     */
+    enum FillMode {
+      FillAutomatic, //!< Only for inorganic crystals, as Molecule::setOBMol
+      FillAlways,
+      FillNever
+    };
+
+    CifReader();
+    ~CifReader();
+
+    /**
+     * @return True if @p fileName, or @p fileType if not empty, is a CIF
+     * or mmCIF file that this reader should be used for.
+     */
+    static bool canRead(const QString &fileName,
+                        const QString &fileType = QString());
+
+    /**
+     * Set the selection from an option string, one option per line:
+     * "model 1 3", "chain A B", "assembly 1" and "fill always|never|auto".
+     * Unknown lines are ignored.
+     */
+    void setOptions(const QString &options);
+
+    /**
+     * Models to load, by pdbx_PDB_model_num. The first one read gives the
+     * atoms, the others are added as conformers if they have the same
+     * atoms. The default, an empty list, loads only the first model.
+     */
+    void setModels(const QList<int> &models);
+    QList<int> models() const;
+
+    /**
+     * Chains to load, matched against both the author and the label chain
+     * ids. The default, an empty list, loads all chains.
+     */
+    void setChains(const QStringList &chains);
+    QStringList chains() const;
+
+    /**
+     * The id of the biological assembly to build from the
+     * pdbx_struct_assembly_gen category. Empty, the default, loads the
+     * asymmetric unit.
+     */
+    void setAssembly(const QString &assembly);
+    QString assembly() const;
+
+    void setFillMode(FillMode mode);
+    FillMode fillMode() const;
+
+    /**
+     * Two symmetry images of the same element closer than @p tolerance
+     * Angstrom are the same atom. The default is 0.05.
+     */
+    void setSymmetryTolerance(double tolerance);
+    double symmetryTolerance() const;
+
+    /**
+     * Read the first data block of @p device into @p molecule, which
+     * should be empty.
+     * @return False if no atoms could be read, see errorString().
+     */
+    bool read(QIODevice *device, Molecule *molecule);
+
+    /**
+     * @return The reason the last read() failed.
+     */
+    QString errorString() const;
+
+  private:
+    CifReaderPrivate * const d;
+  };
+
+} // End namespace Avogadro
+
+#endif
@@ -0,0 +1,275 @@
+/**********************************************************************
+  AttributeColor - Color atoms by a per atom attribute column
+
+  Copyright (C) 2013 Avogadro Developers
+
+  This file is part of the Avogadro molecular editor project.
+  For more information, see <http://avogadro.cc/>
+
+  Avogadro is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  Avogadro is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+  02110-1301, USA.
+ **********************************************************************/
+
+#include "attributecolor.h"
+
+#include <avogadro/primitive.h>
+#include <avogadro/molecule.h>
+#include <avogadro/atom.h>
+
+#include <QtPlugin>
+#include <QtCore/QHash>
+#include <QtCore/QSettings>
+
+#include <openbabel/mol.h>
+
+#include <limits>
+
+namespace Avogadro {
+
+  namespace {
+    /**
+     * The color of @a t, from 0 to 1, in @a palette.
+     */
+    Color3f paletteColor(int palette, double t)
+    {
+      if (t < 0.0)
+        t = 0.0;
+      else if (t > 1.0)
+        t = 1.0;
+
+      switch (palette) {
+      case AttributeColor::Rainbow:
+        // Blue through cyan, green and yellow to red
+        if (t < 0.25)
+          return Color3f(0.0f, float(4.0 * t), 1.0f);
+        else if (t < 0.5)
+          return Color3f(0.0f, 1.0f, float(1.0 - 4.0 * (t - 0.25)));
+        else if (t < 0.75)
+          return Color3f(float(4.0 * (t - 0.5)), 1.0f, 0.0f);
+        return Color3f(1.0f, float(1.0 - 4.0 * (t - 0.75)), 0.0f);
+      case AttributeColor::Grayscale:
+        return Color3f(float(t), float(t), float(t));
+      case AttributeColor::BlueWhiteRed:
+      default:
+        if (t < 0.5)
+          return Color3f(float(2.0 * t), float(2.0 * t), 1.0f);
+        return Color3f(1.0f, float(2.0 * (1.0 - t)), float(2.0 * (1.0 - t)));
+      }
+    }
+  }
+
+  AttributeColor::AttributeColor() : m_settingsWidget(0),
+    m_attribute("bfactor"), m_palette(BlueWhiteRed), m_autoRange(true),
+    m_min(0.0), m_max(1.0), m_revision(0), m_valid(false)
+  { }
+
+  AttributeColor::~AttributeColor()
+  {
+    if (m_settingsWidget)
+      m_settingsWidget->deleteLater();
+  }
+
+  void AttributeColor::setFromPrimitive(const Primitive *p)
+  {
+    if (!p || p->type() != Primitive::AtomType)
+      return;
+
+    const Atom *atom = static_cast<const Atom*>(p);
+    Molecule *molecule = atom->molecule();
+    if (!molecule)
+      return;
+
+    if (!m_valid || m_molecule != molecule
+        || m_revision != molecule->atomAttributeRevision())
+      updateColors(molecule);
+
+    const unsigned int index = atom->index();
+    if (index < m_colors.size() && m_hasValue[index]) {
+      const Color3f &color = m_colors[index];
+      m_channels[0] = color.red();
+      m_channels[1] = color.green();
+      m_channels[2] = color.blue();
+    } else {
+      std::vector<double> rgb = OpenBabel::etab.GetRGB(atom->atomicNumber());
+      m_channels[0] = rgb[0];
+      m_channels[1] = rgb[1];
+      m_channels[2] = rgb[2];
+    }
+    m_channels[3] = 1.0;
+  }
+
+  void AttributeColor::updateColors(Molecule *molecule)
+  {
+    m_molecule = molecule;
+    m_revision = molecule->atomAttributeRevision();
+    m_valid = true;
+
+    const int numAtoms = molecule->numAtoms();
+    m_colors.assign(numAtoms, Color3f());
+    m_hasValue.assign(numAtoms, false);
+
+    switch (molecule->atomAttributeType(m_attribute)) {
+    case Molecule::FloatAttribute:
+    case Molecule::IntAttribute: {
+      std::vector<double> values;
+      if (molecule->atomAttributeType(m_attribute) == Molecule::IntAttribute) {
+        const std::vector<int> &ints = molecule->atomIntAttribute(m_attribute);
+        values.assign(ints.begin(), ints.end());
+      } else {
+        values = molecule->atomFloatAttribute(m_attribute);
+      }
+      if (values.empty())
+        return;
+
+      double lo = m_min;
+      double hi = m_max;
+      if (m_autoRange) {
+        lo = std::numeric_limits<double>::max();
+        hi = -lo;
+        for (size_t i = 0; i < values.size(); ++i) {
+          if (values[i] < lo)
+            lo = values[i];
+          if (values[i] > hi)
+            hi = values[i];
+        }
+      }
+      const double scale = hi > lo ? 1.0 / (hi - lo) : 0.0;
+      for (size_t i = 0; i < values.size(); ++i) {
+        // A constant column is drawn with the middle of the palette
+        const double t = scale > 0.0 ? (values[i] - lo) * scale : 0.5;
+        m_colors[i] = paletteColor(m_palette, t);
+        m_hasValue[i] = true;
+      }
+      break;
+    }
+    case Molecule::StringAttribute: {
+      // One color per distinct value, spread evenly over the palette
+      const QStringList &strings = molecule->atomStringAttribute(m_attribute);
+      QHash<QString, int> categories;
+      std::vector<int> category(strings.size(), -1);
+      for (int i = 0; i < strings.size(); ++i) {
+        if (strings.at(i).isEmpty())
+          continue;
+        QHash<QString, int>::const_iterator it =
+            categories.constFind(strings.at(i));
+        if (it == categories.constEnd())
+          it = categories.insert(strings.at(i), categories.size());
+        category[i] = it.value();
+      }
+      const double scale = categories.size() > 1 ?
+          1.0 / (categories.size() - 1) : 0.0;
+      for (int i = 0; i < strings.size(); ++i) {
+        if (category[i] < 0)
+          continue;
+        m_colors[i] = paletteColor(m_palette, category[i] * scale);
+        m_hasValue[i] = true;
+      }
+      break;
+    }
+    default:
+      break;
+    }
+  }
+
+  void AttributeColor::invalidate()
+  {
+    m_valid = false;
+    emit changed();
+  }
+
+  void AttributeColor::settingsWidgetDestroyed()
+  {
+    m_settingsWidget = 0;
+  }
+
+  void AttributeColor::setAttribute()
+  {
+    if (!m_settingsWidget)
+      return;
+    m_attribute = m_settingsWidget->attributeEdit->text().trimmed();
+    invalidate();
+  }
+
+  void AttributeColor::setPalette(int palette)
+  {
+    m_palette = palette;
+    invalidate();
+  }
+
+  void AttributeColor::setRange()
+  {
+    if (!m_settingsWidget)
+      return;
+    m_autoRange = m_settingsWidget->autoRangeCheck->isChecked();
+    m_min = m_settingsWidget->minSpin->value();
+    m_max = m_settingsWidget->maxSpin->value();
+    m_settingsWidget->minSpin->setEnabled(!m_autoRange);
+    m_settingsWidget->maxSpin->setEnabled(!m_autoRange);
+    invalidate();
+  }
+
+  QWidget *AttributeColor::settingsWidget()
+  {
+    if (!m_settingsWidget) {
+      m_settingsWidget = new AttributeColorSettingsWidget();
+      m_settingsWidget->attributeEdit->setText(m_attribute);
+      m_settingsWidget->paletteComboBox->setCurrentIndex(m_palette);
+      m_settingsWidget->autoRangeCheck->setChecked(m_autoRange);
+      m_settingsWidget->minSpin->setValue(m_min);
+      m_settingsWidget->maxSpin->setValue(m_max);
+      m_settingsWidget->minSpin->setEnabled(!m_autoRange);
+      m_settingsWidget->maxSpin->setEnabled(!m_autoRange);
+      connect(m_settingsWidget->attributeEdit, SIGNAL(editingFinished()),
+              this, SLOT(setAttribute()));
+      connect(m_settingsWidget->paletteComboBox,
+              SIGNAL(currentIndexChanged(int)),
+              this, SLOT(setPalette(int)));
+      connect(m_settingsWidget->autoRangeCheck, SIGNAL(toggled(bool)),
+              this, SLOT(setRange()));
+      connect(m_settingsWidget->minSpin, SIGNAL(valueChanged(double)),
+              this, SLOT(setRange()));
+      connect(m_settingsWidget->maxSpin, SIGNAL(valueChanged(double)),
+              this, SLOT(setRange()));
+      connect(m_settingsWidget, SIGNAL(destroyed()),
+              this, SLOT(settingsWidgetDestroyed()));
+    }
+
+    return m_settingsWidget;
+  }
+
+  void AttributeColor::writeSettings(QSettings &settings) const
+  {
+    Color::writeSettings(settings);
+    settings.setValue("attribute", m_attribute);
+    settings.setValue("palette", m_palette);
+    settings.setValue("autoRange", m_autoRange);
+    settings.setValue("min", m_min);
+    settings.setValue("max", m_max);
+  }
+
+  void AttributeColor::readSettings(QSettings &settings)
+  {
+    Color::readSettings(settings);
+    m_attribute = settings.value("attribute", "bfactor").toString();
+    m_palette = settings.value("palette", BlueWhiteRed).toInt();
+    m_autoRange = settings.value("autoRange", true).toBool();
+    m_min = settings.value("min", 0.0).toDouble();
+    m_max = settings.value("max", 1.0).toDouble();
+    m_valid = false;
+  }
+
+}
+
+Q_EXPORT_PLUGIN2(attributecolor, Avogadro::AttributeColorFactory)
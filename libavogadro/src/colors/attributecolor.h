@@ -0,0 +1,127 @@
+/**********************************************************************
+  AttributeColor - Color atoms by a per atom attribute column
+
+  Copyright (C) 2013 Avogadro Developers
+
+  This file is part of the Avogadro molecular editor project.
+  For more information, see <http://avogadro.cc/>
+
+  Avogadro is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  Avogadro is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+  02110-1301, USA.
+ **********************************************************************/
+
+#ifndef ATTRIBUTECOLOR_H
+#define ATTRIBUTECOLOR_H
+
+#include <avogadro/global.h>
+#include <avogadro/plugin.h>
+#include <avogadro/color.h>
+#include <avogadro/color3f.h>
+
+#include <QPointer>
+
+#include <vector>
+
+#include "ui_attributecolorsettings.h"
+
+namespace Avogadro {
+
+  class Molecule;
+  class AttributeColorSettingsWidget;
+
+  /**
+   * @class AttributeColor
+   * @brief Color atoms by a named attribute column of the molecule
+   *
+   * Maps a column set with Molecule::setAtomAttribute() through a palette.
+   * Numbers are scaled between the smallest and largest value, or a fixed
+   * range, strings get one color per distinct value. The colors of all the
+   * atoms are computed in one pass and kept until the columns or atoms of
+   * the molecule change, atoms without a value are colored by element.
+   */
+  class AttributeColor: public Color
+  {
+    Q_OBJECT
+    AVOGADRO_COLOR("AttributeColor", tr("Color by Attribute"),
+                   tr("Color by a per atom attribute, such as B-factors."))
+
+  public:
+    enum Palette {
+      BlueWhiteRed = 0,
+      Rainbow,
+      Grayscale
+    };
+
+    AttributeColor();
+    virtual ~AttributeColor();
+
+    /**
+     * Set the color based on the supplied Primitive
+     * If NULL is passed, do nothing */
+    void setFromPrimitive(const Primitive *);
+
+    QWidget *settingsWidget();
+
+    void writeSettings(QSettings &settings) const;
+    void readSettings(QSettings &settings);
+
+  private Q_SLOTS:
+    void settingsWidgetDestroyed();
+    void setAttribute();
+    void setPalette(int palette);
+    void setRange();
+
+  private:
+    /**
+     * Compute the colors of all the atoms of @a molecule.
+     */
+    void updateColors(Molecule *molecule);
+    void invalidate();
+
+    AttributeColorSettingsWidget *m_settingsWidget;
+    QString m_attribute;
+    int m_palette;
+    bool m_autoRange;
+    double m_min;
+    double m_max;
+
+    // The colors by atom index, and what they were computed from
+    std::vector<Color3f> m_colors;
+    std::vector<bool> m_hasValue;
+    QPointer<Molecule> m_molecule;
+    unsigned long m_revision;
+    bool m_valid;
+  };
+
+  class AttributeColorSettingsWidget :
+    public QWidget,
+    public Ui::AttributeColorSettings
+  {
+    public:
+      AttributeColorSettingsWidget(QWidget *parent=0) : QWidget(parent) {
+        setupUi(this);
+      }
+  };
+
+  class AttributeColorFactory : public QObject, public PluginFactory
+  {
+    Q_OBJECT
+    Q_INTERFACES(Avogadro::PluginFactory)
+    AVOGADRO_COLOR_FACTORY(AttributeColor)
+  };
+
+}
+
+#endif
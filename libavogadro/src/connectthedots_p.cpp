@@ -0,0 +1,155 @@
+/**********************************************************************
+  ConnectTheDots - Bonds from interatomic distances
+
+  Copyright (C) 2013 Avogadro Developers
+
+  This file is part of the Avogadro molecular editor project.
+  For more information, see <http://avogadro.cc/>
+
+  Avogadro is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  Avogadro is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+  02110-1301, USA.
+ **********************************************************************/
+
+#include "connectthedots_p.h"
+
+#include <avogadro/molecule.h>
+#include <avogadro/atom.h>
+#include <avogadro/bond.h>
+
+#include <openbabel/data.h>
+
+#include <Eigen/Core>
+#include <Eigen/Geometry>
+#include <Eigen/LU>
+
+#include <QHash>
+
+#include <cmath>
+#include <vector>
+
+using Eigen::Matrix3d;
+using Eigen::Vector3d;
+using Eigen::Vector3i;
+
+namespace Avogadro {
+
+  static inline qint64 cellKey(int x, int y, int z)
+  {
+    return (qint64(x) * 2097152 + y) * 2097152 + z;
+  }
+
+  static void connectPeriodic(Molecule *molecule, const QList<Atom *> &list,
+                              const std::vector<double> &radii, double edge,
+                              const Matrix3d &cell)
+  {
+    const Matrix3d inverse = cell.inverse();
+    const int n = list.size();
+
+    // Fractional coordinates in [0, 1), sorted into at least edge wide
+    // cells along each axis
+    const double volume = std::abs(cell.determinant());
+    Vector3i dims;
+    for (int k = 0; k < 3; ++k) {
+      const double width = volume / cell.col((k + 1) % 3).cross(cell.col((k + 2) % 3)).norm();
+      dims[k] = qMax(1, static_cast<int>(std::floor(width / edge)));
+    }
+    std::vector<Vector3d> fractional(n);
+    std::vector<Vector3i> cellOf(n);
+    for (int i = 0; i < n; ++i) {
+      Vector3d f = inverse * *list.at(i)->pos();
+      for (int k = 0; k < 3; ++k) {
+        f[k] -= std::floor(f[k]);
+        cellOf[i][k] = qMin(dims[k] - 1, static_cast<int>(f[k] * dims[k]));
+      }
+      fractional[i] = f;
+    }
+
+    // With less than three cells along an axis the neighbors would be
+    // visited more than once, compare all pairs instead
+    const bool allPairs = dims[0] < 3 || dims[1] < 3 || dims[2] < 3;
+    QHash<qint64, int> first;
+    std::vector<int> next(n, -1);
+    for (int i = 0; i < n; ++i) {
+      const Vector3i &c = cellOf[i];
+      const int range = allPairs ? 0 : 1;
+      for (int dx = -range; dx <= range; ++dx)
+        for (int dy = -range; dy <= range; ++dy)
+          for (int dz = -range; dz <= range; ++dz) {
+            const qint64 key = allPairs ? 0 :
+              cellKey((c[0] + dx + dims[0]) % dims[0], (c[1] + dy + dims[1]) % dims[1],
+                      (c[2] + dz + dims[2]) % dims[2]);
+            for (int j = first.value(key, -1); j >= 0; j = next[j]) {
+              Vector3d delta = fractional[j] - fractional[i];
+              for (int k = 0; k < 3; ++k)
+                delta[k] -= std::floor(delta[k] + 0.5);
+              const double cutoff = radii[i] + radii[j] + 0.45;
+              const double d2 = (cell * delta).squaredNorm();
+              if (d2 > 0.16 && d2 < cutoff * cutoff)
+                molecule->addBond(list.at(j), list.at(i), 1);
+            }
+          }
+      const qint64 key = allPairs ? 0 : cellKey(c[0], c[1], c[2]);
+      next[i] = first.value(key, -1);
+      first.insert(key, i);
+    }
+  }
+
+  void connectTheDots(Molecule *molecule, const Matrix3d *cell)
+  {
+    const QList<Atom *> list = molecule->atoms();
+    if (list.size() < 2)
+      return;
+    std::vector<double> radii(list.size());
+    double maxRadius = 0.0;
+    Vector3d min = *list.first()->pos();
+    for (int i = 0; i < list.size(); ++i) {
+      radii[i] = OpenBabel::etab.GetCovalentRad(list.at(i)->atomicNumber());
+      maxRadius = qMax(maxRadius, radii[i]);
+      min = min.cwiseMin(*list.at(i)->pos());
+    }
+    const double edge = 2.0 * maxRadius + 0.45;
+
+    if (cell && std::abs(cell->determinant()) > 1.0e-8) {
+      connectPeriodic(molecule, list, radii, edge, *cell);
+      return;
+    }
+
+    // One empty cell below the smallest index, so the neighbors are >= 0
+    min.array() -= edge;
+    QHash<qint64, int> first;
+    std::vector<int> next(list.size(), -1);
+    for (int i = 0; i < list.size(); ++i) {
+      const Vector3d pos = *list.at(i)->pos();
+      const Vector3i index(static_cast<int>((pos.x() - min.x()) / edge),
+                           static_cast<int>((pos.y() - min.y()) / edge),
+                           static_cast<int>((pos.z() - min.z()) / edge));
+      for (int dx = -1; dx <= 1; ++dx)
+        for (int dy = -1; dy <= 1; ++dy)
+          for (int dz = -1; dz <= 1; ++dz) {
+            const qint64 key = cellKey(index.x() + dx, index.y() + dy, index.z() + dz);
+            for (int j = first.value(key, -1); j >= 0; j = next[j]) {
+              const double cutoff = radii[i] + radii[j] + 0.45;
+              const double d2 = (*list.at(j)->pos() - pos).squaredNorm();
+              if (d2 > 0.16 && d2 < cutoff * cutoff)
+                molecule->addBond(list.at(j), list.at(i), 1);
+            }
+          }
+      const qint64 key = cellKey(index.x(), index.y(), index.z());
+      next[i] = first.value(key, -1);
+      first.insert(key, i);
+    }
+  }
+
+} // End namespace Avogadro
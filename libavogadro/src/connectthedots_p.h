@@ -0,0 +1,49 @@
+/**********************************************************************
+  ConnectTheDots - Bonds from interatomic distances
+
+  Copyright (C) 2013 Avogadro Developers
+
+  This file is part of the Avogadro molecular editor project.
+  For more information, see <http://avogadro.cc/>
+
+  Avogadro is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  Avogadro is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+  02110-1301, USA.
+ **********************************************************************/
+
+#ifndef CONNECTTHEDOTS_P_H
+#define CONNECTTHEDOTS_P_H
+
+#include <Eigen/Core>
+
+namespace Avogadro {
+
+  class Molecule;
+
+  /**
+   * @internal
+   * Add single bonds between the atoms of @p molecule closer than the sum
+   * of their covalent radii plus 0.45 A, the criterion of
+   * OpenBabel::OBMol::ConnectTheDots(). The atoms are sorted into a cell
+   * list so large structures are bonded in linear time.
+   *
+   * If @p cell is given (cell vectors as columns) the distances are taken
+   * between the nearest periodic images, so atoms bonded across a face of
+   * the cell are found as well.
+   */
+  void connectTheDots(Molecule *molecule, const Eigen::Matrix3d *cell = 0);
+
+} // End namespace Avogadro
+
+#endif
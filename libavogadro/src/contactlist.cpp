@@ -0,0 +1,340 @@
+/**********************************************************************
+  ContactList - Incrementally updated list of close atom contacts
+
+  Copyright (C) 2013 Avogadro Developers
+
+  This file is part of the Avogadro molecular editor project.
+  For more information, see <http://avogadro.cc/>
+
+  Avogadro is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  Avogadro is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+  02110-1301, USA.
+ **********************************************************************/
+
+#include "contactlist.h"
+
+#include "molecule.h"
+#include "moleculesnapshot.h"
+
+#include <openbabel/mol.h>
+
+#include <QtCore/QHash>
+#include <QtCore/QPointer>
+#include <QtCore/QVector>
+
+#include <algorithm>
+#include <cmath>
+
+namespace Avogadro {
+
+  using Eigen::Vector3d;
+
+  namespace {
+    // 21 bits per cell coordinate, offset so that negative cells fit
+    const qint64 CellOffset = 1 << 20;
+
+    inline quint64 packCell(qint64 i, qint64 j, qint64 k)
+    {
+      return (quint64(i + CellOffset) << 42) | (quint64(j + CellOffset) << 21)
+          | quint64(k + CellOffset);
+    }
+  }
+
+  class ContactListPrivate
+  {
+  public:
+    ContactListPrivate() : fraction(0.8), valid(false), cellSize(1.0),
+      maxRadius(0.0)
+    {
+    }
+
+    /**
+     * Find everything again in @a current.
+     */
+    void rebuild(const MoleculeSnapshot &current);
+
+    /**
+     * Find the contacts of atom @a i, a pair with another flagged atom is
+     * only added by the one with the lower index.
+     */
+    void findContacts(unsigned int i);
+
+    /**
+     * @return True if atoms @a i and @a j are bonded or bonded to a common
+     * atom.
+     */
+    bool excluded(unsigned int i, unsigned int j) const;
+
+    quint64 cellKey(const Vector3d &pos) const
+    {
+      return packCell(qint64(std::floor(pos.x() / cellSize)),
+                      qint64(std::floor(pos.y() / cellSize)),
+                      qint64(std::floor(pos.z() / cellSize)));
+    }
+
+    void insert(unsigned int i, quint64 key)
+    {
+      cellKeys[i] = key;
+      cells[key].append(i);
+    }
+
+    void remove(unsigned int i)
+    {
+      QHash<quint64, QVector<unsigned int> >::iterator cell =
+          cells.find(cellKeys[i]);
+      if (cell == cells.end())
+        return;
+      const int position = cell->indexOf(i);
+      if (position >= 0) {
+        (*cell)[position] = cell->last();
+        cell->remove(cell->size() - 1);
+      }
+      if (cell->isEmpty())
+        cells.erase(cell);
+    }
+
+    QPointer<Molecule> molecule;
+    double fraction;
+    bool valid;
+
+    MoleculeSnapshot snapshot;
+    std::vector<ContactList::Contact> contacts;
+
+    // Per atom, by index
+    std::vector<double> radii;
+    std::vector<quint64> cellKeys;
+    std::vector<std::vector<unsigned int> > bonded;
+    std::vector<bool> flagged;
+
+    QHash<quint64, QVector<unsigned int> > cells;
+    double cellSize;
+    double maxRadius;
+  };
+
+  bool ContactListPrivate::excluded(unsigned int i, unsigned int j) const
+  {
+    const std::vector<unsigned int> &first = bonded[i];
+    for (size_t a = 0; a < first.size(); ++a) {
+      const unsigned int k = first[a];
+      if (k == j)
+        return true;
+      const std::vector<unsigned int> &second = bonded[k];
+      if (std::find(second.begin(), second.end(), j) != second.end())
+        return true;
+    }
+    return false;
+  }
+
+  void ContactListPrivate::findContacts(unsigned int i)
+  {
+    const double radius = radii[i];
+    if (radius <= 0.0)
+      return;
+
+    const Vector3d &pos = snapshot.atomPos(i);
+    const qint64 ci = qint64(std::floor(pos.x() / cellSize));
+    const qint64 cj = qint64(std::floor(pos.y() / cellSize));
+    const qint64 ck = qint64(std::floor(pos.z() / cellSize));
+    for (qint64 di = -1; di <= 1; ++di) {
+      for (qint64 dj = -1; dj <= 1; ++dj) {
+        for (qint64 dk = -1; dk <= 1; ++dk) {
+          QHash<quint64, QVector<unsigned int> >::const_iterator cell =
+              cells.constFind(packCell(ci + di, cj + dj, ck + dk));
+          if (cell == cells.constEnd())
+            continue;
+          foreach (unsigned int j, *cell) {
+            if (j == i || (flagged[j] && j < i) || radii[j] <= 0.0)
+              continue;
+            const double sum = radius + radii[j];
+            const double cutoff = fraction * sum;
+            const double r2 = (snapshot.atomPos(j) - pos).squaredNorm();
+            if (r2 >= cutoff * cutoff || excluded(i, j))
+              continue;
+            ContactList::Contact contact;
+            contact.first = qMin(i, j);
+            contact.second = qMax(i, j);
+            contact.distance = std::sqrt(r2);
+            contact.ratio = contact.distance / sum;
+            contacts.push_back(contact);
+          }
+        }
+      }
+    }
+  }
+
+  void ContactListPrivate::rebuild(const MoleculeSnapshot &current)
+  {
+    snapshot = current;
+    valid = true;
+    contacts.clear();
+    cells.clear();
+
+    const unsigned int numAtoms = snapshot.numAtoms();
+    radii.resize(numAtoms);
+    maxRadius = 0.0;
+    for (unsigned int i = 0; i < numAtoms; ++i) {
+      radii[i] = OpenBabel::etab.GetVdwRad(snapshot.atomicNumber(i));
+      maxRadius = qMax(maxRadius, radii[i]);
+    }
+    // The cells are as large as the longest contact, so only the 27 cells
+    // around an atom need to be searched
+    cellSize = qMax(2.0 * fraction * maxRadius, 0.5);
+
+    bonded.assign(numAtoms, std::vector<unsigned int>());
+    for (unsigned int b = 0; b < snapshot.numBonds(); ++b) {
+      const unsigned int begin = snapshot.bondBeginIndex(b);
+      const unsigned int end = snapshot.bondEndIndex(b);
+      if (begin >= numAtoms || end >= numAtoms)
+        continue;
+      bonded[begin].push_back(end);
+      bonded[end].push_back(begin);
+    }
+
+    cellKeys.resize(numAtoms);
+    cells.reserve(numAtoms / 4);
+    for (unsigned int i = 0; i < numAtoms; ++i)
+      insert(i, cellKey(snapshot.atomPos(i)));
+
+    flagged.assign(numAtoms, true);
+    for (unsigned int i = 0; i < numAtoms; ++i)
+      findContacts(i);
+    flagged.assign(numAtoms, false);
+  }
+
+  ContactList::ContactList(const Molecule *molecule)
+    : d(new ContactListPrivate)
+  {
+    setMolecule(molecule);
+  }
+
+  ContactList::~ContactList()
+  {
+    delete d;
+  }
+
+  void ContactList::setMolecule(const Molecule *molecule)
+  {
+    d->molecule = const_cast<Molecule *>(molecule);
+    d->valid = false;
+  }
+
+  const Molecule * ContactList::molecule() const
+  {
+    return d->molecule;
+  }
+
+  void ContactList::setFraction(double fraction)
+  {
+    if (fraction != d->fraction) {
+      d->fraction = fraction;
+      d->valid = false;
+    }
+  }
+
+  double ContactList::fraction() const
+  {
+    return d->fraction;
+  }
+
+  bool ContactList::update()
+  {
+    if (!d->molecule) {
+      const bool changed = !d->contacts.empty();
+      d->contacts.clear();
+      d->cells.clear();
+      d->snapshot = MoleculeSnapshot();
+      d->valid = false;
+      return changed;
+    }
+
+    const MoleculeSnapshot current = d->molecule->snapshot();
+    if (d->valid && current.version() == d->snapshot.version())
+      return false;
+    // New or removed atoms and bonds change the indices and exclusions
+    if (!d->valid || current.numAtoms() != d->snapshot.numAtoms()
+        || !current.sharesBonds(d->snapshot)) {
+      d->rebuild(current);
+      return true;
+    }
+
+    // Only the chunks not shared with the last snapshot can hold atoms that
+    // moved or changed element
+    std::vector<unsigned int> moved;
+    const unsigned int numAtoms = current.numAtoms();
+    for (unsigned int first = 0; first < numAtoms;
+         first += MoleculeSnapshot::ChunkSize) {
+      if (current.sharesAtom(d->snapshot, first))
+        continue;
+      const unsigned int last = qMin(first + MoleculeSnapshot::ChunkSize,
+                                     numAtoms);
+      for (unsigned int i = first; i < last; ++i) {
+        if (current.atomPos(i) != d->snapshot.atomPos(i)
+            || current.atomicNumber(i) != d->snapshot.atomicNumber(i))
+          moved.push_back(i);
+      }
+    }
+
+    if (moved.empty()) {
+      d->snapshot = current;
+      return false;
+    }
+
+    // A larger atom than any before needs larger cells
+    foreach (unsigned int i, moved) {
+      if (current.atomicNumber(i) != d->snapshot.atomicNumber(i)) {
+        d->radii[i] = OpenBabel::etab.GetVdwRad(current.atomicNumber(i));
+        if (d->radii[i] > d->maxRadius) {
+          d->rebuild(current);
+          return true;
+        }
+      }
+    }
+
+    d->snapshot = current;
+    foreach (unsigned int i, moved) {
+      d->flagged[i] = true;
+      const quint64 key = d->cellKey(current.atomPos(i));
+      if (key != d->cellKeys[i]) {
+        d->remove(i);
+        d->insert(i, key);
+      }
+    }
+
+    // Drop the contacts of the moved atoms and search them again
+    std::vector<Contact> &contacts = d->contacts;
+    size_t kept = 0;
+    for (size_t c = 0; c < contacts.size(); ++c) {
+      if (!d->flagged[contacts[c].first] && !d->flagged[contacts[c].second])
+        contacts[kept++] = contacts[c];
+    }
+    contacts.resize(kept);
+    foreach (unsigned int i, moved)
+      d->findContacts(i);
+
+    foreach (unsigned int i, moved)
+      d->flagged[i] = false;
+    return true;
+  }
+
+  const std::vector<ContactList::Contact> & ContactList::contacts() const
+  {
+    return d->contacts;
+  }
+
+  const MoleculeSnapshot & ContactList::snapshot() const
+  {
+    return d->snapshot;
+  }
+
+} // End namespace Avogadro
@@ -0,0 +1,116 @@
+/**********************************************************************
+  ContactList - Incrementally updated list of close atom contacts
+
+  Copyright (C) 2013 Avogadro Developers
+
+  This file is part of the Avogadro molecular editor project.
+  For more information, see <http://avogadro.cc/>
+
+  Avogadro is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  Avogadro is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+  02110-1301, USA.
+ **********************************************************************/
+
+#ifndef CONTACTLIST_H
+#define CONTACTLIST_H
+
+#include <avogadro/global.h>
+
+#include <vector>
+
+namespace Avogadro {
+
+  class Molecule;
+  class MoleculeSnapshot;
+  class ContactListPrivate;
+
+  /**
+   * @class ContactList contactlist.h <avogadro/contactlist.h>
+   * @brief Finds the pairs of atoms closer than a fraction of the sum of
+   * their van der Waals radii, e.g. steric clashes.
+   *
+   * Atoms bonded to each other (1-2) or to a common atom (1-3) are not
+   * contacts. The atoms are kept in a grid of cells as large as the longest
+   * contact distance. update() compares the molecule with the snapshot of
+   * the previous call, only the atoms that moved are moved between cells
+   * and only their contacts are searched again. Dragging a few atoms of a
+   * large molecule is therefore cheap, adding or removing atoms or bonds
+   * rebuilds the list.
+   *
+   * @code
+   * ContactList contacts(molecule);
+   * contacts.setFraction(0.7);
+   * contacts.update();
+   * foreach (const ContactList::Contact &contact, contacts.contacts())
+   *   qDebug() << contact.first << contact.second << contact.distance;
+   * @endcode
+   */
+  class A_EXPORT ContactList
+  {
+  public:
+    /**
+     * A pair of atoms in contact, by index in Molecule::atoms().
+     */
+    struct Contact
+    {
+      unsigned int first;
+      unsigned int second;
+      double distance;
+      /// The distance divided by the sum of the van der Waals radii
+      double ratio;
+    };
+
+    explicit ContactList(const Molecule *molecule = 0);
+    ~ContactList();
+
+    /**
+     * Find the contacts of @p molecule, the list is rebuilt on the next
+     * update().
+     */
+    void setMolecule(const Molecule *molecule);
+    const Molecule * molecule() const;
+
+    /**
+     * Pairs closer than @p fraction of the sum of their van der Waals radii
+     * are in contact, the default is 0.8.
+     */
+    void setFraction(double fraction);
+    double fraction() const;
+
+    /**
+     * Bring the contacts up to date with the molecule.
+     * @return True if the contacts changed.
+     */
+    bool update();
+
+    /**
+     * @return The contacts found by the last update(), in no particular
+     * order.
+     */
+    const std::vector<Contact> & contacts() const;
+
+    /**
+     * @return The snapshot of the molecule the contacts were found in, the
+     * atom indices of the contacts refer to it.
+     */
+    const MoleculeSnapshot & snapshot() const;
+
+  private:
+    Q_DISABLE_COPY(ContactList)
+    ContactListPrivate * const d;
+  };
+
+} // End namespace Avogadro
+
+#endif
@@ -40,7 +40,7 @@ namespace Avogadro {
   Cube::Cube(QObject *parent) : Primitive(CubeType, parent), m_data(0),
     m_min(0.0, 0.0, 0.0), m_max(0.0, 0.0, 0.0), m_spacing(0.0, 0.0, 0.0),
     m_points(0, 0, 0), m_minValue(0.0), m_maxValue(0.0),
-    m_lock(new QReadWriteLock)
+    m_refinedIsoValue(0.0), m_lock(new QReadWriteLock)
   {
   }
 
@@ -153,6 +153,7 @@ namespace Avogadro {
     }
     if (static_cast<int>(values.size()) == m_points.x() * m_points.y() * m_points.z()) {
       m_data = values;
+      m_refinedIsoValue = 0.0;
       qDebug() << "Loaded in cube data" << m_data.size();
       // Now to update the minimum and maximum values
       m_minValue = m_maxValue = m_data[0];
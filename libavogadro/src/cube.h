@@ -66,7 +66,8 @@ namespace Avogadro {
       ElectronDensity,
       MO,
       FromFile,
-      None
+      None,
+      SolventExcluded
     };
 
    /**
@@ -226,6 +227,22 @@ namespace Avogadro {
     void setCubeType(Type type) { m_cubeType = type; }
     Type cubeType() { return m_cubeType; }
 
+    /**
+     * Cubes calculated on an adaptive grid (see OpenQube::AdaptiveGrid) are
+     * only evaluated near the isosurfaces at +/- @p isoValue. The other
+     * points are interpolated from the evaluated ones, so the cube is an
+     * approximation. It should not be contoured at any other isovalue or
+     * used for analysis, and it is not exported by Molecule::OBMol(). Reset
+     * to 0 by setData().
+     */
+    void setRefinedIsoValue(double isoValue) { m_refinedIsoValue = isoValue; }
+
+    /**
+     * @return The isovalue the data was refined for, 0 if every point was
+     * evaluated.
+     */
+    double refinedIsoValue() const { return m_refinedIsoValue; }
+
     /**
      * Provides locking.
      */
@@ -238,6 +255,7 @@ namespace Avogadro {
     Eigen::Vector3d m_min, m_max, m_spacing;
     Eigen::Vector3i m_points;
     double m_minValue, m_maxValue;
+    double m_refinedIsoValue;
     QString m_name;
     Type    m_cubeType;
     QReadWriteLock *m_lock;
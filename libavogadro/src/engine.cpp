@@ -170,6 +170,25 @@ namespace Avogadro {
     emit changed();
   }
 
+  void Engine::addPrimitives(const PrimitiveList &primitives)
+  {
+    // Without custom primitives the atoms and bonds come straight from the
+    // molecule. The atoms and bonds are new to the molecule, so there is no
+    // need to check for duplicates.
+    if (m_customPrims) {
+      foreach (Primitive *p, primitives.subList(Primitive::AtomType))
+        m_atoms.append(static_cast<Atom *>(p));
+      foreach (Primitive *p, primitives.subList(Primitive::BondType))
+        m_bonds.append(static_cast<Bond *>(p));
+    }
+    foreach (Primitive *p, primitives.list()) {
+      if (p->type() != Primitive::AtomType && p->type() != Primitive::BondType
+          && !m_primitives.contains(p))
+        m_primitives.append(p);
+    }
+    emit changed();
+  }
+
   void Engine::addAtom(Atom *a)
   {
     if (m_customPrims) {
@@ -373,6 +392,8 @@ namespace Avogadro {
     // Now listen to the molecule
     connect(m_molecule, SIGNAL(atomAdded(Atom*)),
             this, SLOT(addAtom(Atom*)));
+    connect(m_molecule, SIGNAL(primitivesAdded(PrimitiveList)),
+            this, SLOT(addPrimitives(PrimitiveList)));
     connect(m_molecule, SIGNAL(atomRemoved(Atom*)),
             this, SLOT(removeAtom(Atom*)));
     connect(m_molecule, SIGNAL(bondAdded(Bond*)),
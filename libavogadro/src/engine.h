@@ -438,6 +438,15 @@ namespace Avogadro {
        */
       virtual void addPrimitive(Primitive *primitive);
 
+      /**
+       * Add primitives added to the Molecule in bulk to the engines lists and
+       * emit changed(). Atoms and bonds are only added to the lists of
+       * engines using custom primitives, the others see them through the
+       * Molecule.
+       * @param primitives to be added to the atom, bond and PrimitiveList.
+       */
+      void addPrimitives(const PrimitiveList &primitives);
+
       /**
        * Update the primitive in the engines PrimitiveList.
        * @param primitive to be updated in the PrimitiveList.
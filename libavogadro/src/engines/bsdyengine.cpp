@@ -104,7 +104,8 @@ namespace Avogadro
   BSDYEngine::BSDYEngine(QObject *parent) : Engine(parent),
       m_settingsWidget(0), m_atomRadiusPercentage(0.3), m_atomRadiusScale(50.0),
       m_bondRadius(0.1), m_bondRadiusScale(40.0),
-      m_atomRadiusType(1), m_showMulti(2), m_alpha(1.), pRadius(radiusVdW)
+      m_atomRadiusType(1), m_showMulti(2), m_alpha(1.),
+      m_radiusAttribute("radius"), pRadius(radiusVdW)
   {  }
 
   Engine *BSDYEngine::clone() const
@@ -116,6 +117,7 @@ namespace Avogadro
     engine->m_showMulti = m_showMulti;
     engine->m_atomRadiusType = m_atomRadiusType;
     engine->m_alpha = m_alpha;
+    engine->m_radiusAttribute = m_radiusAttribute;
     engine->setEnabled(isEnabled());
 
     return engine;
@@ -149,8 +151,8 @@ namespace Avogadro
         continue;
       }
 
-      Vector3d v1(*atom1->pos());
-      Vector3d v2(*atom2->pos());
+      Vector3d v1(*pd->atomPos(atom1));
+      Vector3d v2(*pd->atomPos(atom2));
       Vector3d d = v2 - v1;
       d.normalize();
       Vector3d v3((v1 + v2 + d*(radius(atom1) - radius(atom2))) / 2);
@@ -185,7 +187,7 @@ namespace Avogadro
         pd->painter()->setColor( map );
       else
         pd->painter()->setColor(a->customColorName());
-      pd->painter()->drawSphere(a->pos(), radius(a));
+      pd->painter()->drawSphere(pd->atomPos(a), radius(a));
     }
 
     // normalize normal vectors of bonds
@@ -223,12 +225,12 @@ namespace Avogadro
           customColor.setAlphaF(m_alpha);
           pd->painter()->setColor(&customColor);
         }
-        pd->painter()->drawSphere(a->pos(), radius(a));
+        pd->painter()->drawSphere(pd->atomPos(a), radius(a));
       }
       // If the atom is selected render the selection
       if (pd->isSelected(a)) {
         pd->painter()->setColor(&selectionMap);
-        pd->painter()->drawSphere(a->pos(), SEL_ATOM_EXTRA_RADIUS + radius(a));
+        pd->painter()->drawSphere(pd->atomPos(a), SEL_ATOM_EXTRA_RADIUS + radius(a));
       }
     }
 
@@ -246,8 +248,8 @@ namespace Avogadro
         continue;
       }
 
-      Vector3d v1(*atom1->pos());
-      Vector3d v2(*atom2->pos());
+      Vector3d v1(*pd->atomPos(atom1));
+      Vector3d v2(*pd->atomPos(atom2));
       Vector3d d = v2 - v1;
       d.normalize();
       Vector3d v3((v1 + v2 + d*(radius(atom1) - radius(atom2))) / 2);
@@ -304,8 +306,8 @@ namespace Avogadro
     foreach(Bond *b, bonds()) {
       Atom* atom1 = pd->molecule()->atomById(b->beginAtomId());
       Atom* atom2 = pd->molecule()->atomById(b->endAtomId());
-      Vector3d v1(*atom1->pos());
-      Vector3d v2(*atom2->pos());
+      Vector3d v1(*pd->atomPos(atom1));
+      Vector3d v2(*pd->atomPos(atom2));
       Vector3d d = v2 - v1;
       d.normalize();
       Vector3d v3((v1 + v2 + d*(radius(atom1)-radius(atom2))) / 2);
@@ -338,12 +340,12 @@ namespace Avogadro
     foreach(Atom *a, allAtoms) {
       if (pd->isSelected(a)) {
         pd->painter()->setColor(&cSel);
-        pd->painter()->drawSphere(a->pos(), SEL_ATOM_EXTRA_RADIUS + radius(a));
+        pd->painter()->drawSphere(pd->atomPos(a), SEL_ATOM_EXTRA_RADIUS + radius(a));
       }
       else {
         map->setFromPrimitive(a);
         pd->painter()->setColor(map);
-        pd->painter()->drawSphere(a->pos(), radius(a));
+        pd->painter()->drawSphere(pd->atomPos(a), radius(a));
       }
     }
 
@@ -370,15 +372,23 @@ namespace Avogadro
       // (e.g., during drawing)
       // heavy atoms get a bit more, hydrogens get a bit less
       if (a->atomicNumber() > 1)
-        pd->painter()->drawSphere(a->pos(), radius(a) + 0.03);
+        pd->painter()->drawSphere(pd->atomPos(a), radius(a) + 0.03);
       else
-        pd->painter()->drawSphere(a->pos(), radius(a) - 0.06);
+        pd->painter()->drawSphere(pd->atomPos(a), radius(a) - 0.06);
     }
     return true;
   }
 
   inline double BSDYEngine::radius(const Atom *atom) const
   {
+    // A radius column of the molecule comes first, in Angstrom like the
+    // element radii, atoms without a positive value in it fall back to their
+    // own radius
+    const std::vector<double> &radii =
+        atom->molecule()->atomFloatAttribute(m_radiusAttribute);
+    const unsigned long index = atom->index();
+    if (index < radii.size() && radii[index] > 0.0)
+      return radii[index] * m_atomRadiusPercentage;
     if (atom->customRadius())
       return atom->customRadius()* m_atomRadiusPercentage;
     else {
@@ -422,6 +432,12 @@ namespace Avogadro
     emit changed();
   }
 
+  void BSDYEngine::setRadiusAttribute(const QString &name)
+  {
+    m_radiusAttribute = name;
+    emit changed();
+  }
+
   double BSDYEngine::radius( const PainterDevice *pd, const Primitive *p ) const
   {
     // Atom radius
@@ -469,6 +485,8 @@ namespace Avogadro
               this, SLOT(setShowMulti(int)));
       connect(m_settingsWidget->opacitySlider, SIGNAL(valueChanged(int)),
               this, SLOT(setOpacity(int)));
+      connect(m_settingsWidget->radiusAttributeEdit, SIGNAL(textChanged(QString)),
+              this, SLOT(setRadiusAttribute(QString)));
       connect(m_settingsWidget, SIGNAL(destroyed()),
               this, SLOT(settingsWidgetDestroyed()));
       m_settingsWidget->atomRadiusSlider
@@ -478,6 +496,7 @@ namespace Avogadro
       m_settingsWidget->showMulti->setCheckState((Qt::CheckState)m_showMulti);
       m_settingsWidget->opacitySlider->setValue(int(20 * m_alpha));
       m_settingsWidget->combo_radius->setCurrentIndex(m_atomRadiusType);
+      m_settingsWidget->radiusAttributeEdit->setText(m_radiusAttribute);
     }
     return m_settingsWidget;
   }
@@ -498,6 +517,7 @@ namespace Avogadro
                       m_bondRadiusScale * m_bondRadius);
     settings.setValue("showMulti", m_showMulti);
     settings.setValue("opacity", 20 * m_alpha);
+    settings.setValue("radiusAttribute", m_radiusAttribute);
   }
 
   void BSDYEngine::readSettings(QSettings &settings)
@@ -508,6 +528,7 @@ namespace Avogadro
     setShowMulti(settings.value("showMulti", 2).toInt());
     setOpacity(settings.value("opacity", 100).toInt());
     setAtomRadiusType(settings.value("radiusType", 1).toInt());
+    m_radiusAttribute = settings.value("radiusAttribute", "radius").toString();
 
     if (m_settingsWidget) {
       m_settingsWidget->atomRadiusSlider
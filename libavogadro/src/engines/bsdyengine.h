@@ -92,6 +92,10 @@ namespace Avogadro {
 
       double m_alpha; // transparency of the balls & sticks
 
+      // Atom attribute column with the atom radii in Angstrom, if the
+      // molecule has one
+      QString m_radiusAttribute;
+
       /**
        * Function pointer for the radius function to be used for rendering.
        */
@@ -123,6 +127,11 @@ namespace Avogadro {
        */
       void setOpacity(int value);
 
+      /**
+       * @param name atom attribute column with the atom radii in Angstrom
+       */
+      void setRadiusAttribute(const QString &name);
+
   };
 
   class BSDYSettingsWidget : public QWidget, public Ui::BSDYSettingsWidget
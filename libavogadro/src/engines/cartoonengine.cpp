@@ -35,6 +35,7 @@
 #include <avogadro/color.h>
 #include <avogadro/glwidget.h>
 #include <avogadro/mesh.h>
+#include <avogadro/meshsimplifier.h>
 #include <avogadro/painterdevice.h>
 #include <avogadro/protein.h>
 
@@ -249,12 +250,25 @@ namespace Avogadro {
                                     m_loopColor.blueF()));
 
     connect(generator, SIGNAL(finished()), this, SIGNAL(changed()));
+    connect(generator, SIGNAL(finished()), this, SLOT(simplifyMesh()));
     connect(generator, SIGNAL(finished()), generator, SLOT(deleteLater()));
     generator->start();
 
     m_update = false;
   }
 
+  void CartoonEngine::simplifyMesh()
+  {
+    if (!m_mesh)
+      return;
+
+    // The full mesh is drawn until the levels are ready
+    MeshSimplifier *simplifier = new MeshSimplifier(m_mesh);
+    connect(simplifier, SIGNAL(finished()), this, SIGNAL(changed()));
+    connect(simplifier, SIGNAL(finished()), simplifier, SLOT(deleteLater()));
+    simplifier->start();
+  }
+
   Engine::PrimitiveTypes CartoonEngine::primitiveTypes() const
   {
     return Engine::Molecules;
@@ -103,6 +103,10 @@ namespace Avogadro {
       QColor m_helixColor, m_sheetColor, m_loopColor;
     
     private Q_SLOTS:
+      /**
+       * Build the levels of detail of the new mesh in a new thread.
+       */
+      void simplifyMesh();
       void settingsWidgetDestroyed();
       void setHelixA(double value);
       void setHelixB(double value);
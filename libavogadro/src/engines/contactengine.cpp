@@ -0,0 +1,162 @@
+/**********************************************************************
+  ContactEngine - Steric clash and close contact engine
+
+  Copyright (C) 2013 Avogadro Developers
+
+  This file is part of the Avogadro molecular editor project.
+  For more information, see <http://avogadro.cc/>
+
+  Avogadro is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  Avogadro is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+  02110-1301, USA.
+ **********************************************************************/
+
+#include "contactengine.h"
+
+#include <avogadro/molecule.h>
+#include <avogadro/moleculesnapshot.h>
+#include <avogadro/atom.h>
+#include <avogadro/painter.h>
+#include <avogadro/painterdevice.h>
+
+#include <QtPlugin>
+#include <QtCore/QVector>
+
+namespace Avogadro {
+
+  ContactEngine::ContactEngine(QObject *parent) : Engine(parent),
+    m_settingsWidget(0), m_width(2)
+  {
+  }
+
+  ContactEngine::~ContactEngine()
+  {
+    if (m_settingsWidget)
+      m_settingsWidget->deleteLater();
+  }
+
+  Engine *ContactEngine::clone() const
+  {
+    ContactEngine *engine = new ContactEngine(parent());
+    engine->setAlias(alias());
+    engine->setWidth(m_width);
+    engine->setFraction(m_contacts.fraction());
+    engine->setEnabled(isEnabled());
+
+    return engine;
+  }
+
+  bool ContactEngine::renderOpaque(PainterDevice *pd)
+  {
+    const Molecule *molecule = pd->molecule();
+    if (!molecule || !molecule->numAtoms())
+      return false;
+
+    if (m_contacts.molecule() != molecule)
+      m_contacts.setMolecule(molecule);
+    m_contacts.update();
+
+    const std::vector<ContactList::Contact> &contacts = m_contacts.contacts();
+    if (contacts.empty())
+      return true;
+
+    // Only look up the rendered atoms if the engine does not have them all
+    QVector<bool> rendered;
+    const QList<Atom *> engineAtoms = atoms();
+    if (static_cast<unsigned int>(engineAtoms.size()) < molecule->numAtoms()) {
+      rendered.fill(false, molecule->numAtoms());
+      foreach (const Atom *atom, engineAtoms)
+        rendered[atom->index()] = true;
+    }
+
+    const MoleculeSnapshot &snapshot = m_contacts.snapshot();
+    const double fraction = m_contacts.fraction();
+    const int stipple = 0xF0F0;
+    for (size_t i = 0; i < contacts.size(); ++i) {
+      const ContactList::Contact &contact = contacts[i];
+      if (!rendered.isEmpty() && !rendered.at(contact.first)
+          && !rendered.at(contact.second))
+        continue;
+      // Yellow at the cut-off turning red 0.2 below it
+      double severity = (fraction - contact.ratio) / 0.2;
+      if (severity > 1.0)
+        severity = 1.0;
+      pd->painter()->setColor(1.0, 1.0 - severity, 0.0);
+      pd->painter()->drawMultiLine(snapshot.atomPos(contact.first),
+                                   snapshot.atomPos(contact.second),
+                                   m_width, 1, stipple);
+    }
+
+    return true;
+  }
+
+  double ContactEngine::radius(const PainterDevice *, const Primitive *) const
+  {
+    return 0.0;
+  }
+
+  QWidget* ContactEngine::settingsWidget()
+  {
+    if (!m_settingsWidget) {
+      m_settingsWidget = new ContactSettingsWidget();
+      m_settingsWidget->widthSlider->setValue(m_width);
+      m_settingsWidget->fractionSpin->setValue(m_contacts.fraction());
+      connect(m_settingsWidget->widthSlider, SIGNAL(valueChanged(int)),
+              this, SLOT(setWidth(int)));
+      connect(m_settingsWidget->fractionSpin, SIGNAL(valueChanged(double)),
+              this, SLOT(setFraction(double)));
+      connect(m_settingsWidget, SIGNAL(destroyed()),
+              this, SLOT(settingsWidgetDestroyed()));
+    }
+    return m_settingsWidget;
+  }
+
+  void ContactEngine::setWidth(int value)
+  {
+    m_width = value;
+    emit changed();
+  }
+
+  void ContactEngine::setFraction(double value)
+  {
+    m_contacts.setFraction(value);
+    emit changed();
+  }
+
+  void ContactEngine::settingsWidgetDestroyed()
+  {
+    m_settingsWidget = 0;
+  }
+
+  void ContactEngine::writeSettings(QSettings &settings) const
+  {
+    Engine::writeSettings(settings);
+    settings.setValue("width", m_width);
+    settings.setValue("fraction", m_contacts.fraction());
+  }
+
+  void ContactEngine::readSettings(QSettings &settings)
+  {
+    Engine::readSettings(settings);
+    setWidth(settings.value("width", 2).toInt());
+    setFraction(settings.value("fraction", 0.8).toDouble());
+    if (m_settingsWidget) {
+      m_settingsWidget->widthSlider->setValue(m_width);
+      m_settingsWidget->fractionSpin->setValue(m_contacts.fraction());
+    }
+  }
+
+}
+
+Q_EXPORT_PLUGIN2(contactengine, Avogadro::ContactEngineFactory)
@@ -0,0 +1,120 @@
+/**********************************************************************
+  ContactEngine - Steric clash and close contact engine
+
+  Copyright (C) 2013 Avogadro Developers
+
+  This file is part of the Avogadro molecular editor project.
+  For more information, see <http://avogadro.cc/>
+
+  Avogadro is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  Avogadro is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+  02110-1301, USA.
+ **********************************************************************/
+
+#ifndef CONTACTENGINE_H
+#define CONTACTENGINE_H
+
+#include <avogadro/global.h>
+#include <avogadro/engine.h>
+#include <avogadro/contactlist.h>
+
+#include "ui_contactsettingswidget.h"
+
+namespace Avogadro {
+
+  class ContactSettingsWidget;
+
+  /**
+   * @class ContactEngine
+   * @brief Renders steric clashes and close contacts as dashed lines.
+   *
+   * The contacts are kept in a ContactList, which only searches again
+   * around the atoms that moved since the last frame, so the clashes follow
+   * a fragment dragged through a large molecule. Contacts are drawn from
+   * yellow at the cut-off to red for the worst overlaps. Contacts of atoms
+   * not rendered by the engine are left out.
+   */
+  class ContactEngine : public Engine
+  {
+    Q_OBJECT
+    AVOGADRO_ENGINE("Contacts", tr("Close Contacts"),
+                    tr("Renders steric clashes and close contacts"))
+
+    public:
+      ContactEngine(QObject *parent=0);
+      ~ContactEngine();
+
+      Engine *clone() const;
+
+      //! \name Render Methods
+      //@{
+      bool renderOpaque(PainterDevice *pd);
+      bool renderPick(PainterDevice *) { return true; }
+      //@}
+
+      double radius(const PainterDevice *pd, const Primitive *p = 0) const;
+
+      QWidget* settingsWidget();
+
+      bool hasSettings() { return true; }
+
+      /**
+       * Write the engine settings so that they can be saved between sessions.
+       */
+      void writeSettings(QSettings &settings) const;
+
+      /**
+       * Read in the settings that have been saved for the engine instance.
+       */
+      void readSettings(QSettings &settings);
+
+    private:
+      ContactSettingsWidget *m_settingsWidget;
+      ContactList m_contacts;
+      int m_width;
+
+    private Q_SLOTS:
+      void settingsWidgetDestroyed();
+
+      /**
+       * @param value width of the contact lines
+       */
+      void setWidth(int value);
+
+      /**
+       * @param value fraction of the sum of the van der Waals radii below
+       * which atoms are in contact
+       */
+      void setFraction(double value);
+  };
+
+  class ContactSettingsWidget : public QWidget, public Ui::ContactSettingsWidget
+  {
+    public:
+      ContactSettingsWidget(QWidget *parent=0) : QWidget(parent) {
+        setupUi(this);
+      }
+  };
+
+  //! Generates instances of our ContactEngine class
+  class ContactEngineFactory : public QObject, public PluginFactory
+  {
+    Q_OBJECT
+    Q_INTERFACES(Avogadro::PluginFactory)
+    AVOGADRO_ENGINE_FACTORY(ContactEngine)
+  };
+
+} // end namespace Avogadro
+
+#endif
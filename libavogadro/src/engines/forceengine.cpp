@@ -64,7 +64,7 @@ namespace Avogadro {
     if (forceVector.norm() < 0.01) // too small to really show
       return true;
 
-    const Vector3d &v1 = *atom->pos();
+    const Vector3d &v1 = *pd->atomPos(atom);
 
     // Use the camera and painter device to "float" the arrows
     // in front of the atom. This is similar to the label engine code
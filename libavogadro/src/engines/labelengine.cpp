@@ -61,7 +61,7 @@ namespace Avogadro {
                     m_lengthPrecision(3),
                     m_atomColor(255,255,255), m_bondColor(255,255,255),
                     m_displacement(0,0,0),  m_bondDisplacement(0,0,0),
-                    m_settingsWidget(0)
+                    m_settingsWidget(0), m_labelAttribute("label")
   {
   }
 
@@ -71,6 +71,7 @@ namespace Avogadro {
     engine->setAlias(alias());
     engine->setAtomType(m_atomType);
     engine->setBondType(m_bondType);
+    engine->m_labelAttribute = m_labelAttribute;
     engine->setEnabled(isEnabled());
 
     return engine;
@@ -100,7 +101,7 @@ namespace Avogadro {
   bool LabelEngine::renderOpaque(PainterDevice *pd, const Atom *a)
   {
     // Render atom labels
-    const Vector3d pos = *a->pos();
+    const Vector3d pos = *pd->atomPos(a);
 
     double renderRadius = pd->radius(a);
     renderRadius += 0.05;
@@ -127,7 +128,37 @@ namespace Avogadro {
   QString LabelEngine::createAtomLabel(const Atom *a)
   {
     unsigned int gi;
-    QString str = QString(a->customLabel());
+    QString str;
+    // A label column of the molecule comes first, then the custom label
+    const Molecule *molecule = a->molecule();
+    const unsigned long index = a->index();
+    switch (molecule->atomAttributeType(m_labelAttribute)) {
+    case Molecule::StringAttribute: {
+      const QStringList &labels =
+          molecule->atomStringAttribute(m_labelAttribute);
+      if (index < static_cast<unsigned long>(labels.size()))
+        str = labels.at(index);
+      break;
+    }
+    case Molecule::FloatAttribute: {
+      const std::vector<double> &labels =
+          molecule->atomFloatAttribute(m_labelAttribute);
+      if (index < labels.size())
+        str = QString("%L1").arg(labels[index], 0, 'g', m_lengthPrecision);
+      break;
+    }
+    case Molecule::IntAttribute: {
+      const std::vector<int> &labels =
+          molecule->atomIntAttribute(m_labelAttribute);
+      if (index < labels.size())
+        str = QString("%L1").arg(labels[index]);
+      break;
+    }
+    default:
+      break;
+    }
+    if (str.isEmpty())
+      str = a->customLabel();
     if (str.isEmpty()) {
      switch(m_atomType) {
       case 1: // Atom index
@@ -208,8 +239,8 @@ namespace Avogadro {
     // Render bond labels
     Atom* atom1 = pd->molecule()->atomById(b->beginAtomId());
     Atom* atom2 = pd->molecule()->atomById(b->endAtomId());
-    Vector3d v1 (*atom1->pos());
-    Vector3d v2 (*atom2->pos());
+    Vector3d v1 (*pd->atomPos(atom1));
+    Vector3d v2 (*pd->atomPos(atom2));
     Vector3d d = v2 - v1;
     d.normalize();
 
@@ -313,6 +344,7 @@ namespace Avogadro {
       m_settingsWidget->atomColor->setDialogTitle(tr("Select Atom Labels Color"));
       m_settingsWidget->bondColor->setColor(m_bondColor);
       m_settingsWidget->bondColor->setDialogTitle(tr("Select Bond Labels Color"));
+      m_settingsWidget->labelAttributeEdit->setText(m_labelAttribute);
 
       // Hide the text rendering engine choice and label for release builds
 #ifndef DEBUG
@@ -336,6 +368,8 @@ namespace Avogadro {
               this, SLOT(setBondColor(QColor)));
       connect(m_settingsWidget->bondFont, SIGNAL(clicked()),
               this, SLOT(setBondFont()));
+      connect(m_settingsWidget->labelAttributeEdit, SIGNAL(textChanged(QString)),
+              this, SLOT(setLabelAttribute(QString)));
       connect(m_settingsWidget, SIGNAL(destroyed()),
               this, SLOT(settingsWidgetDestroyed()));
       connect(m_settingsWidget->xDisplSpinBox, SIGNAL(valueChanged(double)),
@@ -388,6 +422,12 @@ namespace Avogadro {
     }
   }
 
+  void LabelEngine::setLabelAttribute(const QString &name)
+  {
+    m_labelAttribute = name;
+    emit changed();
+  }
+
   void LabelEngine::settingsWidgetDestroyed()
   {
     qDebug() << "Destroyed Settings Widget";
@@ -414,6 +454,7 @@ namespace Avogadro {
     settings.setValue("bondFont", m_bondFont);
     settings.setValue("atomColor", m_atomColor);
     settings.setValue("bondColor", m_bondColor);
+    settings.setValue("labelAttribute", m_labelAttribute);
   }
 
   void LabelEngine::readSettings(QSettings &settings)
@@ -426,6 +467,7 @@ namespace Avogadro {
     m_bondFont = settings.value("bondFont", QApplication::font()).value<QFont>();
     m_atomColor = settings.value("atomColor", QColor(Qt::white)).value<QColor>();
     m_bondColor = settings.value("bondColor", QColor(Qt::white)).value<QColor>();
+    m_labelAttribute = settings.value("labelAttribute", "label").toString();
     if(m_settingsWidget) {
       m_settingsWidget->atomType->setCurrentIndex(m_atomType);
       m_settingsWidget->bondType->setCurrentIndex(m_bondType);
@@ -95,6 +95,7 @@ namespace Avogadro {
       Eigen::Vector3d m_displacement;
       Eigen::Vector3d m_bondDisplacement;
       LabelSettingsWidget* m_settingsWidget;
+      QString m_labelAttribute; // Atom attribute column with the labels
 
     private Q_SLOTS:
       void setAtomType(int value);
@@ -105,6 +106,7 @@ namespace Avogadro {
       void setBondColor(QColor);
       void setAtomFont();
       void setBondFont();
+      void setLabelAttribute(const QString &name);
       void updateDisplacement(double = 0.0);
       void updateBondDisplacement(double = 0.0);
       void settingsWidgetDestroyed();
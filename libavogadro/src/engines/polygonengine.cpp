@@ -88,7 +88,7 @@ namespace Avogadro{
     QVector<const Vector3d*> atoms;
     QList<unsigned long> neighbors = a->neighbors();
     foreach (unsigned long neighbor, neighbors) {
-      atoms.push_back(pd->molecule()->atomById(neighbor)->pos());
+      atoms.push_back(pd->atomPos(pd->molecule()->atomById(neighbor)));
     }
 
     // Disable face culling for ring structures.
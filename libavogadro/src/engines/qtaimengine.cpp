@@ -69,6 +69,41 @@ namespace Avogadro
     }
   }
 
+  void QTAIMEngine::renderRingAndCageCriticalPoints(PainterDevice *pd)
+  {
+    const char *properties[2][3] = {
+      { "QTAIMXRingCriticalPoints", "QTAIMYRingCriticalPoints", "QTAIMZRingCriticalPoints" },
+      { "QTAIMXCageCriticalPoints", "QTAIMYCageCriticalPoints", "QTAIMZCageCriticalPoints" }
+    };
+    const QString colors[2] = { "Red", "Green" };
+
+    for( int k=0 ; k < 2 ; ++k )
+    {
+      QVariant xVariant=m_molecule->property(properties[k][0]);
+      QVariant yVariant=m_molecule->property(properties[k][1]);
+      QVariant zVariant=m_molecule->property(properties[k][2]);
+      if( !xVariant.isValid() || !yVariant.isValid() || !zVariant.isValid() )
+        continue;
+
+      QVariantList xVariantList=xVariant.toList();
+      QVariantList yVariantList=yVariant.toList();
+      QVariantList zVariantList=zVariant.toList();
+      if( xVariantList.length() != yVariantList.length() ||
+          xVariantList.length() != zVariantList.length() )
+        continue;
+
+      pd->painter()->setColor(colors[k]);
+      for( qint64 i=0 ; i < xVariantList.length() ; ++i )
+      {
+        Eigen::Vector3d xyz;
+        xyz << xVariantList.at(i).toReal(),
+               yVariantList.at(i).toReal(),
+               zVariantList.at(i).toReal();
+        pd->painter()->drawSphere(xyz, 0.1 );
+      }
+    }
+  }
+
   bool QTAIMEngine::renderOpaque( PainterDevice *pd )
   {
 //    glPushAttrib( GL_TRANSFORM_BIT );
@@ -229,6 +264,9 @@ namespace Avogadro
       }
     }
 
+
+    renderRingAndCageCriticalPoints(pd);
+
     // normalize normal vectors of bonds
     glDisable( GL_RESCALE_NORMAL );
     glEnable( GL_NORMALIZE );
@@ -427,6 +465,9 @@ namespace Avogadro
       }
     }
 
+
+    renderRingAndCageCriticalPoints(pd);
+
     // normalize normal vectors of bonds
     glDisable( GL_RESCALE_NORMAL );
     glEnable( GL_NORMALIZE );
@@ -592,6 +633,9 @@ namespace Avogadro
       }
     }
 
+
+    renderRingAndCageCriticalPoints(pd);
+
     // normalize normal vectors of bonds
     glDisable( GL_RESCALE_NORMAL );
     glEnable( GL_NORMALIZE );
@@ -756,6 +800,9 @@ namespace Avogadro
       }
     }
 
+
+    renderRingAndCageCriticalPoints(pd);
+
     // normalize normal vectors of bonds
     glDisable( GL_RESCALE_NORMAL );
     glEnable( GL_NORMALIZE );
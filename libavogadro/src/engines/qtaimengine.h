@@ -81,6 +81,12 @@ namespace Avogadro {
 
 
     private:
+      /**
+       * Draw the ring critical points in red and the cage critical points
+       * in green, if the molecule has them.
+       */
+      void renderRingAndCageCriticalPoints(PainterDevice *pd);
+
       double radius(const Atom *atom) const;
       double (*pRadius)(const Atom *atom);
 
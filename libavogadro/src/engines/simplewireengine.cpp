@@ -59,9 +59,9 @@ namespace Avogadro {
 
     foreach(Bond *b, bonds()) {
       const Atom* atom1 = b->beginAtom();
-      const Vector3d & v1 = *atom1->pos();
+      const Vector3d & v1 = *pd->atomPos(atom1);
       const Atom* atom2 = b->endAtom();
-      const Vector3d & v2 = *atom2->pos();
+      const Vector3d & v2 = *pd->atomPos(atom2);
       map->setFromPrimitive(atom1);
       pd->painter()->setColor(map);
       if (atom1->atomicNumber() != atom2->atomicNumber()) {
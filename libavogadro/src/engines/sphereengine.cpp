@@ -100,7 +100,7 @@ namespace Avogadro {
       // Render all atoms and atom images
       QList<Atom *> allAtoms = atoms() + atomImages();
       foreach(Atom *a, allAtoms) {
-        pd->painter()->drawSphere(a->pos(), radius(a)*0.9999);
+        pd->painter()->drawSphere(pd->atomPos(a), radius(a)*0.9999);
       }
 
       glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
@@ -126,7 +126,7 @@ namespace Avogadro {
         map->setToSelectionColor();
         pd->painter()->setColor(map);
         pd->painter()->setName(a);
-        pd->painter()->drawSphere(a->pos(), SEL_ATOM_EXTRA_RADIUS + radius(a));
+        pd->painter()->drawSphere(pd->atomPos(a), SEL_ATOM_EXTRA_RADIUS + radius(a));
       }
     }
 
@@ -147,7 +147,7 @@ namespace Avogadro {
       map->setFromPrimitive(a);
       pd->painter()->setColor(map);
       pd->painter()->setName(a);
-      pd->painter()->drawSphere(a->pos(), radius(a));
+      pd->painter()->drawSphere(pd->atomPos(a), radius(a));
     }
 
     glDisable(GL_RESCALE_NORMAL);
@@ -165,7 +165,7 @@ namespace Avogadro {
     map->setAlpha(m_alpha);
     pd->painter()->setColor(map);
     pd->painter()->setName(a);
-    pd->painter()->drawSphere(a->pos(), radius(a));
+    pd->painter()->drawSphere(pd->atomPos(a), radius(a));
 
     return true;
   }
@@ -48,7 +48,7 @@ using namespace Eigen;
 namespace Avogadro {
 
   StickEngine::StickEngine(QObject *parent) : Engine(parent), m_settingsWidget(0),
-        m_radius(0.25)
+        m_radius(0.25), m_radiusAttribute("stickRadius")
   {
   }
 
@@ -66,6 +66,7 @@ namespace Avogadro {
     engine->setAlias(alias());
     engine->setEnabled(isEnabled());
     engine->setRadius(m_radius * SCALING_FACTOR);
+    engine->m_radiusAttribute = m_radiusAttribute;
     return engine;
   }
 
@@ -106,7 +107,7 @@ namespace Avogadro {
     foreach(Atom *a, allAtoms) {
       if (pd->isSelected(a)) {
         pd->painter()->setName(a);
-        pd->painter()->drawSphere(a->pos(), SEL_ATOM_EXTRA_RADIUS + radius(a));
+        pd->painter()->drawSphere(pd->atomPos(a), SEL_ATOM_EXTRA_RADIUS + radius(a));
       }
     }
 
@@ -117,8 +118,8 @@ namespace Avogadro {
       if (pd->isSelected(b)) {
         Atom* atom1 = pd->molecule()->atomById(b->beginAtomId());
         Atom* atom2 = pd->molecule()->atomById(b->endAtomId());
-        Vector3d v1 (*atom1->pos());
-        Vector3d v2 (*atom2->pos());
+        Vector3d v1 (*pd->atomPos(atom1));
+        Vector3d v2 (*pd->atomPos(atom2));
         Vector3d v3 (( v1 + v2 ) / 2);
         pd->painter()->setName(b);
         pd->painter()->drawCylinder(v1, v2, SEL_BOND_EXTRA_RADIUS + radius(atom1));
@@ -154,7 +155,7 @@ namespace Avogadro {
     map->setFromPrimitive(a);
     pd->painter()->setColor(map);
     pd->painter()->setName(a);
-    pd->painter()->drawSphere( a->pos(), radius(a) );
+    pd->painter()->drawSphere( pd->atomPos(a), radius(a) );
 
     return true;
   }
@@ -167,7 +168,7 @@ namespace Avogadro {
     map->setFromPrimitive(a);
     pd->painter()->setColor(map);
     pd->painter()->setName(a);
-    pd->painter()->drawSphere( a->pos(), radius(a) + 0.2 );
+    pd->painter()->drawSphere( pd->atomPos(a), radius(a) + 0.2 );
 
     return true;
   }
@@ -179,8 +180,8 @@ namespace Avogadro {
 
     Atom* atom1 = pd->molecule()->atomById(b->beginAtomId());
     Atom* atom2 = pd->molecule()->atomById(b->endAtomId());
-    Vector3d v1 (*atom1->pos());
-    Vector3d v2 (*atom2->pos());
+    Vector3d v1 (*pd->atomPos(atom1));
+    Vector3d v2 (*pd->atomPos(atom2));
     Vector3d v3 (( v1 + v2 ) / 2);
 
     map->setFromPrimitive(atom1);
@@ -191,11 +192,23 @@ namespace Avogadro {
     map->setFromPrimitive(atom2);
     pd->painter()->setColor(map);
     pd->painter()->setName(b);
-    pd->painter()->drawCylinder( v3, v2, radius(atom1) );
+    pd->painter()->drawCylinder( v3, v2, radius(atom2) );
 
     return true;
   }
 
+  inline double StickEngine::radius(const Atom *atom) const
+  {
+    // The stick radius column gives the radius of each atom in Angstrom,
+    // atoms without a positive value in it use the common radius
+    const std::vector<double> &radii =
+        atom->molecule()->atomFloatAttribute(m_radiusAttribute);
+    const unsigned long index = atom->index();
+    if (index < radii.size() && radii[index] > 0.0)
+      return radii[index];
+    return m_radius;
+  }
+
   double StickEngine::radius(const PainterDevice *pd, const Primitive *p) const
   {
     // Atom radius
@@ -237,14 +250,23 @@ namespace Avogadro {
     emit changed();
   }
 
+  void StickEngine::setRadiusAttribute(const QString &name)
+  {
+    m_radiusAttribute = name;
+    emit changed();
+  }
+
   QWidget* StickEngine::settingsWidget()
   {
     if(!m_settingsWidget)
     {
       m_settingsWidget = new StickSettingsWidget();
       connect(m_settingsWidget->radiusSlider, SIGNAL(valueChanged(int)), this, SLOT(setRadius(int)));
+      connect(m_settingsWidget->radiusAttributeEdit, SIGNAL(textChanged(QString)),
+              this, SLOT(setRadiusAttribute(QString)));
       connect(m_settingsWidget, SIGNAL(destroyed()), this, SLOT(settingsWidgetDestroyed()));
       m_settingsWidget->radiusSlider->setValue(SCALING_FACTOR*m_radius);
+      m_settingsWidget->radiusAttributeEdit->setText(m_radiusAttribute);
     }
     return m_settingsWidget;
   }
@@ -258,6 +280,7 @@ namespace Avogadro {
   {
     Engine::writeSettings(settings);
     settings.setValue("radius", SCALING_FACTOR*m_radius);
+    settings.setValue("radiusAttribute", m_radiusAttribute);
   }
 
   void StickEngine::readSettings(QSettings &settings)
@@ -265,6 +288,7 @@ namespace Avogadro {
     Engine::readSettings(settings);
         // default = 0.25 as far as m_radius
     setRadius(settings.value("radius", 5).toInt());
+    m_radiusAttribute = settings.value("radiusAttribute", "stickRadius").toString();
     if (m_settingsWidget) {
       m_settingsWidget->radiusSlider->setValue(SCALING_FACTOR*m_radius);
     }
@@ -78,8 +78,7 @@ namespace Avogadro {
       void readSettings(QSettings &settings);
 
     private:
-      inline double radius(const Atom *) const
-      { return m_radius; }
+      double radius(const Atom *atom) const;
       //! Render an Atom.
       bool renderOpaque(PainterDevice *pd, const Atom *a);
       bool renderPick(PainterDevice *pd, const Atom *a);
@@ -89,6 +88,8 @@ namespace Avogadro {
       StickSettingsWidget *m_settingsWidget;
 
 			double m_radius; //!< The radius of the stick bonds
+      //! Atom attribute column with the stick radius of each atom, if present
+      QString m_radiusAttribute;
 
 		private Q_SLOTS:
 	    void settingsWidgetDestroyed();
@@ -96,6 +97,10 @@ namespace Avogadro {
 	     * @param value radius of the sticks / 20
 	     */
 	    void setRadius(int value);
+      /**
+       * @param name atom attribute column with the stick radii in Angstrom
+       */
+      void setRadiusAttribute(const QString &name);
   };
 
   class StickSettingsWidget : public QWidget, public Ui::StickSettingsWidget
@@ -241,6 +241,12 @@ namespace Avogadro {
         m_settingsWidget->orbital1Combo->addItem(comboText.arg(mesh->isoValue()));
         m_meshes.push_back(mesh->id());
       }
+      else if (cubeType == Cube::SolventExcluded) {
+        comboText = tr("Solvent excluded, isosurface = %L1",
+                       "Solvent excluded isosurface with a cutoff of %1");
+        m_settingsWidget->orbital1Combo->addItem(comboText.arg(mesh->isoValue()));
+        m_meshes.push_back(mesh->id());
+      }
       else if (cubeType == Cube::ElectronDensity) {
         comboText = tr("Electron density, isosurface = %L1",
                        "Electron density isosurface with a cutoff of %1");
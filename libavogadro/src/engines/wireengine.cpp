@@ -95,9 +95,9 @@ namespace Avogadro {
       // (e.g., during drawing)
       // heavy atoms get a bit more, hydrogens get a bit less
       if (a->isHydrogen())
-        pd->painter()->drawSphere(a->pos(), 0.05);
+        pd->painter()->drawSphere(pd->atomPos(a), 0.05);
       else
-        pd->painter()->drawSphere(a->pos(), 0.15);
+        pd->painter()->drawSphere(pd->atomPos(a), 0.15);
     }
 
     return true;
@@ -105,7 +105,7 @@ namespace Avogadro {
 
   bool WireEngine::renderOpaque(PainterDevice *pd, const Atom *a)
   {
-    const Vector3d & v = *a->pos();
+    const Vector3d & v = *pd->atomPos(a);
     const Camera *camera = pd->camera();
 
     // perform a rough form of frustum culling
@@ -159,7 +159,7 @@ namespace Avogadro {
   bool WireEngine::renderOpaque(PainterDevice *pd, const Bond *b)
   {
     const Atom* atom1 = pd->molecule()->atomById(b->beginAtomId());
-    const Vector3d & v1 = *atom1->pos();
+    const Vector3d & v1 = *pd->atomPos(atom1);
     const Camera *camera = pd->camera();
 
     Color *map = colorMap(); // possible custom color map
@@ -173,7 +173,7 @@ namespace Avogadro {
       return true; // i.e., don't bother rendering
 
     const Atom* atom2 = pd->molecule()->atomById(b->endAtomId());
-    const Vector3d & v2 = *atom2->pos();
+    const Vector3d & v2 = *pd->atomPos(atom2);
     Vector3d d = v2 - v1;
     d.normalize();
 
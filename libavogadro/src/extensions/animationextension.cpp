@@ -24,9 +24,11 @@
 #include "animationextension.h"
 #include "trajvideomaker.h"
 #include <avogadro/molecule.h>
+#include <avogadro/atom.h>
 #include <avogadro/color.h>
 #include <avogadro/animation.h>
 #include <avogadro/glwidget.h>
+#include <avogadro/trajectoryreader.h>
 
 #include <openbabel/mol.h>
 #include <openbabel/obconversion.h>
@@ -35,6 +37,7 @@
 
 #include <QMessageBox>
 #include <QDir>
+#include <QFile>
 
 #include <fstream>
 
@@ -126,7 +129,11 @@ namespace Avogadro {
     if (file.isEmpty())
       return;
 
-    if (file.endsWith(QLatin1String(".xyz")) || file.endsWith(QLatin1String("HISTORY")) ) {
+    // Checked first, as extended XYZ files with a lattice are .xyz too
+    if (TrajectoryReader::canRead(file)) {
+      readPeriodicTrajFromFile(file);
+    }
+    else if (file.endsWith(QLatin1String(".xyz")) || file.endsWith(QLatin1String("HISTORY")) ) {
       readTrajFromFile(file);
     }
     else { //non xyz
@@ -273,10 +280,44 @@ namespace Avogadro {
       }
       ++i;
     }
+    // The first frame was written over the current positions
+    m_molecule->invalidatePositions();
 
     file.close();
   }
 
+  void AnimationExtension::readPeriodicTrajFromFile(QString trajfile)
+  {
+    QFile file(trajfile);
+    TrajectoryReader reader;
+    Molecule trajectory;
+    if (!file.open(QIODevice::ReadOnly) || !reader.read(&file, &trajectory)) {
+      QMessageBox::warning( NULL, tr( "Avogadro" ),
+                            tr( "Read trajectory file %1 failed: %2" )
+                            .arg( trajfile ).arg( reader.errorString() ) );
+      return;
+    }
+
+    if (trajectory.numAtoms() != m_molecule->numAtoms()) {
+      QMessageBox::warning( NULL, tr( "Avogadro" ),
+        tr( "Trajectory file %1 disagrees on the number of atoms in the present molecule").arg(trajfile));
+      return;
+    }
+
+    m_molecule->clearConformers();
+    for (unsigned int i = 0; i < trajectory.numConformers(); ++i) {
+      trajectory.setConformer(i);
+      std::vector<Eigen::Vector3d> *coords = m_molecule->addConformer(i);
+      for (unsigned int j = 0; j < trajectory.numAtoms(); ++j)
+        (*coords)[m_molecule->atom(j)->id()] = *trajectory.atom(j)->pos();
+    }
+    m_molecule->invalidatePositions();
+    // The unit cell follows the frames, Molecule::setConformer() sets it
+    m_molecule->setConformerCells(trajectory.conformerCells());
+    if (!trajectory.energies().empty())
+      m_molecule->setEnergies(trajectory.energies());
+  }
+
   bool AnimationExtension::writeXyzTraj(QString filename) {
     OBConversion conv;
     conv.SetInAndOutFormats("XYZ","XYZ");
@@ -75,6 +75,10 @@ namespace Avogadro {
       //!htp://www.cse.scitech.ac.uk/ccg/software/DL_POLY/MANUALS/USRMAN2.17.pdf
       void readTrajFromFile(QString filename);
 
+      //!periodic trajectories read by TrajectoryReader, with the cell of
+      //!each frame: VASP XDATCAR and OUTCAR and extended XYZ
+      void readPeriodicTrajFromFile(QString filename);
+
       //!support to write a trajectory to xyz as described here:
       //!http://www.ks.uiuc.edu/Research/vmd/plugins/molfile/xyzplugin.html
       bool writeXyzTraj(QString filename);
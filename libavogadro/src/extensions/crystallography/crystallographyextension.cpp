@@ -90,7 +90,8 @@ namespace Avogadro
       m_matrixCartFrac(Cartesian),
       m_matrixVectorStyle(RowVectors),
       m_spgTolerance(1e-5),
-      m_editorRefreshPending(false)
+      m_editorRefreshPending(false),
+      m_lastCellMatrix(Eigen::Matrix3d::Zero())
   {
     if (!m_mainwindow) {
       // HACK: This might have unintended consequences if used in other
@@ -242,11 +243,18 @@ namespace Avogadro
             this, SLOT(refreshEditors()));
     connect(m_molecule, SIGNAL(atomAdded(Atom *)),
             this, SLOT(refreshEditors()));
+    connect(m_molecule, SIGNAL(primitivesAdded(PrimitiveList)),
+            this, SLOT(refreshEditors()));
     connect(m_molecule, SIGNAL(atomUpdated(Atom *)),
             this, SLOT(refreshEditors()));
     connect(m_molecule, SIGNAL(atomRemoved(Atom *)),
             this, SLOT(refreshEditors()));
+    // The cell may change with the conformer, see
+    // Molecule::setConformerCells()
+    connect(m_molecule, SIGNAL(updated()),
+            this, SLOT(refreshOnCellChange()));
 
+    m_lastCellMatrix = currentCellMatrix();
     refreshEditors();
     refreshProperties();
 
@@ -511,6 +519,20 @@ namespace Avogadro
     }
   }
 
+  void CrystallographyExtension::refreshOnCellChange()
+  {
+    if (!m_molecule || !m_molecule->OBUnitCell()) {
+      return;
+    }
+    const Eigen::Matrix3d cell = currentCellMatrix();
+    if (cell == m_lastCellMatrix) {
+      return;
+    }
+    m_lastCellMatrix = cell;
+    refreshEditors();
+    refreshProperties();
+  }
+
   void CrystallographyExtension::refreshEditors_()
   {
     // If the molecule has changed since the single-shot timer was started, we
@@ -932,17 +954,23 @@ namespace Avogadro
       return QList<Eigen::Vector3d>();
     }
 
-    QList<Eigen::Vector3d> result = currentCartesianCoords();
-    for (QList<Eigen::Vector3d>::iterator
-           it = result.begin(),
-           it_end = result.end();
+    // The columns of the transposed storage cell matrix are the cell
+    // vectors, so a single inverse maps every cartesian position
+    const Eigen::Matrix3d cartToFrac
+      (OB2Eigen(cell->GetCellMatrix()).transpose().inverse());
+
+    QList<Eigen::Vector3d> result;
+    QList<Avogadro::Atom*> atoms = m_molecule->atoms();
+#if QT_VERSION >= 0x040700
+    result.reserve(atoms.size());
+#endif
+
+    for (QList<Avogadro::Atom*>::const_iterator
+           it = atoms.constBegin(),
+           it_end = atoms.constEnd();
          it != it_end;
          ++it) {
-      // Convert cartesian coords back to storage units
-      (*it) = unconvertLength(*it);
-      // Cartesian to fractional units
-      (*it) = OB2Eigen(cell->CartesianToFractional
-                       (Eigen2OB((*it))));
+      result << cartToFrac * (*(*it)->pos());
     }
     return result;
   }
@@ -1115,6 +1143,8 @@ namespace Avogadro
    const QList<Eigen::Vector3d> &fcoords)
   {
     OpenBabel::OBUnitCell *cell = currentCell();
+    const Eigen::Matrix3d fracToCart
+      (OB2Eigen(cell->GetCellMatrix()).transpose());
     QList<Eigen::Vector3d> coords;
 #if QT_VERSION >= 0x040700
     coords.reserve(fcoords.size());
@@ -1126,14 +1156,36 @@ namespace Avogadro
          it != it_end;
          ++it) {
       // Convert to storage cartesian
-      coords.append(OB2Eigen(cell->FractionalToCartesian
-                             (Eigen2OB(*it))));
+      coords.append(fracToCart * (*it));
     }
 
     updateMolecule(m_molecule, ids, coords);
     emit cellChanged();
   }
 
+  void CrystallographyExtension::setCurrentFractionalCoords
+  (const QList<int> &indices,
+   const QList<QString> &ids,
+   const QList<Eigen::Vector3d> &fcoords)
+  {
+    Q_ASSERT(indices.size() == ids.size() &&
+             indices.size() == fcoords.size());
+
+    const Eigen::Matrix3d fracToCart
+      (OB2Eigen(currentCell()->GetCellMatrix()).transpose());
+    QList<Eigen::Vector3d> coords;
+#if QT_VERSION >= 0x040700
+    coords.reserve(fcoords.size());
+#endif
+
+    for (int i = 0; i < fcoords.size(); ++i) {
+      // Convert to display cartesian
+      coords.append(convertLength(Eigen::Vector3d(fracToCart * fcoords[i])));
+    }
+
+    setCurrentCartesianCoords(indices, ids, coords);
+  }
+
   void CrystallographyExtension::setCurrentCartesianCoords
   (const QList<QString> &ids,
    const QList<Eigen::Vector3d> &coords)
@@ -1158,6 +1210,36 @@ namespace Avogadro
     emit cellChanged();
   }
 
+  void CrystallographyExtension::setCurrentCartesianCoords
+  (const QList<int> &indices,
+   const QList<QString> &ids,
+   const QList<Eigen::Vector3d> &coords)
+  {
+    Q_ASSERT(indices.size() == ids.size() &&
+             indices.size() == coords.size());
+
+    // Only touch the listed atoms, the remaining atoms and all bonds
+    // are kept as they are
+    {
+      QWriteLocker locker (m_molecule->lock());
+      for (int i = 0; i < indices.size(); ++i) {
+        Atom *atom = m_molecule->atom(indices[i]);
+        if (!atom) {
+          continue;
+        }
+        int atomicNum = OpenBabel::etab.GetAtomicNum
+          (ids[i].toStdString().c_str());
+        if (atom->atomicNumber() != atomicNum) {
+          atom->setAtomicNumber(atomicNum);
+        }
+        atom->setPos(unconvertLength(coords[i]));
+      }
+    }
+
+    m_molecule->update();
+    emit cellChanged();
+  }
+
   void CrystallographyExtension::setCurrentVolume(double volume)
   {
     // Get scaling factor
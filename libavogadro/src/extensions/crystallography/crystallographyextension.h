@@ -227,6 +227,7 @@ namespace Avogadro
     double unconvertAngle(double angle) const;
 
     // Molecule access functions
+    inline Molecule* currentMolecule() const {return m_molecule;}
     inline OpenBabel::OBUnitCell* currentCell() const {
       return (m_molecule) ? m_molecule->OBUnitCell() : 0 ;}
     Eigen::Matrix3d currentCellMatrix() const;
@@ -248,6 +249,14 @@ namespace Avogadro
                                     const QList<Eigen::Vector3d> &fcoords);
     void setCurrentCartesianCoords(const QList<QString> &ids,
                                    const QList<Eigen::Vector3d> &coords);
+    // Update only the atoms at @a indices, leaving the rest of the
+    // molecule untouched
+    void setCurrentFractionalCoords(const QList<int> &indices,
+                                    const QList<QString> &ids,
+                                    const QList<Eigen::Vector3d> &fcoords);
+    void setCurrentCartesianCoords(const QList<int> &indices,
+                                   const QList<QString> &ids,
+                                   const QList<Eigen::Vector3d> &coords);
     void setCurrentVolume(double volume);
 
     // Tool helpers/implementaions
@@ -349,9 +358,13 @@ namespace Avogadro
     // refresh limiting:
     bool m_editorRefreshPending;
 
+    // The cell last shown, to follow trajectories with a changing cell
+    Eigen::Matrix3d m_lastCellMatrix;
+
   private slots:
     // Hidden functions
     void refreshEditors_();
+    void refreshOnCellChange();
 
     // Actions
     void actionPerceiveSpacegroup();
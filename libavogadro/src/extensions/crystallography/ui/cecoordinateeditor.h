@@ -20,12 +20,12 @@
 
 #include "ceabstracteditor.h"
 
-#include <QtGui/QTextCharFormat>
-
 #include "ui_cecoordinateeditor.h"
 
 namespace Avogadro
 {
+  class CECoordinateModel;
+
   class CECoordinateEditor : public CEAbstractEditor
   {
     Q_OBJECT
@@ -48,16 +48,18 @@ namespace Avogadro
     // Enable the apply/reset buttons
     void enableButtons();
 
-    void validateEditor();
+    // Repaint the coordinates in the current units, without reading
+    // the molecule again
+    void refreshDisplay();
 
-    // Creates and pushes an undo action while setting the current
+    // Creates and pushes an undo action while setting the edited
     // coordinates
     void setCoords();
 
   private:
     Ui::CECoordinateEditor ui;
 
-    QTextCharFormat m_charFormat;
+    CECoordinateModel *m_model;
 
   };
 
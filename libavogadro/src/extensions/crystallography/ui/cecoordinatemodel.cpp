@@ -0,0 +1,288 @@
+/**********************************************************************
+  CECoordinateModel
+
+  Copyright (C) 2013 by Avogadro Developers
+
+  This file is part of the Avogadro molecular editor project.
+  For more information, see <http://avogadro.cc/>
+
+  This source code is released under the New BSD License, (the "License").
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+ ***********************************************************************/
+
+#include "cecoordinatemodel.h"
+
+#include "../ceundo.h"
+#include "../crystallographyextension.h"
+
+#include <avogadro/atom.h>
+#include <avogadro/molecule.h>
+
+#include <openbabel/mol.h>
+
+#include <Eigen/LU>
+
+#include <QtGui/QFont>
+
+#include <cmath>
+
+namespace Avogadro
+{
+  CECoordinateModel::CECoordinateModel(CrystallographyExtension *ext,
+                                       QObject *parent)
+    : QAbstractTableModel(parent),
+      m_ext(ext),
+      m_fcoords(3, 0),
+      m_cellMatrix(Eigen::Matrix3d::Identity()),
+      m_cellMatrixInverse(Eigen::Matrix3d::Identity())
+  {
+  }
+
+  CECoordinateModel::~CECoordinateModel()
+  {
+  }
+
+  int CECoordinateModel::rowCount(const QModelIndex &parent) const
+  {
+    if (parent.isValid()) {
+      return 0;
+    }
+    return m_atomicNumbers.size();
+  }
+
+  int CECoordinateModel::columnCount(const QModelIndex &parent) const
+  {
+    if (parent.isValid()) {
+      return 0;
+    }
+    return ColumnCount;
+  }
+
+  int CECoordinateModel::atomicNumber(int row) const
+  {
+    QMap<int, Edit>::const_iterator edit = m_edits.constFind(row);
+    if (edit != m_edits.constEnd()) {
+      return edit->atomicNumber;
+    }
+    return m_atomicNumbers[row];
+  }
+
+  Eigen::Vector3d CECoordinateModel::fractionalCoords(int row) const
+  {
+    QMap<int, Edit>::const_iterator edit = m_edits.constFind(row);
+    if (edit != m_edits.constEnd()) {
+      return edit->fcoords;
+    }
+    return m_fcoords.col(row);
+  }
+
+  Eigen::Vector3d CECoordinateModel::displayCoords(int row) const
+  {
+    if (m_ext->coordsCartFrac() == Fractional) {
+      return fractionalCoords(row);
+    }
+    return m_ext->convertLength
+      (Eigen::Vector3d(m_cellMatrix * fractionalCoords(row)));
+  }
+
+  QVariant CECoordinateModel::data(const QModelIndex &index, int role) const
+  {
+    if (!index.isValid() || index.row() >= m_atomicNumbers.size()) {
+      return QVariant();
+    }
+
+    switch (role) {
+    case Qt::DisplayRole:
+    case Qt::EditRole: {
+      if (index.column() == SymbolColumn) {
+        return QString(OpenBabel::etab.GetSymbol(atomicNumber(index.row())));
+      }
+      double value = displayCoords(index.row())[index.column() - XColumn];
+      // Remove negative zeros
+      if (fabs(value) < 1e-10) {
+        value = 0.0;
+      }
+      if (role == Qt::EditRole) {
+        return value;
+      }
+      return QString::number(value, 'f', 5);
+    }
+    case Qt::TextAlignmentRole:
+      if (index.column() == SymbolColumn) {
+        return int(Qt::AlignLeft | Qt::AlignVCenter);
+      }
+      return int(Qt::AlignRight | Qt::AlignVCenter);
+    case Qt::FontRole: {
+      QFont font (CE_FONT, CE_FONTSIZE);
+      // Highlight rows that will be changed by Apply
+      font.setBold(m_edits.contains(index.row()));
+      return font;
+    }
+    default:
+      return QVariant();
+    }
+  }
+
+  QVariant CECoordinateModel::headerData(int section,
+                                         Qt::Orientation orientation,
+                                         int role) const
+  {
+    if (role != Qt::DisplayRole) {
+      return QVariant();
+    }
+
+    if (orientation == Qt::Vertical) {
+      return section + 1;
+    }
+
+    const bool frac = (m_ext->coordsCartFrac() == Fractional);
+    switch (section) {
+    case SymbolColumn:
+      return tr("Element");
+    case XColumn:
+      return frac ? tr("a") : tr("x");
+    case YColumn:
+      return frac ? tr("b") : tr("y");
+    case ZColumn:
+      return frac ? tr("c") : tr("z");
+    default:
+      return QVariant();
+    }
+  }
+
+  Qt::ItemFlags CECoordinateModel::flags(const QModelIndex &index) const
+  {
+    if (!index.isValid()) {
+      return 0;
+    }
+    return Qt::ItemIsSelectable | Qt::ItemIsEnabled | Qt::ItemIsEditable;
+  }
+
+  bool CECoordinateModel::setData(const QModelIndex &index,
+                                  const QVariant &value, int role)
+  {
+    if (!index.isValid() || role != Qt::EditRole ||
+        index.row() >= m_atomicNumbers.size()) {
+      return false;
+    }
+
+    const int row = index.row();
+    Edit edit;
+    edit.atomicNumber = atomicNumber(row);
+    edit.fcoords = fractionalCoords(row);
+
+    if (index.column() == SymbolColumn) {
+      const QString symbol = value.toString().trimmed();
+      int atomicNum = OpenBabel::etab.GetAtomicNum
+        (symbol.toStdString().c_str());
+      if (symbol.isEmpty() || (atomicNum == 0 && symbol != "Xx")) {
+        emit rejected();
+        return false;
+      }
+      edit.atomicNumber = atomicNum;
+    }
+    else {
+      bool ok;
+      const double v = value.toDouble(&ok);
+      if (!ok) {
+        emit rejected();
+        return false;
+      }
+      const int component = index.column() - XColumn;
+      if (m_ext->coordsCartFrac() == Fractional) {
+        edit.fcoords[component] = v;
+      }
+      else {
+        Eigen::Vector3d cart (displayCoords(row));
+        cart[component] = v;
+        edit.fcoords = m_cellMatrixInverse * m_ext->unconvertLength(cart);
+      }
+    }
+
+    m_edits.insert(row, edit);
+    emit dataChanged(this->index(row, 0), this->index(row, ColumnCount - 1));
+    emit edited();
+    return true;
+  }
+
+  void CECoordinateModel::refresh()
+  {
+    Molecule *mol = m_ext->currentCell() ? m_ext->currentMolecule() : 0;
+    const QList<Atom*> atoms = mol ? mol->atoms() : QList<Atom*>();
+    const int oldRows = m_atomicNumbers.size();
+    const int rows = atoms.size();
+
+    if (rows != oldRows) {
+      beginResetModel();
+    }
+
+    m_edits.clear();
+    if (mol) {
+      m_cellMatrix = m_ext->unconvertLength
+        (m_ext->currentCellMatrix()).transpose();
+      m_cellMatrixInverse = m_cellMatrix.inverse();
+    }
+
+    // Gather the positions, then convert them all at once
+    Eigen::Matrix3Xd cart (3, rows);
+    m_atomicNumbers.resize(rows);
+    for (int i = 0; i < rows; ++i) {
+      m_atomicNumbers[i] = atoms[i]->atomicNumber();
+      cart.col(i) = *atoms[i]->pos();
+    }
+    m_fcoords = m_cellMatrixInverse * cart;
+
+    if (rows != oldRows) {
+      endResetModel();
+    }
+    else {
+      // Keep the scroll position and selection, only repaint
+      refreshDisplay();
+    }
+  }
+
+  void CECoordinateModel::refreshDisplay()
+  {
+    emit headerDataChanged(Qt::Horizontal, 0, ColumnCount - 1);
+    if (!m_atomicNumbers.isEmpty()) {
+      emit dataChanged(index(0, 0),
+                       index(m_atomicNumbers.size() - 1, ColumnCount - 1));
+    }
+  }
+
+  void CECoordinateModel::applyEdits()
+  {
+    if (m_edits.isEmpty()) {
+      return;
+    }
+
+    QList<int> indices;
+    QList<QString> ids;
+    QList<Eigen::Vector3d> fcoords;
+#if QT_VERSION >= 0x040700
+    indices.reserve(m_edits.size());
+    ids.reserve(m_edits.size());
+    fcoords.reserve(m_edits.size());
+#endif
+
+    for (QMap<int, Edit>::const_iterator it = m_edits.constBegin(),
+           it_end = m_edits.constEnd(); it != it_end; ++it) {
+      indices.append(it.key());
+      ids.append(OpenBabel::etab.GetSymbol(it->atomicNumber));
+      fcoords.append(it->fcoords);
+    }
+
+    CEUndoState before (m_ext);
+    m_ext->setCurrentFractionalCoords(indices, ids, fcoords);
+    CEUndoState after (m_ext);
+    m_ext->pushUndo(new CEUndoCommand (before, after,
+                                       (m_ext->coordsCartFrac() == Fractional)
+                                       ? tr("Set Fractional Coordinates")
+                                       : tr("Set Cartesian Coordinates")));
+  }
+}
@@ -0,0 +1,104 @@
+/**********************************************************************
+  CECoordinateModel
+
+  Copyright (C) 2013 by Avogadro Developers
+
+  This file is part of the Avogadro molecular editor project.
+  For more information, see <http://avogadro.cc/>
+
+  This source code is released under the New BSD License, (the "License").
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+***********************************************************************/
+
+#ifndef CECOORDINATEMODEL_H
+#define CECOORDINATEMODEL_H
+
+#include "config.h"
+
+#include <Eigen/Core>
+
+#include <QtCore/QAbstractTableModel>
+#include <QtCore/QMap>
+#include <QtCore/QVector>
+
+namespace Avogadro
+{
+  class CrystallographyExtension;
+
+  // Table model for the coordinate editor. The atomic numbers and the
+  // fractional coordinates of all atoms are cached in flat arrays; rows
+  // and their text are only produced when the view asks for them, so the
+  // cost of a refresh does not depend on how many rows are displayed.
+  class CECoordinateModel : public QAbstractTableModel
+  {
+    Q_OBJECT
+
+  public:
+    enum Column {
+      SymbolColumn = 0,
+      XColumn,
+      YColumn,
+      ZColumn,
+      ColumnCount
+    };
+
+    CECoordinateModel(CrystallographyExtension *ext, QObject *parent = 0);
+    virtual ~CECoordinateModel();
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const;
+    int columnCount(const QModelIndex &parent = QModelIndex()) const;
+    QVariant data(const QModelIndex &index, int role) const;
+    QVariant headerData(int section, Qt::Orientation orientation,
+                        int role) const;
+    Qt::ItemFlags flags(const QModelIndex &index) const;
+    bool setData(const QModelIndex &index, const QVariant &value,
+                 int role = Qt::EditRole);
+
+  signals:
+    // Emitted when a cell has been changed by the user
+    void edited();
+    // Emitted when a value entered by the user cannot be used
+    void rejected();
+
+  public slots:
+    // Re-read the atoms and the cell from the molecule. Pending edits
+    // are discarded.
+    void refresh();
+    // Repaint after a change of the length unit or of the
+    // cartesian/fractional display setting. Nothing is recomputed.
+    void refreshDisplay();
+    // Push the edited rows to the molecule as a single undo step
+    void applyEdits();
+
+  private:
+    struct Edit {
+      int atomicNumber;
+      Eigen::Vector3d fcoords;
+    };
+
+    int atomicNumber(int row) const;
+    Eigen::Vector3d fractionalCoords(int row) const;
+    // Position of @a row in the current display units and mode
+    Eigen::Vector3d displayCoords(int row) const;
+
+    CrystallographyExtension *m_ext;
+
+    QVector<int> m_atomicNumbers;
+    // Storage (angstrom) fractional coordinates, one column per atom
+    Eigen::Matrix3Xd m_fcoords;
+    // Storage cell matrix, columns are the cell vectors
+    Eigen::Matrix3d m_cellMatrix;
+    Eigen::Matrix3d m_cellMatrixInverse;
+
+    // Pending per-row changes, keyed by atom index
+    QMap<int, Edit> m_edits;
+  };
+
+}
+
+#endif
@@ -135,6 +135,8 @@ namespace Avogadro
     if (m_molecule) {
       connect(m_molecule, SIGNAL(atomAdded(Atom*)),
               this, SLOT(resetExtraAtomImages()));
+      connect(m_molecule, SIGNAL(primitivesAdded(PrimitiveList)),
+              this, SLOT(resetExtraAtomImages()));
       connect(m_molecule, SIGNAL(atomUpdated(Atom*)),
               this, SLOT(resetExtraAtomImages()));
       connect(m_molecule, SIGNAL(atomRemoved(Atom*)),
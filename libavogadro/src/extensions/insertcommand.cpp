@@ -32,11 +32,15 @@
 #include <avogadro/glwidget.h>
 #include <avogadro/toolgroup.h>
 
-#include <openbabel/mol.h>
-#include <openbabel/builder.h>
+#include <openbabel/data.h>
+
+#include <Eigen/Geometry>
 
 #include <QDebug>
 
+#include <cmath>
+#include <limits>
+
 namespace Avogadro {
 
   /////////////////////////////////////////////////////////////////////////////
@@ -53,9 +57,168 @@ namespace Avogadro {
     Molecule *molecule;
     Molecule moleculeCopy, generatedMolecule;
     GLWidget *widget;
-    int startAtom, endAtom; // if we're using OBBuilder::Connect()
+    int startAtom, endAtom; // if we're connecting the fragment to an atom
+
+    /**
+     * Find the direction of a free valence of @p atom and make room for the
+     * new bond. A bonded hydrogen is removed and its bond vector used, a
+     * selected hydrogen is replaced by its parent atom.
+     * @return The unit vector pointing from @p atom to the new neighbor.
+     */
+    static Eigen::Vector3d openValence(Molecule *mol, Atom *&atom);
+
+    /**
+     * Rotate the fragment about the new bond to the torsion keeping it
+     * furthest away from the surrounding atoms of the molecule.
+     */
+    static void resolveClashes(const Molecule *mol, const Atom *startAtom,
+                               Molecule &fragment, const Atom *endAtom);
+
+    /**
+     * Attach the fragment to the start atom. Only the fragment and the
+     * atoms around the junction are touched, the molecule is never
+     * converted as a whole.
+     * @return The atom of the fragment now bonded to the molecule.
+     */
+    Atom * attachFragment();
   };
 
+  Eigen::Vector3d InsertFragmentCommandPrivate::openValence(Molecule *mol,
+                                                            Atom *&atom)
+  {
+    if (atom->isHydrogen() && atom->neighbors().size()) {
+      // Replace the hydrogen with the new bond
+      Atom *hydrogen = atom;
+      atom = mol->atomById(hydrogen->neighbors()[0]);
+      Eigen::Vector3d v = *hydrogen->pos() - *atom->pos();
+      mol->removeAtom(hydrogen);
+      if (v.squaredNorm() > 1.0e-8)
+        return v.normalized();
+    }
+
+    // Use the first hydrogen bonded to a heavy atom
+    Eigen::Vector3d sum = Eigen::Vector3d::Zero();
+    foreach (unsigned long id, atom->neighbors()) {
+      Atom *nbr = mol->atomById(id);
+      if (!nbr)
+        continue;
+      Eigen::Vector3d v = *nbr->pos() - *atom->pos();
+      if (nbr->isHydrogen() && v.squaredNorm() > 1.0e-8) {
+        mol->removeAtom(nbr);
+        return v.normalized();
+      }
+      if (v.squaredNorm() > 1.0e-8)
+        sum += v.normalized();
+    }
+
+    // No hydrogen to replace, point away from the existing neighbors
+    if (sum.squaredNorm() > 1.0e-4)
+      return -sum.normalized();
+    if (atom->neighbors().size()) {
+      // Linear or symmetric neighborhood, use any perpendicular direction
+      Atom *nbr = mol->atomById(atom->neighbors()[0]);
+      if (nbr)
+        return (*nbr->pos() - *atom->pos()).unitOrthogonal();
+    }
+    return Eigen::Vector3d::UnitX();
+  }
+
+  void InsertFragmentCommandPrivate::resolveClashes(const Molecule *mol,
+                                                    const Atom *startAtom,
+                                                    Molecule &fragment,
+                                                    const Atom *endAtom)
+  {
+    const Eigen::Vector3d origin = *startAtom->pos();
+    const Eigen::Vector3d axis = (*endAtom->pos() - origin).normalized();
+
+    // Only atoms of the molecule within reach of the fragment matter
+    double reach = 0.0;
+    QList<Eigen::Vector3d> fragmentPos;
+    foreach (Atom *a, fragment.atoms()) {
+      if (a == endAtom)
+        continue; // on the rotation axis
+      fragmentPos.append(*a->pos() - origin);
+      reach = qMax(reach, fragmentPos.last().norm());
+    }
+    if (fragmentPos.isEmpty())
+      return;
+    reach += 3.0;
+
+    QList<Eigen::Vector3d> nearby;
+    foreach (Atom *a, mol->atoms()) {
+      if (a == startAtom)
+        continue;
+      Eigen::Vector3d v = *a->pos() - origin;
+      if (v.squaredNorm() < reach * reach)
+        nearby.append(v);
+    }
+    if (nearby.isEmpty())
+      return;
+
+    // Scan the torsion about the new bond in 10 degree steps
+    double bestAngle = 0.0, bestDistance = -1.0;
+    for (int step = 0; step < 36; ++step) {
+      double angle = step * M_PI / 18.0;
+      Eigen::AngleAxisd rotation(angle, axis);
+      double closest = std::numeric_limits<double>::max();
+      foreach (const Eigen::Vector3d &f, fragmentPos) {
+        Eigen::Vector3d p = rotation * f;
+        foreach (const Eigen::Vector3d &n, nearby)
+          closest = qMin(closest, (p - n).squaredNorm());
+      }
+      if (closest > bestDistance + 1.0e-6) {
+        bestDistance = closest;
+        bestAngle = angle;
+      }
+    }
+
+    if (bestAngle == 0.0)
+      return;
+    Eigen::AngleAxisd rotation(bestAngle, axis);
+    foreach (Atom *a, fragment.atoms())
+      a->setPos(Eigen::Vector3d(origin + rotation * (*a->pos() - origin)));
+  }
+
+  Atom * InsertFragmentCommandPrivate::attachFragment()
+  {
+    Atom *start = molecule->atomById(startAtom);
+    if (!start)
+      return 0;
+
+    // Protonate the fragment on its own, its junction hydrogen is then
+    // replaced by the new bond
+    Molecule fragment(generatedMolecule);
+    fragment.addHydrogens();
+    Atom *end = (endAtom == -1) ? fragment.atom(0) : fragment.atomById(endAtom);
+    if (!end)
+      return 0;
+
+    Eigen::Vector3d startDir = openValence(molecule, start);
+    Eigen::Vector3d endDir = openValence(&fragment, end);
+
+    // Place the fragment atom along the free valence of the start atom
+    // with its own free valence pointing back
+    double bondLength =
+      OpenBabel::etab.GetCovalentRad(start->atomicNumber()) +
+      OpenBabel::etab.GetCovalentRad(end->atomicNumber());
+    Eigen::Vector3d endPos = *start->pos() + startDir * bondLength;
+    Eigen::Quaterniond rotation;
+    rotation.setFromTwoVectors(endDir, -startDir);
+    Eigen::Vector3d pivot = *end->pos();
+    foreach (Atom *a, fragment.atoms())
+      a->setPos(Eigen::Vector3d(endPos + rotation * (*a->pos() - pivot)));
+
+    resolveClashes(molecule, start, fragment, end);
+
+    // Atoms of the fragment are appended in order
+    unsigned int offset = molecule->numAtoms();
+    unsigned int endIndex = end->index();
+    *molecule += fragment;
+    Atom *attached = molecule->atom(offset + endIndex);
+    molecule->addBond(start, attached, 1);
+    return attached;
+  }
+
   InsertFragmentCommand::InsertFragmentCommand(Molecule *molecule,
                                                const Molecule &generatedMolecule,
                                                GLWidget *widget,
@@ -86,56 +249,15 @@ namespace Avogadro {
   {
     unsigned int initialAtoms = d->molecule->numAtoms() - 1;
     bool emptyMol = (d->molecule->numAtoms() == 0);
-    Atom *endAtom, *startAtom;
 
     if (emptyMol)
       initialAtoms = 0;
 
-    *(d->molecule) += d->generatedMolecule;
-    // OK, now get the first atom of the newly placed fragment
-    // We need to do this before removing hydrogens
-    // (when all the indices will change)
-    if (d->endAtom == -1) {
-      // We'll connect to the first atom of the fragment
-      d->endAtom = initialAtoms + 1;
-      endAtom = d->molecule->atom(initialAtoms + 1);
-    } else {
-      endAtom = d->molecule->atomById(d->endAtom);
-    }
-
     // Do we need to connect the fragment to the original molecule?
-    if (d->startAtom != -1 && !emptyMol) {
-      // OK, first, we should see if this atom is a hydrogen
-      startAtom = d->molecule->atomById(d->startAtom);
-      if (startAtom->isHydrogen()) {
-        // get the bonded non-hydrogen and remove this atom
-        Atom *hydrogen = startAtom;
-        if (hydrogen->neighbors().size()) {
-          startAtom = d->molecule->atomById(hydrogen->neighbors()[0]); // the first bonded atom to this "H"
-          d->molecule->removeAtom(hydrogen);
-        }
-      } else { // heavy atom -- remove attached hydrogens
-        d->molecule->removeHydrogens(startAtom);
-      }
-
-      // same procedure as the start atom -- check if endAtom is an H
-      if (endAtom->isHydrogen()) {
-        // get the bonded non-hydrogen and remove this atom
-        Atom *hydrogen = endAtom;
-        if (hydrogen->neighbors().size()) {
-          endAtom = d->molecule->atomById(hydrogen->neighbors()[0]); // the first bonded atom to this "H"
-          d->molecule->removeAtom(hydrogen);
-        }
-      } else { // heavy atom -- remove attached hydrogens
-        d->molecule->removeHydrogens(endAtom);
-      }
-
-      OpenBabel::OBMol mol = d->molecule->OBMol();
-      // Open Babel indexes atoms from 1, not 0
-      OpenBabel::OBBuilder::Connect(mol, startAtom->index() + 1, endAtom->index() + 1);
-      d->molecule->setOBMol(&mol);
-      d->molecule->addHydrogens();
-    }
+    if (d->startAtom != -1 && !emptyMol)
+      d->attachFragment();
+    else
+      *(d->molecule) += d->generatedMolecule;
 
     // now tell the molecule to update
     d->molecule->update();
@@ -24,15 +24,19 @@
 #include <avogadro/primitive.h>
 #include <avogadro/glwidget.h>
 #include <avogadro/molecule.h>
+#include <avogadro/moleculesnapshot.h>
+#include <avogadro/surfacearea.h>
 
 #include <openbabel/mol.h>
 #include <openbabel/obconversion.h>
+#include <openbabel/data.h>
 
 #include <QtGui/QAction>
 #include <QtGui/QMessageBox>
 #include <QtCore/QString>
 #include <QtCore/QDebug>
 #include <QtCore/QTimer>
+#include <QtCore/QtConcurrentRun>
 
 #include <QtNetwork/QNetworkAccessManager>
 #include <QtNetwork/QNetworkReply>
@@ -42,19 +46,45 @@ using namespace OpenBabel;
 
 namespace Avogadro {
 
+  namespace {
+
+    // Runs in a worker thread, on copies of the atoms
+    MolecularSurface calculateSurface(std::vector<Eigen::Vector3d> positions,
+                                      std::vector<double> radii)
+    {
+      MolecularSurface result;
+      SurfaceArea surface;
+      result.valid = surface.calculate(positions, radii);
+      result.area = surface.totalArea();
+      result.atomAreas = surface.atomAreas();
+      // The volume is that of the van der Waals surface
+      surface.setProbeRadius(0.0);
+      surface.calculate(positions, radii);
+      result.volume = surface.volume();
+      return result;
+    }
+
+  }
+
   MolecularPropertiesExtension::MolecularPropertiesExtension(QObject *parent) : Extension(parent),
                                                                                 m_molecule(0), m_dialog(0),
                                                                                 m_inchi(),
                                                                                 m_network(0),
-                                                                                m_nameRequestPending(false)
+                                                                                m_nameRequestPending(false),
+                                                                                m_surfaceRequestPending(false),
+                                                                                m_surfaceOutdated(false)
   {
     QAction *action = new QAction(this);
     action->setText(tr("Molecule Properties..."));
     m_actions.append(action);
+    connect(&m_surfaceWatcher, SIGNAL(finished()),
+            this, SLOT(surfaceAreaFinished()));
   }
 
   MolecularPropertiesExtension::~MolecularPropertiesExtension()
-  {  }
+  {
+    m_surfaceWatcher.waitForFinished();
+  }
 
   QList<QAction *> MolecularPropertiesExtension::actions() const
   {
@@ -113,6 +143,8 @@ namespace Avogadro {
 
     connect(m_molecule, SIGNAL(atomAdded(Atom *)),
             this, SLOT(updateAtoms(Atom*)));
+    connect(m_molecule, SIGNAL(primitivesAdded(PrimitiveList)),
+            this, SLOT(update()));
     connect(m_molecule, SIGNAL(atomRemoved(Atom *)),
             this, SLOT(updateAtoms(Atom*)));
     connect(m_molecule, SIGNAL(atomUpdated(Atom *)),
@@ -158,6 +190,12 @@ namespace Avogadro {
     m_dialog->formulaLine->setText(formula);
     // we should actually handle charges with superscripts too (e.g., [SO4]-2)
 
+    if (!m_surfaceRequestPending) {
+      m_surfaceRequestPending = true;
+      // Large molecules take a while, so wait for edits to settle
+      QTimer::singleShot(250, this, SLOT(updateSurfaceArea()));
+    }
+
     m_dialog->energyLine->setText(format.arg(m_molecule->energy(), 0, 'f', 3));
     bool estimate = true; // estimated dipole
     m_dialog->dipoleMomentLine->setText(format.arg(m_molecule->dipoleMoment(&estimate).norm(), 0, 'f', 3));
@@ -258,6 +296,57 @@ namespace Avogadro {
     reply->deleteLater();
   }
 
+  void MolecularPropertiesExtension::updateSurfaceArea()
+  {
+    m_surfaceRequestPending = false;
+    if (m_dialog == NULL || m_molecule == NULL || !m_dialog->isVisible())
+      return;
+    // Start again with the latest atoms once the running one is done
+    if (m_surfaceWatcher.isRunning()) {
+      m_surfaceOutdated = true;
+      return;
+    }
+    m_surfaceOutdated = false;
+
+    const MoleculeSnapshot snapshot = m_molecule->snapshot();
+    std::vector<Eigen::Vector3d> positions(snapshot.numAtoms());
+    std::vector<double> radii(snapshot.numAtoms());
+    for (unsigned int i = 0; i < snapshot.numAtoms(); ++i) {
+      positions[i] = snapshot.atomPos(i);
+      radii[i] = etab.GetVdwRad(snapshot.atomicNumber(i));
+    }
+    m_surfaceMolecule = m_molecule;
+    m_surfaceWatcher.setFuture(QtConcurrent::run(calculateSurface,
+                                                 positions, radii));
+  }
+
+  void MolecularPropertiesExtension::surfaceAreaFinished()
+  {
+    // Results for a molecule that changed since are dropped, a request
+    // still waiting for its timer starts the next calculation
+    if (m_surfaceRequestPending)
+      return;
+    if (m_surfaceOutdated || m_surfaceMolecule != m_molecule) {
+      updateSurfaceArea();
+      return;
+    }
+    if (m_dialog == NULL || m_molecule == NULL)
+      return;
+
+    const MolecularSurface surface = m_surfaceWatcher.result();
+    QString format("%L1");
+    if (!surface.valid) {
+      m_dialog->surfaceAreaLine->setText(format.arg(0.0, 0, 'f', 2));
+      m_dialog->volumeLine->setText(format.arg(0.0, 0, 'f', 2));
+      return;
+    }
+    m_dialog->surfaceAreaLine->setText(format.arg(surface.area, 0, 'f', 2));
+    m_dialog->volumeLine->setText(format.arg(surface.volume, 0, 'f', 2));
+    // Keep the areas so atoms can be colored by them, set here in the GUI
+    // thread like every other edit of the molecule
+    m_molecule->setAtomAttribute("sasa", surface.atomAreas);
+  }
+
   void MolecularPropertiesExtension::requestIUPACName()
   {
     if (m_dialog == NULL || m_molecule == NULL)
@@ -32,6 +32,10 @@
 #include <QString>
 #include <QUndoCommand>
 #include <QCloseEvent>
+#include <QFutureWatcher>
+#include <QPointer>
+
+#include <vector>
 
 // Forward declarations
 class QNetworkAccessManager;
@@ -48,6 +52,19 @@ namespace Avogadro {
       }
     };
 
+  /**
+   * @internal
+   * Solvent accessible area and van der Waals volume of a molecule,
+   * calculated in the background.
+   */
+  struct MolecularSurface
+  {
+    bool valid;
+    double area;
+    double volume;
+    std::vector<double> atomAreas;
+  };
+
  class MolecularPropertiesExtension : public Extension
   {
     Q_OBJECT
@@ -88,6 +105,13 @@ namespace Avogadro {
       QString                m_inchi;
       QNetworkAccessManager *m_network;
       bool m_nameRequestPending;
+      bool m_surfaceRequestPending;
+
+      // The surface is calculated in the background and only while the
+      // dialog is shown, changes during a calculation start another one
+      QFutureWatcher<MolecularSurface> m_surfaceWatcher;
+      QPointer<Molecule> m_surfaceMolecule;
+      bool m_surfaceOutdated;
 
       void clearName();
 
@@ -95,6 +119,8 @@ namespace Avogadro {
       void requestIUPACName();
       void printSslErrors(QNetworkReply *reply, const QList<QSslError> &errors);
       void replyFinished(QNetworkReply*);
+      void updateSurfaceArea();
+      void surfaceAreaFinished();
 
   };
 
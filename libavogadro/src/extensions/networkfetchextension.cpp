@@ -25,35 +25,69 @@
 #include "networkfetchextension.h"
 
 #include <avogadro/molecule.h>
+#include <avogadro/moleculefile.h>
+#include <avogadro/cifreader.h>
+#include <avogadro/trajectoryreader.h>
 #include <avogadro/glwidget.h>
 #include <avogadro/toolgroup.h>
 
 #include <QtGui/QAction>
+#include <QtGui/QDesktopServices>
 #include <QtGui/QInputDialog>
 #include <QtGui/QMessageBox>
 #include <QtNetwork/QNetworkAccessManager>
+#include <QtNetwork/QNetworkDiskCache>
 #include <QtNetwork/QNetworkReply>
 #include <QtNetwork/QSslSocket>
+#include <QtCore/QBuffer>
 #include <QtCore/QFileInfo>
+#include <QtCore/QStringList>
 #include <QtCore/QDebug>
 
-#include <openbabel/mol.h>
 #include <openbabel/obconversion.h>
 #include <openbabel/format.h>
-//#include <openbabel/builder.h>
-//#include <openbabel/forcefield.h>
 
 namespace Avogadro
 {
   using OpenBabel::OBConversion;
-  using OpenBabel::OBMol;
   using OpenBabel::OBFormat;
-  /*using OpenBabel::OBBuilder;
-  using OpenBabel::OBForceField;*/
+
+  // Requests made by prefetch() only fill the cache
+  static const QNetworkRequest::Attribute PrefetchAttribute =
+    QNetworkRequest::User;
+  // Redirects followed by a prefetch
+  static const QNetworkRequest::Attribute RedirectsAttribute =
+    static_cast<QNetworkRequest::Attribute>(QNetworkRequest::User + 1);
+  // Reader options of the molecule requested
+  static const QNetworkRequest::Attribute OptionsAttribute =
+    static_cast<QNetworkRequest::Attribute>(QNetworkRequest::User + 2);
+  // Name the molecule requested is known by
+  static const QNetworkRequest::Attribute NameAttribute =
+    static_cast<QNetworkRequest::Attribute>(QNetworkRequest::User + 3);
+
+  // The format of a download: the suffix of the URL if it is known, else
+  // the content type, else the suffix of the name it was requested by
+  static QString downloadFormat(const QUrl &url, const QString &contentType,
+                                const QString &name)
+  {
+    OBConversion conv;
+    const QString suffix = QFileInfo(url.path()).suffix();
+    if (!suffix.isEmpty() && (CifReader::canRead(QString(), suffix)
+                              || TrajectoryReader::canRead(QString(), suffix)
+                              || conv.SetInFormat(suffix.toAscii())))
+      return suffix;
+    OBFormat *format = OBConversion::FormatFromMIME(contentType.toAscii());
+    if (format)
+      return format->GetID();
+    return QFileInfo(name).suffix();
+  }
 
   NetworkFetchExtension::NetworkFetchExtension(QObject* parent)
     : Extension(parent),
-      m_glwidget(0), m_molecule(0), m_network(0), m_moleculeName(0), m_redirects(0)
+      m_glwidget(0), m_offlineAction(0), m_molecule(0), m_network(0),
+      m_cache(0), m_moleculeName(0), m_redirects(0), m_offline(false),
+      m_cacheSize(100), m_pdbUrl("http://www.rcsb.org/pdb/files/"),
+      m_nihUrl("https://cactus.nci.nih.gov/chemical/structure/")
   {
     QAction* action = new QAction(this);
     action->setText(tr("Fetch from PDB..."));
@@ -64,9 +98,25 @@ namespace Avogadro
     action->setData("NIH");
     m_actions.append(action);
     action = new QAction(this);
+    action->setText(tr("Fetch biological assembly from PDB..."));
+    action->setData("Assembly");
+    m_actions.append(action);
+    action = new QAction(this);
     action->setText(tr("Fetch from URL..."));
     action->setData("URL");
     m_actions.append(action);
+    action = new QAction(this);
+    action->setSeparator(true);
+    m_actions.append(action);
+    m_offlineAction = new QAction(this);
+    m_offlineAction->setText(tr("Work Offline"));
+    m_offlineAction->setData("Offline");
+    m_offlineAction->setCheckable(true);
+    m_actions.append(m_offlineAction);
+    action = new QAction(this);
+    action->setText(tr("Clear Download Cache"));
+    action->setData("ClearCache");
+    m_actions.append(action);
   }
 
   NetworkFetchExtension::~NetworkFetchExtension()
@@ -84,20 +134,79 @@ namespace Avogadro
     return tr("&File") + '>' + tr("Import");
   }
 
+  void NetworkFetchExtension::initializeNetwork()
+  {
+    if (m_network)
+      return;
+    m_network = new QNetworkAccessManager(this);
+    // Downloads are kept on disk between sessions, the cache takes care of
+    // the validation headers and of the size limit
+    m_cache = new QNetworkDiskCache(this);
+    m_cache->setCacheDirectory(m_cacheDirectory.isEmpty()
+      ? QDesktopServices::storageLocation(QDesktopServices::CacheLocation)
+        + "/networkfetch" : m_cacheDirectory);
+    m_cache->setMaximumCacheSize(qint64(m_cacheSize) * 1024 * 1024);
+    m_network->setCache(m_cache);
+    connect(m_network, SIGNAL(finished(QNetworkReply*)),
+            this, SLOT(replyFinished(QNetworkReply*)));
+    connect(m_network, SIGNAL(sslErrors(QNetworkReply*, const QList<QSslError>&)),
+            this, SLOT(printSslErrors(QNetworkReply*, const QList<QSslError>&)));
+  }
+
+  QNetworkRequest NetworkFetchExtension::request(const QUrl &url,
+                                                 bool preferCache) const
+  {
+    QNetworkRequest request(url);
+    if (m_offline)
+      request.setAttribute(QNetworkRequest::CacheLoadControlAttribute,
+                           QNetworkRequest::AlwaysCache);
+    else if (preferCache)
+      request.setAttribute(QNetworkRequest::CacheLoadControlAttribute,
+                           QNetworkRequest::PreferCache);
+    return request;
+  }
+
+  void NetworkFetchExtension::prefetch(const QUrl &url, int redirects)
+  {
+    if (m_offline || m_cache->metaData(url).isValid())
+      return;
+    QNetworkRequest prefetchRequest = request(url, true);
+    prefetchRequest.setAttribute(PrefetchAttribute, true);
+    prefetchRequest.setAttribute(RedirectsAttribute, redirects);
+    prefetchRequest.setPriority(QNetworkRequest::LowPriority);
+    m_network->get(prefetchRequest);
+  }
+
+  void NetworkFetchExtension::fetch(const QUrl &url, const QString &name,
+                                    bool preferCache, const QString &options)
+  {
+    if (!m_moleculeName)
+      m_moleculeName = new QString;
+    initializeNetwork();
+    m_redirects = 0;
+    m_urlRequest = url;
+    QNetworkRequest fetchRequest = request(url, preferCache);
+    fetchRequest.setAttribute(NameAttribute, name);
+    if (!options.isEmpty())
+      fetchRequest.setAttribute(OptionsAttribute, options);
+    m_network->get(fetchRequest);
+    *m_moleculeName = name;
+  }
+
   QUndoCommand* NetworkFetchExtension::performAction(QAction *action,
                                                      GLWidget *widget)
   {
     m_glwidget = widget;
-    if (!m_moleculeName)
-      m_moleculeName = new QString;
-    if (!m_network) {
-      m_network = new QNetworkAccessManager(this);
-      connect(m_network, SIGNAL(finished(QNetworkReply*)),
-              this, SLOT(replyFinished(QNetworkReply*)));
-      connect(m_network, SIGNAL(sslErrors(QNetworkReply*, const QList<QSslError>&)),
-              this, SLOT(printSslErrors(QNetworkReply*, const QList<QSslError>&)));
+    initializeNetwork();
+    if (action->data() == "Offline") {
+      m_offline = action->isChecked();
+      return 0;
+    }
+    else if (action->data() == "ClearCache") {
+      m_cache->clear();
+      return 0;
     }
-    if (action->data() == "PDB") {
+    else if (action->data() == "PDB") {
       // Prompt for a PDB name
       bool ok;
       QString pdbName = QInputDialog::getText(qobject_cast<QWidget*>(parent()),
@@ -107,10 +216,26 @@ namespace Avogadro
                                               "", &ok);
       if (!ok || pdbName.isEmpty())
         return 0;
-      // Hard coding the PDB download URL - this could be used for other services
-      m_network->get(QNetworkRequest(QUrl("http://www.rcsb.org/pdb/files/" + pdbName + ".pdb")));
-
-      *m_moleculeName = pdbName + ".pdb";
+      fetch(QUrl(m_pdbUrl + pdbName + ".pdb"), pdbName + ".pdb", true);
+      // The mmCIF entry has all the models and the assemblies
+      prefetch(QUrl(m_pdbUrl + pdbName + ".cif"));
+    }
+    else if (action->data() == "Assembly") {
+      // Prompt for a PDB name and the assembly
+      bool ok;
+      QString text = QInputDialog::getText(qobject_cast<QWidget*>(parent()),
+                                           tr("PDB Entry"),
+                                           tr("PDB entry to download, optionally followed by the assembly number."),
+                                           QLineEdit::Normal,
+                                           "", &ok);
+      QStringList words = text.simplified().split(' ', QString::SkipEmptyParts);
+      if (!ok || words.isEmpty())
+        return 0;
+      const QString pdbName = words.at(0);
+      const QString assembly = words.value(1, "1");
+      // Read by CifReader, which builds the assembly from the mmCIF file
+      fetch(QUrl(m_pdbUrl + pdbName + ".cif"), pdbName + ".cif", true,
+            "assembly " + assembly);
     }
     else if (action->data() == "NIH") {
       // Prompt for a chemical structure name
@@ -122,13 +247,9 @@ namespace Avogadro
                                                     "", &ok);
       if (!ok || structureName.isEmpty())
         return 0;
-      // Hard coding the NIH resolver download URL - this could be used for other services
-      m_network->get(QNetworkRequest(
-          QUrl("https://cactus.nci.nih.gov/chemical/structure/" + structureName + "/sdf?get3d=true"
-               + "&resolver=name_by_opsin,name_by_cir,name_by_chemspider"
-               + "&requester=Avogadro")));
-
-      *m_moleculeName = structureName + ".sdf";
+      fetch(QUrl(m_nihUrl + structureName + "/sdf?get3d=true"
+                 + "&resolver=name_by_opsin,name_by_cir,name_by_chemspider"
+                 + "&requester=Avogadro"), structureName + ".sdf", true);
     }
     else if (action->data() == "URL") {
       // Prompt for a URL
@@ -140,15 +261,12 @@ namespace Avogadro
                                           "", &ok);
       if (!ok || url.isEmpty())
         return 0;
-      // Arbitrary URL
-      m_redirects = 0;
-      m_urlRequest = QUrl(url);
-      m_network->get(QNetworkRequest( m_urlRequest ));
-
-      *m_moleculeName = url;
+      // Arbitrary URL, the server is asked if the cached copy changed
+      fetch(QUrl(url), url, false);
     }
 
-    widget->toolGroup()->setActiveTool("Navigate");
+    if (widget)
+      widget->toolGroup()->setActiveTool("Navigate");
 
     return 0;
   }
@@ -156,12 +274,26 @@ namespace Avogadro
   void NetworkFetchExtension::writeSettings(QSettings &settings) const
   {
     Extension::writeSettings(settings);
-
+    settings.setValue("offline", m_offline);
+    settings.setValue("cacheSize", m_cacheSize);
+    settings.setValue("pdbUrl", m_pdbUrl);
+    settings.setValue("nihUrl", m_nihUrl);
+    settings.setValue("cacheDirectory", m_cacheDirectory);
   }
 
   void NetworkFetchExtension::readSettings(QSettings &settings)
   {
     Extension::readSettings(settings);
+    m_offline = settings.value("offline", false).toBool();
+    m_offlineAction->setChecked(m_offline);
+    m_cacheSize = settings.value("cacheSize", 100).toInt();
+    if (m_cache)
+      m_cache->setMaximumCacheSize(qint64(m_cacheSize) * 1024 * 1024);
+    m_pdbUrl = settings.value("pdbUrl", "http://www.rcsb.org/pdb/files/").toString();
+    m_nihUrl = settings.value("nihUrl",
+                              "https://cactus.nci.nih.gov/chemical/structure/").toString();
+    // Only used when the cache is created
+    m_cacheDirectory = settings.value("cacheDirectory").toString();
   }
 
   void NetworkFetchExtension::setMolecule(Molecule *molecule)
@@ -197,9 +329,28 @@ namespace Avogadro
 
   void NetworkFetchExtension::replyFinished(QNetworkReply *reply)
   {
+    const bool prefetched = reply->request().attribute(PrefetchAttribute).toBool();
+
     // Print error messages
     if (reply->error() != QNetworkReply::NoError) {
       qDebug() << tr("Network Error: %1").arg(reply->errorString());
+      // Offline, a missing cache entry is the only likely error
+      if (m_offline && !prefetched)
+        QMessageBox::warning(qobject_cast<QWidget*>(parent()),
+                             tr("Network Download Failed"),
+                             tr("%1 is not in the download cache.").arg(*m_moleculeName));
+      reply->deleteLater();
+      return;
+    }
+
+    // Prefetched data is in the cache now, only redirects need more work
+    if (prefetched) {
+      const QUrl target =
+        reply->attribute(QNetworkRequest::RedirectionTargetAttribute).toUrl();
+      const int redirects = reply->request().attribute(RedirectsAttribute).toInt();
+      if (!target.isEmpty() && redirects < 10)
+        prefetch(reply->url().resolved(target), redirects + 1);
+      reply->deleteLater();
       return;
     }
 
@@ -223,7 +374,9 @@ namespace Avogadro
     // If we have a non-empty request, we need to try again
     if(!m_urlRequest.isEmpty()) {
       /* We'll do another request to the redirection url. */
-      m_network->get(QNetworkRequest( m_urlRequest ));
+      QNetworkRequest redirected = reply->request();
+      redirected.setUrl(m_urlRequest);
+      m_network->get(redirected);
       qDebug() << " handling redirect " << m_urlRequest;
       reply->deleteLater();
       return; // don't try to fetch, because it's not real data
@@ -232,8 +385,10 @@ namespace Avogadro
     // OK, we have our real data
     QByteArray data = reply->readAll();
 
-    // Check if the file was successfully downloaded
+    // Check if the file was successfully downloaded, an error page is served
+    // as a normal reply and must not be read from the cache next time
     if (data.contains("Error report")) {
+      m_cache->remove(reply->url());
       QMessageBox::warning(qobject_cast<QWidget*>(parent()),
                            tr("Network Download Failed"),
                            tr("Specified molecule could not be found: %1").arg(*m_moleculeName));
@@ -241,40 +396,25 @@ namespace Avogadro
       return;
     }
 
-    QString strData(data);
-    QFileInfo info(m_urlRequest.path());
-    QString contentType(reply->header(QNetworkRequest::ContentTypeHeader).toString());
-    OBConversion conv;
-
-    qDebug() << " parsing " << strData.length() << " format "<< info.suffix() << " mime: " << contentType;
-
-    if ( info.suffix().isEmpty() || !conv.SetInFormat(info.suffix().toAscii()) ) {
-      // we might not get an extension, so
-      // try to guess from the content type
-      OBFormat *format = OBConversion::FormatFromMIME(contentType.toAscii());
-      if (!format || !conv.SetInFormat(format)) {
-        // last try, use the m_moleculeName
-        info.setFile(*m_moleculeName);
-        if ( info.suffix().isEmpty() || !conv.SetInFormat(info.suffix().toAscii()) ) {
-          // nothing is working!
-          return;
-        }
-      }
-    }
-
-    // Now read it in with OpenBabel - we should add a wrapper class to automate
-    OBMol *obmol = new OBMol;
-    if (conv.ReadString(obmol, QString(data).toStdString())) {
-      Molecule *mol = new Molecule;
-      mol->setOBMol(obmol);
-      mol->setFileName(*m_moleculeName);
+    // Read like a file of the same name, CIF and trajectories by the native
+    // readers and everything else by OpenBabel
+    const QString name = reply->request().attribute(NameAttribute).toString();
+    const QString fileType =
+      downloadFormat(reply->url(), reply->header(QNetworkRequest::ContentTypeHeader).toString(), name);
+    QBuffer buffer(&data);
+    QString error;
+    Molecule *mol = MoleculeFile::readMolecule(&buffer, name, fileType,
+      reply->request().attribute(OptionsAttribute).toString(), &error);
+    if (mol) {
       emit moleculeChanged(mol, Extension::DeleteOld | Extension::NewWindow);
       m_molecule = mol;
     }
     else {
+      m_cache->remove(reply->url());
       QMessageBox::warning(qobject_cast<QWidget*>(parent()),
                            tr("Network Download Failed"),
-                           tr("Specified molecule could not be loaded: %1").arg(*m_moleculeName));
+                           tr("Specified molecule could not be loaded: %1\n%2")
+                           .arg(name).arg(error));
     }
     // We are responsible for deleting the reply object
     reply->deleteLater();
@@ -30,7 +30,9 @@
 #include <QtCore/QUrl>
 
 class QNetworkAccessManager;
+class QNetworkDiskCache;
 class QNetworkReply;
+class QNetworkRequest;
 class QSslError;
 class QString;
 
@@ -75,6 +77,15 @@ namespace Avogadro
      */
     virtual void readSettings(QSettings &settings);
 
+    /**
+     * Download @p url and emit moleculeChanged() with the molecule read from
+     * it. The download is read like a file called @p name, with the
+     * newline separated reader @p options, see MoleculeFile::readMolecule().
+     * With @p preferCache a cached copy is used without asking the server.
+     */
+    void fetch(const QUrl &url, const QString &name, bool preferCache,
+               const QString &options = QString());
+
   public slots:
 
     /**
@@ -83,14 +94,42 @@ namespace Avogadro
     void setMolecule(Molecule *molecule);
 
   private:
+    /**
+     * Create the network access manager and its disk cache on first use.
+     */
+    void initializeNetwork();
+
+    /**
+     * @return A request for @p url. Entries of the databases do not change,
+     * so with @p preferCache a cached copy is used without asking the
+     * server. Offline only the cache is used.
+     */
+    QNetworkRequest request(const QUrl &url, bool preferCache) const;
+
+    /**
+     * Download @p url into the cache in the background, the reply is not
+     * loaded.
+     */
+    void prefetch(const QUrl &url, int redirects = 0);
+
     GLWidget* m_glwidget;
     QList<QAction *> m_actions;
+    QAction *m_offlineAction;
     Molecule *m_molecule;
     QNetworkAccessManager *m_network;
+    QNetworkDiskCache *m_cache;
     QString *m_moleculeName;
     QUrl m_urlRequest;
     int m_redirects;
 
+    // Cache settings, the base URLs can point to a local mirror and an
+    // empty cache directory is in the user's cache location
+    bool m_offline;
+    int m_cacheSize;
+    QString m_pdbUrl;
+    QString m_nihUrl;
+    QString m_cacheDirectory;
+
   private slots:
     void replyFinished(QNetworkReply*);
     void printSslErrors(QNetworkReply *reply, const QList<QSslError> &errors);
@@ -127,6 +127,7 @@ void OrcaAnalyseDialog::setMolecule(Molecule *molecule)
 
     connect(m_molecule, SIGNAL(atomRemoved(Atom *)), this, SLOT(forceFileReload(Atom*)));
     connect(m_molecule, SIGNAL(atomAdded(Atom *)), this, SLOT(forceFileReload(Atom*)));
+    connect(m_molecule, SIGNAL(primitivesAdded(PrimitiveList)), this, SLOT(forceFileReload(PrimitiveList)));
     connect(m_molecule, SIGNAL(atomUpdated(Atom *)), this, SLOT(forceFileReload(Atom*)));
 
 //    if (molecule->fileName() != "")  m_fileLabel->setText(molecule->fileName());
@@ -159,6 +160,12 @@ void OrcaAnalyseDialog::forceFileReload(Atom *atom)
 
     ui.animationGroup->setEnabled(false);
 }
+void OrcaAnalyseDialog::forceFileReload(const PrimitiveList &primitives)
+{
+    // Atoms merged in bulk are not announced one at a time
+    if (!primitives.subList(Primitive::AtomType).isEmpty())
+        forceFileReload(static_cast<Atom*>(0));
+}
 void OrcaAnalyseDialog::orcaWarningMessage(const QString &m)
 {
     QMessageBox msgBox;
@@ -1178,6 +1185,7 @@ QString OrcaAnalyseDialog::readOutputFile()
     m_molecule = newMol;
     connect(m_molecule, SIGNAL(atomRemoved(Atom *)), this, SLOT(forceFileReload(Atom*)));
     connect(m_molecule, SIGNAL(atomAdded(Atom *)), this, SLOT(forceFileReload(Atom*)));
+    connect(m_molecule, SIGNAL(primitivesAdded(PrimitiveList)), this, SLOT(forceFileReload(PrimitiveList)));
     connect(m_molecule, SIGNAL(atomUpdated(Atom *)), this, SLOT(forceFileReload(Atom*)));
     m_molecule->update();
 
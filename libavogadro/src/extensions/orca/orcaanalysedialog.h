@@ -30,6 +30,7 @@
 #include <avogadro/glwidget.h>
 #include <avogadro/extension.h>
 #include <avogadro/fragment.h>
+#include <avogadro/primitivelist.h>
 #include <openbabel/mol.h>
 
 #include <avogadro/animation.h>
@@ -91,6 +92,7 @@ private slots:
     void selectVibration(int n, int m);
     void setVibration(int n);
     void forceFileReload(Atom* atom);
+    void forceFileReload(const PrimitiveList &primitives);
 
     void selectFragment();
 
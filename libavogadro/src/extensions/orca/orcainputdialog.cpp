@@ -510,6 +510,8 @@ OrcaInputDialog::OrcaInputDialog(QWidget *parent, Qt::WindowFlags f ) :
                   this, SLOT(updatePreviewText()));
           connect(m_molecule, SIGNAL(atomAdded(Atom *)),
                   this, SLOT(updatePreviewText()));
+          connect(m_molecule, SIGNAL(primitivesAdded(PrimitiveList)),
+                  this, SLOT(updatePreviewText()));
           connect(m_molecule, SIGNAL(atomUpdated(Atom *)),
                   this, SLOT(updatePreviewText()));
 
@@ -46,7 +46,7 @@ namespace Avogadro
   {
   public:
     POVPainterPrivate() : pd (0), initialized (false), sharing(0),
-    color(0), output(0), planeNormalVector(0., 0., 0.)
+    color(0), output(0), planeNormalVector(0., 0., 0.), meshTriangles(0)
     {
       color.setFromRgba(0., 0., 0., 0.);
     }
@@ -68,6 +68,7 @@ namespace Avogadro
     Color color;
     QTextStream *output;
     Vector3d planeNormalVector;
+    unsigned int meshTriangles;
   };
 
 
@@ -108,6 +109,11 @@ namespace Avogadro
     d->planeNormalVector = planeNormalVector;
   }
 
+  void POVPainter::setMeshTriangles(unsigned int triangles)
+  {
+    d->meshTriangles = triangles;
+  }
+
   void POVPainter::drawSphere (const Vector3d &center, double radius)
   {
     // Write out a POVRay sphere for rendering
@@ -219,8 +225,9 @@ namespace Avogadro
     }
 
     // Render the triangles of the mesh
-    std::vector<Eigen::Vector3f> t = mesh.vertices();
-    std::vector<Eigen::Vector3f> n = mesh.normals();
+    const Mesh *level = mesh.levelForTriangles(d->meshTriangles);
+    std::vector<Eigen::Vector3f> t = level->vertices();
+    std::vector<Eigen::Vector3f> n = level->normals();
 
     // If there are no triangles then don't bother doing anything
     if (t.size() == 0)
@@ -285,9 +292,10 @@ namespace Avogadro
     }
 
     // Render the triangles of the mesh
-    std::vector<Eigen::Vector3f> v = mesh.vertices();
-    std::vector<Eigen::Vector3f> n = mesh.normals();
-    std::vector<Color3f> c = mesh.colors();
+    const Mesh *level = mesh.levelForTriangles(d->meshTriangles);
+    std::vector<Eigen::Vector3f> v = level->vertices();
+    std::vector<Eigen::Vector3f> n = level->normals();
+    std::vector<Color3f> c = level->colors();
 
     // If there are no triangles then don't bother doing anything
     if (v.size() == 0 || v.size() != c.size())
@@ -399,12 +407,14 @@ namespace Avogadro
 
   POVPainterDevice::POVPainterDevice(const QString& filename,
                                      double aspectRatio,
-                                     const GLWidget* glwidget)
+                                     const GLWidget* glwidget,
+                                     unsigned int meshTriangles)
   {
     m_output = 0;
     m_aspectRatio = aspectRatio;
     m_glwidget = glwidget;
     m_painter = new POVPainter;
+    m_painter->setMeshTriangles(meshTriangles);
     m_file = new QFile(filename);
     if (!m_file->open(QIODevice::WriteOnly | QIODevice::Text))
       return;
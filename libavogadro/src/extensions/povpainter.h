@@ -117,6 +117,14 @@ namespace Avogadro
      */
     void setPlaneNormal(Vector3d planeNormalVector);
 
+    /**
+     * Limit the number of triangles written for each mesh, meshes with more
+     * triangles are written from a simplified level, see Mesh::level().
+     * @param triangles The largest number of triangles, 0 (the default)
+     * writes all meshes at full detail.
+     */
+    void setMeshTriangles(unsigned int triangles);
+
     /**
      * Draws a sphere, leaving the Painter choose the appropriate detail level based on the
      * apparent radius (ratio of radius over distance) and the global quality setting.
@@ -345,7 +353,13 @@ namespace Avogadro
   class POVPainterDevice : public PainterDevice
   {
   public:
-    POVPainterDevice(const QString& filename, double aspectRatio, const GLWidget* glwidget);
+    /**
+     * Write the scene of @p glwidget to @p filename. Meshes are written with
+     * at most @p meshTriangles triangles if they have simplified levels, 0
+     * writes them at full detail.
+     */
+    POVPainterDevice(const QString& filename, double aspectRatio,
+                     const GLWidget* glwidget, unsigned int meshTriangles = 0);
     ~POVPainterDevice();
 
     void initializePOV();
@@ -199,6 +199,7 @@ namespace Avogadro
     }
 
     connect(m_molecule, SIGNAL(moleculeChanged()), model, SLOT(moleculeChanged()));
+    connect(m_molecule, SIGNAL(primitivesAdded(PrimitiveList)), model, SLOT(moleculeChanged()));
     connect(m_molecule, SIGNAL( updated() ), model, SLOT( updateTable() ));
 
     QSortFilterProxyModel* proxyModel = new QSortFilterProxyModel(this);
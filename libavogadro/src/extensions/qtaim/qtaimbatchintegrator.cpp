@@ -0,0 +1,260 @@
+/**********************************************************************
+  QTAIM - Extension for Quantum Theory of Atoms In Molecules Analysis
+
+  Copyright (C) 2013 Avogadro Developers
+
+  This file is part of the Avogadro molecular editor project.
+  For more information, see <http://avogadro.cc/>
+
+  Avogadro is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  Avogadro is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+  02110-1301, USA.
+**********************************************************************/
+
+#include "qtaimbatchintegrator.h"
+
+#include <cmath>
+
+namespace Avogadro
+{
+  // Same tolerance and path length as the steepest ascent mode of
+  // QTAIMODEIntegrator
+  static const qreal absoluteError=1.e-5;
+  static const qreal pathLength=10.0;
+
+  static const qreal initialStep=0.05;
+  // Not larger than the beta spheres, so a path cannot step over one
+  static const qreal maximumStep=0.1;
+  static const qreal minimumStep=1.e-8;
+
+  // Below this the gradient has no direction, the path is at a critical point
+  static const qreal gradientTolerance=1.e-15;
+
+  // Runge-Kutta-Fehlberg 4(5), the same scheme as r8_fehl
+  static const qreal rkfA[6][5]=
+  {
+    { 0.0, 0.0, 0.0, 0.0, 0.0 },
+    { 1.0/4.0, 0.0, 0.0, 0.0, 0.0 },
+    { 3.0/32.0, 9.0/32.0, 0.0, 0.0, 0.0 },
+    { 1932.0/2197.0, -7200.0/2197.0, 7296.0/2197.0, 0.0, 0.0 },
+    { 439.0/216.0, -8.0, 3680.0/513.0, -845.0/4104.0, 0.0 },
+    { -8.0/27.0, 2.0, -3544.0/2565.0, 1859.0/4104.0, -11.0/40.0 }
+  };
+  // Fifth order solution
+  static const qreal rkfB[6]=
+  { 16.0/135.0, 0.0, 6656.0/12825.0, 28561.0/56430.0, -9.0/50.0, 2.0/55.0 };
+  // Difference between the fifth and fourth order solutions
+  static const qreal rkfE[6]=
+  { 1.0/360.0, 0.0, -128.0/4275.0, -2197.0/75240.0, 1.0/50.0, 2.0/55.0 };
+
+  QTAIMBatchIntegrator::QTAIMBatchIntegrator(QTAIMWavefunctionEvaluator &eval, const qint64 lanes)
+  {
+    m_eval=&eval;
+    m_lanes=qMax((qint64) 1, lanes);
+    m_recordPaths=false;
+  }
+
+  void QTAIMBatchIntegrator::direction(const Matrix<qreal,3,Dynamic> &xyz,
+                                       Matrix<qreal,3,Dynamic> &unit,
+                                       Array<qreal,1,Dynamic> &norm)
+  {
+    m_eval->electronDensityAndGradientAtPoints(xyz, m_density, m_gradient);
+
+    norm=m_gradient.colwise().norm().array();
+    unit.resize(3,xyz.cols());
+    for( qint64 l=0 ; l < xyz.cols() ; ++l )
+    {
+      if( norm(l) > gradientTolerance )
+      {
+        unit.col(l)=m_gradient.col(l)/norm(l);
+      }
+      else
+      {
+        unit.col(l).setZero();
+      }
+    }
+  }
+
+  QList<QVector3D> QTAIMBatchIntegrator::integrate(const QList<QVector3D> &x0y0z0)
+  {
+    const qint64 npaths=x0y0z0.length();
+
+    m_status.fill(ReachedEndOfPath, npaths);
+    m_associatedSphere.fill(-1, npaths);
+    m_paths.clear();
+    if( m_recordPaths )
+    {
+      m_paths.resize(npaths);
+    }
+    QVector<QVector3D> endpoints(npaths);
+
+    // Lane state, only the first nlanes columns are in use
+    Matrix<qreal,3,Dynamic> y(3,m_lanes);
+    Array<qreal,1,Dynamic> t(m_lanes);
+    Array<qreal,1,Dynamic> h(m_lanes);
+    QVector<qint64> lanePath(m_lanes);
+    QVector<bool> finished(m_lanes);
+    qint64 nlanes=0;
+    qint64 next=0;
+
+    Matrix<qreal,3,Dynamic> k[6];
+    Matrix<qreal,3,Dynamic> ys;
+    Array<qreal,1,Dynamic> norm;
+
+    for(;;)
+    {
+      // Refill the retired lanes from the queue
+      while( nlanes < m_lanes && next < npaths )
+      {
+        y.col(nlanes) << x0y0z0.at(next).x(), x0y0z0.at(next).y(), x0y0z0.at(next).z();
+        t(nlanes)=0.0;
+        h(nlanes)=initialStep;
+        lanePath[nlanes]=next;
+        if( m_recordPaths )
+        {
+          m_paths[next].append(x0y0z0.at(next));
+        }
+        ++nlanes;
+        ++next;
+      }
+
+      if( nlanes == 0 )
+      {
+        break;
+      }
+
+      const Matrix<qreal,3,Dynamic> y0=y.leftCols(nlanes);
+      const Matrix<qreal,Dynamic,1> step=h.head(nlanes).matrix().transpose();
+
+      finished.fill(false);
+      bool anyFinished=false;
+
+      direction(y0, k[0], norm);
+      for( qint64 l=0 ; l < nlanes ; ++l )
+      {
+        if( !(norm(l) > gradientTolerance) )
+        {
+          qint64 path=lanePath.at(l);
+          m_status[path]=ReachedCriticalPoint;
+          endpoints[path]=QVector3D(y0(0,l),y0(1,l),y0(2,l));
+          finished[l]=true;
+          anyFinished=true;
+        }
+      }
+
+      if( !anyFinished )
+      {
+        // All lanes take one step together, each with its own step size
+        for( qint64 s=1 ; s < 6 ; ++s )
+        {
+          ys=y0;
+          for( qint64 j=0 ; j < s ; ++j )
+          {
+            if( rkfA[s][j] != 0.0 )
+            {
+              ys.noalias() += rkfA[s][j] * k[j] * step.asDiagonal();
+            }
+          }
+          direction(ys, k[s], norm);
+        }
+
+        Matrix<qreal,3,Dynamic> y5=y0;
+        Matrix<qreal,3,Dynamic> error=Matrix<qreal,3,Dynamic>::Zero(3,nlanes);
+        for( qint64 j=0 ; j < 6 ; ++j )
+        {
+          y5.noalias() += rkfB[j] * k[j] * step.asDiagonal();
+          error.noalias() += rkfE[j] * k[j] * step.asDiagonal();
+        }
+        const Array<qreal,1,Dynamic> errorNorm=error.colwise().norm().array();
+
+        for( qint64 l=0 ; l < nlanes ; ++l )
+        {
+          const qint64 path=lanePath.at(l);
+
+          if( errorNorm(l) <= absoluteError )
+          {
+            y.col(l)=y5.col(l);
+            t(l)+=h(l);
+
+            const QVector3D point(y(0,l),y(1,l),y(2,l));
+            if( m_recordPaths )
+            {
+              m_paths[path].append(point);
+            }
+
+            for( qint64 n=0 ; n < m_betaSpheres.length() ; ++n )
+            {
+              if( (point - m_betaSpheres.at(n).first).length() < m_betaSpheres.at(n).second )
+              {
+                m_status[path]=ReachedBetaSphere;
+                m_associatedSphere[path]=n;
+                endpoints[path]=m_betaSpheres.at(n).first;
+                finished[l]=true;
+                break;
+              }
+            }
+
+            if( !finished.at(l) && t(l) >= pathLength - minimumStep )
+            {
+              m_status[path]=ReachedEndOfPath;
+              endpoints[path]=point;
+              finished[l]=true;
+            }
+          }
+
+          if( finished.at(l) )
+          {
+            continue;
+          }
+
+          qreal factor=5.0;
+          if( errorNorm(l) > 0.0 )
+          {
+            factor=qBound(0.2, 0.9*pow(absoluteError/errorNorm(l), 0.2), 5.0);
+          }
+          h(l)=qMin(qMin(h(l)*factor, maximumStep), pathLength-t(l));
+
+          if( h(l) < minimumStep )
+          {
+            m_status[path]=StepSizeTooSmall;
+            endpoints[path]=QVector3D(y(0,l),y(1,l),y(2,l));
+            finished[l]=true;
+          }
+        }
+      }
+
+      // Retire the finished lanes, keeping the others in order
+      qint64 kept=0;
+      for( qint64 l=0 ; l < nlanes ; ++l )
+      {
+        if( finished.at(l) )
+        {
+          continue;
+        }
+        if( kept != l )
+        {
+          y.col(kept)=y.col(l);
+          t(kept)=t(l);
+          h(kept)=h(l);
+          lanePath[kept]=lanePath.at(l);
+        }
+        ++kept;
+      }
+      nlanes=kept;
+    }
+
+    return endpoints.toList();
+  }
+
+} // namespace Avogadro
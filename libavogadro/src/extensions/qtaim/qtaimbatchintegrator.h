@@ -0,0 +1,106 @@
+/**********************************************************************
+  QTAIM - Extension for Quantum Theory of Atoms In Molecules Analysis
+
+  Copyright (C) 2013 Avogadro Developers
+
+  This file is part of the Avogadro molecular editor project.
+  For more information, see <http://avogadro.cc/>
+
+  Avogadro is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  Avogadro is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+  02110-1301, USA.
+**********************************************************************/
+
+#ifndef QTAIMBATCHINTEGRATOR_H
+#define QTAIMBATCHINTEGRATOR_H
+
+#include "config.h"
+
+#include <QList>
+#include <QVector>
+#include <QVector3D>
+#include <QPair>
+
+#include <Eigen/Core>
+
+#include "qtaimwavefunctionevaluator.h"
+
+namespace Avogadro {
+
+  /*
+     Steepest ascent paths in the electron density for many starting points.
+
+     QTAIMODEIntegrator and QTAIMLSODAIntegrator follow one path at a time
+     and evaluate the gradient one point per call. This integrator advances
+     a batch of paths (lanes) in lock-step: every Runge-Kutta-Fehlberg 4(5)
+     stage evaluates the gradient at all lanes with one batched call of
+     the evaluator. Each lane has its own adaptive step size. Lanes whose
+     path ended are retired and refilled with the next starting point, so
+     the batch stays full until the queue is empty.
+
+     The paths follow the normalized gradient, as the SteepestAscent mode of
+     the other integrators, and end in a beta sphere, after a path length
+     of 10 bohr, or at a point where the gradient vanishes.
+  */
+  class QTAIMBatchIntegrator
+  {
+
+  public:
+    enum
+    {
+      ReachedBetaSphere=0,
+      ReachedEndOfPath=2,
+      ReachedCriticalPoint=3,
+      StepSizeTooSmall=4
+    };
+
+    explicit QTAIMBatchIntegrator(QTAIMWavefunctionEvaluator &eval, const qint64 lanes=64);
+
+    // Integrate one path from each point, returns the end points. A path
+    // that ends in a beta sphere returns the center of the sphere.
+    QList<QVector3D> integrate(const QList<QVector3D> &x0y0z0);
+
+    // Per path results of the last integrate()
+    const QVector<qint64> & status() const { return m_status; }
+    const QVector<qint64> & associatedSpheres() const { return m_associatedSphere; }
+    const QVector<QList<QVector3D> > & paths() const { return m_paths; }
+
+    void setBetaSpheres( QList<QPair<QVector3D,qreal> > betaSpheres ) { m_betaSpheres = betaSpheres; }
+
+    // Keep all accepted points of the paths, off by default
+    void setRecordPaths( bool record ) { m_recordPaths = record; }
+
+  private:
+    // Unit gradient at each column, and its norm before normalization
+    void direction(const Matrix<qreal,3,Dynamic> &xyz, Matrix<qreal,3,Dynamic> &unit,
+                   Array<qreal,1,Dynamic> &norm);
+
+    QTAIMWavefunctionEvaluator *m_eval;
+    qint64 m_lanes;
+
+    QList<QPair<QVector3D,qreal> > m_betaSpheres;
+    bool m_recordPaths;
+
+    QVector<qint64> m_status;
+    QVector<qint64> m_associatedSphere;
+    QVector<QList<QVector3D> > m_paths;
+
+    // Buffers for the evaluator
+    Matrix<qreal,Dynamic,1> m_density;
+    Matrix<qreal,3,Dynamic> m_gradient;
+  };
+
+} // namespace Avogadro
+
+#endif // QTAIMBATCHINTEGRATOR_H
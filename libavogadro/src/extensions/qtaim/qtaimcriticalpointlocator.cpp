@@ -29,8 +29,10 @@
 #include "qtaimodeintegrator.h"
 #include "qtaimlsodaintegrator.h"
 #include "qtaimmathutilities.h"
+#include "qtaimspatialhash.h"
 
 #include <Eigen/Core>
+#include <Eigen/Eigenvalues>
 
 #include <QList>
 
@@ -42,16 +44,23 @@
 #include <QDir>
 
 #include <QVariant>
+#include <QVector>
+#include <QByteArray>
 
 #include <QProgressDialog>
 #include <QFutureWatcher>
 #include <QFuture>
+#include <QThread>
+
+#include <cmath>
 
 using namespace std;
 using namespace Eigen;
 
 #define HUGE_REAL_NUMBER 1.e20
 #define SMALL_GRADIENT_NORM 1.e-4
+#define SMALL_ELECTRON_DENSITY 1.e-4
+#define GRID_BLOCK 4
 
 namespace Avogadro
 {
@@ -246,8 +255,13 @@ namespace Avogadro
     qint64 backwardNucleusIndex=smallestDistanceIndex;
 
     bool bondPathConnectsPair;
-    if( (forwardNucleusIndex == nucleusA && backwardNucleusIndex == nucleusB) ||
-        (forwardNucleusIndex == nucleusB && backwardNucleusIndex == nucleusA) )
+    if( nucleusA < 0 || nucleusB < 0 )
+    {
+      // Any pair of nuclei, the pair is found from the bond path
+      bondPathConnectsPair=( forwardNucleusIndex != backwardNucleusIndex );
+    }
+    else if( (forwardNucleusIndex == nucleusA && backwardNucleusIndex == nucleusB) ||
+             (forwardNucleusIndex == nucleusB && backwardNucleusIndex == nucleusA) )
     {
       bondPathConnectsPair=true;
     }
@@ -259,8 +273,8 @@ namespace Avogadro
     if( bondPathConnectsPair )
     {
       value.append(true);
-      value.append(nucleusA);
-      value.append(nucleusB);
+      value.append(qMin(forwardNucleusIndex,backwardNucleusIndex));
+      value.append(qMax(forwardNucleusIndex,backwardNucleusIndex));
       value.append(result.x());
       value.append(result.y());
       value.append(result.z());
@@ -461,6 +475,287 @@ namespace Avogadro
 
   }
 
+  // The grid is visited in cubic blocks of GRID_BLOCK points a side, so
+  // that every task and every batch of the evaluator covers a compact
+  // region. Returns the indices of the points of the blocks first to
+  // last-1, numbering the blocks and the points with z fastest.
+  static QVector<qint64> QTAIMGridBlockPoints( const qint64 n[3], qint64 firstBlock, qint64 lastBlock )
+  {
+    const qint64 block=GRID_BLOCK;
+    const qint64 nb[3]={ (n[0]+block-1)/block, (n[1]+block-1)/block, (n[2]+block-1)/block };
+
+    QVector<qint64> points;
+    points.reserve( (lastBlock-firstBlock)*block*block*block );
+    for( qint64 b=firstBlock ; b < lastBlock ; ++b )
+    {
+      const qint64 bi=block*( b / (nb[1]*nb[2]) );
+      const qint64 bj=block*( (b / nb[2]) % nb[1] );
+      const qint64 bk=block*( b % nb[2] );
+      for( qint64 i=bi ; i < qMin(bi+block,n[0]) ; ++i )
+        for( qint64 j=bj ; j < qMin(bj+block,n[1]) ; ++j )
+          for( qint64 k=bk ; k < qMin(bk+block,n[2]) ; ++k )
+          {
+            points.append( (i*n[1] + j)*n[2] + k );
+          }
+    }
+    return points;
+  }
+
+  QList<QVariant> QTAIMClassifyGridPoints( QList<QVariant> input )
+  {
+    /*
+       Order of input:
+       QString wfnFileName
+       qreal xmin, ymin, zmin, step
+       qint64 nx, ny, nz
+       qint64 firstBlock, lastBlock
+
+       Returns the electron density, the norm of its gradient and the
+       signature of its Hessian at each point of the blocks, in the order
+       of QTAIMGridBlockPoints, streamed into a QByteArray. The last two
+       are 0 where the density is negligible.
+    */
+    qint64 counter=0;
+    const QString fileName=input.at(counter).toString(); counter++;
+    Matrix<qreal,3,1> lower;
+    lower(0)=input.at(counter).toReal(); counter++;
+    lower(1)=input.at(counter).toReal(); counter++;
+    lower(2)=input.at(counter).toReal(); counter++;
+    const qreal step=input.at(counter).toReal(); counter++;
+    qint64 n[3];
+    n[0]=input.at(counter).toLongLong(); counter++;
+    n[1]=input.at(counter).toLongLong(); counter++;
+    n[2]=input.at(counter).toLongLong(); counter++;
+    const qint64 firstBlock=input.at(counter).toLongLong(); counter++;
+    const qint64 lastBlock=input.at(counter).toLongLong(); counter++;
+
+    const QVector<qint64> points=QTAIMGridBlockPoints(n,firstBlock,lastBlock);
+    const qint64 npts=points.size();
+
+    QTAIMWavefunction wfn;
+    wfn.loadFromBinaryFile(fileName);
+
+    QTAIMWavefunctionEvaluator eval(wfn);
+
+    // A block at a time keeps the primitive screening of the batched
+    // density effective
+    const qint64 blockSize=64;
+
+    QVector<qreal> density(npts);
+    QVector<qreal> gradientNorm(npts);
+    QVector<qint64> signature(npts);
+    for( qint64 start=0 ; start < npts ; start+=blockSize )
+    {
+      const qint64 m=qMin(blockSize,npts-start);
+      Matrix<qreal,3,Dynamic> xyz(3,m);
+      for( qint64 i=0 ; i < m ; ++i )
+      {
+        const qint64 index=points.at(start+i);
+        xyz(0,i)=lower(0) + step*( index / (n[1]*n[2]) );
+        xyz(1,i)=lower(1) + step*( (index / n[2]) % n[1] );
+        xyz(2,i)=lower(2) + step*( index % n[2] );
+      }
+
+      const Matrix<qreal,Dynamic,1> rho=eval.electronDensityAtPoints(xyz);
+
+      for( qint64 i=0 ; i < m ; ++i )
+      {
+        density[start+i]=rho(i);
+        if( rho(i) < SMALL_ELECTRON_DENSITY )
+        {
+          gradientNorm[start+i]=0.0;
+          signature[start+i]=0;
+        }
+        else
+        {
+          const Matrix<qreal,3,4> gH=eval.gradientAndHessianOfElectronDensity(xyz.col(i));
+          gradientNorm[start+i]=gH.col(0).norm();
+          signature[start+i]=QTAIMMathUtilities::signatureOfASymmetricThreeByThreeMatrix(gH.block<3,3>(0,1));
+        }
+      }
+    }
+
+    QByteArray data;
+    QDataStream out(&data, QIODevice::WriteOnly);
+    out << density << gradientNorm << signature;
+
+    QList<QVariant> value;
+    value.append(data);
+    return value;
+  }
+
+  // A critical point other than a maximum, inside the search box
+  static qint64 QTAIMSignatureOfCriticalPoint( QTAIMWavefunctionEvaluator &eval, const Matrix<qreal,3,1> &xyz,
+                                               const Matrix<qreal,3,1> &lower, const Matrix<qreal,3,1> &upper )
+  {
+    if( !( (lower.array() < xyz.array()).all() && (xyz.array() < upper.array()).all() ) ||
+        eval.electronDensity(xyz) < SMALL_ELECTRON_DENSITY ||
+        eval.gradientOfElectronDensity(xyz).norm() > SMALL_GRADIENT_NORM )
+    {
+      return 0;
+    }
+
+    const qint64 signature=QTAIMMathUtilities::signatureOfASymmetricThreeByThreeMatrix(
+        eval.hessianOfElectronDensity(xyz) );
+
+    return ( signature == -1 || signature == 1 || signature == 3 ) ? signature : 0;
+  }
+
+  QList<QVariant> QTAIMLocateCriticalPoints( QList<QVariant> input )
+  {
+    /*
+       Order of input:
+       QString wfnFileName
+       qint64 signature (-1, 1 or 3, or 0 for the signature at each seed)
+       qreal xmin, ymin, zmin, xmax, ymax, zmax
+       qint64 npts
+       qreal x1, y1, z1, x2, ...
+
+       Returns the signature (0 if no critical point was found) and the
+       coordinates of the critical point found from each seed.
+    */
+    qint64 counter=0;
+    const QString fileName=input.at(counter).toString(); counter++;
+    const qint64 signature=input.at(counter).toLongLong(); counter++;
+    Matrix<qreal,3,1> lower;
+    Matrix<qreal,3,1> upper;
+    lower(0)=input.at(counter).toReal(); counter++;
+    lower(1)=input.at(counter).toReal(); counter++;
+    lower(2)=input.at(counter).toReal(); counter++;
+    upper(0)=input.at(counter).toReal(); counter++;
+    upper(1)=input.at(counter).toReal(); counter++;
+    upper(2)=input.at(counter).toReal(); counter++;
+    const qint64 npts=input.at(counter).toLongLong(); counter++;
+
+    QTAIMWavefunction wfn;
+    wfn.loadFromBinaryFile(fileName);
+
+    QTAIMWavefunctionEvaluator eval(wfn);
+
+    const qint64 newtonIterations=50;
+    const qreal newtonMaximumStep=0.3;
+
+    QList<QVariant> value;
+
+    for( qint64 i=0 ; i < npts ; ++i )
+    {
+      Matrix<qreal,3,1> x0y0z0;
+      x0y0z0(0)=input.at(counter).toReal(); counter++;
+      x0y0z0(1)=input.at(counter).toReal(); counter++;
+      x0y0z0(2)=input.at(counter).toReal(); counter++;
+
+      qint64 found=0;
+      Matrix<qreal,3,1> xyz=x0y0z0;
+
+      if( eval.electronDensity(x0y0z0) > SMALL_ELECTRON_DENSITY )
+      {
+        // Newton-Raphson converges to the closest critical point of any kind
+        // when the seed is near enough, the Hessian need not be definite
+        for( qint64 iteration=0 ; iteration < newtonIterations ; ++iteration )
+        {
+          const Matrix<qreal,3,4> gH=eval.gradientAndHessianOfElectronDensity(xyz);
+          if( gH.col(0).norm() < 1.e-10 )
+          {
+            break;
+          }
+
+          SelfAdjointEigenSolver<Matrix<qreal,3,3> > eigensolver(gH.block<3,3>(0,1));
+          Matrix<qreal,3,1> step=eigensolver.eigenvectors()*
+              (eigensolver.eigenvectors().transpose()*gH.col(0)).cwiseQuotient(eigensolver.eigenvalues());
+          if( !(step.norm() < newtonMaximumStep) )
+          {
+            if( !(step.norm() > 0.0) )
+            {
+              break;
+            }
+            step*=newtonMaximumStep/step.norm();
+          }
+          xyz-=step;
+        }
+        found=QTAIMSignatureOfCriticalPoint(eval,xyz,lower,upper);
+
+        // Otherwise follow the eigenvectors of the Hessian from the seed
+        if( found == 0 )
+        {
+          qint64 wanted=signature;
+          if( wanted == 0 )
+          {
+            wanted=QTAIMMathUtilities::signatureOfASymmetricThreeByThreeMatrix(
+                eval.hessianOfElectronDensity(x0y0z0) );
+          }
+
+          qint64 mode=-1;
+          switch( wanted )
+          {
+          case -1:
+            mode=QTAIMLSODAIntegrator::CMBPMinusOneGradientInElectronDensity;
+            break;
+          case 1:
+            mode=QTAIMLSODAIntegrator::CMBPPlusOneGradientInElectronDensity;
+            break;
+          case 3:
+            mode=QTAIMLSODAIntegrator::CMBPPlusThreeGradientInElectronDensity;
+            break;
+          }
+
+          // Maxima are found from the nuclei
+          if( mode >= 0 )
+          {
+            QTAIMLSODAIntegrator ode(eval,mode);
+            QVector3D result=ode.integrate(QVector3D(x0y0z0(0),x0y0z0(1),x0y0z0(2)));
+            xyz << result.x(), result.y(), result.z();
+            found=QTAIMSignatureOfCriticalPoint(eval,xyz,lower,upper);
+          }
+        }
+      }
+
+      value.append(found);
+      value.append(xyz(0));
+      value.append(xyz(1));
+      value.append(xyz(2));
+    }
+
+    return value;
+  }
+
+  namespace
+  {
+    // Runs function on all inputs in parallel behind a progress dialog
+    QList<QList<QVariant> > QTAIMMappedWithProgress( const QList<QList<QVariant> > &inputList,
+                                                     QList<QVariant> (*function)(QList<QVariant>),
+                                                     const QString &labelText )
+    {
+      QProgressDialog dialog;
+      dialog.setWindowTitle("QTAIM");
+      dialog.setLabelText(labelText);
+
+      QFutureWatcher<void> futureWatcher;
+      QObject::connect(&futureWatcher, SIGNAL(finished()), &dialog, SLOT(reset()));
+      QObject::connect(&dialog, SIGNAL(canceled()), &futureWatcher, SLOT(cancel()));
+      QObject::connect(&futureWatcher, SIGNAL(progressRangeChanged(int,int)), &dialog, SLOT(setRange(int,int)));
+      QObject::connect(&futureWatcher, SIGNAL(progressValueChanged(int)), &dialog, SLOT(setValue(int)));
+
+      QFuture<QList<QVariant> > future=QtConcurrent::mapped(inputList, function);
+      futureWatcher.setFuture(future);
+      dialog.exec();
+      futureWatcher.waitForFinished();
+
+      QList<QList<QVariant> > results;
+      if( !futureWatcher.future().isCanceled() )
+      {
+        results=future.results();
+      }
+      return results;
+    }
+
+    // A few tasks per thread, each task loads the wavefunction once
+    qint64 QTAIMTaskSize(qint64 n)
+    {
+      const qint64 ntask=4*qMax(1,QThread::idealThreadCount());
+      return qMax((qint64) 1, (n + ntask - 1)/ntask);
+    }
+  }
+
   QTAIMCriticalPointLocator::QTAIMCriticalPointLocator( QTAIMWavefunction &wfn)
   {
     m_wfn=&wfn;
@@ -479,6 +774,9 @@ namespace Avogadro
     m_electronDensitySources.empty();
     m_electronDensitySinks.empty();
 
+    m_gridSearched=false;
+    m_gridStep=0.5;
+
   }
 
   void QTAIMCriticalPointLocator::locateNuclearCriticalPoints()
@@ -555,6 +853,15 @@ namespace Avogadro
 
   void QTAIMCriticalPointLocator::locateBondCriticalPoints()
   {
+    // Start the analysis afresh, candidates of an earlier search would
+    // otherwise be traced again. The grid seeds were collected with them.
+    m_bondCandidates.clear();
+    m_bondCriticalPoints.clear();
+    m_laplacianAtBondCriticalPoints.clear();
+    m_ellipticityAtBondCriticalPoints.clear();
+    m_bondPaths.clear();
+    m_bondedAtoms.clear();
+    m_gridSearched=false;
 
     if( m_nuclearCriticalPoints.length() < 1 )
     {
@@ -568,77 +875,384 @@ namespace Avogadro
       return;
     }
 
-    QString temporaryFileName=QTAIMCriticalPointLocator::temporaryFileName();
+    // Seeds at the midpoints of the pairs of nuclei closer than the cutoff,
+    // the pairs are found from a cell list of the nuclei
+    const qreal distanceCutoff = 8.0 ;
 
-    QString nuclearCriticalPointsFileName=QTAIMCriticalPointLocator::temporaryFileName();
-    QFile nuclearCriticalPointsFile(nuclearCriticalPointsFileName);
-    nuclearCriticalPointsFile.open(QIODevice::WriteOnly);
-    QDataStream nuclearCriticalPointsOut(&nuclearCriticalPointsFile);
-    nuclearCriticalPointsOut << m_nuclearCriticalPoints;
-    nuclearCriticalPointsFile.close();
+    QTAIMSpatialHash nuclei(distanceCutoff);
+    for( qint64 n=0 ; n < numberOfNuclei ; ++n )
+    {
+      nuclei.insert( QVector3D(m_wfn->xNuclearCoordinate(n), m_wfn->yNuclearCoordinate(n), m_wfn->zNuclearCoordinate(n)) );
+    }
 
-    QList<QList<QVariant> > inputList;
+    QList<QVector3D> seeds;
+    for( qint64 M=0 ; M < numberOfNuclei ; ++M )
+    {
+      QVector3D a(m_wfn->xNuclearCoordinate(M), m_wfn->yNuclearCoordinate(M), m_wfn->zNuclearCoordinate(M));
+
+      foreach( qint64 N, nuclei.neighbors(a,distanceCutoff) )
+      {
+        if( N > M )
+        {
+          QVector3D b(m_wfn->xNuclearCoordinate(N), m_wfn->yNuclearCoordinate(N), m_wfn->zNuclearCoordinate(N));
+          seeds.append( (a + b) / 2.0 );
+        }
+      }
+    }
+
+    locateCriticalPoints(seeds, -1, QString("Bond Critical Points Search"));
+
+    // and seeds from the density grid
+    if( !m_gridSearched )
+    {
+      searchGrid(m_gridStep);
+    }
 
-    for( qint64 M=0 ; M < numberOfNuclei - 1 ; ++M )
+    traceBondPaths( uniqueCriticalPoints(m_bondCandidates, m_bondCriticalPoints) );
+    m_bondCandidates.clear();
+
+  }
+
+  void QTAIMCriticalPointLocator::locateRingCriticalPoints()
+  {
+    if( !m_gridSearched )
     {
-      for( qint64 N=M+1 ; N < numberOfNuclei ; ++N )
+      searchGrid(m_gridStep);
+    }
+
+    m_ringCriticalPoints.append( uniqueCriticalPoints(m_ringCandidates, m_ringCriticalPoints) );
+    m_ringCandidates.clear();
+  }
+
+  void QTAIMCriticalPointLocator::locateCageCriticalPoints()
+  {
+    if( !m_gridSearched )
+    {
+      searchGrid(m_gridStep);
+    }
+
+    m_cageCriticalPoints.append( uniqueCriticalPoints(m_cageCandidates, m_cageCriticalPoints) );
+    m_cageCandidates.clear();
+  }
+
+  qint64 QTAIMCriticalPointLocator::poincareHopfSum() const
+  {
+    return m_nuclearCriticalPoints.length() - m_bondCriticalPoints.length()
+        + m_ringCriticalPoints.length() - m_cageCriticalPoints.length();
+  }
+
+  bool QTAIMCriticalPointLocator::verifyTopology()
+  {
+    if( poincareHopfSum() == 1 )
+    {
+      return true;
+    }
+
+    // Something was missed, search again on a finer grid and keep what is new
+    searchGrid(m_gridStep/2.0);
+
+    traceBondPaths( uniqueCriticalPoints(m_bondCandidates, m_bondCriticalPoints) );
+    m_ringCriticalPoints.append( uniqueCriticalPoints(m_ringCandidates, m_ringCriticalPoints) );
+    m_cageCriticalPoints.append( uniqueCriticalPoints(m_cageCandidates, m_cageCriticalPoints) );
+    m_bondCandidates.clear();
+    m_ringCandidates.clear();
+    m_cageCandidates.clear();
+
+    return poincareHopfSum() == 1;
+  }
+
+  void QTAIMCriticalPointLocator::boundingBox(Matrix<qreal,3,1> &lower, Matrix<qreal,3,1> &upper) const
+  {
+    // Same margin as the searches for sources and sinks
+    const qreal margin=2.0;
+
+    for( qint64 n=0 ; n < m_wfn->numberOfNuclei() ; ++n )
+    {
+      Matrix<qreal,3,1> a;
+      a << m_wfn->xNuclearCoordinate(n), m_wfn->yNuclearCoordinate(n), m_wfn->zNuclearCoordinate(n);
+      if( n == 0 )
+      {
+        lower=a;
+        upper=a;
+      }
+      else
       {
+        lower=lower.cwiseMin(a);
+        upper=upper.cwiseMax(a);
+      }
+    }
+
+    lower.array() -= margin;
+    upper.array() += margin;
+  }
+
+  void QTAIMCriticalPointLocator::searchGrid(qreal step)
+  {
+    m_gridSearched=true;
+    m_gridStep=step;
+
+    if( m_wfn->numberOfNuclei() < 1 )
+    {
+      return;
+    }
+
+    Matrix<qreal,3,1> lower;
+    Matrix<qreal,3,1> upper;
+    boundingBox(lower,upper);
+
+    qint64 n[3];
+    for( qint64 i=0 ; i < 3 ; ++i )
+    {
+      n[i]=(qint64) floor( (upper(i)-lower(i))/step ) + 1;
+    }
+
+    const qint64 block=GRID_BLOCK;
+    const qint64 numberOfBlocks=( (n[0]+block-1)/block )*( (n[1]+block-1)/block )*( (n[2]+block-1)/block );
+
+    QString temporaryFileName=QTAIMCriticalPointLocator::temporaryFileName();
 
-        const qreal distanceCutoff = 8.0 ;
+    // Each task gets a range of blocks and generates the points itself
+    QList<QList<QVariant> > inputList;
+    const qint64 taskSize=QTAIMTaskSize(numberOfBlocks);
+    for( qint64 start=0 ; start < numberOfBlocks ; start+=taskSize )
+    {
+      QList<QVariant> input;
+      input.append( temporaryFileName );
+      input.append( lower(0) );
+      input.append( lower(1) );
+      input.append( lower(2) );
+      input.append( step );
+      input.append( n[0] );
+      input.append( n[1] );
+      input.append( n[2] );
+      input.append( start );
+      input.append( qMin(numberOfBlocks, start+taskSize) );
+      inputList.append(input);
+    }
 
-        Matrix<qreal,3,1> a;
-        Matrix<qreal,3,1> b;
+    m_wfn->saveToBinaryFile(temporaryFileName);
 
-        a << m_wfn->xNuclearCoordinate(M), m_wfn->yNuclearCoordinate(M), m_wfn->zNuclearCoordinate(M) ;
-        b << m_wfn->xNuclearCoordinate(N), m_wfn->yNuclearCoordinate(N), m_wfn->zNuclearCoordinate(N) ;
+    QList<QList<QVariant> > results=QTAIMMappedWithProgress(inputList,
+                                                             QTAIMClassifyGridPoints,
+                                                             QString("Electron Density Grid"));
 
-        if( QTAIMMathUtilities::distance(a,b) < distanceCutoff )
+    QFile file;
+    file.remove(temporaryFileName);
+
+    if( results.length() != inputList.length() )
+    {
+      return;
+    }
+
+    const qint64 numberOfPoints=n[0]*n[1]*n[2];
+    QVector<qreal> density(numberOfPoints);
+    QVector<qreal> gradientNorm(numberOfPoints);
+    QVector<qint64> signature(numberOfPoints);
+    for( qint64 t=0 ; t < results.length() ; ++t )
+    {
+      const QVector<qint64> points=QTAIMGridBlockPoints(n,
+                                                        inputList.at(t).at(8).toLongLong(),
+                                                        inputList.at(t).at(9).toLongLong());
+      QVector<qreal> taskDensity;
+      QVector<qreal> taskGradientNorm;
+      QVector<qint64> taskSignature;
+      QDataStream in(results.at(t).at(0).toByteArray());
+      in >> taskDensity >> taskGradientNorm >> taskSignature;
+      for( qint64 p=0 ; p < points.size() ; ++p )
+      {
+        density[points.at(p)]=taskDensity.at(p);
+        gradientNorm[points.at(p)]=taskGradientNorm.at(p);
+        signature[points.at(p)]=taskSignature.at(p);
+      }
+    }
+
+    // The grid points are classified by the signature of the Hessian. In
+    // each region of one signature the gradient norm has a minimum near
+    // every critical point of that signature, these minima are the seeds.
+    // Comparing only within a region keeps a bond critical point close to
+    // a ring critical point from hiding it on a coarse grid.
+    QList<QVector3D> seeds;
+    for( qint64 i=0 ; i < n[0] ; ++i )
+    {
+      for( qint64 j=0 ; j < n[1] ; ++j )
+      {
+        for( qint64 k=0 ; k < n[2] ; ++k )
         {
-          QVector3D x0y0z0( ( m_wfn->xNuclearCoordinate(M) + m_wfn->xNuclearCoordinate(N) ) / 2.0 ,
-                            ( m_wfn->yNuclearCoordinate(M) + m_wfn->yNuclearCoordinate(N) ) / 2.0,
-                            ( m_wfn->zNuclearCoordinate(M) + m_wfn->zNuclearCoordinate(N) ) / 2.0 );
+          const qint64 index=(i*n[1] + j)*n[2] + k;
+          if( density.at(index) < SMALL_ELECTRON_DENSITY || signature.at(index) == -3 )
+          {
+            continue;
+          }
 
-          QList<QVariant> input;
-          input.append( temporaryFileName );
-          input.append( nuclearCriticalPointsFileName );
-          input.append( M );
-          input.append( N );
-          input.append( x0y0z0.x() );
-          input.append( x0y0z0.y() );
-          input.append( x0y0z0.z() );
+          const qint64 neighbor[6][3]={ {i-1,j,k}, {i+1,j,k}, {i,j-1,k}, {i,j+1,k}, {i,j,k-1}, {i,j,k+1} };
+          bool minimum=true;
+          for( qint64 m=0 ; m < 6 && minimum ; ++m )
+          {
+            if( neighbor[m][0] < 0 || neighbor[m][0] >= n[0] ||
+                neighbor[m][1] < 0 || neighbor[m][1] >= n[1] ||
+                neighbor[m][2] < 0 || neighbor[m][2] >= n[2] )
+            {
+              continue;
+            }
+            const qint64 other=(neighbor[m][0]*n[1] + neighbor[m][1])*n[2] + neighbor[m][2];
+            if( signature.at(other) == signature.at(index) )
+            {
+              minimum=!( gradientNorm.at(other) < gradientNorm.at(index) );
+            }
+          }
 
-          inputList.append(input);
+          if( minimum )
+          {
+            seeds.append( QVector3D(lower(0) + step*i, lower(1) + step*j, lower(2) + step*k) );
+          }
         }
-      } // end N
-    } // end M
+      }
+    }
+
+    locateCriticalPoints(seeds, 0, QString("Critical Points Search"));
+  }
+
+  void QTAIMCriticalPointLocator::locateCriticalPoints(const QList<QVector3D> &seeds,
+                                                       qint64 signature,
+                                                       const QString &labelText)
+  {
+    if( seeds.isEmpty() )
+    {
+      return;
+    }
+
+    Matrix<qreal,3,1> lower;
+    Matrix<qreal,3,1> upper;
+    boundingBox(lower,upper);
+
+    QString temporaryFileName=QTAIMCriticalPointLocator::temporaryFileName();
+
+    QList<QList<QVariant> > inputList;
+    const qint64 taskSize=QTAIMTaskSize(seeds.length());
+    for( qint64 start=0 ; start < seeds.length() ; start+=taskSize )
+    {
+      const qint64 end=qMin((qint64) seeds.length(), start+taskSize);
+
+      QList<QVariant> input;
+      input.append( temporaryFileName );
+      input.append( signature );
+      input.append( lower(0) );
+      input.append( lower(1) );
+      input.append( lower(2) );
+      input.append( upper(0) );
+      input.append( upper(1) );
+      input.append( upper(2) );
+      input.append( end-start );
+      for( qint64 i=start ; i < end ; ++i )
+      {
+        input.append( seeds.at(i).x() );
+        input.append( seeds.at(i).y() );
+        input.append( seeds.at(i).z() );
+      }
+      inputList.append(input);
+    }
 
     m_wfn->saveToBinaryFile(temporaryFileName);
 
-    QProgressDialog dialog;
-    dialog.setWindowTitle("QTAIM");
-    dialog.setLabelText(QString("Bond Critical Points Search"));
+    QList<QList<QVariant> > results=QTAIMMappedWithProgress(inputList,
+                                                             QTAIMLocateCriticalPoints,
+                                                             labelText);
 
-    QFutureWatcher<void> futureWatcher;
-    QObject::connect(&futureWatcher, SIGNAL(finished()), &dialog, SLOT(reset()));
-    QObject::connect(&dialog, SIGNAL(canceled()), &futureWatcher, SLOT(cancel()));
-    QObject::connect(&futureWatcher, SIGNAL(progressRangeChanged(int,int)), &dialog, SLOT(setRange(int,int)));
-    QObject::connect(&futureWatcher, SIGNAL(progressValueChanged(int)), &dialog, SLOT(setValue(int)));
+    QFile file;
+    file.remove(temporaryFileName);
 
-    QFuture<QList<QVariant> > future=QtConcurrent::mapped(inputList, QTAIMLocateBondCriticalPoint);;
-    futureWatcher.setFuture(future);
-    dialog.exec();
-    futureWatcher.waitForFinished();
+    for( qint64 t=0 ; t < results.length() ; ++t )
+    {
+      for( qint64 i=0 ; i < results.at(t).length() ; i+=4 )
+      {
+        const QVector3D criticalPoint(results.at(t).at(i+1).toReal(),
+                                      results.at(t).at(i+2).toReal(),
+                                      results.at(t).at(i+3).toReal());
 
-    QList<QList<QVariant> > results;
-    if( futureWatcher.future().isCanceled() )
+        // Whatever kind of critical point was found is kept
+        switch( results.at(t).at(i).toLongLong() )
+        {
+        case -1:
+          m_bondCandidates.append(criticalPoint);
+          break;
+        case 1:
+          m_ringCandidates.append(criticalPoint);
+          break;
+        case 3:
+          m_cageCandidates.append(criticalPoint);
+          break;
+        }
+      }
+    }
+  }
+
+  QList<QVector3D> QTAIMCriticalPointLocator::uniqueCriticalPoints(const QList<QVector3D> &candidates,
+                                                                   const QList<QVector3D> &known) const
+  {
+    // Searches from nearby seeds converge to the same critical point up to
+    // the tolerance of the integrator, distinct critical points are much
+    // further apart
+    const qreal duplicateDistance=5.e-2;
+
+    QTAIMSpatialHash hash(duplicateDistance);
+    foreach( const QVector3D &point, known )
     {
-      results.clear();
+      hash.insert(point);
     }
-    else
+
+    QList<QVector3D> unique;
+    foreach( const QVector3D &point, candidates )
     {
-      results=future.results();
+      if( !hash.contains(point,duplicateDistance) )
+      {
+        hash.insert(point);
+        unique.append(point);
+      }
+    }
+
+    return unique;
+  }
+
+  void QTAIMCriticalPointLocator::traceBondPaths(const QList<QVector3D> &bondCriticalPoints)
+  {
+
+    if( bondCriticalPoints.isEmpty() )
+    {
+      return;
     }
 
+    QString temporaryFileName=QTAIMCriticalPointLocator::temporaryFileName();
+
+    QString nuclearCriticalPointsFileName=QTAIMCriticalPointLocator::temporaryFileName();
+    QFile nuclearCriticalPointsFile(nuclearCriticalPointsFileName);
+    nuclearCriticalPointsFile.open(QIODevice::WriteOnly);
+    QDataStream nuclearCriticalPointsOut(&nuclearCriticalPointsFile);
+    nuclearCriticalPointsOut << m_nuclearCriticalPoints;
+    nuclearCriticalPointsFile.close();
+
+    QList<QList<QVariant> > inputList;
+
+    foreach( const QVector3D &x0y0z0, bondCriticalPoints )
+    {
+      // The bonded nuclei are those at the ends of the bond path
+      QList<QVariant> input;
+      input.append( temporaryFileName );
+      input.append( nuclearCriticalPointsFileName );
+      input.append( -1 );
+      input.append( -1 );
+      input.append( x0y0z0.x() );
+      input.append( x0y0z0.y() );
+      input.append( x0y0z0.z() );
+
+      inputList.append(input);
+    }
+
+    m_wfn->saveToBinaryFile(temporaryFileName);
+
+    QList<QList<QVariant> > results=QTAIMMappedWithProgress(inputList,
+                                                             QTAIMLocateBondCriticalPoint,
+                                                             QString("Bond Paths"));
+
     QFile file;
     file.remove(temporaryFileName);
     file.remove(nuclearCriticalPointsFileName);
@@ -42,8 +42,25 @@ namespace Avogadro {
   public:
     explicit QTAIMCriticalPointLocator(QTAIMWavefunction &wfn);
     void locateNuclearCriticalPoints();
+
+    // Needs the nuclear critical points. Seeds are placed at the midpoints
+    // of nearby pairs of nuclei and at the minima of the gradient norm on
+    // a grid, the same critical point found twice is kept once.
     void locateBondCriticalPoints();
 
+    // Seeded from the grid search shared with locateBondCriticalPoints.
+    void locateRingCriticalPoints();
+    void locateCageCriticalPoints();
+
+    // n - b + r - c of the critical points found so far. The Poincare-Hopf
+    // relation requires 1 for an isolated molecule.
+    qint64 poincareHopfSum() const;
+
+    // Once all kinds of critical points are located: if the Poincare-Hopf
+    // relation does not hold, search again with a finer grid. Returns
+    // whether the relation holds.
+    bool verifyTopology();
+
     void locateElectronDensitySources();
     void locateElectronDensitySinks();
 
@@ -78,6 +95,28 @@ namespace Avogadro {
     QList<QVector3D> m_electronDensitySources;
     QList<QVector3D> m_electronDensitySinks;
 
+    // Seeds at the minima of the gradient norm on a grid of the given
+    // spacing, within the regions of equal Hessian signature
+    void searchGrid(qreal step);
+    bool m_gridSearched;
+    qreal m_gridStep;
+
+    // Critical points found so far, not yet checked for duplicates
+    QList<QVector3D> m_bondCandidates;
+    QList<QVector3D> m_ringCandidates;
+    QList<QVector3D> m_cageCandidates;
+
+    // Searches for a critical point from each seed and adds it to the
+    // candidates of its kind. Where Newton-Raphson fails, the search
+    // follows the Hessian for the given signature, or for the signature
+    // at the seed if signature is 0.
+    void locateCriticalPoints(const QList<QVector3D> &seeds, qint64 signature,
+                              const QString &labelText);
+    QList<QVector3D> uniqueCriticalPoints(const QList<QVector3D> &candidates,
+                                          const QList<QVector3D> &known) const;
+    void traceBondPaths(const QList<QVector3D> &bondCriticalPoints);
+    void boundingBox(Matrix<qreal,3,1> &lower, Matrix<qreal,3,1> &upper) const;
+
     QString temporaryFileName();
 
   };
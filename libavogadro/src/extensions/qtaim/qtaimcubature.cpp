@@ -57,6 +57,7 @@
 #include <QProgressDialog>
 #include <QFutureWatcher>
 #include <QFuture>
+#include <QThread>
 
 #include <cstdio>
 #include <cstdlib>
@@ -1123,14 +1124,21 @@ int adapt_integrate(unsigned int fdim, integrand f, void *fdata,
 }
 
 // TODO: Consider QVariantList. For now, mimic what is known to work.
-QList<QVariant> QTAIMEvaluateProperty(QList<QVariant> variantList)
+// Evaluates a batch of integration points. The gradient paths of all points
+// of the batch are followed together by QTAIMBatchIntegrator, so the
+// wavefunction is loaded and the evaluator is set up once per batch
+// instead of once per point.
+QList<QVariant> QTAIMEvaluatePropertyBatch(QList<QVariant> variantList)
 {
   /*
      Order of variantList:
      QString wfnFileName
-     qreal x0
-     qreal y0
-     qreal z0
+     qint64 coordinates (0 Cartesian, 1 Spherical Polar around the first basin)
+     qint64 npts
+     qreal x0 (or r0)
+     qreal y0 (or t0)
+     qreal z0 (or p0)
+     ...
      qint64 nncp
      qint64 xncp1
      qint64 yncp1
@@ -1147,12 +1155,21 @@ QList<QVariant> QTAIMEvaluateProperty(QList<QVariant> variantList)
      qint64 basin1
      qint64 basin2
      ...
+
+     The values are returned point by point, nmode values for each point.
   */
   qint64 counter=0;
   QString wfnFileName=variantList.at(counter).toString(); counter++;
-  qreal x0=variantList.at(counter).toReal(); counter++;
-  qreal y0=variantList.at(counter).toReal(); counter++;
-  qreal z0=variantList.at(counter).toReal(); counter++;
+  qint64 coordinates=variantList.at(counter).toLongLong(); counter++;
+
+  qint64 npts=variantList.at(counter).toLongLong(); counter++;
+  Matrix<qreal,3,Dynamic> points(3,npts);
+  for( qint64 i=0 ; i < npts ; ++i )
+  {
+    points(0,i)=variantList.at(counter).toReal(); counter++;
+    points(1,i)=variantList.at(counter).toReal(); counter++;
+    points(2,i)=variantList.at(counter).toReal(); counter++;
+  }
 
   qint64 nncp=variantList.at(counter).toLongLong(); counter++;
   QList<QVector3D> ncpList;
@@ -1182,42 +1199,67 @@ QList<QVariant> QTAIMEvaluateProperty(QList<QVariant> variantList)
   }
   QSet<qint64> basinSet=basinList.toSet();
 
+  // Volume element of each point
+  QVector<qreal> jacobian(npts,1.0);
+  Matrix<qreal,3,Dynamic> xyz(3,npts);
+  if( coordinates == 1 )
+  {
+    Matrix<qreal,3,1> origin;
+    origin <<
+        ncpList.at(basinList.at(0)).x(),
+        ncpList.at(basinList.at(0)).y(),
+        ncpList.at(basinList.at(0)).z();
+
+    for( qint64 i=0 ; i < npts ; ++i )
+    {
+      Matrix<qreal,3,1> r0t0p0=points.col(i);
+      xyz.col(i)=Avogadro::QTAIMMathUtilities::sphericalToCartesian(r0t0p0, origin );
+      jacobian[i]=r0t0p0(0)*r0t0p0(0)*sin(r0t0p0(1));
+    }
+  }
+  else
+  {
+    xyz=points;
+  }
+
   Avogadro::QTAIMWavefunction wfn;
   wfn.loadFromBinaryFile(wfnFileName);
 
   Avogadro::QTAIMWavefunctionEvaluator eval(wfn);
 
-  QList<QVariant> valueList;
-
-  qreal initialElectronDensity=eval.electronDensity( Matrix<qreal,3,1>(x0,y0,z0) );
+  const Matrix<qreal,Dynamic,1> initialElectronDensity=eval.electronDensityAtPoints(xyz);
 
-  // if less than some small value, then return zero for all integrands.
-  if( initialElectronDensity < 1.e-5 )
+  // if less than some small value, then return zero for all integrands,
+  // otherwise follow the gradient path from the point.
+  QList<qint64> pathIndex;
+  QList<QVector3D> pathStart;
+  for( qint64 i=0 ; i < npts ; ++i )
   {
-    for( qint64 m=0; m < nmode ; ++m )
+    if( !(initialElectronDensity(i) < 1.e-5) )
     {
-      qreal zero=0.0;
-      valueList.append(zero);
+      pathIndex.append(i);
+      pathStart.append(QVector3D(xyz(0,i),xyz(1,i),xyz(2,i)));
     }
   }
-  else
+
+  QList<QPair<QVector3D,qreal> > betaSpheres;
+  for( qint64 i=0 ; i < nncp ; ++i )
   {
-    QList<QPair<QVector3D,qreal> > betaSpheres;
-    for( qint64 i=0 ; i < nncp ; ++i )
-    {
-      QPair<QVector3D,qreal> thisBetaSphere;
-      thisBetaSphere.first=QVector3D(ncpList.at(i).x(), ncpList.at(i).y(),ncpList.at(i).z());
-      thisBetaSphere.second=0.10;
-      betaSpheres.append(thisBetaSphere);
-    }
+    QPair<QVector3D,qreal> thisBetaSphere;
+    thisBetaSphere.first=QVector3D(ncpList.at(i).x(), ncpList.at(i).y(),ncpList.at(i).z());
+    thisBetaSphere.second=0.10;
+    betaSpheres.append(thisBetaSphere);
+  }
 
-    Avogadro::QTAIMLSODAIntegrator ode(eval,0);
-    //  Avogadro::QTAIMODEIntegrator ode(eval,0);
+  Avogadro::QTAIMBatchIntegrator ode(eval);
+  ode.setBetaSpheres(betaSpheres);
 
-    ode.setBetaSpheres(betaSpheres);
+  QList<QVector3D> endpoints=ode.integrate(pathStart);
 
-    QVector3D endpoint=ode.integrate(QVector3D(x0,y0,z0));
-    // QList<QVector3D> path=ode.path();
+  QVector<qreal> values(npts*nmode,0.0);
+  for( qint64 p=0 ; p < pathIndex.length() ; ++p )
+  {
+    const qint64 i=pathIndex.at(p);
 
 #define HUGE_REAL_NUMBER 1.e20
     qreal smallestDistance=HUGE_REAL_NUMBER;
@@ -1225,7 +1267,7 @@ QList<QVariant> QTAIMEvaluateProperty(QList<QVariant> variantList)
 
     for( qint64 n=0 ; n < betaSpheres.length()  ; ++n )
     {
-      Matrix<qreal,3,1> a(endpoint.x(),endpoint.y(),endpoint.z());
+      Matrix<qreal,3,1> a(endpoints.at(p).x(),endpoints.at(p).y(),endpoints.at(p).z());
       Matrix<qreal,3,1> b(betaSpheres.at(n).first.x(),
                           betaSpheres.at(n).first.y(),
                           betaSpheres.at(n).first.z());
@@ -1242,44 +1284,34 @@ QList<QVariant> QTAIMEvaluateProperty(QList<QVariant> variantList)
 
     if( basinSet.contains(nucleusIndex) )
     {
-      //      if(nucleusIndex==0)
-      //      {
-      //        QFile file("/scratch/brown/0.txt");
-      //        file.open(QIODevice::WriteOnly | QIODevice::Append);
-      //        QTextStream out(&file);
-      //        out << x0 << " " << y0 << " " << z0 << "\n";
-      //        file.close();
-      //      }
       for( qint64 m=0 ; m < nmode ; ++m )
       {
         if( modeList.at(m) == 0 )
         {
-	    valueList.append(eval.electronDensity( Matrix<qreal,3,1>(x0,y0,z0) ));
+          values[i*nmode+m]=jacobian.at(i)*initialElectronDensity(i);
         }
         else
         {
           qDebug() << "mode not defined";
-          qreal zero=0.0;
-          valueList.append(zero);
         }
       }
     }
-    else
-    {
-      for(qint64 m=0 ; m < nmode ; ++m)
-      {
-        qreal zero=0.0;
-        valueList.append(zero);
-      }
-    }
+  }
+
+  QList<QVariant> valueList;
+  for( qint64 i=0 ; i < values.size() ; ++i )
+  {
+    valueList.append(values.at(i));
   }
 
   return valueList;
 
 }
 
-void property_v(unsigned int /* ndim */, unsigned int npts, const double *xyz, void *param,
-                unsigned int /* dim */, double *fval)
+// Shared by property_v and property_v_rtp: splits the points of one call of
+// the cubature into batches and evaluates the batches in parallel.
+static void property_v_batched(qint64 coordinates, unsigned int npts, const double *xyz,
+                               void *param, double *fval)
 {
 
   QVariantList *paramVariantListPtr = (QVariantList *)param;
@@ -1309,22 +1341,32 @@ void property_v(unsigned int /* ndim */, unsigned int npts, const double *xyz, v
 
   // prepare input
 
+  // A few batches per thread so the load stays balanced, but not so large
+  // that one batch holds up the progress dialog
+  const qint64 maximumBatchSize=256;
+  const qint64 nthread=qMax(1,QThread::idealThreadCount());
+  qint64 batchSize=(npts + 4*nthread - 1)/(4*nthread);
+  batchSize=qBound((qint64) 1, batchSize, maximumBatchSize);
+
   QList<QList<QVariant> > inputList;
+  QList<qint64> batchStart;
 
-  for(unsigned int i=0 ; i < npts ; ++i )
+  for( qint64 start=0 ; start < npts ; start+=batchSize )
   {
-
-    double x0=xyz[i*3+0];
-    double y0=xyz[i*3+1];
-    double z0=xyz[i*3+2];
+    const qint64 end=qMin((qint64) npts, start+batchSize);
 
     QList<QVariant> variantList;
 
     variantList.append(wfnFileName);
+    variantList.append(coordinates);
 
-    variantList.append(x0);
-    variantList.append(y0);
-    variantList.append(z0);
+    variantList.append(end-start);
+    for( qint64 i=start ; i < end ; ++i )
+    {
+      variantList.append(xyz[i*3+0]);
+      variantList.append(xyz[i*3+1]);
+      variantList.append(xyz[i*3+2]);
+    }
 
     variantList.append(nncp);
     for(qint64 n=0; n < nncp ; ++n)
@@ -1348,6 +1390,7 @@ void property_v(unsigned int /* ndim */, unsigned int npts, const double *xyz, v
     }
 
     inputList.append(variantList);
+    batchStart.append(start);
 
   }
 
@@ -1363,318 +1406,50 @@ void property_v(unsigned int /* ndim */, unsigned int npts, const double *xyz, v
   QObject::connect(&futureWatcher, SIGNAL(progressRangeChanged(int,int)), &dialog, SLOT(setRange(int,int)));
   QObject::connect(&futureWatcher, SIGNAL(progressValueChanged(int)), &dialog, SLOT(setValue(int)));
 
-  QFuture<QList<QVariant> > future=QtConcurrent::mapped(inputList, QTAIMEvaluateProperty);
+  QFuture<QList<QVariant> > future=QtConcurrent::mapped(inputList, QTAIMEvaluatePropertyBatch);
   futureWatcher.setFuture(future);
   dialog.exec();
   futureWatcher.waitForFinished();
 
-  QList<QList<QVariant> > results;
-  if( futureWatcher.future().isCanceled() )
-  {
-    results.clear();
-  }
-  else
-  {
-    results=future.results();
-  }
-
-  // harvest results
+  // harvest results, a canceled integration counts as zero
   for(qint64 i=0; i<npts; ++i )
   {
     for(qint64 m=0; m<nmode ; ++m )
     {
-      fval[m*nmode+i]=results.at(i).at(m).toDouble();
+      fval[m*npts+i]=0.0;
     }
   }
 
-}
-
-// TODO: Consider QVariantList. For now, mimic what is known to work.
-// This version performs integration in Spherical Polar Coordinates.
-// Note that the basin limits are not explicitly determined.
-QList<QVariant> QTAIMEvaluatePropertyRTP(QList<QVariant> variantList)
-{
-  /*
-     Order of variantList:
-     QString wfnFileName
-     qreal r0
-     qreal t0
-     qreal p0
-     qint64 nncp
-     qint64 xncp1
-     qint64 yncp1
-     qint64 zncp1
-     qint64 xncp2
-     qint64 yncp2
-     qint64 zncp2
-     ...
-     qint64 nmode
-     qint64 mode1
-     qint64 mode2
-     ...
-     qint64 nbasin
-     qint64 basin1
-     qint64 basin2
-     ...
-  */
-  qint64 counter=0;
-  QString wfnFileName=variantList.at(counter).toString(); counter++;
-  qreal r0=variantList.at(counter).toReal(); counter++;
-  qreal t0=variantList.at(counter).toReal(); counter++;
-  qreal p0=variantList.at(counter).toReal(); counter++;
-
-  qint64 nncp=variantList.at(counter).toLongLong(); counter++;
-  QList<QVector3D> ncpList;
-  for( qint64 n=0 ; n < nncp ; ++n )
-  {
-    qreal x=variantList.at(counter).toReal(); counter++;
-    qreal y=variantList.at(counter).toReal(); counter++;
-    qreal z=variantList.at(counter).toReal(); counter++;
-
-    ncpList.append(QVector3D(x,y,z));
-  }
-
-  qint64 nmode=variantList.at(counter).toLongLong(); counter++;
-  QList<qint64> modeList;
-  for( qint64 m=0 ; m < nmode ; ++m )
+  if( !futureWatcher.future().isCanceled() )
   {
-    qint64 mode=variantList.at(counter).toLongLong(); counter++;
-    modeList.append(mode);
-  }
-
-  qint64 nbasin=variantList.at(counter).toLongLong(); counter++;
-  QList<qint64> basinList;
-  for( qint64 b=0 ; b < nbasin ; ++b )
-  {
-    qint64 basin=variantList.at(counter).toLongLong(); counter++;
-    basinList.append(basin);
-  }
-  QSet<qint64> basinSet=basinList.toSet();
-
-  Matrix<qreal,3,1> r0t0p0;
-  r0t0p0 << r0, t0, p0;
-  Matrix<qreal,3,1> origin;
-  origin <<
-      ncpList.at(basinList.at(0)).x(),
-      ncpList.at(basinList.at(0)).y(),
-      ncpList.at(basinList.at(0)).z();
-
-  Matrix<qreal,3,1> x0y0z0=Avogadro::QTAIMMathUtilities::sphericalToCartesian(r0t0p0, origin );
-
-  qreal x0=x0y0z0(0);
-  qreal y0=x0y0z0(1);
-  qreal z0=x0y0z0(2);
-
-  Avogadro::QTAIMWavefunction wfn;
-  wfn.loadFromBinaryFile(wfnFileName);
-
-  Avogadro::QTAIMWavefunctionEvaluator eval(wfn);
-
-  QList<QVariant> valueList;
-
-  qreal initialElectronDensity=eval.electronDensity( Matrix<qreal,3,1>(x0,y0,z0) );
-
-  // if less than some small value, then return zero for all integrands.
-  if( initialElectronDensity < 1.e-5 )
-  {
-    for( qint64 m=0; m < nmode ; ++m )
+    QList<QList<QVariant> > results=future.results();
+    for( qint64 b=0 ; b < results.length() ; ++b )
     {
-      qreal zero=0.0;
-      valueList.append(zero);
-    }
-  }
-  else
-  {
-    QList<QPair<QVector3D,qreal> > betaSpheres;
-    for( qint64 i=0 ; i < nncp ; ++i )
-    {
-      QPair<QVector3D,qreal> thisBetaSphere;
-      thisBetaSphere.first=QVector3D(ncpList.at(i).x(), ncpList.at(i).y(),ncpList.at(i).z());
-      thisBetaSphere.second=0.10;
-      betaSpheres.append(thisBetaSphere);
-    }
-
-    Avogadro::QTAIMLSODAIntegrator ode(eval,0);
-    //  Avogadro::QTAIMODEIntegrator ode(eval,0);
-
-    ode.setBetaSpheres(betaSpheres);
-
-    QVector3D endpoint=ode.integrate(QVector3D(x0,y0,z0));
-    // QList<QVector3D> path=ode.path();
-
-#define HUGE_REAL_NUMBER 1.e20
-    qreal smallestDistance=HUGE_REAL_NUMBER;
-    qint64 smallestDistanceIndex=-1;
-
-    for( qint64 n=0 ; n < betaSpheres.length()  ; ++n )
-    {
-      Matrix<qreal,3,1> a(endpoint.x(),endpoint.y(),endpoint.z());
-      Matrix<qreal,3,1> b(betaSpheres.at(n).first.x(),
-                          betaSpheres.at(n).first.y(),
-                          betaSpheres.at(n).first.z());
-
-      qreal distance=Avogadro::QTAIMMathUtilities::distance(a,b);
-
-      if( distance < smallestDistance )
-      {
-        smallestDistance = distance;
-        smallestDistanceIndex=n;
-      }
-    }
-    qint64 nucleusIndex=smallestDistanceIndex;
-
-    if( basinSet.contains(nucleusIndex) )
-    {
-      //      if(nucleusIndex==0)
-      //      {
-      //        QFile file("/scratch/brown/0.txt");
-      //        file.open(QIODevice::WriteOnly | QIODevice::Append);
-      //        QTextStream out(&file);
-      //        out << x0 << " " << y0 << " " << z0 << "\n";
-      ////        out << r0 << " " << t0 << " " << p0 << "\n";
-      //        file.close();
-      //      }
-      for( qint64 m=0 ; m < nmode ; ++m )
+      const QList<QVariant> &values=results.at(b);
+      for( qint64 j=0 ; j < values.length()/nmode ; ++j )
       {
-        if( modeList.at(m) == 0 )
-        {
-          valueList.append(
-
-              r0*r0*sin(t0)*eval.electronDensity( Matrix<qreal,3,1>(x0,y0,z0) )
-
-              );
-        }
-        else
+        for(qint64 m=0; m<nmode ; ++m )
         {
-          qDebug() << "mode not defined";
-          qreal zero=0.0;
-          valueList.append(zero);
+          fval[m*npts+batchStart.at(b)+j]=values.at(j*nmode+m).toDouble();
         }
       }
     }
-    else
-    {
-      for(qint64 m=0 ; m < nmode ; ++m)
-      {
-        qreal zero=0.0;
-        valueList.append(zero);
-      }
-    }
   }
 
-  return valueList;
+}
 
+void property_v(unsigned int /* ndim */, unsigned int npts, const double *xyz, void *param,
+                unsigned int /* dim */, double *fval)
+{
+  property_v_batched(0, npts, xyz, param, fval);
 }
 
+// This version performs integration in Spherical Polar Coordinates.
+// Note that the basin limits are not explicitly determined.
 void property_v_rtp(unsigned int /* ndim */, unsigned int npts, const double *xyz, void *param,
                     unsigned int /* fdim */, double *fval)
 {
-
-  QVariantList *paramVariantListPtr = (QVariantList *)param;
-  QVariantList paramVariantList=*paramVariantListPtr;
-
-  qint64 counter=0;
-  QString wfnFileName=paramVariantList.at(counter).toString(); counter++;
-
-  qint64 nncp=paramVariantList.at(counter).toLongLong(); counter++;
-  QList<QVector3D> ncpList;
-  for( qint64 i=0 ; i < nncp ; ++i )
-  {
-    qreal x=paramVariantList.at(counter).toReal(); counter++;
-    qreal y=paramVariantList.at(counter).toReal(); counter++;
-    qreal z=paramVariantList.at(counter).toReal(); counter++;
-
-    ncpList.append(QVector3D(x,y,z));
-  }
-  qint64 nmode=1;
-  qint64 mode=paramVariantList.at(counter).toLongLong(); counter++;
-  QList<qint64> basinList;
-  for( qint64 i=counter ; i < paramVariantList.length() ; ++i )
-  {
-    basinList.append( paramVariantList.at(i).toLongLong()  );
-    counter++;
-  }
-
-  // prepare input
-
-  QList<QList<QVariant> > inputList;
-
-  for(unsigned int i=0 ; i < npts ; ++i )
-  {
-
-    double x0=xyz[i*3+0];
-    double y0=xyz[i*3+1];
-    double z0=xyz[i*3+2];
-
-    QList<QVariant> variantList;
-
-    variantList.append(wfnFileName);
-
-    variantList.append(x0);
-    variantList.append(y0);
-    variantList.append(z0);
-
-    variantList.append(nncp);
-    for(qint64 n=0; n < nncp ; ++n)
-    {
-      variantList.append(ncpList.at(n).x());
-      variantList.append(ncpList.at(n).y());
-      variantList.append(ncpList.at(n).z());
-    }
-
-    variantList.append(nmode); // for now, one mode
-    for( qint64 m=0 ; m<nmode ; ++m)
-    {
-      variantList.append(mode);
-    }
-
-    qint64 nbasin=basinList.length();
-    variantList.append(nbasin);
-    for(qint64 b=0 ; b<basinList.length() ; ++b)
-    {
-      variantList.append(basinList.at(b));
-    }
-
-    inputList.append(variantList);
-
-  }
-
-  // calculate
-
-  QProgressDialog dialog;
-  dialog.setWindowTitle("QTAIM");
-  dialog.setLabelText(QString("Atomic Basin Integration"));
-
-  QFutureWatcher<void> futureWatcher;
-  QObject::connect(&futureWatcher, SIGNAL(finished()), &dialog, SLOT(reset()));
-  QObject::connect(&dialog, SIGNAL(canceled()), &futureWatcher, SLOT(cancel()));
-  QObject::connect(&futureWatcher, SIGNAL(progressRangeChanged(int,int)), &dialog, SLOT(setRange(int,int)));
-  QObject::connect(&futureWatcher, SIGNAL(progressValueChanged(int)), &dialog, SLOT(setValue(int)));
-
-  QFuture<QList<QVariant> > future=QtConcurrent::mapped(inputList, QTAIMEvaluatePropertyRTP);
-  futureWatcher.setFuture(future);
-  dialog.exec();
-  futureWatcher.waitForFinished();
-
-  QList<QList<QVariant> > results;
-  if( futureWatcher.future().isCanceled() )
-  {
-    results.clear();
-  }
-  else
-  {
-    results=future.results();
-  }
-
-  // harvest results
-  for(qint64 i=0; i<npts; ++i )
-  {
-    for(qint64 m=0; m<nmode ; ++m )
-    {
-      fval[m*nmode+i]=results.at(i).at(m).toDouble();
-    }
-  }
-
+  property_v_batched(1, npts, xyz, param, fval);
 }
 
 void property_r(unsigned int ndim, const double *xyz, void *param,
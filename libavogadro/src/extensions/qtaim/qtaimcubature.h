@@ -109,6 +109,7 @@ int adapt_integrate_v(unsigned int fdim, integrand_v f, void *fdata,
 #include "qtaimcriticalpointlocator.h"
 #include "qtaimodeintegrator.h"
 #include "qtaimlsodaintegrator.h"
+#include "qtaimbatchintegrator.h"
 #include "qtaimmathutilities.h"
 
 namespace Avogadro
@@ -39,6 +39,7 @@
 #include <QVector3D>
 #include <QPair>
 #include <QFileDialog>
+#include <QMessageBox>
 #include <QDir>
 
 #include <QThread>
@@ -120,6 +121,58 @@ namespace Avogadro
     m_molecule = molecule;
   }
 
+  void QTAIMExtension::locateRingAndCageCriticalPoints(QTAIMCriticalPointLocator &cpl,
+                                                       GLWidget *widget)
+  {
+    cpl.locateRingCriticalPoints();
+    cpl.locateCageCriticalPoints();
+
+    // Check the whole set against the Poincare-Hopf relation
+    if( !cpl.verifyTopology() )
+    {
+      QMessageBox::warning( widget, tr("QTAIM"),
+                            tr("The critical points found do not satisfy the "
+                               "Poincare-Hopf relation (n - b + r - c = %1 "
+                               "instead of 1), some critical points may be missing.")
+                            .arg(cpl.poincareHopfSum()) );
+    }
+  }
+
+  void QTAIMExtension::setRingAndCageCriticalPoints(const QTAIMCriticalPointLocator &cpl)
+  {
+    const qreal convertBohrToAngstrom=0.529177249;
+
+    QList<QVector3D> rcpList=cpl.ringCriticalPoints();
+    QList<QVector3D> ccpList=cpl.cageCriticalPoints();
+
+    QVariantList xRCPsVariantList;
+    QVariantList yRCPsVariantList;
+    QVariantList zRCPsVariantList;
+    for( qint64 n=0 ; n < rcpList.length() ; ++n )
+    {
+      xRCPsVariantList.append( rcpList.at(n).x() * convertBohrToAngstrom );
+      yRCPsVariantList.append( rcpList.at(n).y() * convertBohrToAngstrom );
+      zRCPsVariantList.append( rcpList.at(n).z() * convertBohrToAngstrom );
+    }
+
+    QVariantList xCCPsVariantList;
+    QVariantList yCCPsVariantList;
+    QVariantList zCCPsVariantList;
+    for( qint64 n=0 ; n < ccpList.length() ; ++n )
+    {
+      xCCPsVariantList.append( ccpList.at(n).x() * convertBohrToAngstrom );
+      yCCPsVariantList.append( ccpList.at(n).y() * convertBohrToAngstrom );
+      zCCPsVariantList.append( ccpList.at(n).z() * convertBohrToAngstrom );
+    }
+
+    m_molecule->setProperty("QTAIMXRingCriticalPoints",xRCPsVariantList);
+    m_molecule->setProperty("QTAIMYRingCriticalPoints",yRCPsVariantList);
+    m_molecule->setProperty("QTAIMZRingCriticalPoints",zRCPsVariantList);
+    m_molecule->setProperty("QTAIMXCageCriticalPoints",xCCPsVariantList);
+    m_molecule->setProperty("QTAIMYCageCriticalPoints",yCCPsVariantList);
+    m_molecule->setProperty("QTAIMZCageCriticalPoints",zCCPsVariantList);
+  }
+
   QUndoCommand* QTAIMExtension::performAction(QAction *action, GLWidget *widget)
   {
     bool wavefunctionAlreadyLoaded;
@@ -261,6 +314,9 @@ namespace Avogadro
         // Locate the Bond Critical Points and Trace Bond Paths
         cpl.locateBondCriticalPoints();
 
+        // Locate the Ring and Cage Critical Points
+        locateRingAndCageCriticalPoints(cpl, widget);
+
         // BCP and Bond Path Results
         QList<QVector3D> bcpList=cpl.bondCriticalPoints();
         QList<QList<QVector3D> > bondPathList=cpl.bondPaths();
@@ -367,6 +423,9 @@ namespace Avogadro
         m_molecule->setProperty("QTAIMXBondPaths",xBondPathsVariantList);
         m_molecule->setProperty("QTAIMYBondPaths",yBondPathsVariantList);
         m_molecule->setProperty("QTAIMZBondPaths",zBondPathsVariantList);
+
+        // Ring and Cage Critical Points
+        setRingAndCageCriticalPoints(cpl);
       }
       break;
     case SecondAction: // Molecular Graph with Lone Pairs
@@ -426,6 +485,9 @@ namespace Avogadro
         // Locate the Bond Critical Points and Trace Bond Paths
         cpl.locateBondCriticalPoints();
 
+        // Locate the Ring and Cage Critical Points
+        locateRingAndCageCriticalPoints(cpl, widget);
+
         // BCP and Bond Path Results
         QList<QVector3D> bcpList=cpl.bondCriticalPoints();
         QList<QList<QVector3D> > bondPathList=cpl.bondPaths();
@@ -533,6 +595,9 @@ namespace Avogadro
         m_molecule->setProperty("QTAIMYBondPaths",yBondPathsVariantList);
         m_molecule->setProperty("QTAIMZBondPaths",zBondPathsVariantList);
 
+        // Ring and Cage Critical Points
+        setRingAndCageCriticalPoints(cpl);
+
         // Locate Electron Density Sources / Lone Pairs
 
         cpl.locateElectronDensitySources();
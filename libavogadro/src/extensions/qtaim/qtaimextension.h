@@ -29,6 +29,8 @@
 
 namespace Avogadro {
 
+  class QTAIMCriticalPointLocator;
+
   class QTAIMExtension : public Extension
   {
     Q_OBJECT
@@ -53,6 +55,17 @@ namespace Avogadro {
     QList<QAction *> m_actions;
     Molecule *m_molecule;
 
+    /**
+     * Locate the ring and cage critical points and warn the user if the
+     * critical points found do not satisfy the Poincare-Hopf relation.
+     */
+    void locateRingAndCageCriticalPoints(QTAIMCriticalPointLocator &cpl,
+                                         GLWidget *widget);
+    /**
+     * Store the ring and cage critical points as molecule properties.
+     */
+    void setRingAndCageCriticalPoints(const QTAIMCriticalPointLocator &cpl);
+
   private Q_SLOTS:
 
   };
@@ -0,0 +1,101 @@
+/**********************************************************************
+  QTAIM - Extension for Quantum Theory of Atoms In Molecules Analysis
+
+  Copyright (C) 2013 Avogadro Developers
+
+  This file is part of the Avogadro molecular editor project.
+  For more information, see <http://avogadro.cc/>
+
+  Avogadro is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  Avogadro is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+  02110-1301, USA.
+**********************************************************************/
+#ifndef QTAIMSPATIALHASH_H
+#define QTAIMSPATIALHASH_H
+
+#include <QHash>
+#include <QList>
+#include <QVector3D>
+
+#include <cmath>
+
+namespace Avogadro {
+
+  // Points hashed into cubic cells, so that the points near a position
+  // are found without looking at all of them
+  class QTAIMSpatialHash
+  {
+  public:
+    explicit QTAIMSpatialHash(qreal cellSize) : m_cellSize(cellSize) {}
+
+    void insert(const QVector3D &point)
+    {
+      m_cells[key(cell(point.x()),cell(point.y()),cell(point.z()))].append(m_points.length());
+      m_points.append(point);
+    }
+
+    // Indices of the points closer than radius to point
+    QList<qint64> neighbors(const QVector3D &point, qreal radius) const
+    {
+      QList<qint64> result;
+      const qint64 reach=(qint64) std::ceil(radius/m_cellSize);
+      const qint64 i=cell(point.x());
+      const qint64 j=cell(point.y());
+      const qint64 k=cell(point.z());
+      for( qint64 di=-reach ; di <= reach ; ++di )
+      {
+        for( qint64 dj=-reach ; dj <= reach ; ++dj )
+        {
+          for( qint64 dk=-reach ; dk <= reach ; ++dk )
+          {
+            QHash<qint64,QList<qint64> >::const_iterator it=m_cells.constFind(key(i+di,j+dj,k+dk));
+            if( it == m_cells.constEnd() )
+            {
+              continue;
+            }
+            foreach( qint64 n, it.value() )
+            {
+              if( (m_points.at(n) - point).length() < radius )
+              {
+                result.append(n);
+              }
+            }
+          }
+        }
+      }
+      return result;
+    }
+
+    bool contains(const QVector3D &point, qreal radius) const
+    {
+      return !neighbors(point,radius).isEmpty();
+    }
+
+  private:
+    qint64 cell(qreal x) const { return (qint64) std::floor(x/m_cellSize); }
+
+    static qint64 key(qint64 i, qint64 j, qint64 k)
+    {
+      const qint64 mask=(Q_INT64_C(1) << 21) - 1;
+      return ( (i & mask) << 42 ) | ( (j & mask) << 21 ) | ( k & mask );
+    }
+
+    qreal m_cellSize;
+    QList<QVector3D> m_points;
+    QHash<qint64,QList<qint64> > m_cells;
+  };
+
+} // namespace Avogadro
+
+#endif // QTAIMSPATIALHASH_H
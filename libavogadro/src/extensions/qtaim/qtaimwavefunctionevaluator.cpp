@@ -275,6 +275,109 @@ namespace Avogadro
 
   }
 
+  // x^n and n*x^(n-1) for every point, n is a small angular momentum
+  static inline void monomialAtPoints(const Array<qreal,1,Dynamic> &x, const qint64 n,
+                                      Array<qreal,1,Dynamic> &xn,
+                                      Array<qreal,1,Dynamic> &dxn)
+  {
+    if( n < 1 )
+    {
+      xn.setOnes(x.size());
+      dxn.setZero(x.size());
+      return;
+    }
+
+    Array<qreal,1,Dynamic> xnm1=Array<qreal,1,Dynamic>::Ones(x.size());
+    for( qint64 i=1 ; i < n ; ++i )
+    {
+      xnm1 *= x;
+    }
+    xn = xnm1*x;
+    dxn = ((qreal) n)*xnm1;
+  }
+
+  void QTAIMWavefunctionEvaluator::primitivesAtPoints(const Matrix<qreal,3,Dynamic> &xyz,
+                                                      Matrix<qreal,Dynamic,Dynamic> &g000,
+                                                      Matrix<qreal,Dynamic,Dynamic> *g100,
+                                                      Matrix<qreal,Dynamic,Dynamic> *g010,
+                                                      Matrix<qreal,Dynamic,Dynamic> *g001)
+  {
+    const qint64 npts=xyz.cols();
+    const bool gradient=( g100 && g010 && g001 );
+
+    g000.setZero(m_nprim,npts);
+    if( gradient )
+    {
+      g100->setZero(m_nprim,npts);
+      g010->setZero(m_nprim,npts);
+      g001->setZero(m_nprim,npts);
+    }
+
+    Array<qreal,1,Dynamic> xx0, yy0, zz0, b0arg, b0;
+    Array<qreal,1,Dynamic> ax0, ay0, az0, ax1, ay1, az1;
+
+    for( qint64 p=0 ; p < m_nprim ; ++p )
+    {
+      xx0 = xyz.row(0).array() - m_X0(p);
+      yy0 = xyz.row(1).array() - m_Y0(p);
+      zz0 = xyz.row(2).array() - m_Z0(p);
+
+      b0arg = -m_alpha(p)*(xx0.square() + yy0.square() + zz0.square());
+
+      // Screened for all points, the row stays zero
+      if( b0arg.maxCoeff() <= m_cutoff )
+      {
+        continue;
+      }
+
+      b0 = (b0arg > m_cutoff).select(b0arg.exp(), 0.0);
+
+      monomialAtPoints(xx0, m_xamom(p), ax0, ax1);
+      monomialAtPoints(yy0, m_yamom(p), ay0, ay1);
+      monomialAtPoints(zz0, m_zamom(p), az0, az1);
+
+      g000.row(p) = (ax0*ay0*az0*b0).matrix();
+
+      if( gradient )
+      {
+        const qreal twoAlpha=2*m_alpha(p);
+        g100->row(p) = (ay0*az0*b0*(ax1-twoAlpha*ax0*xx0)).matrix();
+        g010->row(p) = (ax0*az0*b0*(ay1-twoAlpha*ay0*yy0)).matrix();
+        g001->row(p) = (ax0*ay0*b0*(az1-twoAlpha*az0*zz0)).matrix();
+      }
+    }
+  }
+
+  const Matrix<qreal,Dynamic,1> QTAIMWavefunctionEvaluator::electronDensityAtPoints( const Matrix<qreal,3,Dynamic> &xyz )
+  {
+    Matrix<qreal,Dynamic,Dynamic> g000;
+    primitivesAtPoints(xyz, g000, 0, 0, 0);
+
+    const Matrix<qreal,Dynamic,Dynamic> cdg000 = m_coef*g000;
+
+    return cdg000.cwiseAbs2().transpose()*m_occno;
+  }
+
+  void QTAIMWavefunctionEvaluator::electronDensityAndGradientAtPoints( const Matrix<qreal,3,Dynamic> &xyz,
+                                                                       Matrix<qreal,Dynamic,1> &density,
+                                                                       Matrix<qreal,3,Dynamic> &gradient )
+  {
+    Matrix<qreal,Dynamic,Dynamic> g000, g100, g010, g001;
+    primitivesAtPoints(xyz, g000, &g100, &g010, &g001);
+
+    const Matrix<qreal,Dynamic,Dynamic> cdg000 = m_coef*g000;
+    const Matrix<qreal,Dynamic,Dynamic> cdg100 = m_coef*g100;
+    const Matrix<qreal,Dynamic,Dynamic> cdg010 = m_coef*g010;
+    const Matrix<qreal,Dynamic,Dynamic> cdg001 = m_coef*g001;
+
+    // Same normalization as gradientOfElectronDensity
+    density = cdg000.cwiseAbs2().transpose()*m_occno;
+    gradient.resize(3,xyz.cols());
+    gradient.row(0) = m_occno.transpose()*cdg100.cwiseProduct(cdg000);
+    gradient.row(1) = m_occno.transpose()*cdg010.cwiseProduct(cdg000);
+    gradient.row(2) = m_occno.transpose()*cdg001.cwiseProduct(cdg000);
+  }
+
   const Matrix<qreal,3,3> QTAIMWavefunctionEvaluator::hessianOfElectronDensity( const Matrix<qreal,3,1> xyz )
   {
 
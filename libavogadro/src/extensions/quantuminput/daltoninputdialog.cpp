@@ -119,19 +119,8 @@ namespace Avogadro
 
   void DaltonInputDialog::setMolecule(Molecule *molecule)
   {
-    // Disconnect the old molecule first...
-    if (m_molecule) {
-      disconnect(m_molecule, 0, this, 0);
-    }
-
-    m_molecule = molecule;
-    // Update the preview text whenever atoms are changed
-    connect(m_molecule, SIGNAL(atomRemoved(Atom *)),
-            this, SLOT(updatePreviewText()));
-    connect(m_molecule, SIGNAL(atomAdded(Atom *)),
-            this, SLOT(updatePreviewText()));
-    connect(m_molecule, SIGNAL(atomUpdated(Atom *)),
-            this, SLOT(updatePreviewText()));
+    // Regenerates the preview once the molecule stopped changing
+    InputDialog::setMolecule(molecule);
     // Add atom coordinates
     updatePreviewText();
   }
@@ -80,20 +80,9 @@ namespace Avogadro {
   {
     if(!inputData) return;
 
-    if(m_inputData)
-      disconnect(m_inputData->m_molecule, 0, this, 0);
-
     m_inputData = inputData;
-    m_molecule = m_inputData->m_molecule;
-
-    connect(m_inputData->m_molecule, SIGNAL(atomAdded(Atom*)),
-            this, SLOT(updatePreviewText()));
-    connect(m_inputData->m_molecule, SIGNAL(atomUpdated(Atom*)),
-            this, SLOT(updatePreviewText()));
-    connect(m_inputData->m_molecule, SIGNAL(atomRemoved(Atom*)),
-            this, SLOT(updatePreviewText()));
-    connect(m_inputData->m_molecule, SIGNAL(updated()),
-            this, SLOT(updatePreviewText()));
+    // Regenerates the preview once the molecule stopped changing
+    InputDialog::setMolecule(m_inputData->m_molecule);
   }
 
   void GamessInputDialog::connectBasic()
@@ -96,23 +96,13 @@ namespace Avogadro
 
   void GAMESSUKInputDialog::setMolecule(Molecule *molecule)
   {
-    // Disconnect the old molecule first...
-    if (m_molecule)
-      disconnect(m_molecule, 0, this, 0);
-
-    m_molecule = molecule;
+    // Regenerates the preview once the molecule stopped changing
+    InputDialog::setMolecule(molecule);
 
     // Set multiplicity to the OB value
     OpenBabel::OBMol obmol = m_molecule->OBMol();
     setMultiplicity(obmol.GetTotalSpinMultiplicity());
 
-    // Update the preview text whenever primitives are changed
-    connect(m_molecule, SIGNAL(atomRemoved(Atom *)),
-            this, SLOT(updatePreviewText()));
-    connect(m_molecule, SIGNAL(atomAdded(Atom *)),
-            this, SLOT(updatePreviewText()));
-    connect(m_molecule, SIGNAL(atomUpdated(Atom *)),
-            this, SLOT(updatePreviewText()));
     // Add atom coordinates
     updatePreviewText();
   }
@@ -297,10 +287,39 @@ namespace Avogadro
     mol << "mult " << m_multiplicity << "\n";
     mol << "charge " << m_charge << "\n\n";
 
-    // Geometry specification
-    // Now to output the actual molecular coordinates
+    // Geometry specification, only formatted again after the geometry
+    // changed
+    if (m_molecule) {
+      const QString key = QString("gamessuk/%1/%2").arg(m_coordType)
+        .arg(m_calculationType == TSS);
+      QString coords = cachedBlock(key);
+      if (coords.isNull())
+        coords = cacheBlock(key, generateCoordinates());
+      mol << coords;
+    }
+
+    // Basis set
+    mol << "basis  " << getBasisType(m_basisType) << endl << endl;
+
+    // Set runtype
+    mol << getRunType(m_calculationType) << endl;
+
+    // Set scftype
+    mol << getScfType(m_theoryType) << endl;
+
+    mol << endl;
+    mol << "enter" << endl;
+
+    return buffer;
+  }
+
+  QString GAMESSUKInputDialog::generateCoordinates()
+  {
+    QString buffer;
+    QTextStream mol(&buffer);
+
     // Cartesian coordinates
-    if (m_molecule && m_coordType == CARTESIAN)
+    if (m_coordType == CARTESIAN)
     {
       // Ensure automatic z-matrix generation is used if we are doing a transiation state search
       if (m_calculationType == TSS)
@@ -319,86 +338,66 @@ namespace Avogadro
       mol << "end\n\n";
     }
     // Z-matrix
-    else if (m_molecule && m_coordType == ZMATRIX)
+    else if (m_coordType == ZMATRIX)
     {
-      QTextStream mol(&buffer);
       mol.setFieldAlignment(QTextStream::AlignAccountingStyle);
       mol << "zmatrix angstrom\n";
-      OBAtom *a, *b, *c;
+      const QVector<InputGeometry::ZMatrixEntry> zmat = zMatrix();
+      const QList<Atom *> atoms = m_molecule->atoms();
       double r, w, t;
 
-      /* Taken from OpenBabel's gzmat file format converter */
-      std::vector<OBInternalCoord*> vic;
-      vic.push_back((OpenBabel::OBInternalCoord*)NULL);
-      OpenBabel::OBMol obmol = m_molecule->OBMol();
-      FOR_ATOMS_OF_MOL(atom, &obmol)
-        vic.push_back(new OpenBabel::OBInternalCoord);
-      CartesianToInternal(vic, obmol);
-
-      FOR_ATOMS_OF_MOL(atom, &obmol)
+      foreach (Atom *atom, atoms)
       {
-        a = vic[atom->GetIdx()]->_a;
-        b = vic[atom->GetIdx()]->_b;
-        c = vic[atom->GetIdx()]->_c;
+        const InputGeometry::ZMatrixEntry &entry = zmat[atom->index()];
+        const int idx = atom->index() + 1;
 
-        mol << qSetFieldWidth(3) << QString(etab.GetSymbol(atom->GetAtomicNum()));
+        mol << qSetFieldWidth(3) << QString(etab.GetSymbol(atom->atomicNumber()));
 
-        if (atom->GetIdx() > 1)
-          mol << qSetFieldWidth(0) << "  " << qSetFieldWidth(3) << QString::number(a->GetIdx())
-              << qSetFieldWidth(0) << "  "<< qSetFieldWidth(4) << QString("r") + QString::number(atom->GetIdx());
+        if (idx > 1)
+          mol << qSetFieldWidth(0) << "  " << qSetFieldWidth(3) << QString::number(entry.a + 1)
+              << qSetFieldWidth(0) << "  "<< qSetFieldWidth(4) << QString("r") + QString::number(idx);
 
-        if (atom->GetIdx() > 2)
-          mol << qSetFieldWidth(0) << "  " << qSetFieldWidth(3) << QString::number(b->GetIdx())
-              << qSetFieldWidth(0) << "  "<< qSetFieldWidth(4) << QString("a") + QString::number(atom->GetIdx());
+        if (idx > 2)
+          mol << qSetFieldWidth(0) << "  " << qSetFieldWidth(3) << QString::number(entry.b + 1)
+              << qSetFieldWidth(0) << "  "<< qSetFieldWidth(4) << QString("a") + QString::number(idx);
 
-        if (atom->GetIdx() > 3)
-          mol << qSetFieldWidth(0) << "  " << qSetFieldWidth(3) << QString::number(c->GetIdx())
-              << qSetFieldWidth(0) << "  "<< qSetFieldWidth(4) << QString("d") + QString::number(atom->GetIdx());
+        if (idx > 3)
+          mol << qSetFieldWidth(0) << "  " << qSetFieldWidth(3) << QString::number(entry.c + 1)
+              << qSetFieldWidth(0) << "  "<< qSetFieldWidth(4) << QString("d") + QString::number(idx);
 
         mol << qSetFieldWidth(0) << '\n';
       }
 
       mol << " variables\n";
-      FOR_ATOMS_OF_MOL(atom, &obmol)
+      foreach (Atom *atom, atoms)
       {
-        r = vic[atom->GetIdx()]->_dst;
-        w = vic[atom->GetIdx()]->_ang;
+        const InputGeometry::ZMatrixEntry &entry = zmat[atom->index()];
+        const int idx = atom->index() + 1;
+        r = entry.distance;
+        w = entry.angle;
         if (w < 0.0)
           w += 360.0;
-        t = vic[atom->GetIdx()]->_tor;
+        t = entry.dihedral;
         if (t < 0.0)
           t += 360.0;
-        if (atom->GetIdx() > 1)
-          mol << "   r" << atom->GetIdx() << qSetFieldWidth(15)
+        if (idx > 1)
+          mol << "   r" << idx << qSetFieldWidth(15)
               << qSetRealNumberPrecision(5) << forcepoint << fixed << right
               << r << qSetFieldWidth(0) << '\n';
-        if (atom->GetIdx() > 2)
-          mol << "   a" << atom->GetIdx() << qSetFieldWidth(15)
+        if (idx > 2)
+          mol << "   a" << idx << qSetFieldWidth(15)
               << qSetRealNumberPrecision(5) << forcepoint << fixed << right
               << w << qSetFieldWidth(0) << '\n';
-        if (atom->GetIdx() > 3)
-          mol << "   d" << atom->GetIdx() << qSetFieldWidth(15)
+        if (idx > 3)
+          mol << "   d" << idx << qSetFieldWidth(15)
               << qSetRealNumberPrecision(5) << forcepoint << fixed << right
               << t << qSetFieldWidth(0) << '\n';
       }
-      foreach (OpenBabel::OBInternalCoord *c, vic)
-        delete c;
       // End
       mol << "end\n\n";
     }
 
-    // Basis set
-    mol << "basis  " << getBasisType(m_basisType) << endl << endl;
-
-    // Set runtype
-    mol << getRunType(m_calculationType) << endl;
-
-    // Set scftype
-    mol << getScfType(m_theoryType) << endl;
-
-    mol << endl;
-    mol << "enter" << endl;
-
+    mol.flush();
     return buffer;
   }
 
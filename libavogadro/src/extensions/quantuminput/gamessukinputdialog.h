@@ -75,6 +75,8 @@ namespace Avogadro
 
     // Generate an input deck as a string
     QString generateInputDeck();
+    // The geometry block of the deck, for the current m_coordType
+    QString generateCoordinates();
     // Translate enums to strings
     QString getRunType(calculationType t);
     QString getScfType(theoryType t);
@@ -173,19 +173,8 @@ namespace Avogadro
 
   void GaussianInputDialog::setMolecule(Molecule *molecule)
   {
-    // Disconnect the old molecule first...
-    if (m_molecule) {
-      disconnect(m_molecule, 0, this, 0);
-    }
-
-    m_molecule = molecule;
-    // Update the preview text whenever atoms are changed
-    connect(m_molecule, SIGNAL(atomRemoved(Atom *)),
-            this, SLOT(updatePreviewText()));
-    connect(m_molecule, SIGNAL(atomAdded(Atom *)),
-            this, SLOT(updatePreviewText()));
-    connect(m_molecule, SIGNAL(atomUpdated(Atom *)),
-            this, SLOT(updatePreviewText()));
+    // Regenerates the preview once the molecule stopped changing
+    InputDialog::setMolecule(molecule);
     // Add atom coordinates
     updatePreviewText();
   }
@@ -587,10 +576,26 @@ namespace Avogadro
     // Now for the charge and multiplicity
     mol << m_charge << ' ' << m_multiplicity << '\n';
 
-    // Now to output the actual molecular coordinates
+    // Now to output the actual molecular coordinates, they are only
+    // formatted again after the geometry changed
+    if (m_molecule) {
+      const QString key = QString("gaussian/%1").arg(m_coordType);
+      QString coords = cachedBlock(key);
+      if (coords.isNull())
+        coords = cacheBlock(key, generateCoordinates());
+      mol << coords;
+    }
+
+    return buffer;
+  }
+
+  QString GaussianInputDialog::generateCoordinates()
+  {
+    QString buffer;
+    QTextStream mol(&buffer);
+
     // Cartesian coordinates
-    if (m_molecule && m_coordType == CARTESIAN) {
-      QTextStream mol(&buffer);
+    if (m_coordType == CARTESIAN) {
       QList<Atom *> atoms = m_molecule->atoms();
       foreach (Atom *atom, atoms) {
         mol << qSetFieldWidth(3) << left
@@ -603,43 +608,33 @@ namespace Avogadro
       mol << '\n';
     }
     // Z-matrix
-    else if (m_molecule && m_coordType == ZMATRIX) {
-      QTextStream mol(&buffer);
-      OpenBabel::OBAtom *a, *b, *c;
+    else if (m_coordType == ZMATRIX) {
+      const QVector<InputGeometry::ZMatrixEntry> zmat = zMatrix();
       double r, w, t;
 
-      /* Taken from OpenBabel's gzmat file format converter */
-      std::vector<OpenBabel::OBInternalCoord*> vic;
-      vic.push_back((OpenBabel::OBInternalCoord*)NULL);
-      OpenBabel::OBMol obmol = m_molecule->OBMol();
-      FOR_ATOMS_OF_MOL(atom, &obmol)
-        vic.push_back(new OpenBabel::OBInternalCoord);
-      CartesianToInternal(vic, obmol);
-
       foreach (Atom *atom, m_molecule->atoms()) {
-        a = vic[atom->index()+1]->_a;
-        b = vic[atom->index()+1]->_b;
-        c = vic[atom->index()+1]->_c;
+        const InputGeometry::ZMatrixEntry &entry = zmat[atom->index()];
 
         mol << qSetFieldWidth(3) << left
             << QString(OpenBabel::etab.GetSymbol(atom->atomicNumber()))
             << qSetFieldWidth(0);
         if (atom->index() > 0)
-          mol << ' ' << a->GetIdx() << " B" << atom->index();
+          mol << ' ' << entry.a + 1 << " B" << atom->index();
         if (atom->index() > 1)
-          mol << ' ' << b->GetIdx() << " A" << atom->index();
+          mol << ' ' << entry.b + 1 << " A" << atom->index();
         if (atom->index() > 2)
-          mol << ' ' << c->GetIdx() << " D" << atom->index();
+          mol << ' ' << entry.c + 1 << " D" << atom->index();
         mol << '\n';
       }
 
       mol << "Variables:" << endl;
       foreach (Atom *atom, m_molecule->atoms()) {
-        r = vic[atom->index()+1]->_dst;
-        w = vic[atom->index()+1]->_ang;
+        const InputGeometry::ZMatrixEntry &entry = zmat[atom->index()];
+        r = entry.distance;
+        w = entry.angle;
         if (w < 0.0)
           w += 360.0;
-        t = vic[atom->index()+1]->_tor;
+        t = entry.dihedral;
         if (t < 0.0)
           t += 360.0;
         if (atom->index() > 0)
@@ -656,54 +651,41 @@ namespace Avogadro
               << t << qSetFieldWidth(0) << '\n';
       }
       mol << '\n';
-      foreach(OpenBabel::OBInternalCoord *c, vic)
-        delete c;
     }
-    else if (m_molecule && m_coordType == ZMATRIX_COMPACT)
+    else if (m_coordType == ZMATRIX_COMPACT)
     {
-      QTextStream mol(&buffer);
-      OBAtom *a, *b, *c;
+      const QVector<InputGeometry::ZMatrixEntry> zmat = zMatrix();
       double r, w, t;
 
-      /* Taken from OpenBabel's gzmat file format converter */
-      std::vector<OBInternalCoord*> vic;
-      vic.push_back((OBInternalCoord*)NULL);
-      OpenBabel::OBMol obmol = m_molecule->OBMol();
-      FOR_ATOMS_OF_MOL(atom, &obmol)
-        vic.push_back(new OBInternalCoord);
-      CartesianToInternal(vic, obmol);
-
-      FOR_ATOMS_OF_MOL(atom, &obmol)
+      foreach (Atom *atom, m_molecule->atoms())
       {
-        a = vic[atom->GetIdx()]->_a;
-        b = vic[atom->GetIdx()]->_b;
-        c = vic[atom->GetIdx()]->_c;
-        r = vic[atom->GetIdx()]->_dst;
-        w = vic[atom->GetIdx()]->_ang;
+        const InputGeometry::ZMatrixEntry &entry = zmat[atom->index()];
+        r = entry.distance;
+        w = entry.angle;
         if (w < 0.0)
           w += 360.0;
-        t = vic[atom->GetIdx()]->_tor;
+        t = entry.dihedral;
         if (t < 0.0)
           t += 360.0;
 
-        mol << qSetFieldWidth(3) << left << QString(etab.GetSymbol(atom->GetAtomicNum()))
+        mol << qSetFieldWidth(3) << left
+            << QString(etab.GetSymbol(atom->atomicNumber()))
             << qSetFieldWidth(6) << right;
-        if (atom->GetIdx() > 1)
-          mol << a->GetIdx() << qSetFieldWidth(15)
+        if (atom->index() > 0)
+          mol << entry.a + 1 << qSetFieldWidth(15)
           << qSetRealNumberPrecision(5) << forcepoint << fixed << right << r;
-        if (atom->GetIdx() > 2)
-          mol << qSetFieldWidth(6) << right << b->GetIdx() << qSetFieldWidth(15)
+        if (atom->index() > 1)
+          mol << qSetFieldWidth(6) << right << entry.b + 1 << qSetFieldWidth(15)
           << qSetRealNumberPrecision(5) << forcepoint << fixed << right << w;
-        if (atom->GetIdx() > 3)
-          mol << qSetFieldWidth(6) << right << c->GetIdx() << qSetFieldWidth(15)
+        if (atom->index() > 2)
+          mol << qSetFieldWidth(6) << right << entry.c + 1 << qSetFieldWidth(15)
           << qSetRealNumberPrecision(5) << forcepoint << fixed << right << t;
         mol << qSetFieldWidth(0) << '\n';
       }
       mol << '\n';
-      foreach(OpenBabel::OBInternalCoord *c, vic)
-        delete c;
     }
 
+    mol.flush();
     return buffer;
   }
 
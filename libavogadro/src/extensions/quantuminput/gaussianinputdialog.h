@@ -93,6 +93,8 @@ namespace Avogadro
 
     // Generate an input deck as a string
     QString generateInputDeck();
+    // The coordinate block of the deck, for the current m_coordType
+    QString generateCoordinates();
     // Translate enums to strings
     QString getCalculationType(calculationType t);
     QString getTheoryType(theoryType t);
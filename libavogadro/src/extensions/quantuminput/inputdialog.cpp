@@ -39,7 +39,29 @@ namespace Avogadro
 
   void InputDialog::setMolecule(Molecule *molecule)
   {
+    if (m_geometry)
+      disconnect(m_geometry, 0, this, 0);
+
     m_molecule = molecule;
+    m_geometry = InputGeometry::instance(molecule);
+    if (m_geometry)
+      connect(m_geometry, SIGNAL(changed()), this, SLOT(updatePreviewText()));
+  }
+
+  QString InputDialog::cachedBlock(const QString &key) const
+  {
+    return m_geometry ? m_geometry->block(key) : QString();
+  }
+
+  QString InputDialog::cacheBlock(const QString &key, const QString &text)
+  {
+    return m_geometry ? m_geometry->setBlock(key, text) : text;
+  }
+
+  QVector<InputGeometry::ZMatrixEntry> InputDialog::zMatrix()
+  {
+    return m_geometry ? m_geometry->zMatrix()
+                      : QVector<InputGeometry::ZMatrixEntry>();
   }
 
   QString InputDialog::saveInputFile(QString inputDeck, QString fileType, QString ext)
@@ -27,6 +27,9 @@
 
 #include <avogadro/molecule.h>
 
+#include "inputgeometry.h"
+
+#include <QtCore/QPointer>
 #include <QtCore/QSettings>
 #include <QtGui/QDialog>
 
@@ -42,6 +45,10 @@ namespace Avogadro
     // TODO: other enums also must be shared
     enum coordType{CARTESIAN, ZMATRIX, ZMATRIX_COMPACT};
 
+    /**
+     * Set the molecule of the dialog. updatePreviewText() is called once
+     * after a series of changes to the molecule, see InputGeometry.
+     */
     virtual void setMolecule(Molecule *molecule);
 
     /**
@@ -69,8 +76,24 @@ namespace Avogadro
 
   protected:
     QString saveInputFile(QString inputDeck, QString fileType, QString ext);
+
+    /**
+     * @return The formatted block stored under @p key for the current
+     * geometry, or a null string if it needs to be generated.
+     */
+    QString cachedBlock(const QString &key) const;
+    /**
+     * Keep @p text under @p key until the geometry changes.
+     * @return @p text
+     */
+    QString cacheBlock(const QString &key, const QString &text);
+    /**
+     * @return The Z-matrix of the molecule, shared by all dialogs.
+     */
+    QVector<InputGeometry::ZMatrixEntry> zMatrix();
       
     Molecule* m_molecule;
+    QPointer<InputGeometry> m_geometry;
     QString m_title;
     int m_multiplicity;
     int m_charge;
@@ -0,0 +1,214 @@
+/**********************************************************************
+  InputGeometry - Shared geometry cache for the QC input dialogs
+
+  Copyright (C) 2013 Avogadro Developers
+
+  This file is part of the Avogadro molecular editor project.
+  For more information, see <http://avogadro.cc/>
+
+  Avogadro is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  Avogadro is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+  02110-1301, USA.
+ **********************************************************************/
+
+#include "inputgeometry.h"
+
+#include <avogadro/molecule.h>
+#include <avogadro/moleculesnapshot.h>
+
+#include <Eigen/Geometry>
+
+#include <cmath>
+#include <limits>
+#include <vector>
+
+namespace Avogadro
+{
+  namespace
+  {
+    // Delay after the last change of the molecule before changed() is
+    // emitted, in milliseconds
+    const int updateDelay = 100;
+
+    QHash<Molecule *, InputGeometry *> instances;
+
+    typedef std::vector<Eigen::Vector3d> PositionList;
+    typedef std::vector<std::vector<int> > NeighborList;
+
+    double angle(const Eigen::Vector3d &a, const Eigen::Vector3d &center,
+                 const Eigen::Vector3d &b)
+    {
+      const Eigen::Vector3d u = a - center;
+      const Eigen::Vector3d v = b - center;
+      return std::atan2(u.cross(v).norm(), u.dot(v)) * 180.0 / M_PI;
+    }
+
+    double dihedral(const Eigen::Vector3d &a, const Eigen::Vector3d &b,
+                    const Eigen::Vector3d &c, const Eigen::Vector3d &d)
+    {
+      const Eigen::Vector3d b1 = b - a;
+      const Eigen::Vector3d b2 = c - b;
+      const Eigen::Vector3d b3 = d - c;
+      const Eigen::Vector3d n1 = b1.cross(b2);
+      const Eigen::Vector3d n2 = b2.cross(b3);
+      if (n1.squaredNorm() < 1e-12 || n2.squaredNorm() < 1e-12)
+        return 0.0;
+      return std::atan2(b2.norm() * b1.dot(n2), n1.dot(n2)) * 180.0 / M_PI;
+    }
+
+    bool isLinear(const Eigen::Vector3d &a, const Eigen::Vector3d &center,
+                  const Eigen::Vector3d &b)
+    {
+      double w = angle(a, center, b);
+      return w < 5.0 || w > 175.0;
+    }
+
+    /**
+     * @return The atom with an index below @p limit that is closest to
+     * @p to, trying the atoms bonded to @p to first. Atoms that would make
+     * a linear angle from - to - atom are skipped unless there is nothing
+     * else, as is @p skip.
+     */
+    int reference(const PositionList &pos, const NeighborList &bonded,
+                  int limit, int to, int from, int skip)
+    {
+      for (int pass = 0; pass < 3; ++pass) {
+        int best = -1;
+        double bestDistance = std::numeric_limits<double>::max();
+        const int count = pass == 0 ? int(bonded[to].size()) : limit;
+        for (int k = 0; k < count; ++k) {
+          int j = pass == 0 ? bonded[to][k] : k;
+          if (j >= limit || j == to || j == skip)
+            continue;
+          if (pass < 2 && from >= 0 && isLinear(pos[from], pos[to], pos[j]))
+            continue;
+          double distance = (pos[j] - pos[to]).squaredNorm();
+          if (distance < bestDistance) {
+            bestDistance = distance;
+            best = j;
+          }
+        }
+        if (best >= 0)
+          return best;
+      }
+      return -1;
+    }
+  }
+
+  InputGeometry::InputGeometry(Molecule *molecule) : QObject(molecule),
+    m_molecule(molecule), m_revision(0), m_zMatrixValid(false)
+  {
+    m_timer.setSingleShot(true);
+    m_timer.setInterval(updateDelay);
+    connect(&m_timer, SIGNAL(timeout()), this, SIGNAL(changed()));
+
+    connect(m_molecule, SIGNAL(atomAdded(Atom *)), this, SLOT(invalidate()));
+    connect(m_molecule, SIGNAL(atomRemoved(Atom *)), this, SLOT(invalidate()));
+    connect(m_molecule, SIGNAL(atomUpdated(Atom *)), this, SLOT(invalidate()));
+    connect(m_molecule, SIGNAL(bondAdded(Bond *)), this, SLOT(invalidate()));
+    connect(m_molecule, SIGNAL(bondRemoved(Bond *)), this, SLOT(invalidate()));
+    connect(m_molecule, SIGNAL(primitivesAdded(PrimitiveList)),
+            this, SLOT(invalidate()));
+    connect(m_molecule, SIGNAL(moleculeChanged()), this, SLOT(invalidate()));
+    connect(m_molecule, SIGNAL(updated()), this, SLOT(invalidate()));
+  }
+
+  InputGeometry::~InputGeometry()
+  {
+    instances.remove(m_molecule);
+  }
+
+  InputGeometry * InputGeometry::instance(Molecule *molecule)
+  {
+    if (!molecule)
+      return 0;
+
+    InputGeometry *geometry = instances.value(molecule);
+    if (!geometry) {
+      geometry = new InputGeometry(molecule);
+      instances.insert(molecule, geometry);
+    }
+    return geometry;
+  }
+
+  void InputGeometry::invalidate()
+  {
+    // The caches are dropped right away so that a deck generated before
+    // changed() is emitted is still up to date
+    ++m_revision;
+    m_zMatrixValid = false;
+    m_blocks.clear();
+    m_timer.start();
+  }
+
+  QString InputGeometry::block(const QString &key) const
+  {
+    return m_blocks.value(key);
+  }
+
+  QString InputGeometry::setBlock(const QString &key, const QString &text)
+  {
+    m_blocks.insert(key, text);
+    return text;
+  }
+
+  const QVector<InputGeometry::ZMatrixEntry> & InputGeometry::zMatrix()
+  {
+    if (!m_zMatrixValid) {
+      buildZMatrix();
+      m_zMatrixValid = true;
+    }
+    return m_zMatrix;
+  }
+
+  void InputGeometry::buildZMatrix()
+  {
+    // The snapshot shares the atoms that did not move since the last one
+    const MoleculeSnapshot snapshot = m_molecule->snapshot();
+    const int n = snapshot.numAtoms();
+
+    PositionList pos(n);
+    for (int i = 0; i < n; ++i)
+      pos[i] = snapshot.atomPos(i);
+
+    NeighborList bonded(n);
+    for (unsigned int b = 0; b < snapshot.numBonds(); ++b) {
+      int i = snapshot.bondBeginIndex(b);
+      int j = snapshot.bondEndIndex(b);
+      bonded[i].push_back(j);
+      bonded[j].push_back(i);
+    }
+
+    m_zMatrix.resize(n);
+    for (int i = 0; i < n; ++i) {
+      ZMatrixEntry &entry = m_zMatrix[i];
+      entry.a = entry.b = entry.c = -1;
+      entry.distance = entry.angle = entry.dihedral = 0.0;
+
+      if (i > 0) {
+        entry.a = reference(pos, bonded, i, i, -1, -1);
+        entry.distance = (pos[i] - pos[entry.a]).norm();
+      }
+      if (i > 1) {
+        entry.b = reference(pos, bonded, i, entry.a, i, -1);
+        entry.angle = angle(pos[i], pos[entry.a], pos[entry.b]);
+      }
+      if (i > 2) {
+        entry.c = reference(pos, bonded, i, entry.b, entry.a, entry.a);
+        entry.dihedral = dihedral(pos[i], pos[entry.a], pos[entry.b],
+                                  pos[entry.c]);
+      }
+    }
+  }
+}
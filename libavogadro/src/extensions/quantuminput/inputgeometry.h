@@ -0,0 +1,125 @@
+/**********************************************************************
+  InputGeometry - Shared geometry cache for the QC input dialogs
+
+  Copyright (C) 2013 Avogadro Developers
+
+  This file is part of the Avogadro molecular editor project.
+  For more information, see <http://avogadro.cc/>
+
+  Avogadro is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  Avogadro is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+  02110-1301, USA.
+ **********************************************************************/
+
+#ifndef INPUTGEOMETRY_H
+#define INPUTGEOMETRY_H
+
+#include <QtCore/QObject>
+#include <QtCore/QHash>
+#include <QtCore/QString>
+#include <QtCore/QTimer>
+#include <QtCore/QVector>
+
+namespace Avogadro
+{
+  class Molecule;
+
+  /**
+   * @class InputGeometry inputgeometry.h
+   * @brief Geometry shared by all input dialogs of a molecule.
+   *
+   * The input dialogs used to regenerate their whole input deck for
+   * every atom signal of the molecule. InputGeometry collects those
+   * signals and emits changed() once, shortly after the molecule stopped
+   * changing. It also keeps a geometry revision: the Z-matrix and any
+   * formatted coordinate block stored with setBlock() are only rebuilt
+   * after the geometry changed, not when an option of a dialog changed.
+   *
+   * There is one instance per molecule, shared by all dialogs, see
+   * instance().
+   */
+  class InputGeometry : public QObject
+  {
+  Q_OBJECT
+  public:
+    /**
+     * One row of a Z-matrix. The indices are zero based atom indices and
+     * -1 for the first atoms which do not have all references. Angles are
+     * in degrees, the dihedral is in the range (-180, 180].
+     */
+    struct ZMatrixEntry
+    {
+      int a, b, c;
+      double distance, angle, dihedral;
+    };
+
+    /**
+     * @return The geometry of @p molecule, created on first use and
+     * deleted with the molecule.
+     */
+    static InputGeometry * instance(Molecule *molecule);
+
+    Molecule * molecule() const { return m_molecule; }
+
+    /**
+     * @return A number that changes whenever atoms or bonds change.
+     */
+    unsigned int revision() const { return m_revision; }
+
+    /**
+     * @return The Z-matrix of the molecule, one entry per atom. Each atom
+     * is defined by the closest preceding atom (bonded atoms first), and
+     * the angle and dihedral references follow the bonds of that atom
+     * where possible, avoiding linear angles.
+     */
+    const QVector<ZMatrixEntry> & zMatrix();
+
+    /**
+     * @return The text stored under @p key for the current revision, or
+     * a null string. Keys should include the dialog and any option that
+     * changes the text, e.g. "gaussian/zmatrix".
+     */
+    QString block(const QString &key) const;
+
+    /**
+     * Store @p text under @p key until the geometry changes.
+     * @return @p text
+     */
+    QString setBlock(const QString &key, const QString &text);
+
+  Q_SIGNALS:
+    /**
+     * Emitted once after a series of changes to the molecule.
+     */
+    void changed();
+
+  private Q_SLOTS:
+    void invalidate();
+
+  private:
+    explicit InputGeometry(Molecule *molecule);
+    ~InputGeometry();
+
+    void buildZMatrix();
+
+    Molecule *m_molecule;
+    unsigned int m_revision;
+    bool m_zMatrixValid;
+    QVector<ZMatrixEntry> m_zMatrix;
+    QHash<QString, QString> m_blocks;
+    QTimer m_timer;
+  };
+}
+
+#endif
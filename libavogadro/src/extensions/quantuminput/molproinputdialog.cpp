@@ -89,18 +89,8 @@ namespace Avogadro
 
   void MolproInputDialog::setMolecule(Molecule *molecule)
   {
-    // Disconnect the old molecule first...
-    if (m_molecule)
-      disconnect(m_molecule, 0, this, 0);
-
-    m_molecule = molecule;
-    // Update the preview text whenever primitives are changed
-    connect(m_molecule, SIGNAL(atomRemoved(Atom *)),
-            this, SLOT(updatePreviewText()));
-    connect(m_molecule, SIGNAL(atomAdded(Atom *)),
-            this, SLOT(updatePreviewText()));
-    connect(m_molecule, SIGNAL(atomUpdated(Atom *)),
-            this, SLOT(updatePreviewText()));
+    // Regenerates the preview once the molecule stopped changing
+    InputDialog::setMolecule(molecule);
     // Add atom coordinates
     updatePreviewText();
   }
@@ -261,9 +251,45 @@ namespace Avogadro
 
     mol << '\n';
 
-    // Now to output the actual molecular coordinates
+    // Now to output the actual molecular coordinates, they are only
+    // formatted again after the geometry changed
+    if (m_molecule) {
+      const QString key = QString("molpro/%1/%2").arg(m_coordType).arg(m_2009);
+      QString coords = cachedBlock(key);
+      if (coords.isNull())
+        coords = cacheBlock(key, generateCoordinates());
+      mol << coords;
+    }
+
+    mol << '\n';
+
+    // Now specify the job type
+    if (m_theoryType != B3LYP) {
+      mol << "{" << "rhf" << '\n';
+      mol << getWavefunction() << "}\n";
+    }
+    if (m_theoryType != RHF) {
+      mol << "{" << getTheoryType(m_theoryType) << '\n';
+      mol << getWavefunction() << "}\n";
+    }
+    
+    mol << '\n';
+
+    // Now for the calculation type
+    mol << getCalculationType(m_calculationType);
+
+    mol << "---\n";
+
+    return buffer;
+  }
+
+  QString MolproInputDialog::generateCoordinates()
+  {
+    QString buffer;
+    QTextStream mol(&buffer);
+
     // Cartesian coordinates
-    if (m_molecule && m_coordType == CARTESIAN)
+    if (m_coordType == CARTESIAN)
     {
       if (!m_2009) {
         mol << "geomtyp=xyz" << '\n';
@@ -285,38 +311,33 @@ namespace Avogadro
       mol << "}" << '\n';
     }
     // Z-matrix
-    else if (m_molecule && m_coordType == ZMATRIX)
+    else if (m_coordType == ZMATRIX)
     {
-      OBAtom *a, *b, *c;
+      const QVector<InputGeometry::ZMatrixEntry> zmat = zMatrix();
+      const QList<Atom *> atoms = m_molecule->atoms();
       double r, w, t;
 
-      /* Taken from OpenBabel's gzmat file format converter */
-      std::vector<OBInternalCoord*> vic;
-      vic.push_back((OpenBabel::OBInternalCoord*)NULL);
-      OpenBabel::OBMol obmol = m_molecule->OBMol();
-      FOR_ATOMS_OF_MOL(atom, &obmol)
-        vic.push_back(new OpenBabel::OBInternalCoord);
-      CartesianToInternal(vic, obmol);
-
-      FOR_ATOMS_OF_MOL(atom, &obmol)
+      foreach (Atom *atom, atoms)
       {
-        r = vic[atom->GetIdx()]->_dst;
-        w = vic[atom->GetIdx()]->_ang;
+        const InputGeometry::ZMatrixEntry &entry = zmat[atom->index()];
+        const int idx = atom->index() + 1;
+        r = entry.distance;
+        w = entry.angle;
         if (w < 0.0)
           w += 360.0;
-        t = vic[atom->GetIdx()]->_tor;
+        t = entry.dihedral;
         if (t < 0.0)
           t += 360.0;
-        if (atom->GetIdx() > 1)
-          mol << "   r" << atom->GetIdx() << " = " << qSetFieldWidth(15)
+        if (idx > 1)
+          mol << "   r" << idx << " = " << qSetFieldWidth(15)
               << qSetRealNumberPrecision(5) << forcepoint << fixed << right
               << r << qSetFieldWidth(0) << " ang\n";
-        if (atom->GetIdx() > 2)
-          mol << "   a" << atom->GetIdx() << " = " << qSetFieldWidth(15)
+        if (idx > 2)
+          mol << "   a" << idx << " = " << qSetFieldWidth(15)
               << qSetRealNumberPrecision(5) << forcepoint << fixed << right
               << w << qSetFieldWidth(0) << " degree\n";
-        if (atom->GetIdx() > 3)
-          mol << "   d" << atom->GetIdx() << " = " << qSetFieldWidth(15)
+        if (idx > 3)
+          mol << "   d" << idx << " = " << qSetFieldWidth(15)
               << qSetRealNumberPrecision(5) << forcepoint << fixed << right
               << t << qSetFieldWidth(0) << " degree\n";
       }
@@ -329,99 +350,67 @@ namespace Avogadro
         mol << "nosym" << '\n'; /* FIXME */
         mol << "ang" << '\n';
       }
-      FOR_ATOMS_OF_MOL(atom, &obmol)
+      foreach (Atom *atom, atoms)
       {
-        a = vic[atom->GetIdx()]->_a;
-        b = vic[atom->GetIdx()]->_b;
-        c = vic[atom->GetIdx()]->_c;
-
-        mol << QString(etab.GetSymbol(atom->GetAtomicNum()));
-        if (atom->GetIdx() > 1)
-          mol << ", " << QString::number(a->GetIdx())
-              << ", r" << atom->GetIdx();
-        if (atom->GetIdx() > 2)
-          mol << ", " << QString::number(b->GetIdx())
-              << ", a" << atom->GetIdx();
-        if (atom->GetIdx() > 3)
-          mol << ", " << QString::number(c->GetIdx())
-              << ", d" << atom->GetIdx();
+        const InputGeometry::ZMatrixEntry &entry = zmat[atom->index()];
+        const int idx = atom->index() + 1;
+
+        mol << QString(etab.GetSymbol(atom->atomicNumber()));
+        if (idx > 1)
+          mol << ", " << QString::number(entry.a + 1)
+              << ", r" << idx;
+        if (idx > 2)
+          mol << ", " << QString::number(entry.b + 1)
+              << ", a" << idx;
+        if (idx > 3)
+          mol << ", " << QString::number(entry.c + 1)
+              << ", d" << idx;
         mol << '\n';
       }
       mol << "}" << '\n';
-      foreach (OpenBabel::OBInternalCoord *c, vic)
-        delete c;
     }
-    else if (m_molecule && m_coordType == ZMATRIX_COMPACT)
+    else if (m_coordType == ZMATRIX_COMPACT)
     {
-      QTextStream mol(&buffer);
-      OBAtom *a, *b, *c;
+      const QVector<InputGeometry::ZMatrixEntry> zmat = zMatrix();
       double r, w, t;
 
       mol << "geometry={" << '\n';
       if(!m_2009) {
-        mol << "nosym" << '\n'; /* FIXME */        
+        mol << "nosym" << '\n'; /* FIXME */
       }
       mol << "ang" << '\n';
-      /* Taken from OpenBabel's gzmat file format converter */
-      std::vector<OBInternalCoord*> vic;
-      vic.push_back((OpenBabel::OBInternalCoord*)NULL);
-      OpenBabel::OBMol obmol = m_molecule->OBMol();
-      FOR_ATOMS_OF_MOL(atom, &obmol)
-        vic.push_back(new OpenBabel::OBInternalCoord);
-      CartesianToInternal(vic, obmol);
-
-      FOR_ATOMS_OF_MOL(atom, &obmol)
+
+      foreach (Atom *atom, m_molecule->atoms())
       {
-        a = vic[atom->GetIdx()]->_a;
-        b = vic[atom->GetIdx()]->_b;
-        c = vic[atom->GetIdx()]->_c;
-        r = vic[atom->GetIdx()]->_dst;
-        w = vic[atom->GetIdx()]->_ang;
+        const InputGeometry::ZMatrixEntry &entry = zmat[atom->index()];
+        const int idx = atom->index() + 1;
+        r = entry.distance;
+        w = entry.angle;
         if (w < 0.0)
           w += 360.0;
-        t = vic[atom->GetIdx()]->_tor;
+        t = entry.dihedral;
         if (t < 0.0)
           t += 360.0;
 
-        mol << QString(etab.GetSymbol(atom->GetAtomicNum()));
-        if (atom->GetIdx() > 1)
-          mol << ", " << QString::number(a->GetIdx()) << ", "
-              << qSetRealNumberPrecision(5) << forcepoint 
-	      << fixed << right << r;
-        if (atom->GetIdx() > 2)
-          mol << ", " << QString::number(b->GetIdx()) << ", "
-              << qSetRealNumberPrecision(5) << forcepoint 
-	      << fixed << right << w;
-        if (atom->GetIdx() > 3)
-          mol << ", " << QString::number(c->GetIdx()) << ", " 
-              << qSetRealNumberPrecision(5) << forcepoint 
+        mol << QString(etab.GetSymbol(atom->atomicNumber()));
+        if (idx > 1)
+          mol << ", " << QString::number(entry.a + 1) << ", "
+              << qSetRealNumberPrecision(5) << forcepoint
+              << fixed << right << r;
+        if (idx > 2)
+          mol << ", " << QString::number(entry.b + 1) << ", "
+              << qSetRealNumberPrecision(5) << forcepoint
+              << fixed << right << w;
+        if (idx > 3)
+          mol << ", " << QString::number(entry.c + 1) << ", "
+              << qSetRealNumberPrecision(5) << forcepoint
               << fixed << right << t;
         mol << qSetFieldWidth(0) << '\n';
       }
       mol << "}" << '\n';
-      foreach (OpenBabel::OBInternalCoord *c, vic)
-        delete c;
     }
 
-    mol << '\n';
-
-    // Now specify the job type
-    if (m_theoryType != B3LYP) {
-      mol << "{" << "rhf" << '\n';
-      mol << getWavefunction() << "}\n";
-    }
-    if (m_theoryType != RHF) {
-      mol << "{" << getTheoryType(m_theoryType) << '\n';
-      mol << getWavefunction() << "}\n";
-    }
-    
-    mol << '\n';
-
-    // Now for the calculation type
-    mol << getCalculationType(m_calculationType);
-
-    mol << "---\n";
-
+    mol.flush();
     return buffer;
   }
 
@@ -429,13 +418,12 @@ namespace Avogadro
   {
     QString buffer;
     QTextStream wf(&buffer);
-    OpenBabel::OBMol obmol = m_molecule->OBMol();
     int num_electrons;
     int spin;
 
     num_electrons = -m_charge;
-    FOR_ATOMS_OF_MOL(atom, &obmol)
-      num_electrons += atom->GetAtomicNum();
+    foreach (const Atom *atom, m_molecule->atoms())
+      num_electrons += atom->atomicNumber();
     spin = m_multiplicity - 1;
 
     //  TODO: space symmetry
@@ -74,6 +74,8 @@ namespace Avogadro
 
     // Generate an input deck as a string
     QString generateInputDeck();
+    // The geometry block of the deck, for the current m_coordType
+    QString generateCoordinates();
     // Translate enums to strings
     QString getCalculationType(calculationType t);
     QString getWavefunction(void);
@@ -31,7 +31,7 @@
 #include <openbabel/mol.h>
 
 #include <QString>
-//#include <QTextStream>
+#include <QTextStream>
 #include <QFileDialog>
 #include <QMessageBox>
 #include <QSettings>
@@ -39,9 +39,6 @@
 
 namespace Avogadro
 {
-  using OpenBabel::OBAtom;
-  using OpenBabel::OBInternalCoord;
-  using OpenBabel::OBMolAtomIter;
   using OpenBabel::etab;
 
 #ifdef Q_WS_WIN
@@ -98,18 +95,8 @@ namespace Avogadro
 
   void MOPACInputDialog::setMolecule(Molecule *molecule)
   {
-    // Disconnect the old molecule first...
-    if (m_molecule)
-      disconnect(m_molecule, 0, this, 0);
-
-    m_molecule = molecule;
-    // Update the preview text whenever atoms are changed
-    connect(m_molecule, SIGNAL(atomRemoved(Atom *)),
-            this, SLOT(updatePreviewText()));
-    connect(m_molecule, SIGNAL(atomAdded(Atom *)),
-            this, SLOT(updatePreviewText()));
-    connect(m_molecule, SIGNAL(atomUpdated(Atom *)),
-            this, SLOT(updatePreviewText()));
+    // Regenerates the preview once the molecule stopped changing
+    InputDialog::setMolecule(molecule);
     // Add atom coordinates
     updatePreviewText();
   }
@@ -398,7 +385,26 @@ namespace Avogadro
 
     mol << m_title << "\n\n";
 
-    // Now to output the actual molecular coordinates
+    // Now to output the actual molecular coordinates, they are only
+    // formatted again after the geometry changed
+    if (m_molecule) {
+      const QString key = QString("mopac/%1/%2").arg(m_coordType)
+        .arg(m_calculationType == SP);
+      QString coords = cachedBlock(key);
+      if (coords.isNull())
+        coords = cacheBlock(key, generateCoordinates());
+      mol << coords;
+    }
+    mol << "\n\n";
+
+    return buffer;
+  }
+
+  QString MOPACInputDialog::generateCoordinates()
+  {
+    QString buffer;
+    QTextStream mol(&buffer);
+
     QString optimizationFlag;
     if (m_calculationType == SP)
       optimizationFlag = " 0 "; // we could actually obey constraints easily
@@ -406,7 +412,7 @@ namespace Avogadro
       optimizationFlag = " 1 ";
 
     // Cartesian coordinates
-    if (m_molecule && m_coordType == CARTESIAN)
+    if (m_coordType == CARTESIAN)
       {
         QList<Atom *> atoms = m_molecule->atoms();
         foreach (Atom *atom, atoms) {
@@ -421,36 +427,26 @@ namespace Avogadro
         }
       }
     // Z-matrix
-    else if (m_molecule && m_coordType == ZMATRIX)
+    else if (m_coordType == ZMATRIX)
       {
-        OBAtom *a, *b, *c;
+        const QVector<InputGeometry::ZMatrixEntry> zmat = zMatrix();
         double r, w, t;
 
-        /* Taken from OpenBabel's gzmat file format converter */
-        std::vector<OBInternalCoord*> vic;
-        vic.push_back((OBInternalCoord*)NULL);
-        OpenBabel::OBMol obmol = m_molecule->OBMol();
-        FOR_ATOMS_OF_MOL(atom, &obmol)
-          vic.push_back(new OBInternalCoord);
-        CartesianToInternal(vic, obmol);
-
-        FOR_ATOMS_OF_MOL(atom, &obmol)
+        foreach (Atom *atom, m_molecule->atoms())
           {
-            a = vic[atom->GetIdx()]->_a;
-            b = vic[atom->GetIdx()]->_b;
-            c = vic[atom->GetIdx()]->_c;
-            r = vic[atom->GetIdx()]->_dst;
-            w = vic[atom->GetIdx()]->_ang;
+            const InputGeometry::ZMatrixEntry &entry = zmat[atom->index()];
+            r = entry.distance;
+            w = entry.angle;
             if (w < 0.0)
               w += 360.0;
-            t = vic[atom->GetIdx()]->_tor;
+            t = entry.dihedral;
             if (t < 0.0)
               t += 360.0;
 
             mol << qSetFieldWidth(4) << right
-                << QString(etab.GetSymbol(atom->GetAtomicNum()));
+                << QString(etab.GetSymbol(atom->atomicNumber()));
 
-            QString buffer = QString("%1 %2 %3 %4 %5 %6")
+            QString line = QString("%1 %2 %3 %4 %5 %6")
               .arg(r, 10, 'f', 6)
               .arg(optimizationFlag)
               .arg(w, 10, 'f', 6)
@@ -458,25 +454,15 @@ namespace Avogadro
               .arg(t, 10, 'f', 6)
               .arg(optimizationFlag);
 
-            mol << buffer;
+            mol << line;
 
-            int aIndex, bIndex, cIndex;
-            aIndex = bIndex = cIndex = 0;
-
-            if (atom->GetIdx() > 1)
-              aIndex = a->GetIdx();
-            if (atom->GetIdx() > 2)
-              bIndex = b->GetIdx();
-            if (atom->GetIdx() > 3)
-              cIndex = c->GetIdx();
-
-            mol << ' ' << aIndex << ' ' << bIndex << ' ' << cIndex << '\n';
+            // MOPAC uses 0 for the missing references of the first atoms
+            mol << ' ' << entry.a + 1 << ' ' << entry.b + 1
+                << ' ' << entry.c + 1 << '\n';
           }
-        foreach(OBInternalCoord *c, vic)
-          delete c;
       }
-    mol << "\n\n";
 
+    mol.flush();
     return buffer;
   }
 
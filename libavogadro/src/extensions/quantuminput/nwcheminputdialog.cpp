@@ -88,23 +88,13 @@ namespace Avogadro
 
   void NWChemInputDialog::setMolecule(Molecule *molecule)
   {
-    // Disconnect the old molecule first...
-    if (m_molecule)
-      disconnect(m_molecule, 0, this, 0);
-
-    m_molecule = molecule;
+    // Regenerates the preview once the molecule stopped changing
+    InputDialog::setMolecule(molecule);
 
     // Set multiplicity to the OB value
     OpenBabel::OBMol obmol = m_molecule->OBMol();
     setMultiplicity(obmol.GetTotalSpinMultiplicity());
 
-    // Update the preview text whenever primitives are changed
-    connect(m_molecule, SIGNAL(atomRemoved(Atom *)),
-            this, SLOT(updatePreviewText()));
-    connect(m_molecule, SIGNAL(atomAdded(Atom *)),
-            this, SLOT(updatePreviewText()));
-    connect(m_molecule, SIGNAL(atomUpdated(Atom *)),
-            this, SLOT(updatePreviewText()));
     // Add atom coordinates
     updatePreviewText();
   }
@@ -266,11 +256,86 @@ namespace Avogadro
 
     // Geometry specification
     mol << "geometry units angstroms print";
-    // Now to output the actual molecular coordinates
+    // Now to output the actual molecular coordinates, they are only
+    // formatted again after the geometry changed
+    if (m_molecule) {
+      const QString key = QString("nwchem/%1").arg(m_coordType);
+      QString coords = cachedBlock(key);
+      if (coords.isNull())
+        coords = cacheBlock(key, generateCoordinates());
+      mol << coords;
+    }
+    mol << "end\n\n";
+
+    // Basis set
+    mol << "basis";
+
+    // Need spherical keyword if using Dunning correlation consistent basis sets
+    if ( m_basisType == ccpVDZ || m_basisType == ccpVTZ )
+      mol << " spherical";
+
+    mol << endl;
+
+    mol << "  * library " << getBasisType(m_basisType) << '\n';
+    mol << "end\n\n";
+
+    // theory directives (multiplicity, too)
+    switch (m_theoryType)
+      {
+      case B3LYP:
+        mol << "dft\n  xc b3lyp\n  mult " << m_multiplicity << "\nend\n\n";
+        break;
+      case MP2:
+        mol << "mp2\n";
+        mol << "  # Exclude core electrons from MP2 treatment\n";
+        mol << "  freeze atomic\n";
+        mol << "end\n\n";
+        break;
+      case CCSD:
+        mol << "ccsd\n";
+        mol << "  # Exclude core electrons from CCSD treatment\n";
+        mol << "  freeze atomic\n";
+        mol << "end\n\n";
+        break;
+      default:
+      case RHF:
+          break;
+      }
+
+    // Task directive
+    mol << "task ";
+
+    // Set theory level:
+    switch (m_theoryType)
+      {
+      case B3LYP:
+        mol << "dft ";
+        break;
+      case CCSD:
+        mol << "ccsd ";
+        break;
+      case MP2:
+        mol << "mp2 ";
+        break;
+      default:
+      case RHF:
+        mol << "scf ";
+        break;
+      }
+
+    mol << getCalculationType(m_calculationType) << endl;
+
+    return buffer;
+  }
+
+  QString NWChemInputDialog::generateCoordinates()
+  {
+    QString buffer;
+    QTextStream mol(&buffer);
+
     // Cartesian coordinates
-    if (m_molecule && m_coordType == CARTESIAN)
+    if (m_coordType == CARTESIAN)
     {
-      QTextStream mol(&buffer);
       mol << " xyz autosym\n";
       QList<Atom *> atoms = m_molecule->atoms();
       foreach (Atom *atom, atoms) {
@@ -283,184 +348,106 @@ namespace Avogadro
       }
     }
     // Z-matrix
-    else if (m_molecule && m_coordType == ZMATRIX)
+    else if (m_coordType == ZMATRIX)
     {
-      QTextStream mol(&buffer);
       mol.setFieldAlignment(QTextStream::AlignAccountingStyle);
       mol << "\n zmatrix\n";
-      OBAtom *a, *b, *c;
+      const QVector<InputGeometry::ZMatrixEntry> zmat = zMatrix();
+      const QList<Atom *> atoms = m_molecule->atoms();
       double r, w, t;
 
-      /* Taken from OpenBabel's gzmat file format converter */
-      std::vector<OBInternalCoord*> vic;
-      vic.push_back((OpenBabel::OBInternalCoord*)NULL);
-      OpenBabel::OBMol obmol = m_molecule->OBMol();
-      FOR_ATOMS_OF_MOL(atom, &obmol)
-        vic.push_back(new OpenBabel::OBInternalCoord);
-      CartesianToInternal(vic, obmol);
-
-      FOR_ATOMS_OF_MOL(atom, &obmol)
+      foreach (Atom *atom, atoms)
       {
-        a = vic[atom->GetIdx()]->_a;
-        b = vic[atom->GetIdx()]->_b;
-        c = vic[atom->GetIdx()]->_c;
+        const InputGeometry::ZMatrixEntry &entry = zmat[atom->index()];
+        const int idx = atom->index() + 1;
 
-        mol << qSetFieldWidth(3) << QString(etab.GetSymbol(atom->GetAtomicNum()));
+        mol << qSetFieldWidth(3) << QString(etab.GetSymbol(atom->atomicNumber()));
 
-        if (atom->GetIdx() > 1)
-          mol << qSetFieldWidth(0) << "  " << qSetFieldWidth(3) << QString::number(a->GetIdx())
-              << qSetFieldWidth(0) << "  "<< qSetFieldWidth(4) << QString("r") + QString::number(atom->GetIdx());
+        if (idx > 1)
+          mol << qSetFieldWidth(0) << "  " << qSetFieldWidth(3) << QString::number(entry.a + 1)
+              << qSetFieldWidth(0) << "  "<< qSetFieldWidth(4) << QString("r") + QString::number(idx);
 
-        if (atom->GetIdx() > 2)
-          mol << qSetFieldWidth(0) << "  " << qSetFieldWidth(3) << QString::number(b->GetIdx())
-              << qSetFieldWidth(0) << "  "<< qSetFieldWidth(4) << QString("a") + QString::number(atom->GetIdx());
+        if (idx > 2)
+          mol << qSetFieldWidth(0) << "  " << qSetFieldWidth(3) << QString::number(entry.b + 1)
+              << qSetFieldWidth(0) << "  "<< qSetFieldWidth(4) << QString("a") + QString::number(idx);
 
-        if (atom->GetIdx() > 3)
-          mol << qSetFieldWidth(0) << "  " << qSetFieldWidth(3) << QString::number(c->GetIdx())
-              << qSetFieldWidth(0) << "  "<< qSetFieldWidth(4) << QString("d") + QString::number(atom->GetIdx());
+        if (idx > 3)
+          mol << qSetFieldWidth(0) << "  " << qSetFieldWidth(3) << QString::number(entry.c + 1)
+              << qSetFieldWidth(0) << "  "<< qSetFieldWidth(4) << QString("d") + QString::number(idx);
 
         mol << qSetFieldWidth(0) << '\n';
       }
 
       mol << " variables\n";
-      FOR_ATOMS_OF_MOL(atom, &obmol)
+      foreach (Atom *atom, atoms)
       {
-        r = vic[atom->GetIdx()]->_dst;
-        w = vic[atom->GetIdx()]->_ang;
+        const InputGeometry::ZMatrixEntry &entry = zmat[atom->index()];
+        const int idx = atom->index() + 1;
+        r = entry.distance;
+        w = entry.angle;
         if (w < 0.0)
           w += 360.0;
-        t = vic[atom->GetIdx()]->_tor;
+        t = entry.dihedral;
         if (t < 0.0)
           t += 360.0;
-        if (atom->GetIdx() > 1)
-          mol << "   r" << atom->GetIdx() << qSetFieldWidth(15)
+        if (idx > 1)
+          mol << "   r" << idx << qSetFieldWidth(15)
               << qSetRealNumberPrecision(5) << forcepoint << fixed << right
               << r << qSetFieldWidth(0) << '\n';
-        if (atom->GetIdx() > 2)
-          mol << "   a" << atom->GetIdx() << qSetFieldWidth(15)
+        if (idx > 2)
+          mol << "   a" << idx << qSetFieldWidth(15)
               << qSetRealNumberPrecision(5) << forcepoint << fixed << right
               << w << qSetFieldWidth(0) << '\n';
-        if (atom->GetIdx() > 3)
-          mol << "   d" << atom->GetIdx() << qSetFieldWidth(15)
+        if (idx > 3)
+          mol << "   d" << idx << qSetFieldWidth(15)
               << qSetRealNumberPrecision(5) << forcepoint << fixed << right
               << t << qSetFieldWidth(0) << '\n';
       }
       mol << " end\n";
-      foreach (OpenBabel::OBInternalCoord *c, vic)
-        delete c;
     }
     // Compact ZMatrix
-    else if (m_molecule && m_coordType == ZMATRIX_COMPACT)
+    else if (m_coordType == ZMATRIX_COMPACT)
     {
-      QTextStream mol(&buffer);
       mol << " zmatrix\n";
-      OBAtom *a, *b, *c;
+      const QVector<InputGeometry::ZMatrixEntry> zmat = zMatrix();
+      const QList<Atom *> atoms = m_molecule->atoms();
       double r, w, t;
 
-      /* Taken from OpenBabel's gzmat file format converter */
-      std::vector<OBInternalCoord*> vic;
-      vic.push_back((OpenBabel::OBInternalCoord*)NULL);
-      OpenBabel::OBMol obmol = m_molecule->OBMol();
-      FOR_ATOMS_OF_MOL(atom, &obmol)
-        vic.push_back(new OpenBabel::OBInternalCoord);
-      CartesianToInternal(vic, obmol);
-
-      FOR_ATOMS_OF_MOL(atom, &obmol)
+      foreach (Atom *atom, atoms)
       {
-        a = vic[atom->GetIdx()]->_a;
-        b = vic[atom->GetIdx()]->_b;
-        c = vic[atom->GetIdx()]->_c;
-        r = vic[atom->GetIdx()]->_dst;
-        w = vic[atom->GetIdx()]->_ang;
+        const InputGeometry::ZMatrixEntry &entry = zmat[atom->index()];
+        const int idx = atom->index() + 1;
+        r = entry.distance;
+        w = entry.angle;
         if (w < 0.0)
           w += 360.0;
-        t = vic[atom->GetIdx()]->_tor;
+        t = entry.dihedral;
         if (t < 0.0)
           t += 360.0;
 
         mol << qSetFieldWidth(4) << right
-            << QString(etab.GetSymbol(atom->GetAtomicNum())
-                       + QString::number(atom->GetIdx()));
-        if (atom->GetIdx() > 1)
+            << QString(etab.GetSymbol(atom->atomicNumber())
+                       + QString::number(idx));
+        if (idx > 1)
           mol << qSetFieldWidth(6) << right
-              << QString(etab.GetSymbol(a->GetAtomicNum())
-                         + QString::number(a->GetIdx())) << qSetFieldWidth(15)
+              << QString(etab.GetSymbol(atoms[entry.a]->atomicNumber())
+                         + QString::number(entry.a + 1)) << qSetFieldWidth(15)
               << qSetRealNumberPrecision(5) << forcepoint << fixed << right << r;
-        if (atom->GetIdx() > 2)
+        if (idx > 2)
           mol << qSetFieldWidth(6) << right
-                 << QString(etab.GetSymbol(b->GetAtomicNum())
-                         + QString::number(b->GetIdx())) << qSetFieldWidth(15)
+              << QString(etab.GetSymbol(atoms[entry.b]->atomicNumber())
+                         + QString::number(entry.b + 1)) << qSetFieldWidth(15)
               << qSetRealNumberPrecision(5) << forcepoint << fixed << right << w;
-        if (atom->GetIdx() > 3)
+        if (idx > 3)
           mol << qSetFieldWidth(6) << right
-              << QString(etab.GetSymbol(c->GetAtomicNum())
-                         + QString::number(c->GetIdx())) << qSetFieldWidth(15)
+              << QString(etab.GetSymbol(atoms[entry.c]->atomicNumber())
+                         + QString::number(entry.c + 1)) << qSetFieldWidth(15)
               << qSetRealNumberPrecision(5) << forcepoint << fixed << right << t;
         mol << qSetFieldWidth(0) << '\n';
       }
-      foreach (OpenBabel::OBInternalCoord *c, vic)
-        delete c;
     }
-    mol << "end\n\n";
-
-    // Basis set
-    mol << "basis";
-
-    // Need spherical keyword if using Dunning correlation consistent basis sets
-    if ( m_basisType == ccpVDZ || m_basisType == ccpVTZ )
-      mol << " spherical";
-
-    mol << endl;
-
-    mol << "  * library " << getBasisType(m_basisType) << '\n';
-    mol << "end\n\n";
-
-    // theory directives (multiplicity, too)
-    switch (m_theoryType)
-      {
-      case B3LYP:
-        mol << "dft\n  xc b3lyp\n  mult " << m_multiplicity << "\nend\n\n";
-        break;
-      case MP2:
-        mol << "mp2\n";
-        mol << "  # Exclude core electrons from MP2 treatment\n";
-        mol << "  freeze atomic\n";
-        mol << "end\n\n";
-        break;
-      case CCSD:
-        mol << "ccsd\n";
-        mol << "  # Exclude core electrons from CCSD treatment\n";
-        mol << "  freeze atomic\n";
-        mol << "end\n\n";
-        break;
-      default:
-      case RHF:
-          break;
-      }
-
-    // Task directive
-    mol << "task ";
-
-    // Set theory level:
-    switch (m_theoryType)
-      {
-      case B3LYP:
-        mol << "dft ";
-        break;
-      case CCSD:
-        mol << "ccsd ";
-        break;
-      case MP2:
-        mol << "mp2 ";
-        break;
-      default:
-      case RHF:
-        mol << "scf ";
-        break;
-      }
-
-    mol << getCalculationType(m_calculationType) << endl;
 
+    mol.flush();
     return buffer;
   }
 
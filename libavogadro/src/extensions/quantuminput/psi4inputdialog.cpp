@@ -83,18 +83,8 @@ namespace Avogadro
 
   void Psi4InputDialog::setMolecule(Molecule *molecule)
   {
-    // Disconnect the old molecule first...
-    if (m_molecule)
-      disconnect(m_molecule, 0, this, 0);
-
-    m_molecule = molecule;
-    // Update the preview text whenever primitives are changed
-    connect(m_molecule, SIGNAL(atomRemoved(Atom *)),
-            this, SLOT(updatePreviewText()));
-    connect(m_molecule, SIGNAL(atomAdded(Atom *)),
-            this, SLOT(updatePreviewText()));
-    connect(m_molecule, SIGNAL(atomUpdated(Atom *)),
-            this, SLOT(updatePreviewText()));
+    // Regenerates the preview once the molecule stopped changing
+    InputDialog::setMolecule(molecule);
     // Add atom coordinates
     updatePreviewText();
   }
@@ -233,15 +223,23 @@ namespace Avogadro
 
     mol << "molecule {\n";
     mol << m_charge << " " << m_multiplicity << "\n";
-    QList<Atom *> atoms = m_molecule->atoms();
-    foreach (Atom *atom, atoms) {
-      mol << qSetFieldWidth(4) << right
-        << QString(OpenBabel::etab.GetSymbol(atom->atomicNumber()))
-        << qSetFieldWidth(15) << qSetRealNumberPrecision(5) << forcepoint
-        << fixed << right << atom->pos()->x() << atom->pos()->y()
-        << atom->pos()->z()
-        << qSetFieldWidth(0) << '\n';
+    // The coordinates are only formatted again after the geometry changed
+    QString coords = cachedBlock("psi4/cartesian");
+    if (coords.isNull()) {
+      QTextStream xyz(&coords);
+      QList<Atom *> atoms = m_molecule->atoms();
+      foreach (Atom *atom, atoms) {
+        xyz << qSetFieldWidth(4) << right
+          << QString(OpenBabel::etab.GetSymbol(atom->atomicNumber()))
+          << qSetFieldWidth(15) << qSetRealNumberPrecision(5) << forcepoint
+          << fixed << right << atom->pos()->x() << atom->pos()->y()
+          << atom->pos()->z()
+          << qSetFieldWidth(0) << '\n';
+      }
+      xyz.flush();
+      cacheBlock("psi4/cartesian", coords);
     }
+    mol << coords;
     mol << "}\n";
     if(getTheoryType(m_theoryType) == "sapt0" || getTheoryType(m_theoryType) == "sapt2")
       mol << "auto_fragments('')\n";
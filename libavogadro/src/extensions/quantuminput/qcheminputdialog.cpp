@@ -26,6 +26,7 @@
 
 #include <avogadro/molecule.h>
 #include <avogadro/atom.h>
+#include <avogadro/bond.h>
 
 #include <openbabel/mol.h>
 
@@ -35,10 +36,61 @@
 #include <QMessageBox>
 #include <QDebug>
 
+#include <algorithm>
+
 using namespace OpenBabel;
 
 namespace Avogadro
 {
+  namespace
+  {
+    bool largerFragment(const QVector<int> &a, const QVector<int> &b)
+    {
+      return a.size() > b.size();
+    }
+
+    // The bonded fragments of the molecule, largest first, each with its
+    // atom indices in ascending order
+    QList<QVector<int> > fragments(const Molecule *molecule)
+    {
+      const int n = molecule->numAtoms();
+      QVector<QVector<int> > bonded(n);
+      foreach (const Bond *bond, molecule->bonds()) {
+        int i = bond->beginAtom()->index();
+        int j = bond->endAtom()->index();
+        bonded[i].append(j);
+        bonded[j].append(i);
+      }
+
+      QList<QVector<int> > result;
+      QVector<bool> visited(n, false);
+      for (int start = 0; start < n; ++start) {
+        if (visited[start])
+          continue;
+        QVector<int> fragment;
+        QVector<int> stack;
+        stack.append(start);
+        visited[start] = true;
+        while (!stack.isEmpty()) {
+          int i = stack.last();
+          stack.pop_back();
+          fragment.append(i);
+          foreach (int j, bonded[i]) {
+            if (!visited[j]) {
+              visited[j] = true;
+              stack.append(j);
+            }
+          }
+        }
+        qSort(fragment);
+        result.append(fragment);
+      }
+
+      std::stable_sort(result.begin(), result.end(), largerFragment);
+      return result;
+    }
+  }
+
   QChemInputDialog::QChemInputDialog(QWidget *parent, Qt::WindowFlags f)
     : InputDialog(parent, f), m_calculationType(OPT),
     m_theoryType(B3LYP), m_basisType(B631Gd),
@@ -86,18 +138,8 @@ namespace Avogadro
 
   void QChemInputDialog::setMolecule(Molecule *molecule)
   {
-    // Disconnect the old molecule first...
-    if (m_molecule)
-      disconnect(m_molecule, 0, this, 0);
-
-    m_molecule = molecule;
-    // Update the preview text whenever primitives are changed
-    connect(m_molecule, SIGNAL(atomRemoved(Atom *)),
-            this, SLOT(updatePreviewText()));
-    connect(m_molecule, SIGNAL(atomAdded(Atom *)),
-            this, SLOT(updatePreviewText()));
-    connect(m_molecule, SIGNAL(atomUpdated(Atom *)),
-            this, SLOT(updatePreviewText()));
+    // Regenerates the preview once the molecule stopped changing
+    InputDialog::setMolecule(molecule);
     // Add atom coordinates
     updatePreviewText();
   }
@@ -260,19 +302,32 @@ namespace Avogadro
     // Now for the charge and multiplicity
     mol << "   " << m_charge << ' ' << m_multiplicity << '\n';
 
-    // Now to output the actual molecular coordinates
-    // Cartesian coordinates
-    if (m_molecule && m_coordType == CARTESIAN)
-    {
-      QTextStream mol(&buffer);
+    // Now to output the actual molecular coordinates, they are only
+    // formatted again after the geometry changed
+    if (m_molecule) {
+      const QString key = QString("qchem/%1").arg(m_coordType);
+      QString coords = cachedBlock(key);
+      if (coords.isNull())
+        coords = cacheBlock(key, generateCoordinates());
+      mol << coords;
+    }
+    mol << "$end\n\n";
 
-      OpenBabel::OBMol obmol = m_molecule->OBMol();
-      std::vector<std::vector<int> > fragList;
-      obmol.ContigFragList(fragList);
+    return buffer;
+  }
+
+  QString QChemInputDialog::generateCoordinates()
+  {
+    QString buffer;
+    QTextStream mol(&buffer);
 
-      for (unsigned int frag = 0; frag < fragList.size(); ++frag) {
-        for (unsigned int idx = 0; idx < fragList[frag].size(); ++idx) {
-          Atom *atom = m_molecule->atom(fragList[frag][idx] - 1);
+    // Cartesian coordinates
+    if (m_coordType == CARTESIAN)
+    {
+      const QList<Atom *> atoms = m_molecule->atoms();
+      foreach (const QVector<int> &fragment, fragments(m_molecule)) {
+        foreach (int index, fragment) {
+          Atom *atom = atoms[index];
           mol << qSetFieldWidth(4) << right
               << QString(OpenBabel::etab.GetSymbol(atom->atomicNumber()))
               << qSetFieldWidth(15) << qSetRealNumberPrecision(5) << forcepoint
@@ -283,123 +338,103 @@ namespace Avogadro
       }
     }
     // Z-matrix
-    else if (m_molecule && m_coordType == ZMATRIX)
+    else if (m_coordType == ZMATRIX)
     {
-      QTextStream mol(&buffer);
-      OBAtom *a, *b, *c;
+      const QVector<InputGeometry::ZMatrixEntry> zmat = zMatrix();
+      const QList<Atom *> atoms = m_molecule->atoms();
       double r, w, t;
 
-      /* Taken from OpenBabel's gzmat file format converter */
-      std::vector<OBInternalCoord*> vic;
-      vic.push_back((OpenBabel::OBInternalCoord*)NULL);
-      OpenBabel::OBMol obmol = m_molecule->OBMol();
-      FOR_ATOMS_OF_MOL(atom, &obmol)
-        vic.push_back(new OpenBabel::OBInternalCoord);
-      CartesianToInternal(vic, obmol);
-
-      FOR_ATOMS_OF_MOL(atom, &obmol)
+      foreach (Atom *atom, atoms)
       {
-        a = vic[atom->GetIdx()]->_a;
-        b = vic[atom->GetIdx()]->_b;
-        c = vic[atom->GetIdx()]->_c;
+        const InputGeometry::ZMatrixEntry &entry = zmat[atom->index()];
+        const int idx = atom->index() + 1;
 
         mol << qSetFieldWidth(4) << right
-            << QString(etab.GetSymbol(atom->GetAtomicNum())
-                       + QString::number(atom->GetIdx()))
+            << QString(etab.GetSymbol(atom->atomicNumber())
+                       + QString::number(idx))
             << qSetFieldWidth(0);
-        if (atom->GetIdx() > 1)
-          mol << ' ' << QString(etab.GetSymbol(a->GetAtomicNum())
-                                + QString::number(a->GetIdx()))
-              << " r" << atom->GetIdx();
-        if (atom->GetIdx() > 2)
-          mol << ' ' << QString(etab.GetSymbol(b->GetAtomicNum())
-                                + QString::number(b->GetIdx()))
-              << " a" << atom->GetIdx();
-        if (atom->GetIdx() > 3)
-          mol << ' ' << QString(etab.GetSymbol(c->GetAtomicNum())
-                                + QString::number(c->GetIdx()))
-              << " d" << atom->GetIdx();
+        if (idx > 1)
+          mol << ' ' << QString(etab.GetSymbol(atoms[entry.a]->atomicNumber())
+                                + QString::number(entry.a + 1))
+              << " r" << idx;
+        if (idx > 2)
+          mol << ' ' << QString(etab.GetSymbol(atoms[entry.b]->atomicNumber())
+                                + QString::number(entry.b + 1))
+              << " a" << idx;
+        if (idx > 3)
+          mol << ' ' << QString(etab.GetSymbol(atoms[entry.c]->atomicNumber())
+                                + QString::number(entry.c + 1))
+              << " d" << idx;
         mol << '\n';
       }
 
       mol << '\n';
-      FOR_ATOMS_OF_MOL(atom, &obmol)
+      foreach (Atom *atom, atoms)
       {
-        r = vic[atom->GetIdx()]->_dst;
-        w = vic[atom->GetIdx()]->_ang;
+        const InputGeometry::ZMatrixEntry &entry = zmat[atom->index()];
+        const int idx = atom->index() + 1;
+        r = entry.distance;
+        w = entry.angle;
         if (w < 0.0)
           w += 360.0;
-        t = vic[atom->GetIdx()]->_tor;
+        t = entry.dihedral;
         if (t < 0.0)
           t += 360.0;
-        if (atom->GetIdx() > 1)
-          mol << "   r" << atom->GetIdx() << " = " << qSetFieldWidth(15)
+        if (idx > 1)
+          mol << "   r" << idx << " = " << qSetFieldWidth(15)
               << qSetRealNumberPrecision(5) << forcepoint << fixed << right
               << r << qSetFieldWidth(0) << '\n';
-        if (atom->GetIdx() > 2)
-          mol << "   a" << atom->GetIdx() << " = " << qSetFieldWidth(15)
+        if (idx > 2)
+          mol << "   a" << idx << " = " << qSetFieldWidth(15)
               << qSetRealNumberPrecision(5) << forcepoint << fixed << right
               << w << qSetFieldWidth(0) << '\n';
-        if (atom->GetIdx() > 3)
-          mol << "   d" << atom->GetIdx() << " = " << qSetFieldWidth(15)
+        if (idx > 3)
+          mol << "   d" << idx << " = " << qSetFieldWidth(15)
               << qSetRealNumberPrecision(5) << forcepoint << fixed << right
               << t << qSetFieldWidth(0) << '\n';
       }
-      foreach (OpenBabel::OBInternalCoord *c, vic)
-        delete c;
     }
-    else if (m_molecule && m_coordType == ZMATRIX_COMPACT)
+    else if (m_coordType == ZMATRIX_COMPACT)
     {
-      QTextStream mol(&buffer);
-      OBAtom *a, *b, *c;
+      const QVector<InputGeometry::ZMatrixEntry> zmat = zMatrix();
+      const QList<Atom *> atoms = m_molecule->atoms();
       double r, w, t;
 
-      /* Taken from OpenBabel's gzmat file format converter */
-      std::vector<OBInternalCoord*> vic;
-      vic.push_back((OpenBabel::OBInternalCoord*)NULL);
-      OpenBabel::OBMol obmol = m_molecule->OBMol();
-      FOR_ATOMS_OF_MOL(atom, &obmol)
-        vic.push_back(new OpenBabel::OBInternalCoord);
-      CartesianToInternal(vic, obmol);
-
-      FOR_ATOMS_OF_MOL(atom, &obmol)
+      foreach (Atom *atom, atoms)
       {
-        a = vic[atom->GetIdx()]->_a;
-        b = vic[atom->GetIdx()]->_b;
-        c = vic[atom->GetIdx()]->_c;
-        r = vic[atom->GetIdx()]->_dst;
-        w = vic[atom->GetIdx()]->_ang;
+        const InputGeometry::ZMatrixEntry &entry = zmat[atom->index()];
+        const int idx = atom->index() + 1;
+        r = entry.distance;
+        w = entry.angle;
         if (w < 0.0)
           w += 360.0;
-        t = vic[atom->GetIdx()]->_tor;
+        t = entry.dihedral;
         if (t < 0.0)
           t += 360.0;
 
         mol << qSetFieldWidth(4) << right
-            << QString(etab.GetSymbol(atom->GetAtomicNum())
-                       + QString::number(atom->GetIdx()));
-        if (atom->GetIdx() > 1)
+            << QString(etab.GetSymbol(atom->atomicNumber())
+                       + QString::number(idx));
+        if (idx > 1)
           mol << qSetFieldWidth(6) << right
-              << QString(etab.GetSymbol(a->GetAtomicNum())
-                         + QString::number(a->GetIdx())) << qSetFieldWidth(15)
+              << QString(etab.GetSymbol(atoms[entry.a]->atomicNumber())
+                         + QString::number(entry.a + 1)) << qSetFieldWidth(15)
               << qSetRealNumberPrecision(5) << forcepoint << fixed << right << r;
-        if (atom->GetIdx() > 2)
+        if (idx > 2)
           mol << qSetFieldWidth(6) << right
-                 << QString(etab.GetSymbol(b->GetAtomicNum())
-                         + QString::number(b->GetIdx())) << qSetFieldWidth(15)
+              << QString(etab.GetSymbol(atoms[entry.b]->atomicNumber())
+                         + QString::number(entry.b + 1)) << qSetFieldWidth(15)
               << qSetRealNumberPrecision(5) << forcepoint << fixed << right << w;
-        if (atom->GetIdx() > 3)
+        if (idx > 3)
           mol << qSetFieldWidth(6) << right
-              << QString(etab.GetSymbol(c->GetAtomicNum())
-                         + QString::number(c->GetIdx())) << qSetFieldWidth(15)
+              << QString(etab.GetSymbol(atoms[entry.c]->atomicNumber())
+                         + QString::number(entry.c + 1)) << qSetFieldWidth(15)
               << qSetRealNumberPrecision(5) << forcepoint << fixed << right << t;
         mol << qSetFieldWidth(0) << '\n';
       }
-      foreach (OpenBabel::OBInternalCoord *c, vic)
-        delete c;
     }
-    mol << "$end\n\n";
 
+    mol.flush();
     return buffer;
   }
 
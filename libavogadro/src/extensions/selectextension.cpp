@@ -30,6 +30,7 @@
 #include <avogadro/residue.h>
 #include <avogadro/color.h>
 #include <avogadro/primitivelist.h>
+#include <avogadro/selectionquery.h>
 
 #include <openbabel/mol.h>
 #include <openbabel/parsmart.h>
@@ -55,7 +56,8 @@ namespace Avogadro {
       SolventIndex,
       SMARTSIndex,
       AddNamedIndex,
-      SeparatorIndex
+      SeparatorIndex,
+      ExpressionIndex
     };
 
   SelectExtension::SelectExtension(QObject *parent) : Extension(parent)
@@ -70,6 +72,11 @@ namespace Avogadro {
     action->setData(InvertIndex);
     m_actions.append(action);
 
+    action = new QAction(this);
+    action->setText(tr("Select by Expression..."));
+    action->setData(ExpressionIndex);
+    m_actions.append(action);
+
     action = new QAction(this);
     action->setText(tr("Select SMARTS..."));
     action->setData(SMARTSIndex);
@@ -129,6 +136,9 @@ namespace Avogadro {
     case InvertIndex:
       invertSelection(widget);
       break;
+    case ExpressionIndex:
+      selectExpression(widget);
+      break;
     case SMARTSIndex:
       selectSMARTS(widget);
       break;
@@ -199,6 +209,46 @@ namespace Avogadro {
     return;
   }
 
+  // Helper function -- handle selection expressions
+  // Called by performAction()
+  void SelectExtension::selectExpression(GLWidget *widget)
+  {
+    bool ok;
+    QString expression = QInputDialog::getText(qobject_cast<QWidget*>(parent()),
+        tr("Select by Expression"),
+        tr("Atoms to select, e.g. \"protein and within 5 of resname LIG and not element H\""),
+        QLineEdit::Normal,
+        m_lastExpression, &ok);
+    if (!ok || expression.isEmpty())
+      return;
+    m_lastExpression = expression;
+
+    SelectionQuery query;
+    if (!query.setExpression(expression)) {
+      QMessageBox::warning(widget, tr("Avogadro"),
+        tr("Invalid selection expression: %1").arg(query.errorString()));
+      return;
+    }
+
+    const QBitArray selected = query.evaluate(m_molecule);
+    QList<Primitive *> primitives;
+    QList<Atom *> atoms = m_molecule->atoms();
+    for (int i = 0; i < selected.size(); ++i) {
+      if (selected.testBit(i))
+        primitives.append(atoms.at(i));
+    }
+    // Bonds between two selected atoms are selected too
+    foreach (Bond *bond, m_molecule->bonds()) {
+      if (selected.testBit(bond->beginAtom()->index())
+          && selected.testBit(bond->endAtom()->index()))
+        primitives.append(bond);
+    }
+
+    widget->clearSelected();
+    widget->setSelected(primitives, true);
+    widget->update();
+  }
+
   // Helper function -- handle element selections
   // Connected to signal from PeriodicTableView
   void SelectExtension::selectElement(int element)
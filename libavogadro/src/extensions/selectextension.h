@@ -62,8 +62,10 @@ namespace Avogadro {
       Molecule *m_molecule;
       GLWidget *m_widget;
       PeriodicTableView *m_periodicTable;
+      QString m_lastExpression;
 
       void invertSelection(GLWidget *widget);
+      void selectExpression(GLWidget *widget);
       void selectSMARTS(GLWidget *widget);
       void selectResidue(GLWidget *widget);
       void selectSolvent(GLWidget *widget);
@@ -0,0 +1,155 @@
+/**********************************************************************
+  SpectraDialog - Visualize spectral data from QM calculations
+
+  Copyright (C) 2013 Avogadro Developers
+
+  This file is part of the Avogadro molecular editor project.
+  For more information, see <http://avogadro.cc/>
+
+  This library is free software; you can redistribute it and/or modify
+  it under the terms of the GNU Library General Public License as
+  published by the Free Software Foundation; either version 2.1 of the
+  License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+ ***********************************************************************/
+
+#include "md.h"
+
+#include <avogadro/trajectoryspectrum.h>
+
+#include <QtGui/QApplication>
+#include <QtCore/QDebug>
+
+#include <cmath>
+
+namespace Avogadro {
+
+  // Shorter trajectories do not resolve any vibrations
+  static const unsigned int minimumFrames = 16;
+
+  MDSpectra::MDSpectra( SpectraDialog *parent ) :
+    SpectraType( parent ), m_molecule(0)
+  {
+    ui.setupUi(m_tab_widget);
+
+    // Setup signals/slots
+    connect(this, SIGNAL(plotDataChanged()),
+            m_dialog, SLOT(regenerateCalculatedSpectra()));
+    connect(ui.combo_type, SIGNAL(currentIndexChanged(int)),
+            this, SLOT(recalculate()));
+    connect(ui.spin_timeStep, SIGNAL(valueChanged(double)),
+            this, SLOT(recalculate()));
+    connect(ui.spin_length, SIGNAL(valueChanged(int)),
+            this, SLOT(recalculate()));
+    connect(ui.combo_window, SIGNAL(currentIndexChanged(int)),
+            this, SLOT(recalculate()));
+    connect(ui.combo_correction, SIGNAL(currentIndexChanged(int)),
+            this, SLOT(recalculate()));
+    connect(ui.spin_temperature, SIGNAL(valueChanged(double)),
+            this, SLOT(recalculate()));
+
+    readSettings();
+    ui.spin_temperature->setEnabled(ui.combo_correction->currentIndex()
+                                    != TrajectorySpectrum::NoCorrection);
+  }
+
+  MDSpectra::~MDSpectra()
+  {
+    writeSettings();
+  }
+
+  void MDSpectra::writeSettings()
+  {
+    QSettings settings; // Already set up in avogadro/src/main.cpp
+    settings.setValue("spectra/MD/type", ui.combo_type->currentIndex());
+    settings.setValue("spectra/MD/timeStep", ui.spin_timeStep->value());
+    settings.setValue("spectra/MD/correlationLength", ui.spin_length->value());
+    settings.setValue("spectra/MD/window", ui.combo_window->currentIndex());
+    settings.setValue("spectra/MD/correction", ui.combo_correction->currentIndex());
+    settings.setValue("spectra/MD/temperature", ui.spin_temperature->value());
+  }
+
+  void MDSpectra::readSettings()
+  {
+    QSettings settings; // Already set up in avogadro/src/main.cpp
+    ui.combo_type->setCurrentIndex(settings.value("spectra/MD/type", TrajectorySpectrum::PowerSpectrum).toInt());
+    ui.spin_timeStep->setValue(settings.value("spectra/MD/timeStep", 1.0).toDouble());
+    ui.spin_length->setValue(settings.value("spectra/MD/correlationLength", 0).toInt());
+    ui.combo_window->setCurrentIndex(settings.value("spectra/MD/window", TrajectorySpectrum::HannWindow).toInt());
+    ui.combo_correction->setCurrentIndex(settings.value("spectra/MD/correction", TrajectorySpectrum::NoCorrection).toInt());
+    ui.spin_temperature->setValue(settings.value("spectra/MD/temperature", 300.0).toDouble());
+  }
+
+  bool MDSpectra::checkForData(Molecule * mol)
+  {
+    m_molecule = 0;
+    if (!mol || mol->numConformers() < minimumFrames)
+      return false;
+
+    m_molecule = mol;
+    return calculate();
+  }
+
+  void MDSpectra::setupPlot(PlotWidget * plot)
+  {
+    plot->setDefaultLimits( 4000.0, 0.0, 0.0, 1.0 );
+    plot->axis(PlotWidget::BottomAxis)->setLabel(tr("Wavenumber (cm<sup>-1</sup>)"));
+    plot->axis(PlotWidget::LeftAxis)->setLabel(tr("Intensity (arb. units)"));
+  }
+
+  QString MDSpectra::getTSV()
+  {
+    return SpectraType::getTSV("Wavenumber(cm-1)", "Intensity");
+  }
+
+  void MDSpectra::recalculate()
+  {
+    ui.spin_temperature->setEnabled(ui.combo_correction->currentIndex()
+                                    != TrajectorySpectrum::NoCorrection);
+    if (!m_molecule)
+      return;
+
+    calculate();
+    emit plotDataChanged();
+  }
+
+  bool MDSpectra::calculate()
+  {
+    m_xList.clear();
+    m_yList.clear();
+
+    TrajectorySpectrum spectrum;
+    spectrum.setTimeStep(ui.spin_timeStep->value());
+    spectrum.setCorrelationLength(ui.spin_length->value());
+    spectrum.setWindow(TrajectorySpectrum::Window(ui.combo_window->currentIndex()));
+    spectrum.setCorrection(TrajectorySpectrum::Correction(ui.combo_correction->currentIndex()));
+    spectrum.setTemperature(ui.spin_temperature->value());
+
+    // Long trajectories take a few seconds
+    QApplication::setOverrideCursor(Qt::WaitCursor);
+    bool ok = spectrum.calculate(m_molecule,
+                                 TrajectorySpectrum::Type(ui.combo_type->currentIndex()));
+    QApplication::restoreOverrideCursor();
+    if (!ok) {
+      qWarning() << "MDSpectra::calculate: Could not calculate the spectrum.";
+      return false;
+    }
+
+    // Scale the largest peak to 1
+    const std::vector<double> &frequencies = spectrum.frequencies();
+    const std::vector<double> &intensities = spectrum.intensities();
+    double maximum = 0.0;
+    for (unsigned int i = 0; i < intensities.size(); ++i)
+      maximum = qMax(maximum, std::fabs(intensities[i]));
+    const double scale = maximum > 0.0 ? 1.0 / maximum : 1.0;
+    for (unsigned int i = 0; i < frequencies.size(); ++i) {
+      m_xList.append(frequencies[i]);
+      m_yList.append(intensities[i] * scale);
+    }
+    return true;
+  }
+}
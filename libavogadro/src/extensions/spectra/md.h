@@ -0,0 +1,64 @@
+/**********************************************************************
+  SpectraDialog - Visualize spectral data from QM calculations
+
+  Copyright (C) 2013 Avogadro Developers
+
+  This file is part of the Avogadro molecular editor project.
+  For more information, see <http://avogadro.cc/>
+
+  This library is free software; you can redistribute it and/or modify
+  it under the terms of the GNU Library General Public License as
+  published by the Free Software Foundation; either version 2.1 of the
+  License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+ ***********************************************************************/
+
+#ifndef SPECTRATYPE_MD_H
+#define SPECTRATYPE_MD_H
+
+#include <QtCore/QHash>
+#include <QtCore/QVariant>
+
+#include "spectradialog.h"
+#include "spectratype.h"
+#include "ui_tab_md.h"
+
+namespace Avogadro {
+
+  /**
+   * Power and infrared spectra of the conformers of a molecule taken as the
+   * frames of a molecular dynamics trajectory, see TrajectorySpectrum.
+   */
+  class MDSpectra : public SpectraType
+  {
+    Q_OBJECT
+
+  public:
+    MDSpectra( SpectraDialog *parent = 0 );
+    ~MDSpectra();
+
+    void writeSettings();
+    void readSettings();
+
+    bool checkForData(Molecule* mol);
+    void setupPlot(PlotWidget * plot);
+
+    QString getTSV();
+
+  private slots:
+    void recalculate();
+
+  private:
+    /// Calculate the spectrum of m_molecule into m_xList and m_yList
+    bool calculate();
+
+    Ui::Tab_MD ui;
+    Molecule *m_molecule;
+  };
+}
+
+#endif
@@ -26,6 +26,7 @@
 #include "uv.h"
 #include "cd.h"
 #include "raman.h"
+#include "md.h"
 
 #include <QtGui/QPen>
 #include <QtGui/QColor>
@@ -71,6 +72,7 @@ namespace Avogadro {
     m_spectra_uv = new UVSpectra(this);
     m_spectra_cd = new CDSpectra(this);
     m_spectra_raman = new RamanSpectra(this);
+    m_spectra_md = new MDSpectra(this);
 
     // Initialize vars
     m_schemes = new QList<QHash<QString, QVariant> >;
@@ -155,6 +157,7 @@ namespace Avogadro {
     delete m_spectra_uv;
     delete m_spectra_cd;
     delete m_spectra_raman;
+    delete m_spectra_md;
   }
 
   void SpectraDialog::setMolecule(Molecule *molecule)
@@ -170,6 +173,7 @@ namespace Avogadro {
     m_spectra_uv->clear();
     m_spectra_cd->clear();
     m_spectra_raman->clear();
+    m_spectra_md->clear();
 
     updatePlot();
 
@@ -231,8 +235,15 @@ namespace Avogadro {
       ui.tab_widget->addTab(m_spectra_raman->getTabWidget(), tr("&Raman Settings"));
     }
 
+    // Check for a trajectory
+    bool hasMD = m_spectra_md->checkForData(m_molecule);
+    if (hasMD) {
+      ui.combo_spectra->addItem(tr("MD", "Molecular dynamics spectrum"));
+      ui.tab_widget->addTab(m_spectra_md->getTabWidget(), tr("&MD Spectra Settings"));
+    }
+
     // Change this when other spectra are added!!
-    if (!hasIR && !hasNMR && !hasDOS && !hasUV && !hasCD && !hasRaman) { // Actions if there are no spectra loaded
+    if (!hasIR && !hasNMR && !hasDOS && !hasUV && !hasCD && !hasRaman && !hasMD) { // Actions if there are no spectra loaded
       qWarning() << "SpectraDialog::setMolecule: No spectra available!";
       ui.combo_spectra->addItem(tr("No data"));
       ui.push_colorCalculated->setEnabled(false);
@@ -1099,6 +1110,8 @@ namespace Avogadro {
       return m_spectra_cd;
     else if (m_spectra == "Raman")
       return m_spectra_raman;
+    else if (m_spectra == "MD")
+      return m_spectra_md;
     return NULL;
   }
 
@@ -46,6 +46,7 @@ namespace Avogadro {
   class UVSpectra;
   class CDSpectra;
   class RamanSpectra;
+  class MDSpectra;
 
   class SpectraDialog : public QDialog
   {
@@ -101,6 +102,7 @@ namespace Avogadro {
     UVSpectra *m_spectra_uv;
     CDSpectra *m_spectra_cd;
     RamanSpectra *m_spectra_raman;
+    MDSpectra *m_spectra_md;
 
     Molecule *m_molecule;
     int m_scheme;
@@ -0,0 +1,231 @@
+/******************************************************************************
+
+  This source file is part of the OpenQube project.
+
+  Copyright 2013 Avogadro Developers
+
+  This source code is released under the New BSD License, (the "License").
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+******************************************************************************/
+
+#include "adaptivegrid.h"
+
+#include "cube.h"
+
+#include <algorithm>
+#include <cmath>
+
+using std::vector;
+using Eigen::Vector3d;
+using Eigen::Vector3i;
+
+namespace OpenQube
+{
+
+// Corners within this factor of the isovalue may hide a crossing. Chosen
+// by experiment, narrower lobes can still be missed.
+static const double OUTSIDE_FACTOR = 0.25;
+static const double INSIDE_FACTOR = 4.0;
+
+AdaptiveGrid::AdaptiveGrid(Cube *cube, double isoValue, int coarseStep)
+  : m_cube(cube), m_isoValue(std::fabs(isoValue)), m_numEvaluated(0),
+    m_numResolved(0)
+{
+  Vector3i dim = cube->dimensions();
+  for (int a = 0; a < 3; ++a)
+    m_dim[a] = dim[a];
+  m_known.resize(m_dim[0] * m_dim[1] * m_dim[2], false);
+  if (m_known.empty())
+    return;
+  if (coarseStep < 1)
+    coarseStep = 1;
+
+  // The roots of the octree, the last cell along each axis may be smaller
+  vector<int> starts[3];
+  for (int a = 0; a < 3; ++a) {
+    for (int s = 0; s < m_dim[a] - 1; s += coarseStep)
+      starts[a].push_back(s);
+    if (starts[a].empty())
+      starts[a].push_back(0); // Flat cube along this axis
+  }
+  for (size_t i = 0; i < starts[0].size(); ++i) {
+    for (size_t j = 0; j < starts[1].size(); ++j) {
+      for (size_t k = 0; k < starts[2].size(); ++k) {
+        Cell cell;
+        int s[3] = { starts[0][i], starts[1][j], starts[2][k] };
+        for (int a = 0; a < 3; ++a) {
+          cell.min[a] = s[a];
+          cell.max[a] = std::min(s[a] + coarseStep, m_dim[a] - 1);
+        }
+        cell.root = static_cast<unsigned int>(m_active.size());
+        requestCorners(cell);
+        m_active.push_back(cell);
+        m_activeChildren.push_back(1);
+      }
+    }
+  }
+}
+
+void AdaptiveGrid::addNucleus(const Vector3d &pos)
+{
+  Vector3d grid;
+  for (int a = 0; a < 3; ++a) {
+    grid[a] = (pos[a] - m_cube->min()[a]) / m_cube->spacing()[a];
+    if (grid[a] < 0.0 || grid[a] > m_dim[a] - 1)
+      return;
+  }
+  m_nuclei.push_back(grid);
+}
+
+void AdaptiveGrid::request(int i, int j, int k)
+{
+  unsigned int n = index(i, j, k);
+  if (!m_known[n]) {
+    m_known[n] = true;
+    m_pending.push_back(n);
+    ++m_numEvaluated;
+  }
+}
+
+void AdaptiveGrid::requestCorners(const Cell &cell)
+{
+  for (int c = 0; c < 8; ++c) {
+    request(c & 1 ? cell.max[0] : cell.min[0],
+            c & 2 ? cell.max[1] : cell.min[1],
+            c & 4 ? cell.max[2] : cell.min[2]);
+  }
+}
+
+bool AdaptiveGrid::needsRefinement(const Cell &cell) const
+{
+  for (size_t n = 0; n < m_nuclei.size(); ++n) {
+    const Vector3d &nucleus = m_nuclei[n];
+    if (nucleus.x() >= cell.min[0] && nucleus.x() <= cell.max[0]
+        && nucleus.y() >= cell.min[1] && nucleus.y() <= cell.max[1]
+        && nucleus.z() >= cell.min[2] && nucleus.z() <= cell.max[2])
+      return true;
+  }
+
+  double minAbs = HUGE_VAL, maxAbs = 0.0;
+  bool positive = false, negative = false;
+  for (int c = 0; c < 8; ++c) {
+    double value = m_cube->value(c & 1 ? cell.max[0] : cell.min[0],
+                                 c & 2 ? cell.max[1] : cell.min[1],
+                                 c & 4 ? cell.max[2] : cell.min[2]);
+    minAbs = std::min(minAbs, std::fabs(value));
+    maxAbs = std::max(maxAbs, std::fabs(value));
+    if (value < 0.0)
+      negative = true;
+    else
+      positive = true;
+  }
+
+  // Well outside the surface
+  if (maxAbs < OUTSIDE_FACTOR * m_isoValue)
+    return false;
+  // Well inside one lobe
+  if (positive != negative && minAbs > INSIDE_FACTOR * m_isoValue)
+    return false;
+  return true;
+}
+
+void AdaptiveGrid::refine()
+{
+  m_pending.clear();
+  vector<Cell> active;
+  std::fill(m_activeChildren.begin(), m_activeChildren.end(), 0u);
+  for (size_t n = 0; n < m_active.size(); ++n) {
+    const Cell &cell = m_active[n];
+    bool resolved = true;
+    for (int a = 0; a < 3; ++a)
+      resolved = resolved && cell.max[a] - cell.min[a] <= 1;
+    if (resolved) // All points are corners, nothing left to do
+      continue;
+    if (!needsRefinement(cell)) {
+      m_leaves.push_back(cell);
+      continue;
+    }
+
+    // Split each axis that is still more than one point wide
+    int ranges[3][3];
+    int count[3];
+    for (int a = 0; a < 3; ++a) {
+      ranges[a][0] = cell.min[a];
+      if (cell.max[a] - cell.min[a] > 1) {
+        ranges[a][1] = (cell.min[a] + cell.max[a]) / 2;
+        ranges[a][2] = cell.max[a];
+        count[a] = 2;
+      }
+      else {
+        ranges[a][1] = cell.max[a];
+        count[a] = 1;
+      }
+    }
+    for (int i = 0; i < count[0]; ++i) {
+      for (int j = 0; j < count[1]; ++j) {
+        for (int k = 0; k < count[2]; ++k) {
+          Cell child;
+          child.min[0] = ranges[0][i];
+          child.max[0] = ranges[0][i + 1];
+          child.min[1] = ranges[1][j];
+          child.max[1] = ranges[1][j + 1];
+          child.min[2] = ranges[2][k];
+          child.max[2] = ranges[2][k + 1];
+          child.root = cell.root;
+          requestCorners(child);
+          active.push_back(child);
+          ++m_activeChildren[cell.root];
+        }
+      }
+    }
+  }
+  m_active.swap(active);
+  m_numResolved = static_cast<unsigned int>(
+        std::count(m_activeChildren.begin(), m_activeChildren.end(), 0u));
+}
+
+void AdaptiveGrid::interpolate()
+{
+  for (size_t leaf = 0; leaf < m_leaves.size(); ++leaf) {
+    const Cell &cell = m_leaves[leaf];
+    double corner[8];
+    for (int c = 0; c < 8; ++c) {
+      corner[c] = m_cube->value(c & 1 ? cell.max[0] : cell.min[0],
+                                c & 2 ? cell.max[1] : cell.min[1],
+                                c & 4 ? cell.max[2] : cell.min[2]);
+    }
+    double size[3];
+    for (int a = 0; a < 3; ++a)
+      size[a] = cell.max[a] > cell.min[a] ? cell.max[a] - cell.min[a] : 1;
+
+    for (int i = cell.min[0]; i <= cell.max[0]; ++i) {
+      double x = (i - cell.min[0]) / size[0];
+      for (int j = cell.min[1]; j <= cell.max[1]; ++j) {
+        double y = (j - cell.min[1]) / size[1];
+        for (int k = cell.min[2]; k <= cell.max[2]; ++k) {
+          unsigned int n = index(i, j, k);
+          if (m_known[n])
+            continue;
+          double z = (k - cell.min[2]) / size[2];
+          double c00 = corner[0] * (1 - x) + corner[1] * x;
+          double c10 = corner[2] * (1 - x) + corner[3] * x;
+          double c01 = corner[4] * (1 - x) + corner[5] * x;
+          double c11 = corner[6] * (1 - x) + corner[7] * x;
+          double c0 = c00 * (1 - y) + c10 * y;
+          double c1 = c01 * (1 - y) + c11 * y;
+          m_cube->setValue(n, c0 * (1 - z) + c1 * z);
+          m_known[n] = true;
+        }
+      }
+    }
+  }
+  m_leaves.clear();
+}
+
+} // End namespace
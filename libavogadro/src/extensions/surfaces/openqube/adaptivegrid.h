@@ -0,0 +1,146 @@
+/******************************************************************************
+
+  This source file is part of the OpenQube project.
+
+  Copyright 2013 Avogadro Developers
+
+  This source code is released under the New BSD License, (the "License").
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+******************************************************************************/
+
+#ifndef OPENQUBE_ADAPTIVEGRID_H
+#define OPENQUBE_ADAPTIVEGRID_H
+
+#include <Eigen/Core>
+
+#include <vector>
+
+namespace OpenQube
+{
+
+class Cube;
+
+/**
+ * @class AdaptiveGrid adaptivegrid.h
+ * @brief Decides which points of a Cube need to be evaluated for an
+ * isosurface.
+ *
+ * The cube is split into coarse cells that form the roots of an octree.
+ * Once the corners of a cell have been evaluated, it is subdivided only if
+ * the field could cross the isovalue inside it. A cell is subdivided when
+ * its corners come within a factor of the isovalue, unless they are all far
+ * beyond it with the same sign. Cells containing a nucleus are always
+ * subdivided, since tight basis functions can peak between the corners.
+ * Points inside cells that are not subdivided are filled by trilinear
+ * interpolation.
+ *
+ * The test on the corners is a heuristic, not a bound. A lobe narrower than
+ * a cell, away from the nuclei and too weak at every corner, is missed. The
+ * filled cube is an approximation for drawing the isosurfaces, it should
+ * not be exported or used for analysis.
+ *
+ * Typical use:
+ * @code
+ * AdaptiveGrid grid(cube, isoValue);
+ * while (!grid.pending().empty()) {
+ *   // write the field at grid.pending() into the cube
+ *   grid.refine();
+ *   // grid.numResolvedCells() of grid.numCells() are now complete
+ * }
+ * grid.interpolate();
+ * @endcode
+ *
+ * @note The interpolated points are only good enough for the isosurfaces at
+ * +/- isoValue. Mark the cube as approximate with
+ * Avogadro::Cube::setRefinedIsoValue().
+ */
+class AdaptiveGrid
+{
+public:
+  /**
+   * @param cube The cube to fill, its values are read back during
+   * refinement.
+   * @param isoValue The isovalue of interest, the surfaces at +isoValue and
+   * -isoValue are both resolved.
+   * @param coarseStep Spacing in points of the coarsest cells.
+   */
+  AdaptiveGrid(Cube *cube, double isoValue, int coarseStep = 8);
+
+  /**
+   * Always refine the cells containing @p pos (in Angstrom).
+   */
+  void addNucleus(const Eigen::Vector3d &pos);
+
+  /**
+   * @return Cube indices that must be evaluated before calling refine().
+   * Empty once refinement is complete.
+   */
+  const std::vector<unsigned int> & pending() const { return m_pending; }
+
+  /**
+   * Subdivide the cells that need it, using the values just evaluated.
+   */
+  void refine();
+
+  /**
+   * Fill all points that were not evaluated.
+   */
+  void interpolate();
+
+  /**
+   * @return The number of points requested for evaluation so far.
+   */
+  unsigned int numEvaluated() const { return m_numEvaluated; }
+
+  /**
+   * @return The number of coarse cells, the roots of the octree.
+   */
+  unsigned int numCells() const
+  {
+    return static_cast<unsigned int>(m_activeChildren.size());
+  }
+
+  /**
+   * @return The number of coarse cells that need no further refinement,
+   * useful to report progress.
+   */
+  unsigned int numResolvedCells() const { return m_numResolved; }
+
+private:
+  struct Cell
+  {
+    int min[3];
+    int max[3];
+    unsigned int root; // Index of the coarse cell this one is part of
+  };
+
+  unsigned int index(int i, int j, int k) const
+  {
+    return (i * m_dim[1] + j) * m_dim[2] + k;
+  }
+  void request(int i, int j, int k);
+  void requestCorners(const Cell &cell);
+  bool needsRefinement(const Cell &cell) const;
+
+  Cube *m_cube;
+  double m_isoValue;
+  int m_dim[3];
+  std::vector<bool> m_known;
+  std::vector<Cell> m_active;
+  std::vector<Cell> m_leaves;
+  std::vector<unsigned int> m_pending;
+  std::vector<Eigen::Vector3d> m_nuclei; // In grid coordinates
+  std::vector<unsigned int> m_activeChildren; // Active cells of each root
+  unsigned int m_numEvaluated;
+  unsigned int m_numResolved;
+};
+
+} // End namespace
+
+#endif
@@ -163,6 +163,37 @@ public:
    */
   virtual bool blockingCalculateCubeDensity(Cube *cube);
 
+  /**
+   * Calculate the MO in the supplied Cube only where it is needed to
+   * extract the isosurfaces at +/- @p isoValue. Other points are
+   * interpolated, so the cube should not be used for other isovalues.
+   * @param cube The cube to write the values of the MO into.
+   * @param mo The molecular orbital number to calculate.
+   * @param isoValue The isovalue the cube will be contoured at.
+   * @note This function starts a threaded calculation. Use watcher() to
+   * monitor progress, counted in coarse cells of the grid, or to cancel it.
+   * A canceled cube is left partly calculated. The default implementation
+   * calculates every point.
+   * @return True if the calculation was successful.
+   */
+  virtual bool calculateCubeMOAdaptive(Cube *cube, unsigned int mo,
+                                       double isoValue)
+  {
+    Q_UNUSED(isoValue);
+    return calculateCubeMO(cube, mo);
+  }
+
+  /**
+   * Calculate the electron density in the supplied Cube only where it is
+   * needed to extract the isosurface at @p isoValue.
+   * @sa calculateCubeMOAdaptive
+   */
+  virtual bool calculateCubeDensityAdaptive(Cube *cube, double isoValue)
+  {
+    Q_UNUSED(isoValue);
+    return calculateCubeDensity(cube);
+  }
+
   /**
    * When performing a calculation the QFutureWatcher is useful if you want
    * to update a progress bar.
@@ -24,11 +24,15 @@
 #endif
 
 #include "cube.h"
+#include "adaptivegrid.h"
 
+#include <algorithm>
 #include <cmath>
 
 #include <QtCore/QtConcurrentMap>
+#include <QtCore/QtConcurrentRun>
 #include <QtCore/QFuture>
+#include <QtCore/QFutureInterface>
 #include <QtCore/QFutureWatcher>
 #include <QtCore/QReadWriteLock>
 #include <QtCore/QDebug>
@@ -242,6 +246,101 @@ bool GaussianSet::calculateCubeDensity(Cube *cube)
   return true;
 }
 
+bool GaussianSet::calculateCubeMOAdaptive(Cube *cube, unsigned int state,
+                                          double isoValue)
+{
+  if (state < 1 || state > static_cast<unsigned int>(m_moMatrix.rows()))
+      return false;
+
+  startAdaptive(cube, state, isoValue);
+  return true;
+}
+
+bool GaussianSet::calculateCubeDensityAdaptive(Cube *cube, double isoValue)
+{
+  if (m_density.size() == 0) {
+    qDebug() << "Cannot calculate density -- density matrix not set.";
+    return false;
+  }
+
+  // State 0 selects the density
+  startAdaptive(cube, 0, isoValue);
+  return true;
+}
+
+void GaussianSet::startAdaptive(Cube *cube, unsigned int state,
+                                double isoValue)
+{
+  if (!m_useOrcaNorm) {
+      initCalculation();
+  } else {
+      initCalculationForOrca();
+  }
+
+  AdaptiveGrid *grid = new AdaptiveGrid(cube, isoValue);
+  for (unsigned int i = 0; i < m_numAtoms; ++i)
+    grid->addNucleus(m_molecule.atomPos(i) * BOHR_TO_ANGSTROM);
+
+  // Lock the cube until we are done.
+  m_cube = cube;
+  cube->lock()->lockForWrite();
+
+  connect(&m_watcher, SIGNAL(finished()), this, SLOT(calculationComplete()));
+
+  // QtConcurrent::run() cannot report progress or be canceled, so the
+  // future is driven by processAdaptive() directly. The range is set here
+  // so that it can be read as soon as this function returns.
+  QFutureInterface<void> futureInterface;
+  futureInterface.reportStarted();
+  futureInterface.setProgressRange(0, grid->numCells());
+  futureInterface.setProgressValue(0);
+  m_future = futureInterface.future();
+  m_watcher.setFuture(m_future);
+
+  QtConcurrent::run(GaussianSet::processAdaptive, this, grid, state,
+                    futureInterface);
+}
+
+void GaussianSet::processAdaptive(GaussianSet *set, AdaptiveGrid *grid,
+                                  unsigned int state,
+                                  QFutureInterface<void> futureInterface)
+{
+  // Points evaluated between checks for cancellation
+  const int chunkSize = 16384;
+
+  QVector<GaussianShell> shells;
+  while (!grid->pending().empty() && !futureInterface.isCanceled()) {
+    const std::vector<unsigned int> &points = grid->pending();
+    for (size_t start = 0; start < points.size(); start += chunkSize) {
+      if (futureInterface.isCanceled())
+        break;
+      int count = static_cast<int>(std::min(points.size() - start,
+                                            size_t(chunkSize)));
+      shells.resize(count);
+      for (int i = 0; i < count; ++i) {
+        shells[i].set = set;
+        shells[i].tCube = set->m_cube;
+        shells[i].pos = points[start + i];
+        shells[i].state = state;
+      }
+      if (state)
+        QtConcurrent::blockingMap(shells, GaussianSet::processPoint);
+      else
+        QtConcurrent::blockingMap(shells, GaussianSet::processDensity);
+    }
+    if (futureInterface.isCanceled())
+      break;
+    grid->refine();
+    futureInterface.setProgressValue(grid->numResolvedCells());
+  }
+  // A canceled cube is left partly calculated
+  if (!futureInterface.isCanceled())
+    grid->interpolate();
+
+  delete grid;
+  futureInterface.reportFinished();
+}
+
 BasisSet * GaussianSet::clone()
 {
   GaussianSet *result = new GaussianSet();
@@ -270,9 +369,15 @@ BasisSet * GaussianSet::clone()
 void GaussianSet::calculationComplete()
 {
   disconnect(&m_watcher, SIGNAL(finished()), this, SLOT(calculationComplete()));
-  (*m_gaussianShells)[0].tCube->lock()->unlock();
-  delete m_gaussianShells;
-  m_gaussianShells = 0;
+  if (m_gaussianShells) {
+    (*m_gaussianShells)[0].tCube->lock()->unlock();
+    delete m_gaussianShells;
+    m_gaussianShells = 0;
+  }
+  else if (m_cube) { // Adaptive calculation
+    m_cube->lock()->unlock();
+    m_cube = 0;
+  }
   emit finished();
 }
 
@@ -23,6 +23,7 @@
 #include "basisset.h"
 
 #include <QtCore/QFuture>
+#include <QtCore/QFutureInterface>
 
 #include <Eigen/Core>
 #include <vector>
@@ -33,6 +34,7 @@ namespace OpenQube
 {
 
 struct GaussianShell;
+class AdaptiveGrid;
 
 /**
  * Enumeration of the Gaussian type orbitals.
@@ -151,6 +153,20 @@ public:
    */
   bool calculateCubeDensity(Cube *cube);
 
+  /**
+   * Calculate the MO on an adaptively refined grid, evaluating the basis
+   * only near the isosurfaces at +/- @p isoValue.
+   * @sa BasisSet::calculateCubeMOAdaptive
+   */
+  bool calculateCubeMOAdaptive(Cube *cube, unsigned int state,
+                               double isoValue);
+
+  /**
+   * Calculate the electron density on an adaptively refined grid.
+   * @sa BasisSet::calculateCubeDensityAdaptive
+   */
+  bool calculateCubeDensityAdaptive(Cube *cube, double isoValue);
+
   /**
    * When performing a calculation the QFutureWatcher is useful if you want
    * to update a progress bar.
@@ -206,6 +222,12 @@ private:
   /// Re-entrant single point forms of the calculations
   static void processPoint(GaussianShell &shell);
   static void processDensity(GaussianShell &shell);
+  /// Start refining @p cube for @p isoValue, state 0 selects the density
+  void startAdaptive(Cube *cube, unsigned int state, double isoValue);
+  /// Refine the grid level by level, calculating only the points needed
+  static void processAdaptive(GaussianSet *set, AdaptiveGrid *grid,
+                              unsigned int state,
+                              QFutureInterface<void> futureInterface);
   static double pointS(GaussianSet *set, unsigned int moIndex,
                        double dr2, unsigned int indexMO);
   static double pointP(GaussianSet *set, unsigned int moIndex,
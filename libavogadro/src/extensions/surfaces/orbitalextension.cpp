@@ -38,6 +38,7 @@
 #include <avogadro/cube.h>
 #include <avogadro/mesh.h>
 #include <avogadro/meshgenerator.h>
+#include <avogadro/meshsimplifier.h>
 #include <avogadro/engine.h>
 #include <avogadro/glwidget.h>
 
@@ -501,12 +502,14 @@ namespace Avogadro
 
     info->state = Running;
 
-    // Check if the cube we want already exists
+    // Check if the cube we want already exists. Cubes are only calculated
+    // in full near the isosurface, so the isovalue must match too.
     for (int i = 0; i < m_queue.size(); i++) {
       calcInfo *cI = &m_queue[i];
       if (cI->state == Completed &&
           cI->orbital == info->orbital &&
-          cI->resolution == info->resolution) {
+          cI->resolution == info->resolution &&
+          cI->isovalue == info->isovalue) {
         info->cube = cI->cube;
         qDebug() << "Reusing cube from calculation " << i << ":\n"
                  << "\tOrbital " << cI->orbital << "\n"
@@ -529,7 +532,7 @@ namespace Avogadro
     m_qube = new OpenQube::Cube;
     m_qube->setLimits(cube->min(), cube->max(), cube->dimensions());
 
-    m_basis->calculateCubeMO(m_qube, info->orbital);
+    m_basis->calculateCubeMOAdaptive(m_qube, info->orbital, info->isovalue);
     connect(&m_basis->watcher(), SIGNAL(finished()),
             this, SLOT(calculateCubeDone()));
 
@@ -556,6 +559,8 @@ namespace Avogadro
     // Convert the cube data
     if (m_qube) {
       info->cube->setData(*m_qube->data());
+      // Only points near this isovalue were evaluated
+      info->cube->setRefinedIsoValue(info->isovalue);
       delete m_qube;
       m_qube = 0;
     }
@@ -626,6 +631,7 @@ namespace Avogadro
                this, 0);
 
     qDebug() << info->orbital << " posMesh calculation finished.";
+    simplifyMesh(info->posMesh);
 
     calculateNegMesh();
   }
@@ -694,9 +700,19 @@ namespace Avogadro
                this, 0);
 
     qDebug() << info->orbital << " negMesh calculation finished.";
+    simplifyMesh(info->negMesh);
     calculationComplete();
   }
 
+  void OrbitalExtension::simplifyMesh(Mesh *mesh)
+  {
+    // The levels of detail are built in the background, the full mesh is
+    // drawn until they are ready
+    MeshSimplifier *simplifier = new MeshSimplifier(mesh);
+    connect(simplifier, SIGNAL(finished()), simplifier, SLOT(deleteLater()));
+    simplifier->start();
+  }
+
   void OrbitalExtension::calculationComplete()
   {
     calcInfo *info = &m_queue[m_currentRunningCalculation];
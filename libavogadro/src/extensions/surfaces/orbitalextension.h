@@ -166,6 +166,10 @@ namespace Avogadro
     void updateProgress(int current);
 
   private:
+    /**
+     * Build the levels of detail of a finished mesh in a new thread.
+     */
+    void simplifyMesh(Mesh *mesh);
 
     QDockWidget *m_dock;
     OrbitalWidget *m_widget;
@@ -0,0 +1,333 @@
+/**********************************************************************
+  SESurface - Class to calculate solvent excluded surface cubes
+
+  Copyright (C) 2013 Avogadro Developers
+
+  This file is part of the Avogadro molecular editor project.
+  For more information, see <http://avogadro.cc/>
+
+  This library is free software; you can redistribute it and/or modify
+  it under the terms of the GNU Library General Public License as
+  published by the Free Software Foundation; either version 2.1 of the
+  License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+  02110-1301, USA.
+ **********************************************************************/
+
+#include "sesurface.h"
+
+#include <avogadro/molecule.h>
+#include <avogadro/atom.h>
+#include <avogadro/cube.h>
+#include <avogadro/glwidget.h>
+#include <avogadro/primitivelist.h>
+
+#include <openbabel/mol.h>
+
+#include <cmath>
+#include <limits>
+
+#include <QtConcurrentMap>
+#include <QtConcurrentRun>
+#include <QFuture>
+#include <QFutureWatcher>
+#include <QReadWriteLock>
+
+using std::vector;
+using Eigen::Vector3d;
+using Eigen::Vector3i;
+
+namespace Avogadro
+{
+  // Squared distance of the points not yet reached by the transform, larger
+  // than any squared distance across a cube
+  static const double farAway = 1.0e10;
+
+  struct SESStruct
+  {
+    vector<Vector3d> atomPos;
+    vector<double> atomRadius; // Grown by the probe radius
+    double probeRadius;
+
+    Vector3d min;
+    Vector3d spacing;
+    Vector3i dims;
+    vector<double> values;     // Squared distances, then the cube values
+  };
+
+  /// One plane or row of the grid handed to a thread
+  struct SESSlice
+  {
+    SESStruct *ses;
+    int index;
+    const vector<unsigned int> *atoms; // The atoms crossing a plane
+  };
+
+  namespace
+  {
+    inline unsigned int gridIndex(const SESStruct &ses, int i, int j, int k)
+    {
+      return (i * ses.dims.y() + j) * ses.dims.z() + k;
+    }
+
+    /**
+     * Flag the points in plane x = @a slice.index inside the grown spheres
+     * of the atoms crossing it as not reached yet.
+     */
+    void stampPlane(SESSlice &slice)
+    {
+      SESStruct &ses = *slice.ses;
+      const int i = slice.index;
+      const double x = ses.min.x() + i * ses.spacing.x();
+      foreach (unsigned int a, *slice.atoms) {
+        const Vector3d &pos = ses.atomPos[a];
+        const double radius2 = ses.atomRadius[a] * ses.atomRadius[a];
+        const double dx2 = (x - pos.x()) * (x - pos.x());
+        if (dx2 >= radius2)
+          continue;
+        // The circle the sphere cuts from the plane, one row at a time
+        const double rowRadius = std::sqrt(radius2 - dx2);
+        const int jMin = qMax(0, int(std::ceil((pos.y() - rowRadius
+                                                - ses.min.y())
+                                               / ses.spacing.y())));
+        const int jMax = qMin(ses.dims.y() - 1,
+                              int(std::floor((pos.y() + rowRadius
+                                              - ses.min.y())
+                                             / ses.spacing.y())));
+        for (int j = jMin; j <= jMax; ++j) {
+          const double y = ses.min.y() + j * ses.spacing.y();
+          const double left = radius2 - dx2 - (y - pos.y()) * (y - pos.y());
+          if (left <= 0.0)
+            continue;
+          const double halfWidth = std::sqrt(left);
+          const int kMin = qMax(0, int(std::floor((pos.z() - halfWidth
+                                                   - ses.min.z())
+                                                  / ses.spacing.z())) + 1);
+          const int kMax = qMin(ses.dims.z() - 1,
+                                int(std::ceil((pos.z() + halfWidth
+                                               - ses.min.z())
+                                              / ses.spacing.z())) - 1);
+          double *row = &ses.values[gridIndex(ses, i, j, 0)];
+          for (int k = kMin; k <= kMax; ++k)
+            row[k] = farAway;
+        }
+      }
+    }
+
+    /**
+     * Exact one dimensional squared distance transform of the @a n values
+     * @a stride apart at @a f, with @a h2 the squared grid spacing. This is
+     * the lower envelope of parabolas of Felzenszwalb and Huttenlocher,
+     * "Distance Transforms of Sampled Functions" (2004).
+     */
+    void transformLine(double *f, int n, int stride, double h2,
+                       vector<double> &g, vector<int> &v, vector<double> &z)
+    {
+      for (int q = 0; q < n; ++q)
+        g[q] = f[q * stride];
+
+      const double infinity = std::numeric_limits<double>::infinity();
+      int k = 0;
+      v[0] = 0;
+      z[0] = -infinity;
+      z[1] = infinity;
+      for (int q = 1; q < n; ++q) {
+        double s;
+        for (;;) {
+          const int p = v[k];
+          s = ((g[q] + h2 * q * q) - (g[p] + h2 * p * p)) / (2.0 * h2 * (q - p));
+          if (s > z[k])
+            break;
+          --k;
+        }
+        ++k;
+        v[k] = q;
+        z[k] = s;
+        z[k + 1] = infinity;
+      }
+
+      k = 0;
+      for (int q = 0; q < n; ++q) {
+        while (z[k + 1] < q)
+          ++k;
+        const int p = v[k];
+        f[q * stride] = qMin(h2 * (q - p) * (q - p) + g[p], farAway);
+      }
+    }
+
+    /// Transform the lines along z and then y in the plane x = index
+    void transformPlane(SESSlice &slice)
+    {
+      SESStruct &ses = *slice.ses;
+      const int ny = ses.dims.y(), nz = ses.dims.z();
+      const int n = qMax(ny, nz);
+      vector<double> g(n), z(n + 1);
+      vector<int> v(n);
+      double *plane = &ses.values[gridIndex(ses, slice.index, 0, 0)];
+      const double hz2 = ses.spacing.z() * ses.spacing.z();
+      for (int j = 0; j < ny; ++j)
+        transformLine(plane + j * nz, nz, 1, hz2, g, v, z);
+      const double hy2 = ses.spacing.y() * ses.spacing.y();
+      for (int k = 0; k < nz; ++k)
+        transformLine(plane + k, ny, nz, hy2, g, v, z);
+    }
+
+    /// Transform the lines along x in the row y = index
+    void transformRow(SESSlice &slice)
+    {
+      SESStruct &ses = *slice.ses;
+      const int nx = ses.dims.x(), nz = ses.dims.z();
+      vector<double> g(nx), z(nx + 1);
+      vector<int> v(nx);
+      const int stride = ses.dims.y() * nz;
+      const double hx2 = ses.spacing.x() * ses.spacing.x();
+      for (int k = 0; k < nz; ++k)
+        transformLine(&ses.values[gridIndex(ses, 0, slice.index, k)], nx,
+                      stride, hx2, g, v, z);
+    }
+  }
+
+  SESurface::SESurface() : m_probeRadius(1.4), m_cube(0), m_ses(0)
+  {
+    connect(&m_watcher, SIGNAL(finished()), this, SLOT(calculationComplete()));
+  }
+
+  SESurface::~SESurface()
+  {
+    m_future.waitForFinished();
+    delete m_ses;
+  }
+
+  void SESurface::setAtoms(Molecule* mol)
+  {
+    // check if there is a selection in the current glwidget
+    GLWidget *glwidget = GLWidget::current();
+    if (glwidget) {
+      QList<Primitive*> atoms = glwidget->selectedPrimitives().subList(Primitive::AtomType);
+      if (!atoms.isEmpty()) {
+        m_atomPos.resize(atoms.size());
+        m_atomRadius.resize(atoms.size());
+
+        for (unsigned int i = 0; i < m_atomPos.size(); ++i) {
+          Atom *atom = static_cast<Atom*>(atoms.at(i));
+          m_atomPos[i] = *atom->pos();
+          m_atomRadius[i] = OpenBabel::etab.GetVdwRad(atom->atomicNumber());
+        }
+
+        return;
+      }
+    }
+
+    m_atomPos.resize(mol->numAtoms());
+    m_atomRadius.resize(mol->numAtoms());
+
+    for (unsigned int i = 0; i < m_atomPos.size(); ++i) {
+      m_atomPos[i] = *mol->atom(i)->pos();
+      m_atomRadius[i] = OpenBabel::etab.GetVdwRad(mol->atom(i)->atomicNumber());
+    }
+  }
+
+  void SESurface::calculateCube(Cube *cube)
+  {
+    // A calculation still running hands its cube over first
+    if (m_ses) {
+      m_future.waitForFinished();
+      calculationComplete();
+    }
+
+    // The calculation works on its own copy of the atoms and the grid
+    m_ses = new SESStruct;
+    m_ses->atomPos = m_atomPos;
+    m_ses->atomRadius = m_atomRadius;
+    for (unsigned int i = 0; i < m_ses->atomRadius.size(); ++i)
+      m_ses->atomRadius[i] += m_probeRadius;
+    m_ses->probeRadius = m_probeRadius;
+    m_ses->min = cube->min();
+    m_ses->spacing = cube->spacing();
+    m_ses->dims = cube->dimensions();
+    m_cube = cube;
+
+    // Lock the cube until we are done.
+    cube->lock()->lockForWrite();
+
+    m_future = QtConcurrent::run(SESurface::calculate, m_ses);
+    // Connect our watcher to our future
+    m_watcher.setFuture(m_future);
+  }
+
+  void SESurface::calculationComplete()
+  {
+    // The finished signal of a calculation completed by calculateCube() may
+    // still arrive after the next one started
+    if (!m_ses || !m_future.isFinished())
+      return;
+    m_cube->setData(m_ses->values);
+    m_cube->lock()->unlock();
+    m_cube->update();
+    delete m_ses;
+    m_ses = 0;
+  }
+
+  void SESurface::calculate(SESStruct *ses)
+  {
+    const int nx = ses->dims.x(), ny = ses->dims.y(), nz = ses->dims.z();
+    ses->values.assign(nx * ny * nz, 0.0);
+    if (ses->values.empty())
+      return;
+
+    // Sort the atoms into the planes of constant x their grown sphere cuts,
+    // so every plane can be stamped by its own thread
+    vector<vector<unsigned int> > planeAtoms(nx);
+    for (unsigned int a = 0; a < ses->atomPos.size(); ++a) {
+      const double x = ses->atomPos[a].x() - ses->min.x();
+      const double radius = ses->atomRadius[a];
+      const int first = qMax(0, int(std::ceil((x - radius) / ses->spacing.x())));
+      const int last = qMin(nx - 1,
+                            int(std::floor((x + radius) / ses->spacing.x())));
+      for (int i = first; i <= last; ++i)
+        planeAtoms[i].push_back(a);
+    }
+
+    QVector<SESSlice> planes(nx);
+    for (int i = 0; i < nx; ++i) {
+      planes[i].ses = ses;
+      planes[i].index = i;
+      planes[i].atoms = &planeAtoms[i];
+    }
+    QtConcurrent::blockingMap(planes, stampPlane);
+
+    // Beyond the cube is solvent, which also keeps the transform finite
+    for (int i = 0; i < nx; ++i) {
+      for (int j = 0; j < ny; ++j) {
+        for (int k = 0; k < nz; ++k) {
+          if (i == 0 || i == nx - 1 || j == 0 || j == ny - 1
+              || k == 0 || k == nz - 1)
+            ses->values[gridIndex(*ses, i, j, k)] = 0.0;
+        }
+      }
+    }
+
+    // The transform is separable: z and y within each plane, then x
+    QtConcurrent::blockingMap(planes, transformPlane);
+    QVector<SESSlice> rows(ny);
+    for (int j = 0; j < ny; ++j) {
+      rows[j].ses = ses;
+      rows[j].index = j;
+      rows[j].atoms = 0;
+    }
+    QtConcurrent::blockingMap(rows, transformRow);
+
+    // Points closer to a probe centre than the probe radius are solvent
+    for (unsigned int i = 0; i < ses->values.size(); ++i)
+      ses->values[i] = ses->probeRadius - std::sqrt(ses->values[i]);
+  }
+
+}
@@ -0,0 +1,137 @@
+/**********************************************************************
+  SESurface - Class to calculate solvent excluded surface cubes
+
+  Copyright (C) 2013 Avogadro Developers
+
+  This file is part of the Avogadro molecular editor project.
+  For more information, see <http://avogadro.cc/>
+
+  This library is free software; you can redistribute it and/or modify
+  it under the terms of the GNU Library General Public License as
+  published by the Free Software Foundation; either version 2.1 of the
+  License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+  02110-1301, USA.
+ **********************************************************************/
+
+#ifndef SESURFACE_H
+#define SESURFACE_H
+
+#include "config.h"
+
+#include <QObject>
+#include <QFuture>
+#include <QFutureWatcher>
+
+#include <Eigen/Core>
+#include <vector>
+
+/**
+ * @class SESurface sesurface.h
+ * @brief Calculates cubes of the solvent excluded (Connolly) surface.
+ *
+ * The solvent excluded surface is the surface of the region a spherical
+ * probe rolling over the Van der Waals spheres can not reach. It is found on
+ * the grid of the cube in two steps:
+ *
+ * -# The points where the centre of the probe can be, outside of the
+ *    spheres grown by the probe radius, are flagged by stamping the grown
+ *    spheres onto the grid.
+ * -# An exact Euclidean distance transform gives the distance of every
+ *    other point to the nearest of those probe centres. The probe covers
+ *    the points closer than its radius, so the cube value is the distance
+ *    minus the probe radius, negated: negative inside the surface, zero on
+ *    it and positive outside, like the Van der Waals cube.
+ *
+ * Both steps are linear in the number of grid points and run in parallel
+ * with QtConcurrent, the distance transform one line of the grid at a time
+ * along each axis in turn. The surface is accurate to about one grid
+ * spacing. The points on the faces of the cube are taken to be solvent, so
+ * the cube should be padded by at least the probe radius plus the largest
+ * atom radius.
+ */
+
+namespace Avogadro
+{
+
+  class Molecule;
+  class Cube;
+  struct SESStruct;
+
+  class SESurface : public QObject
+  {
+  Q_OBJECT
+
+  public:
+    /**
+     * Constructor.
+     */
+    SESurface();
+
+    /**
+     * Destructor.
+     */
+    ~SESurface();
+
+    /**
+     * Set the atoms in the Molecule to the solvent excluded surface. The
+     * selected atoms are used if there is a selection.
+     * @param mol Molecule to copy atoms across from.
+     */
+    void setAtoms(Molecule* mol);
+
+    /**
+     * Set the radius of the solvent probe, the default is 1.4 Angstrom.
+     */
+    void setProbeRadius(double radius) { m_probeRadius = radius; }
+
+    /**
+     * @return The radius of the solvent probe.
+     */
+    double probeRadius() const { return m_probeRadius; }
+
+    /**
+     * Calculate the solvent excluded cube over the entire range of the
+     * supplied Cube in the background. The cube is locked for writing until
+     * the values are set, a calculation still running is completed first.
+     * @param cube The cube to write the values to.
+     */
+    void calculateCube(Cube *cube);
+
+    /**
+     * When performing a calculation the QFutureWatcher is useful if you want
+     * to update a progress bar.
+     */
+    QFutureWatcher<void> & watcher() { return m_watcher; }
+
+  private Q_SLOTS:
+    /**
+     * Slot to set the cube data once Qt Concurrent is done
+     */
+     void calculationComplete();
+
+  private:
+    std::vector<Eigen::Vector3d> m_atomPos;
+    std::vector<double> m_atomRadius;
+    double m_probeRadius;
+
+    QFuture<void> m_future;
+    QFutureWatcher<void> m_watcher;
+    Cube *m_cube; // Cube to put the results into
+    SESStruct *m_ses;
+
+    /// The calculation, run in the background
+    static void calculate(SESStruct *ses);
+  };
+
+} // End namespace Avogadro
+
+#endif
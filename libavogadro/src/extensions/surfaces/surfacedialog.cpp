@@ -40,7 +40,7 @@ namespace Avogadro {
     ui.moColorCombo->hide();
 
     // Initialize the surface and color by type mappings
-    m_surfaceTypes << Cube::VdW << Cube::ESP;
+    m_surfaceTypes << Cube::VdW << Cube::SolventExcluded << Cube::ESP;
     m_colorTypes << Cube::None << Cube::ESP;
 
     // Connect up some signals and slots
@@ -78,7 +78,8 @@ namespace Avogadro {
     }
     // Now add the MO option to the surface and color combos
     m_surfaceTypes.clear();
-    m_surfaceTypes << Cube::VdW << Cube::ESP << Cube::ElectronDensity << Cube::MO;
+    m_surfaceTypes << Cube::VdW << Cube::SolventExcluded << Cube::ESP
+                   << Cube::ElectronDensity << Cube::MO;
     m_colorTypes.clear();
     m_colorTypes << Cube::None << Cube::ESP << Cube::ElectronDensity << Cube::MO;
     updateCubes();
@@ -220,7 +221,7 @@ namespace Avogadro {
 
     // Update the type mappings too
     m_surfaceTypes.clear();
-    m_surfaceTypes << Cube::VdW << Cube::ESP;
+    m_surfaceTypes << Cube::VdW << Cube::SolventExcluded << Cube::ESP;
     m_colorTypes.clear();
     m_colorTypes << Cube::None << Cube::ESP;
 
@@ -241,6 +242,8 @@ namespace Avogadro {
         return tr("Nothing", "A cube type of nothing - empty cube");
       case Cube::VdW:
         return tr("Van der Waals", "Van der Waals surface type");
+      case Cube::SolventExcluded:
+        return tr("Solvent Excluded", "Solvent excluded surface type");
       case Cube::ESP:
         return tr("Electrostatic Potential",
                   "Electrostatic potential surface type");
@@ -331,6 +334,7 @@ namespace Avogadro {
       double isoValue = 0.0;
       switch (m_surfaceTypes[n]) {
         case Cube::VdW:
+        case Cube::SolventExcluded:
           isoValue = 0.0;
           break;
         case Cube::ESP:
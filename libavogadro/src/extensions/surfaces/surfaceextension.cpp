@@ -31,8 +31,10 @@
 #include <openqube/cube.h>
 
 #include "vdwsurface.h"
+#include "sesurface.h"
 #include "surfacedialog.h"
 
+#include <algorithm>
 #include <vector>
 #include <avogadro/toolgroup.h>
 #include <avogadro/molecule.h>
@@ -41,10 +43,13 @@
 #include <avogadro/mesh.h>
 #include <avogadro/color3f.h>
 #include <avogadro/meshgenerator.h>
+#include <avogadro/meshsimplifier.h>
 #include <avogadro/engine.h>
 #include <avogadro/neighborlist.h>
 #include <avogadro/glwidget.h>
 
+#include <openbabel/data.h>
+
 #include <Eigen/Core>
 
 #include <QProgressDialog>
@@ -63,9 +68,23 @@ using namespace OpenQube;
 
 namespace Avogadro
 {
+  // Radius of the solvent probe for the solvent excluded surface
+  static const double sesProbeRadius = 1.4;
+
+  // The solvent excluded cube needs room for the probe around the largest
+  // atom, e.g. 3.43 A for Rb and Cs
+  static double sesPadding(const Molecule *molecule)
+  {
+    double radius = 0.0;
+    foreach (const Atom *atom, molecule->atoms())
+      radius = std::max(radius, OpenBabel::etab.GetVdwRad(atom->atomicNumber()));
+    return radius + sesProbeRadius;
+  }
+
   SurfaceExtension::SurfaceExtension(QObject* parent) : Extension(parent),
-    m_glwidget(0), m_surfaceDialog(0), m_molecule(0), m_basis(0), m_progress(0),
+    m_sesCube(FALSE_ID), m_glwidget(0), m_surfaceDialog(0), m_molecule(0), m_basis(0), m_progress(0),
     m_mesh1(0), m_mesh2(0), m_meshGen1(0), m_meshGen2(0), m_VdWsurface(0),
+    m_SESurface(0),
     m_cube(0), m_qube(0), m_cubeColor(0)
   {
     QAction* action = new QAction(this);
@@ -83,6 +102,8 @@ namespace Avogadro
     m_meshGen2 = 0;
     delete m_VdWsurface;
     m_VdWsurface = 0;
+    delete m_SESurface;
+    m_SESurface = 0;
   }
 
   QList<QAction *> SurfaceExtension::actions() const
@@ -124,9 +145,12 @@ namespace Avogadro
     m_basis = 0;
     delete m_VdWsurface;
     m_VdWsurface = 0;
+    delete m_SESurface;
+    m_SESurface = 0;
     m_loadedFileName = QString();
     m_cubes.clear();
     m_cubes << FALSE_ID << FALSE_ID;
+    m_sesCube = FALSE_ID;
     m_moCubes.clear();
 
     // This will no longer be valid if the molecule has changed - clear them
@@ -259,12 +283,12 @@ namespace Avogadro
     mesh->setColors(colors);
   }
 
-  Cube * SurfaceExtension::newCube()
+  Cube * SurfaceExtension::newCube(double padding)
   {
     // This function takes the requested resolution and makes a new cube
     Cube *cube = m_molecule->addCube();
     double step = m_surfaceDialog->stepSize();
-    cube->setLimits(m_molecule, step, 2.5);
+    cube->setLimits(m_molecule, step, padding);
     return cube;
   }
 
@@ -321,11 +345,47 @@ namespace Avogadro
             this, SLOT(calculateDone()));
   }
 
+  void SurfaceExtension::calculateSES(Cube *cube)
+  {
+    if (!m_SESurface)
+      m_SESurface = new SESurface;
+
+    // Only do the calculation if there is a molecule and it has some atoms
+    if (!m_molecule || !m_molecule->numAtoms())
+      return;
+    m_SESurface->setAtoms(m_molecule);
+    m_SESurface->setProbeRadius(sesProbeRadius);
+
+    m_SESurface->calculateCube(cube);
+
+    // Set up a progress dialog
+    if (!m_progress) {
+      m_progress = new QProgressDialog(m_surfaceDialog);
+      m_progress->setCancelButtonText(tr("Abort Calculation"));
+      m_progress->setWindowModality(Qt::NonModal);
+    }
+
+    // The calculation runs in one piece, so the progress bar only shows that
+    // it is busy
+    m_progress->setWindowTitle(tr("Calculating Solvent Excluded Cube"));
+    m_progress->setRange(0, 0);
+    m_progress->setValue(0);
+    m_progress->show();
+
+    connect(m_progress, SIGNAL(canceled()),
+            this, SLOT(calculateCanceled()));
+    connect(&m_SESurface->watcher(), SIGNAL(finished()),
+            m_progress, SLOT(reset()));
+    connect(&m_SESurface->watcher(), SIGNAL(finished()),
+            this, SLOT(calculateDone()));
+  }
+
   void SurfaceExtension::calculateMo(OpenQube::Cube *cube, int mo)
   {
     if (m_basis) {
 
-      m_basis->calculateCubeMO(cube, mo);
+      // Only refine the grid near the isosurface we are about to extract
+      m_basis->calculateCubeMOAdaptive(cube, mo, m_surfaceDialog->isoValue());
 
       // Set up a progress dialog
       if (!m_progress) {
@@ -360,7 +420,7 @@ namespace Avogadro
     if (!m_basis)
       return;
 
-    m_basis->calculateCubeDensity(cube);
+    m_basis->calculateCubeDensityAdaptive(cube, m_surfaceDialog->isoValue());
 
     // Set up a progress dialog
     if (!m_progress) {
@@ -382,7 +442,7 @@ namespace Avogadro
     connect(&m_basis->watcher(), SIGNAL(progressRangeChanged(int, int)),
             m_progress, SLOT(setRange(int, int)));
     connect(m_progress, SIGNAL(canceled()),
-            this, SLOT(slaterCanceled()));
+            this, SLOT(calculateCanceled()));
     connect(&m_basis->watcher(), SIGNAL(finished()),
             this, SLOT(calculateDone()));
     m_surfaceDialog->enableCalculation(false);
@@ -415,7 +475,9 @@ namespace Avogadro
       connect(m_meshGen1, SIGNAL(finished()), this, SLOT(calculateDone()));
     }
     m_meshGen1->initialize(cube, m_mesh1, isoValue,
-                           m_surfaceDialog->cubeType() == Cube::VdW);
+                           m_surfaceDialog->cubeType() == Cube::VdW
+                           || m_surfaceDialog->cubeType()
+                              == Cube::SolventExcluded);
     m_meshGen1->start();
 
     // Calculate the negative part of the MO if this is an MO mesh
@@ -479,6 +541,35 @@ namespace Avogadro
           return;
         }
       }
+      case Cube::SolventExcluded: {
+        Cube *cube = m_molecule->cubeById(m_sesCube);
+        if (!cube) { // We need a new cube
+          cube = newCube(sesPadding(m_molecule));
+          cube->setName(tr("Solvent Excluded"));
+          cube->setCubeType(Cube::SolventExcluded);
+          m_sesCube = cube->id();
+          calculateSES(cube);
+          calculateCube = true;
+          m_cube = cube;
+          return;
+        }
+        // There is a valid cube - check the resolution
+        else if (fabs(cube->spacing().x() - m_surfaceDialog->stepSize()) > 0.02) {
+          // Resize the cube and recalculate at the desired resolution
+          cube->setLimits(m_molecule, m_surfaceDialog->stepSize(),
+                          sesPadding(m_molecule));
+          calculateSES(cube);
+          calculateCube = true;
+          m_cube = cube;
+          return;
+        }
+        else {
+          // The cube is valid, the resolution is valid. Return cube
+          calculateCube = false;
+          m_cube = cube;
+          return;
+        }
+      }
       case Cube::ESP:
         // FIXME To be implemented - calculate an ESP cube
         return;
@@ -496,8 +587,11 @@ namespace Avogadro
           calculateCube = true;
           return;
         }
-        // There is a valid cube - check the resolution
-        else if (fabs(cube->spacing().x() - m_surfaceDialog->stepSize()) > 0.02) {
+        // There is a valid cube - check the resolution and isovalue
+        else if (fabs(cube->spacing().x() - m_surfaceDialog->stepSize()) > 0.02
+                 || (cube->refinedIsoValue() != 0.0
+                     && cube->refinedIsoValue()
+                        != m_surfaceDialog->isoValue())) {
           // Resize the cube and recalculate at the desired resolution
           cube->setLimits(m_molecule, m_surfaceDialog->stepSize(), 2.5);
           m_cube = cube;
@@ -529,8 +623,11 @@ namespace Avogadro
           calculateCube = true;
           return;
         }
-        // There is a valid cube - check the resolution
-        else if (fabs(cube->spacing().x() - m_surfaceDialog->stepSize()) > 0.02) {
+        // There is a valid cube - check the resolution and isovalue
+        else if (fabs(cube->spacing().x() - m_surfaceDialog->stepSize()) > 0.02
+                 || (cube->refinedIsoValue() != 0.0
+                     && cube->refinedIsoValue()
+                        != m_surfaceDialog->isoValue())) {
           qDebug() << "Recalculating MO cube, delta ="
               << fabs(cube->spacing().x() - m_surfaceDialog->stepSize());
           // Resize the cube and recalculate at the desired resolution
@@ -602,12 +699,30 @@ namespace Avogadro
             m_surfaceDialog->cubeType() == Cube::ElectronDensity) {
           if (m_basis)
             disconnect(&m_basis->watcher(), 0, this, 0);
+          if (m_basis && m_basis->watcher().isCanceled()) {
+            // Forget the cube, it is recalculated when next requested
+            delete m_qube;
+            m_qube = 0;
+            m_molecule->removeCube(m_cube);
+            m_cube = 0;
+            disconnect(m_progress, 0, this, 0);
+            m_progress->reset();
+            m_calculationPhase = -1;
+            m_surfaceDialog->enableCalculation(true);
+            return;
+          }
           if (m_qube) {
             m_cube->setData(*m_qube->data());
+            // Only points near this isovalue were evaluated
+            m_cube->setRefinedIsoValue(m_surfaceDialog->isoValue());
             delete m_qube;
             m_qube = 0;
           }
         }
+        if (m_SESurface) {
+          disconnect(&m_SESurface->watcher(), 0, this, 0);
+          disconnect(&m_SESurface->watcher(), 0, m_progress, 0);
+        }
         disconnect(m_progress, 0, this, 0);
         // FIXME Skipped for now!
         if (m_surfaceDialog->cubeColorType() != Cube::None) {
@@ -647,6 +762,20 @@ namespace Avogadro
           else
             settings.setValue("colorMode", 0);
 
+          // The levels of detail are built in the background once the
+          // colors are final, the full meshes are drawn until they are ready
+          QList<Mesh *> meshes;
+          meshes << m_mesh1;
+          if (m_mesh2)
+            meshes << m_mesh2;
+          foreach (Mesh *mesh, meshes) {
+            MeshSimplifier *simplifier = new MeshSimplifier(mesh);
+            connect(simplifier, SIGNAL(finished()), m_glwidget, SLOT(update()));
+            connect(simplifier, SIGNAL(finished()),
+                    simplifier, SLOT(deleteLater()));
+            simplifier->start();
+          }
+
           settings.setValue("mesh1Id", static_cast<int>(m_mesh1->id()));
           if (m_mesh2)
             settings.setValue("mesh2Id", static_cast<int>(m_mesh2->id()));
@@ -672,7 +801,10 @@ namespace Avogadro
 
   void SurfaceExtension::calculateCanceled()
   {
-    /// FIXME - implement this code too!
+    // Only the basis set calculations can be stopped part way, the partial
+    // cube is dropped once the calculation returns (see calculateDone())
+    if (m_calculationPhase == 0 && m_basis && m_basis->watcher().isRunning())
+      m_basis->watcher().cancel();
   }
 
 } // End namespace Avogadro
@@ -31,6 +31,7 @@
 
 #include <QVector>
 #include <QList>
+#include <QHash>
 
 class QProgressDialog;
 
@@ -46,6 +47,7 @@ namespace Avogadro
   class Mesh;
   class MeshGenerator;
   class VdWSurface;
+  class SESurface;
   class SurfaceDialog;
 
   class SurfaceExtension : public Extension
@@ -68,6 +70,7 @@ namespace Avogadro
 
   private:
     QList<unsigned long> m_cubes; // These are the standard cubes
+    unsigned long m_sesCube; // The solvent excluded cube
     QVector<unsigned long> m_moCubes; // These are the MO cubes
     int m_calculationPhase;        // The calculation phase
     GLWidget* m_glwidget;
@@ -83,6 +86,7 @@ namespace Avogadro
     MeshGenerator *m_meshGen2;
 
     VdWSurface *m_VdWsurface;
+    SESurface *m_SESurface;
 
     Cube *m_cube;
     OpenQube::Cube *m_qube;
@@ -96,12 +100,15 @@ namespace Avogadro
     void calculateESP(Mesh *mesh);
 
     //! Convenience function - creates a new cube with the correct dimensions.
-    Cube * newCube();
+    Cube * newCube(double padding = 2.5);
     OpenQube::Cube * newQube();
 
     //! Calculate the VdW cube
     void calculateVdW(Cube *cube);
 
+    //! Calculate the solvent excluded cube
+    void calculateSES(Cube *cube);
+
     //! Calculate an MO cube
     void calculateMo(OpenQube::Cube *cube, int mo);
 
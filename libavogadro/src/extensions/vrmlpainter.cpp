@@ -27,7 +27,7 @@ namespace Avogadro
 	{
 	public:
 		VRMLPainterPrivate() : pd(0), initialized(false), sharing(0),
-			color(0), output(0), planeNormalVector(0., 0., 0.)
+			color(0), output(0), planeNormalVector(0., 0., 0.), meshTriangles(0)
 		{
 			color.setFromRgba(0., 0., 0., 0.);
 		}
@@ -46,6 +46,7 @@ namespace Avogadro
 		Color color;
 		QTextStream *output;
 		Vector3d planeNormalVector;
+		unsigned int meshTriangles;
 	};
 
 	VRMLPainter::VRMLPainter() : d(new VRMLPainterPrivate)
@@ -236,10 +237,16 @@ namespace Avogadro
 	{
 	}
 
+	void VRMLPainter::setMeshTriangles(unsigned int triangles)
+	{
+		d->meshTriangles = triangles;
+	}
+
 	void VRMLPainter::drawMesh(const Mesh & mesh, int mode)
 	{
-		std::vector<Eigen::Vector3f> t = mesh.vertices();
-		std::vector<Eigen::Vector3f> n = mesh.normals();
+		const Mesh *level = mesh.levelForTriangles(d->meshTriangles);
+		std::vector<Eigen::Vector3f> t = level->vertices();
+		std::vector<Eigen::Vector3f> n = level->normals();
 		std::vector<Color3f> c;
 
 		//take color from d->color
@@ -287,9 +294,10 @@ namespace Avogadro
 
 	void VRMLPainter::drawColorMesh(const Mesh & mesh, int mode)
 	{
-		std::vector<Eigen::Vector3f> t = mesh.vertices();
-		std::vector<Eigen::Vector3f> n = mesh.normals();
-		std::vector<Color3f> c = mesh.colors();
+		const Mesh *level = mesh.levelForTriangles(d->meshTriangles);
+		std::vector<Eigen::Vector3f> t = level->vertices();
+		std::vector<Eigen::Vector3f> n = level->normals();
+		std::vector<Color3f> c = level->colors();
 
 		// If there are no triangles then don't bother doing anything
 		if (t.size() == 0 || t.size() != c.size())
@@ -376,13 +384,15 @@ namespace Avogadro
 
 
 	VRMLPainterDevice::VRMLPainterDevice(const QString& filename,
-		const GLWidget* glwidget,const double scale, VRMLDialog* m_VRMLDialog)
+		const GLWidget* glwidget,const double scale, VRMLDialog* m_VRMLDialog,
+		unsigned int meshTriangles)
 	{
 		m_output = 0;
 		m_glwidget = glwidget;
 
 		m_painter = new VRMLPainter;
 		m_painter->scale = scale;
+		m_painter->setMeshTriangles(meshTriangles);
 		m_painter->thinnestCyl = std::numeric_limits<double>::max(); //keep track of the thinnest cylinder
 		m_painter->smallestSphere = std::numeric_limits<double>::max(); //keep track of the smallest sphere
 		if (!filename.isEmpty()) {
@@ -58,6 +58,13 @@ namespace Avogadro
 
 		void setPlaneNormal(Vector3d planeNormalVector);
 
+		/**
+		* Limit the number of triangles written for each mesh, meshes with
+		* more triangles are written from a simplified level. 0 (the default)
+		* writes all meshes at full detail.
+		*/
+		void setMeshTriangles(unsigned int triangles);
+
 
 		void drawSphere(const Vector3d &center, double radius);
 
@@ -151,7 +158,8 @@ namespace Avogadro
 	class VRMLPainterDevice : public PainterDevice
 	{
 	public:
-		VRMLPainterDevice(const QString& filename, const GLWidget* glwidget, const double scale, VRMLDialog* m_VRMLDialog);
+		VRMLPainterDevice(const QString& filename, const GLWidget* glwidget, const double scale, VRMLDialog* m_VRMLDialog,
+			unsigned int meshTriangles = 0);
 		~VRMLPainterDevice();
 
 		void initializeVRML();
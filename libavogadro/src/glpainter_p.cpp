@@ -45,6 +45,9 @@
 #include <QDebug>
 #include <QColor>
 #include <QVarLengthArray>
+#ifdef ENABLE_THREADED_GL
+#include <QMutex>
+#endif
 #include <Eigen/Geometry>
 
 #ifdef Q_WS_MAC
@@ -105,13 +108,22 @@ namespace Avogadro
     / ( PAINTER_CYLINDERS_SQRT_LIMIT_MAX_LEVEL - PAINTER_CYLINDERS_SQRT_LIMIT_MIN_LEVEL );
 //  const double   PAINTER_FRUSTUM_CULL_TRESHOLD = -0.8;
 
+  // Triangles per pixel covered by a mesh for each global quality setting,
+  // used to choose a simplified level of large meshes
+  const double   PAINTER_MESH_TRIANGLES_PER_PIXEL[5]
+  = { 0.1, 0.2, 0.5, 1.0, 2.0 };
+
   class GLPainterPrivate
   {
   public:
     GLPainterPrivate() : widget ( 0 ), newQuality(-1), quality ( 0 ), overflow(0),
                          spheres ( 0 ), cylinders ( 0 ),
                          textRenderer ( new TextRenderer ), initialized ( false ), sharing ( 0 ),
-                         type(Primitive::OtherType), id ( -1 ), color(0)  {};
+                         type(Primitive::OtherType), id ( -1 ), color(0)
+#ifdef ENABLE_THREADED_GL
+                         , mutex(QMutex::Recursive)
+#endif
+    {};
     ~GLPainterPrivate()
     {
       deleteObjects();
@@ -155,6 +167,14 @@ namespace Avogadro
     Primitive::Type type;
     int id;
     Color color;
+
+#ifdef ENABLE_THREADED_GL
+    /**
+     * Shared painters are used by the render threads of several widgets,
+     * held from begin() to the matching end().
+     */
+    QMutex mutex;
+#endif
   };
 
   inline bool GLPainterPrivate::isValid()
@@ -1012,8 +1032,9 @@ namespace Avogadro
     d->color.applyAsMaterials();
 
     // Render the triangles of the mesh
-    std::vector<Eigen::Vector3f> v = mesh.vertices();
-    std::vector<Eigen::Vector3f> n = mesh.normals();
+    const Mesh *level = meshLevel(mesh);
+    std::vector<Eigen::Vector3f> v = level->vertices();
+    std::vector<Eigen::Vector3f> n = level->normals();
 
     if (v.size() != n.size()) {
       qDebug() << "Vertices size does not equal normals size:" << v.size()
@@ -1053,9 +1074,10 @@ namespace Avogadro
     }
 
     // Render the triangles of the mesh
-    std::vector<Eigen::Vector3f> v = mesh.vertices();
-    std::vector<Eigen::Vector3f> n = mesh.normals();
-    std::vector<Color3f> c = mesh.colors();
+    const Mesh *level = meshLevel(mesh);
+    std::vector<Eigen::Vector3f> v = level->vertices();
+    std::vector<Eigen::Vector3f> n = level->normals();
+    std::vector<Color3f> c = level->colors();
 
     if (v.size() != n.size() || v.size() != c.size()) {
       qDebug() << "Vertices size does not equal normals size or color size:"
@@ -1094,6 +1116,29 @@ namespace Avogadro
     glEnable(GL_LIGHTING);
   }
 
+  const Mesh * GLPainter::meshLevel(const Mesh &mesh) const
+  {
+    // As for spheres and cylinders the detail only depends on the size on
+    // screen in the perspective projection
+    if (!d->isValid() || !m_dynamicScaling || mesh.numLevels() < 2 ||
+        d->widget->projection() == GLWidget::Orthographic)
+      return &mesh;
+
+    const double distance =
+      d->widget->camera()->distance(mesh.center().cast<double>());
+    if (distance <= mesh.radius())
+      return &mesh;
+
+    // Radius of the bounding sphere of the mesh in pixels
+    const double pixels = mesh.radius() / distance * d->widget->height()
+      / (2.0 * tan(d->widget->camera()->angleOfViewY() * M_PI / 360.0));
+    const double triangles = PAINTER_MESH_TRIANGLES_PER_PIXEL[d->quality]
+      * M_PI * pixels * pixels;
+    if (triangles >= mesh.numVertices() / 3)
+      return &mesh;
+    return mesh.levelForTriangles(qMax(1u, static_cast<unsigned int>(triangles)));
+  }
+
   int GLPainter::drawText ( int x, int y, const QString &string )
   {
     if(!d->isValid()) { return 0; }
@@ -1261,6 +1306,9 @@ namespace Avogadro
 
   void GLPainter::begin(GLWidget *widget)
   {
+#ifdef ENABLE_THREADED_GL
+    d->mutex.lock();
+#endif
     d->widget = widget;
     d->overflow++;
     // Ensure that the painter is properly initialised
@@ -1274,6 +1322,9 @@ namespace Avogadro
       {
         d->widget = 0;
       }
+#ifdef ENABLE_THREADED_GL
+    d->mutex.unlock();
+#endif
   }
 
   void GLPainter::pushName()
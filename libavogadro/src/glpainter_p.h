@@ -501,6 +501,12 @@ namespace Avogadro
 
     bool m_dynamicScaling;
 
+    /**
+     * @return The level of detail of @p mesh to draw, chosen from the size
+     * of the mesh on screen when dynamic scaling is on.
+     */
+    const Mesh * meshLevel(const Mesh &mesh) const;
+
     /**
      * Increment the number of widgets the Painter is being shared by.
      */
@@ -74,6 +74,8 @@
 #include <QtCore/QMutex>
 
 #ifdef ENABLE_THREADED_GL
+  #include <QtCore/QMutexLocker>
+  #include <QtCore/QSharedPointer>
   #include <QtCore/QWaitCondition>
   #include <QtCore/QThread>
 #endif
@@ -144,6 +146,7 @@ namespace Avogadro {
     bool isSelected( const Primitive *p ) const { return widget->isSelected(p); }
     double radius( const Primitive *p ) const { return widget->radius(p); }
     const Molecule *molecule() const { return widget->molecule(); }
+    const Vector3d * atomPos(const Atom *atom) const { return widget->atomPos(atom); }
     Color *colorMap() const { return widget->colorMap(); }
 
     int width() { return widget->width(); }
@@ -153,6 +156,40 @@ namespace Avogadro {
     GLWidget *widget;
   };
 
+#ifdef ENABLE_THREADED_GL
+  /**
+   * The view state needed to draw one frame. It is captured by the GUI thread
+   * each time a redraw is requested and is not modified after being handed
+   * to the render thread, so the GUI thread is free to carry on changing the
+   * camera, selection, engines and atom positions while a slow frame is
+   * drawn. The members share their names with GLWidgetPrivate so
+   * GLWidget::render() can use either.
+   */
+  struct GLFrame
+  {
+    GLFrame() : camera(0), radius(1.0), fogLevel(0), width(0), height(0),
+                quickRender(false), updateCache(false), renderAxes(false)
+    {}
+    ~GLFrame() { delete camera; }
+
+    Camera                *camera;
+    PrimitiveList          selectedPrimitives;
+    QList<Engine *>        engines; // Enabled engines, in render order
+    QList<Engine *>        transparentEngines; // Those with transparent layers
+    std::vector<Vector3d>  positions; // Current conformer, by atom id
+    QColor                 background;
+    Vector3d               normalVector;
+    Vector3d               center;
+    double                 radius;
+    int                    fogLevel;
+    int                    width;
+    int                    height;
+    bool                   quickRender;
+    bool                   updateCache;
+    bool                   renderAxes;
+  };
+#endif
+
   class GLWidgetPrivate
   {
   public:
@@ -168,6 +205,7 @@ namespace Avogadro {
                         selectBufSize( -1 ),
                         undoStack(0),
 #ifdef ENABLE_THREADED_GL
+                        paintMutex( QMutex::Recursive ),
                         thread( 0 ),
 #else
                         initialized( false ),
@@ -202,7 +240,36 @@ namespace Avogadro {
         glDeleteLists(dlistTransparent, 1);
     }
 
-    void updateListQuick();
+    void updateListQuick(const QList<Engine *> &engines, bool &updateCache);
+
+    /**
+     * Fill @p opaque with the enabled engines in render order, and
+     * @p transparent with those of them that have transparent layers.
+     */
+    void enabledEngines(QList<Engine *> &opaque,
+                        QList<Engine *> &transparent) const;
+
+#ifdef ENABLE_THREADED_GL
+    /**
+     * @return The current view state, captured in the GUI thread. The
+     * molecule must be locked for reading.
+     */
+    QSharedPointer<GLFrame> captureFrame(const GLWidget *widget) const;
+
+    /**
+     * Capture the current view state and hand it to the render thread. A
+     * frame that has not been drawn yet is replaced, so redraw requests
+     * arriving faster than frames can be drawn are coalesced. No frame is
+     * published while another thread holds the molecule write lock.
+     */
+    void publishFrame(const GLWidget *widget);
+
+    /**
+     * Discard the pending and last drawn frames. Must be called with the
+     * paintMutex held, e.g. before deleting engines they may refer to.
+     */
+    void dropFrames();
+#endif
 
     QList<Engine *>        engines;
 
@@ -211,7 +278,6 @@ namespace Avogadro {
     Vector3d               normalVector;
     Vector3d               center;
     double                 radius;
-    const Atom            *farthestAtom;
 
     //! number of unit cells in a, b, and c crystal directions
     unsigned char          aCells;
@@ -242,8 +308,11 @@ namespace Avogadro {
 
 #ifdef ENABLE_THREADED_GL
     QWaitCondition         paintCondition;
-    QMutex                 renderMutex;
+    QMutex                 renderMutex; // Protects pendingFrame and frame
+    QMutex                 paintMutex;  // Held while a frame is drawn
 
+    QSharedPointer<GLFrame> pendingFrame; // Published, not yet drawn
+    QSharedPointer<GLFrame> frame;        // Drawn by the render thread
     GLThread              *thread;
 #else
     bool                   initialized;
@@ -273,8 +342,10 @@ namespace Avogadro {
     GLPainterDevice *pd;
   };
 
-  void GLWidgetPrivate::updateListQuick()
+  void GLWidgetPrivate::updateListQuick(const QList<Engine *> &engines,
+                                        bool &updateCache)
   {
+    // Called from GLWidget::render(), with the molecule locked for reading
     // Create a display list cache
     if (updateCache) {
 //      qDebug() << "Making new quick display lists...";
@@ -287,14 +358,7 @@ namespace Avogadro {
 
       glNewList(dlistQuick, GL_COMPILE);
       foreach(Engine *engine, engines)
-      {
-        if(engine->isEnabled())
-        {
-          molecule->lock()->lockForRead();
-          engine->renderQuick(pd);
-          molecule->lock()->unlock();
-        }
-      }
+        engine->renderQuick(pd);
       glEndList();
 
       updateCache = false;
@@ -303,21 +367,91 @@ namespace Avogadro {
   }
 
 
+  void GLWidgetPrivate::enabledEngines(QList<Engine *> &opaque,
+                                       QList<Engine *> &transparent) const
+  {
+    foreach(Engine *engine, engines) {
+      if (engine->isEnabled()) {
+        opaque.append(engine);
+        if (engine->layers() & Engine::Transparent)
+          transparent.append(engine);
+      }
+    }
+  }
+
 #ifdef ENABLE_THREADED_GL
+  QSharedPointer<GLFrame> GLWidgetPrivate::captureFrame(const GLWidget *widget) const
+  {
+    QSharedPointer<GLFrame> next(new GLFrame);
+    next->camera = new Camera(camera);
+    next->selectedPrimitives = selectedPrimitives;
+    enabledEngines(next->engines, next->transparentEngines);
+    if (molecule) {
+      QList<Atom *> atoms = molecule->atoms();
+      unsigned long size = 0;
+      foreach(Atom *atom, atoms)
+        size = qMax(size, atom->id() + 1);
+      next->positions.resize(size, Vector3d::Zero());
+      foreach(Atom *atom, atoms)
+        next->positions[atom->id()] = *atom->pos();
+    }
+    next->background = background;
+    next->normalVector = normalVector;
+    next->center = center;
+    next->radius = radius;
+    next->fogLevel = fogLevel;
+    next->width = widget->width();
+    next->height = widget->height();
+    next->quickRender = quickRender;
+    next->updateCache = updateCache;
+    next->renderAxes = renderAxes;
+    return next;
+  }
+
+  void GLWidgetPrivate::publishFrame(const GLWidget *widget)
+  {
+    // As in GLWidget::render(), the frame is skipped rather than waiting for
+    // a writer, the molecule is updated again when it is done
+    if (molecule && !molecule->lock()->tryLockForRead())
+      return;
+    QSharedPointer<GLFrame> next = captureFrame(widget);
+    if (molecule)
+      molecule->lock()->unlock();
+    // The render thread now owns the request to rebuild the display lists
+    updateCache = false;
+
+    QMutexLocker locker(&renderMutex);
+    if (pendingFrame)
+      next->updateCache |= pendingFrame->updateCache;
+    pendingFrame = next;
+    paintCondition.wakeOne();
+  }
+
+  void GLWidgetPrivate::dropFrames()
+  {
+    QMutexLocker locker(&renderMutex);
+    pendingFrame.clear();
+    frame.clear();
+    // Any pending display list update was lost with the frames
+    updateCache = true;
+  }
+
+  /**
+   * Draws the frames published by GLWidgetPrivate::publishFrame(). The GL
+   * context is only made current in this thread while a frame is drawn, the
+   * GUI thread may use it (e.g. for picking) while holding the paintMutex.
+   */
   class GLThread : public QThread
   {
   public:
     GLThread( GLWidget *widget, QObject *parent );
 
     void run();
-    void resize( int width, int height );
     void stop();
 
   private:
     GLWidget *m_widget;
-    QGLContext *m_context;
     bool m_running;
-    bool m_resize;
     bool m_initialized;
 
     int m_width;
@@ -326,7 +460,8 @@ namespace Avogadro {
   };
 
   GLThread::GLThread( GLWidget *widget, QObject *parent ) : QThread( parent ),
-                                                            m_widget( widget ), m_running( true ), m_resize( false ), m_initialized( false )
+    m_widget( widget ), m_running( true ), m_initialized( false ),
+    m_width( -1 ), m_height( -1 )
   {}
 
   void GLThread::run()
@@ -334,15 +469,27 @@ namespace Avogadro {
     GLWidgetPrivate *d = m_widget->d;
 
     while ( true ) {
-      // lock the mutex
+      // Wait for the GUI thread to publish a frame
       d->renderMutex.lock();
-
-      // unlock and wait
-      d->paintCondition.wait( &( d->renderMutex ) );
+      while ( m_running && !d->pendingFrame )
+        d->paintCondition.wait( &( d->renderMutex ) );
       if ( !m_running ) {
         d->renderMutex.unlock();
         break;
       }
+      QSharedPointer<GLFrame> frame = d->pendingFrame;
+      d->pendingFrame.clear();
+      d->renderMutex.unlock();
+
+      QMutexLocker locker( &( d->paintMutex ) );
+      d->renderMutex.lock();
+      if ( d->frame ) {
+        // Display lists that were not rebuilt yet still need rebuilding
+        frame->updateCache |= d->frame->updateCache;
+      }
+      d->frame = frame;
+      d->renderMutex.unlock();
+
       m_widget->makeCurrent();
 
       if ( !m_initialized ) {
@@ -350,30 +497,25 @@ namespace Avogadro {
         m_initialized = true;
       }
 
-      if ( m_resize ) {
+      if ( frame->width != m_width || frame->height != m_height ) {
+        m_width = frame->width;
+        m_height = frame->height;
         m_widget->resizeGL( m_width, m_height );
-        m_resize=false;
       }
 
-      d->background.setAlphaF(0.0);
-      m_widget->qglClearColor(d->background);
+      m_widget->qglClearColor( frame->background );
       m_widget->paintGL();
       m_widget->swapBuffers();
       m_widget->doneCurrent();
-      d->renderMutex.unlock();
     }
   }
 
-  void GLThread::resize( int width, int height )
-  {
-    m_resize = true;
-    m_width = width;
-    m_height = height;
-  }
-
   void GLThread::stop()
   {
+    GLWidgetPrivate *d = m_widget->d;
+    QMutexLocker locker( &( d->renderMutex ) );
     m_running = false;
+    d->paintCondition.wakeAll();
   }
 #endif
 
@@ -401,18 +543,18 @@ namespace Avogadro {
 
   GLWidget::~GLWidget()
   {
-    if(!d->painter->isShared())
-      delete d->painter;
-    else
-      d->painter->decrementShare();
-
 #ifdef ENABLE_THREADED_GL
-    // cleanup our thread
+    // cleanup our thread before anything it draws with is deleted
     d->thread->stop();
-    d->paintCondition.wakeAll();
     d->thread->wait();
+    makeCurrent();
 #endif
 
+    if(!d->painter->isShared())
+      delete d->painter;
+    else
+      d->painter->decrementShare();
+
 #ifdef ENABLE_PYTHON
     // Creating the PythonThread object in Engine destructor doesn't seem
     // to work so we do it here
@@ -452,8 +594,10 @@ namespace Avogadro {
 
 #ifdef ENABLE_THREADED_GL
     qDebug() << "Threaded GL enabled.";
+    // The context must not be current in the GUI thread for the render
+    // thread to be able to use it
+    doneCurrent();
     d->thread = new GLThread( this, this );
-    //doneCurrent();
     d->thread->start();
 #endif
   }
@@ -472,7 +616,15 @@ namespace Avogadro {
 
   void GLWidget::renderNow()
   {
+#ifdef ENABLE_THREADED_GL
+    // Take the context from the render thread for the duration
+    QMutexLocker locker(&d->paintMutex);
+    makeCurrent();
+    paintGL();
+    doneCurrent();
+#else
     paintGL();
+#endif
   }
 
   void GLWidget::initializeGL()
@@ -560,12 +712,12 @@ namespace Avogadro {
     // setup the OpenGL projection matrix using the camera
     glMatrixMode( GL_PROJECTION );
     glLoadIdentity();
-    d->camera->applyProjection();
+    camera()->applyProjection();
 
     // setup the OpenGL modelview matrix using the camera
     glMatrixMode( GL_MODELVIEW );
     glLoadIdentity();
-    d->camera->applyModelview();
+    camera()->applyModelview();
 
     render();
   }
@@ -608,8 +760,8 @@ namespace Avogadro {
     if(updatesEnabled())
     {
 #ifdef ENABLE_THREADED_GL
-      // tell our thread to paint
-      d->paintCondition.wakeAll();
+      // hand the current view over to our thread to paint
+      d->publishFrame(this);
 #else
       makeCurrent();
       if(!d->initialized) {
@@ -626,7 +778,8 @@ namespace Avogadro {
   void GLWidget::resizeEvent( QResizeEvent *event )
   {
 #ifdef ENABLE_THREADED_GL
-    d->thread->resize( event->size().width(), event->size().height() );
+    // The new size is picked up by the render thread with the next frame
+    Q_UNUSED(event);
 #else
     if (!isValid())
       return;
@@ -650,14 +803,8 @@ namespace Avogadro {
 
   void GLWidget::setBackground( const QColor &background )
   {
-#ifdef ENABLE_THREADED_GL
-    d->renderMutex.lock();
-#endif
     d->background = background;
         d->background.setAlphaF(0.0);
-#ifdef ENABLE_THREADED_GL
-    d->renderMutex.unlock();
-#endif
   }
 
   QColor GLWidget::background() const
@@ -750,6 +897,35 @@ namespace Avogadro {
       return;
     }
 
+#ifdef ENABLE_THREADED_GL
+    QSharedPointer<GLFrame> frame;
+    // The render thread draws with the paintMutex held already, renders
+    // requested from the GUI thread (image export, the graphics view) keep
+    // it out while they use the context
+    QMutexLocker paintLocker(QThread::currentThread() == d->thread
+                             ? 0 : &d->paintMutex);
+    if (QThread::currentThread() == d->thread) {
+      // Draw the frame published by the GUI thread
+      QMutexLocker locker(&d->renderMutex);
+      frame = d->frame;
+    }
+    else {
+      // Renders from the GUI thread draw the current view state
+      frame = d->captureFrame(this);
+    }
+    if (!frame) {
+      d->molecule->lock()->unlock();
+      return;
+    }
+    GLFrame &state = *frame;
+    const QList<Engine *> &engines = state.engines;
+    const QList<Engine *> &transparentEngines = state.transparentEngines;
+#else
+    GLWidgetPrivate &state = *d;
+    QList<Engine *> engines, transparentEngines;
+    d->enabledEngines(engines, transparentEngines);
+#endif
+
     d->painter->begin(this);
 
     if (d->painter->quality() >= 3) {
@@ -760,17 +936,17 @@ namespace Avogadro {
     }
     bool hasUnitCell = (d->molecule->OBUnitCell() != NULL);
 
-    if (d->fogLevel) {
+    if (state.fogLevel) {
       glFogi(GL_FOG_MODE, GL_LINEAR);
-      GLfloat fogColor[4]= {static_cast<GLfloat>(d->background.redF()), static_cast<GLfloat>(d->background.greenF()),
-                            static_cast<GLfloat>(d->background.blueF()), static_cast<GLfloat>(d->background.alphaF())};
+      GLfloat fogColor[4]= {static_cast<GLfloat>(state.background.redF()), static_cast<GLfloat>(state.background.greenF()),
+                            static_cast<GLfloat>(state.background.blueF()), static_cast<GLfloat>(state.background.alphaF())};
       glFogfv(GL_FOG_COLOR, fogColor);
-      Vector3d distance = (camera()->modelview() * d->center.homogeneous()).head<3>();
+      Vector3d distance = (camera()->modelview() * state.center.homogeneous()).head<3>();
       double distanceToCenter = distance.norm();
       glFogf(GL_FOG_DENSITY, 1.0);
       glHint(GL_FOG_HINT, GL_NICEST);
-      glFogf(GL_FOG_START, distanceToCenter - (d->fogLevel / 8.0) * d->radius);
-      glFogf(GL_FOG_END, distanceToCenter + ((10-d->fogLevel)/8.0 * 2.0) * d->radius);
+      glFogf(GL_FOG_START, distanceToCenter - (state.fogLevel / 8.0) * state.radius);
+      glFogf(GL_FOG_END, distanceToCenter + ((10-state.fogLevel)/8.0 * 2.0) * state.radius);
       glEnable(GL_FOG);
     }
     else {
@@ -778,8 +954,8 @@ namespace Avogadro {
     }
 
     // Use renderQuick if the view is being moved, otherwise full render
-    if (d->quickRender) {
-      d->updateListQuick();
+    if (state.quickRender) {
+      d->updateListQuick(engines, state.updateCache);
       glCallList(d->dlistQuick);
       if (hasUnitCell) {
         renderCrystal(d->dlistQuick);
@@ -798,13 +974,12 @@ namespace Avogadro {
 
       // Opaque engine elements rendered first
       if (hasUnitCell) glNewList(d->dlistOpaque, GL_COMPILE);
-      foreach(Engine *engine, d->engines)
-        if(engine->isEnabled()) {
+      foreach(Engine *engine, engines) {
 #ifdef ENABLE_GLSL
-          if (m_glslEnabled) glUseProgramObjectARB(engine->shader());
+        if (m_glslEnabled) glUseProgramObjectARB(engine->shader());
 #endif
-          engine->renderOpaque(d->pd);
-        }
+        engine->renderOpaque(d->pd);
+      }
 #ifdef ENABLE_GLSL
           if (m_glslEnabled) glUseProgramObjectARB(0);
 #endif
@@ -838,13 +1013,11 @@ namespace Avogadro {
       glEnable(GL_BLEND);
       if (hasUnitCell)
         glNewList(d->dlistTransparent, GL_COMPILE);
-      foreach(Engine *engine, d->engines) {
-        if(engine->isEnabled() && engine->layers() & Engine::Transparent) {
+      foreach(Engine *engine, transparentEngines) {
 #ifdef ENABLE_GLSL
-          if (m_glslEnabled) glUseProgramObjectARB(engine->shader());
+        if (m_glslEnabled) glUseProgramObjectARB(engine->shader());
 #endif
-          engine->renderTransparent(d->pd);
-        }
+        engine->renderTransparent(d->pd);
       }
       glDisable(GL_BLEND);
 #ifdef ENABLE_GLSL
@@ -866,7 +1039,7 @@ namespace Avogadro {
     }
 
     // If enabled draw the axes
-    if (d->renderAxes) renderAxesOverlay();
+    if (state.renderAxes) renderAxesOverlay();
 
     // Render text overlay
     renderTextOverlay();
@@ -1836,14 +2009,8 @@ namespace Avogadro {
         d->undoStack->push( command );
       }
     }
-#ifdef ENABLE_THREADED_GL
-    d->renderMutex.lock();
-#endif
     // Stop using quickRender
     d->quickRender = false;
-#ifdef ENABLE_THREADED_GL
-    d->renderMutex.unlock();
-#endif
     // Render the scene at full quality now the mouse button has been released
     update();
     emit mouseRelease(event);
@@ -1854,15 +2021,9 @@ namespace Avogadro {
     // Set the event to ignored, check whether any tools accept it
     event->ignore();
 
-#ifdef ENABLE_THREADED_GL
-    d->renderMutex.lock();
-#endif
     // Use quick render while the mouse is down
     if (d->allowQuickRender)
       d->quickRender = true;
-#ifdef ENABLE_THREADED_GL
-    d->renderMutex.unlock();
-#endif
     if ( d->tool ) {
       QUndoCommand *command;
       command = d->tool->mouseMoveEvent( this, event );
@@ -1912,14 +2073,8 @@ namespace Avogadro {
         d->undoStack->push( command );
       }
     }
-#ifdef ENABLE_THREADED_GL
-    d->renderMutex.lock();
-#endif
     // Stop using quickRender
     d->quickRender = false;
-#ifdef ENABLE_THREADED_GL
-    d->renderMutex.unlock();
-#endif
     // Render the scene at full quality now the mouse button has been released
     update();
     emit mouseDoubleClick(event);
@@ -2030,22 +2185,38 @@ namespace Avogadro {
 
   const Vector3d & GLWidget::center() const
   {
+#ifdef ENABLE_THREADED_GL
+    if (QThread::currentThread() == d->thread && d->frame)
+      return d->frame->center;
+#endif
     return d->center;
   }
 
   const Vector3d & GLWidget::normalVector() const
   {
+#ifdef ENABLE_THREADED_GL
+    if (QThread::currentThread() == d->thread && d->frame)
+      return d->frame->normalVector;
+#endif
     return d->normalVector;
   }
 
   double GLWidget::radius() const
   {
+#ifdef ENABLE_THREADED_GL
+    if (QThread::currentThread() == d->thread && d->frame)
+      return d->frame->radius;
+#endif
     return d->radius;
   }
 
   const Atom *GLWidget::farthestAtom() const
   {
-    return d->farthestAtom;
+    // Finding the farthest atom can require a pass over all atoms, so it is
+    // looked up when needed rather than on every geometry update
+    if (d->molecule)
+      return d->molecule->farthestAtom();
+    return 0;
   }
 
   void GLWidget::updateGeometry()
@@ -2062,7 +2233,6 @@ namespace Avogadro {
     d->center = d->molecule->center();
     d->radius = d->molecule->radius();
     d->normalVector = d->molecule->normalVector();
-    d->farthestAtom = d->molecule->farthestAtom();
 
     // if any cell repeats are used, adjust the geometries
     if (d->molecule->OBUnitCell() &&
@@ -2105,6 +2275,11 @@ namespace Avogadro {
 
   Camera * GLWidget::camera() const
   {
+#ifdef ENABLE_THREADED_GL
+    // Engines drawing in the render thread see the camera of their frame
+    if (QThread::currentThread() == d->thread && d->frame)
+      return d->frame->camera;
+#endif
     return d->camera;
   }
 
@@ -2128,6 +2303,11 @@ namespace Avogadro {
 
   void GLWidget::removeEngine(Engine *engine)
   {
+#ifdef ENABLE_THREADED_GL
+    // Make sure no frame still refers to the engine once it is deleted
+    QMutexLocker locker(&d->paintMutex);
+    d->dropFrames();
+#endif
     disconnect(engine, 0, this, 0);
     disconnect(this, 0, engine, 0);
     d->engines.removeAll(engine);
@@ -2247,7 +2427,8 @@ namespace Avogadro {
     }
 
 #ifdef ENABLE_THREADED_GL
-    d->renderMutex.lock();
+    // Wait for the render thread to release the context
+    d->paintMutex.lock();
 #endif
     makeCurrent();
     //X   hits.clear();
@@ -2294,7 +2475,7 @@ namespace Avogadro {
 
 #ifdef ENABLE_THREADED_GL
     doneCurrent();
-    d->renderMutex.unlock();
+    d->paintMutex.unlock();
 #endif
 
     // if no error occurred and there are hits, process them
@@ -2477,8 +2658,23 @@ namespace Avogadro {
     d->updateCache = true;
   }
 
+  const Vector3d * GLWidget::atomPos(const Atom *atom) const
+  {
+#ifdef ENABLE_THREADED_GL
+    // Atoms added since the frame was published are drawn where they are
+    if (QThread::currentThread() == d->thread && d->frame
+        && atom->id() < d->frame->positions.size())
+      return &d->frame->positions[atom->id()];
+#endif
+    return atom->pos();
+  }
+
   bool GLWidget::isSelected( const Primitive *p ) const
   {
+#ifdef ENABLE_THREADED_GL
+    if (QThread::currentThread() == d->thread && d->frame)
+      return d->frame->selectedPrimitives.contains(const_cast<Primitive *>(p));
+#endif
     // Return true if the item is selected
     return d->selectedPrimitives.contains(const_cast<Primitive *>(p));
   }
@@ -2585,13 +2781,7 @@ namespace Avogadro {
 
   void GLWidget::setUnitCellColor(const QColor c)
   {
-#ifdef ENABLE_THREADED_GL
-    d->renderMutex.lock();
-#endif
     d->cellColor = c;
-#ifdef ENABLE_THREADED_GL
-    d->renderMutex.unlock();
-#endif
   }
 
   void GLWidget::setOnlyRenderOriginalUnitCell(bool b)
@@ -2799,10 +2989,17 @@ namespace Avogadro {
     }
     settings.endArray();
 
+#ifdef ENABLE_THREADED_GL
+    d->paintMutex.lock();
+    d->dropFrames();
+#endif
     // delete engines
     foreach(Engine *engine, d->engines) {
       delete engine;
     }
+#ifdef ENABLE_THREADED_GL
+    d->paintMutex.unlock();
+#endif
 
     // clear the engine list
     d->engines.clear();
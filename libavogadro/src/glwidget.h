@@ -265,6 +265,12 @@ namespace Avogadro {
        * @return the Atom farthest away from the camera.
        */
       const Atom *farthestAtom() const;
+      /**
+       * @return the position of @p atom to draw. Engines drawing in the
+       * render thread see the position the atom had when their frame was
+       * published.
+       */
+      const Eigen::Vector3d * atomPos(const Atom *atom) const;
 
       /**
        * @param quality set the global quality of the widget.
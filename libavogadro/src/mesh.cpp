@@ -35,7 +35,8 @@ namespace Avogadro {
 
   Mesh::Mesh(QObject *parent) : Primitive(MeshType, parent), m_vertices(0),
     m_normals(0), m_colors(0), m_stable(true), m_other(FALSE_ID), m_cube(0),
-    m_lock(new QReadWriteLock)
+    m_lock(new QReadWriteLock), m_revision(0), m_center(0.0, 0.0, 0.0),
+    m_radius(0.0)
   {
     m_vertices.reserve(100);
     m_normals.reserve(100);
@@ -44,6 +45,9 @@ namespace Avogadro {
 
   Mesh::~Mesh()
   {
+    for (unsigned int i = 0; i < m_levels.size(); ++i)
+      delete m_levels[i];
+    m_levels.clear();
     delete m_lock;
     m_lock = 0;
   }
@@ -84,6 +88,7 @@ namespace Avogadro {
   bool Mesh::setVertices(const vector<Vector3f> &values)
   {
     QWriteLocker lock(m_lock);
+    invalidateLevels();
     m_vertices.clear();
     m_vertices = values;
     return true;
@@ -92,6 +97,7 @@ namespace Avogadro {
   bool Mesh::addVertices(const vector<Vector3f> &values)
   {
     QWriteLocker lock(m_lock);
+    invalidateLevels();
     if (m_vertices.capacity() < m_vertices.size() + values.size()) {
       m_vertices.reserve(m_vertices.capacity()*2);
     }
@@ -122,6 +128,7 @@ namespace Avogadro {
   bool Mesh::setNormals(const vector<Vector3f> &values)
   {
     QWriteLocker lock(m_lock);
+    invalidateLevels();
     m_normals.clear();
     m_normals = values;
     return true;
@@ -130,6 +137,7 @@ namespace Avogadro {
   bool Mesh::addNormals(const vector<Vector3f> &values)
   {
     QWriteLocker lock(m_lock);
+    invalidateLevels();
     if (m_normals.capacity() < m_normals.size() + values.size()) {
       m_normals.reserve(m_normals.capacity()*2);
     }
@@ -166,6 +174,7 @@ namespace Avogadro {
   bool Mesh::setColors(const vector<Color3f> &values)
   {
     QWriteLocker lock(m_lock);
+    invalidateLevels();
     m_colors.clear();
     m_colors = values;
     return true;
@@ -174,6 +183,7 @@ namespace Avogadro {
   bool Mesh::addColors(const vector<Color3f> &values)
   {
     QWriteLocker lock(m_lock);
+    invalidateLevels();
     if (m_colors.capacity() < m_colors.size() + values.size()) {
       m_colors.reserve(m_colors.capacity()*2);
     }
@@ -208,6 +218,7 @@ namespace Avogadro {
   bool Mesh::clear()
   {
     QWriteLocker lock(m_lock);
+    invalidateLevels();
     m_vertices.clear();
     m_normals.clear();
     m_colors.clear();
@@ -218,8 +229,9 @@ namespace Avogadro {
   {
     QWriteLocker lock(m_lock);
     QReadLocker oLock(other.m_lock);
+    invalidateLevels();
     m_vertices = other.m_vertices;
-    m_normals = other.m_vertices;
+    m_normals = other.m_normals;
     m_colors = other.m_colors;
     m_name = other.m_name;
     return *this;
@@ -230,4 +242,78 @@ namespace Avogadro {
     return m_lock;
   }
 
+  int Mesh::numLevels() const
+  {
+    QReadLocker lock(m_lock);
+    return m_levels.size() + 1;
+  }
+
+  const Mesh * Mesh::level(int n) const
+  {
+    QReadLocker lock(m_lock);
+    if (n == 0)
+      return this;
+    else if (n > 0 && n <= static_cast<int>(m_levels.size()))
+      return m_levels[n-1];
+    else
+      return 0;
+  }
+
+  const Mesh * Mesh::levelForTriangles(unsigned int triangles) const
+  {
+    QReadLocker lock(m_lock);
+    if (triangles == 0 || m_levels.empty() || m_vertices.size() <= 3*triangles)
+      return this;
+    for (unsigned int i = 0; i < m_levels.size(); ++i) {
+      if (m_levels[i]->numVertices() <= 3*triangles)
+        return m_levels[i];
+    }
+    return m_levels.back();
+  }
+
+  bool Mesh::setLevels(const vector<Mesh *> &levels, unsigned int revision)
+  {
+    QWriteLocker lock(m_lock);
+    if (revision != m_revision) {
+      for (unsigned int i = 0; i < levels.size(); ++i)
+        delete levels[i];
+      return false;
+    }
+
+    invalidateLevels();
+    m_levels = levels;
+    // The levels may have been built in a worker thread, the painters use
+    // them from the thread of the Mesh
+    for (unsigned int i = 0; i < m_levels.size(); ++i)
+      m_levels[i]->moveToThread(thread());
+
+    // Bounding sphere for choosing a level by the size on screen
+    if (m_vertices.size()) {
+      Vector3f min = m_vertices[0];
+      Vector3f max = m_vertices[0];
+      for (unsigned int i = 1; i < m_vertices.size(); ++i) {
+        min = min.cwiseMin(m_vertices[i]);
+        max = max.cwiseMax(m_vertices[i]);
+      }
+      m_center = 0.5 * (min + max);
+      m_radius = 0.5 * (max - min).norm();
+    }
+    return true;
+  }
+
+  unsigned int Mesh::revision() const
+  {
+    QReadLocker lock(m_lock);
+    return m_revision;
+  }
+
+  void Mesh::invalidateLevels()
+  {
+    ++m_revision;
+    // A painter may still be drawing one of the levels
+    for (unsigned int i = 0; i < m_levels.size(); ++i)
+      m_levels[i]->deleteLater();
+    m_levels.clear();
+  }
+
 } // End namespace
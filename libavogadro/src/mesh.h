@@ -226,6 +226,50 @@ namespace Avogadro {
      */
     QReadWriteLock *lock() const;
 
+    /**
+     * @return The number of levels of detail, including the Mesh itself as
+     * level 0. Levels are built by the MeshSimplifier.
+     */
+    int numLevels() const;
+
+    /**
+     * @return The level of detail @p n, level 0 is this Mesh and each
+     * further level has fewer triangles. Returns 0 if there is no such level.
+     */
+    const Mesh * level(int n) const;
+
+    /**
+     * @return The most detailed level with at most @p triangles triangles,
+     * or the coarsest level if they all have more. Returns this Mesh if
+     * @p triangles is 0.
+     */
+    const Mesh * levelForTriangles(unsigned int triangles) const;
+
+    /**
+     * Replace the simplified levels, ordered from the most detailed one. The
+     * Mesh takes ownership of the levels. The levels are deleted instead if
+     * the Mesh has changed since revision() returned @p revision.
+     * @return True if the levels were stored.
+     */
+    bool setLevels(const std::vector<Mesh *> &levels, unsigned int revision);
+
+    /**
+     * @return A counter that is increased every time the Mesh is changed.
+     */
+    unsigned int revision() const;
+
+    /**
+     * @return The center of the bounding sphere, only valid if there are
+     * levels of detail.
+     */
+    const Eigen::Vector3f & center() const { return m_center; }
+
+    /**
+     * @return The radius of the bounding sphere, only valid if there are
+     * levels of detail.
+     */
+    float radius() const { return m_radius; }
+
     friend class Molecule;
 
   protected:
@@ -238,6 +282,15 @@ namespace Avogadro {
     unsigned int m_other; // Unique id of the other mesh if this is part of a pair
     unsigned int m_cube; // Unique id of the cube this mesh was generated from
     QReadWriteLock *m_lock;
+    std::vector<Mesh *> m_levels; // Simplified levels, most detailed first
+    unsigned int m_revision;
+    Eigen::Vector3f m_center;
+    float m_radius;
+
+    /**
+     * Drop the levels of detail after a change, the write lock must be held.
+     */
+    void invalidateLevels();
     Q_DECLARE_PRIVATE(Mesh)
   };
 } // End namespace Avogadro
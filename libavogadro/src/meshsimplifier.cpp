@@ -0,0 +1,655 @@
+/**********************************************************************
+  MeshSimplifier - Levels of detail for triangle meshes
+
+  Copyright (C) 2013 Avogadro Developers
+
+  This file is part of the Avogadro molecular editor project.
+  For more information, see <http://avogadro.cc/>
+
+  Avogadro is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  Avogadro is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+  02110-1301, USA.
+ **********************************************************************/
+
+#include "meshsimplifier.h"
+#include "mesh.h"
+
+#include <Eigen/Geometry>
+#include <Eigen/LU>
+
+#include <QHash>
+#include <QDebug>
+
+#include <algorithm>
+#include <cmath>
+#include <iterator>
+#include <limits>
+
+using Eigen::Vector3d;
+using Eigen::Vector3f;
+using Eigen::Matrix3d;
+using std::vector;
+
+namespace Avogadro {
+
+  namespace {
+    // Vertices closer than this fraction of the size of the mesh are welded
+    const double weldTolerance = 1.0e-6;
+    // Normals and colors that differ by less than this are the same
+    const float attributeTolerance = 1.0e-3f;
+    // Weight of the planes that hold the border of an open mesh in place
+    const double borderWeight = 100.0;
+    // A triangle may not turn by more than about 80 degrees in a collapse
+    const double minimumNormalDot = 0.2;
+    // Give up when a level cannot get below this fraction of the previous one
+    const double minimumReduction = 0.75;
+    // Each level has this fraction of the triangles of the previous one
+    const unsigned int levelRatio = 4;
+
+    const double infinity = std::numeric_limits<double>::infinity();
+
+    inline qint64 cellKey(qint64 i, qint64 j, qint64 k)
+    {
+      return (i << 42) | (j << 21) | k;
+    }
+
+    inline qint64 edgeKey(int a, int b)
+    {
+      return a < b ? (qint64(a) << 32) | b : (qint64(b) << 32) | a;
+    }
+
+    inline Vector3d triangleNormal(const Vector3d &p0, const Vector3d &p1,
+                                   const Vector3d &p2)
+    {
+      return (p1 - p0).cross(p2 - p0);
+    }
+  }
+
+  void MeshSimplifier::Quadric::setPlane(const Vector3d &n, double d,
+                                         double weight)
+  {
+    q[0] = weight * n.x() * n.x();
+    q[1] = weight * n.x() * n.y();
+    q[2] = weight * n.x() * n.z();
+    q[3] = weight * n.x() * d;
+    q[4] = weight * n.y() * n.y();
+    q[5] = weight * n.y() * n.z();
+    q[6] = weight * n.y() * d;
+    q[7] = weight * n.z() * n.z();
+    q[8] = weight * n.z() * d;
+    q[9] = weight * d * d;
+  }
+
+  MeshSimplifier::Quadric & MeshSimplifier::Quadric::operator+=(const Quadric &other)
+  {
+    for (int i = 0; i < 10; ++i)
+      q[i] += other.q[i];
+    return *this;
+  }
+
+  double MeshSimplifier::Quadric::error(const Vector3d &v) const
+  {
+    const double x = v.x(), y = v.y(), z = v.z();
+    return q[0]*x*x + 2.0*q[1]*x*y + 2.0*q[2]*x*z + 2.0*q[3]*x
+         + q[4]*y*y + 2.0*q[5]*y*z + 2.0*q[6]*y
+         + q[7]*z*z + 2.0*q[8]*z
+         + q[9];
+  }
+
+  bool MeshSimplifier::Quadric::minimum(Vector3d &x) const
+  {
+    Matrix3d a;
+    a << q[0], q[1], q[2],
+         q[1], q[4], q[5],
+         q[2], q[5], q[7];
+    // The matrix is positive semi-definite, compare the determinant to the
+    // scale of the matrix to find flat and straight regions
+    const double scale = a.trace() / 3.0;
+    if (scale <= 0.0 || a.determinant() < 1.0e-6 * scale * scale * scale)
+      return false;
+    x = a.inverse() * -Vector3d(q[3], q[6], q[8]);
+    return true;
+  }
+
+  MeshSimplifier::MeshSimplifier(QObject *parent) : QThread(parent),
+    m_mesh(0), m_revision(0), m_minimumTriangles(1000), m_maximumLevels(4),
+    m_hasColors(false), m_singleColor(false), m_triangleCount(0)
+  {
+    connect(this, SIGNAL(finished()), this, SLOT(storeLevels()));
+  }
+
+  MeshSimplifier::MeshSimplifier(Mesh *mesh, QObject *parent) :
+    QThread(parent), m_mesh(0), m_revision(0), m_minimumTriangles(1000),
+    m_maximumLevels(4), m_hasColors(false), m_singleColor(false),
+    m_triangleCount(0)
+  {
+    connect(this, SIGNAL(finished()), this, SLOT(storeLevels()));
+    initialize(mesh);
+  }
+
+  MeshSimplifier::~MeshSimplifier()
+  {
+    wait();
+    for (unsigned int i = 0; i < m_levels.size(); ++i)
+      delete m_levels[i];
+  }
+
+  bool MeshSimplifier::initialize(Mesh *mesh)
+  {
+    m_mesh = mesh;
+    if (!m_mesh)
+      return false;
+
+    // Work on a copy, the levels are thrown away if the mesh changes and
+    // the mesh may be deleted while the thread runs
+    m_revision = m_mesh->revision();
+    m_meshVertices = m_mesh->vertices();
+    m_meshNormals = m_mesh->normals();
+    m_meshColors = m_mesh->colors();
+    return true;
+  }
+
+  void MeshSimplifier::run()
+  {
+    // Only touch the mesh here if run() was called directly, the thread
+    // hands the levels over in storeLevels()
+    const bool direct = QThread::currentThread() != this;
+    if (direct && !m_mesh) {
+      qDebug() << "MeshSimplifier: No mesh set...";
+      return;
+    }
+    const vector<Vector3f> &vertices = m_meshVertices;
+    const vector<Vector3f> &normals = m_meshNormals;
+    const vector<Color3f> &colors = m_meshColors;
+
+    vector<Mesh *> levels;
+    if (vertices.size() % 3 || vertices.size() != normals.size() ||
+        vertices.size() / 3 < levelRatio * m_minimumTriangles) {
+      if (direct)
+        m_mesh->setLevels(levels, m_revision);
+      else
+        m_levels = levels;
+      return;
+    }
+
+    weld(vertices, normals, colors);
+
+    unsigned int previous = m_triangleCount;
+    for (int i = 0; i < m_maximumLevels; ++i) {
+      const unsigned int target = previous / levelRatio;
+      if (target < m_minimumTriangles)
+        break;
+      const unsigned int left = simplify(target);
+      if (left > minimumReduction * previous)
+        break;
+      levels.push_back(level());
+      emit progressValueChanged(levels.size());
+      previous = left;
+    }
+
+    clear();
+    m_meshVertices.clear();
+    m_meshNormals.clear();
+    m_meshColors.clear();
+    if (direct) {
+      m_mesh->setLevels(levels, m_revision);
+    }
+    else {
+      // Objects can only be pushed to another thread from their own
+      for (unsigned int i = 0; i < levels.size(); ++i)
+        levels[i]->moveToThread(thread());
+      m_levels = levels;
+    }
+  }
+
+  void MeshSimplifier::storeLevels()
+  {
+    // Runs in the thread of the simplifier after the thread finished, the
+    // Mesh is deleted from the same thread so the pointer is reliable here
+    if (m_mesh) {
+      m_mesh->setLevels(m_levels, m_revision);
+    }
+    else {
+      for (unsigned int i = 0; i < m_levels.size(); ++i)
+        delete m_levels[i];
+    }
+    m_levels.clear();
+  }
+
+  void MeshSimplifier::weld(const vector<Vector3f> &vertices,
+                            const vector<Vector3f> &normals,
+                            const vector<Color3f> &colors)
+  {
+    clear();
+    m_hasColors = colors.size() == vertices.size();
+    m_singleColor = colors.size() == 1;
+    if (m_singleColor)
+      m_color = colors[0];
+
+    Vector3f min = vertices[0];
+    Vector3f max = vertices[0];
+    for (unsigned int i = 1; i < vertices.size(); ++i) {
+      min = min.cwiseMin(vertices[i]);
+      max = max.cwiseMax(vertices[i]);
+    }
+    const double tolerance = qMax(weldTolerance * (max - min).norm(),
+                                  static_cast<double>(std::numeric_limits<float>::min()));
+    const double cellSize = 2.0 * tolerance;
+
+    // Spatial hash of the welded vertices, the cells are larger than the
+    // tolerance so only the neighboring cells need to be searched
+    QMultiHash<qint64, int> cells;
+    cells.reserve(vertices.size() / 3);
+    vector<int> corners(vertices.size());
+    for (unsigned int i = 0; i < vertices.size(); ++i) {
+      const Vector3d p = vertices[i].cast<double>();
+      const qint64 ci = static_cast<qint64>((p.x() - min.x()) / cellSize);
+      const qint64 cj = static_cast<qint64>((p.y() - min.y()) / cellSize);
+      const qint64 ck = static_cast<qint64>((p.z() - min.z()) / cellSize);
+
+      int match = -1;
+      for (qint64 di = -1; di <= 1 && match < 0; ++di) {
+        for (qint64 dj = -1; dj <= 1 && match < 0; ++dj) {
+          for (qint64 dk = -1; dk <= 1 && match < 0; ++dk) {
+            QMultiHash<qint64, int>::const_iterator it =
+              cells.constFind(cellKey(ci + di, cj + dj, ck + dk));
+            for (; it != cells.constEnd() && it.key() == cellKey(ci + di, cj + dj, ck + dk); ++it) {
+              const int v = it.value();
+              if ((m_positions[v] - p).squaredNorm() > tolerance * tolerance)
+                continue;
+              bool same = (m_normals[v] - normals[i]).squaredNorm()
+                          < attributeTolerance * attributeTolerance;
+              if (same && m_hasColors) {
+                same = qAbs(m_colors[v].red() - colors[i].red()) < attributeTolerance
+                  && qAbs(m_colors[v].green() - colors[i].green()) < attributeTolerance
+                  && qAbs(m_colors[v].blue() - colors[i].blue()) < attributeTolerance;
+              }
+              if (same) {
+                match = v;
+                break;
+              }
+              // Same position but another normal or color, both sides of
+              // the seam stay where they are so that no gap opens
+              m_locked[v] = true;
+              match = -2;
+            }
+          }
+        }
+      }
+
+      if (match >= 0) {
+        corners[i] = match;
+        continue;
+      }
+      corners[i] = m_positions.size();
+      cells.insert(cellKey(ci, cj, ck), m_positions.size());
+      m_positions.push_back(p);
+      m_normals.push_back(normals[i]);
+      if (m_hasColors)
+        m_colors.push_back(colors[i]);
+      m_locked.push_back(match == -2);
+    }
+
+    const unsigned int n = m_positions.size();
+    m_removed.assign(n, false);
+    m_versions.assign(n, 0);
+    m_vertexTriangles.resize(n);
+    Quadric zero;
+    for (int i = 0; i < 10; ++i)
+      zero.q[i] = 0.0;
+    m_quadrics.assign(n, zero);
+
+    // Triangles and their planes, weighted by the area
+    QHash<qint64, int> edges;
+    for (unsigned int i = 0; i < corners.size(); i += 3) {
+      const int v[3] = { corners[i], corners[i+1], corners[i+2] };
+      if (v[0] == v[1] || v[1] == v[2] || v[0] == v[2])
+        continue;
+      const int triangle = m_triangles.size() / 3;
+      for (int j = 0; j < 3; ++j) {
+        m_triangles.push_back(v[j]);
+        m_vertexTriangles[v[j]].push_back(triangle);
+        ++edges[edgeKey(v[j], v[(j+1)%3])];
+      }
+
+      Vector3d normal = triangleNormal(m_positions[v[0]], m_positions[v[1]],
+                                       m_positions[v[2]]);
+      const double area = 0.5 * normal.norm();
+      if (area > 0.0) {
+        normal.normalize();
+        Quadric plane;
+        plane.setPlane(normal, -normal.dot(m_positions[v[0]]), area);
+        for (int j = 0; j < 3; ++j)
+          m_quadrics[v[j]] += plane;
+      }
+    }
+    m_triangleCount = m_triangles.size() / 3;
+    m_removedTriangles.assign(m_triangleCount, false);
+
+    // Edges of only one triangle are on the border, a plane through the
+    // edge perpendicular to the triangle keeps it in place. Edges of more
+    // than two triangles are not manifold and are not touched.
+    for (unsigned int t = 0; t < m_triangleCount; ++t) {
+      const int *v = &m_triangles[3*t];
+      const Vector3d normal = triangleNormal(m_positions[v[0]], m_positions[v[1]],
+                                             m_positions[v[2]]);
+      for (int j = 0; j < 3; ++j) {
+        const int a = v[j];
+        const int b = v[(j+1)%3];
+        const int count = edges.value(edgeKey(a, b));
+        if (count > 2) {
+          m_locked[a] = m_locked[b] = true;
+        }
+        else if (count == 1) {
+          const Vector3d edge = m_positions[b] - m_positions[a];
+          Vector3d border = edge.cross(normal);
+          if (border.squaredNorm() == 0.0)
+            continue;
+          border.normalize();
+          Quadric plane;
+          plane.setPlane(border, -border.dot(m_positions[a]),
+                         borderWeight * edge.squaredNorm());
+          m_quadrics[a] += plane;
+          m_quadrics[b] += plane;
+        }
+      }
+    }
+
+    m_heap.reserve(edges.size());
+    for (QHash<qint64, int>::const_iterator it = edges.constBegin();
+         it != edges.constEnd(); ++it) {
+      pushEdge(static_cast<int>(it.key() >> 32),
+               static_cast<int>(it.key() & 0xffffffff));
+    }
+  }
+
+  double MeshSimplifier::collapseCost(int a, int b, Vector3d &position,
+                                      double &t) const
+  {
+    if (m_removed[a] || m_removed[b] || (m_locked[a] && m_locked[b]))
+      return infinity;
+
+    Quadric q = m_quadrics[a];
+    q += m_quadrics[b];
+
+    const Vector3d &pa = m_positions[a];
+    const Vector3d &pb = m_positions[b];
+    const Vector3d edge = pb - pa;
+    const double length2 = edge.squaredNorm();
+
+    if (m_locked[a]) {
+      position = pa;
+      t = 0.0;
+    }
+    else if (m_locked[b]) {
+      position = pb;
+      t = 1.0;
+    }
+    else {
+      // The optimal position, as long as it stays close to the edge,
+      // otherwise the best of the ends and the middle of the edge
+      Vector3d optimal;
+      if (q.minimum(optimal) && length2 > 0.0) {
+        t = qBound(0.0, (optimal - pa).dot(edge) / length2, 1.0);
+        if ((optimal - (pa + t * edge)).squaredNorm() <= length2) {
+          position = optimal;
+          return qMax(0.0, q.error(position));
+        }
+      }
+      const double ends[3] = { 0.0, 0.5, 1.0 };
+      double best = infinity;
+      for (int i = 0; i < 3; ++i) {
+        const Vector3d p = pa + ends[i] * edge;
+        const double error = q.error(p);
+        if (error < best) {
+          best = error;
+          position = p;
+          t = ends[i];
+        }
+      }
+      return qMax(0.0, best);
+    }
+    return qMax(0.0, q.error(position));
+  }
+
+  bool MeshSimplifier::collapseValid(int a, int b, const Vector3d &position) const
+  {
+    // Link condition: the only vertices next to both ends of the edge are
+    // the tips of the triangles on the edge
+    vector<int> neighborsA, neighborsB;
+    int shared = 0;
+    for (unsigned int i = 0; i < m_vertexTriangles[a].size(); ++i) {
+      const int *v = &m_triangles[3*m_vertexTriangles[a][i]];
+      bool hasB = false;
+      for (int j = 0; j < 3; ++j) {
+        if (v[j] == b)
+          hasB = true;
+        else if (v[j] != a)
+          neighborsA.push_back(v[j]);
+      }
+      if (hasB)
+        ++shared;
+    }
+    for (unsigned int i = 0; i < m_vertexTriangles[b].size(); ++i) {
+      const int *v = &m_triangles[3*m_vertexTriangles[b][i]];
+      for (int j = 0; j < 3; ++j) {
+        if (v[j] != a && v[j] != b)
+          neighborsB.push_back(v[j]);
+      }
+    }
+    std::sort(neighborsA.begin(), neighborsA.end());
+    neighborsA.erase(std::unique(neighborsA.begin(), neighborsA.end()), neighborsA.end());
+    std::sort(neighborsB.begin(), neighborsB.end());
+    neighborsB.erase(std::unique(neighborsB.begin(), neighborsB.end()), neighborsB.end());
+    vector<int> common;
+    std::set_intersection(neighborsA.begin(), neighborsA.end(),
+                          neighborsB.begin(), neighborsB.end(),
+                          std::back_inserter(common));
+    if (shared == 0 || static_cast<int>(common.size()) != shared)
+      return false;
+
+    // The triangles that stay must not flip or collapse to a line, and must
+    // not end up on top of another triangle
+    const int ends[2] = { a, b };
+    for (int e = 0; e < 2; ++e) {
+      const int moved = ends[e];
+      const int other = ends[1-e];
+      for (unsigned int i = 0; i < m_vertexTriangles[moved].size(); ++i) {
+        const int *v = &m_triangles[3*m_vertexTriangles[moved][i]];
+        if (v[0] == other || v[1] == other || v[2] == other)
+          continue;
+
+        Vector3d before[3], after[3];
+        int rest[2], k = 0;
+        for (int j = 0; j < 3; ++j) {
+          before[j] = m_positions[v[j]];
+          after[j] = v[j] == moved ? position : before[j];
+          if (v[j] != moved)
+            rest[k++] = v[j];
+        }
+        const Vector3d n0 = triangleNormal(before[0], before[1], before[2]);
+        const Vector3d n1 = triangleNormal(after[0], after[1], after[2]);
+        if (n0.dot(n1) <= minimumNormalDot * n0.norm() * n1.norm())
+          return false;
+
+        for (unsigned int l = 0; l < m_vertexTriangles[other].size(); ++l) {
+          const int *w = &m_triangles[3*m_vertexTriangles[other][l]];
+          int found = 0;
+          for (int j = 0; j < 3; ++j) {
+            if (w[j] == rest[0] || w[j] == rest[1])
+              ++found;
+          }
+          if (found == 2)
+            return false;
+        }
+      }
+    }
+    return true;
+  }
+
+  void MeshSimplifier::collapse(int a, int b, const Vector3d &position,
+                                double t)
+  {
+    m_positions[a] = position;
+    const float s = static_cast<float>(t);
+    Vector3f normal = (1.0f - s) * m_normals[a] + s * m_normals[b];
+    if (normal.squaredNorm() > 0.0f)
+      m_normals[a] = normal.normalized();
+    if (m_hasColors) {
+      const Color3f &ca = m_colors[a];
+      const Color3f &cb = m_colors[b];
+      m_colors[a].set((1.0f - s) * ca.red() + s * cb.red(),
+                      (1.0f - s) * ca.green() + s * cb.green(),
+                      (1.0f - s) * ca.blue() + s * cb.blue());
+    }
+    m_quadrics[a] += m_quadrics[b];
+    if (m_locked[b])
+      m_locked[a] = true;
+
+    // The triangles on the edge go, the others of b move over to a
+    for (unsigned int i = 0; i < m_vertexTriangles[b].size(); ++i) {
+      const int triangle = m_vertexTriangles[b][i];
+      int *v = &m_triangles[3*triangle];
+      if (v[0] == a || v[1] == a || v[2] == a) {
+        m_removedTriangles[triangle] = true;
+        --m_triangleCount;
+        continue;
+      }
+      for (int j = 0; j < 3; ++j) {
+        if (v[j] == b)
+          v[j] = a;
+      }
+      m_vertexTriangles[a].push_back(triangle);
+    }
+    m_removed[b] = true;
+    m_vertexTriangles[b].clear();
+    ++m_versions[a];
+
+    // Drop the removed triangles from the lists of the vertices around a
+    vector<int> neighbors;
+    vector<int> &triangles = m_vertexTriangles[a];
+    unsigned int kept = 0;
+    for (unsigned int i = 0; i < triangles.size(); ++i) {
+      if (m_removedTriangles[triangles[i]])
+        continue;
+      triangles[kept++] = triangles[i];
+      const int *v = &m_triangles[3*triangles[i]];
+      for (int j = 0; j < 3; ++j) {
+        if (v[j] != a)
+          neighbors.push_back(v[j]);
+      }
+    }
+    triangles.resize(kept);
+    std::sort(neighbors.begin(), neighbors.end());
+    neighbors.erase(std::unique(neighbors.begin(), neighbors.end()), neighbors.end());
+
+    for (unsigned int i = 0; i < neighbors.size(); ++i) {
+      vector<int> &other = m_vertexTriangles[neighbors[i]];
+      unsigned int k = 0;
+      for (unsigned int j = 0; j < other.size(); ++j) {
+        if (!m_removedTriangles[other[j]])
+          other[k++] = other[j];
+      }
+      other.resize(k);
+      pushEdge(a, neighbors[i]);
+    }
+  }
+
+  void MeshSimplifier::pushEdge(int a, int b)
+  {
+    Vector3d position;
+    double t;
+    const double cost = collapseCost(a, b, position, t);
+    if (cost == infinity)
+      return;
+    Edge edge;
+    edge.cost = cost;
+    edge.a = a;
+    edge.b = b;
+    edge.versionA = m_versions[a];
+    edge.versionB = m_versions[b];
+    m_heap.push_back(edge);
+    std::push_heap(m_heap.begin(), m_heap.end());
+  }
+
+  unsigned int MeshSimplifier::simplify(unsigned int triangles)
+  {
+    // Entries are not updated in the heap, entries of vertices that changed
+    // since they were pushed are skipped
+    while (m_triangleCount > triangles && !m_heap.empty()) {
+      std::pop_heap(m_heap.begin(), m_heap.end());
+      const Edge edge = m_heap.back();
+      m_heap.pop_back();
+      if (m_removed[edge.a] || m_removed[edge.b] ||
+          edge.versionA != m_versions[edge.a] ||
+          edge.versionB != m_versions[edge.b])
+        continue;
+
+      Vector3d position;
+      double t;
+      if (collapseCost(edge.a, edge.b, position, t) == infinity ||
+          !collapseValid(edge.a, edge.b, position))
+        continue;
+      collapse(edge.a, edge.b, position, t);
+    }
+    return m_triangleCount;
+  }
+
+  Mesh * MeshSimplifier::level() const
+  {
+    vector<Vector3f> vertices, normals;
+    vector<Color3f> colors;
+    vertices.reserve(3 * m_triangleCount);
+    normals.reserve(3 * m_triangleCount);
+    if (m_hasColors)
+      colors.reserve(3 * m_triangleCount);
+    else if (m_singleColor)
+      colors.push_back(m_color);
+
+    for (unsigned int i = 0; i < m_removedTriangles.size(); ++i) {
+      if (m_removedTriangles[i])
+        continue;
+      for (int j = 0; j < 3; ++j) {
+        const int v = m_triangles[3*i+j];
+        vertices.push_back(m_positions[v].cast<float>());
+        normals.push_back(m_normals[v]);
+        if (m_hasColors)
+          colors.push_back(m_colors[v]);
+      }
+    }
+
+    Mesh *mesh = new Mesh;
+    mesh->setVertices(vertices);
+    mesh->setNormals(normals);
+    mesh->setColors(colors);
+    return mesh;
+  }
+
+  void MeshSimplifier::clear()
+  {
+    m_positions.clear();
+    m_normals.clear();
+    m_colors.clear();
+    m_quadrics.clear();
+    m_versions.clear();
+    m_locked.clear();
+    m_removed.clear();
+    m_vertexTriangles.clear();
+    m_triangles.clear();
+    m_removedTriangles.clear();
+    m_heap.clear();
+    m_triangleCount = 0;
+  }
+
+} // End namespace Avogadro
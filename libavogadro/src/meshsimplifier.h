@@ -0,0 +1,229 @@
+/**********************************************************************
+  MeshSimplifier - Levels of detail for triangle meshes
+
+  Copyright (C) 2013 Avogadro Developers
+
+  This file is part of the Avogadro molecular editor project.
+  For more information, see <http://avogadro.cc/>
+
+  Avogadro is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  Avogadro is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+  02110-1301, USA.
+ **********************************************************************/
+
+#ifndef MESHSIMPLIFIER_H
+#define MESHSIMPLIFIER_H
+
+#include "config.h"
+
+#include <avogadro/global.h>
+#include <avogadro/color3f.h>
+
+#include <Eigen/Core>
+
+#include <QPointer>
+#include <QThread>
+
+#include <vector>
+
+namespace Avogadro {
+
+  class Mesh;
+
+  /**
+   * @class MeshSimplifier meshsimplifier.h <avogadro/meshsimplifier.h>
+   * @brief Builds the levels of detail of a Mesh.
+   *
+   * Meshes are stored as triangle soups, every vertex of every triangle is
+   * stored on its own. The simplifier first welds the copies of each vertex
+   * that have the same position, normal and color, and then removes edges
+   * one at a time, always the edge whose removal moves the surface the
+   * least as measured by the quadric error metric of Garland and Heckbert.
+   * The normal and color of the merged vertex are interpolated along the
+   * removed edge. Edges on the border of an open mesh are kept in place by
+   * penalty planes, and vertices on a seam between two colors or normals
+   * do not move.
+   *
+   * Each level has about a quarter of the triangles of the previous one,
+   * down to minimumTriangles(). The levels are stored in the Mesh, see
+   * Mesh::level(), and are dropped by the Mesh as soon as it is changed.
+   *
+   * Like the MeshGenerator the class can either be started as a thread or
+   * run() can be called directly from a thread that is already working on
+   * the Mesh. The geometry is copied by initialize(), so the Mesh is not
+   * touched while a started thread runs. The levels are stored in the
+   * Mesh once the thread finished, from the thread of the simplifier, and
+   * are dropped if the Mesh was deleted in the meantime.
+   */
+  class A_EXPORT MeshSimplifier : public QThread
+  {
+    Q_OBJECT
+  public:
+    /**
+     * Constructor.
+     */
+    explicit MeshSimplifier(QObject *parent = 0);
+
+    /**
+     * Constructor. Can be used to initialize the MeshSimplifier.
+     * @param mesh The Mesh to build the levels of detail of.
+     */
+    explicit MeshSimplifier(Mesh *mesh, QObject *parent = 0);
+
+    /**
+     * Destructor.
+     */
+    ~MeshSimplifier();
+
+    /**
+     * Initialization function, copies the geometry of the Mesh.
+     * @param mesh The Mesh to build the levels of detail of.
+     */
+    bool initialize(Mesh *mesh);
+
+    /**
+     * Build the levels of detail and store them in the Mesh. The levels
+     * are discarded if the Mesh was changed in the meantime. When started
+     * as a thread the levels are stored after finished() is emitted.
+     */
+    void run();
+
+    /**
+     * @return The Mesh being simplified by the class.
+     */
+    Mesh * mesh() const { return m_mesh; }
+
+    /**
+     * The smallest number of triangles of a level, 1000 by default. Meshes
+     * that are not much larger get no levels at all.
+     */
+    void setMinimumTriangles(unsigned int triangles) { m_minimumTriangles = triangles; }
+    unsigned int minimumTriangles() const { return m_minimumTriangles; }
+
+    /**
+     * The largest number of levels, not counting the Mesh itself. The
+     * default is 4.
+     */
+    void setMaximumLevels(int levels) { m_maximumLevels = levels; }
+    int maximumLevels() const { return m_maximumLevels; }
+
+  signals:
+    /**
+     * Emitted after each level with the number of levels done.
+     */
+    void progressValueChanged(int);
+
+  private slots:
+    /**
+     * Hand the levels built by the thread to the Mesh if it still exists.
+     */
+    void storeLevels();
+
+  protected:
+    /**
+     * Weld the triangle soup into shared vertices and set up the quadrics.
+     */
+    void weld(const std::vector<Eigen::Vector3f> &vertices,
+              const std::vector<Eigen::Vector3f> &normals,
+              const std::vector<Color3f> &colors);
+
+    /**
+     * Collapse edges until at most @p triangles triangles are left.
+     * @return The number of triangles left.
+     */
+    unsigned int simplify(unsigned int triangles);
+
+    /**
+     * @return A new Mesh holding the current state as a triangle soup.
+     */
+    Mesh * level() const;
+
+    /**
+     * @return The error of collapsing the edge from @p a to @p b and the
+     * position of the merged vertex along the edge in @p t, where 0 is @p a.
+     * Infinite if the edge cannot be collapsed.
+     */
+    double collapseCost(int a, int b, Eigen::Vector3d &position, double &t) const;
+
+    /**
+     * @return True if moving the triangles around @p a and @p b to
+     * @p position keeps the mesh manifold and does not flip any triangle.
+     */
+    bool collapseValid(int a, int b, const Eigen::Vector3d &position) const;
+
+    /**
+     * Merge vertex @p b into @p a at @p position and update the heap.
+     */
+    void collapse(int a, int b, const Eigen::Vector3d &position, double t);
+
+    void pushEdge(int a, int b);
+
+    void clear();
+
+    /**
+     * Symmetric 4x4 matrix, the sum of the squared distances to a set of
+     * planes is (x, 1)^T Q (x, 1).
+     */
+    struct Quadric
+    {
+      double q[10]; // xx, xy, xz, xw, yy, yz, yw, zz, zw, ww
+      void setPlane(const Eigen::Vector3d &normal, double d, double weight);
+      Quadric & operator+=(const Quadric &other);
+      double error(const Eigen::Vector3d &x) const;
+      /**
+       * @return False if the minimum is not well defined.
+       */
+      bool minimum(Eigen::Vector3d &x) const;
+    };
+
+    struct Edge
+    {
+      double cost;
+      int a, b;
+      unsigned int versionA, versionB;
+      bool operator<(const Edge &other) const { return cost > other.cost; }
+    };
+
+    QPointer<Mesh> m_mesh;
+    // Copy of the Mesh taken by initialize()
+    unsigned int m_revision;
+    std::vector<Eigen::Vector3f> m_meshVertices;
+    std::vector<Eigen::Vector3f> m_meshNormals;
+    std::vector<Color3f> m_meshColors;
+    // Levels built by the thread, waiting for storeLevels()
+    std::vector<Mesh *> m_levels;
+
+    unsigned int m_minimumTriangles;
+    int m_maximumLevels;
+    bool m_hasColors;   // one color per vertex
+    bool m_singleColor; // one color for the whole mesh
+    Color3f m_color;
+
+    std::vector<Eigen::Vector3d> m_positions;
+    std::vector<Eigen::Vector3f> m_normals;
+    std::vector<Color3f> m_colors;
+    std::vector<Quadric> m_quadrics;
+    std::vector<unsigned int> m_versions;
+    std::vector<bool> m_locked;
+    std::vector<bool> m_removed;
+    std::vector<std::vector<int> > m_vertexTriangles;
+    std::vector<int> m_triangles;  // three vertex indices per triangle
+    std::vector<bool> m_removedTriangles;
+    std::vector<Edge> m_heap;
+    unsigned int m_triangleCount;
+  };
+
+} // End namespace Avogadro
+
+#endif
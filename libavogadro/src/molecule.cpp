@@ -32,12 +32,15 @@
 #include "cube.h"
 #include "fragment.h"
 #include "mesh.h"
+#include "moleculesnapshot.h"
+#include "obmolsnapshot.h"
+#include "obmolsnapshot_p.h"
 #include "obeigenconv.h"
 #include "primitivelist.h"
 #include "residue.h"
 #include "zmatrix.h"
-#include "leastsquares.h"
 
+#include <Eigen/Eigenvalues>
 #include <Eigen/Geometry>
 
 #include <vector>
@@ -52,6 +55,9 @@
 
 #include <QtCore/QDir>
 #include <QtCore/QDebug>
+#include <QtCore/QMap>
+#include <QtCore/QMutex>
+#include <QtCore/QMutexLocker>
 #include <QtCore/QVariant>
 #include <QtCore/QVector>
 
@@ -60,22 +66,193 @@ namespace Avogadro{
   using std::vector;
   using Eigen::Vector3d;
 
+  /**
+   * One named column of per atom data, only the values of its type are used.
+   */
+  struct AtomAttribute
+  {
+    AtomAttribute() : type(Molecule::NoAttribute) {}
+
+    int size() const
+    {
+      switch (type) {
+      case Molecule::FloatAttribute:
+        return static_cast<int>(floats.size());
+      case Molecule::IntAttribute:
+        return static_cast<int>(ints.size());
+      case Molecule::StringAttribute:
+        return strings.size();
+      default:
+        return 0;
+      }
+    }
+
+    /// Append the default value for a new atom
+    void append()
+    {
+      switch (type) {
+      case Molecule::FloatAttribute:
+        floats.push_back(0.0);
+        break;
+      case Molecule::IntAttribute:
+        ints.push_back(0);
+        break;
+      case Molecule::StringAttribute:
+        strings.append(QString());
+        break;
+      default:
+        break;
+      }
+    }
+
+    /// Append the value of atom @a index of @a other, of the same type
+    void append(const AtomAttribute &other, int index)
+    {
+      if (other.type != type || index >= other.size()) {
+        append();
+        return;
+      }
+      switch (type) {
+      case Molecule::FloatAttribute:
+        floats.push_back(other.floats[index]);
+        break;
+      case Molecule::IntAttribute:
+        ints.push_back(other.ints[index]);
+        break;
+      case Molecule::StringAttribute:
+        strings.append(other.strings.at(index));
+        break;
+      default:
+        break;
+      }
+    }
+
+    void removeAt(int index)
+    {
+      if (index >= size())
+        return;
+      switch (type) {
+      case Molecule::FloatAttribute:
+        floats.erase(floats.begin() + index);
+        break;
+      case Molecule::IntAttribute:
+        ints.erase(ints.begin() + index);
+        break;
+      case Molecule::StringAttribute:
+        strings.removeAt(index);
+        break;
+      default:
+        break;
+      }
+    }
+
+    Molecule::AttributeType type;
+    std::vector<double> floats;
+    std::vector<int> ints;
+    QStringList strings;
+  };
+
   class MoleculePrivate {
     public:
-      MoleculePrivate() : farthestAtom(0), invalidGeomInfo(true),
+      MoleculePrivate() : radius(1.0), farthestAtom(0),
+                          boundRadius(0.0), geomUpdates(0),
+                          invalidGeomInfo(true), invalidNormalVector(true),
+                          invalidFarthestAtom(true),
                           invalidRings(true), invalidGroupIndices(true),
                           obmol(0), obunitcell(0),
                           obvibdata(0), obdosdata(0),
-                          obelectronictransitiondata(0)
-    {}
+                          obelectronictransitiondata(0),
+                          version(1), dirtyBonds(true),
+                          attributeRevision(0)
+    {
+      center.setZero();
+      normalVector = Eigen::Vector3d::UnitZ();
+      origin.setZero();
+      posSum.setZero();
+      posSqSum.setZero();
+      boundCenter.setZero();
+      dipoleEstimate.setZero();
+    }
+
+      /**
+       * Update the running sums and bounding sphere for an atom moving from
+       * @a from to @a to, the atom is added if @a from is null and removed if
+       * @a to is null.
+       */
+      void moveAtomPos(const Atom *atom, const Eigen::Vector3d *from,
+                       const Eigen::Vector3d *to) const;
+
+      /**
+       * Flag the snapshot chunk holding the atom at @a index as changed.
+       */
+      void touchAtom(int index) const
+      {
+        ++version;
+        unsigned int chunk = index / MoleculeSnapshot::ChunkSize;
+        if (chunk < dirtyChunks.size())
+          dirtyChunks[chunk] = true;
+      }
+
+      /**
+       * Flag the atoms from @a index onwards as changed, e.g. as their
+       * indices shifted.
+       */
+      void touchAtomsFrom(int index) const
+      {
+        ++version;
+        unsigned int chunk = index / MoleculeSnapshot::ChunkSize;
+        for (; chunk < dirtyChunks.size(); ++chunk)
+          dirtyChunks[chunk] = true;
+      }
+
+      /**
+       * Flag the atoms with indices @a first to @a last as changed.
+       */
+      void touchAtoms(int first, int last) const
+      {
+        ++version;
+        unsigned int chunk = first / MoleculeSnapshot::ChunkSize;
+        const unsigned int end = last / MoleculeSnapshot::ChunkSize;
+        for (; chunk <= end && chunk < dirtyChunks.size(); ++chunk)
+          dirtyChunks[chunk] = true;
+      }
+
+      void touchBonds() const
+      {
+        ++version;
+        dirtyBonds = true;
+      }
+
+      /**
+       * Nothing from the previous snapshot can be reused.
+       */
+      void touchAll() const
+      {
+        ++version;
+        dirtyChunks.clear();
+        dirtyBonds = true;
+      }
+
     // These are logically cached variables and thus are marked as mutable.
     // Const objects should be logically constant (and not mutable)
     // http://www.highprogrammer.com/alan/rants/mutable.html
       mutable Eigen::Vector3d       center;
       mutable Eigen::Vector3d       normalVector;
       mutable double                radius;
-      mutable Atom *                farthestAtom;
+      mutable const Atom *          farthestAtom;
+      // First and second moments of the atom positions relative to origin,
+      // kept up to date as atoms are moved, added and removed.
+      mutable Eigen::Vector3d       origin;
+      mutable Eigen::Vector3d       posSum;
+      mutable Eigen::Matrix3d       posSqSum;
+      // Conservative bounding sphere, only grows between full refreshes
+      mutable Eigen::Vector3d       boundCenter;
+      mutable double                boundRadius;
+      mutable unsigned int          geomUpdates;
+      mutable Eigen::Vector3d       dipoleEstimate;
       mutable bool                  invalidGeomInfo;
+      mutable bool                  invalidNormalVector;
+      mutable bool                  invalidFarthestAtom;
       mutable bool                  invalidRings;
       mutable bool                  invalidGroupIndices;
       mutable std::vector<double>   energies;
@@ -98,6 +275,8 @@ namespace Avogadro{
       OpenBabel::OBMol *            obmol;
       // Our OpenBabel OBUnitCell object (if any)
       OpenBabel::OBUnitCell *       obunitcell;
+      // The unit cell of each conformer, if it changes
+      std::vector<Eigen::Matrix3d>  conformerCells;
       // Our OpenBabel OBVibrationData object (if any)
       // TODO: Cache an OBMol, in which case the vib. data (and others)
       //       won't be necessary
@@ -105,14 +284,58 @@ namespace Avogadro{
       OpenBabel::OBDOSData *        obdosdata;
       OpenBabel::OBElectronicTransitionData *
                                     obelectronictransitiondata;
+
+      // The last snapshot taken, and what changed since. Several readers
+      // may take snapshots at once, the mutex serialises the rebuild.
+      mutable QMutex                snapshotMutex;
+      mutable MoleculeSnapshot      snapshot;
+      mutable unsigned long         version;
+      mutable std::vector<bool>     dirtyChunks;
+      mutable bool                  dirtyBonds;
+
+      // Per atom data columns, in the order of the atom indices
+      QMap<QString, AtomAttribute>  atomAttributes;
+      unsigned long                 attributeRevision;
   };
 
+  void MoleculePrivate::moveAtomPos(const Atom *atom,
+                                    const Eigen::Vector3d *from,
+                                    const Eigen::Vector3d *to) const
+  {
+    // Nothing to track until the next full refresh in computeGeomInfo
+    if (invalidGeomInfo)
+      return;
+
+    if (from) {
+      const Vector3d p = *from - origin;
+      posSum -= p;
+      posSqSum -= p * p.transpose();
+      if (atom == farthestAtom)
+        invalidFarthestAtom = true;
+    }
+    if (to) {
+      const Vector3d p = *to - origin;
+      posSum += p;
+      posSqSum += p * p.transpose();
+      // Grow the bounding sphere if the atom left it, it is now the farthest
+      const double distance = (*to - boundCenter).norm();
+      if (distance >= boundRadius) {
+        boundRadius = distance;
+        farthestAtom = atom;
+        invalidFarthestAtom = false;
+      }
+    }
+    invalidNormalVector = true;
+    ++geomUpdates;
+  }
+
   Molecule::Molecule(QObject *parent) : Primitive(MoleculeType, parent),
                                         d_ptr(new MoleculePrivate),
                                         m_atomPos(0),
                                         m_currentConformer(0),
                                         m_estimatedDipoleMoment(true),
                                         m_dipoleMoment(0),
+                                        m_invalidDipoleEstimate(true),
                                         m_invalidPartialCharges(true),
                                         m_invalidAromaticity(true),
                                         m_lock(new QReadWriteLock)
@@ -126,8 +349,10 @@ namespace Avogadro{
 
   Molecule::Molecule(const Molecule &other) :
     Primitive(MoleculeType, other.parent()), d_ptr(new MoleculePrivate),
-    m_atomPos(0), m_dipoleMoment(0), m_invalidPartialCharges(true),
-    m_invalidAromaticity(true), m_lock(new QReadWriteLock)
+    m_atomPos(0), m_currentConformer(0), m_estimatedDipoleMoment(true),
+    m_dipoleMoment(0), m_invalidDipoleEstimate(true),
+    m_invalidPartialCharges(true), m_invalidAromaticity(true),
+    m_lock(new QReadWriteLock)
   {
     *this = other;
     connect(this, SIGNAL(updated()), this, SLOT(updatePrimitive()));
@@ -162,8 +387,7 @@ namespace Avogadro{
     // do some fancy footwork when we add an atom previously created
   Atom *Molecule::addAtom(unsigned long id)
   {
-    Q_D(const Molecule);
-    d->invalidGeomInfo = true;
+    Q_D(Molecule);
     Atom *atom = new Atom(this);
 
     if (!m_atomPos) {
@@ -183,6 +407,15 @@ namespace Avogadro{
 
     atom->setId(id);
     atom->setIndex(m_atomList.size()-1);
+    if (!d->atomAttributes.isEmpty()) {
+      QMap<QString, AtomAttribute>::iterator it = d->atomAttributes.begin();
+      for (; it != d->atomAttributes.end(); ++it)
+        it->append();
+      ++d->attributeRevision;
+    }
+    d->moveAtomPos(atom, 0, &(*m_atomPos)[id]);
+    d->touchAtom(atom->index());
+    invalidateDipoleMoment();
     // now that the id is correct, emit the signal
     connect(atom, SIGNAL(updated()), this, SLOT(updateAtom()));
     d->invalidGroupIndices = true;
@@ -197,7 +430,7 @@ namespace Avogadro{
     Atom *newAtom = this->addAtom(newId);
 
     newAtom->m_atomicNumber = atomicNum;
-    (*m_atomPos)[newId] = pos;
+    setAtomPos(newId, pos);
 
     return newAtom;
   }
@@ -215,8 +448,13 @@ namespace Avogadro{
   {
     Q_D(const Molecule);
     if (id < m_atomPos->size()) {
+      // Only live atoms contribute to the cached geometry
+      if (id < m_atoms.size() && m_atoms[id]) {
+        d->moveAtomPos(m_atoms[id], &(*m_atomPos)[id], &vec);
+        d->touchAtom(m_atoms[id]->index());
+        invalidateDipoleMoment();
+      }
       (*m_atomPos)[id] = vec;
-      d->invalidGeomInfo = true;
     }
   }
 
@@ -228,7 +466,7 @@ namespace Avogadro{
 
   void Molecule::removeAtom(Atom *atom)
   {
-    Q_D(const Molecule);
+    Q_D(Molecule);
     if(atom && atom->parent() == this) {
       // When deleting an atom this also implicitly deletes any bonds to the atom
       foreach (unsigned long bond, atom->bonds()) {
@@ -236,11 +474,22 @@ namespace Avogadro{
       }
 
       m_atoms[atom->id()] = 0;
+      d->moveAtomPos(atom, &(*m_atomPos)[atom->id()], 0);
+      invalidateDipoleMoment();
       // 1 based arrays stored/shown to user
       int index = atom->index();
       m_atomList.removeAt(index);
       for (int i = index; i < m_atomList.size(); ++i)
         m_atomList[i]->setIndex(i);
+      if (!d->atomAttributes.isEmpty()) {
+        QMap<QString, AtomAttribute>::iterator it = d->atomAttributes.begin();
+        for (; it != d->atomAttributes.end(); ++it)
+          it->removeAt(index);
+        ++d->attributeRevision;
+      }
+      // Bonds refer to the shifted atom indices too
+      d->touchAtomsFrom(index);
+      d->touchBonds();
       atom->deleteLater();
 
       disconnect(atom, SIGNAL(updated()), this, SLOT(updateAtom()));
@@ -264,8 +513,10 @@ namespace Avogadro{
     Q_D(Molecule);
     Bond *bond = new Bond(this);
 
+    d->touchBonds();
     d->invalidRings = true;
     m_invalidPartialCharges = true;
+    m_invalidDipoleEstimate = true;
     m_invalidAromaticity = true;
     if(id >= m_bonds.size())
       m_bonds.resize(id+1,0);
@@ -311,8 +562,10 @@ namespace Avogadro{
       if (m_bonds[id] == 0)
         return;
 
+      d->touchBonds();
       d->invalidRings = true;
       m_invalidPartialCharges = true;
+      m_invalidDipoleEstimate = true;
       m_invalidAromaticity = true;
       Bond *bond = m_bonds[id];
       m_bonds[id] = 0;
@@ -777,25 +1030,38 @@ namespace Avogadro{
       return *m_dipoleMoment;
     }
     else {
-      // Calculate a new estimate (e.g., the geometry changed
-      Vector3d dipoleMoment(0.0, 0.0, 0.0);
-
-      foreach (Atom *a, atoms())
-        dipoleMoment += *a->pos() * a->partialCharge();
-
-      // convert from electrons * Angstrom to Debye
-      // (1.602176487×10−19 C / electron) *  (1.0e-10 m/Ang / 3.33564e-30 C/m)
-      // use the negative to go from positive to negative charge (Chemistry)
-      dipoleMoment *= -4.8032046729977;
+      Q_D(const Molecule);
+      // Calculate a new estimate only if the geometry or charges changed
+      if (m_invalidDipoleEstimate) {
+        Vector3d dipoleMoment(0.0, 0.0, 0.0);
+
+        foreach (Atom *a, m_atomList)
+          dipoleMoment += *a->pos() * a->partialCharge();
+
+        // convert from electrons * Angstrom to Debye
+        // (1.602176487×10−19 C / electron) *  (1.0e-10 m/Ang / 3.33564e-30 C/m)
+        // use the negative to go from positive to negative charge (Chemistry)
+        d->dipoleEstimate = dipoleMoment * -4.8032046729977;
+        m_invalidDipoleEstimate = false;
+      }
 
       if (estimate)
         *estimate = true;
 
       m_estimatedDipoleMoment = true;
-      return dipoleMoment;
+      return d->dipoleEstimate;
     }
   }
 
+  void Molecule::invalidateDipoleMoment() const
+  {
+    m_invalidDipoleEstimate = true;
+    // Any calculated dipole moment no longer matches the geometry
+    m_estimatedDipoleMoment = true;
+    delete m_dipoleMoment;
+    m_dipoleMoment = 0;
+  }
+
   void Molecule::calculatePartialCharges() const
   {
     if (numAtoms() < 1 || !m_invalidPartialCharges) {
@@ -906,15 +1172,18 @@ namespace Avogadro{
   {
     Q_D(Molecule);
     d->invalidGeomInfo = true;
+    d->touchAll();
+    invalidateDipoleMoment();
     emit moleculeChanged();
     emit updated();
   }
 
   void Molecule::updatePrimitive()
   {
-    Q_D(Molecule);
+    // Atom positions are tracked as they are set, and direct writes are
+    // announced through invalidatePositions(), so the cached geometry does
+    // not need to be invalidated here
     Primitive *primitive = qobject_cast<Primitive *>(sender());
-    d->invalidGeomInfo = true;
     emit primitiveUpdated(primitive);
   }
 
@@ -922,14 +1191,20 @@ namespace Avogadro{
   {
     Q_D(Molecule);
     Atom *atom = qobject_cast<Atom *>(sender());
-    d->invalidGeomInfo = true;
     d->invalidGroupIndices = true;
+    if (atom)
+      d->touchAtom(atom->index());
+    // The element may have changed, and with it the partial charges
+    m_invalidDipoleEstimate = true;
     emit atomUpdated(atom);
   }
 
   void Molecule::updateBond()
   {
+    Q_D(Molecule);
     Bond *bond = qobject_cast<Bond *>(sender());
+    // The bond order may have changed
+    d->touchBonds();
     emit bondUpdated(bond);
   }
 
@@ -978,6 +1253,8 @@ namespace Avogadro{
         m_atomConformers.push_back( new vector<Vector3d>(m_atomPos->size()) );
     }
     *m_atomConformers[index] = conformer;
+    if (m_atomConformers[index] == m_atomPos)
+      invalidatePositions();
     return true;
   }
 
@@ -1004,6 +1281,22 @@ namespace Avogadro{
       return NULL;
   }
 
+  void Molecule::invalidatePositions(int first, int last)
+  {
+    Q_D(Molecule);
+    if (last < 0 || last >= m_atomList.size())
+      last = m_atomList.size() - 1;
+    if (first < 0)
+      first = 0;
+    if (first > last)
+      return;
+    // The old positions are gone, so the running sums are rebuilt in one pass
+    // when the geometry is next needed
+    d->invalidGeomInfo = true;
+    d->touchAtoms(first, last);
+    invalidateDipoleMoment();
+  }
+
   const std::vector<std::vector<Eigen::Vector3d> *>& Molecule::conformers() const
   {
     return m_atomConformers;
@@ -1025,6 +1318,18 @@ namespace Avogadro{
         m_atomPos->push_back(Eigen::Vector3d::Zero());
       // set the current conformer index
       m_currentConformer = index;
+      Q_D(Molecule);
+      if (index < d->conformerCells.size()) {
+        if (!d->obunitcell)
+          d->obunitcell = new OpenBabel::OBUnitCell;
+        const Eigen::Matrix3d &cell = d->conformerCells[index];
+        d->obunitcell->SetData(Eigen2OB(Vector3d(cell.col(0))),
+                               Eigen2OB(Vector3d(cell.col(1))),
+                               Eigen2OB(Vector3d(cell.col(2))));
+      }
+      d->invalidGeomInfo = true;
+      d->touchAll();
+      invalidateDipoleMoment();
       return true;
     }
   }
@@ -1054,6 +1359,12 @@ namespace Avogadro{
 
     m_atomPos = m_atomConformers[0];
     m_currentConformer = 0;
+    Q_D(Molecule);
+    // The cells of the old conformers do not apply to the new ones
+    d->conformerCells.clear();
+    d->invalidGeomInfo = true;
+    d->touchAll();
+    invalidateDipoleMoment();
     return true;
   }
 
@@ -1064,8 +1375,29 @@ namespace Avogadro{
         delete m_atomConformers[i];
       m_atomConformers.resize(1);
       m_atomPos = m_atomConformers[0];
+      Q_D(Molecule);
+      d->invalidGeomInfo = true;
+      d->touchAll();
+      invalidateDipoleMoment();
     }
     m_currentConformer = 0;
+    Q_D(Molecule);
+    d->conformerCells.clear();
+  }
+
+  void Molecule::setConformerCells(const std::vector<Eigen::Matrix3d> &cells)
+  {
+    Q_D(Molecule);
+    d->conformerCells = cells;
+    // Apply the cell of the current conformer
+    if (m_atomPos)
+      setConformer(m_currentConformer);
+  }
+
+  const std::vector<Eigen::Matrix3d> & Molecule::conformerCells() const
+  {
+    Q_D(const Molecule);
+    return d->conformerCells;
   }
 
   unsigned int Molecule::numConformers() const
@@ -1124,6 +1456,116 @@ namespace Avogadro{
     d->energies = energies;
   }
 
+  bool Molecule::setAtomAttribute(const QString &name,
+                                  const std::vector<double> &values)
+  {
+    Q_D(Molecule);
+    if (values.size() != static_cast<size_t>(m_atomList.size()))
+      return false;
+    AtomAttribute attribute;
+    attribute.type = FloatAttribute;
+    attribute.floats = values;
+    d->atomAttributes.insert(name, attribute);
+    ++d->attributeRevision;
+    return true;
+  }
+
+  bool Molecule::setAtomAttribute(const QString &name,
+                                  const std::vector<int> &values)
+  {
+    Q_D(Molecule);
+    if (values.size() != static_cast<size_t>(m_atomList.size()))
+      return false;
+    AtomAttribute attribute;
+    attribute.type = IntAttribute;
+    attribute.ints = values;
+    d->atomAttributes.insert(name, attribute);
+    ++d->attributeRevision;
+    return true;
+  }
+
+  bool Molecule::setAtomAttribute(const QString &name,
+                                  const QStringList &values)
+  {
+    Q_D(Molecule);
+    if (values.size() != m_atomList.size())
+      return false;
+    AtomAttribute attribute;
+    attribute.type = StringAttribute;
+    attribute.strings = values;
+    d->atomAttributes.insert(name, attribute);
+    ++d->attributeRevision;
+    return true;
+  }
+
+  void Molecule::removeAtomAttribute(const QString &name)
+  {
+    Q_D(Molecule);
+    if (d->atomAttributes.remove(name))
+      ++d->attributeRevision;
+  }
+
+  QStringList Molecule::atomAttributeNames() const
+  {
+    Q_D(const Molecule);
+    return d->atomAttributes.keys();
+  }
+
+  Molecule::AttributeType Molecule::atomAttributeType(const QString &name) const
+  {
+    Q_D(const Molecule);
+    QMap<QString, AtomAttribute>::const_iterator it =
+        d->atomAttributes.constFind(name);
+    return it == d->atomAttributes.constEnd() ? NoAttribute : it->type;
+  }
+
+  const std::vector<double> &
+  Molecule::atomFloatAttribute(const QString &name) const
+  {
+    Q_D(const Molecule);
+    static const std::vector<double> empty;
+    if (d->atomAttributes.isEmpty())
+      return empty;
+    QMap<QString, AtomAttribute>::const_iterator it =
+        d->atomAttributes.constFind(name);
+    if (it == d->atomAttributes.constEnd() || it->type != FloatAttribute)
+      return empty;
+    return it->floats;
+  }
+
+  const std::vector<int> &
+  Molecule::atomIntAttribute(const QString &name) const
+  {
+    Q_D(const Molecule);
+    static const std::vector<int> empty;
+    if (d->atomAttributes.isEmpty())
+      return empty;
+    QMap<QString, AtomAttribute>::const_iterator it =
+        d->atomAttributes.constFind(name);
+    if (it == d->atomAttributes.constEnd() || it->type != IntAttribute)
+      return empty;
+    return it->ints;
+  }
+
+  const QStringList & Molecule::atomStringAttribute(const QString &name) const
+  {
+    Q_D(const Molecule);
+    static const QStringList empty;
+    if (d->atomAttributes.isEmpty())
+      return empty;
+    QMap<QString, AtomAttribute>::const_iterator it =
+        d->atomAttributes.constFind(name);
+    if (it == d->atomAttributes.constEnd() || it->type != StringAttribute)
+      return empty;
+    return it->strings;
+  }
+
+  unsigned long Molecule::atomAttributeRevision() const
+  {
+    Q_D(const Molecule);
+    return d->attributeRevision;
+  }
+
 
   QList<Atom *> Molecule::atoms() const
   {
@@ -1178,118 +1620,76 @@ namespace Avogadro{
 
   OpenBabel::OBMol Molecule::OBMol() const
   {
-    Q_D(const Molecule);
     // Right now we make an OBMol each time
-    OpenBabel::OBMol obmol;
-    obmol.BeginModify();
-
-    foreach(Atom *atom, m_atomList) {
-      OpenBabel::OBAtom *a = obmol.NewAtom();
-      OpenBabel::OBAtom obatom = atom->OBAtom();
-      *a = obatom;
-    }
-    // we are copying partial charges above
-    obmol.SetPartialChargesPerceived();
-    foreach(Bond *bond, m_bondList) {
-      Atom *beginAtom = atomById(bond->beginAtomId());
-      if (!beginAtom)
-        continue;
+    return OBMolSnapshot(this).OBMol();
+  }
 
-      Atom *endAtom = atomById(bond->endAtomId());
-      if (!endAtom)
-        continue;
+  void Molecule::copyOBMolData(OBMolSnapshotPrivate *data) const
+  {
+    Q_D(const Molecule);
+    data->snapshot = snapshot();
 
-      obmol.AddBond(beginAtom->index() + 1,
-                    endAtom->index() + 1, bond->order());
+    data->atoms.resize(m_atomList.size());
+    for (int i = 0; i < m_atomList.size(); ++i)
+      m_atomList.at(i)->copyOBAtomData(&data->atoms[i]);
 
+    // Numbered as the bonds of the snapshot, which skips the same bonds
+    unsigned int bondIndex = 0;
+    foreach(Bond *bond, m_bondList) {
+      if (!bond->beginAtom() || !bond->endAtom())
+        continue;
       QString label = bond->customLabel();
-      if(!label.isEmpty()) {
-        OpenBabel::OBPairData *dp = new OpenBabel::OBPairData();
-        dp->SetAttribute("label");
-        dp->SetValue(label.toLatin1());
-        obmol.GetBond(obmol.NumBonds()-1)->SetData(dp);
-      }
+      if (!label.isEmpty())
+        data->bondLabels.insert(bondIndex, label.toLatin1());
+      ++bondIndex;
     }
-    // We're doing this after copying all atoms, so we can grab them ourselves
+
     foreach(Residue *residue, d->residueList) {
-      OpenBabel::OBResidue *r = obmol.NewResidue();
-      // Copy per-residue information
-      r->SetNum(residue->number().toStdString());
-      r->SetChain(residue->chainID());
-      r->SetName(residue->name().toUpper().toStdString());
-
-      OpenBabel::OBAtom *a;
-      foreach(unsigned long atomId, residue->atoms()){
-        // Avogadro indexes from 0, but OB from 1. Watch out!
+      OBResidueData r;
+      r.number = residue->number().toStdString();
+      r.chain = residue->chainID();
+      r.name = residue->name().toUpper().toStdString();
+      foreach(unsigned long atomId, residue->atoms()) {
         Atom *avoAtom = this->atomById(atomId);
         if (!avoAtom)
           continue;
-        a = obmol.GetAtom(avoAtom->index() + 1);
-        r->AddAtom(a);
-        r->SetSerialNum(a, a->GetIdx());
-        QString atomLabel = residue->atomId(atomId);
-        if (!atomLabel.isEmpty())
-          r->SetAtomID(a, atomLabel.toStdString());
-        else {
-          r->SetAtomID(a, OpenBabel::etab.GetSymbol(avoAtom->atomicNumber()));
-          r->SetHetAtom(a, true);
-        }
+        r.atoms.append(avoAtom->index());
+        r.atomIds.append(residue->atomId(atomId).toStdString().c_str());
       }
+      data->residues.append(r);
     }
-    foreach(Cube *cube, d->cubeList) {
-      OpenBabel::OBGridData *obgrid = new OpenBabel::OBGridData;
-      obgrid->SetOrigin(OpenBabel::fileformatInput);
-      obgrid->SetAttribute(cube->name().toLatin1().data());
-      obgrid->SetUnit(OpenBabel::OBGridData::ANGSTROM);
-      obgrid->SetNumberOfPoints(cube->dimensions().x(),
-                                cube->dimensions().y(),
-                                cube->dimensions().z());
-      OpenBabel::vector3 origin(cube->min().x(), cube->min().y(), cube->min().z());
-      OpenBabel::vector3 x(cube->spacing().x(), 0.0, 0.0);
-      OpenBabel::vector3 y(0.0, cube->spacing().y(), 0.0);
-      OpenBabel::vector3 z(0.0, 0.0, cube->spacing().z());
-      obgrid->SetLimits(origin, x, y, z);
-      obgrid->SetValues(cube->m_data);
-      obmol.SetData(obgrid);
-    }
-
-    obmol.EndModify();
-
-    // Copy energy
-    obmol.SetEnergy(this->energy() / KCAL_TO_KJ);
 
-    // Copy unit cells
-    if (d->obunitcell != NULL) {
-      OpenBabel::OBUnitCell *obunitcell = new OpenBabel::OBUnitCell;
-      *obunitcell = *d->obunitcell;
-      obmol.SetData(obunitcell);
-    }
-
-    // Copy OBPairData, if needed
-    OpenBabel::OBPairData *obproperty;
-    foreach(const QByteArray &propertyName, dynamicPropertyNames()) {
-      obproperty = new OpenBabel::OBPairData;
-      obproperty->SetAttribute(propertyName.data());
-      obproperty->SetValue(property(propertyName).toByteArray().data());
-      obmol.SetData(obproperty);
+    foreach(Cube *cube, d->cubeList) {
+      // Adaptive cubes are interpolated away from their isosurfaces
+      if (cube->refinedIsoValue() != 0.0)
+        continue;
+      OBCubeData c;
+      c.name = cube->name().toLatin1();
+      c.points = cube->dimensions();
+      c.min = cube->min();
+      c.spacing = cube->spacing();
+      c.values = cube->m_data;
+      data->cubes.append(c);
     }
 
-    // Copy vibrations, if needed
-    if (d->obvibdata != NULL) {
-      obmol.SetData(d->obvibdata->Clone(&obmol));
-    }
+    data->energy = this->energy();
 
-    // Copy dos, if needed
-    if (d->obdosdata != NULL) {
-      obmol.SetData(d->obdosdata->Clone(&obmol));
+    if (d->obunitcell != NULL) {
+      data->unitCell = new OpenBabel::OBUnitCell;
+      *data->unitCell = *d->obunitcell;
     }
 
-    // Copy excited states data, if needed
-    if (d->obelectronictransitiondata != NULL) {
-      obmol.SetData(d->obelectronictransitiondata->Clone(&obmol));
-    }
+    foreach(const QByteArray &propertyName, dynamicPropertyNames())
+      data->properties << qMakePair(propertyName,
+                                    property(propertyName).toByteArray());
 
-    return obmol;
+    // Vibrations, dos and excited states, cloned again into each OBMol
+    if (d->obvibdata != NULL)
+      data->data.append(d->obvibdata->Clone(0));
+    if (d->obdosdata != NULL)
+      data->data.append(d->obdosdata->Clone(0));
+    if (d->obelectronictransitiondata != NULL)
+      data->data.append(d->obelectronictransitiondata->Clone(0));
   }
 
   bool Molecule::setOBMol(OpenBabel::OBMol *obmol)
@@ -1552,28 +1952,48 @@ namespace Avogadro{
   const Eigen::Vector3d Molecule::center() const
   {
     Q_D(const Molecule);
-    if( d->invalidGeomInfo ) computeGeomInfo();
+    computeGeomInfo();
     return d->center;
   }
 
   const Eigen::Vector3d Molecule::normalVector() const
   {
     Q_D(const Molecule);
-    if( d->invalidGeomInfo ) computeGeomInfo();
+    computeGeomInfo();
+    // The best-fitting plane is only solved for when it is asked for, using
+    // the covariance of the atom positions from the running sums
+    if (!d->obunitcell && d->invalidNormalVector) {
+      d->normalVector = Vector3d::UnitZ();
+      const unsigned int nAtoms = numAtoms();
+      if (nAtoms > 1) {
+        const Vector3d mean = d->posSum / static_cast<double>(nAtoms);
+        const Eigen::Matrix3d covariance =
+            d->posSqSum / static_cast<double>(nAtoms) - mean * mean.transpose();
+        Eigen::SelfAdjointEigenSolver<Eigen::Matrix3d> eigen(covariance);
+        d->normalVector = eigen.eigenvectors().col(0);
+      }
+      d->invalidNormalVector = false;
+    }
     return d->normalVector;
   }
 
   double Molecule::radius() const
   {
     Q_D(const Molecule);
-    if( d->invalidGeomInfo ) computeGeomInfo();
+    computeGeomInfo();
     return d->radius;
   }
 
   const Atom * Molecule::farthestAtom() const
   {
     Q_D(const Molecule);
-    if( d->invalidGeomInfo ) computeGeomInfo();
+    computeGeomInfo();
+    // The farthest atom is lost if it was moved inwards or removed, this
+    // needs a full pass over the atoms to find again
+    if (d->invalidFarthestAtom) {
+      d->invalidGeomInfo = true;
+      computeGeomInfo();
+    }
     return d->farthestAtom;
   }
 
@@ -1582,8 +2002,13 @@ namespace Avogadro{
     if (!m_atomPos)
       return; // nothing to do
 
+    // Rigid translations do not change the moments about the origin, so just
+    // move the reference points along with the atoms
     Q_D(const Molecule);
-    d->invalidGeomInfo = true;
+    d->origin += offset;
+    d->boundCenter += offset;
+    d->touchAll();
+    invalidateDipoleMoment();
     foreach (Atom *atom, m_atomList) {
       (*m_atomPos)[atom->id()] += offset;
       emit atomUpdated(atom);
@@ -1593,6 +2018,9 @@ namespace Avogadro{
   void Molecule::clear()
   {
     Q_D(Molecule);
+    d->invalidGeomInfo = true;
+    d->touchAll();
+    invalidateDipoleMoment();
     m_atoms.clear();
     foreach (Atom *atom, m_atomList) {
       atom->deleteLater();
@@ -1641,6 +2069,11 @@ namespace Avogadro{
       emit primitiveRemoved(ring);
     }
     d->ringList.clear();
+
+    if (!d->atomAttributes.isEmpty()) {
+      d->atomAttributes.clear();
+      ++d->attributeRevision;
+    }
   }
 
   QReadWriteLock * Molecule::lock() const
@@ -1715,43 +2148,176 @@ namespace Avogadro{
       d->obunitcell = new OpenBabel::OBUnitCell;
       *d->obunitcell = *(other.OBUnitCell()); // Copy the object not the pointer
     }
+    d->conformerCells = other.d_func()->conformerCells;
+
+    // The atoms keep their indices, so the columns apply unchanged
+    d->atomAttributes = other.d_func()->atomAttributes;
+    ++d->attributeRevision;
 
     return *this;
   }
 
+  MoleculeSnapshot Molecule::snapshot() const
+  {
+    Q_D(const Molecule);
+    QMutexLocker locker(&d->snapshotMutex);
+    if (d->snapshot.version() != d->version) {
+      d->snapshot.update(this, d->version, d->dirtyChunks, d->dirtyBonds);
+      unsigned int numChunks = (m_atomList.size() + MoleculeSnapshot::ChunkSize
+                                - 1) / MoleculeSnapshot::ChunkSize;
+      d->dirtyChunks.assign(numChunks, false);
+      d->dirtyBonds = false;
+    }
+    return d->snapshot;
+  }
+
   Molecule &Molecule::operator+=(const Molecule& other)
   {
+    merge(other);
+    return *this;
+  }
+
+  PrimitiveList Molecule::merge(const Molecule &other,
+                                const Eigen::Matrix3d &rotation,
+                                const Eigen::Vector3d &translation)
+  {
+    Q_D(Molecule);
     // FIXME: Copy all the other stuff in the molecule!
-    //const MoleculePrivate *e = other.d_func();
-    // Create a temporary map from the old indices to the new for bonding
-    QList<int> map;
-    foreach (Atom *a, other.m_atomList) {
-      Atom *atom = addAtom();
-      *atom = *a;
-      map.push_back(atom->id());
-      emit primitiveAdded(atom);
+    PrimitiveList newPrimitives;
+    if (other.m_atomList.isEmpty() || &other == this)
+      return newPrimitives;
+
+    const bool rigid = !rotation.isIdentity() || !translation.isZero();
+    const unsigned long firstAtomId = m_atoms.size();
+    const unsigned long numNewAtoms = other.m_atomList.size();
+    const unsigned long numIds = firstAtomId + numNewAtoms;
+
+    if (!m_atomPos) {
+      m_atomConformers.resize(1);
+      m_atomConformers[0] = new vector<Vector3d>;
+      m_atomPos = m_atomConformers[0];
+    }
+
+    // Map the ids of the other molecule to the new, contiguous ids
+    vector<unsigned long> idMap(other.m_atoms.size(), FALSE_ID);
+    for (unsigned long i = 0; i < numNewAtoms; ++i)
+      idMap[other.m_atomList[i]->id()] = firstAtomId + i;
+
+    // Copy the positions a conformer at a time. If the conformers of the two
+    // molecules don't match up every conformer gets the current positions.
+    const bool matchConformers =
+        m_atomConformers.size() == other.m_atomConformers.size();
+    for (unsigned int c = 0; c < m_atomConformers.size(); ++c) {
+      const vector<Vector3d> *from = matchConformers ?
+          other.m_atomConformers[c] : other.m_atomPos;
+      vector<Vector3d> *to = m_atomConformers[c];
+      to->resize(numIds, Vector3d::Zero());
+      for (unsigned long i = 0; i < numNewAtoms; ++i) {
+        const unsigned long id = other.m_atomList[i]->id();
+        if (id >= from->size())
+          continue;
+        if (rigid)
+          (*to)[firstAtomId + i] = rotation * (*from)[id] + translation;
+        else
+          (*to)[firstAtomId + i] = (*from)[id];
+      }
     }
+
+    // Now the atoms, ids and indices follow on from the existing ones
+    m_atoms.reserve(numIds);
+    m_atomList.reserve(m_atomList.size() + numNewAtoms);
+    foreach (Atom *a, other.m_atomList) {
+      Atom *atom = new Atom(this);
+      atom->setId(m_atoms.size());
+      m_atoms.push_back(atom);
+      m_atomList.push_back(atom);
+      atom->setIndex(m_atomList.size() - 1);
+      atom->m_atomicNumber = a->m_atomicNumber;
+      atom->setFormalCharge(a->formalCharge());
+      atom->setCustomLabel(a->customLabel());
+      atom->setCustomColorName(a->customColorName());
+      atom->setCustomRadius(a->customRadius());
+      connect(atom, SIGNAL(updated()), this, SLOT(updateAtom()));
+      newPrimitives.append(atom);
+    }
+
+    m_bonds.reserve(m_bonds.size() + other.m_bondList.size());
+    m_bondList.reserve(m_bondList.size() + other.m_bondList.size());
     foreach (Bond *b, other.m_bondList) {
-      Bond *bond = addBond();
+      Bond *bond = new Bond(this);
       *bond = *b;
-      bond->setBegin(atomById(map.at(other.atomById(b->beginAtomId())->index())));
-      bond->setEnd(atomById(map.at(other.atomById(b->endAtomId())->index())));
-      emit primitiveAdded(bond);
+      bond->setId(m_bonds.size());
+      m_bonds.push_back(bond);
+      m_bondList.push_back(bond);
+      bond->setIndex(m_bondList.size() - 1);
+      bond->setAtoms(idMap.at(b->beginAtomId()), idMap.at(b->endAtomId()),
+                     b->order());
+      connect(bond, SIGNAL(updated()), this, SLOT(updateBond()));
+      newPrimitives.append(bond);
     }
+
     foreach (Residue *r, other.residues()) {
-      Residue *residue = addResidue();
+      Residue *residue = new Residue(this);
+      residue->setId(d->residues.size());
+      d->residues.push_back(residue);
+      d->residueList.push_back(residue);
+      residue->setIndex(d->residueList.size() - 1);
       residue->setChainNumber(r->chainNumber());
       residue->setChainID(r->chainID());
       residue->setNumber(r->number());
       residue->setName(r->name());
-
-      foreach(unsigned int atomId, r->atoms()) {
-        residue->addAtom(map.at(atomId));
-      }
+      foreach (unsigned long atomId, r->atoms())
+        if (atomId < idMap.size() && idMap[atomId] != FALSE_ID)
+          residue->addAtom(idMap[atomId]);
       residue->setAtomIds(r->atomIds());
+      connect(residue, SIGNAL(updated()), this, SLOT(updatePrimitive()));
+      newPrimitives.append(residue);
+    }
+
+    // Extend the columns, taking the values of the other molecule if it has
+    // a column of the same name and type. Its other columns are added with
+    // default values for the existing atoms.
+    const QMap<QString, AtomAttribute> &otherAttributes =
+        other.d_func()->atomAttributes;
+    if (!d->atomAttributes.isEmpty() || !otherAttributes.isEmpty()) {
+      const int numOldAtoms = m_atomList.size() - static_cast<int>(numNewAtoms);
+      QMap<QString, AtomAttribute>::const_iterator from =
+          otherAttributes.constBegin();
+      for (; from != otherAttributes.constEnd(); ++from) {
+        if (d->atomAttributes.contains(from.key()))
+          continue;
+        AtomAttribute &attribute = d->atomAttributes[from.key()];
+        attribute.type = from->type;
+        for (int i = 0; i < numOldAtoms; ++i)
+          attribute.append();
+      }
+      QMap<QString, AtomAttribute>::iterator it = d->atomAttributes.begin();
+      for (; it != d->atomAttributes.end(); ++it) {
+        from = otherAttributes.constFind(it.key());
+        for (unsigned long i = 0; i < numNewAtoms; ++i) {
+          if (from != otherAttributes.constEnd())
+            it->append(*from, static_cast<int>(i));
+          else
+            it->append();
+        }
+      }
+      ++d->attributeRevision;
     }
 
-    return *this;
+    // Invalidate the cached properties once rather than per primitive
+    d->invalidGeomInfo = true;
+    d->touchAtomsFrom(m_atomList.size() - numNewAtoms);
+    d->touchBonds();
+    d->invalidGroupIndices = true;
+    if (!other.m_bondList.isEmpty()) {
+      d->invalidRings = true;
+      m_invalidPartialCharges = true;
+      m_invalidAromaticity = true;
+    }
+    invalidateDipoleMoment();
+
+    emit primitivesAdded(newPrimitives);
+    return newPrimitives;
   }
 
   PrimitiveList Molecule::copyAtomsAndBonds(const QList<Atom *> &atoms,
@@ -1861,61 +2427,59 @@ namespace Avogadro{
   void Molecule::computeGeomInfo() const
   {
     Q_D(const Molecule);
-    d->invalidGeomInfo = true;
-    d->farthestAtom = 0;
-    d->center.setZero();
-    d->normalVector = Vector3d::UnitZ();
-    d->radius = 1.0;
-
-    /// FIXME This leads to the dipole moment always getting invalidated
-    /// as the geometry information must be computed on load
-    // invalidate the previous dipole moment
-    if (m_dipoleMoment) {
-      delete m_dipoleMoment; // don't leak -- this is the previous estimate
-      m_dipoleMoment = 0;
-      m_estimatedDipoleMoment = true;
+    const unsigned int nAtoms = numAtoms();
+
+    // Rebuild the running sums from scratch when they have been invalidated,
+    // or once there have been as many incremental updates as atoms. This keeps
+    // the cost amortised, bounds rounding errors and tightens the sphere.
+    if (d->invalidGeomInfo || d->geomUpdates > qMax(nAtoms, 64u)) {
+      // Accumulate about the centroid to keep the second moments accurate
+      Vector3d centroid(Vector3d::Zero());
+      foreach (Atom *atom, m_atomList)
+        centroid += (*m_atomPos)[atom->id()];
+      if (nAtoms)
+        centroid /= static_cast<double>(nAtoms);
+
+      d->origin = centroid;
+      d->posSum.setZero();
+      d->posSqSum.setZero();
+      d->boundCenter = centroid;
+      d->farthestAtom = 0;
+      double sqRadius = 0.0;
+      foreach (Atom *atom, m_atomList) {
+        const Vector3d pos = (*m_atomPos)[atom->id()] - centroid;
+        d->posSum += pos;
+        d->posSqSum += pos * pos.transpose();
+        const double distanceToCenter = pos.squaredNorm();
+        if (distanceToCenter > sqRadius || !d->farthestAtom) {
+          sqRadius = distanceToCenter;
+          d->farthestAtom = atom;
+        }
+      }
+      d->boundRadius = sqrt(sqRadius);
+      d->geomUpdates = 0;
+      d->invalidGeomInfo = false;
+      d->invalidNormalVector = true;
+      d->invalidFarthestAtom = false;
     }
 
-    unsigned int nAtoms = numAtoms();
+    // Everything below is O(1) in the number of atoms
+    if (nAtoms)
+      d->center = d->origin + d->posSum / static_cast<double>(nAtoms);
+    else
+      d->center.setZero();
+
+    // The bounding sphere is not centered on the current center, so enlarge it
+    // to remain conservative
+    if (nAtoms > 1)
+      d->radius = d->boundRadius + (d->center - d->boundCenter).norm();
+    else
+      d->radius = 1.0;
 
     // If a unit cell is present, combine it's center and radius with
     // that of the molecule's atomic center/radius
-    if (d->obunitcell) {
+    if (d->obunitcell)
       this->computeGeomInfoFromUnitCell();
-    }
-    // If no unit cell, just compute the radius and farthest atom as normal.
-    else {
-      if (nAtoms > 1) {
-        // compute radius and the farthest atom
-        d->radius = std::numeric_limits<double>::min();
-        foreach (Atom *atom, m_atomList) {
-          double distanceToCenter = (*atom->pos() - d->center).squaredNorm();
-          if(distanceToCenter > d->radius) {
-            d->radius = distanceToCenter;
-            d->farthestAtom = atom;
-          }
-        }
-        d->radius = sqrt(d->radius);
-
-        // Compute the normal vector to the molecule's best-fitting plane
-        int i = 0;
-        Vector3d ** atomPositions = new Vector3d*[nAtoms];
-        // Calculate the center of the molecule too
-        foreach (Atom *atom, m_atomList) {
-          Vector3d *pos = &(*m_atomPos)[atom->id()];
-          d->center += *pos;
-          atomPositions[i++] = pos;
-        }
-        d->center /= static_cast<double>(nAtoms);
-        Eigen::Hyperplane<double, 3> planeCoeffs;
-        fitHyperplane(numAtoms(), atomPositions, &planeCoeffs);
-
-        delete[] atomPositions;
-        d->normalVector = planeCoeffs.normal();
-      }
-    }
-
-    d->invalidGeomInfo = false;
   }
 
   inline void Molecule::computeGeomInfoFromUnitCell() const
@@ -1959,29 +2523,20 @@ namespace Avogadro{
       else                   // c < b < a
         d->normalVector = -ucRowMatrix.row(2).normalized();
     }
+    // Refit the plane to the atoms should the unit cell be removed
+    d->invalidNormalVector = true;
 
     // If there are no atoms, just use the cell geometry:
     if (this->numAtoms() == 0) {
       d->radius = ucRadius;
       d->center = ucCenter;
     }
-    // Otherwise set the center only and calculate the radius and farthest
-    // atom
+    // Otherwise center on the cell and grow the atomic bounding sphere to
+    // contain the atoms as seen from there
     else {
-      // Calculate the center between the molecule and uc centers:
       d->center = ucCenter;
-
-      // Discover the farthestAtom info and radius
-      double farthestAtomSqDistance = std::numeric_limits<double>::min();
-      d->farthestAtom = NULL;
-      foreach (Atom *atom, m_atomList) {
-        double distanceToCenter = (*atom->pos() - d->center).squaredNorm();
-        if(distanceToCenter > farthestAtomSqDistance) {
-          farthestAtomSqDistance = distanceToCenter;
-          d->farthestAtom = atom;
-        }
-      }
-      const double moleculeRadius = sqrt(farthestAtomSqDistance);
+      const double moleculeRadius = d->boundRadius +
+          (ucCenter - d->boundCenter).norm();
       d->radius = (moleculeRadius > ucRadius) ? moleculeRadius : ucRadius;
     }
   }
@@ -30,6 +30,7 @@
 
 // Used by the inline functions
 #include <QReadWriteLock>
+#include <QStringList>
 
 #include <vector>
 
@@ -48,6 +49,8 @@ namespace Avogadro {
   class Cube;
   class Fragment;
   class Mesh;
+  class MoleculeSnapshot;
+  class OBMolSnapshotPrivate;
   class PrimitiveList;
   class Residue;
   class ZMatrix;
@@ -617,7 +620,8 @@ namespace Avogadro {
      * atoms.
      *
      * @param index The index of the new conformer.
-     * @return Pointer to the conformer added.
+     * @return Pointer to the conformer added. Call invalidatePositions()
+     * after writing the current conformer through it.
      */
     std::vector<Eigen::Vector3d> * addConformer(unsigned int index);
 
@@ -627,9 +631,22 @@ namespace Avogadro {
      * atoms.
      * @param index The index of the conformer to retrieve.
      * @return Pointer to an existing conformer, or NULL if the index doesn't exist.
+     * Call invalidatePositions() after writing the current conformer through
+     * it.
      */
     std::vector<Eigen::Vector3d> * conformer(unsigned int index);
 
+    /**
+     * Announce that the positions of the atoms with indices @p first to
+     * @p last in the current conformer were written directly, e.g. through
+     * conformer(). Positions set through Atom::setPos() are tracked already.
+     * The cached geometry and dipole moment are recalculated when next
+     * needed, and only the snapshot chunks holding these atoms are rebuilt.
+     * @param first The index of the first atom written.
+     * @param last The index of the last atom written, -1 for the last atom.
+     */
+    void invalidatePositions(int first = 0, int last = -1);
+
     /**
      * Get const reference to all conformers.
      *
@@ -670,6 +687,22 @@ namespace Avogadro {
      */
     void clearConformers();
 
+    /**
+     * Set the unit cell of each conformer, for trajectories in which the cell
+     * changes, e.g. constant pressure molecular dynamics. The columns of each
+     * matrix are the cell vectors in Angstrom. setConformer() then sets the
+     * OBUnitCell to the cell of the new conformer, so everything using the
+     * cell follows the trajectory. Conformers without a cell keep the current
+     * one. The cells are dropped by clearConformers() and setAllConformers().
+     */
+    void setConformerCells(const std::vector<Eigen::Matrix3d> &cells);
+
+    /**
+     * @return The unit cells of the conformers, empty if the cell does not
+     * change between conformers.
+     */
+    const std::vector<Eigen::Matrix3d> & conformerCells() const;
+
     /**
      * @return The number of conformers.
      */
@@ -712,6 +745,63 @@ namespace Avogadro {
      */
     void setEnergies(const std::vector<double>& energies);
 
+    /** @name Atom attributes
+     * Named columns of per atom data, such as B-factors or charges read
+     * from another code. A column holds one value per atom in the order of
+     * atoms(), it grows and shrinks as atoms are added and removed. Columns
+     * are set and read as a whole, engines and color maps look them up by
+     * name: by default "radius" holds the ball radii and "stickRadius" the
+     * stick radii, both in Angstrom, and "label" the atom labels.
+     * @{
+     */
+
+    enum AttributeType {
+      NoAttribute = 0,
+      FloatAttribute,
+      IntAttribute,
+      StringAttribute
+    };
+
+    /**
+     * Set the column @p name to @p values, replacing any existing column.
+     * @return False if there is not exactly one value per atom.
+     */
+    bool setAtomAttribute(const QString &name,
+                          const std::vector<double> &values);
+    bool setAtomAttribute(const QString &name, const std::vector<int> &values);
+    bool setAtomAttribute(const QString &name, const QStringList &values);
+
+    /**
+     * Remove the column @p name.
+     */
+    void removeAtomAttribute(const QString &name);
+
+    /**
+     * @return The names of all the columns, sorted.
+     */
+    QStringList atomAttributeNames() const;
+
+    /**
+     * @return The type of column @p name, NoAttribute if there is none.
+     */
+    AttributeType atomAttributeType(const QString &name) const;
+
+    /**
+     * @return The values of column @p name, empty if there is no such column
+     * of this type.
+     */
+    const std::vector<double> & atomFloatAttribute(const QString &name) const;
+    const std::vector<int> & atomIntAttribute(const QString &name) const;
+    const QStringList & atomStringAttribute(const QString &name) const;
+
+    /**
+     * @return A number that changes whenever a column is set or removed, or
+     * atoms are added or removed, so that values derived from the columns
+     * can be cached.
+     */
+    unsigned long atomAttributeRevision() const;
+    //@}
+
     /**
      * Remove all elements of the molecule.
      */
@@ -730,7 +820,8 @@ namespace Avogadro {
     /**
      * Get access to an OpenBabel::OBMol, this is a copy of the internal data
      * structure in OpenBabel form, you must call setOBMol in order to save
-     * any changes you make to this object.
+     * any changes you make to this object. Approximate cubes, see
+     * Cube::refinedIsoValue(), are left out.
      */
     OpenBabel::OBMol OBMol() const;
 
@@ -799,6 +890,7 @@ namespace Avogadro {
     /**
      * Addition operator used to add elements from the other Molecule to this
      * one.
+     * @sa merge
      */
     Molecule& operator+=(const Molecule& other);
     /** @} */
@@ -831,6 +923,32 @@ namespace Avogadro {
      * @note The QList overload of this function is faster.
      */
     PrimitiveList copyAtomsAndBonds(const PrimitiveList &atomsAndBonds);
+
+    /**
+     * Take an immutable snapshot of the atoms, their positions in the current
+     * conformer and the bonds. The snapshot can be kept and read from any
+     * thread while this Molecule is edited, it is cheap to take as the parts
+     * not edited since the last snapshot are shared with it.
+     * @note Call this from the thread editing the Molecule, or while holding
+     * the read lock. Several threads holding the read lock may take snapshots
+     * at the same time.
+     * @return The snapshot of the current version of the Molecule.
+     */
+    MoleculeSnapshot snapshot() const;
+
+    /**
+     * Append the atoms, bonds and residues of @a other to @a this in bulk.
+     * Storage is reserved up front, the new atoms get contiguous ids following
+     * the existing ones and a single primitivesAdded signal is emitted instead
+     * of the per primitive signals.
+     * @param other Molecule to copy into @a this.
+     * @param rotation Rotation applied to the positions of @a other.
+     * @param translation Translation applied after the rotation.
+     * @return A PrimitiveList containing the new atoms, bonds and residues.
+     */
+    PrimitiveList merge(const Molecule &other,
+                        const Eigen::Matrix3d &rotation = Eigen::Matrix3d::Identity(),
+                        const Eigen::Vector3d &translation = Eigen::Vector3d::Zero());
     /** @} */
 
   protected:
@@ -843,6 +961,7 @@ namespace Avogadro {
 
     mutable bool m_estimatedDipoleMoment;
     mutable Eigen::Vector3d *m_dipoleMoment;
+    mutable bool m_invalidDipoleEstimate;
     mutable bool m_invalidPartialCharges;
     mutable bool m_invalidAromaticity;
     Q_DECLARE_PRIVATE(Molecule)
@@ -857,11 +976,28 @@ namespace Avogadro {
     /**
      * Compute all the geometry information for the Molecule. This allows
      * several relatively expensive calculations to be cached by the Molecule
-     * instead of being recalculated every time the Molecule is drawn.
+     * instead of being recalculated every time the Molecule is drawn. Running
+     * sums of the atom positions are updated as atoms are moved, added and
+     * removed, so this is only a full pass over the atoms when the cache has
+     * been invalidated (e.g. the conformer changed).
      */
     void computeGeomInfo() const;
 
   private:
+    friend class Atom;
+    friend class OBMolSnapshot;
+
+    /**
+     * Copy everything OBMol() converts to @p data, see OBMolSnapshot.
+     */
+    void copyOBMolData(OBMolSnapshotPrivate *data) const;
+
+    /**
+     * Mark the estimated dipole moment as needing recalculation, and drop any
+     * calculated dipole moment since it no longer matches the geometry.
+     */
+    void invalidateDipoleMoment() const;
+
     /**
      * Helper function for setting cached geometry information from the unit
      * unit cell. This is called as needed by Molecule::computeGeomInfo.
@@ -917,6 +1053,13 @@ namespace Avogadro {
      */
     void primitiveAdded(Primitive *primitive);
 
+    /**
+     * Emitted once when many primitives are added in bulk, e.g. by merge(),
+     * instead of primitiveAdded, atomAdded and bondAdded for each of them.
+     * @param primitives the primitives that were added
+     */
+    void primitivesAdded(const PrimitiveList &primitives);
+
     /**
      * Emitted when a child primitive is updated.
      * @param primitive pointer to the primitive that was updated
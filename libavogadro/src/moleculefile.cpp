@@ -24,6 +24,8 @@
 
 #include "moleculefile.h"
 #include "readfilethread_p.h"
+#include "cifreader.h"
+#include "trajectoryreader.h"
 
 #include <avogadro/molecule.h>
 
@@ -37,6 +39,15 @@
 #include <openbabel/mol.h>
 #include <openbabel/obconversion.h>
 
+#ifdef Q_OS_WIN
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <cstdio>
+#endif
+
 // Included in obconversion.h
 //#include <iostream>
 
@@ -245,9 +256,11 @@ namespace Avogadro {
     ifs.close();
     ofs.close();
 
-    QFile newFile(newFilename);
-    QFile(m_fileName).remove();
-    newFile.rename(m_fileName);
+    if (!replaceFile(newFilename, m_fileName)) {
+      QFile(newFilename).remove();
+      m_error.append(tr("Replacing molecule with index %1 in file '%2' failed.").arg(i).arg(m_fileName));
+      return false;
+    }
 
 
     // adjust the cached variables
@@ -328,8 +341,11 @@ namespace Avogadro {
 
   bool MoleculeFile::canOpen(const QString &fileName, QIODevice::OpenMode mode)
   {
-    // Check that the file can be opened in mode
+    // Check that the file can be opened in mode, without truncating it: the
+    // new contents are written to fileName.new and only moved over on success
     QFile file(fileName);
+    if (mode & QIODevice::WriteOnly)
+      mode |= QIODevice::Append;
     if (!file.open(mode))
       // Cannot open the file in mode
       return false;
@@ -358,6 +374,16 @@ namespace Avogadro {
       return 0;
     }
 
+    // CIF and mmCIF files are read natively, which is much faster for large
+    // entries and keeps the chains, entities and assemblies. Periodic
+    // trajectories keep the cell of every frame, see
+    // Molecule::setConformerCells(), which OpenBabel does not read
+    if (CifReader::canRead(fileName, fileType)
+        || TrajectoryReader::canRead(fileName, fileType)) {
+      QFile file(fileName);
+      return readMolecule(&file, fileName, fileType, fileOptions, error);
+    }
+
     // Construct the OpenBabel objects, set the file type
     OBConversion conv;
     OBFormat *inFormat;
@@ -402,16 +428,97 @@ namespace Avogadro {
     }
   }
 
+  Molecule * MoleculeFile::readMolecule(QIODevice *device,
+      const QString &fileName, const QString &fileType,
+      const QString &fileOptions, QString *error)
+  {
+    if (!device || (!device->isOpen() && !device->open(QIODevice::ReadOnly))) {
+      if (error)
+        error->append(QObject::tr("File %1 cannot be opened for reading.").arg(fileName));
+      return 0;
+    }
+
+    // Extended XYZ files are only told apart from plain ones by the lattice
+    // on the comment line
+    QString type = fileType;
+    if (type.isEmpty() && QFileInfo(fileName).suffix().toLower() == "xyz") {
+      const QList<QByteArray> lines = device->peek(4096).split('\n');
+      if (lines.size() > 1 && lines.at(1).toLower().contains("lattice="))
+        type = "extxyz";
+    }
+
+    if (CifReader::canRead(fileName, type)) {
+      CifReader reader;
+      reader.setOptions(fileOptions);
+      Molecule *mol = new Molecule;
+      if (!reader.read(device, mol)) {
+        if (error)
+          error->append(QObject::tr("Reading a molecule from file '%1' failed: %2")
+                        .arg(fileName).arg(reader.errorString()));
+        delete mol;
+        return 0;
+      }
+      mol->setFileName(fileName);
+      return mol;
+    }
+
+    if (TrajectoryReader::canRead(fileName, type)) {
+      TrajectoryReader reader;
+      reader.setOptions(fileOptions);
+      Molecule *mol = new Molecule;
+      if (!reader.read(device, mol)) {
+        if (error)
+          error->append(QObject::tr("Reading a molecule from file '%1' failed: %2")
+                        .arg(fileName).arg(reader.errorString()));
+        delete mol;
+        return 0;
+      }
+      mol->setFileName(fileName);
+      return mol;
+    }
+
+    OBConversion conv;
+    OBFormat *inFormat = type.isEmpty() ? conv.FormatFromExt(fileName.toAscii().data())
+      : conv.FindFormat(type.toAscii().data());
+    if (!inFormat || !conv.SetInFormat(inFormat)) {
+      if (error)
+        error->append(QObject::tr("File type for file '%1' is not supported for reading.").arg(fileName));
+      return 0;
+    }
+    foreach(const QString &option,
+            fileOptions.split('\n', QString::SkipEmptyParts)) {
+      conv.AddOption(option.toAscii().data(), OBConversion::INOPTIONS);
+    }
+
+    const QByteArray data = device->readAll();
+    OpenBabel::OBMol obMol;
+    if (!conv.ReadString(&obMol, std::string(data.constData(), data.size()))) {
+      if (error)
+        error->append(QObject::tr("Reading a molecule from file '%1' failed.").arg(fileName));
+      return 0;
+    }
+    Molecule *mol = new Molecule;
+    mol->setOBMol(&obMol);
+    mol->setFileName(fileName);
+    return mol;
+  }
+
   bool MoleculeFile::writeMolecule(const Molecule *molecule,
                                    const QString &fileName,
                                    const QString &fileType,
                                    const QString &fileOptions, QString *error)
   {
-    // Check is we are replacing an existing file
-    QFile file(fileName);
-    bool replaceExistingFile = file.exists();
+    OpenBabel::OBMol obmol = molecule->OBMol();
+    return writeMolecule(&obmol, fileName, fileType, fileOptions, error);
+  }
+
+  bool MoleculeFile::writeMolecule(OpenBabel::OBMol *obmol,
+                                   const QString &fileName,
+                                   const QString &fileType,
+                                   const QString &fileOptions, QString *error)
+  {
     // Check that the file can be written to disk
-    if (!file.open(QFile::WriteOnly | QFile::Text)) {
+    if (!canOpen(fileName, QFile::WriteOnly | QFile::Text)) {
       // Cannot write to the file
       if (error) {
         error->append(QObject::tr("File %1 can not be opened for writing.")
@@ -419,22 +526,8 @@ namespace Avogadro {
       }
       return false;
     }
-    file.close();
-
-    QString newFileName = fileName;
-    if (replaceExistingFile) {
-      newFileName += ".new";
-      QFile newFile(newFileName);
-      if (!newFile.open(QFile::WriteOnly | QFile::Text)) {
-        // Cannot write to the temporary file location
-        if (error) {
-          error->append(QObject::tr("File %1 can not be opened for writing.")
-                        .arg(newFileName));
-        }
-        return false;
-      }
-      newFile.close();
-    }
+    // Always write to a new file and move it into place once complete
+    QString newFileName = fileName + ".new";
 
     // Construct the OpenBabel objects, set the file type
     OBConversion conv;
@@ -471,57 +564,26 @@ namespace Avogadro {
       qDebug() << "ofs is bad";
       return false;
     }
-    OpenBabel::OBMol obmol = molecule->OBMol();
-
-    if (obmol.NumResidues() == 0) {
+    if (obmol->NumResidues() == 0) {
       OpenBabel::OBChainsParser chainparser;
-      obmol.UnsetFlag(OB_CHAINS_MOL);
-      chainparser.PerceiveChains(obmol);
+      obmol->UnsetFlag(OB_CHAINS_MOL);
+      chainparser.PerceiveChains(*obmol);
     }
 
-    if (conv.Write(&obmol, &ofs)) {
+    if (conv.Write(obmol, &ofs)) {
       ofs.close();
-      if (replaceExistingFile) {
-        QFile newFile(newFileName);
-        bool success;
-        success = file.rename(fileName + ".old");
-        if (success) {
-          // Leave to ensure we work around a bug in Qt < 4.5.1
-          file.setFileName(fileName + ".old");
-          success = newFile.rename(fileName);
-        }
-        else {
-          if (error)
-              error->append(QObject::tr("Saving molecular file failed - could not rename original file."));
-          return false;
-        }
-        if (success) // renaming worked
-          success = file.remove(); // remove the old file: WARNING -- would much prefer to just rename, but Qt won't let you
-        else {
-          if (error)
-            error->append(QObject::tr("Saving molecular file failed - could not rename new file."));
-          return false;
-        }
-
-        if (success) {
-          return true;
-        }
-        else {
-          if (error)
-            error->append(QObject::tr("Saving molecular file failed - could not remove old file."));
-          return false;
-        }
-      }
-      else // No need for all that - this is a new file in an empty location
+      if (replaceFile(newFileName, fileName))
         return true;
+      if (error)
+        error->append(QObject::tr("Saving molecular file failed - could not rename new file."));
     }
     else {
+      ofs.close();
       if (error)
         error->append(QObject::tr("Writing a molecule to file '%1' failed. OpenBabel function failed.").arg(fileName));
-      return false;
     }
-    // Assume something went wrong if we did not return true earlier
-    qDebug() << "OBWrapper should never get here...";
+    // Leave any previous file in place
+    QFile(newFileName).remove();
     return false;
   }
 
@@ -529,6 +591,17 @@ namespace Avogadro {
                                          const QString &fileName,
                                          const QString &fileType,
                                          QString *error)
+  {
+    OpenBabel::OBMol obMol = molecule->OBMol();
+    return writeConformers(&obMol, molecule->conformers(), fileName, fileType,
+                           error);
+  }
+
+  bool MoleculeFile::writeConformers(OpenBabel::OBMol *obMol,
+                                     const std::vector<std::vector<Eigen::Vector3d>*> &conformers,
+                                     const QString &fileName,
+                                     const QString &fileType,
+                                     QString *error)
   {
     // Check that the file can be written to disk
     if (!canOpen(fileName, QFile::WriteOnly | QFile::Text)) {
@@ -566,24 +639,20 @@ namespace Avogadro {
       return false;
 
     bool success = false;
-    const std::vector<std::vector<Eigen::Vector3d>*> &conformers = molecule->conformers();
-    OpenBabel::OBMol obMol = molecule->OBMol();
     for (unsigned int i = 0; i < conformers.size(); ++i) {
       OpenBabel::OBAtomIterator ai;
-      for (OpenBabel::OBAtom *atom = obMol.BeginAtom(ai); atom; atom = obMol.NextAtom(ai))
+      for (OpenBabel::OBAtom *atom = obMol->BeginAtom(ai); atom; atom = obMol->NextAtom(ai))
         atom->SetVector(conformers.at(i)->at(atom->GetIdx()-1).data());
-      success = conv.Write(&obMol, &ofs);
+      success = conv.Write(obMol, &ofs);
       if (!success)
         break;
       if (fileName.endsWith(QLatin1String("xyz"), Qt::CaseInsensitive))
         ofs << std::endl;
     }
 
-    if (success) {
-      QFile(fileName).remove();
-      newFile.rename(fileName);
+    ofs.close();
+    if (success && replaceFile(newFileName, fileName))
       return true;
-    }
 
     if (error)
       error->append(QObject::tr("Writing conformers to file '%1' failed.").arg(fileName));
@@ -592,6 +661,19 @@ namespace Avogadro {
     return false;
   }
 
+  bool MoleculeFile::replaceFile(const QString &newFileName,
+                                 const QString &fileName)
+  {
+#ifdef Q_OS_WIN
+    return MoveFileExW(reinterpret_cast<const wchar_t *>(newFileName.utf16()),
+                       reinterpret_cast<const wchar_t *>(fileName.utf16()),
+                       MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != 0;
+#else
+    return ::rename(QFile::encodeName(newFileName).constData(),
+                    QFile::encodeName(fileName).constData()) == 0;
+#endif
+  }
+
   MoleculeFile* MoleculeFile::readFile(const QString &fileName,
       const QString &fileType, const QString &fileOptions, bool wait)
   {
@@ -181,12 +181,32 @@ namespace Avogadro {
      * @param fileOptions Newline separated list of options for reading the
      * molecule file, such as bonding.
      * @return The Molecule object loaded, 0 if the file could not be loaded.
+     * @note CIF and mmCIF files are read by CifReader and periodic
+     * trajectories by TrajectoryReader, see their setOptions() for the
+     * options.
      */
     static Molecule * readMolecule(const QString &fileName,
                                    const QString &fileType = QString(),
                                    const QString &fileOptions = QString(),
                                    QString *error = 0);
 
+    /**
+     * Read a molecule from @p device, e.g. a download held in a QBuffer, the
+     * same way as readMolecule() reads a file. You are responsible for
+     * deleting the molecule object.
+     * @param device The device to read from, opened if it is not open yet.
+     * @param fileName The name the molecule is known by, its extension gives
+     * the format unless @p fileType is set.
+     * @param fileType Optional file type parameter.
+     * @param fileOptions Newline separated list of options for reading.
+     * @return The Molecule object loaded, 0 if it could not be loaded.
+     */
+    static Molecule * readMolecule(QIODevice *device,
+                                   const QString &fileName,
+                                   const QString &fileType = QString(),
+                                   const QString &fileOptions = QString(),
+                                   QString *error = 0);
+
     /**
      * Static function to save a single molecule to a file. If writing was
      * unsuccessful, a previously existing file will not be overwritten.
@@ -214,6 +234,9 @@ namespace Avogadro {
      * extension parsing.
      * @param fileOptions Newline separated list of options for writing the
      * molecule file.
+     * The file is written next to @p fileName and moved over it once
+     * complete. Only @p molecule is read, so this can run in a worker thread
+     * on a copy of the molecule being edited.
      * @return True on success, false on failure.
      */
     static bool writeMolecule(const Molecule *molecule,
@@ -222,6 +245,19 @@ namespace Avogadro {
                               const QString &fileOptions,
                               QString *error = 0);
 
+    /**
+     * Static function to save an Open Babel molecule to a file, see the
+     * overload above. Only @p obmol is used, so a copy taken from a Molecule
+     * with Molecule::OBMol() can be written from a worker thread while the
+     * molecule is edited.
+     * @note Chains are perceived on @p obmol if it has no residues.
+     */
+    static bool writeMolecule(OpenBabel::OBMol *obmol,
+                              const QString &fileName,
+                              const QString &fileType,
+                              const QString &fileOptions,
+                              QString *error = 0);
+
     /**
      * Static function to save a all conformers in a molecule to a file. If 
      * writing was unsuccessful, a previously existing file will not be 
@@ -238,6 +274,25 @@ namespace Avogadro {
                                 const QString &fileType = QString(),
                                 QString *error = 0);
 
+    /**
+     * Static function to save each set of coordinates in @p conformers as a
+     * frame of @p obMol, see the overload above. The coordinates of the
+     * atoms in @p obMol are overwritten.
+     */
+    static bool writeConformers(OpenBabel::OBMol *obMol,
+                                const std::vector<std::vector<Eigen::Vector3d>*> &conformers,
+                                const QString &fileName,
+                                const QString &fileType = QString(),
+                                QString *error = 0);
+
+    /**
+     * Move @p newFileName over @p fileName, replacing any existing file in a
+     * single step so that readers (or a crash) never see a partial file.
+     * @return True on success, @p newFileName is left in place otherwise.
+     */
+    static bool replaceFile(const QString &newFileName,
+                            const QString &fileName);
+
     /**
      * Read an entire file, possibly containing multiple molecules in a 
      * separate thread and return a MoleculeFile object with the result.
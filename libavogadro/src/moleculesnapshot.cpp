@@ -0,0 +1,108 @@
+/**********************************************************************
+  MoleculeSnapshot - Immutable, shared view of a Molecule
+
+  Copyright (C) 2013 Avogadro Developers
+
+  This file is part of the Avogadro molecular editor project.
+  For more information, see <http://avogadro.cc/>
+
+  Avogadro is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  Avogadro is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+  02110-1301, USA.
+ **********************************************************************/
+
+#include "moleculesnapshot.h"
+
+#include "molecule.h"
+#include "atom.h"
+#include "bond.h"
+
+namespace Avogadro {
+
+  MoleculeSnapshot::MoleculeSnapshot() : m_version(0), m_numAtoms(0)
+  {
+  }
+
+  unsigned int MoleculeSnapshot::numBonds() const
+  {
+    return m_bonds ? m_bonds->orders.size() : 0;
+  }
+
+  unsigned int MoleculeSnapshot::bondBeginIndex(unsigned int index) const
+  {
+    return m_bonds->atoms.at(2 * index);
+  }
+
+  unsigned int MoleculeSnapshot::bondEndIndex(unsigned int index) const
+  {
+    return m_bonds->atoms.at(2 * index + 1);
+  }
+
+  short MoleculeSnapshot::bondOrder(unsigned int index) const
+  {
+    return m_bonds->orders.at(index);
+  }
+
+  void MoleculeSnapshot::update(const Molecule *molecule, unsigned long version,
+                                const std::vector<bool> &dirtyChunks,
+                                bool dirtyBonds)
+  {
+    const QList<Atom *> atoms = molecule->atoms();
+    const unsigned int numChunks = (atoms.size() + ChunkSize - 1) / ChunkSize;
+    const unsigned int sharedChunks = m_chunks.size();
+    m_chunks.resize(numChunks);
+
+    for (unsigned int c = 0; c < numChunks; ++c) {
+      const unsigned int first = c * ChunkSize;
+      const unsigned int last = qMin(first + ChunkSize,
+                                     static_cast<unsigned int>(atoms.size()));
+      // Chunks that were not touched are shared with the previous snapshot
+      if (c < sharedChunks && c < dirtyChunks.size() && !dirtyChunks[c]
+          && m_chunks[c]->ids.size() == static_cast<int>(last - first))
+        continue;
+
+      Chunk *chunk = new Chunk;
+      chunk->positions.reserve(last - first);
+      chunk->atomicNumbers.reserve(last - first);
+      chunk->ids.reserve(last - first);
+      for (unsigned int i = first; i < last; ++i) {
+        const Atom *atom = atoms.at(i);
+        chunk->positions.push_back(*atom->pos());
+        chunk->atomicNumbers.append(atom->atomicNumber());
+        chunk->ids.append(atom->id());
+      }
+      m_chunks[c] = QSharedPointer<const Chunk>(chunk);
+    }
+
+    if (dirtyBonds || !m_bonds) {
+      Bonds *bonds = new Bonds;
+      const QList<Bond *> bondList = molecule->bonds();
+      bonds->atoms.reserve(2 * bondList.size());
+      bonds->orders.reserve(bondList.size());
+      foreach (const Bond *bond, bondList) {
+        const Atom *begin = bond->beginAtom();
+        const Atom *end = bond->endAtom();
+        if (!begin || !end)
+          continue;
+        bonds->atoms << begin->index() << end->index();
+        bonds->orders << bond->order();
+      }
+      m_bonds = QSharedPointer<const Bonds>(bonds);
+    }
+
+    m_numAtoms = atoms.size();
+    m_version = version;
+  }
+
+} // End namespace Avogadro
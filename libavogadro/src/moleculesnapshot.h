@@ -0,0 +1,183 @@
+/**********************************************************************
+  MoleculeSnapshot - Immutable, shared view of a Molecule
+
+  Copyright (C) 2013 Avogadro Developers
+
+  This file is part of the Avogadro molecular editor project.
+  For more information, see <http://avogadro.cc/>
+
+  Avogadro is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  Avogadro is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+  02110-1301, USA.
+ **********************************************************************/
+
+#ifndef MOLECULESNAPSHOT_H
+#define MOLECULESNAPSHOT_H
+
+#include <avogadro/global.h>
+
+#include <QtCore/QSharedPointer>
+#include <QtCore/QVector>
+
+#include <Eigen/Core>
+
+#include <vector>
+
+namespace Avogadro {
+
+  class Molecule;
+
+  /**
+   * @class MoleculeSnapshot moleculesnapshot.h <avogadro/moleculesnapshot.h>
+   * @brief An immutable view of a Molecule at one version.
+   *
+   * Snapshots are returned by Molecule::snapshot() and hold the atoms (in
+   * index order), their positions in the current conformer and the bonds.
+   * They never change once taken, are cheap to copy and may be handed to
+   * other threads, so long running calculations can work on a consistent
+   * structure while the Molecule is being edited.
+   *
+   * The atoms are stored in fixed size chunks shared between successive
+   * snapshots, only the chunks containing edited atoms are copied when a
+   * new snapshot is taken.
+   */
+  class A_EXPORT MoleculeSnapshot
+  {
+  public:
+    /**
+     * Construct a null snapshot with no atoms.
+     */
+    MoleculeSnapshot();
+
+    /**
+     * @return True if this snapshot was not taken from a Molecule.
+     */
+    bool isNull() const { return m_version == 0; }
+
+    /**
+     * @return The version of the Molecule this snapshot was taken at.
+     * Snapshots with the same version from the same Molecule are identical.
+     */
+    unsigned long version() const { return m_version; }
+
+    /**
+     * @return The number of atoms in the snapshot.
+     */
+    unsigned int numAtoms() const { return m_numAtoms; }
+
+    /**
+     * @return The number of bonds in the snapshot.
+     */
+    unsigned int numBonds() const;
+
+    /**
+     * @return The unique id of the atom at @p index.
+     */
+    unsigned long atomId(unsigned int index) const
+    {
+      return chunk(index).ids[index % ChunkSize];
+    }
+
+    /**
+     * @return The atomic number of the atom at @p index.
+     */
+    int atomicNumber(unsigned int index) const
+    {
+      return chunk(index).atomicNumbers[index % ChunkSize];
+    }
+
+    /**
+     * @return The position of the atom at @p index.
+     */
+    const Eigen::Vector3d & atomPos(unsigned int index) const
+    {
+      return chunk(index).positions[index % ChunkSize];
+    }
+
+    /**
+     * @return The index of the first atom of the bond at @p index.
+     */
+    unsigned int bondBeginIndex(unsigned int index) const;
+
+    /**
+     * @return The index of the second atom of the bond at @p index.
+     */
+    unsigned int bondEndIndex(unsigned int index) const;
+
+    /**
+     * @return The order of the bond at @p index.
+     */
+    short bondOrder(unsigned int index) const;
+
+    /**
+     * @return True if the atom at @p index is in a chunk shared with the
+     * @p other snapshot of the same Molecule, so it is unchanged. A false
+     * return only means the atom may have changed.
+     */
+    bool sharesAtom(const MoleculeSnapshot &other, unsigned int index) const
+    {
+      const int c = index / ChunkSize;
+      return c < m_chunks.size() && c < other.m_chunks.size()
+          && m_chunks.at(c) == other.m_chunks.at(c);
+    }
+
+    /**
+     * @return True if the bonds are shared with the @p other snapshot of the
+     * same Molecule, so they are unchanged.
+     */
+    bool sharesBonds(const MoleculeSnapshot &other) const
+    {
+      return m_bonds && m_bonds == other.m_bonds;
+    }
+
+    /// The number of atoms stored in each shared chunk.
+    static const unsigned int ChunkSize = 256;
+
+  private:
+    friend class Molecule;
+
+    struct Chunk
+    {
+      std::vector<Eigen::Vector3d> positions;
+      QVector<int> atomicNumbers;
+      QVector<unsigned long> ids;
+    };
+
+    struct Bonds
+    {
+      QVector<unsigned int> atoms; // Pairs of atom indices
+      QVector<short> orders;
+    };
+
+    const Chunk & chunk(unsigned int index) const
+    {
+      return *m_chunks.at(index / ChunkSize);
+    }
+
+    /**
+     * Bring this snapshot up to date with @p molecule, rebuilding only the
+     * chunks flagged in @p dirtyChunks and the bonds if @p dirtyBonds.
+     */
+    void update(const Molecule *molecule, unsigned long version,
+                const std::vector<bool> &dirtyChunks, bool dirtyBonds);
+
+    unsigned long m_version;
+    unsigned int m_numAtoms;
+    QVector<QSharedPointer<const Chunk> > m_chunks;
+    QSharedPointer<const Bonds> m_bonds;
+  };
+
+} // End namespace Avogadro
+
+#endif
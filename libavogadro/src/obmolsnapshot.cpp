@@ -0,0 +1,165 @@
+/**********************************************************************
+  OBMolSnapshot - Copy of a Molecule to convert to Open Babel later
+
+  Copyright (C) 2013 Avogadro Developers
+
+  This file is part of the Avogadro molecular editor project.
+  For more information, see <http://avogadro.cc/>
+
+  Avogadro is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  Avogadro is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+  02110-1301, USA.
+ **********************************************************************/
+
+#include "obmolsnapshot.h"
+#include "obmolsnapshot_p.h"
+
+#include "molecule.h"
+
+#include <openbabel/mol.h>
+#include <openbabel/atom.h>
+#include <openbabel/bond.h>
+#include <openbabel/residue.h>
+#include <openbabel/data.h>
+#include <openbabel/generic.h>
+#include <openbabel/griddata.h>
+#include <openbabel/math/vector3.h>
+
+namespace Avogadro {
+
+  namespace {
+    void addPairData(OpenBabel::OBBase *base, const QByteArray &attribute,
+                     const QByteArray &value)
+    {
+      OpenBabel::OBPairData *obproperty = new OpenBabel::OBPairData;
+      obproperty->SetAttribute(attribute.data());
+      obproperty->SetValue(value.data());
+      base->SetData(obproperty);
+    }
+  }
+
+  void OBAtomData::copyTo(OpenBabel::OBAtom *obatom) const
+  {
+    obatom->SetPartialCharge(partialCharge);
+    obatom->SetFormalCharge(formalCharge);
+    for (int i = 0; i < pairData.size(); ++i)
+      addPairData(obatom, pairData.at(i).first, pairData.at(i).second);
+  }
+
+  OBMolSnapshotPrivate::~OBMolSnapshotPrivate()
+  {
+    delete unitCell;
+    qDeleteAll(data);
+  }
+
+  OBMolSnapshot::OBMolSnapshot(const Molecule *molecule)
+    : d(new OBMolSnapshotPrivate)
+  {
+    molecule->copyOBMolData(d);
+  }
+
+  OBMolSnapshot::~OBMolSnapshot()
+  {
+    delete d;
+  }
+
+  MoleculeSnapshot OBMolSnapshot::snapshot() const
+  {
+    return d->snapshot;
+  }
+
+  OpenBabel::OBMol OBMolSnapshot::OBMol() const
+  {
+    const MoleculeSnapshot &snapshot = d->snapshot;
+    OpenBabel::OBMol obmol;
+    obmol.BeginModify();
+
+    for (unsigned int i = 0; i < snapshot.numAtoms(); ++i) {
+      OpenBabel::OBAtom *a = obmol.NewAtom();
+      OpenBabel::OBAtom obatom;
+      const Eigen::Vector3d &pos = snapshot.atomPos(i);
+      obatom.SetVector(pos.x(), pos.y(), pos.z());
+      obatom.SetAtomicNum(snapshot.atomicNumber(i));
+      obatom.SetId(snapshot.atomId(i));
+      d->atoms.at(i).copyTo(&obatom);
+      *a = obatom;
+    }
+    // we are copying partial charges above
+    obmol.SetPartialChargesPerceived();
+
+    for (unsigned int i = 0; i < snapshot.numBonds(); ++i) {
+      obmol.AddBond(snapshot.bondBeginIndex(i) + 1,
+                    snapshot.bondEndIndex(i) + 1, snapshot.bondOrder(i));
+      QHash<unsigned int, QByteArray>::const_iterator label =
+        d->bondLabels.constFind(i);
+      if (label != d->bondLabels.constEnd())
+        addPairData(obmol.GetBond(obmol.NumBonds() - 1), "label", label.value());
+    }
+
+    // Avogadro indexes from 0, but OB from 1. Watch out!
+    foreach (const OBResidueData &residue, d->residues) {
+      OpenBabel::OBResidue *r = obmol.NewResidue();
+      r->SetNum(residue.number);
+      r->SetChain(residue.chain);
+      r->SetName(residue.name);
+      for (int i = 0; i < residue.atoms.size(); ++i) {
+        OpenBabel::OBAtom *a = obmol.GetAtom(residue.atoms.at(i) + 1);
+        r->AddAtom(a);
+        r->SetSerialNum(a, a->GetIdx());
+        if (!residue.atomIds.at(i).isEmpty()) {
+          r->SetAtomID(a, residue.atomIds.at(i).data());
+        }
+        else {
+          r->SetAtomID(a, OpenBabel::etab.GetSymbol(a->GetAtomicNum()));
+          r->SetHetAtom(a, true);
+        }
+      }
+    }
+
+    foreach (const OBCubeData &cube, d->cubes) {
+      OpenBabel::OBGridData *obgrid = new OpenBabel::OBGridData;
+      obgrid->SetOrigin(OpenBabel::fileformatInput);
+      obgrid->SetAttribute(cube.name.data());
+      obgrid->SetUnit(OpenBabel::OBGridData::ANGSTROM);
+      obgrid->SetNumberOfPoints(cube.points.x(), cube.points.y(),
+                                cube.points.z());
+      OpenBabel::vector3 origin(cube.min.x(), cube.min.y(), cube.min.z());
+      OpenBabel::vector3 x(cube.spacing.x(), 0.0, 0.0);
+      OpenBabel::vector3 y(0.0, cube.spacing.y(), 0.0);
+      OpenBabel::vector3 z(0.0, 0.0, cube.spacing.z());
+      obgrid->SetLimits(origin, x, y, z);
+      obgrid->SetValues(cube.values);
+      obmol.SetData(obgrid);
+    }
+
+    obmol.EndModify();
+
+    obmol.SetEnergy(d->energy / KCAL_TO_KJ);
+
+    if (d->unitCell) {
+      OpenBabel::OBUnitCell *obunitcell = new OpenBabel::OBUnitCell;
+      *obunitcell = *d->unitCell;
+      obmol.SetData(obunitcell);
+    }
+
+    for (int i = 0; i < d->properties.size(); ++i)
+      addPairData(&obmol, d->properties.at(i).first, d->properties.at(i).second);
+
+    foreach (const OpenBabel::OBGenericData *data, d->data)
+      obmol.SetData(data->Clone(&obmol));
+
+    return obmol;
+  }
+
+} // End namespace Avogadro
@@ -0,0 +1,78 @@
+/**********************************************************************
+  OBMolSnapshot - Copy of a Molecule to convert to Open Babel later
+
+  Copyright (C) 2013 Avogadro Developers
+
+  This file is part of the Avogadro molecular editor project.
+  For more information, see <http://avogadro.cc/>
+
+  Avogadro is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  Avogadro is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+  02110-1301, USA.
+ **********************************************************************/
+
+#ifndef OBMOLSNAPSHOT_H
+#define OBMOLSNAPSHOT_H
+
+#include <avogadro/global.h>
+#include <avogadro/moleculesnapshot.h>
+
+namespace OpenBabel {
+  class OBMol;
+}
+
+namespace Avogadro {
+
+  class Molecule;
+  class OBMolSnapshotPrivate;
+
+  /**
+   * @class OBMolSnapshot obmolsnapshot.h <avogadro/obmolsnapshot.h>
+   * @brief A copy of everything Molecule::OBMol() converts.
+   *
+   * Taking the copy only copies plain data: the atoms and bonds are shared
+   * with a MoleculeSnapshot, the charges, labels, residues, cubes and
+   * other data are copied as they are. Building the OpenBabel::OBMol, the
+   * costly part, can then be done by another thread while the Molecule is
+   * edited.
+   */
+  class A_EXPORT OBMolSnapshot
+  {
+  public:
+    /**
+     * Copy @p molecule, in the thread owning it.
+     */
+    explicit OBMolSnapshot(const Molecule *molecule);
+    ~OBMolSnapshot();
+
+    /**
+     * @return The snapshot of the atoms and bonds.
+     */
+    MoleculeSnapshot snapshot() const;
+
+    /**
+     * @return The copy converted to an OpenBabel::OBMol as by
+     * Molecule::OBMol(). Can be called from any thread.
+     */
+    OpenBabel::OBMol OBMol() const;
+
+  private:
+    Q_DISABLE_COPY(OBMolSnapshot)
+
+    OBMolSnapshotPrivate * const d;
+  };
+
+} // End namespace Avogadro
+
+#endif
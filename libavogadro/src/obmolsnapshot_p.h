@@ -0,0 +1,108 @@
+/**********************************************************************
+  OBMolSnapshot - Copy of a Molecule to convert to Open Babel later
+
+  Copyright (C) 2013 Avogadro Developers
+
+  This file is part of the Avogadro molecular editor project.
+  For more information, see <http://avogadro.cc/>
+
+  Avogadro is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  Avogadro is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+  02110-1301, USA.
+ **********************************************************************/
+
+#ifndef OBMOLSNAPSHOT_P_H
+#define OBMOLSNAPSHOT_P_H
+
+#include <avogadro/moleculesnapshot.h>
+
+#include <QtCore/QByteArray>
+#include <QtCore/QHash>
+#include <QtCore/QList>
+#include <QtCore/QPair>
+#include <QtCore/QVector>
+
+#include <Eigen/Core>
+
+#include <string>
+#include <vector>
+
+namespace OpenBabel {
+  class OBAtom;
+  class OBGenericData;
+  class OBUnitCell;
+}
+
+namespace Avogadro {
+
+  typedef QList<QPair<QByteArray, QByteArray> > OBPairDataList;
+
+  /**
+   * What Atom::OBAtom() writes besides the element, id and position, which
+   * are in the MoleculeSnapshot.
+   */
+  struct OBAtomData
+  {
+    OBAtomData() : partialCharge(0.0), formalCharge(0) {}
+
+    /**
+     * Copy the charges and the pair data to @p obatom.
+     */
+    void copyTo(OpenBabel::OBAtom *obatom) const;
+
+    double partialCharge;
+    int formalCharge;
+    // The custom label, color and radius and the dynamic properties
+    OBPairDataList pairData;
+  };
+
+  struct OBResidueData
+  {
+    std::string number;
+    char chain;
+    std::string name;
+    QVector<unsigned int> atoms; // Indices in the snapshot
+    QVector<QByteArray> atomIds; // Empty for hetero atoms
+  };
+
+  struct OBCubeData
+  {
+    QByteArray name;
+    Eigen::Vector3i points;
+    Eigen::Vector3d min;
+    Eigen::Vector3d spacing;
+    std::vector<double> values;
+  };
+
+  class OBMolSnapshotPrivate
+  {
+  public:
+    OBMolSnapshotPrivate() : energy(0.0), unitCell(0) {}
+    ~OBMolSnapshotPrivate();
+
+    MoleculeSnapshot snapshot;
+    QVector<OBAtomData> atoms; // In the order of the snapshot
+    QHash<unsigned int, QByteArray> bondLabels; // By snapshot bond index
+    QList<OBResidueData> residues;
+    QList<OBCubeData> cubes;
+    double energy;
+    OpenBabel::OBUnitCell *unitCell;
+    OBPairDataList properties;
+    // Vibrations, density of states and electronic transitions
+    QList<OpenBabel::OBGenericData *> data;
+  };
+
+} // End namespace Avogadro
+
+#endif
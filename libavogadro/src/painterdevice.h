@@ -26,6 +26,7 @@
 #define PAINTERDEVICE_H
 
 #include <avogadro/painter.h>
+#include <avogadro/atom.h>
 
 namespace Avogadro {
 
@@ -46,6 +47,14 @@ namespace Avogadro {
     virtual bool isSelected( const Primitive *p ) const = 0;
     virtual double radius( const Primitive *p ) const = 0;
     virtual const Molecule *molecule() const = 0;
+    /**
+     * @return The position of @p atom to draw. Devices drawing a frame
+     * captured earlier return the position the atom had then.
+     */
+    virtual const Eigen::Vector3d * atomPos(const Atom *atom) const
+    {
+      return atom->pos();
+    }
     virtual Color* colorMap() const = 0;
     virtual PrimitiveList * primitives() const { return 0; }
 
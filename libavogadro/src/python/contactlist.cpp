@@ -0,0 +1,53 @@
+#include <boost/python.hpp>
+
+#include <avogadro/contactlist.h>
+#include <avogadro/molecule.h>
+
+using namespace boost::python;
+using namespace Avogadro;
+
+// The contacts as a list of (first, second, distance) tuples of atom indices
+list contactlist_contacts(ContactList &self)
+{
+  list result;
+  const std::vector<ContactList::Contact> &contacts = self.contacts();
+  for (size_t i = 0; i < contacts.size(); ++i)
+    result.append(make_tuple(contacts[i].first, contacts[i].second,
+                             contacts[i].distance));
+  return result;
+}
+
+void export_ContactList()
+{
+
+  class_<Avogadro::ContactList, boost::noncopyable>("ContactList")
+    // constructors
+    .def(init<const Molecule*>())
+
+    //
+    // properties
+    //
+    .add_property("fraction",
+        &ContactList::fraction,
+        &ContactList::setFraction,
+        "Atoms closer than this fraction of the sum of their van der Waals "
+        "radii are in contact.")
+
+    //
+    // real functions
+    //
+    .def("setMolecule",
+        &ContactList::setMolecule,
+        "Find the contacts of another molecule.")
+
+    .def("update",
+        &ContactList::update,
+        "Bring the contacts up to date with the molecule, only the atoms "
+        "that moved are searched again. Returns True if the contacts changed.")
+
+    .def("contacts",
+        &contactlist_contacts,
+        "The contacts as a list of (index, index, distance) tuples.")
+    ;
+
+}
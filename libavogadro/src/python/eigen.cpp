@@ -9,7 +9,9 @@
 #include <avogadro/global.h>
 #include <Eigen/Geometry>
 
+#include <cstring>
 #include <iostream>
+#include <vector>
 
 using namespace boost::python;
 
@@ -486,6 +488,66 @@ class EigenUnitTestHelper
 };
 #endif
 
+/*
+ * NumPy arrays for the atom attribute columns, used in molecule.cpp as only
+ * this file may call the NumPy C API (import_array)
+ */
+
+PyObject* doubleVectorToArray(const std::vector<double> &values)
+{
+  npy_intp dims[1] = { static_cast<npy_intp>(values.size()) };
+  PyObject *result = PyArray_SimpleNew(1, dims, NPY_DOUBLE);
+  PyArrayObject *array = reinterpret_cast<PyArrayObject*>(result);
+  if (!values.empty())
+    memcpy(PyArray_DATA(array), &values[0], values.size() * sizeof(double));
+  return result;
+}
+
+PyObject* intVectorToArray(const std::vector<int> &values)
+{
+  npy_intp dims[1] = { static_cast<npy_intp>(values.size()) };
+  PyObject *result = PyArray_SimpleNew(1, dims, NPY_INT);
+  PyArrayObject *array = reinterpret_cast<PyArrayObject*>(result);
+  if (!values.empty())
+    memcpy(PyArray_DATA(array), &values[0], values.size() * sizeof(int));
+  return result;
+}
+
+bool isIntArray(PyObject *obj)
+{
+  return PyArray_Check(obj)
+      && PyArray_ISINTEGER(reinterpret_cast<PyArrayObject*>(obj));
+}
+
+/*
+ * Copy a one dimensional array, or any sequence of numbers, in one go.
+ * Returns false, without a Python error set, if obj is not one.
+ */
+template <typename Scalar>
+bool arrayToVector(PyObject *obj, int type, std::vector<Scalar> &values)
+{
+  PyObject *array = PyArray_ContiguousFromObject(obj, type, 1, 1);
+  if (!array) {
+    PyErr_Clear();
+    return false;
+  }
+  PyArrayObject *a = reinterpret_cast<PyArrayObject*>(array);
+  const Scalar *data = reinterpret_cast<const Scalar*>(PyArray_DATA(a));
+  values.assign(data, data + PyArray_DIM(a, 0));
+  Py_DECREF(array);
+  return true;
+}
+
+bool arrayToDoubleVector(PyObject *obj, std::vector<double> &values)
+{
+  return arrayToVector(obj, NPY_DOUBLE, values);
+}
+
+bool arrayToIntVector(PyObject *obj, std::vector<int> &values)
+{
+  return arrayToVector(obj, NPY_INT, values);
+}
+
 void export_Eigen()
 {
   import_array(); // needed for NumPy 
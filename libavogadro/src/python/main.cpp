@@ -16,6 +16,7 @@ void export_Atom();
 void export_Bond();
 void export_Camera();
 void export_Color();
+void export_ContactList();
 void export_Cube();
 void export_ElementTranslator();
 void export_Engine();
@@ -37,8 +38,11 @@ void export_PluginManager();
 void export_Primitive();
 void export_PrimitiveList();
 void export_Residue();
+void export_SelectionQuery();
+void export_SurfaceArea();
 void export_Tool();
 void export_ToolGroup();
+void export_TrajectorySpectrum();
 
 BOOST_PYTHON_MODULE(Avogadro) {
 
@@ -64,6 +68,7 @@ BOOST_PYTHON_MODULE(Avogadro) {
   export_Bond();
   export_Camera();
   export_Color();
+  export_ContactList();
   export_Cube();
   export_ElementTranslator();
   export_Engine();
@@ -83,8 +88,11 @@ BOOST_PYTHON_MODULE(Avogadro) {
   export_PluginManager();
   export_PrimitiveList();
   export_Residue();
+  export_SelectionQuery();
+  export_SurfaceArea();
   export_Tool();
   export_ToolGroup();
+  export_TrajectorySpectrum();
 
 
 
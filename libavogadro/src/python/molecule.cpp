@@ -12,6 +12,8 @@
 
 #include <openbabel/mol.h>
 
+#include <QStringList>
+
 using namespace boost::python;
 using namespace Avogadro;
 
@@ -43,6 +45,50 @@ double energy(Molecule &self)
   return self.energy();
 }
 
+// defined in eigen.cpp
+PyObject* doubleVectorToArray(const std::vector<double> &values);
+PyObject* intVectorToArray(const std::vector<int> &values);
+bool isIntArray(PyObject *obj);
+bool arrayToDoubleVector(PyObject *obj, std::vector<double> &values);
+bool arrayToIntVector(PyObject *obj, std::vector<int> &values);
+
+// Integer arrays give int columns, other numbers float columns and a
+// sequence of strings a string column
+bool setAtomAttribute(Molecule &self, const QString &name, object values)
+{
+  if (isIntArray(values.ptr())) {
+    std::vector<int> ints;
+    if (arrayToIntVector(values.ptr(), ints))
+      return self.setAtomAttribute(name, ints);
+  }
+
+  std::vector<double> floats;
+  if (arrayToDoubleVector(values.ptr(), floats))
+    return self.setAtomAttribute(name, floats);
+
+  QStringList strings;
+  const int size = len(values);
+  for (int i = 0; i < size; ++i) {
+    QString value = extract<QString>(values[i]);
+    strings.append(value);
+  }
+  return self.setAtomAttribute(name, strings);
+}
+
+object atomAttribute(const Molecule &self, const QString &name)
+{
+  switch (self.atomAttributeType(name)) {
+  case Molecule::FloatAttribute:
+    return object(handle<>(doubleVectorToArray(self.atomFloatAttribute(name))));
+  case Molecule::IntAttribute:
+    return object(handle<>(intVectorToArray(self.atomIntAttribute(name))));
+  case Molecule::StringAttribute:
+    return object(self.atomStringAttribute(name));
+  default:
+    return object();
+  }
+}
+
 void export_Molecule()
 {
 
@@ -355,6 +401,22 @@ void export_Molecule()
     .def("setEnergy",
         setEnergy_ptr2,
         "Set the energy for the specified conformer.")
+    // atom attributes
+    .def("setAtomAttribute",
+        &setAtomAttribute,
+        "Set the named atom attribute column to a NumPy array or a list of "
+        "strings with one value per atom. Returns False if the number of "
+        "values is wrong.")
+    .def("atomAttribute",
+        &atomAttribute,
+        "The named atom attribute column as a NumPy array or a list of "
+        "strings, None if there is no such column.")
+    .def("removeAtomAttribute",
+        &Molecule::removeAtomAttribute,
+        "Remove the named atom attribute column.")
+    .add_property("atomAttributeNames",
+        &Molecule::atomAttributeNames,
+        "The names of all atom attribute columns.")
     // general functions
     .def("addHydrogens",
         &addHydrogens1,
@@ -0,0 +1,58 @@
+#include <boost/python.hpp>
+
+#include <avogadro/selectionquery.h>
+#include <avogadro/molecule.h>
+#include <avogadro/atom.h>
+
+using namespace boost::python;
+using namespace Avogadro;
+
+// The selection as a list of atom indices, QBitArray has no converter
+QList<unsigned long> selectionquery_indices(SelectionQuery &self, Molecule *molecule)
+{
+  QList<unsigned long> indices;
+  const QBitArray bits = self.evaluate(molecule);
+  for (int i = 0; i < bits.size(); ++i)
+    if (bits.testBit(i))
+      indices.append(i);
+  return indices;
+}
+
+void export_SelectionQuery()
+{
+
+  class_<Avogadro::SelectionQuery, boost::noncopyable>("SelectionQuery")
+    // constructors
+    .def(init<const QString&>())
+
+    //
+    // properties
+    //
+    .add_property("expression",
+        &SelectionQuery::expression,
+        "The selection expression.")
+    .add_property("valid",
+        &SelectionQuery::isValid,
+        "True if the expression was parsed.")
+    .add_property("errorString",
+        &SelectionQuery::errorString,
+        "The reason the expression could not be parsed.")
+
+    //
+    // real functions
+    //
+    .def("setExpression",
+        &SelectionQuery::setExpression,
+        "Parse an expression such as \"protein and within 5 of resname LIG\", "
+        "returns False if it is not valid.")
+
+    .def("atoms",
+        &SelectionQuery::atoms,
+        "The atoms of the molecule selected.")
+
+    .def("indices",
+        &selectionquery_indices,
+        "The indices of the atoms of the molecule selected.")
+    ;
+
+}
@@ -0,0 +1,80 @@
+#include <boost/python.hpp>
+
+#include <avogadro/surfacearea.h>
+#include <avogadro/molecule.h>
+
+using namespace boost::python;
+using namespace Avogadro;
+
+// defined in eigen.cpp
+PyObject* doubleVectorToArray(const std::vector<double> &values);
+
+object surfacearea_atomAreas(SurfaceArea &self)
+{
+  return object(handle<>(doubleVectorToArray(self.atomAreas())));
+}
+
+object surfacearea_residueAreas(SurfaceArea &self)
+{
+  return object(handle<>(doubleVectorToArray(self.residueAreas())));
+}
+
+object surfacearea_conformerAreas(SurfaceArea &self, const Molecule *molecule)
+{
+  return object(handle<>(doubleVectorToArray(self.conformerAreas(molecule))));
+}
+
+bool surfacearea_calculate(SurfaceArea &self, const Molecule *molecule)
+{
+  return self.calculate(molecule);
+}
+
+void export_SurfaceArea()
+{
+
+  class_<Avogadro::SurfaceArea, boost::noncopyable>("SurfaceArea")
+
+    //
+    // properties
+    //
+    .add_property("probeRadius",
+        &SurfaceArea::probeRadius,
+        &SurfaceArea::setProbeRadius,
+        "The radius of the solvent probe in Angstrom, 0 for the van der "
+        "Waals surface.")
+
+    .add_property("pointCount",
+        &SurfaceArea::pointCount,
+        &SurfaceArea::setPointCount,
+        "The number of points on each atom sphere.")
+
+    .add_property("atomAreas",
+        &surfacearea_atomAreas,
+        "The accessible area of each atom as a numpy array.")
+
+    .add_property("residueAreas",
+        &surfacearea_residueAreas,
+        "The accessible area of each residue as a numpy array.")
+
+    .add_property("totalArea",
+        &SurfaceArea::totalArea,
+        "The total accessible area.")
+
+    .add_property("volume",
+        &SurfaceArea::volume,
+        "The volume enclosed by the surface.")
+
+    //
+    // real functions
+    //
+    .def("calculate",
+        &surfacearea_calculate,
+        "Calculate the areas of the atoms of a molecule.")
+
+    .def("conformerAreas",
+        &surfacearea_conformerAreas,
+        "The total area of each conformer of a molecule as a numpy array, "
+        "e.g. a time series over a trajectory.")
+    ;
+
+}
@@ -0,0 +1,98 @@
+#include <boost/python.hpp>
+
+#include <avogadro/trajectoryspectrum.h>
+#include <avogadro/molecule.h>
+
+using namespace boost::python;
+using namespace Avogadro;
+
+// defined in eigen.cpp
+PyObject* doubleVectorToArray(const std::vector<double> &values);
+
+object trajectoryspectrum_autocorrelation(TrajectorySpectrum &self)
+{
+  return object(handle<>(doubleVectorToArray(self.autocorrelation())));
+}
+
+object trajectoryspectrum_frequencies(TrajectorySpectrum &self)
+{
+  return object(handle<>(doubleVectorToArray(self.frequencies())));
+}
+
+object trajectoryspectrum_intensities(TrajectorySpectrum &self)
+{
+  return object(handle<>(doubleVectorToArray(self.intensities())));
+}
+
+void export_TrajectorySpectrum()
+{
+
+  enum_<TrajectorySpectrum::Type>("SpectrumType")
+    .value("PowerSpectrum", TrajectorySpectrum::PowerSpectrum)
+    .value("InfraredSpectrum", TrajectorySpectrum::InfraredSpectrum)
+    ;
+
+  enum_<TrajectorySpectrum::Window>("SpectrumWindow")
+    .value("NoWindow", TrajectorySpectrum::NoWindow)
+    .value("HannWindow", TrajectorySpectrum::HannWindow)
+    .value("BlackmanWindow", TrajectorySpectrum::BlackmanWindow)
+    ;
+
+  enum_<TrajectorySpectrum::Correction>("SpectrumCorrection")
+    .value("NoCorrection", TrajectorySpectrum::NoCorrection)
+    .value("HarmonicCorrection", TrajectorySpectrum::HarmonicCorrection)
+    .value("SchofieldCorrection", TrajectorySpectrum::SchofieldCorrection)
+    ;
+
+  class_<Avogadro::TrajectorySpectrum, boost::noncopyable>("TrajectorySpectrum")
+
+    //
+    // properties
+    //
+    .add_property("timeStep",
+        &TrajectorySpectrum::timeStep,
+        &TrajectorySpectrum::setTimeStep,
+        "The time between the conformers in femtoseconds.")
+
+    .add_property("correlationLength",
+        &TrajectorySpectrum::correlationLength,
+        &TrajectorySpectrum::setCorrelationLength,
+        "The number of frames of the correlation function, 0 for half of "
+        "the frames.")
+
+    .add_property("window",
+        &TrajectorySpectrum::window,
+        &TrajectorySpectrum::setWindow,
+        "The window applied to the correlation function.")
+
+    .add_property("correction",
+        &TrajectorySpectrum::correction,
+        &TrajectorySpectrum::setCorrection,
+        "The quantum correction factor.")
+
+    .add_property("temperature",
+        &TrajectorySpectrum::temperature,
+        &TrajectorySpectrum::setTemperature,
+        "The temperature in Kelvin for the quantum correction.")
+
+    .add_property("autocorrelation",
+        &trajectoryspectrum_autocorrelation,
+        "The normalized autocorrelation function as a numpy array.")
+
+    .add_property("frequencies",
+        &trajectoryspectrum_frequencies,
+        "The wavenumbers of the spectrum in cm^-1 as a numpy array.")
+
+    .add_property("intensities",
+        &trajectoryspectrum_intensities,
+        "The intensities of the spectrum as a numpy array.")
+
+    //
+    // real functions
+    //
+    .def("calculate",
+        &TrajectorySpectrum::calculate,
+        "Calculate the spectrum from the conformers of a molecule.")
+    ;
+
+}
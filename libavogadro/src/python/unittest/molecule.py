@@ -363,6 +363,25 @@ class TestMolecule(unittest.TestCase):
     vec = array([1., 2., 3.])
     self.molecule.translate(vec)
 
+  def test_atomAttribute(self):
+    for i in range(3):
+      self.molecule.addAtom()
+
+    self.assertTrue(self.molecule.setAtomAttribute("bfactor", array([1.5, 2.5, 3.5])))
+    self.assertTrue(self.molecule.setAtomAttribute("count", array([1, 2, 3])))
+    self.assertTrue(self.molecule.setAtomAttribute("label", ["a", "b", "c"]))
+    self.assertFalse(self.molecule.setAtomAttribute("short", array([1.0])))
+
+    self.assertEqual(self.molecule.atomAttribute("bfactor")[1], 2.5)
+    self.assertEqual(self.molecule.atomAttribute("count")[2], 3)
+    self.assertEqual(self.molecule.atomAttribute("label")[0], "a")
+    self.assertEqual(self.molecule.atomAttribute("short"), None)
+    self.assertEqual(len(self.molecule.atomAttributeNames), 3)
+
+    self.molecule.removeAtom(self.molecule.atom(0))
+    self.assertEqual(len(self.molecule.atomAttribute("bfactor")), 2)
+    self.assertEqual(self.molecule.atomAttribute("bfactor")[0], 2.5)
+
 
 
 
@@ -0,0 +1,883 @@
+/**********************************************************************
+  SelectionQuery - Compiled atom selection expressions
+
+  Copyright (C) 2013 Avogadro Developers
+
+  This file is part of the Avogadro molecular editor project.
+  For more information, see <http://avogadro.cc/>
+
+  Avogadro is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  Avogadro is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+  02110-1301, USA.
+ **********************************************************************/
+
+#include "selectionquery.h"
+
+#include <avogadro/molecule.h>
+#include <avogadro/atom.h>
+#include <avogadro/residue.h>
+
+#include <openbabel/data.h>
+
+#include <Eigen/Core>
+
+#include <QPair>
+#include <QRegExp>
+#include <QSet>
+#include <QStringList>
+
+#include <algorithm>
+#include <cmath>
+#include <utility>
+#include <vector>
+
+using Eigen::Vector3d;
+
+namespace Avogadro {
+
+  namespace {
+
+    enum NodeType {
+      AllNode,
+      NoneNode,
+      IndexNode,
+      ElementNode,
+      ChainNode,
+      ResNameNode,
+      ResIdNode,
+      ProteinNode,
+      WaterNode,
+      NameNode,
+      BackboneNode,
+      NotNode,
+      AndNode,
+      OrNode,
+      SameResidueNode,
+      WithinNode
+    };
+
+    typedef QPair<int, int> Range;
+
+    struct SelectionNode
+    {
+      explicit SelectionNode(NodeType nodeType) : type(nodeType),
+        distance(0.0), cost(1) { }
+      ~SelectionNode() { qDeleteAll(children); }
+
+      NodeType type;
+      QList<SelectionNode *> children;
+      QStringList values;        // names, residue names and chains
+      QList<QRegExp> patterns;   // values with wildcards
+      QList<Range> ranges;       // indices and residue numbers
+      QBitArray elements;        // by atomic number
+      double distance;
+      int cost;
+    };
+
+    bool cheaperThan(const SelectionNode *a, const SelectionNode *b)
+    {
+      return a->cost < b->cost;
+    }
+
+    /**
+     * The values of one node matched against the names of the atoms or
+     * residues, exactly or by the wildcard patterns.
+     */
+    bool matches(const SelectionNode *node, const QString &name)
+    {
+      if (node->values.contains(name))
+        return true;
+      foreach (const QRegExp &pattern, node->patterns)
+        if (pattern.exactMatch(name))
+          return true;
+      return false;
+    }
+
+    bool inRanges(const QList<Range> &ranges, int value)
+    {
+      foreach (const Range &range, ranges)
+        if (value >= range.first && value <= range.second)
+          return true;
+      return false;
+    }
+
+    QSet<QString> aminoAcids()
+    {
+      static const char *names[] = {
+        "ALA", "ARG", "ASN", "ASP", "CYS", "GLN", "GLU", "GLY", "HIS", "ILE",
+        "LEU", "LYS", "MET", "PHE", "PRO", "SER", "THR", "TRP", "TYR", "VAL",
+        "ASH", "CYX", "GLH", "HID", "HIE", "HIP", "HSD", "HSE", "HSP", "LYN",
+        "MSE", "SEC", "PYL", 0 };
+      QSet<QString> set;
+      for (int i = 0; names[i]; ++i)
+        set.insert(names[i]);
+      return set;
+    }
+
+    QSet<QString> waters()
+    {
+      QSet<QString> set;
+      set << "HOH" << "WAT" << "H2O" << "DOD" << "SOL" << "TIP" << "TIP3"
+          << "TIP4" << "SPC";
+      return set;
+    }
+
+    /**
+     * Recursive descent parser of the expression tokens.
+     */
+    class SelectionParser
+    {
+    public:
+      explicit SelectionParser(const QStringList &tokens) : m_tokens(tokens),
+        m_pos(0) { }
+
+      SelectionNode * parse();
+      QString error() const { return m_error; }
+
+    private:
+      SelectionNode * parseOr();
+      SelectionNode * parseAnd();
+      SelectionNode * parseNot();
+      SelectionNode * parseTerm();
+      SelectionNode * fail(const QString &error, SelectionNode *node = 0);
+
+      QString peek() const { return m_tokens.value(m_pos).toLower(); }
+      bool atEnd() const { return m_pos >= m_tokens.size(); }
+      bool atValue() const;
+      QStringList values();
+      bool ranges(QList<Range> &ranges);
+
+      QStringList m_tokens;
+      int m_pos;
+      QString m_error;
+    };
+
+    SelectionNode * SelectionParser::fail(const QString &error,
+                                          SelectionNode *node)
+    {
+      if (m_error.isEmpty())
+        m_error = error;
+      delete node;
+      return 0;
+    }
+
+    bool SelectionParser::atValue() const
+    {
+      const QString token = peek();
+      return !atEnd() && token != "and" && token != "or" && token != "not"
+        && token != "(" && token != ")";
+    }
+
+    QStringList SelectionParser::values()
+    {
+      QStringList list;
+      while (atValue())
+        list.append(m_tokens.at(m_pos++));
+      return list;
+    }
+
+    // Ranges as 5, 5-10 or 5:10
+    bool SelectionParser::ranges(QList<Range> &ranges)
+    {
+      foreach (const QString &value, values()) {
+        const int separator = value.indexOf(QRegExp("[:-]"), 1);
+        bool ok1 = true;
+        bool ok2 = true;
+        const int first = (separator < 0 ? value : value.left(separator)).toInt(&ok1);
+        const int last = separator < 0 ? first : value.mid(separator + 1).toInt(&ok2);
+        if (!ok1 || !ok2) {
+          m_error = QObject::tr("\"%1\" is not a number or a range.").arg(value);
+          return false;
+        }
+        ranges.append(Range(first, last));
+      }
+      return !ranges.isEmpty();
+    }
+
+    SelectionNode * SelectionParser::parse()
+    {
+      SelectionNode *node = parseOr();
+      if (node && !atEnd())
+        return fail(QObject::tr("Unexpected \"%1\".").arg(m_tokens.at(m_pos)), node);
+      return node;
+    }
+
+    SelectionNode * SelectionParser::parseOr()
+    {
+      SelectionNode *node = parseAnd();
+      while (node && peek() == "or") {
+        ++m_pos;
+        SelectionNode *right = parseAnd();
+        if (!right)
+          return fail(QString(), node);
+        SelectionNode *parent = new SelectionNode(OrNode);
+        parent->children << node << right;
+        node = parent;
+      }
+      return node;
+    }
+
+    SelectionNode * SelectionParser::parseAnd()
+    {
+      SelectionNode *node = parseNot();
+      while (node && peek() == "and") {
+        ++m_pos;
+        SelectionNode *right = parseNot();
+        if (!right)
+          return fail(QString(), node);
+        SelectionNode *parent = new SelectionNode(AndNode);
+        parent->children << node << right;
+        node = parent;
+      }
+      return node;
+    }
+
+    SelectionNode * SelectionParser::parseNot()
+    {
+      if (peek() != "not")
+        return parseTerm();
+      ++m_pos;
+      SelectionNode *child = parseNot();
+      if (!child)
+        return 0;
+      SelectionNode *node = new SelectionNode(NotNode);
+      node->children << child;
+      return node;
+    }
+
+    SelectionNode * SelectionParser::parseTerm()
+    {
+      if (atEnd())
+        return fail(QObject::tr("Unexpected end of the expression."));
+
+      const QString keyword = peek();
+      const QString token = m_tokens.at(m_pos++);
+      if (keyword == "(") {
+        SelectionNode *node = parseOr();
+        if (node && peek() != ")")
+          return fail(QObject::tr("Missing \")\"."), node);
+        ++m_pos;
+        return node;
+      }
+      if (keyword == "all" || keyword == "everything")
+        return new SelectionNode(AllNode);
+      if (keyword == "none" || keyword == "nothing")
+        return new SelectionNode(NoneNode);
+      if (keyword == "protein")
+        return new SelectionNode(ProteinNode);
+      if (keyword == "water" || keyword == "waters" || keyword == "solvent")
+        return new SelectionNode(WaterNode);
+      if (keyword == "backbone")
+        return new SelectionNode(BackboneNode);
+
+      if (keyword == "element" || keyword == "hydrogen") {
+        SelectionNode *node = new SelectionNode(ElementNode);
+        node->elements.resize(256);
+        const QStringList symbols = keyword == "hydrogen" ? QStringList("H") : values();
+        if (symbols.isEmpty())
+          return fail(QObject::tr("\"element\" needs at least one element."), node);
+        foreach (const QString &symbol, symbols) {
+          bool ok;
+          int number = symbol.toInt(&ok);
+          if (!ok) {
+            const QString name = symbol.left(1).toUpper() + symbol.mid(1).toLower();
+            number = OpenBabel::etab.GetAtomicNum(name.toAscii().constData());
+            ok = number > 0;
+          }
+          if (!ok || number < 0 || number > 255)
+            return fail(QObject::tr("Unknown element \"%1\".").arg(symbol), node);
+          node->elements.setBit(number);
+        }
+        return node;
+      }
+
+      if (keyword == "name" || keyword == "resname" || keyword == "chain") {
+        SelectionNode *node = new SelectionNode(keyword == "name" ? NameNode
+          : (keyword == "resname" ? ResNameNode : ChainNode));
+        foreach (const QString &value, values()) {
+          if (value.contains('*') || value.contains('?'))
+            node->patterns.append(QRegExp(value, Qt::CaseSensitive, QRegExp::Wildcard));
+          else
+            node->values.append(value);
+        }
+        if (node->values.isEmpty() && node->patterns.isEmpty())
+          return fail(QObject::tr("\"%1\" needs at least one value.").arg(token), node);
+        return node;
+      }
+
+      if (keyword == "resid" || keyword == "resnum" || keyword == "index") {
+        SelectionNode *node = new SelectionNode(keyword == "index" ? IndexNode
+                                                : ResIdNode);
+        if (!ranges(node->ranges))
+          return fail(QObject::tr("\"%1\" needs at least one number.").arg(token), node);
+        return node;
+      }
+
+      if (keyword == "within") {
+        bool ok;
+        const double distance = m_tokens.value(m_pos++).toDouble(&ok);
+        if (!ok || distance < 0.0 || peek() != "of")
+          return fail(QObject::tr("Expected \"within <distance> of\"."));
+        ++m_pos;
+        SelectionNode *child = parseNot();
+        if (!child)
+          return 0;
+        SelectionNode *node = new SelectionNode(WithinNode);
+        node->distance = distance;
+        node->children << child;
+        return node;
+      }
+
+      if (keyword == "same") {
+        if (peek() != "residue" || m_tokens.value(m_pos + 1).toLower() != "as")
+          return fail(QObject::tr("Expected \"same residue as\"."));
+        m_pos += 2;
+        SelectionNode *child = parseNot();
+        if (!child)
+          return 0;
+        SelectionNode *node = new SelectionNode(SameResidueNode);
+        node->children << child;
+        return node;
+      }
+
+      return fail(QObject::tr("Unknown keyword \"%1\".").arg(token));
+    }
+
+    /**
+     * Split @p expression at white space and parentheses, quotes keep
+     * values with spaces together.
+     */
+    QStringList tokenize(const QString &expression)
+    {
+      QStringList tokens;
+      QString token;
+      QChar quote;
+      for (int i = 0; i < expression.size(); ++i) {
+        const QChar c = expression.at(i);
+        if (!quote.isNull()) {
+          if (c == quote) {
+            tokens.append(token);
+            token.clear();
+            quote = QChar();
+          }
+          else
+            token += c;
+        }
+        else if (c == '"' || c == '\'')
+          quote = c;
+        else if (c.isSpace() || c == '(' || c == ')') {
+          if (!token.isEmpty())
+            tokens.append(token);
+          token.clear();
+          if (!c.isSpace())
+            tokens.append(QString(c));
+        }
+        else
+          token += c;
+      }
+      if (!token.isEmpty())
+        tokens.append(token);
+      return tokens;
+    }
+
+    /**
+     * The query planner: nested "and" and "or" nodes are merged and their
+     * terms sorted by cost, so that the cheap terms narrow down the atoms
+     * the expensive ones look at.
+     */
+    void plan(SelectionNode *node)
+    {
+      foreach (SelectionNode *child, node->children)
+        plan(child);
+
+      if (node->type == AndNode || node->type == OrNode) {
+        QList<SelectionNode *> children;
+        foreach (SelectionNode *child, node->children) {
+          if (child->type == node->type) {
+            children += child->children;
+            child->children.clear();
+            delete child;
+          }
+          else
+            children.append(child);
+        }
+        node->children = children;
+        qStableSort(node->children.begin(), node->children.end(), cheaperThan);
+      }
+
+      switch (node->type) {
+      case AllNode:
+      case NoneNode:
+      case IndexNode:
+      case ElementNode:
+        node->cost = 1;
+        break;
+      case ChainNode:
+      case ResNameNode:
+      case ResIdNode:
+      case ProteinNode:
+      case WaterNode:
+        node->cost = 2;
+        break;
+      case NameNode:
+      case BackboneNode:
+        node->cost = 3;
+        break;
+      case NotNode:
+      case AndNode:
+      case OrNode:
+        node->cost = 0;
+        foreach (SelectionNode *child, node->children)
+          node->cost += child->cost;
+        break;
+      case SameResidueNode:
+        node->cost = 5 + node->children.first()->cost;
+        break;
+      case WithinNode:
+        node->cost = 20 + node->children.first()->cost;
+        break;
+      }
+    }
+
+    // What evaluating a tree needs to know about the atoms
+    enum Columns {
+      ResidueColumn = 0x1,
+      NameColumn = 0x2,
+      PositionColumn = 0x4
+    };
+
+    int columns(const SelectionNode *node)
+    {
+      int result = 0;
+      switch (node->type) {
+      case ChainNode:
+      case ResNameNode:
+      case ResIdNode:
+      case ProteinNode:
+      case WaterNode:
+      case SameResidueNode:
+        result = ResidueColumn;
+        break;
+      case NameNode:
+      case BackboneNode:
+        result = ResidueColumn | NameColumn;
+        break;
+      case WithinNode:
+        result = PositionColumn;
+        break;
+      default:
+        break;
+      }
+      foreach (const SelectionNode *child, node->children)
+        result |= columns(child);
+      return result;
+    }
+
+    /**
+     * The atom properties as arrays, only the columns the query needs are
+     * filled.
+     */
+    struct AtomTable
+    {
+      AtomTable(const Molecule *molecule, int columns);
+
+      int size;
+      std::vector<int> atomicNumbers;
+      std::vector<int> residues;   // index in residueList, -1 if none
+      std::vector<QString> names;
+      std::vector<Vector3d> positions;
+      QList<Residue *> residueList;
+    };
+
+    AtomTable::AtomTable(const Molecule *molecule, int columns)
+    {
+      const QList<Atom *> atoms = molecule->atoms();
+      size = atoms.size();
+      atomicNumbers.resize(size);
+      for (int i = 0; i < size; ++i)
+        atomicNumbers[i] = atoms.at(i)->atomicNumber();
+
+      if (columns & PositionColumn) {
+        positions.resize(size);
+        for (int i = 0; i < size; ++i)
+          positions[i] = *atoms.at(i)->pos();
+      }
+
+      if (columns & (ResidueColumn | NameColumn)) {
+        residues.assign(size, -1);
+        if (columns & NameColumn)
+          names.resize(size);
+        residueList = molecule->residues();
+        for (int k = 0; k < residueList.size(); ++k) {
+          const Residue *residue = residueList.at(k);
+          const QList<unsigned long> ids = residue->atoms();
+          const QList<QString> &atomNames = residue->atomIds();
+          for (int j = 0; j < ids.size(); ++j) {
+            const Atom *atom = molecule->atomById(ids.at(j));
+            if (!atom)
+              continue;
+            residues[atom->index()] = k;
+            if ((columns & NameColumn) && j < atomNames.size())
+              names[atom->index()] = atomNames.at(j);
+          }
+        }
+      }
+    }
+
+    inline qint64 cellKey(int x, int y, int z, int ny, int nz)
+    {
+      return (qint64(x) * ny + y) * nz + z;
+    }
+
+  } // End of anonymous namespace
+
+  class SelectionQueryPrivate
+  {
+  public:
+    SelectionQueryPrivate() : root(0) { }
+    ~SelectionQueryPrivate() { delete root; }
+
+    /**
+     * @return The atoms among @p candidates matching @p node.
+     */
+    QBitArray evaluate(const SelectionNode *node, const AtomTable &table,
+                       const QBitArray &candidates) const;
+    QBitArray evaluateWithin(const SelectionNode *node, const AtomTable &table,
+                             const QBitArray &candidates) const;
+
+    /**
+     * @return The atoms among @p candidates in the residues matching
+     * @p match, called once per residue.
+     */
+    template <typename Match>
+    QBitArray byResidue(const AtomTable &table, const QBitArray &candidates,
+                        Match match) const;
+
+    QString expression;
+    QString error;
+    SelectionNode *root;
+  };
+
+  template <typename Match>
+  QBitArray SelectionQueryPrivate::byResidue(const AtomTable &table,
+                                             const QBitArray &candidates,
+                                             Match match) const
+  {
+    std::vector<char> residueMatches(table.residueList.size());
+    for (int k = 0; k < table.residueList.size(); ++k)
+      residueMatches[k] = match(table.residueList.at(k));
+    QBitArray result(table.size);
+    for (int i = 0; i < table.size; ++i) {
+      const int residue = table.residues[i];
+      if (residue >= 0 && residueMatches[residue] && candidates.testBit(i))
+        result.setBit(i);
+    }
+    return result;
+  }
+
+  namespace {
+
+    struct MatchResidueName
+    {
+      explicit MatchResidueName(const SelectionNode *n) : node(n) { }
+      bool operator()(Residue *residue) const { return matches(node, residue->name()); }
+      const SelectionNode *node;
+    };
+
+    struct MatchResidueSet
+    {
+      explicit MatchResidueSet(const QSet<QString> &s) : set(s) { }
+      bool operator()(Residue *residue) const { return set.contains(residue->name()); }
+      QSet<QString> set;
+    };
+
+    struct MatchChain
+    {
+      explicit MatchChain(const SelectionNode *n) : node(n) { }
+      bool operator()(Residue *residue) const
+      {
+        return matches(node, QString(QChar(residue->chainID())));
+      }
+      const SelectionNode *node;
+    };
+
+    struct MatchResidueNumber
+    {
+      explicit MatchResidueNumber(const SelectionNode *n) : node(n) { }
+      bool operator()(Residue *residue) const
+      {
+        // Insertion codes as in 52A are ignored
+        const QString number = residue->number().trimmed();
+        int end = 0;
+        if (end < number.size() && number.at(end) == '-')
+          ++end;
+        while (end < number.size() && number.at(end).isDigit())
+          ++end;
+        bool ok;
+        const int value = number.left(end).toInt(&ok);
+        return ok && inRanges(node->ranges, value);
+      }
+      const SelectionNode *node;
+    };
+
+  } // End of anonymous namespace
+
+  QBitArray SelectionQueryPrivate::evaluate(const SelectionNode *node,
+                                            const AtomTable &table,
+                                            const QBitArray &candidates) const
+  {
+    QBitArray result(table.size);
+    switch (node->type) {
+    case AllNode:
+      return candidates;
+    case NoneNode:
+      return result;
+    case IndexNode:
+      foreach (const Range &range, node->ranges) {
+        for (int i = qMax(0, range.first); i <= range.second && i < table.size; ++i)
+          if (candidates.testBit(i))
+            result.setBit(i);
+      }
+      return result;
+    case ElementNode:
+      for (int i = 0; i < table.size; ++i) {
+        const int number = table.atomicNumbers[i];
+        if (number >= 0 && number < 256 && node->elements.testBit(number)
+            && candidates.testBit(i))
+          result.setBit(i);
+      }
+      return result;
+    case ChainNode:
+      return byResidue(table, candidates, MatchChain(node));
+    case ResNameNode:
+      return byResidue(table, candidates, MatchResidueName(node));
+    case ResIdNode:
+      return byResidue(table, candidates, MatchResidueNumber(node));
+    case ProteinNode:
+      return byResidue(table, candidates, MatchResidueSet(aminoAcids()));
+    case WaterNode:
+      return byResidue(table, candidates, MatchResidueSet(waters()));
+    case NameNode:
+      for (int i = 0; i < table.size; ++i)
+        if (candidates.testBit(i) && matches(node, table.names[i]))
+          result.setBit(i);
+      return result;
+    case BackboneNode: {
+      SelectionNode backbone(NameNode);
+      backbone.values << "N" << "CA" << "C" << "O";
+      result = byResidue(table, candidates, MatchResidueSet(aminoAcids()));
+      for (int i = 0; i < table.size; ++i)
+        if (result.testBit(i) && !matches(&backbone, table.names[i]))
+          result.clearBit(i);
+      return result;
+    }
+    case NotNode:
+      result = candidates;
+      result &= ~evaluate(node->children.first(), table, candidates);
+      return result;
+    case AndNode:
+      // The cheapest terms come first, each one only looks at the atoms
+      // all the previous ones accepted
+      result = candidates;
+      foreach (const SelectionNode *child, node->children) {
+        result = evaluate(child, table, result);
+        if (result.count(true) == 0)
+          break;
+      }
+      return result;
+    case OrNode: {
+      // Each term only looks at the atoms no previous one accepted
+      QBitArray remaining = candidates;
+      foreach (const SelectionNode *child, node->children) {
+        const QBitArray accepted = evaluate(child, table, remaining);
+        result |= accepted;
+        remaining &= ~accepted;
+        if (remaining.count(true) == 0)
+          break;
+      }
+      return result;
+    }
+    case SameResidueNode: {
+      const QBitArray targets = evaluate(node->children.first(), table,
+                                         QBitArray(table.size, true));
+      std::vector<char> marked(table.residueList.size());
+      for (int i = 0; i < table.size; ++i)
+        if (targets.testBit(i) && table.residues[i] >= 0)
+          marked[table.residues[i]] = true;
+      for (int i = 0; i < table.size; ++i) {
+        const int residue = table.residues[i];
+        if (candidates.testBit(i) && (targets.testBit(i)
+                                      || (residue >= 0 && marked[residue])))
+          result.setBit(i);
+      }
+      return result;
+    }
+    case WithinNode:
+      return evaluateWithin(node, table, candidates);
+    }
+    return result;
+  }
+
+  QBitArray SelectionQueryPrivate::evaluateWithin(const SelectionNode *node,
+                                                  const AtomTable &table,
+                                                  const QBitArray &candidates) const
+  {
+    // The targets are looked for among all the atoms, not the candidates
+    const QBitArray targets = evaluate(node->children.first(), table,
+                                       QBitArray(table.size, true));
+    QBitArray result(table.size);
+    const double distance = node->distance;
+    if (distance <= 0.0) {
+      result = candidates;
+      result &= targets;
+      return result;
+    }
+
+    // Sort the targets by grid cell, cells as large as the distance
+    Vector3d min(HUGE_VAL, HUGE_VAL, HUGE_VAL);
+    Vector3d max(-HUGE_VAL, -HUGE_VAL, -HUGE_VAL);
+    for (int i = 0; i < table.size; ++i) {
+      if (targets.testBit(i)) {
+        min = min.cwiseMin(table.positions[i]);
+        max = max.cwiseMax(table.positions[i]);
+      }
+    }
+    if (min.x() > max.x())
+      return result;
+    const int nx = static_cast<int>((max.x() - min.x()) / distance) + 1;
+    const int ny = static_cast<int>((max.y() - min.y()) / distance) + 1;
+    const int nz = static_cast<int>((max.z() - min.z()) / distance) + 1;
+
+    std::vector< std::pair<qint64, int> > cells;
+    for (int i = 0; i < table.size; ++i) {
+      if (!targets.testBit(i))
+        continue;
+      const Vector3d p = (table.positions[i] - min) / distance;
+      cells.push_back(std::make_pair(cellKey(static_cast<int>(p.x()),
+                                             static_cast<int>(p.y()),
+                                             static_cast<int>(p.z()), ny, nz), i));
+    }
+    std::sort(cells.begin(), cells.end());
+
+    const double distanceSquared = distance * distance;
+    for (int i = 0; i < table.size; ++i) {
+      if (!candidates.testBit(i))
+        continue;
+      if (targets.testBit(i)) {
+        result.setBit(i);
+        continue;
+      }
+      const Vector3d &position = table.positions[i];
+      const Vector3d p = (position - min) / distance;
+      // Outside of the box around the targets by more than the distance
+      if (p.minCoeff() < -1.0 || p.x() >= nx + 1 || p.y() >= ny + 1 || p.z() >= nz + 1)
+        continue;
+      const int cx = static_cast<int>(std::floor(p.x()));
+      const int cy = static_cast<int>(std::floor(p.y()));
+      const int cz = static_cast<int>(std::floor(p.z()));
+      bool found = false;
+      for (int x = qMax(cx - 1, 0); !found && x <= qMin(cx + 1, nx - 1); ++x) {
+        for (int y = qMax(cy - 1, 0); !found && y <= qMin(cy + 1, ny - 1); ++y) {
+          for (int z = qMax(cz - 1, 0); !found && z <= qMin(cz + 1, nz - 1); ++z) {
+            std::vector< std::pair<qint64, int> >::const_iterator it =
+              std::lower_bound(cells.begin(), cells.end(),
+                               std::make_pair(cellKey(x, y, z, ny, nz), -1));
+            const qint64 key = cellKey(x, y, z, ny, nz);
+            for (; it != cells.end() && it->first == key; ++it) {
+              if ((table.positions[it->second] - position).squaredNorm()
+                  <= distanceSquared) {
+                found = true;
+                break;
+              }
+            }
+          }
+        }
+      }
+      if (found)
+        result.setBit(i);
+    }
+    return result;
+  }
+
+  SelectionQuery::SelectionQuery() : d(new SelectionQueryPrivate)
+  {
+  }
+
+  SelectionQuery::SelectionQuery(const QString &expression)
+    : d(new SelectionQueryPrivate)
+  {
+    setExpression(expression);
+  }
+
+  SelectionQuery::~SelectionQuery()
+  {
+    delete d;
+  }
+
+  bool SelectionQuery::setExpression(const QString &expression)
+  {
+    delete d->root;
+    d->root = 0;
+    d->expression = expression;
+    d->error.clear();
+
+    SelectionParser parser(tokenize(expression));
+    d->root = parser.parse();
+    if (!d->root) {
+      d->error = parser.error();
+      return false;
+    }
+    plan(d->root);
+    return true;
+  }
+
+  QString SelectionQuery::expression() const
+  {
+    return d->expression;
+  }
+
+  bool SelectionQuery::isValid() const
+  {
+    return d->root != 0;
+  }
+
+  QString SelectionQuery::errorString() const
+  {
+    return d->error;
+  }
+
+  QBitArray SelectionQuery::evaluate(const Molecule *molecule) const
+  {
+    if (!molecule)
+      return QBitArray();
+    if (!d->root)
+      return QBitArray(molecule->numAtoms());
+    const AtomTable table(molecule, columns(d->root));
+    return d->evaluate(d->root, table, QBitArray(table.size, true));
+  }
+
+  QList<Atom *> SelectionQuery::atoms(const Molecule *molecule) const
+  {
+    QList<Atom *> selected;
+    const QBitArray bits = evaluate(molecule);
+    if (bits.isEmpty())
+      return selected;
+    const QList<Atom *> all = molecule->atoms();
+    for (int i = 0; i < bits.size(); ++i)
+      if (bits.testBit(i))
+        selected.append(all.at(i));
+    return selected;
+  }
+
+} // End namespace Avogadro
@@ -0,0 +1,112 @@
+/**********************************************************************
+  SelectionQuery - Compiled atom selection expressions
+
+  Copyright (C) 2013 Avogadro Developers
+
+  This file is part of the Avogadro molecular editor project.
+  For more information, see <http://avogadro.cc/>
+
+  Avogadro is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  Avogadro is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+  02110-1301, USA.
+ **********************************************************************/
+
+#ifndef SELECTIONQUERY_H
+#define SELECTIONQUERY_H
+
+#include <avogadro/global.h>
+
+#include <QBitArray>
+#include <QList>
+#include <QString>
+
+namespace Avogadro {
+
+  class Atom;
+  class Molecule;
+  class SelectionQueryPrivate;
+
+  /**
+   * @class SelectionQuery selectionquery.h <avogadro/selectionquery.h>
+   * @brief Selects atoms by an expression such as
+   * "protein and within 5 of resname LIG and not element H".
+   *
+   * The expression is parsed once into a tree, in which the terms of each
+   * "and" and "or" are ordered so that the cheap ones are evaluated first
+   * and the expensive ones, such as "within", only look at the atoms still
+   * undecided. The terms are evaluated over arrays of the atom properties
+   * and the result is a bit per atom.
+   *
+   * The terms, lists of values may follow each keyword:
+   * @li all, none
+   * @li element C N O (symbols or atomic numbers), hydrogen
+   * @li name CA CB (atom names in the residue, * and ? are wildcards)
+   * @li resname ALA GLY, resid 10 12-20, chain A B, index 0-99
+   * @li protein, backbone, water (also solvent)
+   * @li within 5 of term, same residue as term
+   *
+   * Terms are combined by not, and, or and parentheses. "within" and
+   * "same residue as" apply to the single term that follows them, a
+   * compound target needs parentheses.
+   *
+   * @code
+   * SelectionQuery query("chain A and not water");
+   * if (query.isValid())
+   *   QBitArray selected = query.evaluate(molecule);
+   * @endcode
+   */
+  class A_EXPORT SelectionQuery
+  {
+  public:
+    SelectionQuery();
+    explicit SelectionQuery(const QString &expression);
+    ~SelectionQuery();
+
+    /**
+     * Parse @p expression.
+     * @return False if it is not valid, see errorString().
+     */
+    bool setExpression(const QString &expression);
+    QString expression() const;
+
+    /**
+     * @return True if the expression was parsed.
+     */
+    bool isValid() const;
+
+    /**
+     * @return The reason the expression could not be parsed.
+     */
+    QString errorString() const;
+
+    /**
+     * @return One bit per atom of @p molecule, set if the atom is selected.
+     * The bits are in the order of Molecule::atoms(). An invalid query
+     * selects nothing.
+     */
+    QBitArray evaluate(const Molecule *molecule) const;
+
+    /**
+     * @return The atoms of @p molecule selected.
+     */
+    QList<Atom *> atoms(const Molecule *molecule) const;
+
+  private:
+    Q_DISABLE_COPY(SelectionQuery)
+    SelectionQueryPrivate * const d;
+  };
+
+} // End namespace Avogadro
+
+#endif
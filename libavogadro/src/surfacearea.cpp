@@ -0,0 +1,437 @@
+/**********************************************************************
+  SurfaceArea - Solvent accessible surface areas and volumes
+
+  Copyright (C) 2013 Avogadro Developers
+
+  This file is part of the Avogadro molecular editor project.
+  For more information, see <http://avogadro.cc/>
+
+  Avogadro is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  Avogadro is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+  02110-1301, USA.
+ **********************************************************************/
+
+#include "surfacearea.h"
+
+#include "atom.h"
+#include "molecule.h"
+#include "residue.h"
+
+#include <openbabel/mol.h>
+
+#include <QtCore/QtConcurrentMap>
+#include <QtCore/QVector>
+
+#include <algorithm>
+#include <cmath>
+
+namespace Avogadro {
+
+  using Eigen::Vector3d;
+
+  namespace {
+    // Atoms handed to a thread at a time
+    const unsigned int BlockSize = 256;
+
+    /**
+     * The spheres of one calculation, binned in a grid of cells at least as
+     * large as the largest sphere diameter.
+     */
+    struct SurfaceGrid
+    {
+      const std::vector<Vector3d> *positions;
+      const std::vector<double> *radii;
+      const std::vector<Vector3d> *points;
+      Vector3d centre;
+
+      Vector3d origin;
+      double cellSize;
+      int dims[3];
+      std::vector<unsigned int> cellStart; // Index into cellAtoms, per cell
+      std::vector<unsigned int> cellAtoms;
+
+      // Results, per atom
+      std::vector<double> areas;
+      std::vector<double> volumes;
+
+      void cell(const Vector3d &pos, int c[3]) const
+      {
+        for (int k = 0; k < 3; ++k)
+          c[k] = qBound(0, int(std::floor((pos[k] - origin[k]) / cellSize)),
+                        dims[k] - 1);
+      }
+    };
+
+    struct SurfaceBlock
+    {
+      unsigned int begin;
+      unsigned int end;
+      SurfaceGrid *grid;
+    };
+
+    struct Occluder
+    {
+      Vector3d pos;
+      double radius2;
+      double distance2;
+
+      bool operator<(const Occluder &other) const
+      {
+        return distance2 < other.distance2;
+      }
+    };
+
+    void buildGrid(SurfaceGrid &grid)
+    {
+      const std::vector<Vector3d> &positions = *grid.positions;
+      const std::vector<double> &radii = *grid.radii;
+      const unsigned int numAtoms = positions.size();
+
+      Vector3d min = positions[0];
+      Vector3d max = positions[0];
+      double maxRadius = 0.0;
+      grid.centre = Vector3d::Zero();
+      for (unsigned int i = 0; i < numAtoms; ++i) {
+        min = min.cwiseMin(positions[i]);
+        max = max.cwiseMax(positions[i]);
+        maxRadius = qMax(maxRadius, radii[i]);
+        grid.centre += positions[i];
+      }
+      grid.centre /= numAtoms;
+
+      // Overlapping spheres are never more than one cell apart. Stray atoms
+      // far from the rest must not make the grid huge, so the cells grow
+      // until there are not many more cells than atoms.
+      grid.origin = min;
+      grid.cellSize = qMax(2.0 * maxRadius, 1.0);
+      const double maxCells = qMax(8.0 * numAtoms, 1000.0);
+      for (;;) {
+        double cells = 1.0;
+        for (int k = 0; k < 3; ++k) {
+          grid.dims[k] = int((max[k] - min[k]) / grid.cellSize) + 1;
+          cells *= grid.dims[k];
+        }
+        if (cells <= maxCells)
+          break;
+        grid.cellSize *= 1.5;
+      }
+
+      // Sort the atoms by cell
+      const unsigned int numCells = grid.dims[0] * grid.dims[1] * grid.dims[2];
+      std::vector<unsigned int> cellOf(numAtoms);
+      grid.cellStart.assign(numCells + 1, 0);
+      for (unsigned int i = 0; i < numAtoms; ++i) {
+        int c[3];
+        grid.cell(positions[i], c);
+        cellOf[i] = (c[0] * grid.dims[1] + c[1]) * grid.dims[2] + c[2];
+        ++grid.cellStart[cellOf[i] + 1];
+      }
+      for (unsigned int c = 0; c < numCells; ++c)
+        grid.cellStart[c + 1] += grid.cellStart[c];
+      std::vector<unsigned int> fill(grid.cellStart.begin(),
+                                     grid.cellStart.end() - 1);
+      grid.cellAtoms.resize(numAtoms);
+      for (unsigned int i = 0; i < numAtoms; ++i)
+        grid.cellAtoms[fill[cellOf[i]]++] = i;
+
+      grid.areas.assign(numAtoms, 0.0);
+      grid.volumes.assign(numAtoms, 0.0);
+    }
+
+    void processBlock(SurfaceBlock &block)
+    {
+      const SurfaceGrid &grid = *block.grid;
+      const std::vector<Vector3d> &positions = *grid.positions;
+      const std::vector<double> &radii = *grid.radii;
+      const std::vector<Vector3d> &points = *grid.points;
+      const double pointArea = 4.0 * M_PI / points.size();
+
+      std::vector<Occluder> occluders;
+      for (unsigned int i = block.begin; i < block.end; ++i) {
+        const double radius = radii[i];
+        if (radius <= 0.0)
+          continue;
+        const Vector3d &pos = positions[i];
+
+        // The spheres overlapping this one, nearest first as they hide the
+        // most points
+        occluders.clear();
+        int c[3];
+        grid.cell(pos, c);
+        for (int x = qMax(c[0] - 1, 0); x <= qMin(c[0] + 1, grid.dims[0] - 1);
+             ++x) {
+          for (int y = qMax(c[1] - 1, 0);
+               y <= qMin(c[1] + 1, grid.dims[1] - 1); ++y) {
+            for (int z = qMax(c[2] - 1, 0);
+                 z <= qMin(c[2] + 1, grid.dims[2] - 1); ++z) {
+              const unsigned int cell = (x * grid.dims[1] + y) * grid.dims[2]
+                  + z;
+              for (unsigned int a = grid.cellStart[cell];
+                   a < grid.cellStart[cell + 1]; ++a) {
+                const unsigned int j = grid.cellAtoms[a];
+                if (j == i || radii[j] <= 0.0)
+                  continue;
+                const double reach = radius + radii[j];
+                const double distance2 = (positions[j] - pos).squaredNorm();
+                if (distance2 >= reach * reach)
+                  continue;
+                Occluder occluder;
+                occluder.pos = positions[j];
+                occluder.radius2 = radii[j] * radii[j];
+                occluder.distance2 = distance2;
+                occluders.push_back(occluder);
+              }
+            }
+          }
+        }
+        std::sort(occluders.begin(), occluders.end());
+
+        // Neighbouring points are usually hidden by the same sphere, so the
+        // last one found is tried first
+        int exposed = 0;
+        double flux = 0.0;
+        size_t last = 0;
+        const Vector3d offset = pos - grid.centre;
+        for (size_t k = 0; k < points.size(); ++k) {
+          const Vector3d point = pos + radius * points[k];
+          bool hidden = false;
+          if (last < occluders.size()
+              && (point - occluders[last].pos).squaredNorm()
+                 < occluders[last].radius2) {
+            hidden = true;
+          }
+          else {
+            for (size_t o = 0; o < occluders.size(); ++o) {
+              if ((point - occluders[o].pos).squaredNorm()
+                  < occluders[o].radius2) {
+                hidden = true;
+                last = o;
+                break;
+              }
+            }
+          }
+          if (!hidden) {
+            ++exposed;
+            // Divergence theorem: V = 1/3 sum over the surface of r.n dA
+            flux += points[k].dot(offset) + radius;
+          }
+        }
+        const double area = pointArea * radius * radius;
+        block.grid->areas[i] = area * exposed;
+        block.grid->volumes[i] = area * flux / 3.0;
+      }
+    }
+
+    /**
+     * Calculate the areas and volumes of spheres of @a radii (already
+     * including the probe) at @a positions into @a grid.
+     */
+    void calculateGrid(SurfaceGrid &grid)
+    {
+      buildGrid(grid);
+      const unsigned int numAtoms = grid.positions->size();
+      QVector<SurfaceBlock> blocks;
+      for (unsigned int first = 0; first < numAtoms; first += BlockSize) {
+        SurfaceBlock block;
+        block.begin = first;
+        block.end = qMin(first + BlockSize, numAtoms);
+        block.grid = &grid;
+        blocks.append(block);
+      }
+      QtConcurrent::blockingMap(blocks, processBlock);
+    }
+  }
+
+  class SurfaceAreaPrivate
+  {
+  public:
+    SurfaceAreaPrivate() : probeRadius(1.4), totalArea(0.0), volume(0.0)
+    {
+      setPointCount(100);
+    }
+
+    /**
+     * Spread @a count points evenly over the unit sphere along a golden
+     * section spiral.
+     */
+    void setPointCount(int count)
+    {
+      points.resize(qMax(count, 1));
+      const double increment = M_PI * (3.0 - std::sqrt(5.0));
+      for (size_t k = 0; k < points.size(); ++k) {
+        const double y = 1.0 - (2.0 * k + 1.0) / points.size();
+        const double r = std::sqrt(1.0 - y * y);
+        const double phi = k * increment;
+        points[k] = Vector3d(r * std::cos(phi), y, r * std::sin(phi));
+      }
+    }
+
+    /**
+     * The van der Waals radii plus the probe of the atoms of @a molecule.
+     */
+    std::vector<double> radii(const Molecule *molecule) const
+    {
+      std::vector<double> result;
+      result.reserve(molecule->numAtoms());
+      foreach (const Atom *atom, molecule->atoms())
+        result.push_back(OpenBabel::etab.GetVdwRad(atom->atomicNumber())
+                         + probeRadius);
+      return result;
+    }
+
+    double probeRadius;
+    std::vector<Vector3d> points;
+
+    std::vector<double> atomAreas;
+    std::vector<double> residueAreas;
+    double totalArea;
+    double volume;
+  };
+
+  SurfaceArea::SurfaceArea() : d(new SurfaceAreaPrivate)
+  {
+  }
+
+  SurfaceArea::~SurfaceArea()
+  {
+    delete d;
+  }
+
+  void SurfaceArea::setProbeRadius(double radius)
+  {
+    d->probeRadius = qMax(radius, 0.0);
+  }
+
+  double SurfaceArea::probeRadius() const
+  {
+    return d->probeRadius;
+  }
+
+  void SurfaceArea::setPointCount(int count)
+  {
+    d->setPointCount(count);
+  }
+
+  int SurfaceArea::pointCount() const
+  {
+    return d->points.size();
+  }
+
+  bool SurfaceArea::calculate(const Molecule *molecule)
+  {
+    if (!molecule || !molecule->numAtoms()) {
+      calculate(std::vector<Vector3d>(), std::vector<double>());
+      return false;
+    }
+
+    std::vector<Vector3d> positions;
+    std::vector<double> radii;
+    positions.reserve(molecule->numAtoms());
+    radii.reserve(molecule->numAtoms());
+    foreach (const Atom *atom, molecule->atoms()) {
+      positions.push_back(*atom->pos());
+      radii.push_back(OpenBabel::etab.GetVdwRad(atom->atomicNumber()));
+    }
+    calculate(positions, radii);
+
+    foreach (const Residue *residue, molecule->residues()) {
+      double area = 0.0;
+      foreach (unsigned long id, residue->atoms()) {
+        const Atom *atom = molecule->atomById(id);
+        if (atom)
+          area += d->atomAreas[atom->index()];
+      }
+      d->residueAreas.push_back(area);
+    }
+    return true;
+  }
+
+  bool SurfaceArea::calculate(const std::vector<Vector3d> &positions,
+                              const std::vector<double> &radii)
+  {
+    d->atomAreas.clear();
+    d->residueAreas.clear();
+    d->totalArea = 0.0;
+    d->volume = 0.0;
+    if (positions.empty() || positions.size() != radii.size())
+      return false;
+
+    std::vector<double> expanded(radii);
+    for (size_t i = 0; i < expanded.size(); ++i)
+      expanded[i] += d->probeRadius;
+
+    SurfaceGrid grid;
+    grid.positions = &positions;
+    grid.radii = &expanded;
+    grid.points = &d->points;
+    calculateGrid(grid);
+
+    d->atomAreas.swap(grid.areas);
+    for (size_t i = 0; i < d->atomAreas.size(); ++i) {
+      d->totalArea += d->atomAreas[i];
+      d->volume += grid.volumes[i];
+    }
+    return true;
+  }
+
+  std::vector<double> SurfaceArea::conformerAreas(const Molecule *molecule)
+    const
+  {
+    std::vector<double> result;
+    if (!molecule || !molecule->numAtoms())
+      return result;
+
+    const std::vector<double> radii = d->radii(molecule);
+    const QList<Atom *> atoms = molecule->atoms();
+    std::vector<Vector3d> positions(atoms.size());
+    foreach (const std::vector<Vector3d> *conformer, molecule->conformers()) {
+      // Conformers are indexed by atom id
+      for (int i = 0; i < atoms.size(); ++i)
+        positions[i] = (*conformer)[atoms[i]->id()];
+
+      SurfaceGrid grid;
+      grid.positions = &positions;
+      grid.radii = &radii;
+      grid.points = &d->points;
+      calculateGrid(grid);
+
+      double total = 0.0;
+      for (size_t i = 0; i < grid.areas.size(); ++i)
+        total += grid.areas[i];
+      result.push_back(total);
+    }
+    return result;
+  }
+
+  const std::vector<double> & SurfaceArea::atomAreas() const
+  {
+    return d->atomAreas;
+  }
+
+  const std::vector<double> & SurfaceArea::residueAreas() const
+  {
+    return d->residueAreas;
+  }
+
+  double SurfaceArea::totalArea() const
+  {
+    return d->totalArea;
+  }
+
+  double SurfaceArea::volume() const
+  {
+    return d->volume;
+  }
+
+} // End namespace Avogadro
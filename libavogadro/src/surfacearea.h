@@ -0,0 +1,133 @@
+/**********************************************************************
+  SurfaceArea - Solvent accessible surface areas and volumes
+
+  Copyright (C) 2013 Avogadro Developers
+
+  This file is part of the Avogadro molecular editor project.
+  For more information, see <http://avogadro.cc/>
+
+  Avogadro is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  Avogadro is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+  02110-1301, USA.
+ **********************************************************************/
+
+#ifndef SURFACEAREA_H
+#define SURFACEAREA_H
+
+#include <avogadro/global.h>
+
+#include <Eigen/Core>
+
+#include <vector>
+
+namespace Avogadro {
+
+  class Molecule;
+  class SurfaceAreaPrivate;
+
+  /**
+   * @class SurfaceArea surfacearea.h <avogadro/surfacearea.h>
+   * @brief Calculates solvent accessible surface areas and the volume they
+   * enclose.
+   *
+   * The Shrake-Rupley method is used: every atom is a sphere of its van der
+   * Waals radius plus the probe radius, covered by a fixed set of points
+   * spread evenly over the sphere. The area of an atom is the fraction of
+   * its points not inside any other sphere times the area of its sphere.
+   * The spheres that may overlap an atom are found with a grid of cells and
+   * the atoms are split between threads with QtConcurrent.
+   *
+   * The volume enclosed by the surface is found from the same points with
+   * the divergence theorem. With a probe radius of 0 the areas and volume
+   * are those of the van der Waals surface.
+   *
+   * @code
+   * SurfaceArea sasa;
+   * sasa.setProbeRadius(1.4);
+   * if (sasa.calculate(molecule))
+   *   qDebug() << sasa.totalArea() << sasa.volume();
+   * @endcode
+   */
+  class A_EXPORT SurfaceArea
+  {
+  public:
+    SurfaceArea();
+    ~SurfaceArea();
+
+    /**
+     * Set the radius of the solvent probe in Angstrom, the default of 1.4 is
+     * water. Set it to 0 for the van der Waals surface.
+     */
+    void setProbeRadius(double radius);
+    double probeRadius() const;
+
+    /**
+     * Set the number of points on each sphere, the default is 100. More
+     * points give more accurate areas, the cost grows linearly.
+     */
+    void setPointCount(int count);
+    int pointCount() const;
+
+    /**
+     * Calculate the areas of the atoms of @p molecule in its current
+     * conformer, using the van der Waals radii of the elements.
+     * @return False if the molecule is null or has no atoms.
+     */
+    bool calculate(const Molecule *molecule);
+
+    /**
+     * Calculate the areas of the spheres at @p positions with van der Waals
+     * @p radii. There are no residues.
+     */
+    bool calculate(const std::vector<Eigen::Vector3d> &positions,
+                   const std::vector<double> &radii);
+
+    /**
+     * Calculate the total area of each conformer of @p molecule, e.g. the
+     * frames of a trajectory. The current conformer and the results of the
+     * last calculate() are not changed.
+     * @return The total area of each conformer, in order.
+     */
+    std::vector<double> conformerAreas(const Molecule *molecule) const;
+
+    /**
+     * @return The accessible area of each atom in square Angstrom, by index
+     * in Molecule::atoms().
+     */
+    const std::vector<double> & atomAreas() const;
+
+    /**
+     * @return The accessible area of each residue in square Angstrom, by
+     * index in Molecule::residues().
+     */
+    const std::vector<double> & residueAreas() const;
+
+    /**
+     * @return The total accessible area in square Angstrom.
+     */
+    double totalArea() const;
+
+    /**
+     * @return The volume enclosed by the surface in cubic Angstrom.
+     */
+    double volume() const;
+
+  private:
+    Q_DISABLE_COPY(SurfaceArea)
+    SurfaceAreaPrivate * const d;
+  };
+
+} // End namespace Avogadro
+
+#endif
@@ -162,8 +162,10 @@ namespace Avogadro {
         m_clickedAtom = 0;
       }
 
-      if (m_clickedAtom)
+      if (m_clickedAtom) {
         m_forceField->SetFixAtom(m_clickedAtom->index()+1);
+        m_thread->setFixedAtom(m_clickedAtom->index());
+      }
     }
 
     widget->update();
@@ -180,6 +182,7 @@ namespace Avogadro {
 
     m_clickedAtom = 0;
     m_forceField->UnsetFixAtom();
+    m_thread->setFixedAtom(-1);
 
     widget->update();
     return 0;
@@ -235,9 +238,15 @@ namespace Avogadro {
                                     tr("AutoOpt: Could not setup force field...."));
       }
       else {
-        double energy = m_forceField->Energy(false);
-        if (m_forceField->GetUnit().find("kcal") != string::npos)
-          energy *= KCAL_TO_KJ;
+        double energy;
+        if (UFFForceField *uff = m_thread->nativeForceField()) {
+          energy = uff->energy();
+        }
+        else {
+          energy = m_forceField->Energy(false);
+          if (m_forceField->GetUnit().find("kcal") != string::npos)
+            energy *= KCAL_TO_KJ;
+        }
         widget->molecule()->setEnergy(energy);
         widget->painter()->drawText(labelPos,
             tr("AutoOpt: E = %1 %2 (dE = %3)").arg(energy).
@@ -396,6 +405,7 @@ namespace Avogadro {
 
       m_clickedAtom = 0;
       m_forceField->UnsetFixAtom();
+      m_thread->setFixedAtom(-1);
       m_leftButtonPressed = false;
       m_midButtonPressed = false;
       m_rightButtonPressed = false;
@@ -426,7 +436,17 @@ namespace Avogadro {
 
   void AutoOptTool::finished(bool calculated)
   {
-    if (m_running && calculated) {
+    if (m_running && calculated && m_thread->nativeForceField()) {
+      m_thread->nativeForceField()->writeCoordinates();
+
+      if(m_clickedAtom && m_leftButtonPressed) {
+        Vector3d begin = m_glwidget->camera()->project(*m_clickedAtom->pos());
+        QPoint point = QPoint(begin.x(), begin.y());
+        translate(m_glwidget, *m_clickedAtom->pos(), point,
+                  m_lastDraggingPosition);
+      }
+    }
+    else if (m_running && calculated) {
       QList<Atom*> atoms = m_glwidget->molecule()->atoms();
 
       OBMol mol = m_glwidget->molecule()->OBMol();
@@ -484,6 +504,10 @@ namespace Avogadro {
   {
     m_stop = false;
     m_velocities = false;
+    m_molecule = 0;
+    m_uffValid = false;
+    m_usedNative = false;
+    m_fixedAtom = -1;
   }
 
   void AutoOptThread::setup(Molecule *molecule,
@@ -491,6 +515,8 @@ namespace Avogadro {
                             int algorithm, int steps)
   {
     m_mutex.lock();
+    if (molecule != m_molecule)
+      m_uffValid = false;
     m_molecule = molecule;
     m_forceField = forceField;
     m_algorithm = algorithm;
@@ -515,6 +541,13 @@ namespace Avogadro {
 
     m_mutex.lock();
 
+    if (updateNative()) {
+      m_mutex.unlock();
+      emit setupSucces();
+      emit finished(m_stop ? false : true);
+      return;
+    }
+
     m_forceField->SetLogFile(NULL);
     m_forceField->SetLogLevel(OBFF_LOGLVL_NONE);
 
@@ -561,6 +594,54 @@ namespace Avogadro {
     emit finished(m_stop ? false : true);
   }
 
+  bool AutoOptThread::updateNative()
+  {
+    m_usedNative = false;
+    if (QString(m_forceField->GetID()) != "UFF" ||
+        (m_algorithm != 0 && m_algorithm != 1))
+      return false;
+
+    if (!m_uffValid || m_uff.molecule() != m_molecule ||
+        m_uff.topologyChanged()) {
+      // Falls back to OpenBabel, e.g. for dummy atoms
+      m_uffValid = m_uff.setup(m_molecule);
+      if (!m_uffValid)
+        return false;
+    }
+    else {
+      m_uff.readCoordinates();
+    }
+
+    QList<int> fixed;
+    OBFFConstraints &constraints = m_forceField->GetConstraints();
+    for (unsigned int i = 0; i < m_molecule->numAtoms(); ++i)
+      if (constraints.IsFixed(i + 1))
+        fixed.append(i);
+    if (m_fixedAtom >= 0)
+      fixed.append(m_fixedAtom);
+    m_uff.setFixedAtoms(fixed);
+
+    if (m_algorithm == 0)
+      m_uff.steepestDescent(m_steps);
+    else
+      m_uff.lbfgs(m_steps);
+
+    m_usedNative = true;
+    return true;
+  }
+
+  void AutoOptThread::setFixedAtom(int index)
+  {
+    m_mutex.lock();
+    m_fixedAtom = index;
+    m_mutex.unlock();
+  }
+
+  UFFForceField * AutoOptThread::nativeForceField()
+  {
+    return m_usedNative ? &m_uff : 0;
+  }
+
   void AutoOptThread::stop()
   {
     m_stop = true;
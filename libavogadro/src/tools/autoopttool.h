@@ -28,6 +28,7 @@
 #include <avogadro/glwidget.h>
 #include <avogadro/tool.h>
 #include <avogadro/molecule.h>
+#include <avogadro/uffforcefield.h>
 
 #include <openbabel/mol.h>
 #include <openbabel/forcefield.h>
@@ -56,6 +57,17 @@ namespace Avogadro {
       void run();
       void update();
 
+      /**
+       * Atom @p index (or none for -1) is held in place while dragged.
+       */
+      void setFixedAtom(int index);
+
+      /**
+       * @return The native UFF implementation if it was used by the last
+       * update(), 0 if the OpenBabel force field was used.
+       */
+      UFFForceField * nativeForceField();
+
     Q_SIGNALS:
       void finished(bool calculated);
       void setupDone();
@@ -74,6 +86,15 @@ namespace Avogadro {
       int m_steps;
       bool m_stop;
       QMutex m_mutex;
+
+      // UFF minimizations with steepest descent or L-BFGS use the native
+      // implementation, the atom types and terms are only set up again
+      // when the topology changes
+      bool updateNative();
+      UFFForceField m_uff;
+      bool m_uffValid;
+      bool m_usedNative;
+      int m_fixedAtom;
   };
 
   /**
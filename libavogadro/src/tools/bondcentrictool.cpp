@@ -35,6 +35,7 @@
 #include <avogadro/painter.h>
 #include <avogadro/camera.h>
 #include <avogadro/toolgroup.h>
+#include <avogadro/plotwidget.h>
 
 #include <QtPlugin>
 #include <QString>
@@ -50,6 +51,11 @@ namespace Avogadro {
     return x != x;
   }
 
+  bool pointLessThan(const QPointF &a, const QPointF &b)
+  {
+    return a.x() < b.x();
+  }
+
   // ############################ BondCentricTool ################################
 
   // ##########  Constructor  ##########
@@ -72,7 +78,14 @@ namespace Avogadro {
   m_movedSinceButtonPressed(false),
   m_showAngles(true),
   m_snapToEnabled(true),
-  m_snapToAngle(10)
+  m_snapToAngle(10),
+  m_scan(new TorsionScan(this)),
+  m_scanStepBox(NULL),
+  m_scanRelaxBox(NULL),
+  m_scanButton(NULL),
+  m_scanLabel(NULL),
+  m_scanPlot(NULL),
+  m_scanObject(NULL)
   {
     QAction *action = activateAction();
     action->setIcon(QIcon(QString::fromUtf8(":/bondcentric/bondcentric.png")));
@@ -86,12 +99,18 @@ namespace Avogadro {
           "Right Click & Drag one of the Atoms in the Bond to change the length"));
     //action->setShortcut(Qt::Key_F9);
     connect(action,SIGNAL(toggled(bool)),this,SLOT(toolChanged(bool)));
+
+    // The scan signals come from the worker threads and are queued
+    connect(m_scan, SIGNAL(pointFinished(int)), this, SLOT(scanPointFinished(int)));
+    connect(m_scan, SIGNAL(finished()), this, SLOT(scanFinished()));
   }
 
   // ##########  Destructor  ##########
 
   BondCentricTool::~BondCentricTool()
   {
+    m_scan->cancel();
+
     delete m_referencePoint;
     m_referencePoint = NULL;
     delete m_currentReference;
@@ -141,6 +160,14 @@ namespace Avogadro {
       disconnect(m_molecule, 0 , this, 0);
     }
 
+    // A running scan belongs to the old molecule
+    m_scan->setup(0, 0);
+    if (m_settingsWidget) {
+      m_scanObject->clearPoints();
+      m_scanPlot->update();
+      m_scanLabel->clear();
+    }
+
     if (molecule) {
       m_molecule = molecule;
       connect(molecule, SIGNAL(primitiveRemoved(Primitive*)), this,
@@ -1623,13 +1650,44 @@ namespace Avogadro {
       m_snapToAngleBox->setSuffix(QString::fromUtf8("°"));
       m_snapToAngleBox->setEnabled(m_snapToEnabled);
 
+      m_scanStepBox = new QSpinBox(m_settingsWidget);
+      m_scanStepBox->setRange(1, 60);
+      m_scanStepBox->setValue(10);
+      m_scanStepBox->setSuffix(QString::fromUtf8("°"));
+      m_scanStepBox->setToolTip(tr("Spacing of the torsion scan"));
+
+      m_scanRelaxBox = new QCheckBox(tr(" Relax"), m_settingsWidget);
+      m_scanRelaxBox->setToolTip(tr("Optimize the rest of the molecule at each angle"));
+
+      m_scanButton = new QPushButton(tr("Scan Torsion"), m_settingsWidget);
+      m_scanButton->setToolTip(tr("Plot the energy of the rotation around the selected bond.\n"
+                                  "Click the plot to move to the nearest minimum."));
+
+      m_scanLabel = new QLabel(m_settingsWidget);
+      m_scanLabel->setWordWrap(true);
+
+      m_scanPlot = new PlotWidget(m_settingsWidget);
+      m_scanPlot->setMinimumHeight(150);
+      m_scanPlot->setAntialiasing(true);
+      m_scanPlot->setLimits(-180.0, 180.0, 0.0, 1.0);
+      m_scanPlot->axis(PlotWidget::BottomAxis)->setLabel(tr("Dihedral (degrees)"));
+      m_scanPlot->axis(PlotWidget::LeftAxis)->setLabel(tr("Energy (kJ/mol)"));
+      m_scanObject = new PlotObject(Qt::red, PlotObject::Points, 4);
+      m_scanObject->setShowLines(true);
+      m_scanPlot->addPlotObject(m_scanObject);
+
       m_layout = new QGridLayout();
       m_layout->addWidget(m_showAnglesBox, 0, 0);
       m_layout->addWidget(m_snapToCheckBox, 1, 0);
       m_layout->addWidget(m_snapToAngleLabel, 2, 0);
       m_layout->addWidget(m_snapToAngleBox, 2, 1);
+      m_layout->addWidget(m_scanButton, 3, 0);
+      m_layout->addWidget(m_scanStepBox, 3, 1);
+      m_layout->addWidget(m_scanRelaxBox, 4, 0);
       QVBoxLayout* tmp = new QVBoxLayout;
       tmp->addLayout(m_layout);
+      tmp->addWidget(m_scanPlot);
+      tmp->addWidget(m_scanLabel);
       tmp->addStretch(1);
 
       connect(m_showAnglesBox, SIGNAL(stateChanged(int)), this,
@@ -1641,6 +1699,11 @@ namespace Avogadro {
       connect(m_snapToAngleBox, SIGNAL(valueChanged(int)), this,
           SLOT(snapToAngleChanged(int)));
 
+      connect(m_scanButton, SIGNAL(clicked()), this, SLOT(startScan()));
+
+      connect(m_scanPlot, SIGNAL(pointClicked(double, double)), this,
+          SLOT(scanPlotClicked(double, double)));
+
       m_settingsWidget->setLayout(tmp);
 
       connect(m_settingsWidget, SIGNAL(destroyed()),
@@ -1654,6 +1717,98 @@ namespace Avogadro {
 
   void BondCentricTool::settingsWidgetDestroyed() {
     m_settingsWidget = 0;
+    m_scanObject = 0;
+  }
+
+  // ##########  startScan  ##########
+
+  void BondCentricTool::startScan()
+  {
+    if (!m_settingsWidget)
+      return;
+
+    m_scanObject->clearPoints();
+    m_scanPlot->update();
+
+    m_scan->setStep(m_scanStepBox->value());
+    m_scan->setRelax(m_scanRelaxBox->isChecked());
+    if (!m_scan->setup(m_molecule, m_selectedBond) || !m_scan->start()) {
+      m_scanLabel->setText(m_scan->errorString());
+      return;
+    }
+    m_scanLabel->setText(tr("Scanning..."));
+  }
+
+  // ##########  scanPointFinished  ##########
+
+  void BondCentricTool::scanPointFinished(int index)
+  {
+    // Queued from a scan that has been restarted since
+    if (!m_settingsWidget || !m_scan->isDone(index))
+      return;
+
+    // Redraw the finished part of the profile relative to its minimum
+    QList<QPointF> points;
+    double minimum = 0.0;
+    for (int i = 0; i < m_scan->count(); ++i) {
+      if (!m_scan->isDone(i))
+        continue;
+      if (points.isEmpty() || m_scan->energy(i) < minimum)
+        minimum = m_scan->energy(i);
+      points.append(QPointF(m_scan->angle(i), m_scan->energy(i)));
+    }
+    qSort(points.begin(), points.end(), pointLessThan);
+
+    double maximum = 1.0;
+    m_scanObject->clearPoints();
+    foreach (const QPointF &point, points) {
+      m_scanObject->addPoint(point.x(), point.y() - minimum);
+      maximum = qMax(maximum, point.y() - minimum);
+    }
+    m_scanPlot->setLimits(-180.0, 180.0, 0.0, 1.05 * maximum);
+    m_scanPlot->update();
+  }
+
+  // ##########  scanFinished  ##########
+
+  void BondCentricTool::scanFinished()
+  {
+    if (!m_settingsWidget || !m_scan->count())
+      return;
+    // Nothing to report for a canceled scan
+    for (int i = 0; i < m_scan->count(); ++i)
+      if (!m_scan->isDone(i))
+        return;
+
+    double minimum = m_scan->energy(0);
+    double maximum = minimum;
+    for (int i = 1; i < m_scan->count(); ++i) {
+      minimum = qMin(minimum, m_scan->energy(i));
+      maximum = qMax(maximum, m_scan->energy(i));
+    }
+    m_scanLabel->setText(tr("Barrier: %1 kJ/mol").arg(maximum - minimum, 0, 'f', 2));
+  }
+
+  // ##########  scanPlotClicked  ##########
+
+  void BondCentricTool::scanPlotClicked(double x, double)
+  {
+    int index = m_scan->localMinimum(m_scan->nearest(x));
+    if (!m_molecule || !m_scan->isDone(index))
+      return;
+
+    // Undo restores the whole molecule, as for the other manipulations
+    BondCentricMoveCommand *command = new BondCentricMoveCommand(m_molecule);
+    if (!m_scan->apply(index)) {
+      delete command;
+      m_scanLabel->setText(tr("The molecule changed, scan again."));
+      return;
+    }
+    GLWidget *widget = GLWidget::current();
+    if (widget && widget->undoStack())
+      widget->undoStack()->push(command);
+    else
+      delete command;
   }
 
   // #########################  BondCentricMoveCommand  ##########################
@@ -1738,6 +1893,8 @@ namespace Avogadro {
     settings.setValue("showAngles", m_showAnglesBox->checkState());
     settings.setValue("snapTo", m_snapToCheckBox->checkState());
     settings.setValue("snapToAngle", m_snapToAngleBox->value());
+    settings.setValue("scanStep", m_scanStepBox->value());
+    settings.setValue("scanRelax", m_scanRelaxBox->isChecked());
   }
 
   void BondCentricTool::readSettings(QSettings &settings)
@@ -1752,6 +1909,12 @@ namespace Avogadro {
     if(m_snapToAngleBox) {
       m_snapToAngleBox->setValue(settings.value("snapToAngle", 10).toInt());
     }
+    if(m_scanStepBox) {
+      m_scanStepBox->setValue(settings.value("scanStep", 10).toInt());
+    }
+    if(m_scanRelaxBox) {
+      m_scanRelaxBox->setChecked(settings.value("scanRelax", false).toBool());
+    }
   }
 
 }
@@ -32,6 +32,7 @@
 #include "config.h"
 
 #include "skeletontree.h"
+#include "torsionscan.h"
 
 #include <avogadro/glwidget.h>
 #include <avogadro/tool.h>
@@ -49,9 +50,13 @@
 #include <QSpinBox>
 #include <QCheckBox>
 #include <QGridLayout>
+#include <QPushButton>
 
 namespace Avogadro {
 
+  class PlotWidget;
+  class PlotObject;
+
   /**
    * @class BondCentricTool
    * @brief Bond Centric Molecule Manipulation Tool
@@ -137,6 +142,11 @@ namespace Avogadro {
        */
       void showAnglesChanged(int state);
 
+      /**
+       * Starts a torsion scan around the selected bond.
+       */
+      void startScan();
+
     protected:
       Molecule *          m_molecule;
       QWidget *           m_settingsWidget;
@@ -176,6 +186,14 @@ namespace Avogadro {
       QSpinBox *          m_snapToAngleBox;
       QGridLayout *       m_layout;
 
+      TorsionScan *       m_scan;
+      QSpinBox *          m_scanStepBox;
+      QCheckBox *         m_scanRelaxBox;
+      QPushButton *       m_scanButton;
+      QLabel *            m_scanLabel;
+      PlotWidget *        m_scanPlot;
+      PlotObject *        m_scanObject;
+
       //! \name Construction Plane/Angles Methods
       //@{
       //! \brief Methods used to construct and draw the angle-sectors, the construction plane, and the rotation-sphere
@@ -343,6 +361,22 @@ namespace Avogadro {
        */
       void settingsWidgetDestroyed();
 
+      /**
+       * Redraws the torsion profile when a point of the scan is done.
+       */
+      void scanPointFinished(int index);
+
+      /**
+       * Function to be called when the torsion scan is done.
+       */
+      void scanFinished();
+
+      /**
+       * Moves the molecule to the minimum of the profile next to the
+       * clicked angle.
+       */
+      void scanPlotClicked(double x, double y);
+
   };
 
   /**
@@ -47,7 +47,10 @@ namespace Avogadro {
 
   // ##########  Destructor  ##########
 
-  Node::~Node() {}
+  Node::~Node()
+  {
+    qDeleteAll(m_nodes);
+  }
 
   // ##########  atom  ##########
 
@@ -114,7 +117,7 @@ namespace Avogadro {
 
   // ##########  Constructor  ##########
 
-  SkeletonTree::SkeletonTree() : m_rootNode(0) {}
+  SkeletonTree::SkeletonTree() : m_rootNode(0), m_rootBond(0), m_molecule(0) {}
 
   // ##########  Destructor  ##########
 
@@ -146,10 +149,13 @@ namespace Avogadro {
       delete m_rootNode;
       m_rootNode = 0;
     }
+    m_atoms.clear();
+    m_atomSet.clear();
 
     m_rootNode = new Node(rootAtom);
 
     m_rootBond = rootBond;
+    m_molecule = molecule;
 
     Atom* bAtom = m_rootBond->beginAtom();
     Atom* eAtom = m_rootBond->endAtom();
@@ -160,48 +166,55 @@ namespace Avogadro {
 
     Atom* diffAtom = (bAtom == m_rootNode->atom()) ? eAtom : bAtom;
 
-    //A temproray tree to find loops
-    m_endNode = new Node(diffAtom);
-
-    //Recursively go through molecule and make a temproray tree.
-    //starting from m_endNode
-    recursivePopulate(molecule, m_endNode, m_rootBond);
+    // The atoms on the other side of the bond are never moved, including
+    // those reached through a ring
+    QSet<Atom *> exclude;
+    exclude.insert(rootAtom);
+    QList<Atom *> otherSide = collect(diffAtom, m_rootBond, exclude, 0);
+    exclude = QSet<Atom *>::fromList(otherSide);
 
-    //Recursively go through molecule and make the tree.
-    //starting from m_rootNode
-    recursivePopulate(molecule, m_rootNode, m_rootBond);
-
-    //delete the temporary tree
-    delete m_endNode;
+    m_atoms = collect(rootAtom, m_rootBond, exclude, m_rootNode);
+    m_atomSet = QSet<Atom *>::fromList(m_atoms);
 
     //for debugging puposes
     //printSkeleton(m_rootNode);
   }
 
-  // ##########  recursivePopulate  ##########
+  // ##########  collect  ##########
 
-  void SkeletonTree::recursivePopulate(Molecule* mol, Node* node, Bond* bond)
+  QList<Atom *> SkeletonTree::collect(Atom *start, Bond *bond,
+                                      const QSet<Atom *> &exclude, Node *root)
   {
-    Atom* atom = node->atom();
-    int found = 0;
-
-    foreach (Bond *b, mol->bonds()) {
-      Atom* bAtom = b->beginAtom();
-      Atom* eAtom = b->endAtom();
-
-      if ((b != bond) && ((bAtom == atom) || (eAtom == atom))) {
-        Atom* diffAtom = (bAtom == atom) ? eAtom : bAtom;
-
-        //Check if this atom already exists, so not to form loops
-        if ((!m_endNode->containsAtom(diffAtom)) &&
-            (!m_rootNode->containsAtom(diffAtom))) {
-          Node* newNode = new Node(diffAtom);
-          node -> addNode(newNode);
-          found++;
-          recursivePopulate(mol, newNode, b);
+    QList<Atom *> atoms;
+    QList<Node *> nodes;
+    QSet<Atom *> visited = exclude;
+
+    atoms.append(start);
+    nodes.append(root);
+    visited.insert(start);
+
+    // Breadth first, each atom is only looked at once
+    for (int i = 0; i < atoms.size(); ++i) {
+      Atom *atom = atoms.at(i);
+      foreach (unsigned long id, atom->bonds()) {
+        Bond *b = m_molecule->bondById(id);
+        if (!b || b == bond)
+          continue;
+        Atom *next = m_molecule->atomById(b->otherAtom(atom->id()));
+        if (!next || visited.contains(next))
+          continue;
+        visited.insert(next);
+        atoms.append(next);
+        Node *node = 0;
+        if (root) {
+          node = new Node(next);
+          nodes.at(i)->addNode(node);
         }
+        nodes.append(node);
       }
     }
+
+    return atoms;
   }
 
   // ##########  skeletonTranslate  ##########
@@ -210,7 +223,9 @@ namespace Avogadro {
   {
     if (m_rootNode) {
       //Translate skeleton
-      recursiveTranslate(m_rootNode, translationVector);
+      foreach (Atom *a, m_atoms)
+        a->setPos(*(a->pos()) + translationVector);
+      update();
     }
   }
 
@@ -227,40 +242,20 @@ namespace Avogadro {
       rotation.pretranslate(centerVector);
       rotation.translate(-centerVector);
 
-      recursiveRotate(m_rootNode, rotation);
+      foreach (Atom *a, m_atoms)
+        a->setPos((rotation * (*a->pos()).homogeneous()).head<3>());
+      update();
     }
   }
 
-  // ##########  recursiveTranslate  ##########
-
-  void SkeletonTree::recursiveTranslate(Node* n,
-                                        const Eigen::Vector3d &translationVector)
-  {
-    // Translate the root node, and then update any children
-    Atom* a = n->atom();
-
-    a->setPos(*(a->pos()) + translationVector);
-    a->update();
-
-    foreach (Node* node, n->nodes())
-      recursiveTranslate(node, translationVector);
-  }
-
-  // ##########  recursiveRotate  ##########
+  // ##########  update  ##########
 
-  void SkeletonTree::recursiveRotate(Node* n,
-                                     const Eigen::Projective3d &rotationMatrix)
+  void SkeletonTree::update()
   {
-    // Update the root node with the new position
-    Atom* a = n->atom();
-    a->setPos((rotationMatrix * (*a->pos()).homogeneous()).head<3>());
-    a->update();
-
-    // Now update the children
-    foreach (Node *node, n->nodes())
-    {
-      recursiveRotate(node, rotationMatrix);
-    }
+    // The positions are tracked by the molecule as they are set, a single
+    // update is enough to redraw instead of one per moved atom
+    if (m_molecule)
+      m_molecule->update();
   }
 
   // ##########  printSkeleton  ##########
@@ -282,8 +277,14 @@ namespace Avogadro {
 
   bool SkeletonTree::containsAtom(Atom *atom)
   {
-    return m_rootNode ? m_rootNode->containsAtom(atom) : false;
+    return m_atomSet.contains(atom);
   }
 
-}
+  // ##########  atoms  ##########
 
+  QList<Atom *> SkeletonTree::atoms() const
+  {
+    return m_atoms;
+  }
+
+}
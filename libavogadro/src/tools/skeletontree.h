@@ -34,6 +34,7 @@
 
 #include <QObject>
 #include <QList>
+#include <QSet>
 
 #include <Eigen/Geometry>
 
@@ -194,43 +195,35 @@ namespace Avogadro {
        */
       bool containsAtom(Atom *atom);
 
+      /**
+       * @return All Atoms of the skeleton, the root Atom first.
+       */
+      QList<Atom *> atoms() const;
+
     protected:
       Node *m_rootNode; //The root node, tree
       Bond *m_rootBond; //The bond at which root node atom is attached
-      Node *m_endNode;  //A temporary tree.
+      Molecule *m_molecule;
+      QList<Atom *> m_atoms; // All atoms in the tree, breadth first
+      QSet<Atom *> m_atomSet;
 
     private:
       /**
-       * Recursively populates the tree, where the Node node is the root
-       * node to start from.
-       * It makes sure not to form loops.
+       * Collects the Atoms reachable from @p start without crossing
+       * @p bond or entering an Atom in @p exclude, breadth first.
        *
-       * @param mol The molecule to form the tree for.
-       * @param node The root node to form the tree from.
-       * @param bond The bond at which the root node atom exists.
+       * @param start The Atom to start from.
+       * @param bond The Bond that is not crossed.
+       * @param exclude Atoms that are not entered.
+       * @param root If not null, the tree is built under this Node.
        */
-      void recursivePopulate(Molecule* mol, Node* node, Bond* bond);
+      QList<Atom *> collect(Atom *start, Bond *bond,
+                            const QSet<Atom *> &exclude, Node *root);
 
       /**
-       * Recursively translates the Atoms attached to Node n in the skeleton by
-       * the given location.
-       * @param n The node atom and the atoms attached to it to translates.
-       * @param x New x location
-       * @param y New y location
-       * @param z New z location
-       */
-      void recursiveTranslate(Node* n, const Eigen::Vector3d &translationVector);
-
-      /**
-       * Recursivly rotates the Atoms attached to Node n in skeleton,
-       * around the Vector centerVector.
-       *
-       * @param n Current node to rotate
-       * @param rotationMatrix The rotation matrix for the transformation.
-       * @param centerVector Center location to rotate around.
+       * Emits a single update for the moved skeleton.
        */
-      void recursiveRotate(Node* n,
-                           const Eigen::Projective3d &rotationMatrix);
+      void update();
 
   };
 } // End namespace Avogadro
@@ -0,0 +1,357 @@
+/**********************************************************************
+  TorsionScan - Background energy profile of a bond torsion
+
+  Copyright (C) 2013 Avogadro Developers
+
+  This file is part of the Avogadro molecular editor project.
+  For more information, see <http://avogadro.cc/>
+
+  Avogadro is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  Avogadro is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+  02110-1301, USA.
+ **********************************************************************/
+
+#include "torsionscan.h"
+
+#include <avogadro/atom.h>
+#include <avogadro/bond.h>
+#include <avogadro/molecule.h>
+#include <avogadro/uffforcefield.h>
+
+#include <QMutexLocker>
+#include <QThread>
+#include <QtConcurrentRun>
+
+#include <Eigen/Geometry>
+
+#include <cmath>
+#include <limits>
+
+namespace Avogadro {
+
+  namespace {
+    // Maximum number of minimization steps at each angle when relaxing
+    const int relaxSteps = 200;
+
+    double dihedral(const Eigen::Vector3d &a, const Eigen::Vector3d &b,
+                    const Eigen::Vector3d &c, const Eigen::Vector3d &d)
+    {
+      const Eigen::Vector3d b1 = b - a;
+      const Eigen::Vector3d b2 = c - b;
+      const Eigen::Vector3d b3 = d - c;
+      return std::atan2(b2.norm() * b1.dot(b2.cross(b3)),
+                        b1.cross(b2).dot(b2.cross(b3))) * 180.0 / M_PI;
+    }
+
+    // Wrap an angle in degrees to (-180, 180]
+    double wrap(double angle)
+    {
+      angle = std::fmod(angle, 360.0);
+      if (angle <= -180.0)
+        angle += 360.0;
+      else if (angle > 180.0)
+        angle -= 360.0;
+      return angle;
+    }
+
+    // The heaviest neighbor of atom, other than exclude
+    Atom * heaviestNeighbor(Molecule *molecule, Atom *atom, Atom *exclude)
+    {
+      Atom *best = 0;
+      foreach (unsigned long id, atom->neighbors()) {
+        Atom *neighbor = molecule->atomById(id);
+        if (!neighbor || neighbor == exclude)
+          continue;
+        if (!best || neighbor->atomicNumber() > best->atomicNumber())
+          best = neighbor;
+      }
+      return best;
+    }
+
+    // The indices of the atoms connected to start, without going through
+    // the bond from start to other. Contains other if the bond is in a ring.
+    QList<int> side(Molecule *molecule, Atom *start, Atom *other)
+    {
+      QVector<bool> visited(molecule->numAtoms(), false);
+      QList<int> atoms;
+      atoms.append(start->index());
+      visited[start->index()] = true;
+
+      for (int i = 0; i < atoms.size(); ++i) {
+        Atom *atom = molecule->atom(atoms.at(i));
+        foreach (unsigned long id, atom->neighbors()) {
+          Atom *neighbor = molecule->atomById(id);
+          if (!neighbor || visited.at(neighbor->index()))
+            continue;
+          if (atom == start && neighbor == other)
+            continue;
+          visited[neighbor->index()] = true;
+          atoms.append(neighbor->index());
+        }
+      }
+      return atoms;
+    }
+  }
+
+  TorsionScan::TorsionScan(QObject *parent) : QObject(parent),
+    m_molecule(0), m_startAngle(0.0), m_step(10.0), m_relax(false),
+    m_canceled(0), m_remaining(0)
+  {
+    for (int i = 0; i < 4; ++i)
+      m_dihedral[i] = -1;
+  }
+
+  TorsionScan::~TorsionScan()
+  {
+    cancel();
+    clear();
+  }
+
+  bool TorsionScan::setup(Molecule *molecule, Bond *bond)
+  {
+    cancel();
+    clear();
+    m_molecule = molecule;
+    m_moving.clear();
+    for (int i = 0; i < 4; ++i)
+      m_dihedral[i] = -1;
+
+    if (!molecule || !bond) {
+      m_error = tr("No bond selected.");
+      return false;
+    }
+
+    Atom *b = bond->beginAtom();
+    Atom *c = bond->endAtom();
+    Atom *a = heaviestNeighbor(molecule, b, c);
+    Atom *d = heaviestNeighbor(molecule, c, b);
+    if (!a || !d) {
+      m_error = tr("Both atoms of the bond need another neighbor.");
+      return false;
+    }
+
+    QList<int> cSide = side(molecule, c, b);
+    if (cSide.contains(b->index())) {
+      m_error = tr("Bonds in rings cannot be rotated.");
+      return false;
+    }
+
+    // Rotate the smaller side, the dihedral is the same read backwards
+    QList<int> bSide = side(molecule, b, c);
+    if (bSide.size() < cSide.size()) {
+      qSwap(a, d);
+      qSwap(b, c);
+      cSide = bSide;
+    }
+
+    m_dihedral[0] = a->index();
+    m_dihedral[1] = b->index();
+    m_dihedral[2] = c->index();
+    m_dihedral[3] = d->index();
+    // The atom at the axis does not move
+    cSide.removeAll(c->index());
+    m_moving = cSide;
+    m_error.clear();
+    return true;
+  }
+
+  bool TorsionScan::start()
+  {
+    cancel();
+    clear();
+
+    if (!m_molecule || m_moving.isEmpty()) {
+      m_error = tr("No bond selected.");
+      return false;
+    }
+
+    UFFForceField *forceField = new UFFForceField;
+    m_forceFields.append(forceField);
+    if (!forceField->setup(m_molecule)) {
+      m_error = forceField->errorString();
+      clear();
+      return false;
+    }
+    if (m_relax) {
+      QList<int> fixed;
+      for (int j = 0; j < 4; ++j)
+        fixed << m_dihedral[j];
+      forceField->setFixedAtoms(fixed);
+    }
+
+    // Each worker evaluates its own copy of the force field
+    int parts = qMax(1, QThread::idealThreadCount());
+    const int n = qMax(1, qRound(360.0 / m_step));
+    parts = qMin(parts, n);
+    for (int i = 1; i < parts; ++i)
+      m_forceFields.append(new UFFForceField(*forceField));
+
+    // The scan starts from the current geometry
+    m_start = m_forceFields.first()->coordinates();
+    QList<int> indices = m_moving;
+    for (int i = 0; i < 4; ++i)
+      indices << m_dihedral[i];
+    foreach (int index, indices) {
+      if (index >= m_start.cols()) {
+        m_error = tr("The molecule changed, select the bond again.");
+        clear();
+        return false;
+      }
+    }
+    m_startAngle = dihedral(m_start.col(m_dihedral[0]),
+                            m_start.col(m_dihedral[1]),
+                            m_start.col(m_dihedral[2]),
+                            m_start.col(m_dihedral[3]));
+
+    m_points.resize(n);
+    for (int i = 0; i < n; ++i) {
+      m_points[i].angle = wrap(m_startAngle + i * 360.0 / n);
+      m_points[i].energy = 0.0;
+      m_points[i].done = false;
+    }
+
+    m_canceled = 0;
+    m_remaining = parts;
+    Point *points = m_points.data();
+    for (int i = 0; i < parts; ++i)
+      m_futures.append(QtConcurrent::run(this, &TorsionScan::scanPart,
+                                         m_forceFields.at(i), points, i, parts));
+    return true;
+  }
+
+  void TorsionScan::scanPart(UFFForceField *forceField, Point *points,
+                             int part, int parts)
+  {
+    const Eigen::Vector3d center = m_start.col(m_dihedral[1]);
+    const Eigen::Vector3d axis = (m_start.col(m_dihedral[2]) - center).normalized();
+    const int n = m_points.size();
+
+    // Interleaved, so that the whole profile fills in at the same rate
+    for (int i = part; i < n && !m_canceled; i += parts) {
+      Point &point = points[i];
+      const Eigen::AngleAxisd rotation((point.angle - m_startAngle) * M_PI / 180.0,
+                                       axis);
+      Eigen::Matrix3Xd pos = m_start;
+      foreach (int j, m_moving)
+        pos.col(j) = rotation * (m_start.col(j) - center) + center;
+
+      forceField->setCoordinates(pos);
+      if (m_relax)
+        forceField->lbfgs(relaxSteps);
+      const double energy = forceField->energy();
+
+      m_pointsMutex.lock();
+      point.energy = energy;
+      point.coordinates = forceField->coordinates();
+      point.done = true;
+      m_pointsMutex.unlock();
+      emit pointFinished(i);
+    }
+
+    if (!m_remaining.deref())
+      emit finished();
+  }
+
+  void TorsionScan::cancel()
+  {
+    m_canceled = 1;
+    foreach (QFuture<void> future, m_futures)
+      future.waitForFinished();
+    m_futures.clear();
+  }
+
+  bool TorsionScan::isRunning() const
+  {
+    foreach (const QFuture<void> &future, m_futures)
+      if (!future.isFinished())
+        return true;
+    return false;
+  }
+
+  void TorsionScan::clear()
+  {
+    qDeleteAll(m_forceFields);
+    m_forceFields.clear();
+    m_points.clear();
+  }
+
+  double TorsionScan::angle(int index) const
+  {
+    return m_points.at(index).angle;
+  }
+
+  bool TorsionScan::isDone(int index) const
+  {
+    QMutexLocker locker(&m_pointsMutex);
+    return index >= 0 && index < m_points.size() && m_points.at(index).done;
+  }
+
+  double TorsionScan::energy(int index) const
+  {
+    QMutexLocker locker(&m_pointsMutex);
+    return m_points.at(index).energy;
+  }
+
+  int TorsionScan::nearest(double angle) const
+  {
+    int best = -1;
+    double bestDistance = std::numeric_limits<double>::max();
+    for (int i = 0; i < m_points.size(); ++i) {
+      double distance = qAbs(wrap(m_points.at(i).angle - angle));
+      if (distance < bestDistance) {
+        bestDistance = distance;
+        best = i;
+      }
+    }
+    return best;
+  }
+
+  int TorsionScan::localMinimum(int index) const
+  {
+    QMutexLocker locker(&m_pointsMutex);
+    if (index < 0 || index >= m_points.size() || !m_points.at(index).done)
+      return index;
+
+    // The points are ordered by angle and the profile is periodic
+    const int n = m_points.size();
+    for (;;) {
+      int best = index;
+      const int next[2] = { (index + 1) % n, (index + n - 1) % n };
+      for (int k = 0; k < 2; ++k) {
+        const Point &point = m_points.at(next[k]);
+        if (point.done && point.energy < m_points.at(best).energy)
+          best = next[k];
+      }
+      if (best == index)
+        return index;
+      index = best;
+    }
+  }
+
+  bool TorsionScan::apply(int index)
+  {
+    if (!isDone(index) || !m_molecule || m_forceFields.isEmpty() ||
+        m_forceFields.first()->topologyChanged())
+      return false;
+
+    m_pointsMutex.lock();
+    const Eigen::Matrix3Xd pos = m_points.at(index).coordinates;
+    m_pointsMutex.unlock();
+    foreach (Atom *atom, m_molecule->atoms())
+      atom->setPos(pos.col(atom->index()));
+    m_molecule->update();
+    return true;
+  }
+
+} // End namespace Avogadro
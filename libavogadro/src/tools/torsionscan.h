@@ -0,0 +1,196 @@
+/**********************************************************************
+  TorsionScan - Background energy profile of a bond torsion
+
+  Copyright (C) 2013 Avogadro Developers
+
+  This file is part of the Avogadro molecular editor project.
+  For more information, see <http://avogadro.cc/>
+
+  Avogadro is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  Avogadro is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+  02110-1301, USA.
+ **********************************************************************/
+
+#ifndef TORSIONSCAN_H
+#define TORSIONSCAN_H
+
+#include <QObject>
+#include <QAtomicInt>
+#include <QFuture>
+#include <QList>
+#include <QMutex>
+#include <QPointer>
+#include <QString>
+#include <QVector>
+
+#include <Eigen/Core>
+
+namespace Avogadro {
+
+  class Atom;
+  class Bond;
+  class Molecule;
+  class UFFForceField;
+
+  /**
+   * @class TorsionScan torsionscan.h
+   * @brief Energy profile of the rotation around a bond.
+   *
+   * The atoms on one side of the bond are rotated rigidly over a grid of
+   * dihedral angles and the UFF energy is evaluated at each angle. The
+   * grid is split between worker threads, each with its own copy of the
+   * force field, and pointFinished() is emitted as soon as an angle is done
+   * so the profile can be drawn while the scan runs. Finished points are
+   * published under a mutex, so the accessors can be called at any time.
+   * With relaxation enabled the other degrees of freedom are minimized at
+   * each angle while the four atoms defining the dihedral are held fixed.
+   *
+   * The molecule is only changed by apply().
+   */
+  class TorsionScan : public QObject
+  {
+    Q_OBJECT
+
+    public:
+      TorsionScan(QObject *parent = 0);
+      virtual ~TorsionScan();
+
+      /**
+       * Prepare a scan around @p bond of @p molecule. The dihedral is
+       * measured from the heaviest neighbor of each bond atom.
+       *
+       * @return False if the bond cannot be rotated (it is in a ring or a
+       * bond atom has no other neighbor), see errorString().
+       */
+      bool setup(Molecule *molecule, Bond *bond);
+
+      /**
+       * @return The reason the last setup() or start() failed.
+       */
+      QString errorString() const { return m_error; }
+
+      /**
+       * The grid spacing in degrees, 10 by default.
+       */
+      void setStep(double step) { m_step = step; }
+      double step() const { return m_step; }
+
+      /**
+       * Minimize all other coordinates at each angle, off by default.
+       */
+      void setRelax(bool relax) { m_relax = relax; }
+      bool relax() const { return m_relax; }
+
+      /**
+       * Start the scan in the background. Any running scan is canceled.
+       * @return False if the force field could not be set up.
+       */
+      bool start();
+
+      /**
+       * Stop a running scan and wait for the worker threads.
+       */
+      void cancel();
+
+      bool isRunning() const;
+
+      /**
+       * @return The number of angles of the current scan.
+       */
+      int count() const { return m_points.size(); }
+
+      /**
+       * @return The dihedral angle of point @p index, in (-180, 180].
+       */
+      double angle(int index) const;
+
+      /**
+       * @return True once point @p index of the current scan is done.
+       */
+      bool isDone(int index) const;
+
+      /**
+       * @return The energy in kJ/mol of point @p index, only valid if
+       * isDone().
+       */
+      double energy(int index) const;
+
+      /**
+       * @return The point whose angle is closest to @p angle, or -1.
+       */
+      int nearest(double angle) const;
+
+      /**
+       * @return The finished point at the bottom of the well containing
+       * point @p index, following lower neighbors.
+       */
+      int localMinimum(int index) const;
+
+      /**
+       * Move the atoms of the molecule to the geometry of point @p index.
+       * @return False if the point is not finished or the atoms or bonds
+       * changed since the scan started.
+       */
+      bool apply(int index);
+
+    Q_SIGNALS:
+      /**
+       * Emitted from a worker thread when point @p index is done.
+       */
+      void pointFinished(int index);
+
+      /**
+       * Emitted from a worker thread after the last point.
+       */
+      void finished();
+
+    private:
+      struct Point
+      {
+        double angle;
+        double energy;
+        bool done;
+        Eigen::Matrix3Xd coordinates;
+      };
+
+      /**
+       * Evaluate every @p parts th point, starting at @p part.
+       */
+      void scanPart(UFFForceField *forceField, Point *points, int part,
+                    int parts);
+
+      void clear();
+
+      QPointer<Molecule> m_molecule;
+      int m_dihedral[4];       // atom indices, the last two are on the moving side
+      QList<int> m_moving;     // indices of the rotated atoms
+      double m_startAngle;
+      Eigen::Matrix3Xd m_start;
+
+      double m_step;
+      bool m_relax;
+      QString m_error;
+
+      QVector<Point> m_points;
+      // Guards energy, coordinates and done of m_points while scanning
+      mutable QMutex m_pointsMutex;
+      QList<UFFForceField *> m_forceFields;
+      QList<QFuture<void> > m_futures;
+      QAtomicInt m_canceled;
+      QAtomicInt m_remaining;
+  };
+
+} // End namespace Avogadro
+
+#endif
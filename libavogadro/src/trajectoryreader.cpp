@@ -0,0 +1,658 @@
+/**********************************************************************
+  TrajectoryReader - Native reader for periodic trajectories
+
+  Copyright (C) 2013 Avogadro Developers
+
+  This file is part of the Avogadro molecular editor project.
+  For more information, see <http://avogadro.cc/>
+
+  Avogadro is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  Avogadro is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+  02110-1301, USA.
+ **********************************************************************/
+
+#include "trajectoryreader.h"
+#include "connectthedots_p.h"
+
+#include <avogadro/molecule.h>
+#include <avogadro/atom.h>
+
+#include <openbabel/data.h>
+#include <openbabel/generic.h>
+
+#include <Eigen/Core>
+#include <Eigen/LU>
+
+#include <QFile>
+#include <QFileInfo>
+#include <QIODevice>
+#include <QList>
+#include <QStringList>
+
+#include <cctype>
+#include <cmath>
+#include <vector>
+
+using Eigen::Matrix3d;
+using Eigen::Vector3d;
+
+namespace Avogadro {
+
+  namespace {
+
+    // The energies of the files are in eV, Molecule keeps kJ/mol
+    const double EV_TO_KJ_PER_MOL = 96.4853365;
+
+    bool nextLine(QIODevice *device, QByteArray &line)
+    {
+      if (device->atEnd())
+        return false;
+      line = device->readLine();
+      return true;
+    }
+
+    /**
+     * Read up to @p count numbers from the start of @p line, independent
+     * of the locale.
+     * @return The number of numbers read.
+     */
+    int readNumbers(const QByteArray &line, double *values, int count)
+    {
+      const char *p = line.constData();
+      const char *end = p + line.size();
+      int n = 0;
+      while (n < count) {
+        while (p < end && isspace(*p))
+          ++p;
+        const char *start = p;
+        while (p < end && !isspace(*p))
+          ++p;
+        if (p == start)
+          break;
+        bool ok;
+        values[n] = QByteArray::fromRawData(start, p - start).toDouble(&ok);
+        if (!ok)
+          break;
+        ++n;
+      }
+      return n;
+    }
+
+    /**
+     * The element of a species name as VASP writes them, "Si", "Si_pv" or
+     * "Si/5a23b0", or a plain atomic number.
+     */
+    int elementNumber(const QByteArray &name)
+    {
+      bool ok;
+      const int number = name.toInt(&ok);
+      if (ok)
+        return number;
+      int length = 0;
+      while (length < name.size() && length < 2 && isalpha(name.at(length)))
+        ++length;
+      QByteArray symbol = name.left(length).toLower();
+      if (symbol.isEmpty())
+        return 0;
+      symbol[0] = toupper(symbol.at(0));
+      int atomicNumber = OpenBabel::etab.GetAtomicNum(symbol.constData());
+      if (!atomicNumber && length == 2)
+        atomicNumber = OpenBabel::etab.GetAtomicNum(symbol.left(1).constData());
+      return atomicNumber;
+    }
+
+    /**
+     * The value of @p key in an extended XYZ comment line, key=value or
+     * key="quoted value", the key is not case sensitive.
+     */
+    QByteArray commentValue(const QByteArray &comment, const QByteArray &key)
+    {
+      const QByteArray lower = comment.toLower();
+      const QByteArray pattern = key + '=';
+      int index = -1;
+      while ((index = lower.indexOf(pattern, index + 1)) >= 0)
+        if (index == 0 || isspace(lower.at(index - 1)))
+          break;
+      if (index < 0)
+        return QByteArray();
+
+      int start = index + pattern.size();
+      int end = start;
+      if (start < comment.size() && comment.at(start) == '"') {
+        ++start;
+        end = comment.indexOf('"', start);
+        if (end < 0)
+          end = comment.size();
+      }
+      else {
+        while (end < comment.size() && !isspace(comment.at(end)))
+          ++end;
+      }
+      return comment.mid(start, end - start);
+    }
+
+  } // End of anonymous namespace
+
+  class TrajectoryReaderPrivate
+  {
+  public:
+    TrajectoryReaderPrivate() : unwrap(true), stride(1), frameCount(0),
+      hasEnergies(false) { }
+    ~TrajectoryReaderPrivate() { clear(); }
+
+    void clear();
+
+    /**
+     * Shift the atoms of every frame by whole cells so that the molecules
+     * bonded across the faces of the first cell are whole.
+     */
+    void makeWhole(Molecule *molecule);
+
+    /**
+     * Unwrap @p positions, which are fractional if @p fractional, and keep
+     * them if the frame is not skipped by the stride.
+     * @return True if the frame was kept.
+     */
+    bool addFrame(std::vector<Vector3d> &positions, const Matrix3d *cell,
+                  bool fractional);
+
+    bool readXdatcar(QIODevice *device);
+    bool readOutcar(QIODevice *device);
+    bool readExtendedXyz(QIODevice *device);
+
+    bool unwrap;
+    int stride;
+    QString error;
+
+    std::vector<int> atomicNumbers;
+    std::vector< std::vector<Vector3d>* > frames;
+    std::vector<Matrix3d> cells;
+    std::vector<double> energies;
+    int frameCount;
+    bool hasEnergies;
+
+    // Fractional coordinates of the last frame as in the file and unwrapped
+    std::vector<Vector3d> previous;
+    std::vector<Vector3d> unwrapped;
+  };
+
+  void TrajectoryReaderPrivate::clear()
+  {
+    for (unsigned int i = 0; i < frames.size(); ++i)
+      delete frames[i];
+    frames.clear();
+    cells.clear();
+    energies.clear();
+    atomicNumbers.clear();
+    previous.clear();
+    unwrapped.clear();
+    frameCount = 0;
+    hasEnergies = false;
+    error.clear();
+  }
+
+  void TrajectoryReaderPrivate::makeWhole(Molecule *molecule)
+  {
+    // Walk the bonds from every unvisited atom, each atom is shifted by
+    // whole cells to the image nearest to the atom it was reached from
+    const Matrix3d inverse = cells.front().inverse();
+    const std::vector<Vector3d> &first = *frames.front();
+    std::vector<Vector3d> shifts(first.size(), Vector3d::Zero());
+    std::vector<bool> visited(first.size(), false);
+    bool shifted = false;
+    foreach (Atom *root, molecule->atoms()) {
+      if (visited[root->index()])
+        continue;
+      visited[root->index()] = true;
+      QList<Atom *> queue;
+      queue.append(root);
+      while (!queue.isEmpty()) {
+        Atom *atom = queue.takeFirst();
+        const unsigned int i = atom->index();
+        foreach (unsigned long id, atom->neighbors()) {
+          const unsigned int j = molecule->atomById(id)->index();
+          if (visited[j])
+            continue;
+          visited[j] = true;
+          const Vector3d step = inverse * (first[j] - first[i]);
+          for (int k = 0; k < 3; ++k)
+            shifts[j][k] = shifts[i][k] - std::floor(step[k] + 0.5);
+          shifted = shifted || !shifts[j].isZero();
+          queue.append(molecule->atomById(id));
+        }
+      }
+    }
+    if (!shifted)
+      return;
+
+    // The unwrapped frames keep the same shifts, in their own cells
+    for (unsigned int f = 0; f < frames.size(); ++f) {
+      std::vector<Vector3d> &positions = *frames[f];
+      for (unsigned int i = 0; i < positions.size(); ++i)
+        positions[i] += cells[f] * shifts[i];
+    }
+  }
+
+  bool TrajectoryReaderPrivate::addFrame(std::vector<Vector3d> &positions,
+                                         const Matrix3d *cell, bool fractional)
+  {
+    // All frames are unwrapped, also the ones skipped by the stride, as an
+    // atom may cross more than half of the cell between kept frames
+    if (cell) {
+      const Matrix3d inverse = cell->inverse();
+      const bool first = previous.size() != positions.size();
+      if (unwrap && first) {
+        previous.resize(positions.size());
+        unwrapped.resize(positions.size());
+      }
+      for (unsigned int i = 0; i < positions.size(); ++i) {
+        if (!unwrap) {
+          if (fractional)
+            positions[i] = *cell * positions[i];
+          continue;
+        }
+        const Vector3d f = fractional ? positions[i] : Vector3d(inverse * positions[i]);
+        if (first)
+          unwrapped[i] = f;
+        else {
+          // The shortest step between the images of the atom
+          Vector3d step = f - previous[i];
+          for (int k = 0; k < 3; ++k)
+            step[k] -= std::floor(step[k] + 0.5);
+          unwrapped[i] += step;
+        }
+        previous[i] = f;
+        positions[i] = *cell * unwrapped[i];
+      }
+    }
+
+    if (frameCount++ % stride)
+      return false;
+    frames.push_back(new std::vector<Vector3d>(positions));
+    cells.push_back(cell ? *cell : Matrix3d::Zero());
+    energies.push_back(0.0);
+    return true;
+  }
+
+  bool TrajectoryReaderPrivate::readXdatcar(QIODevice *device)
+  {
+    Matrix3d cell = Matrix3d::Zero();
+    double scale = 1.0;
+    bool hasHeader = false;
+    std::vector<Vector3d> positions;
+    QByteArray line;
+    while (nextLine(device, line)) {
+      const QByteArray trimmed = line.trimmed();
+      if (trimmed.isEmpty())
+        continue;
+
+      const bool cartesian = trimmed.startsWith("Cartesian");
+      if (cartesian || trimmed.startsWith("Direct")) {
+        if (!hasHeader) {
+          error = QObject::tr("Configuration found before the cell.");
+          return false;
+        }
+        positions.resize(atomicNumbers.size());
+        for (unsigned int i = 0; i < positions.size(); ++i) {
+          double values[3];
+          // A truncated last frame, e.g. of a running job, is dropped
+          if (!nextLine(device, line) || readNumbers(line, values, 3) != 3)
+            return true;
+          positions[i] = Vector3d(values[0], values[1], values[2]);
+          if (cartesian)
+            positions[i] *= scale;
+        }
+        addFrame(positions, &cell, !cartesian);
+        continue;
+      }
+
+      // The header, repeated before every frame if the cell changes: the
+      // title, the scale, the lattice vectors, the species and the counts
+      QList<QByteArray> names = trimmed.simplified().split(' ');
+      if (!nextLine(device, line) || readNumbers(line, &scale, 1) != 1) {
+        error = QObject::tr("Not an XDATCAR file.");
+        return false;
+      }
+      for (int i = 0; i < 3; ++i) {
+        double values[3];
+        if (!nextLine(device, line) || readNumbers(line, values, 3) != 3) {
+          error = QObject::tr("Incomplete lattice vectors.");
+          return false;
+        }
+        cell.col(i) = Vector3d(values[0], values[1], values[2]);
+      }
+      // A negative scale is the volume of the cell
+      if (scale < 0.0) {
+        scale = std::pow(-scale / std::fabs(cell.determinant()), 1.0 / 3.0);
+      }
+      cell *= scale;
+
+      if (!nextLine(device, line)) {
+        error = QObject::tr("Missing atom counts.");
+        return false;
+      }
+      // VASP 4 files have no species line, the title may have them
+      QByteArray counts = line.simplified();
+      if (!counts.isEmpty() && !isdigit(counts.at(0))) {
+        names = counts.split(' ');
+        if (!nextLine(device, line)) {
+          error = QObject::tr("Missing atom counts.");
+          return false;
+        }
+        counts = line.simplified();
+      }
+      std::vector<int> numbers;
+      QList<QByteArray> countList = counts.split(' ');
+      for (int i = 0; i < countList.size(); ++i) {
+        bool ok;
+        const int count = countList.at(i).toInt(&ok);
+        if (!ok || count < 0) {
+          error = QObject::tr("Invalid atom counts.");
+          return false;
+        }
+        numbers.insert(numbers.end(), count, elementNumber(names.value(i)));
+      }
+      if (atomicNumbers.empty())
+        atomicNumbers = numbers;
+      else if (numbers.size() != atomicNumbers.size()) {
+        error = QObject::tr("The number of atoms changes between frames.");
+        return false;
+      }
+      hasHeader = true;
+    }
+    return true;
+  }
+
+  bool TrajectoryReaderPrivate::readOutcar(QIODevice *device)
+  {
+    QList<QByteArray> names;
+    Matrix3d cell = Matrix3d::Zero();
+    bool hasCell = false;
+    bool lastKept = false;
+    std::vector<Vector3d> positions;
+    QByteArray line;
+    while (nextLine(device, line)) {
+      if (line.contains("TITEL")) {
+        // TITEL  = PAW_PBE Si 05Jan2001
+        QList<QByteArray> words = line.simplified().split(' ');
+        if (words.size() > 3)
+          names.append(words.at(3));
+      }
+      else if (line.contains("ions per type")) {
+        QList<QByteArray> counts = line.mid(line.indexOf('=') + 1).simplified().split(' ');
+        atomicNumbers.clear();
+        for (int i = 0; i < counts.size(); ++i)
+          atomicNumbers.insert(atomicNumbers.end(), counts.at(i).toInt(),
+                               elementNumber(names.value(i)));
+      }
+      else if (line.contains("direct lattice vectors")) {
+        // The direct vectors are followed by the reciprocal ones
+        for (int i = 0; i < 3; ++i) {
+          double values[3];
+          if (!nextLine(device, line) || readNumbers(line, values, 3) != 3) {
+            error = QObject::tr("Incomplete lattice vectors.");
+            return false;
+          }
+          cell.col(i) = Vector3d(values[0], values[1], values[2]);
+        }
+        hasCell = true;
+      }
+      else if (line.contains("POSITION") && line.contains("TOTAL-FORCE")) {
+        if (atomicNumbers.empty()) {
+          error = QObject::tr("Positions found before the atom types.");
+          return false;
+        }
+        // Skip the line of dashes
+        if (!nextLine(device, line))
+          return true;
+        positions.resize(atomicNumbers.size());
+        for (unsigned int i = 0; i < positions.size(); ++i) {
+          double values[3];
+          if (!nextLine(device, line) || readNumbers(line, values, 3) != 3)
+            return true;
+          positions[i] = Vector3d(values[0], values[1], values[2]);
+        }
+        lastKept = addFrame(positions, hasCell ? &cell : 0, false);
+      }
+      else if (lastKept && line.contains("free  energy   TOTEN")) {
+        double energy;
+        if (readNumbers(line.mid(line.indexOf('=') + 1), &energy, 1) == 1) {
+          energies.back() = energy * EV_TO_KJ_PER_MOL;
+          hasEnergies = true;
+        }
+        lastKept = false;
+      }
+    }
+    return true;
+  }
+
+  bool TrajectoryReaderPrivate::readExtendedXyz(QIODevice *device)
+  {
+    std::vector<Vector3d> positions;
+    QByteArray line;
+    while (nextLine(device, line)) {
+      const QByteArray trimmed = line.trimmed();
+      if (trimmed.isEmpty())
+        continue;
+      bool ok;
+      const int count = trimmed.toInt(&ok);
+      if (!ok || count <= 0) {
+        error = QObject::tr("Expected the number of atoms, found \"%1\".")
+          .arg(QString(trimmed.left(40)));
+        return false;
+      }
+      if (!atomicNumbers.empty() && count != static_cast<int>(atomicNumbers.size())) {
+        error = QObject::tr("The number of atoms changes between frames.");
+        return false;
+      }
+
+      QByteArray comment;
+      if (!nextLine(device, comment))
+        return true;
+
+      // Lattice="ax ay az bx by bz cx cy cz"
+      Matrix3d cell;
+      double values[9];
+      const bool hasCell =
+        readNumbers(commentValue(comment, "lattice"), values, 9) == 9;
+      if (hasCell) {
+        for (int i = 0; i < 3; ++i)
+          cell.col(i) = Vector3d(values[3 * i], values[3 * i + 1], values[3 * i + 2]);
+      }
+
+      // Properties=species:S:1:pos:R:3:forces:R:3 gives the columns
+      int speciesColumn = 0;
+      int positionColumn = 1;
+      const QByteArray properties = commentValue(comment, "properties");
+      if (!properties.isEmpty()) {
+        QList<QByteArray> fields = properties.split(':');
+        int column = 0;
+        for (int i = 0; i + 2 < fields.size(); i += 3) {
+          const QByteArray name = fields.at(i).toLower();
+          if (name == "species")
+            speciesColumn = column;
+          else if (name == "pos")
+            positionColumn = column;
+          column += fields.at(i + 2).toInt();
+        }
+      }
+
+      const bool first = atomicNumbers.empty();
+      positions.resize(count);
+      for (int i = 0; i < count; ++i) {
+        if (!nextLine(device, line))
+          return !first;
+        QList<QByteArray> words = line.simplified().split(' ');
+        if (words.size() < qMax(speciesColumn, positionColumn + 2) + 1) {
+          if (first)
+            error = QObject::tr("Incomplete atom line.");
+          return !first;
+        }
+        if (first)
+          atomicNumbers.push_back(elementNumber(words.at(speciesColumn)));
+        positions[i] = Vector3d(words.at(positionColumn).toDouble(),
+                                words.at(positionColumn + 1).toDouble(),
+                                words.at(positionColumn + 2).toDouble());
+      }
+
+      if (addFrame(positions, hasCell ? &cell : 0, false)) {
+        double energy;
+        if (readNumbers(commentValue(comment, "energy"), &energy, 1) == 1) {
+          energies.back() = energy * EV_TO_KJ_PER_MOL;
+          hasEnergies = true;
+        }
+      }
+    }
+    return true;
+  }
+
+  TrajectoryReader::TrajectoryReader() : d(new TrajectoryReaderPrivate)
+  {
+  }
+
+  TrajectoryReader::~TrajectoryReader()
+  {
+    delete d;
+  }
+
+  bool TrajectoryReader::canRead(const QString &fileName, const QString &fileType)
+  {
+    if (!fileType.isEmpty()) {
+      const QString type = fileType.toLower();
+      return type == "xdatcar" || type == "outcar" || type == "extxyz";
+    }
+
+    QFileInfo info(fileName);
+    const QString name = info.fileName().toUpper();
+    if (name.startsWith("XDATCAR") || name.startsWith("OUTCAR"))
+      return true;
+    const QString suffix = info.suffix().toLower();
+    if (suffix == "extxyz")
+      return true;
+    if (suffix != "xyz")
+      return false;
+
+    // Plain XYZ files are left to OpenBabel, only a lattice makes them ours
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly))
+      return false;
+    file.readLine();
+    return commentValue(file.readLine(), "lattice").size() > 0;
+  }
+
+  void TrajectoryReader::setOptions(const QString &options)
+  {
+    foreach (const QString &line, options.split('\n', QString::SkipEmptyParts)) {
+      QStringList words = line.simplified().split(' ', QString::SkipEmptyParts);
+      if (words.isEmpty())
+        continue;
+      const QString key = words.takeFirst().toLower();
+      if (key == "wrap")
+        setUnwrap(false);
+      else if (key == "unwrap")
+        setUnwrap(true);
+      else if (key == "stride")
+        setStride(words.value(0).toInt());
+    }
+  }
+
+  void TrajectoryReader::setUnwrap(bool unwrap)
+  {
+    d->unwrap = unwrap;
+  }
+
+  bool TrajectoryReader::unwrap() const
+  {
+    return d->unwrap;
+  }
+
+  void TrajectoryReader::setStride(int stride)
+  {
+    d->stride = qMax(1, stride);
+  }
+
+  int TrajectoryReader::stride() const
+  {
+    return d->stride;
+  }
+
+  QString TrajectoryReader::errorString() const
+  {
+    return d->error;
+  }
+
+  bool TrajectoryReader::read(QIODevice *device, Molecule *molecule)
+  {
+    d->clear();
+    if (!device || !molecule) {
+      d->error = QObject::tr("No file or molecule to read into.");
+      return false;
+    }
+    if (!device->isOpen() && !device->open(QIODevice::ReadOnly)) {
+      d->error = device->errorString();
+      return false;
+    }
+
+    // Recognize the format from the start of the file
+    const QByteArray head = device->peek(4096);
+    const int firstEnd = head.indexOf('\n');
+    bool xyz;
+    head.left(firstEnd).trimmed().toInt(&xyz);
+    bool success;
+    if (head.contains(" vasp.") || head.contains("POTCAR:"))
+      success = d->readOutcar(device);
+    else if (xyz)
+      success = d->readExtendedXyz(device);
+    else
+      success = d->readXdatcar(device);
+
+    if (!success || d->frames.empty()) {
+      if (d->error.isEmpty())
+        d->error = QObject::tr("No frames found.");
+      return false;
+    }
+
+    // Frames without a lattice, only possible in extended XYZ files, take
+    // the cell of the frame before them or the first cell in the file
+    unsigned int firstCell = 0;
+    while (firstCell < d->cells.size() && d->cells[firstCell].isZero())
+      ++firstCell;
+    const bool periodic = firstCell < d->cells.size();
+    if (periodic) {
+      for (unsigned int i = 0; i < d->cells.size(); ++i) {
+        if (d->cells[i].isZero())
+          d->cells[i] = i < firstCell ? d->cells[firstCell] : d->cells[i - 1];
+      }
+    }
+
+    // The first frame is wrapped, bonds across the faces of the cell are
+    // found between the nearest images
+    const std::vector<Vector3d> &first = *d->frames.front();
+    for (unsigned int i = 0; i < first.size(); ++i)
+      molecule->addAtom(d->atomicNumbers[i], first[i]);
+    connectTheDots(molecule, periodic ? &d->cells.front() : 0);
+    if (periodic && d->unwrap)
+      d->makeWhole(molecule);
+
+    molecule->setAllConformers(d->frames);
+    // The molecule owns the frames now
+    d->frames.clear();
+    if (periodic)
+      molecule->setConformerCells(d->cells);
+    if (d->hasEnergies)
+      molecule->setEnergies(d->energies);
+    return true;
+  }
+
+} // End namespace Avogadro
@@ -0,0 +1,117 @@
+/**********************************************************************
+  TrajectoryReader - Native reader for periodic trajectories
+
+  Copyright (C) 2013 Avogadro Developers
+
+  This file is part of the Avogadro molecular editor project.
+  For more information, see <http://avogadro.cc/>
+
+  Avogadro is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  Avogadro is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+  02110-1301, USA.
+ **********************************************************************/
+
+#ifndef TRAJECTORYREADER_H
+#define TRAJECTORYREADER_H
+
+#include <avogadro/global.h>
+
+#include <QString>
+
+class QIODevice;
+
+namespace Avogadro {
+
+  class Molecule;
+  class TrajectoryReaderPrivate;
+
+  /**
+   * @class TrajectoryReader trajectoryreader.h <avogadro/trajectoryreader.h>
+   * @brief Reads periodic trajectories whose cell may change every frame.
+   *
+   * Supported are VASP XDATCAR (fixed and variable cell) and OUTCAR files
+   * and extended XYZ files with a Lattice="..." entry on the comment line.
+   * The format is recognized from the content of the file.
+   *
+   * The atoms and bonds come from the first frame, every frame is added as
+   * a conformer and its cell matrix with Molecule::setConformerCells(), so
+   * the unit cell follows the animation. OUTCAR and extended XYZ energies
+   * are set with Molecule::setEnergies().
+   *
+   * Periodic codes wrap the atoms back into the cell, by default the
+   * frames are unwrapped by the minimum image convention in fractional
+   * coordinates so that the atoms move continuously. The bonds are found
+   * between the nearest images in the first frame and, when unwrapping,
+   * the molecules cut by the faces of the cell are made whole.
+   *
+   * @code
+   * TrajectoryReader reader;
+   * reader.setOptions("stride 10");
+   * if (!reader.read(&file, molecule))
+   *   qDebug() << reader.errorString();
+   * @endcode
+   */
+  class A_EXPORT TrajectoryReader
+  {
+  public:
+    TrajectoryReader();
+    ~TrajectoryReader();
+
+    /**
+     * @return True if @p fileName, or @p fileType if not empty, is a
+     * trajectory this reader should be used for: XDATCAR* and OUTCAR*
+     * files, .extxyz files and .xyz files with a lattice.
+     */
+    static bool canRead(const QString &fileName,
+                        const QString &fileType = QString());
+
+    /**
+     * Set the options from an option string, one option per line:
+     * "wrap" keeps the coordinates as in the file and "stride N" keeps
+     * every Nth frame. Unknown lines are ignored.
+     */
+    void setOptions(const QString &options);
+
+    /**
+     * Unwrap the atoms across the cell boundaries, the default is true.
+     */
+    void setUnwrap(bool unwrap);
+    bool unwrap() const;
+
+    /**
+     * Keep only every @p stride frame, starting with the first one. The
+     * default is 1.
+     */
+    void setStride(int stride);
+    int stride() const;
+
+    /**
+     * Read all the frames of @p device into @p molecule, which should be
+     * empty.
+     * @return False if no frame could be read, see errorString().
+     */
+    bool read(QIODevice *device, Molecule *molecule);
+
+    /**
+     * @return The reason the last read() failed.
+     */
+    QString errorString() const;
+
+  private:
+    TrajectoryReaderPrivate * const d;
+  };
+
+} // End namespace Avogadro
+
+#endif
@@ -0,0 +1,416 @@
+/**********************************************************************
+  TrajectorySpectrum - Vibrational spectra from molecular dynamics
+
+  Copyright (C) 2013 Avogadro Developers
+
+  This file is part of the Avogadro molecular editor project.
+  For more information, see <http://avogadro.cc/>
+
+  Avogadro is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  Avogadro is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+  02110-1301, USA.
+ **********************************************************************/
+
+#include "trajectoryspectrum.h"
+
+#include "atom.h"
+#include "molecule.h"
+
+#include <openbabel/mol.h>
+
+#include <QtCore/QThread>
+#include <QtCore/QtConcurrentMap>
+#include <QtCore/QVector>
+
+#include <cmath>
+#include <complex>
+
+namespace Avogadro {
+
+  using Eigen::Vector3d;
+
+  namespace {
+    typedef std::complex<double> Complex;
+
+    // Speed of light in cm/s and the second radiation constant h c / k in
+    // cm K
+    const double SpeedOfLight = 2.99792458e10;
+    const double RadiationConstant = 1.4387769;
+
+    unsigned int nextPowerOfTwo(unsigned int n)
+    {
+      unsigned int result = 1;
+      while (result < n)
+        result <<= 1;
+      return result;
+    }
+
+    /**
+     * @return The factors exp(-2 pi i j / @a n) used by fft() for
+     * transforms of up to @a n points.
+     */
+    std::vector<Complex> twiddleFactors(unsigned int n)
+    {
+      std::vector<Complex> twiddles(n / 2);
+      for (unsigned int j = 0; j < n / 2; ++j)
+        twiddles[j] = std::polar(1.0, -2.0 * M_PI * j / n);
+      return twiddles;
+    }
+
+    /**
+     * In place radix 2 FFT of @a data, whose size must be a power of two no
+     * larger than that of the @a twiddles. The inverse is not scaled.
+     */
+    void fft(std::vector<Complex> &data, const std::vector<Complex> &twiddles,
+             bool inverse)
+    {
+      const size_t n = data.size();
+      for (size_t i = 1, j = 0; i < n; ++i) {
+        size_t bit = n >> 1;
+        for (; j & bit; bit >>= 1)
+          j ^= bit;
+        j ^= bit;
+        if (i < j)
+          std::swap(data[i], data[j]);
+      }
+      for (size_t length = 2; length <= n; length <<= 1) {
+        const size_t half = length / 2;
+        const size_t stride = 2 * twiddles.size() / length;
+        for (size_t start = 0; start < n; start += length) {
+          for (size_t k = 0; k < half; ++k) {
+            const Complex w = inverse ? std::conj(twiddles[k * stride])
+                                      : twiddles[k * stride];
+            const Complex even = data[start + k];
+            const Complex odd = data[start + k + half] * w;
+            data[start + k] = even + odd;
+            data[start + k + half] = even - odd;
+          }
+        }
+      }
+    }
+
+    /**
+     * The frames of the trajectory and the per atom weights, shared by all
+     * blocks.
+     */
+    struct TrajectoryData
+    {
+      const std::vector<std::vector<Vector3d> *> *frames;
+      std::vector<unsigned long> ids;
+      std::vector<double> weights;
+      double timeStep;
+      std::vector<Complex> twiddles;
+    };
+
+    struct AtomBlock
+    {
+      unsigned int begin;
+      unsigned int end;
+      const TrajectoryData *data;
+      std::vector<double> power; // Summed |FFT|^2 of the velocities
+    };
+
+    /**
+     * Add the summed power spectra of the real and imaginary parts of the
+     * zero padded @a series to @a power. Packing two real series into one
+     * complex one halves the number of transforms.
+     */
+    void addPower(std::vector<Complex> &series,
+                  const std::vector<Complex> &twiddles,
+                  std::vector<double> &power)
+    {
+      fft(series, twiddles, false);
+      const size_t n = series.size();
+      for (size_t k = 0; k < n; ++k)
+        power[k] += 0.5 * (std::norm(series[k])
+                           + std::norm(series[(n - k) % n]));
+    }
+
+    /**
+     * The velocity of component @a c of the atom with @a id at frame
+     * @a t + 1, from central differences.
+     */
+    inline double velocity(const TrajectoryData &data, unsigned long id,
+                           int c, unsigned int t)
+    {
+      const std::vector<std::vector<Vector3d> *> &frames = *data.frames;
+      return ((*frames[t + 2])[id][c] - (*frames[t])[id][c])
+          / (2.0 * data.timeStep);
+    }
+
+    void processAtoms(AtomBlock &block)
+    {
+      const TrajectoryData &data = *block.data;
+      const unsigned int numSamples = data.frames->size() - 2;
+      const unsigned int size = 2 * data.twiddles.size();
+      block.power.assign(size, 0.0);
+      // The weights are folded into the series, so any two of the 3 series
+      // of each atom can share a transform
+      std::vector<Complex> series;
+      const unsigned int end = 3 * block.end;
+      for (unsigned int s = 3 * block.begin; s < end; s += 2) {
+        series.assign(size, Complex(0.0, 0.0));
+        const unsigned long re = data.ids[s / 3];
+        const double reWeight = data.weights[s / 3];
+        if (s + 1 < end) {
+          const unsigned long im = data.ids[(s + 1) / 3];
+          const double imWeight = data.weights[(s + 1) / 3];
+          for (unsigned int t = 0; t < numSamples; ++t)
+            series[t] = Complex(reWeight * velocity(data, re, s % 3, t),
+                                imWeight * velocity(data, im, (s + 1) % 3, t));
+        }
+        else {
+          for (unsigned int t = 0; t < numSamples; ++t)
+            series[t] = reWeight * velocity(data, re, s % 3, t);
+        }
+        addPower(series, data.twiddles, block.power);
+      }
+    }
+  }
+
+  class TrajectorySpectrumPrivate
+  {
+  public:
+    TrajectorySpectrumPrivate() : timeStep(1.0), correlationLength(0),
+      window(TrajectorySpectrum::HannWindow),
+      correction(TrajectorySpectrum::NoCorrection), temperature(300.0)
+    {
+    }
+
+    /**
+     * Turn the summed power of the velocities into the correlation function
+     * and the spectrum.
+     */
+    void transform(std::vector<double> &power, unsigned int numSamples);
+
+    double timeStep;
+    int correlationLength;
+    TrajectorySpectrum::Window window;
+    TrajectorySpectrum::Correction correction;
+    double temperature;
+
+    std::vector<double> autocorrelation;
+    std::vector<double> frequencies;
+    std::vector<double> intensities;
+  };
+
+  void TrajectorySpectrumPrivate::transform(std::vector<double> &power,
+                                            unsigned int numSamples)
+  {
+    // Wiener-Khinchin: the inverse transform of the power is the
+    // correlation, each lag is averaged over the samples it overlaps
+    std::vector<Complex> buffer(power.begin(), power.end());
+    fft(buffer, twiddleFactors(buffer.size()), true);
+    unsigned int length = correlationLength > 0 ? correlationLength
+                                                : numSamples / 2;
+    length = qBound(2u, length, numSamples);
+    autocorrelation.resize(length);
+    for (unsigned int t = 0; t < length; ++t)
+      autocorrelation[t] = buffer[t].real() / (numSamples - t);
+    if (autocorrelation[0] > 0.0) {
+      const double scale = 1.0 / autocorrelation[0];
+      for (unsigned int t = 0; t < length; ++t)
+        autocorrelation[t] *= scale;
+    }
+
+    // The spectrum is the cosine transform of the windowed, symmetric
+    // correlation function
+    const unsigned int size = nextPowerOfTwo(2 * length);
+    buffer.assign(size, Complex(0.0, 0.0));
+    for (unsigned int t = 0; t < length; ++t) {
+      const double x = M_PI * t / length;
+      double w = 1.0;
+      switch (window) {
+        case TrajectorySpectrum::HannWindow:
+          w = 0.5 * (1.0 + std::cos(x));
+          break;
+        case TrajectorySpectrum::BlackmanWindow:
+          w = 0.42 + 0.5 * std::cos(x) + 0.08 * std::cos(2.0 * x);
+          break;
+        default:
+          break;
+      }
+      buffer[t] = autocorrelation[t] * w;
+      if (t > 0)
+        buffer[size - t] = buffer[t];
+    }
+    fft(buffer, twiddleFactors(size), false);
+
+    const double step = 1.0 / (size * timeStep * 1.0e-15 * SpeedOfLight);
+    frequencies.resize(size / 2 + 1);
+    intensities.resize(size / 2 + 1);
+    for (unsigned int k = 0; k <= size / 2; ++k) {
+      const double wavenumber = k * step;
+      double factor = 1.0;
+      const double x = RadiationConstant * wavenumber / temperature;
+      switch (correction) {
+        case TrajectorySpectrum::HarmonicCorrection:
+          factor = x > 1.0e-8 ? x / (1.0 - std::exp(-x)) : 1.0;
+          break;
+        case TrajectorySpectrum::SchofieldCorrection:
+          factor = std::exp(0.5 * x);
+          break;
+        default:
+          break;
+      }
+      frequencies[k] = wavenumber;
+      intensities[k] = buffer[k].real() * timeStep * factor;
+    }
+  }
+
+  TrajectorySpectrum::TrajectorySpectrum() : d(new TrajectorySpectrumPrivate)
+  {
+  }
+
+  TrajectorySpectrum::~TrajectorySpectrum()
+  {
+    delete d;
+  }
+
+  void TrajectorySpectrum::setTimeStep(double femtoseconds)
+  {
+    if (femtoseconds > 0.0)
+      d->timeStep = femtoseconds;
+  }
+
+  double TrajectorySpectrum::timeStep() const
+  {
+    return d->timeStep;
+  }
+
+  void TrajectorySpectrum::setCorrelationLength(int frames)
+  {
+    d->correlationLength = qMax(frames, 0);
+  }
+
+  int TrajectorySpectrum::correlationLength() const
+  {
+    return d->correlationLength;
+  }
+
+  void TrajectorySpectrum::setWindow(Window window)
+  {
+    d->window = window;
+  }
+
+  TrajectorySpectrum::Window TrajectorySpectrum::window() const
+  {
+    return d->window;
+  }
+
+  void TrajectorySpectrum::setCorrection(Correction correction)
+  {
+    d->correction = correction;
+  }
+
+  TrajectorySpectrum::Correction TrajectorySpectrum::correction() const
+  {
+    return d->correction;
+  }
+
+  void TrajectorySpectrum::setTemperature(double kelvin)
+  {
+    if (kelvin > 0.0)
+      d->temperature = kelvin;
+  }
+
+  double TrajectorySpectrum::temperature() const
+  {
+    return d->temperature;
+  }
+
+  bool TrajectorySpectrum::calculate(const Molecule *molecule, Type type)
+  {
+    d->autocorrelation.clear();
+    d->frequencies.clear();
+    d->intensities.clear();
+    if (!molecule || !molecule->numAtoms() || molecule->numConformers() < 4)
+      return false;
+
+    TrajectoryData data;
+    data.frames = &molecule->conformers();
+    data.timeStep = d->timeStep;
+    const unsigned int numSamples = data.frames->size() - 2;
+    // Padding to twice the length makes the circular correlation linear
+    const unsigned int fftSize = nextPowerOfTwo(2 * numSamples);
+    data.twiddles = twiddleFactors(fftSize);
+    foreach (const Atom *atom, molecule->atoms()) {
+      data.ids.push_back(atom->id());
+      data.weights.push_back(type == PowerSpectrum
+          ? std::sqrt(OpenBabel::etab.GetMass(atom->atomicNumber()))
+          : atom->partialCharge());
+    }
+
+    std::vector<double> power;
+    if (type == PowerSpectrum) {
+      // The velocity correlations of the atoms add up, so every thread sums
+      // the power of its own atoms
+      const unsigned int numAtoms = data.ids.size();
+      const unsigned int numBlocks =
+          qMin(numAtoms, unsigned(qMax(QThread::idealThreadCount(), 1) * 2));
+      QVector<AtomBlock> blocks(numBlocks);
+      for (unsigned int b = 0; b < numBlocks; ++b) {
+        blocks[b].begin = b * numAtoms / numBlocks;
+        blocks[b].end = (b + 1) * numAtoms / numBlocks;
+        blocks[b].data = &data;
+      }
+      QtConcurrent::blockingMap(blocks, processAtoms);
+
+      power.assign(fftSize, 0.0);
+      foreach (const AtomBlock &block, blocks) {
+        for (unsigned int k = 0; k < fftSize; ++k)
+          power[k] += block.power[k];
+      }
+    }
+    else {
+      // The dipole derivative is the charge weighted sum of the velocities,
+      // x and y share one transform
+      power.assign(fftSize, 0.0);
+      std::vector<Complex> series;
+      for (int c = 0; c < 3; c += 2) {
+        series.assign(fftSize, Complex(0.0, 0.0));
+        for (unsigned int t = 0; t < numSamples; ++t) {
+          Complex sum(0.0, 0.0);
+          for (size_t i = 0; i < data.ids.size(); ++i) {
+            const unsigned long id = data.ids[i];
+            sum += data.weights[i] * (c == 0
+                ? Complex(velocity(data, id, 0, t), velocity(data, id, 1, t))
+                : Complex(velocity(data, id, 2, t), 0.0));
+          }
+          series[t] = sum;
+        }
+        addPower(series, data.twiddles, power);
+      }
+    }
+
+    d->transform(power, numSamples);
+    return true;
+  }
+
+  const std::vector<double> & TrajectorySpectrum::autocorrelation() const
+  {
+    return d->autocorrelation;
+  }
+
+  const std::vector<double> & TrajectorySpectrum::frequencies() const
+  {
+    return d->frequencies;
+  }
+
+  const std::vector<double> & TrajectorySpectrum::intensities() const
+  {
+    return d->intensities;
+  }
+
+} // End namespace Avogadro
@@ -0,0 +1,154 @@
+/**********************************************************************
+  TrajectorySpectrum - Vibrational spectra from molecular dynamics
+
+  Copyright (C) 2013 Avogadro Developers
+
+  This file is part of the Avogadro molecular editor project.
+  For more information, see <http://avogadro.cc/>
+
+  Avogadro is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  Avogadro is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+  02110-1301, USA.
+ **********************************************************************/
+
+#ifndef TRAJECTORYSPECTRUM_H
+#define TRAJECTORYSPECTRUM_H
+
+#include <avogadro/global.h>
+
+#include <vector>
+
+namespace Avogadro {
+
+  class Molecule;
+  class TrajectorySpectrumPrivate;
+
+  /**
+   * @class TrajectorySpectrum trajectoryspectrum.h <avogadro/trajectoryspectrum.h>
+   * @brief Calculates vibrational spectra from the conformers of a molecular
+   * dynamics trajectory.
+   *
+   * The conformers are taken to be the frames of the trajectory, a fixed
+   * time step apart. Velocities are found by central finite differences,
+   * so the positions must not be wrapped into the unit cell.
+   *
+   * - The power spectrum (vibrational density of states) is the Fourier
+   *   transform of the mass weighted velocity autocorrelation function.
+   * - The infrared spectrum is the Fourier transform of the autocorrelation
+   *   function of the time derivative of the dipole moment, which is found
+   *   from the partial charges of the atoms.
+   *
+   * The autocorrelation functions are calculated with FFTs of the zero
+   * padded series (Wiener-Khinchin), the atoms are split between threads
+   * with QtConcurrent. The cost is O(F log F) per atom for F frames, so long
+   * trajectories are cheap. Before the final transform the correlation
+   * function is cut at correlationLength() frames and multiplied by a
+   * window, which trades resolution for less ringing. A quantum correction
+   * factor can be applied to the classical spectrum.
+   *
+   * @code
+   * TrajectorySpectrum spectrum;
+   * spectrum.setTimeStep(0.5);
+   * if (spectrum.calculate(molecule, TrajectorySpectrum::PowerSpectrum))
+   *   for (size_t i = 0; i < spectrum.frequencies().size(); ++i)
+   *     qDebug() << spectrum.frequencies()[i] << spectrum.intensities()[i];
+   * @endcode
+   */
+  class A_EXPORT TrajectorySpectrum
+  {
+  public:
+    enum Type {
+      PowerSpectrum = 0,   //!< From the velocity autocorrelation
+      InfraredSpectrum     //!< From the dipole derivative autocorrelation
+    };
+
+    enum Window {
+      NoWindow = 0,
+      HannWindow,
+      BlackmanWindow
+    };
+
+    enum Correction {
+      NoCorrection = 0,
+      HarmonicCorrection,  //!< x / (1 - exp(-x)), x = h c nu / k T
+      SchofieldCorrection  //!< exp(x / 2)
+    };
+
+    TrajectorySpectrum();
+    ~TrajectorySpectrum();
+
+    /**
+     * Set the time between frames in femtoseconds, the default is 1 fs.
+     */
+    void setTimeStep(double femtoseconds);
+    double timeStep() const;
+
+    /**
+     * Set the number of frames the correlation function is calculated for.
+     * Zero, the default, uses half of the frames.
+     */
+    void setCorrelationLength(int frames);
+    int correlationLength() const;
+
+    /**
+     * Set the window applied to the correlation function, the default is
+     * HannWindow.
+     */
+    void setWindow(Window window);
+    Window window() const;
+
+    /**
+     * Set the quantum correction factor, the default is NoCorrection.
+     */
+    void setCorrection(Correction correction);
+    Correction correction() const;
+
+    /**
+     * Set the temperature in Kelvin for the quantum correction, the
+     * default is 300 K.
+     */
+    void setTemperature(double kelvin);
+    double temperature() const;
+
+    /**
+     * Calculate the spectrum of @p type from the conformers of @p molecule.
+     * @return False if there are fewer than four conformers.
+     */
+    bool calculate(const Molecule *molecule, Type type);
+
+    /**
+     * @return The normalized autocorrelation function, one value per frame
+     * of lag up to the correlation length.
+     */
+    const std::vector<double> & autocorrelation() const;
+
+    /**
+     * @return The wavenumbers of the spectrum in cm^-1, evenly spaced from 0
+     * up to the Nyquist frequency of the time step.
+     */
+    const std::vector<double> & frequencies() const;
+
+    /**
+     * @return The intensity at each of frequencies(), in arbitrary units.
+     */
+    const std::vector<double> & intensities() const;
+
+  private:
+    Q_DISABLE_COPY(TrajectorySpectrum)
+    TrajectorySpectrumPrivate * const d;
+  };
+
+} // End namespace Avogadro
+
+#endif
@@ -0,0 +1,1057 @@
+/**********************************************************************
+  UFFForceField - Native implementation of the Universal Force Field
+
+  Copyright (C) 2013 Avogadro Developers
+
+  This file is part of the Avogadro molecular editor project.
+  For more information, see <http://avogadro.cc/>
+
+  Avogadro is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  Avogadro is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+  02110-1301, USA.
+ **********************************************************************/
+
+#include "uffforcefield.h"
+#include "uffterms_p.h"
+
+#include <avogadro/molecule.h>
+#include <avogadro/atom.h>
+#include <avogadro/bond.h>
+#include <avogadro/obeigenconv.h>
+
+#include <openbabel/mol.h>
+#include <openbabel/data.h>
+#include <openbabel/generic.h>
+#include <openbabel/obiter.h>
+
+#include <Eigen/LU>
+
+#include <QHash>
+#include <QObject>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QStringList>
+#include <QThread>
+#include <QVector>
+#include <QtConcurrentRun>
+#include <QFuture>
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <vector>
+
+namespace Avogadro {
+
+  namespace {
+
+    const double kcalToKJ = 4.1868;
+    // Coulomb constant in kcal/mol Angstrom e^-2
+    const double coulomb = 332.0637;
+    // Extra distance kept in the pair list so it does not need to be
+    // rebuilt every step
+    const double pairSkin = 1.0;
+    // Width of the region below the cutoff over which the nonbonded
+    // energy is switched off
+    const double switchWidth = 1.0;
+    // Below this number of terms the evaluation is not split over threads
+    const int parallelThreshold = 20000;
+
+    struct UFFParameters
+    {
+      double r1, theta0, x1, D1, zeta, Z1, Vi, Uj, Xi, hard, radius;
+    };
+
+    QMutex parametersMutex;
+    QHash<QString, UFFParameters> parameterTable;
+    QStringList parameterTypes; // in file order
+
+    bool loadParameters()
+    {
+      QMutexLocker locker(&parametersMutex);
+      if (!parameterTable.isEmpty())
+        return true;
+
+      std::ifstream ifs;
+      if (OpenBabel::OpenDatafile(ifs, "UFF.prm").length() == 0 || !ifs)
+        return false;
+
+      std::string line;
+      while (std::getline(ifs, line)) {
+        QStringList fields = QString::fromStdString(line)
+                               .split(QRegExp("\\s+"), QString::SkipEmptyParts);
+        if (fields.size() < 13 || fields.at(0) != "param")
+          continue;
+
+        UFFParameters p;
+        double *values[11] = { &p.r1, &p.theta0, &p.x1, &p.D1, &p.zeta,
+                               &p.Z1, &p.Vi, &p.Uj, &p.Xi, &p.hard,
+                               &p.radius };
+        for (int i = 0; i < 11; ++i)
+          *values[i] = fields.at(i + 2).toDouble();
+
+        parameterTable.insert(fields.at(1), p);
+        parameterTypes.append(fields.at(1));
+      }
+      return !parameterTable.isEmpty();
+    }
+
+    // "C_3" -> "C", "Cl" -> "Cl", "Fe3+2" -> "Fe"
+    QString typeElement(const QString &type)
+    {
+      if (type.size() > 1 && type.at(1).isLower())
+        return type.left(2);
+      return type.left(1);
+    }
+
+    // The coordination/hybridization character of a type, e.g. '3' for
+    // "C_3", 'R' for "C_R" and '6' for "Fe6+2".
+    QChar typeHybrid(const QString &type)
+    {
+      return type.size() > 2 ? type.at(2) : QChar();
+    }
+
+    bool isSp2(QChar hybrid)
+    {
+      return hybrid == '2' || hybrid == 'R';
+    }
+
+    bool isGroup16(int atomicNumber)
+    {
+      return atomicNumber == 8 || atomicNumber == 16 || atomicNumber == 34 ||
+             atomicNumber == 52 || atomicNumber == 84;
+    }
+
+    QString assignType(int atomicNumber, int hybridization, bool aromatic)
+    {
+      QString element(OpenBabel::etab.GetSymbol(atomicNumber));
+      QString prefix = element.size() == 1 ? element + '_' : element;
+
+      QString hybrid;
+      if (aromatic)
+        hybrid = "R";
+      else if (hybridization >= 1 && hybridization <= 3)
+        hybrid = QString::number(hybridization);
+
+      if (!hybrid.isEmpty()) {
+        if (parameterTable.contains(prefix + hybrid))
+          return prefix + hybrid;
+        // e.g. "S_3+2" or "Al3"
+        foreach (const QString &type, parameterTypes)
+          if (type.startsWith(prefix + hybrid))
+            return type;
+        if (parameterTable.contains(element + hybrid))
+          return element + hybrid;
+      }
+
+      if (parameterTable.contains(prefix))
+        return prefix;
+      // the first type listed for the element
+      foreach (const QString &type, parameterTypes)
+        if (typeElement(type) == element)
+          return type;
+
+      return QString();
+    }
+
+    inline quint64 pairKey(int i, int j)
+    {
+      return i < j ? (quint64(i) << 32) | quint64(j)
+                   : (quint64(j) << 32) | quint64(i);
+    }
+
+  } // End anonymous namespace
+
+  class UFFForceFieldPrivate
+  {
+    public:
+      UFFForceFieldPrivate() : molecule(0), numAtoms(0), numBonds(0),
+        cutoff(10.0), electrostatics(true), periodic(false),
+        usePeriodic(false), pairsValid(false), pairSwitch2(0.0),
+        pairCutoff2(0.0)
+      {}
+
+      Molecule *molecule;
+      unsigned int numAtoms, numBonds;
+      QVector<int> atomicNumbers;
+      QString error;
+
+      double cutoff;
+      bool electrostatics;
+      bool periodic;
+
+      QStringList types;
+      QVector<UFFParameters> params;
+      QVector<double> charges;
+      std::vector<std::vector<int> > excluded; // sorted 1-2 and 1-3 partners
+      std::vector<bool> fixed;
+
+      std::vector<UFFBondTerm> bonds;
+      std::vector<UFFAngleTerm> angles;
+      std::vector<UFFTorsionTerm> torsions;
+      std::vector<UFFInversionTerm> inversions;
+      std::vector<UFFPairTerm> pairs;
+
+      Eigen::Matrix3Xd positions;
+
+      // Periodic cell, columns are the cell vectors
+      bool usePeriodic;
+      Eigen::Matrix3d cell, cellInverse;
+
+      // Pair list state
+      bool pairsValid;
+      double pairSwitch2;        // start of the switching region
+      double pairCutoff2;        // cutoff used during evaluation, 0 = none
+      Eigen::Matrix3Xd pairReference; // positions when the list was built
+
+      double naturalLength(int i, int j, double bondOrder) const;
+      void readCell();
+      bool isExcluded(int i, int j) const;
+      void addPair(int i, int j);
+      void buildPairs();
+      bool pairsNeedRebuild() const;
+      double evaluate(int part, int parts, int terms, Eigen::Matrix3Xd *grad) const;
+      double energy(int terms, Eigen::Matrix3Xd *grad);
+      void zeroFixed(Eigen::Matrix3Xd &grad) const;
+
+      inline Eigen::Vector3d delta(int i, int j) const
+      {
+        Eigen::Vector3d d = positions.col(i) - positions.col(j);
+        if (usePeriodic) {
+          Eigen::Vector3d f = cellInverse * d;
+          for (int k = 0; k < 3; ++k)
+            f[k] -= std::floor(f[k] + 0.5);
+          d = cell * f;
+        }
+        return d;
+      }
+  };
+
+  double UFFForceFieldPrivate::naturalLength(int i, int j, double bondOrder) const
+  {
+    const UFFParameters &pi = params[i];
+    const UFFParameters &pj = params[j];
+    // bond order correction
+    double rbo = -0.1332 * (pi.r1 + pj.r1) * std::log(bondOrder);
+    // electronegativity correction
+    double sqrtDiff = std::sqrt(pi.Xi) - std::sqrt(pj.Xi);
+    double ren = pi.r1 * pj.r1 * sqrtDiff * sqrtDiff /
+                 (pi.Xi * pi.r1 + pj.Xi * pj.r1);
+    return pi.r1 + pj.r1 + rbo - ren;
+  }
+
+  void UFFForceFieldPrivate::readCell()
+  {
+    usePeriodic = false;
+    OpenBabel::OBUnitCell *obcell = molecule ? molecule->OBUnitCell() : 0;
+    if (!periodic || !obcell)
+      return;
+
+    cell = OB2Eigen(obcell->GetCellMatrix()).transpose();
+    if (std::abs(cell.determinant()) < 1e-8)
+      return;
+    cellInverse = cell.inverse();
+    usePeriodic = true;
+  }
+
+  bool UFFForceFieldPrivate::isExcluded(int i, int j) const
+  {
+    const std::vector<int> &list = excluded[i];
+    return std::binary_search(list.begin(), list.end(), j);
+  }
+
+  void UFFForceFieldPrivate::addPair(int i, int j)
+  {
+    UFFPairTerm pair;
+    pair.i = i;
+    pair.j = j;
+    pair.x2 = params[i].x1 * params[j].x1;
+    pair.D = kcalToKJ * std::sqrt(params[i].D1 * params[j].D1);
+    pair.qq = electrostatics ? kcalToKJ * coulomb * charges[i] * charges[j] : 0.0;
+    pairs.push_back(pair);
+  }
+
+  void UFFForceFieldPrivate::buildPairs()
+  {
+    pairs.clear();
+    pairReference = positions;
+    pairsValid = true;
+    const int n = positions.cols();
+
+    double listCutoff = cutoff > 0.0 ? cutoff : 0.0;
+    if (usePeriodic) {
+      // The minimum image is only unique within half the smallest width
+      const double volume = std::abs(cell.determinant());
+      double halfWidth = 0.0;
+      for (int k = 0; k < 3; ++k) {
+        double width = volume / cell.col((k + 1) % 3).cross(cell.col((k + 2) % 3)).norm();
+        halfWidth = (k == 0) ? 0.5 * width : std::min(halfWidth, 0.5 * width);
+      }
+      if (listCutoff <= 0.0 || listCutoff > halfWidth)
+        listCutoff = halfWidth;
+    }
+    pairCutoff2 = listCutoff * listCutoff;
+    const double switchStart = std::max(0.0, listCutoff - switchWidth);
+    pairSwitch2 = switchStart * switchStart;
+
+    // All pairs, no cutoff
+    if (listCutoff <= 0.0) {
+      for (int i = 0; i < n; ++i)
+        for (int j = i + 1; j < n; ++j)
+          if (!isExcluded(i, j))
+            addPair(i, j);
+      return;
+    }
+
+    const double listRadius = listCutoff + pairSkin;
+    const double listRadius2 = listRadius * listRadius;
+
+    // Assign the atoms to cells of at least listRadius along each axis,
+    // in fractional coordinates for periodic systems
+    Eigen::Matrix3Xd coords(3, n);
+    Eigen::Vector3i dims;
+    if (usePeriodic) {
+      const double volume = std::abs(cell.determinant());
+      for (int k = 0; k < 3; ++k) {
+        double width = volume / cell.col((k + 1) % 3).cross(cell.col((k + 2) % 3)).norm();
+        dims[k] = std::max(1, int(std::floor(width / listRadius)));
+      }
+      coords = cellInverse * positions;
+      for (int i = 0; i < n; ++i)
+        for (int k = 0; k < 3; ++k)
+          coords(k, i) = (coords(k, i) - std::floor(coords(k, i))) * dims[k];
+    }
+    else {
+      Eigen::Vector3d min = positions.rowwise().minCoeff();
+      Eigen::Vector3d max = positions.rowwise().maxCoeff();
+      for (int k = 0; k < 3; ++k)
+        dims[k] = int(std::floor((max[k] - min[k]) / listRadius)) + 1;
+      coords = (positions.colwise() - min) / listRadius;
+    }
+
+    // With less than three cells along an axis the neighbouring cells
+    // overlap under periodic wrapping, fall back to checking all pairs
+    if (usePeriodic && (dims[0] < 3 || dims[1] < 3 || dims[2] < 3)) {
+      for (int i = 0; i < n; ++i)
+        for (int j = i + 1; j < n; ++j)
+          if (delta(i, j).squaredNorm() < listRadius2 && !isExcluded(i, j))
+            addPair(i, j);
+      return;
+    }
+
+    const int numCells = dims[0] * dims[1] * dims[2];
+    std::vector<int> head(numCells, -1);
+    std::vector<int> next(n, -1);
+    std::vector<Eigen::Vector3i> cellOf(n);
+    for (int i = 0; i < n; ++i) {
+      Eigen::Vector3i c;
+      for (int k = 0; k < 3; ++k)
+        c[k] = std::min(dims[k] - 1, std::max(0, int(std::floor(coords(k, i)))));
+      cellOf[i] = c;
+      int index = c[0] + dims[0] * (c[1] + dims[1] * c[2]);
+      next[i] = head[index];
+      head[index] = i;
+    }
+
+    for (int i = 0; i < n; ++i) {
+      const Eigen::Vector3i &c = cellOf[i];
+      for (int dz = -1; dz <= 1; ++dz) {
+        for (int dy = -1; dy <= 1; ++dy) {
+          for (int dx = -1; dx <= 1; ++dx) {
+            Eigen::Vector3i nc(c[0] + dx, c[1] + dy, c[2] + dz);
+            bool inside = true;
+            for (int k = 0; k < 3; ++k) {
+              if (nc[k] < 0 || nc[k] >= dims[k]) {
+                if (!usePeriodic)
+                  inside = false;
+                nc[k] = (nc[k] + dims[k]) % dims[k];
+              }
+            }
+            if (!inside)
+              continue;
+
+            int index = nc[0] + dims[0] * (nc[1] + dims[1] * nc[2]);
+            for (int j = head[index]; j != -1; j = next[j]) {
+              if (j <= i)
+                continue;
+              if (delta(i, j).squaredNorm() < listRadius2 && !isExcluded(i, j))
+                addPair(i, j);
+            }
+          }
+        }
+      }
+    }
+  }
+
+  bool UFFForceFieldPrivate::pairsNeedRebuild() const
+  {
+    if (!pairsValid || pairReference.cols() != positions.cols())
+      return true;
+    // Without a cutoff every pair is in the list already
+    if (pairCutoff2 <= 0.0)
+      return false;
+
+    const double limit2 = 0.25 * pairSkin * pairSkin;
+    return (positions - pairReference).colwise().squaredNorm().maxCoeff() > limit2;
+  }
+
+  double UFFForceFieldPrivate::evaluate(int part, int parts, int terms,
+                                        Eigen::Matrix3Xd *grad) const
+  {
+    double energy = 0.0;
+
+#define UFF_RANGE(list) \
+    const int begin = int(list.size() * qint64(part) / parts); \
+    const int end = int(list.size() * qint64(part + 1) / parts);
+
+    if (terms & UFFForceField::BondTerm) {
+      UFF_RANGE(bonds)
+      for (int i = begin; i < end; ++i) {
+        const UFFBondTerm &bond = bonds[i];
+        energy += uffBondEnergy(bond, delta(bond.i, bond.j), grad);
+      }
+    }
+    if (terms & UFFForceField::AngleTerm) {
+      UFF_RANGE(angles)
+      for (int i = begin; i < end; ++i) {
+        const UFFAngleTerm &angle = angles[i];
+        energy += uffAngleEnergy(angle, delta(angle.i, angle.j),
+                                 delta(angle.k, angle.j), grad);
+      }
+    }
+    if (terms & UFFForceField::TorsionTerm) {
+      UFF_RANGE(torsions)
+      for (int i = begin; i < end; ++i) {
+        const UFFTorsionTerm &torsion = torsions[i];
+        energy += uffTorsionEnergy(torsion, delta(torsion.i, torsion.j),
+                                   delta(torsion.j, torsion.k),
+                                   delta(torsion.l, torsion.k), grad);
+      }
+    }
+    if (terms & UFFForceField::InversionTerm) {
+      UFF_RANGE(inversions)
+      for (int i = begin; i < end; ++i) {
+        const UFFInversionTerm &inversion = inversions[i];
+        energy += uffInversionEnergy(inversion,
+                                     delta(inversion.i, inversion.center),
+                                     delta(inversion.j, inversion.center),
+                                     delta(inversion.l, inversion.center), grad);
+      }
+    }
+    if (terms & (UFFForceField::VdWTerm | UFFForceField::ElectrostaticTerm)) {
+      UFF_RANGE(pairs)
+      double vdw = 0.0, elec = 0.0;
+      double *vdwPtr = (terms & UFFForceField::VdWTerm) ? &vdw : 0;
+      double *elecPtr = (terms & UFFForceField::ElectrostaticTerm) ? &elec : 0;
+      for (int i = begin; i < end; ++i) {
+        const UFFPairTerm &pair = pairs[i];
+        uffPairEnergy(pair, delta(pair.i, pair.j), pairSwitch2, pairCutoff2,
+                      vdwPtr, elecPtr, grad);
+      }
+      energy += vdw + elec;
+    }
+
+#undef UFF_RANGE
+
+    return energy;
+  }
+
+  double UFFForceFieldPrivate::energy(int terms, Eigen::Matrix3Xd *grad)
+  {
+    if (grad)
+      grad->setZero(3, positions.cols());
+
+    if ((terms & (UFFForceField::VdWTerm | UFFForceField::ElectrostaticTerm))
+        && pairsNeedRebuild())
+      buildPairs();
+
+    const size_t numTerms = bonds.size() + angles.size() + torsions.size() +
+                            inversions.size() + pairs.size();
+    const int parts = numTerms > size_t(parallelThreshold)
+                      ? qMax(1, QThread::idealThreadCount()) : 1;
+    if (parts == 1)
+      return evaluate(0, 1, terms, grad);
+
+    // Every part accumulates into its own gradient, summed afterwards
+    std::vector<Eigen::Matrix3Xd> partGradients(parts);
+    QList<QFuture<double> > futures;
+    for (int part = 0; part < parts; ++part) {
+      Eigen::Matrix3Xd *partGrad = 0;
+      if (grad) {
+        partGradients[part].setZero(3, positions.cols());
+        partGrad = &partGradients[part];
+      }
+      futures.append(QtConcurrent::run(this, &UFFForceFieldPrivate::evaluate,
+                                       part, parts, terms, partGrad));
+    }
+
+    double energy = 0.0;
+    for (int part = 0; part < parts; ++part) {
+      energy += futures[part].result();
+      if (grad)
+        *grad += partGradients[part];
+    }
+    return energy;
+  }
+
+  void UFFForceFieldPrivate::zeroFixed(Eigen::Matrix3Xd &grad) const
+  {
+    for (size_t i = 0; i < fixed.size(); ++i)
+      if (fixed[i])
+        grad.col(i).setZero();
+  }
+
+  UFFForceField::UFFForceField() : d(new UFFForceFieldPrivate)
+  {
+  }
+
+  UFFForceField::UFFForceField(const UFFForceField &other)
+    : d(new UFFForceFieldPrivate(*other.d))
+  {
+  }
+
+  UFFForceField::~UFFForceField()
+  {
+    delete d;
+  }
+
+  UFFForceField & UFFForceField::operator=(const UFFForceField &other)
+  {
+    if (this != &other)
+      *d = *other.d;
+    return *this;
+  }
+
+  bool UFFForceField::setup(Molecule *molecule)
+  {
+    d->molecule = molecule;
+    d->error.clear();
+    d->types.clear();
+    d->params.clear();
+    d->charges.clear();
+    d->excluded.clear();
+    d->bonds.clear();
+    d->angles.clear();
+    d->torsions.clear();
+    d->inversions.clear();
+    d->pairs.clear();
+    d->pairsValid = false;
+
+    if (!molecule) {
+      d->error = QObject::tr("No molecule.");
+      return false;
+    }
+    if (!loadParameters()) {
+      d->error = QObject::tr("Could not read the UFF parameter file UFF.prm.");
+      return false;
+    }
+
+    const QList<Atom *> atoms = molecule->atoms();
+    const int n = atoms.size();
+    d->numAtoms = molecule->numAtoms();
+    d->numBonds = molecule->numBonds();
+    d->atomicNumbers.resize(n);
+    d->fixed.assign(n, false);
+
+    // The hybridization, aromaticity and amide perception is taken from
+    // OpenBabel, once
+    OpenBabel::OBMol obmol = molecule->OBMol();
+    if (int(obmol.NumAtoms()) != n) {
+      d->error = QObject::tr("Could not perceive the atom hybridization.");
+      return false;
+    }
+
+    d->params.resize(n);
+    d->charges.resize(n);
+    for (int i = 0; i < n; ++i) {
+      OpenBabel::OBAtom *obatom = obmol.GetAtom(i + 1);
+      d->atomicNumbers[i] = atoms[i]->atomicNumber();
+      QString type = assignType(atoms[i]->atomicNumber(), obatom->GetHyb(),
+                                obatom->IsAromatic());
+      if (type.isEmpty()) {
+        d->error = QObject::tr("No UFF atom type for atom %1 (%2).")
+                     .arg(i + 1).arg(OpenBabel::etab.GetSymbol(atoms[i]->atomicNumber()));
+        return false;
+      }
+      d->types.append(type);
+      d->params[i] = parameterTable.value(type);
+      d->charges[i] = atoms[i]->partialCharge();
+    }
+
+    // Bond orders as used by UFF
+    QHash<quint64, double> bondOrders;
+    FOR_BONDS_OF_MOL(obbond, obmol) {
+      double order = obbond->GetBondOrder();
+      if (obbond->IsAromatic())
+        order = 1.5;
+      if (obbond->IsAmide())
+        order = 1.41;
+      bondOrders.insert(pairKey(obbond->GetBeginAtomIdx() - 1,
+                                obbond->GetEndAtomIdx() - 1), order);
+    }
+
+    // Connectivity
+    std::vector<std::vector<int> > neighbors(n);
+    foreach (const Bond *bond, molecule->bonds()) {
+      int i = bond->beginAtom()->index();
+      int j = bond->endAtom()->index();
+      neighbors[i].push_back(j);
+      neighbors[j].push_back(i);
+
+      double order = bondOrders.value(pairKey(i, j), qMax(1, int(bond->order())));
+      UFFBondTerm term;
+      term.i = i;
+      term.j = j;
+      term.r0 = d->naturalLength(i, j, order);
+      term.kb = 0.5 * kcalToKJ * 664.12 * d->params[i].Z1 * d->params[j].Z1 /
+                (term.r0 * term.r0 * term.r0);
+      d->bonds.push_back(term);
+    }
+
+    // 1-2 and 1-3 exclusions for the nonbonded terms
+    d->excluded.resize(n);
+    for (int i = 0; i < n; ++i) {
+      std::vector<int> &list = d->excluded[i];
+      for (size_t a = 0; a < neighbors[i].size(); ++a) {
+        int j = neighbors[i][a];
+        list.push_back(j);
+        for (size_t b = 0; b < neighbors[j].size(); ++b)
+          if (neighbors[j][b] != i)
+            list.push_back(neighbors[j][b]);
+      }
+      std::sort(list.begin(), list.end());
+      list.erase(std::unique(list.begin(), list.end()), list.end());
+    }
+
+    // Angles
+    for (int j = 0; j < n; ++j) {
+      const UFFParameters &pj = d->params[j];
+      const double theta0 = pj.theta0 * M_PI / 180.0;
+      const double cosT0 = std::cos(theta0);
+      const double sinT0 = std::sin(theta0);
+      const QChar hybrid = typeHybrid(d->types[j]);
+
+      for (size_t a = 0; a < neighbors[j].size(); ++a) {
+        for (size_t b = a + 1; b < neighbors[j].size(); ++b) {
+          int i = neighbors[j][a];
+          int k = neighbors[j][b];
+          double rij = d->naturalLength(i, j, bondOrders.value(pairKey(i, j), 1.0));
+          double rjk = d->naturalLength(j, k, bondOrders.value(pairKey(j, k), 1.0));
+          double rik = std::sqrt(rij * rij + rjk * rjk - 2.0 * rij * rjk * cosT0);
+
+          UFFAngleTerm term;
+          term.i = i;
+          term.j = j;
+          term.k = k;
+          term.ka = kcalToKJ * 664.12 * d->params[i].Z1 * d->params[k].Z1 /
+                    std::pow(rik, 5) *
+                    (3.0 * rij * rjk * (1.0 - cosT0 * cosT0) - rik * rik * cosT0);
+          term.c0 = term.c1 = term.c2 = 0.0;
+          if (hybrid == '1') {
+            term.n = 1;
+          }
+          else if (isSp2(hybrid)) {
+            term.n = 3;
+            term.ka /= 9.0;
+          }
+          else if (hybrid == '4' || hybrid == '6') {
+            term.n = 4;
+            term.ka /= 16.0;
+          }
+          else {
+            term.n = 0;
+            term.c2 = 1.0 / (4.0 * sinT0 * sinT0);
+            term.c1 = -4.0 * term.c2 * cosT0;
+            term.c0 = term.c2 * (2.0 * cosT0 * cosT0 + 1.0);
+          }
+          d->angles.push_back(term);
+        }
+      }
+    }
+
+    // Torsions, about every bond between sp2/sp3 atoms
+    foreach (const Bond *bond, molecule->bonds()) {
+      int j = bond->beginAtom()->index();
+      int k = bond->endAtom()->index();
+      QChar hj = typeHybrid(d->types[j]);
+      QChar hk = typeHybrid(d->types[k]);
+      bool sp3j = hj == '3', sp3k = hk == '3';
+      if (!(sp3j || isSp2(hj)) || !(sp3k || isSp2(hk)))
+        continue;
+      if (neighbors[j].size() < 2 || neighbors[k].size() < 2)
+        continue;
+
+      double order = bondOrders.value(pairKey(j, k), 1.0);
+      const UFFParameters &pj = d->params[j];
+      const UFFParameters &pk = d->params[k];
+      int zj = d->atomicNumbers[j], zk = d->atomicNumbers[k];
+
+      UFFTorsionTerm term;
+      term.j = j;
+      term.k = k;
+      if (sp3j && sp3k) {
+        if (isGroup16(zj) && isGroup16(zk)) {
+          double vj = zj == 8 ? 2.0 : 6.8;
+          double vk = zk == 8 ? 2.0 : 6.8;
+          term.V = std::sqrt(vj * vk);
+          term.n = 2;
+          term.cosNPhi0 = -1.0; // phi0 = 90
+        }
+        else {
+          term.V = std::sqrt(pj.Vi * pk.Vi);
+          term.n = 3;
+          term.cosNPhi0 = -1.0; // phi0 = 180
+        }
+      }
+      else if (!sp3j && !sp3k) {
+        term.V = 5.0 * std::sqrt(pj.Uj * pk.Uj) * (1.0 + 4.18 * std::log(order));
+        term.n = 2;
+        term.cosNPhi0 = 1.0; // phi0 = 180
+      }
+      else {
+        // sp2-sp3
+        int sp3 = sp3j ? j : k;
+        int sp2 = sp3j ? k : j;
+        bool sp2NextToSp2 = false;
+        for (size_t a = 0; a < neighbors[sp2].size(); ++a) {
+          int other = neighbors[sp2][a];
+          if (other != sp3 && isSp2(typeHybrid(d->types[other])))
+            sp2NextToSp2 = true;
+        }
+        if (isGroup16(d->atomicNumbers[sp3])) {
+          term.V = 5.0 * std::sqrt(pj.Uj * pk.Uj) * (1.0 + 4.18 * std::log(order));
+          term.n = 2;
+          term.cosNPhi0 = -1.0; // phi0 = 90
+        }
+        else if (sp2NextToSp2) {
+          term.V = 2.0;
+          term.n = 3;
+          term.cosNPhi0 = -1.0; // phi0 = 180
+        }
+        else {
+          term.V = 1.0;
+          term.n = 6;
+          term.cosNPhi0 = 1.0; // phi0 = 0
+        }
+      }
+
+      // The barrier is shared by all torsions about the bond
+      std::vector<UFFTorsionTerm> bondTorsions;
+      for (size_t a = 0; a < neighbors[j].size(); ++a) {
+        int i = neighbors[j][a];
+        if (i == k)
+          continue;
+        for (size_t b = 0; b < neighbors[k].size(); ++b) {
+          int l = neighbors[k][b];
+          if (l == j || l == i)
+            continue;
+          term.i = i;
+          term.l = l;
+          bondTorsions.push_back(term);
+        }
+      }
+      for (size_t t = 0; t < bondTorsions.size(); ++t) {
+        bondTorsions[t].V *= kcalToKJ / bondTorsions.size();
+        d->torsions.push_back(bondTorsions[t]);
+      }
+    }
+
+    // Inversions on sp2 carbon and nitrogen
+    for (int c = 0; c < n; ++c) {
+      int z = d->atomicNumbers[c];
+      if ((z != 6 && z != 7) || neighbors[c].size() != 3 ||
+          !isSp2(typeHybrid(d->types[c])))
+        continue;
+
+      double K = 6.0;
+      if (z == 6) {
+        for (size_t a = 0; a < 3; ++a) {
+          int other = neighbors[c][a];
+          if (d->types[other] == "O_2")
+            K = 50.0;
+        }
+      }
+
+      UFFInversionTerm term;
+      term.center = c;
+      term.K = kcalToKJ * K / 3.0;
+      term.c0 = 1.0;
+      term.c1 = -1.0;
+      term.c2 = 0.0;
+      for (int a = 0; a < 3; ++a) {
+        term.i = neighbors[c][a];
+        term.j = neighbors[c][(a + 1) % 3];
+        term.l = neighbors[c][(a + 2) % 3];
+        d->inversions.push_back(term);
+      }
+    }
+
+    readCoordinates();
+    return true;
+  }
+
+  Molecule * UFFForceField::molecule() const
+  {
+    return d->molecule;
+  }
+
+  bool UFFForceField::topologyChanged() const
+  {
+    if (!d->molecule)
+      return true;
+    if (d->molecule->numAtoms() != d->numAtoms ||
+        d->molecule->numBonds() != d->numBonds)
+      return true;
+
+    const QList<Atom *> atoms = d->molecule->atoms();
+    for (int i = 0; i < atoms.size(); ++i)
+      if (atoms[i]->atomicNumber() != d->atomicNumbers[i])
+        return true;
+    return false;
+  }
+
+  QString UFFForceField::errorString() const
+  {
+    return d->error;
+  }
+
+  QString UFFForceField::atomType(int index) const
+  {
+    return d->types.value(index);
+  }
+
+  void UFFForceField::setCutoff(double cutoff)
+  {
+    d->cutoff = cutoff;
+    d->pairsValid = false;
+  }
+
+  double UFFForceField::cutoff() const
+  {
+    return d->cutoff;
+  }
+
+  void UFFForceField::setElectrostatics(bool enable)
+  {
+    d->electrostatics = enable;
+    d->pairsValid = false;
+  }
+
+  bool UFFForceField::electrostatics() const
+  {
+    return d->electrostatics;
+  }
+
+  void UFFForceField::setPeriodic(bool periodic)
+  {
+    d->periodic = periodic;
+    d->readCell();
+    d->pairsValid = false;
+  }
+
+  bool UFFForceField::periodic() const
+  {
+    return d->periodic;
+  }
+
+  void UFFForceField::setFixedAtoms(const QList<int> &indices)
+  {
+    std::fill(d->fixed.begin(), d->fixed.end(), false);
+    foreach (int index, indices)
+      if (index >= 0 && index < int(d->fixed.size()))
+        d->fixed[index] = true;
+  }
+
+  QList<int> UFFForceField::fixedAtoms() const
+  {
+    QList<int> indices;
+    for (size_t i = 0; i < d->fixed.size(); ++i)
+      if (d->fixed[i])
+        indices.append(int(i));
+    return indices;
+  }
+
+  void UFFForceField::readCoordinates()
+  {
+    if (!d->molecule)
+      return;
+
+    const QList<Atom *> atoms = d->molecule->atoms();
+    d->positions.resize(3, atoms.size());
+    for (int i = 0; i < atoms.size(); ++i)
+      d->positions.col(i) = *atoms[i]->pos();
+    // the cell may have changed as well
+    d->readCell();
+  }
+
+  void UFFForceField::writeCoordinates()
+  {
+    if (!d->molecule)
+      return;
+
+    const QList<Atom *> atoms = d->molecule->atoms();
+    if (atoms.size() != d->positions.cols())
+      return;
+    for (int i = 0; i < atoms.size(); ++i)
+      atoms[i]->setPos(d->positions.col(i));
+  }
+
+  const Eigen::Matrix3Xd & UFFForceField::coordinates() const
+  {
+    return d->positions;
+  }
+
+  void UFFForceField::setCoordinates(const Eigen::Matrix3Xd &coordinates)
+  {
+    d->positions = coordinates;
+  }
+
+  double UFFForceField::energy(Terms terms, Eigen::Matrix3Xd *gradient)
+  {
+    return d->energy(int(terms), gradient);
+  }
+
+  int UFFForceField::steepestDescent(int steps, double convergence)
+  {
+    Eigen::Matrix3Xd grad, newGrad;
+    double e = d->energy(AllTerms, &grad);
+    d->zeroFixed(grad);
+
+    // largest displacement of any atom per step, in Angstrom
+    double step = 0.1;
+    for (int n = 0; n < steps; ++n) {
+      double gmax = grad.cwiseAbs().maxCoeff();
+      if (gmax < 1.0e-10)
+        return n;
+
+      Eigen::Matrix3Xd old = d->positions;
+      d->positions -= (step / gmax) * grad;
+      double newE = d->energy(AllTerms, &newGrad);
+
+      if (newE < e) {
+        bool converged = (e - newE) < convergence;
+        e = newE;
+        grad = newGrad;
+        d->zeroFixed(grad);
+        step = qMin(step * 1.2, 0.3);
+        if (converged)
+          return n + 1;
+      }
+      else {
+        d->positions = old;
+        step *= 0.5;
+        if (step < 1.0e-8)
+          return n + 1;
+      }
+    }
+    return steps;
+  }
+
+  int UFFForceField::lbfgs(int steps, double convergence)
+  {
+    const int history = 10;
+    const int size = 3 * d->positions.cols();
+    if (size == 0)
+      return 0;
+
+    Eigen::Matrix3Xd gradMatrix, newGradMatrix;
+    double e = d->energy(AllTerms, &gradMatrix);
+    d->zeroFixed(gradMatrix);
+    Eigen::VectorXd g = Eigen::Map<Eigen::VectorXd>(gradMatrix.data(), size);
+
+    QList<Eigen::VectorXd> s, y;
+    QList<double> rho;
+
+    for (int n = 0; n < steps; ++n) {
+      if (g.cwiseAbs().maxCoeff() < convergence)
+        return n;
+
+      // Two loop recursion for the search direction
+      Eigen::VectorXd q = g;
+      QVector<double> alpha(s.size());
+      for (int i = s.size() - 1; i >= 0; --i) {
+        alpha[i] = rho[i] * s[i].dot(q);
+        q -= alpha[i] * y[i];
+      }
+      if (!s.isEmpty())
+        q *= s.last().dot(y.last()) / y.last().squaredNorm();
+      for (int i = 0; i < s.size(); ++i) {
+        double beta = rho[i] * y[i].dot(q);
+        q += (alpha[i] - beta) * s[i];
+      }
+      Eigen::VectorXd p = -q;
+      if (p.dot(g) >= 0.0) {
+        // not a descent direction, restart from steepest descent
+        p = -g;
+        s.clear();
+        y.clear();
+        rho.clear();
+      }
+
+      // Never move an atom more than 0.3 Angstrom per step
+      double scale = qMin(1.0, 0.3 / p.cwiseAbs().maxCoeff());
+      if (s.isEmpty())
+        scale = qMin(scale, 0.1 / p.cwiseAbs().maxCoeff());
+      p *= scale;
+
+      // Backtracking line search (Armijo condition)
+      Eigen::Map<Eigen::VectorXd> x(d->positions.data(), size);
+      const Eigen::VectorXd x0 = x;
+      const double slope = p.dot(g);
+      double step = 1.0;
+      double newE = e;
+      bool accepted = false;
+      for (int tries = 0; tries < 20; ++tries) {
+        x = x0 + step * p;
+        newE = d->energy(AllTerms, &newGradMatrix);
+        if (newE <= e + 1.0e-4 * step * slope) {
+          accepted = true;
+          break;
+        }
+        step *= 0.5;
+      }
+
+      if (!accepted) {
+        x = x0;
+        if (s.isEmpty())
+          return n + 1;
+        s.clear();
+        y.clear();
+        rho.clear();
+        continue;
+      }
+
+      d->zeroFixed(newGradMatrix);
+      Eigen::VectorXd newG = Eigen::Map<Eigen::VectorXd>(newGradMatrix.data(), size);
+      Eigen::VectorXd sk = x - x0;
+      Eigen::VectorXd yk = newG - g;
+      double sy = sk.dot(yk);
+      if (sy > 1.0e-10) {
+        s.append(sk);
+        y.append(yk);
+        rho.append(1.0 / sy);
+        if (s.size() > history) {
+          s.removeFirst();
+          y.removeFirst();
+          rho.removeFirst();
+        }
+      }
+
+      g = newG;
+      e = newE;
+    }
+    return steps;
+  }
+
+} // End namespace Avogadro
@@ -0,0 +1,191 @@
+/**********************************************************************
+  UFFForceField - Native implementation of the Universal Force Field
+
+  Copyright (C) 2013 Avogadro Developers
+
+  This file is part of the Avogadro molecular editor project.
+  For more information, see <http://avogadro.cc/>
+
+  Avogadro is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  Avogadro is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+  02110-1301, USA.
+ **********************************************************************/
+
+#ifndef UFFFORCEFIELD_H
+#define UFFFORCEFIELD_H
+
+#include <avogadro/global.h>
+
+#include <Eigen/Core>
+
+#include <QString>
+#include <QList>
+
+namespace Avogadro {
+
+  class Molecule;
+
+  class UFFForceFieldPrivate;
+
+  /**
+   * @class UFFForceField uffforcefield.h <avogadro/uffforcefield.h>
+   * @brief Native Universal Force Field energy, gradient and minimizers.
+   *
+   * Rappe, A. K.; Casewit, C. J.; Colwell, K. S.; Goddard III, W. A.;
+   * Skiff, W. M. J. Am. Chem. Soc. 1992, 114, 10024.
+   *
+   * setup() types the atoms and builds the bonded term tables once. The
+   * tables are kept until setup() is called again, so repeated energy
+   * evaluations or minimization steps on the same topology only move the
+   * coordinates. The parameters are read from the UFF.prm file shipped
+   * with OpenBabel and energies are reported in kJ/mol, the same units as
+   * OpenBabel's UFF.
+   *
+   * Van der Waals and electrostatic interactions are evaluated from a pair
+   * list built with a cell list. Pairs are kept within cutoff() plus a skin
+   * and the list is only rebuilt when an atom moved more than half of the
+   * skin. The energy is switched off smoothly over the last Angstrom below
+   * the cutoff so that energy and forces stay continuous. If the molecule
+   * has a unit cell and setPeriodic() is enabled the minimum image
+   * convention is used for all terms, which requires the cutoff to be less
+   * than half of the smallest cell width (it is clamped otherwise).
+   *
+   * Large systems are evaluated in parallel over all available cores.
+   *
+   * All functions work on an internal copy of the coordinates. The
+   * minimizers do not touch the molecule until writeCoordinates() is
+   * called, so they can run in a worker thread while the molecule is
+   * displayed.
+   */
+  class A_EXPORT UFFForceField
+  {
+  public:
+    /**
+     * The energy terms, can be combined.
+     */
+    enum Term {
+      BondTerm          = 0x01,
+      AngleTerm         = 0x02,
+      TorsionTerm       = 0x04,
+      InversionTerm     = 0x08,
+      VdWTerm           = 0x10,
+      ElectrostaticTerm = 0x20,
+      AllTerms          = 0x3F
+    };
+    Q_DECLARE_FLAGS(Terms, Term)
+
+    UFFForceField();
+    /**
+     * Copy the terms and coordinates of @p other, so that a force field
+     * set up once can be evaluated in several threads.
+     */
+    UFFForceField(const UFFForceField &other);
+    ~UFFForceField();
+
+    UFFForceField & operator=(const UFFForceField &other);
+
+    /**
+     * Type the atoms of @p molecule and set up all terms.
+     * @return False if an atom could not be typed, see errorString().
+     */
+    bool setup(Molecule *molecule);
+    /**
+     * @return The molecule passed to setup(), or 0.
+     */
+    Molecule * molecule() const;
+    /**
+     * @return True if the atoms or bonds of the molecule changed since
+     * setup(). A new setup() is required in that case.
+     */
+    bool topologyChanged() const;
+    /**
+     * @return The reason the last setup() failed.
+     */
+    QString errorString() const;
+
+    /**
+     * @return The UFF atom type of atom @p index.
+     */
+    QString atomType(int index) const;
+
+    /**
+     * Set the nonbonded cutoff distance in Angstrom. The interactions are
+     * switched off between cutoff - 1 and cutoff. A value <= 0 includes
+     * all pairs without switching. The default is 10 Angstrom.
+     */
+    void setCutoff(double cutoff);
+    double cutoff() const;
+
+    /**
+     * Enable or disable the Coulomb term. The partial charges of the atoms
+     * are used. Enabled by default.
+     */
+    void setElectrostatics(bool enable);
+    bool electrostatics() const;
+
+    /**
+     * Use periodic boundary conditions with the unit cell of the molecule.
+     * Disabled by default.
+     */
+    void setPeriodic(bool periodic);
+    bool periodic() const;
+
+    /**
+     * Atoms with these indices are not moved by the minimizers.
+     */
+    void setFixedAtoms(const QList<int> &indices);
+    QList<int> fixedAtoms() const;
+
+    /**
+     * Copy the current atom positions from the molecule.
+     */
+    void readCoordinates();
+    /**
+     * Write the optimized positions to the atoms of the molecule.
+     */
+    void writeCoordinates();
+    /**
+     * @return The internal coordinates, one column per atom index.
+     */
+    const Eigen::Matrix3Xd & coordinates() const;
+    void setCoordinates(const Eigen::Matrix3Xd &coordinates);
+
+    /**
+     * @return The energy for @p terms at the current coordinates, and
+     * the gradient dE/dx in @p gradient if it is not null.
+     */
+    double energy(Terms terms = AllTerms, Eigen::Matrix3Xd *gradient = 0);
+
+    /**
+     * Minimize the energy with steepest descent.
+     * @return The number of steps taken, stops early if the energy change
+     * is below @p convergence.
+     */
+    int steepestDescent(int steps, double convergence = 1.0e-6);
+    /**
+     * Minimize the energy with the limited memory BFGS method.
+     * @return The number of steps taken, stops early if the largest
+     * gradient component is below @p convergence.
+     */
+    int lbfgs(int steps, double convergence = 1.0e-4);
+
+  private:
+    UFFForceFieldPrivate * const d;
+  };
+
+  Q_DECLARE_OPERATORS_FOR_FLAGS(UFFForceField::Terms)
+
+} // End namespace Avogadro
+
+#endif
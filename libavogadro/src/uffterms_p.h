@@ -0,0 +1,297 @@
+/**********************************************************************
+  UFFTerms - Energy and gradient kernels of the native UFF implementation
+
+  Copyright (C) 2013 Avogadro Developers
+
+  This file is part of the Avogadro molecular editor project.
+  For more information, see <http://avogadro.cc/>
+
+  Avogadro is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  Avogadro is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+  02110-1301, USA.
+ **********************************************************************/
+
+#ifndef UFFTERMS_P_H
+#define UFFTERMS_P_H
+
+#include <Eigen/Core>
+#include <Eigen/Geometry>
+
+#include <cmath>
+
+namespace Avogadro {
+
+  // All energies are in kJ/mol and all distances in Angstrom, the same
+  // units as used by the OpenBabel force fields. Gradients are dE/dx and
+  // are accumulated into the columns of the gradient matrix.
+  //
+  // The kernels take the difference vectors between the atoms rather than
+  // the positions so that the caller can apply the minimum image
+  // convention for periodic systems.
+
+  /// E = kb (r - r0)^2
+  struct UFFBondTerm
+  {
+    int i, j;
+    double kb, r0;
+  };
+
+  /// E = ka (c0 + c1 cos(theta) + c2 cos(2 theta)) for n == 0,
+  /// E = ka (1 + cos(theta)) for n == 1 and
+  /// E = ka (1 - cos(n theta)) for n == 3, 4 (ka already divided by n^2).
+  /// j is the central atom.
+  struct UFFAngleTerm
+  {
+    int i, j, k;
+    int n;
+    double ka, c0, c1, c2;
+  };
+
+  /// E = V/2 (1 - cos(n phi0) cos(n phi)) for the dihedral i-j-k-l.
+  struct UFFTorsionTerm
+  {
+    int i, j, k, l;
+    int n;
+    double V, cosNPhi0;
+  };
+
+  /// E = K (c0 + c1 cos(w) + c2 cos(2w)) where w is the angle between the
+  /// center-l bond and the plane spanned by the center-i and center-j bonds.
+  struct UFFInversionTerm
+  {
+    int center, i, j, l;
+    double K, c0, c1, c2;
+  };
+
+  /// A nonbonded pair, the parameters are combined when the pair list
+  /// is built.
+  struct UFFPairTerm
+  {
+    int i, j;
+    double x2, D, qq;
+  };
+
+  /// @p d is r_i - r_j.
+  inline double uffBondEnergy(const UFFBondTerm &t, const Eigen::Vector3d &d,
+                              Eigen::Matrix3Xd *grad)
+  {
+    const double r = d.norm();
+    const double delta = r - t.r0;
+    if (grad && r > 1e-10) {
+      const Eigen::Vector3d g = (2.0 * t.kb * delta / r) * d;
+      grad->col(t.i) += g;
+      grad->col(t.j) -= g;
+    }
+    return t.kb * delta * delta;
+  }
+
+  /// @p a is r_i - r_j and @p b is r_k - r_j.
+  inline double uffAngleEnergy(const UFFAngleTerm &t, const Eigen::Vector3d &a,
+                               const Eigen::Vector3d &b, Eigen::Matrix3Xd *grad)
+  {
+    const double la = a.norm();
+    const double lb = b.norm();
+    if (la < 1e-10 || lb < 1e-10)
+      return 0.0;
+
+    double c = a.dot(b) / (la * lb);
+    if (c > 1.0)
+      c = 1.0;
+    else if (c < -1.0)
+      c = -1.0;
+
+    double energy, dEdc;
+    switch (t.n) {
+      case 1:
+        energy = t.ka * (1.0 + c);
+        dEdc = t.ka;
+        break;
+      case 3:
+        // cos(3 theta) = 4c^3 - 3c
+        energy = t.ka * (1.0 - (4.0 * c * c * c - 3.0 * c));
+        dEdc = -t.ka * (12.0 * c * c - 3.0);
+        break;
+      case 4:
+        // cos(4 theta) = 8c^4 - 8c^2 + 1
+        energy = t.ka * (1.0 - (8.0 * c * c * c * c - 8.0 * c * c + 1.0));
+        dEdc = -t.ka * (32.0 * c * c * c - 16.0 * c);
+        break;
+      default:
+        // cos(2 theta) = 2c^2 - 1
+        energy = t.ka * (t.c0 + t.c1 * c + t.c2 * (2.0 * c * c - 1.0));
+        dEdc = t.ka * (t.c1 + 4.0 * t.c2 * c);
+        break;
+    }
+
+    if (grad) {
+      const Eigen::Vector3d ua = a / la;
+      const Eigen::Vector3d ub = b / lb;
+      const Eigen::Vector3d ga = (dEdc / la) * (ub - c * ua);
+      const Eigen::Vector3d gb = (dEdc / lb) * (ua - c * ub);
+      grad->col(t.i) += ga;
+      grad->col(t.k) += gb;
+      grad->col(t.j) -= ga + gb;
+    }
+    return energy;
+  }
+
+  /// @p F is r_i - r_j, @p G is r_j - r_k and @p H is r_l - r_k.
+  inline double uffTorsionEnergy(const UFFTorsionTerm &t, const Eigen::Vector3d &F,
+                                 const Eigen::Vector3d &G, const Eigen::Vector3d &H,
+                                 Eigen::Matrix3Xd *grad)
+  {
+    const Eigen::Vector3d A = F.cross(G);
+    const Eigen::Vector3d B = H.cross(G);
+    const double lA = A.norm();
+    const double lB = B.norm();
+    // Collinear atoms, the dihedral is undefined
+    if (lA < 1e-10 || lB < 1e-10)
+      return 0.0;
+
+    double c = A.dot(B) / (lA * lB);
+    if (c > 1.0)
+      c = 1.0;
+    else if (c < -1.0)
+      c = -1.0;
+
+    // cos(n phi) and its derivative as Chebyshev polynomials of cos(phi)
+    double cosN, dCosN;
+    const double c2 = c * c;
+    switch (t.n) {
+      case 1:
+        cosN = c;
+        dCosN = 1.0;
+        break;
+      case 2:
+        cosN = 2.0 * c2 - 1.0;
+        dCosN = 4.0 * c;
+        break;
+      case 3:
+        cosN = (4.0 * c2 - 3.0) * c;
+        dCosN = 12.0 * c2 - 3.0;
+        break;
+      case 6:
+        cosN = ((32.0 * c2 - 48.0) * c2 + 18.0) * c2 - 1.0;
+        dCosN = ((192.0 * c2 - 192.0) * c2 + 36.0) * c;
+        break;
+      default:
+        return 0.0;
+    }
+
+    if (grad) {
+      const double dEdc = -0.5 * t.V * t.cosNPhi0 * dCosN;
+      const Eigen::Vector3d uA = A / lA;
+      const Eigen::Vector3d uB = B / lB;
+      const Eigen::Vector3d pA = (uB - c * uA) / lA;
+      const Eigen::Vector3d pB = (uA - c * uB) / lB;
+      const Eigen::Vector3d gF = dEdc * G.cross(pA);
+      const Eigen::Vector3d gH = dEdc * G.cross(pB);
+      const Eigen::Vector3d gG = dEdc * (pA.cross(F) + pB.cross(H));
+      grad->col(t.i) += gF;
+      grad->col(t.j) += gG - gF;
+      grad->col(t.k) -= gG + gH;
+      grad->col(t.l) += gH;
+    }
+    return 0.5 * t.V * (1.0 - t.cosNPhi0 * cosN);
+  }
+
+  /// @p P, @p Q and @p v are r_i, r_j and r_l relative to the center.
+  inline double uffInversionEnergy(const UFFInversionTerm &t, const Eigen::Vector3d &P,
+                                   const Eigen::Vector3d &Q, const Eigen::Vector3d &v,
+                                   Eigen::Matrix3Xd *grad)
+  {
+    const Eigen::Vector3d n = P.cross(Q);
+    const double ln = n.norm();
+    const double lv = v.norm();
+    if (ln < 1e-10 || lv < 1e-10)
+      return 0.0;
+
+    const Eigen::Vector3d un = n / ln;
+    const Eigen::Vector3d uv = v / lv;
+    // s = sin(w), w = cos(w)
+    double s = un.dot(uv);
+    if (s > 1.0)
+      s = 1.0;
+    else if (s < -1.0)
+      s = -1.0;
+    const double w = std::sqrt(1.0 - s * s);
+
+    if (grad && w > 1e-8) {
+      const double dEds = t.K * (t.c1 + 4.0 * t.c2 * w) * (-s / w);
+      const Eigen::Vector3d pn = (uv - s * un) / ln;
+      const Eigen::Vector3d gv = (dEds / lv) * (un - s * uv);
+      const Eigen::Vector3d gP = dEds * Q.cross(pn);
+      const Eigen::Vector3d gQ = dEds * pn.cross(P);
+      grad->col(t.i) += gP;
+      grad->col(t.j) += gQ;
+      grad->col(t.l) += gv;
+      grad->col(t.center) -= gP + gQ + gv;
+    }
+    return t.K * (t.c0 + t.c1 * w + t.c2 * (2.0 * w * w - 1.0));
+  }
+
+  /**
+   * Lennard-Jones and Coulomb energy of a pair separated by @p d
+   * (r_i - r_j, already minimum imaged for periodic systems). If
+   * @p cutoff2 is positive the energy is switched off smoothly between
+   * @p switch2 and @p cutoff2 (both squared distances) with the CHARMM
+   * switching function, so that energy and forces go to zero continuously
+   * at the cutoff.
+   */
+  inline double uffPairEnergy(const UFFPairTerm &t, const Eigen::Vector3d &d,
+                              double switch2, double cutoff2,
+                              double *vdw, double *elec, Eigen::Matrix3Xd *grad)
+  {
+    const double r2 = d.squaredNorm();
+    if ((cutoff2 > 0.0 && r2 >= cutoff2) || r2 < 1e-10)
+      return 0.0;
+
+    // S = (rc^2 - r^2)^2 (rc^2 + 2 r^2 - 3 rs^2) / (rc^2 - rs^2)^3
+    double s = 1.0, dSdr = 0.0;
+    if (cutoff2 > 0.0 && r2 > switch2) {
+      const double width = cutoff2 - switch2;
+      const double inv3 = 1.0 / (width * width * width);
+      const double outer = cutoff2 - r2;
+      s = outer * outer * (cutoff2 + 2.0 * r2 - 3.0 * switch2) * inv3;
+      // (dS/dr) / r
+      dSdr = 12.0 * outer * (switch2 - r2) * inv3;
+    }
+
+    const double inv2 = 1.0 / r2;
+    const double t3 = std::pow(t.x2 * inv2, 3);
+    const double eVdw = t.D * (t3 * t3 - 2.0 * t3);
+    const double eElec = t.qq * std::sqrt(inv2);
+    if (vdw)
+      *vdw += s * eVdw;
+    if (elec)
+      *elec += s * eElec;
+
+    const double energy = (vdw ? eVdw : 0.0) + (elec ? eElec : 0.0);
+    if (grad) {
+      // (dE/dr) / r for both terms
+      double dEdr = 0.0;
+      if (vdw)
+        dEdr += 12.0 * t.D * (t3 - t3 * t3) * inv2;
+      if (elec)
+        dEdr -= eElec * inv2;
+      const Eigen::Vector3d g = (s * dEdr + energy * dSdr) * d;
+      grad->col(t.i) += g;
+      grad->col(t.j) -= g;
+    }
+    return s * energy;
+  }
+
+} // End namespace Avogadro
+
+#endif
@@ -0,0 +1,142 @@
+/**********************************************************************
+  AdaptiveGridTest - unit tests for the adaptively refined cubes
+
+  Copyright (C) 2013 Avogadro Developers
+
+  This file is part of the Avogadro molecular editor project.
+  For more information, see <http://avogadro.cc/>
+
+  Avogadro is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  Avogadro is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+  02110-1301, USA.
+ **********************************************************************/
+
+#include "config.h"
+
+#include <QtTest>
+#include <openqube/adaptivegrid.h>
+#include <openqube/cube.h>
+
+#include <cmath>
+#include <vector>
+
+using OpenQube::AdaptiveGrid;
+using OpenQube::Cube;
+
+using Eigen::Vector3d;
+using Eigen::Vector3i;
+
+class AdaptiveGridTest : public QObject
+{
+  Q_OBJECT
+
+  private:
+    /**
+     * A p-like positive lobe around (-1, 0, 0) and a tighter negative lobe
+     * around (1.2, 0.3, 0).
+     */
+    static double twoLobes(const Vector3d &pos);
+
+    /**
+     * Set up @p cube as an 81x61x57 grid with 0.1 A spacing.
+     */
+    void setLimits(Cube *cube);
+
+  private slots:
+    /**
+     * Only a fraction of the points are evaluated, and every point falls on
+     * the same side of +iso and -iso as on the fully evaluated cube.
+     */
+    void twoLobeGrid();
+
+    /**
+     * The coarse cells are all resolved once refinement completes.
+     */
+    void progress();
+};
+
+double AdaptiveGridTest::twoLobes(const Vector3d &pos)
+{
+  const Vector3d a(-1.0, 0.0, 0.0);
+  const Vector3d b(1.2, 0.3, 0.0);
+  return (pos.x() + 1.0) * exp(-1.5 * (pos - a).squaredNorm())
+    - 0.8 * exp(-3.0 * (pos - b).squaredNorm());
+}
+
+void AdaptiveGridTest::setLimits(Cube *cube)
+{
+  cube->setLimits(Vector3d(-4.0, -3.0, -3.0), Vector3i(81, 61, 57), 0.1);
+}
+
+void AdaptiveGridTest::twoLobeGrid()
+{
+  const double iso = 0.05;
+
+  Cube full;
+  setLimits(&full);
+  std::vector<double> &fullData = *full.data();
+  for (unsigned int i = 0; i < fullData.size(); ++i)
+    fullData[i] = twoLobes(full.position(i));
+
+  Cube cube;
+  setLimits(&cube);
+  AdaptiveGrid grid(&cube, iso);
+  grid.addNucleus(Vector3d(-1.0, 0.0, 0.0));
+  grid.addNucleus(Vector3d(1.2, 0.3, 0.0));
+  while (!grid.pending().empty()) {
+    const std::vector<unsigned int> &points = grid.pending();
+    for (unsigned int i = 0; i < points.size(); ++i)
+      cube.setValue(points[i], twoLobes(cube.position(points[i])));
+    grid.refine();
+  }
+  grid.interpolate();
+
+  const std::vector<double> &data = *cube.data();
+  QCOMPARE(data.size(), fullData.size());
+  double fraction = double(grid.numEvaluated()) / data.size();
+  QVERIFY(fraction < 0.2);
+
+  int differences = 0;
+  for (unsigned int i = 0; i < data.size(); ++i) {
+    if ((data[i] > iso) != (fullData[i] > iso)
+        || (data[i] < -iso) != (fullData[i] < -iso))
+      ++differences;
+  }
+  QCOMPARE(differences, 0);
+}
+
+void AdaptiveGridTest::progress()
+{
+  Cube cube;
+  setLimits(&cube);
+  AdaptiveGrid grid(&cube, 0.05);
+  // 81x61x57 points give 10x8x7 coarse cells of 8 points
+  QCOMPARE(grid.numCells(), 560u);
+  QCOMPARE(grid.numResolvedCells(), 0u);
+
+  unsigned int resolved = 0;
+  while (!grid.pending().empty()) {
+    const std::vector<unsigned int> &points = grid.pending();
+    for (unsigned int i = 0; i < points.size(); ++i)
+      cube.setValue(points[i], twoLobes(cube.position(points[i])));
+    grid.refine();
+    QVERIFY(grid.numResolvedCells() >= resolved);
+    resolved = grid.numResolvedCells();
+  }
+  QCOMPARE(grid.numResolvedCells(), grid.numCells());
+}
+
+QTEST_MAIN(AdaptiveGridTest)
+
+#include "moc_adaptivegridtest.cxx"
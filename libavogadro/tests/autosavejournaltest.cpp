@@ -0,0 +1,301 @@
+/**********************************************************************
+  AutosaveJournalTest - unit tests for journaling and saving in the
+  background
+
+  Copyright (C) 2013 Avogadro Developers
+
+  This file is part of the Avogadro molecular editor project.
+  For more information, see <http://avogadro.cc/>
+
+  Avogadro is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  Avogadro is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+  02110-1301, USA.
+ **********************************************************************/
+
+#include "config.h"
+
+#include <QtTest>
+#include <QDesktopServices>
+#include <QDir>
+#include <QFile>
+
+#include <avogadro/molecule.h>
+#include <avogadro/moleculefile.h>
+#include <avogadro/moleculesnapshot.h>
+#include <avogadro/atom.h>
+
+#include "autosavejournal.h"
+#include "savefilethread.h"
+
+using Avogadro::AutosaveJournal;
+using Avogadro::Molecule;
+using Avogadro::MoleculeFile;
+using Avogadro::MoleculeSnapshot;
+using Avogadro::SaveFileThread;
+using Avogadro::Atom;
+
+using Eigen::Vector3d;
+
+class AutosaveJournalTest : public QObject
+{
+  Q_OBJECT
+
+  private:
+    /**
+     * Add methane to @p molecule.
+     */
+    void addMethane(Molecule *molecule);
+
+    /**
+     * @return The journal written by this process, or an empty string if
+     * there is none.
+     */
+    QString journalFile() const;
+
+    /**
+     * Compare the atoms and bonds of two molecules, allowing for the
+     * precision of the file formats in the positions.
+     */
+    void compare(const Molecule *actual, const Molecule *expected);
+
+    QString m_journalPath;
+    QString m_fileName;
+
+  private slots:
+    /**
+     * Called before the first test function is executed.
+     */
+    void initTestCase();
+
+    /**
+     * Called after the last test function is executed.
+     */
+    void cleanupTestCase();
+
+    /**
+     * Called after every test function.
+     */
+    void cleanup();
+
+    /**
+     * Without a baseline file the whole molecule is journaled and recovered.
+     */
+    void wholeMolecule();
+
+    /**
+     * Relative to a file saved by SaveFileThread only the changes are
+     * journaled, and applying them to the file recovers the molecule.
+     */
+    void baselineFile();
+
+    /**
+     * A journal cut short is not recovered.
+     */
+    void incomplete();
+
+    /**
+     * SaveFileThread writes the molecule as it was when the thread was
+     * created, whatever is edited while it runs.
+     */
+    void saveCopy();
+};
+
+void AutosaveJournalTest::addMethane(Molecule *molecule)
+{
+  Atom *carbon = molecule->addAtom(6, Vector3d(0.0, 0.0, 0.0));
+  const Vector3d hydrogens[4] = { Vector3d(0.63, 0.63, 0.63),
+                                  Vector3d(-0.63, -0.63, 0.63),
+                                  Vector3d(-0.63, 0.63, -0.63),
+                                  Vector3d(0.63, -0.63, -0.63) };
+  for (int i = 0; i < 4; ++i)
+    molecule->addBond(carbon, molecule->addAtom(1, hydrogens[i]));
+}
+
+QString AutosaveJournalTest::journalFile() const
+{
+  QDir dir(m_journalPath);
+  const QStringList journals = dir.entryList(QStringList()
+    << QString("%1-*.journal").arg(QCoreApplication::applicationPid()),
+    QDir::Files);
+  return journals.size() == 1 ? dir.absoluteFilePath(journals.first())
+                              : QString();
+}
+
+void AutosaveJournalTest::compare(const Molecule *actual,
+                                  const Molecule *expected)
+{
+  const MoleculeSnapshot a = actual->snapshot();
+  const MoleculeSnapshot e = expected->snapshot();
+  QCOMPARE(a.numAtoms(), e.numAtoms());
+  for (unsigned int i = 0; i < a.numAtoms(); ++i) {
+    QCOMPARE(a.atomicNumber(i), e.atomicNumber(i));
+    QVERIFY((a.atomPos(i) - e.atomPos(i)).norm() < 1.0e-4);
+  }
+  QCOMPARE(a.numBonds(), e.numBonds());
+  for (unsigned int i = 0; i < a.numBonds(); ++i) {
+    QCOMPARE(a.bondBeginIndex(i), e.bondBeginIndex(i));
+    QCOMPARE(a.bondEndIndex(i), e.bondEndIndex(i));
+    QCOMPARE(a.bondOrder(i), e.bondOrder(i));
+  }
+}
+
+void AutosaveJournalTest::initTestCase()
+{
+  // Keep the journals away from those of Avogadro itself
+  QCoreApplication::setApplicationName("autosavejournaltest");
+  m_journalPath = QDesktopServices::storageLocation(
+    QDesktopServices::DataLocation) + "/autosave";
+  m_fileName = QDir::tempPath() + QString("/autosavejournaltest-%1.cml")
+    .arg(QCoreApplication::applicationPid());
+  QVERIFY(journalFile().isEmpty());
+}
+
+void AutosaveJournalTest::cleanupTestCase()
+{
+  QDir().rmdir(m_journalPath);
+}
+
+void AutosaveJournalTest::cleanup()
+{
+  QFile::remove(m_fileName);
+  QVERIFY(journalFile().isEmpty());
+}
+
+void AutosaveJournalTest::wholeMolecule()
+{
+  Molecule molecule;
+  AutosaveJournal journal;
+  journal.setBaseline(molecule.snapshot(), QString(), "methane.cml");
+  addMethane(&molecule);
+
+  QVERIFY(journal.write(molecule.snapshot()));
+  QString file = journalFile();
+  QVERIFY(!file.isEmpty());
+  QCOMPARE(AutosaveJournal::documentName(file), QString("methane.cml"));
+  // Written by this process, so not offered for recovery
+  QVERIFY(!AutosaveJournal::orphanedJournals().contains(file));
+
+  QString error;
+  Molecule *recovered = AutosaveJournal::recover(file, &error);
+  QVERIFY2(recovered, qPrintable(error));
+  compare(recovered, &molecule);
+  QCOMPARE(recovered->fileName(), QString("methane.cml"));
+  delete recovered;
+
+  journal.remove();
+  QVERIFY(!QFile::exists(file));
+}
+
+void AutosaveJournalTest::baselineFile()
+{
+  Molecule molecule;
+  addMethane(&molecule);
+  SaveFileThread thread(&molecule, m_fileName, QString(), false);
+  thread.start();
+  QVERIFY(thread.wait(10000));
+  QVERIFY2(thread.success(), qPrintable(thread.error()));
+
+  AutosaveJournal journal;
+  journal.setBaseline(thread.snapshot(), m_fileName, m_fileName);
+  // Nothing changed since the save, so nothing is written
+  QVERIFY(journal.write(molecule.snapshot()));
+  QVERIFY(journalFile().isEmpty());
+
+  // Move one hydrogen, swap the last one for chlorine and add an atom
+  QList<Atom *> atoms = molecule.atoms();
+  atoms.at(1)->setPos(Vector3d(0.7, 0.7, 0.7));
+  molecule.removeAtom(atoms.at(4));
+  Atom *chlorine = molecule.addAtom(17, Vector3d(1.02, -1.02, -1.02));
+  molecule.addBond(atoms.at(0), chlorine);
+  molecule.addAtom(8, Vector3d(3.0, 0.0, 0.0));
+
+  QVERIFY(journal.write(molecule.snapshot()));
+  QString file = journalFile();
+  QVERIFY(!file.isEmpty());
+
+  QFile journalText(file);
+  QVERIFY(journalText.open(QFile::ReadOnly | QFile::Text));
+  const QString text = journalText.readAll();
+  journalText.close();
+  QVERIFY(text.contains(QString("file %1\n").arg(m_fileName)));
+  QVERIFY(text.contains("\nk 0 1\n"));
+  QVERIFY(text.contains("\nm 1 "));
+  QVERIFY(text.contains("\nk 2 2\n"));
+  QVERIFY(text.contains("\na 17 "));
+  QVERIFY(text.endsWith("end\n"));
+
+  QString error;
+  Molecule *recovered = AutosaveJournal::recover(file, &error);
+  QVERIFY2(recovered, qPrintable(error));
+  compare(recovered, &molecule);
+  delete recovered;
+
+  journal.remove();
+}
+
+void AutosaveJournalTest::incomplete()
+{
+  Molecule molecule;
+  AutosaveJournal journal;
+  journal.setBaseline(molecule.snapshot(), QString(), "methane.cml");
+  addMethane(&molecule);
+  QVERIFY(journal.write(molecule.snapshot()));
+  QString file = journalFile();
+  QVERIFY(!file.isEmpty());
+
+  // Drop the end marker and the last bond, as if the write was interrupted
+  QFile text(file);
+  QVERIFY(text.open(QFile::ReadOnly | QFile::Text));
+  QStringList lines = QString(text.readAll()).split('\n');
+  text.close();
+  while (!lines.isEmpty() && !lines.last().startsWith("b "))
+    lines.removeLast();
+  QVERIFY(!lines.isEmpty());
+  lines.removeLast();
+  QVERIFY(text.open(QFile::WriteOnly | QFile::Truncate | QFile::Text));
+  text.write(lines.join("\n").toLatin1());
+  text.close();
+
+  QString error;
+  QVERIFY(!AutosaveJournal::recover(file, &error));
+  QVERIFY(!error.isEmpty());
+
+  journal.remove();
+}
+
+void AutosaveJournalTest::saveCopy()
+{
+  Molecule molecule;
+  addMethane(&molecule);
+  Molecule original(molecule);
+
+  SaveFileThread thread(&molecule, m_fileName, QString(), false);
+  molecule.atoms().at(1)->setPos(Vector3d(2.0, 2.0, 2.0));
+  molecule.addAtom(8, Vector3d(3.0, 0.0, 0.0));
+  thread.start();
+  QVERIFY(thread.wait(10000));
+  QVERIFY2(thread.success(), qPrintable(thread.error()));
+  QCOMPARE(thread.snapshot().numAtoms(), original.numAtoms());
+
+  QString error;
+  Molecule *saved = MoleculeFile::readMolecule(m_fileName, QString(),
+                                               QString(), &error);
+  QVERIFY2(saved, qPrintable(error));
+  compare(saved, &original);
+  delete saved;
+}
+
+QTEST_MAIN(AutosaveJournalTest)
+
+#include "moc_autosavejournaltest.cxx"
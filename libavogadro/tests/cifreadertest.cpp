@@ -0,0 +1,266 @@
+/**********************************************************************
+  CifReaderTest - unit tests for the native CIF and mmCIF reader
+
+  Copyright (C) 2013 Avogadro Developers
+
+  This file is part of the Avogadro molecular editor project.
+  For more information, see <http://avogadro.cc/>
+
+  Avogadro is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  Avogadro is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+  02110-1301, USA.
+ **********************************************************************/
+
+#include "config.h"
+
+#include <QtTest>
+#include <avogadro/cifreader.h>
+#include <avogadro/molecule.h>
+#include <avogadro/atom.h>
+#include <avogadro/residue.h>
+
+#include "readertest.h"
+
+using Avogadro::CifReader;
+using Avogadro::Molecule;
+using Avogadro::Atom;
+using Avogadro::Residue;
+
+// A cubic crystal with an inversion center, the sodium is on it
+static const char smallMolecule[] =
+  "data_test\n"
+  "_cell_length_a 4.0\n"
+  "_cell_length_b 4.0\n"
+  "_cell_length_c 4.0(2)\n"
+  "_cell_angle_alpha 90\n"
+  "_cell_angle_beta 90\n"
+  "_cell_angle_gamma 90\n"
+  "loop_\n"
+  "_symmetry_equiv_pos_as_xyz\n"
+  "'x, y, z'\n"
+  "'-x, -y, -z'\n"
+  "loop_\n"
+  "_atom_site_label\n"
+  "_atom_site_type_symbol\n"
+  "_atom_site_fract_x\n"
+  "_atom_site_fract_y\n"
+  "_atom_site_fract_z\n"
+  "Na1 Na+ 0.0 0.0 0.0\n"
+  "Cl1 Cl- 0.25 0.25 0.25(1)\n";
+
+// Two models of two one residue chains, the assembly moves a copy by 10 A
+static const char macromolecule[] =
+  "data_TEST\n"
+  "#\n"
+  "loop_\n"
+  "_pdbx_struct_oper_list.id\n"
+  "_pdbx_struct_oper_list.matrix[1][1]\n"
+  "_pdbx_struct_oper_list.matrix[2][2]\n"
+  "_pdbx_struct_oper_list.matrix[3][3]\n"
+  "_pdbx_struct_oper_list.vector[1]\n"
+  "1 1 1 1 0\n"
+  "2 1 1 1 10\n"
+  "#\n"
+  "_pdbx_struct_assembly_gen.assembly_id 1\n"
+  "_pdbx_struct_assembly_gen.oper_expression '(1-2)'\n"
+  "_pdbx_struct_assembly_gen.asym_id_list A,B\n"
+  "#\n"
+  "loop_\n"
+  "_atom_site.group_PDB\n"
+  "_atom_site.id\n"
+  "_atom_site.type_symbol\n"
+  "_atom_site.label_atom_id\n"
+  "_atom_site.label_alt_id\n"
+  "_atom_site.label_comp_id\n"
+  "_atom_site.label_asym_id\n"
+  "_atom_site.label_entity_id\n"
+  "_atom_site.label_seq_id\n"
+  "_atom_site.Cartn_x\n"
+  "_atom_site.Cartn_y\n"
+  "_atom_site.Cartn_z\n"
+  "_atom_site.auth_seq_id\n"
+  "_atom_site.auth_asym_id\n"
+  "_atom_site.pdbx_PDB_model_num\n"
+  "ATOM 1 N N . GLY A 1 1 0.000 0.000 0.000 1 A 1\n"
+  "ATOM 2 C CA A GLY A 1 1 1.458 0.000 0.000 1 A 1\n"
+  "ATOM 3 C CA B GLY A 1 1 1.500 0.500 0.000 1 A 1\n"
+  "HETATM 4 O O . HOH B 2 . 0.000 4.000 0.000 101 A 1\n"
+  "ATOM 5 N N . GLY A 1 1 0.000 0.000 1.000 1 A 2\n"
+  "ATOM 6 C CA . GLY A 1 1 1.458 0.000 1.000 1 A 2\n"
+  "HETATM 7 O O . HOH B 2 . 0.000 4.000 1.000 101 A 2\n";
+
+// No type symbols, the second residue only has the alternate location B
+static const char alternateLocations[] =
+  "data_ALT\n"
+  "loop_\n"
+  "_atom_site.group_PDB\n"
+  "_atom_site.id\n"
+  "_atom_site.label_atom_id\n"
+  "_atom_site.label_alt_id\n"
+  "_atom_site.label_comp_id\n"
+  "_atom_site.label_asym_id\n"
+  "_atom_site.label_seq_id\n"
+  "_atom_site.Cartn_x\n"
+  "_atom_site.Cartn_y\n"
+  "_atom_site.Cartn_z\n"
+  "_atom_site.auth_seq_id\n"
+  "_atom_site.auth_asym_id\n"
+  "ATOM 1 N . ALA A 1 0.000 0.000 0.000 1 A\n"
+  "ATOM 2 CA A ALA A 1 1.458 0.000 0.000 1 A\n"
+  "ATOM 3 CA B ALA A 1 1.500 0.300 0.000 1 A\n"
+  "ATOM 4 N . SER A 2 2.400 1.100 0.000 2 A\n"
+  "ATOM 5 CA B SER A 2 3.800 1.200 0.000 2 A\n"
+  "HETATM 6 CA . CA B . 0.000 6.000 0.000 101 A\n"
+  "HETATM 7 CL1 . LIG C . 0.000 10.000 0.000 201 A\n";
+
+class CifReaderTest : public QObject
+{
+  Q_OBJECT
+
+  private:
+    Molecule * read(const char *text, const QString &options = QString())
+    {
+      return readText<CifReader>(text, options);
+    }
+
+  private slots:
+    /**
+     * Fractional coordinates are filled to the whole cell and the images
+     * falling on an atom are dropped.
+     */
+    void fillUnitCell();
+
+    /**
+     * The first model gives the atoms and residues, the second one a
+     * conformer.
+     */
+    void models();
+
+    /**
+     * Only the selected chains are read.
+     */
+    void chains();
+
+    /**
+     * An assembly has a copy of its chains per operator.
+     */
+    void assembly();
+
+    /**
+     * The first alternate location of each atom is kept, even if it is not
+     * the first one in the file, and without type symbols the element
+     * comes from the atom name.
+     */
+    void alternateLocations();
+};
+
+void CifReaderTest::fillUnitCell()
+{
+  Molecule *molecule = read(smallMolecule);
+  QVERIFY(molecule);
+  QCOMPARE(molecule->numAtoms(), 3u);
+  QVERIFY(molecule->OBUnitCell());
+  QCOMPARE(molecule->atom(0)->atomicNumber(), 11);
+  QCOMPARE(molecule->atom(0)->formalCharge(), 1);
+  QCOMPARE(molecule->atom(1)->atomicNumber(), 17);
+  QCOMPARE(molecule->atom(1)->formalCharge(), -1);
+  QVERIFY((*molecule->atom(2)->pos() - Eigen::Vector3d(3.0, 3.0, 3.0)).norm() < 1e-6);
+  delete molecule;
+
+  molecule = read(smallMolecule, "fill never");
+  QVERIFY(molecule);
+  QCOMPARE(molecule->numAtoms(), 2u);
+  delete molecule;
+}
+
+void CifReaderTest::models()
+{
+  Molecule *molecule = read(macromolecule);
+  QVERIFY(molecule);
+  // The alternate location B is dropped
+  QCOMPARE(molecule->numAtoms(), 3u);
+  QCOMPARE(molecule->numBonds(), 1u);
+  QCOMPARE(molecule->numResidues(), 2u);
+  QCOMPARE(molecule->numConformers(), 2u);
+  QVERIFY(!molecule->OBUnitCell());
+
+  Residue *glycine = molecule->residue(0);
+  QCOMPARE(glycine->name(), QString("GLY"));
+  QCOMPARE(glycine->number(), QString("1"));
+  QCOMPARE(glycine->chainID(), 'A');
+  QCOMPARE(glycine->atomId(1), QString("CA"));
+  QCOMPARE(glycine->property("entity").toString(), QString("1"));
+  Residue *water = molecule->residue(1);
+  QCOMPARE(water->number(), QString("101"));
+  QVERIFY(water->chainNumber() != glycine->chainNumber());
+
+  QVERIFY(molecule->setConformer(1));
+  QCOMPARE(molecule->atom(0)->pos()->z(), 1.0);
+  delete molecule;
+
+  molecule = read(macromolecule, "model 2");
+  QVERIFY(molecule);
+  QCOMPARE(molecule->numAtoms(), 3u);
+  QCOMPARE(molecule->numConformers(), 1u);
+  QCOMPARE(molecule->atom(0)->pos()->z(), 1.0);
+  delete molecule;
+}
+
+void CifReaderTest::chains()
+{
+  Molecule *molecule = read(macromolecule, "chain B");
+  QVERIFY(molecule);
+  QCOMPARE(molecule->numAtoms(), 1u);
+  QCOMPARE(molecule->atom(0)->atomicNumber(), 8);
+  delete molecule;
+
+  QVERIFY(!read(macromolecule, "chain C"));
+}
+
+void CifReaderTest::assembly()
+{
+  Molecule *molecule = read(macromolecule, "assembly 1");
+  QVERIFY(molecule);
+  QCOMPARE(molecule->numAtoms(), 6u);
+  QCOMPARE(molecule->numBonds(), 2u);
+  QCOMPARE(molecule->numResidues(), 4u);
+  QCOMPARE(molecule->atom(3)->pos()->x(), 10.0);
+  QCOMPARE(molecule->residue(2)->chainNumber(), 2u);
+  delete molecule;
+
+  QVERIFY(!read(macromolecule, "assembly 2"));
+}
+
+void CifReaderTest::alternateLocations()
+{
+  Molecule *molecule = read(alternateLocations);
+  QVERIFY(molecule);
+  QCOMPARE(molecule->numAtoms(), 6u);
+
+  // A of the alanine, B of the serine
+  QCOMPARE(molecule->atom(1)->pos()->y(), 0.0);
+  QCOMPARE(molecule->atom(3)->pos()->x(), 3.8);
+
+  // Alpha carbons, a calcium ion and a chlorine
+  QCOMPARE(molecule->atom(0)->atomicNumber(), 7);
+  QCOMPARE(molecule->atom(1)->atomicNumber(), 6);
+  QCOMPARE(molecule->atom(3)->atomicNumber(), 6);
+  QCOMPARE(molecule->atom(4)->atomicNumber(), 20);
+  QCOMPARE(molecule->atom(5)->atomicNumber(), 17);
+  delete molecule;
+}
+
+QTEST_MAIN(CifReaderTest)
+
+#include "moc_cifreadertest.cxx"
@@ -0,0 +1,173 @@
+/**********************************************************************
+  ContactListTest - unit tests for the close contact search
+
+  Copyright (C) 2013 Avogadro Developers
+
+  This file is part of the Avogadro molecular editor project.
+  For more information, see <http://avogadro.cc/>
+
+  Avogadro is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  Avogadro is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+  02110-1301, USA.
+ **********************************************************************/
+
+#include "config.h"
+
+#include <QtTest>
+#include <avogadro/contactlist.h>
+#include <avogadro/molecule.h>
+#include <avogadro/atom.h>
+
+#include <Eigen/Core>
+
+#include <set>
+#include <utility>
+
+using Avogadro::ContactList;
+using Avogadro::Molecule;
+using Avogadro::Atom;
+
+using Eigen::Vector3d;
+
+class ContactListTest : public QObject
+{
+  Q_OBJECT
+
+  private:
+    /**
+     * @return The contacts as sorted pairs of atom indices.
+     */
+    std::set<std::pair<unsigned int, unsigned int> >
+    pairs(const ContactList &contacts);
+
+  private slots:
+    void contact();
+    void exclusions();
+    void moveAtoms();
+    void incremental();
+};
+
+std::set<std::pair<unsigned int, unsigned int> >
+ContactListTest::pairs(const ContactList &contacts)
+{
+  std::set<std::pair<unsigned int, unsigned int> > result;
+  for (size_t i = 0; i < contacts.contacts().size(); ++i) {
+    const ContactList::Contact &contact = contacts.contacts()[i];
+    result.insert(std::make_pair(contact.first, contact.second));
+  }
+  return result;
+}
+
+void ContactListTest::contact()
+{
+  Molecule molecule;
+  molecule.addAtom(6, Vector3d(0.0, 0.0, 0.0));
+  molecule.addAtom(6, Vector3d(2.0, 0.0, 0.0));
+
+  // 2.0 A is well below 0.8 of the 3.4 A sum of the carbon radii
+  ContactList contacts(&molecule);
+  QVERIFY(contacts.update());
+  QCOMPARE(contacts.contacts().size(), size_t(1));
+  QCOMPARE(contacts.contacts()[0].first, 0u);
+  QCOMPARE(contacts.contacts()[0].second, 1u);
+  QVERIFY(qAbs(contacts.contacts()[0].distance - 2.0) < 1.0e-10);
+  // Nothing changed
+  QVERIFY(!contacts.update());
+
+  contacts.setFraction(0.5);
+  contacts.update();
+  QVERIFY(contacts.contacts().empty());
+}
+
+void ContactListTest::exclusions()
+{
+  // A chain of four close carbons, only the 1-4 pair is a contact
+  Molecule molecule;
+  Atom *a1 = molecule.addAtom(6, Vector3d(0.0, 0.0, 0.0));
+  Atom *a2 = molecule.addAtom(6, Vector3d(1.0, 0.0, 0.0));
+  Atom *a3 = molecule.addAtom(6, Vector3d(1.0, 1.0, 0.0));
+  Atom *a4 = molecule.addAtom(6, Vector3d(0.0, 1.0, 0.0));
+  molecule.addBond(a1, a2);
+  molecule.addBond(a2, a3);
+  molecule.addBond(a3, a4);
+
+  ContactList contacts(&molecule);
+  contacts.update();
+  QCOMPARE(contacts.contacts().size(), size_t(1));
+  QCOMPARE(contacts.contacts()[0].first, 0u);
+  QCOMPARE(contacts.contacts()[0].second, 3u);
+
+  // Closing the ring makes it a 1-2 pair
+  molecule.addBond(a4, a1);
+  QVERIFY(contacts.update());
+  QVERIFY(contacts.contacts().empty());
+}
+
+void ContactListTest::moveAtoms()
+{
+  // A grid of carbons 4 A apart, none in contact
+  Molecule molecule;
+  for (int i = 0; i < 10; ++i)
+    for (int j = 0; j < 10; ++j)
+      for (int k = 0; k < 10; ++k)
+        molecule.addAtom(6, Vector3d(4.0 * i, 4.0 * j, 4.0 * k));
+
+  ContactList contacts(&molecule);
+  contacts.update();
+  QVERIFY(contacts.contacts().empty());
+
+  Atom *atom = molecule.atom(555);
+  const Vector3d start = *atom->pos();
+  atom->setPos(start + Vector3d(2.5, 0.0, 0.0));
+  QVERIFY(contacts.update());
+  QCOMPARE(contacts.contacts().size(), size_t(1));
+  QCOMPARE(contacts.contacts()[0].first, 555u);
+  QCOMPARE(contacts.contacts()[0].second, 655u);
+
+  atom->setPos(start);
+  QVERIFY(contacts.update());
+  QVERIFY(contacts.contacts().empty());
+}
+
+void ContactListTest::incremental()
+{
+  // Random moves must give the same contacts as starting over
+  Molecule molecule;
+  qsrand(42);
+  for (int i = 0; i < 500; ++i)
+    molecule.addAtom(i % 3 ? 6 : 1, Vector3d(15.0 * qrand() / RAND_MAX,
+                                             15.0 * qrand() / RAND_MAX,
+                                             15.0 * qrand() / RAND_MAX));
+  for (int i = 0; i + 1 < 500; i += 2)
+    molecule.addBond(molecule.atom(i), molecule.atom(i + 1));
+
+  ContactList contacts(&molecule);
+  contacts.update();
+  for (int step = 0; step < 50; ++step) {
+    for (int n = 0; n < 3; ++n) {
+      Atom *atom = molecule.atom(qrand() % 500);
+      atom->setPos(*atom->pos() + Vector3d(qrand() % 3 - 1.0,
+                                           qrand() % 3 - 1.0,
+                                           qrand() % 3 - 1.0));
+    }
+    contacts.update();
+    ContactList fresh(&molecule);
+    fresh.update();
+    QVERIFY(pairs(contacts) == pairs(fresh));
+  }
+}
+
+QTEST_MAIN(ContactListTest)
+
+#include "moc_contactlisttest.cxx"
@@ -0,0 +1,201 @@
+/**********************************************************************
+  GLWidgetTest - unit tests for drawing the frames of the GLWidget
+
+  Copyright (C) 2013 Avogadro Developers
+
+  This file is part of the Avogadro molecular editor project.
+  For more information, see <http://avogadro.cc/>
+
+  Avogadro is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  Avogadro is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+  02110-1301, USA.
+ **********************************************************************/
+
+#include "config.h"
+
+#include <QtTest>
+#include <QtCore/QMutex>
+#include <QtCore/QMutexLocker>
+#include <QtCore/QThread>
+#include <avogadro/glwidget.h>
+#include <avogadro/engine.h>
+#include <avogadro/painterdevice.h>
+#include <avogadro/molecule.h>
+#include <avogadro/atom.h>
+
+using Avogadro::GLWidget;
+using Avogadro::Engine;
+using Avogadro::PainterDevice;
+using Avogadro::Molecule;
+using Avogadro::Atom;
+
+using Eigen::Vector3d;
+
+/**
+ * Records the x coordinates of the atoms drawn in each frame, and the
+ * threads the frames were drawn in.
+ */
+class RecordEngine : public Engine
+{
+  public:
+    QString identifier() const { return "Record"; }
+    QString name() const { return "Record"; }
+    Engine * clone() const { return new RecordEngine; }
+
+    bool renderOpaque(PainterDevice *pd)
+    {
+      QList<double> frame;
+      foreach (Atom *atom, atoms())
+        frame.append(pd->atomPos(atom)->x());
+      QMutexLocker locker(&mutex);
+      frames.append(frame);
+      threads.append(QThread::currentThread());
+      return true;
+    }
+
+    QMutex mutex;
+    QList<QList<double> > frames;
+    QList<QThread *> threads;
+};
+
+class GLWidgetTest : public QObject
+{
+  Q_OBJECT
+
+  private:
+    /**
+     * Wait for @p engine to draw more than @p frames frames.
+     * @return False on timeout.
+     */
+    bool waitForFrames(RecordEngine *engine, int frames);
+
+    Molecule *m_molecule;
+    GLWidget *m_widget;
+    RecordEngine *m_engine;
+
+  private slots:
+    /**
+     * Called before the first test function is executed.
+     */
+    void initTestCase();
+
+    /**
+     * Called after the last test function is executed.
+     */
+    void cleanupTestCase();
+
+    /**
+     * Every frame is drawn with the positions of a single step while the
+     * atoms are moved step by step, drawn in the render thread if enabled.
+     */
+    void frames();
+
+    /**
+     * A render requested from the GUI thread draws the current positions
+     * while the render thread may be drawing too.
+     */
+    void guiThreadRender();
+};
+
+bool GLWidgetTest::waitForFrames(RecordEngine *engine, int frames)
+{
+  for (int i = 0; i < 500; ++i) {
+    {
+      QMutexLocker locker(&engine->mutex);
+      if (engine->frames.size() > frames)
+        return true;
+    }
+    QTest::qWait(10);
+  }
+  return false;
+}
+
+void GLWidgetTest::initTestCase()
+{
+  m_molecule = new Molecule;
+  for (int i = 0; i < 500; ++i)
+    m_molecule->addAtom(6, Vector3d(0.0, i, 0.0));
+
+  m_widget = new GLWidget;
+  m_engine = new RecordEngine;
+  m_engine->setEnabled(true);
+  m_widget->addEngine(m_engine);
+  m_widget->setMolecule(m_molecule);
+  m_widget->resize(64, 64);
+  m_widget->show();
+  QVERIFY(waitForFrames(m_engine, 0));
+}
+
+void GLWidgetTest::cleanupTestCase()
+{
+  delete m_widget;
+  delete m_molecule;
+}
+
+void GLWidgetTest::frames()
+{
+  int drawn;
+  {
+    QMutexLocker locker(&m_engine->mutex);
+    drawn = m_engine->frames.size();
+  }
+
+  for (int step = 1; step <= 50; ++step) {
+    foreach (Atom *atom, m_molecule->atoms())
+      atom->setPos(Vector3d(step, atom->pos()->y(), 0.0));
+    m_molecule->update();
+    m_widget->update();
+    QTest::qWait(2);
+  }
+  QVERIFY(waitForFrames(m_engine, drawn));
+
+  QMutexLocker locker(&m_engine->mutex);
+  for (int i = drawn; i < m_engine->frames.size(); ++i) {
+    const QList<double> &frame = m_engine->frames.at(i);
+    QCOMPARE(frame.size(), 500);
+    foreach (double x, frame)
+      QCOMPARE(x, frame.first());
+#ifdef ENABLE_THREADED_GL
+    QVERIFY(m_engine->threads.at(i) != QThread::currentThread());
+#endif
+  }
+}
+
+void GLWidgetTest::guiThreadRender()
+{
+  foreach (Atom *atom, m_molecule->atoms())
+    atom->setPos(Vector3d(-1.0, atom->pos()->y(), 0.0));
+  m_widget->update();
+
+  int drawn;
+  {
+    QMutexLocker locker(&m_engine->mutex);
+    drawn = m_engine->frames.size();
+  }
+  m_widget->renderNow();
+
+  QMutexLocker locker(&m_engine->mutex);
+  QVERIFY(m_engine->frames.size() > drawn);
+  // The frame drawn in this thread, the render thread may have added one
+  int index = drawn;
+  while (index < m_engine->threads.size()
+         && m_engine->threads.at(index) != QThread::currentThread())
+    ++index;
+  QVERIFY(index < m_engine->frames.size());
+  QCOMPARE(m_engine->frames.at(index).first(), -1.0);
+}
+
+QTEST_MAIN(GLWidgetTest)
+
+#include "moc_glwidgettest.cxx"
@@ -0,0 +1,269 @@
+/**********************************************************************
+  MeshSimplifierTest - unit tests for the levels of detail of meshes
+
+  Copyright (C) 2013 Avogadro Developers
+
+  This file is part of the Avogadro molecular editor project.
+  For more information, see <http://avogadro.cc/>
+
+  Avogadro is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  Avogadro is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+  02110-1301, USA.
+ **********************************************************************/
+
+#include "config.h"
+
+#include <QtTest>
+#include <avogadro/mesh.h>
+#include <avogadro/meshsimplifier.h>
+#include <avogadro/color3f.h>
+
+#include <Eigen/Geometry>
+
+#include <cmath>
+#include <map>
+#include <vector>
+
+using Avogadro::Mesh;
+using Avogadro::MeshSimplifier;
+using Avogadro::Color3f;
+
+using Eigen::Vector3f;
+using Eigen::Vector3i;
+
+class MeshSimplifierTest : public QObject
+{
+  Q_OBJECT
+
+  private:
+    /**
+     * Fill @p mesh with a unit sphere of 20 * 4^subdivisions triangles as
+     * a triangle soup, colored red on top and blue below the equator.
+     */
+    void sphere(Mesh *mesh, int subdivisions);
+
+    /**
+     * @return The number of edges of @p mesh that are not shared by exactly
+     * two triangles, comparing the vertices by position.
+     */
+    int openEdges(const Mesh *mesh);
+
+  private slots:
+    /**
+     * Each level has about a quarter of the triangles of the previous one,
+     * stays closed and close to the sphere and keeps unit normals.
+     */
+    void levels();
+
+    /**
+     * The levels are dropped when the mesh changes.
+     */
+    void invalidate();
+
+    /**
+     * A simplifier started as a thread stores the levels once it finished,
+     * and does not touch a mesh deleted while it runs.
+     */
+    void background();
+
+    /**
+     * Small meshes get no levels.
+     */
+    void smallMesh();
+};
+
+void MeshSimplifierTest::sphere(Mesh *mesh, int subdivisions)
+{
+  const float t = (1.0f + std::sqrt(5.0f)) / 2.0f;
+  const float p[12][3] = { {-1, t, 0}, {1, t, 0}, {-1, -t, 0}, {1, -t, 0},
+                           {0, -1, t}, {0, 1, t}, {0, -1, -t}, {0, 1, -t},
+                           {t, 0, -1}, {t, 0, 1}, {-t, 0, -1}, {-t, 0, 1} };
+  const int f[20][3] = { {0, 11, 5}, {0, 5, 1}, {0, 1, 7}, {0, 7, 10},
+                         {0, 10, 11}, {1, 5, 9}, {5, 11, 4}, {11, 10, 2},
+                         {10, 7, 6}, {7, 1, 8}, {3, 9, 4}, {3, 4, 2},
+                         {3, 2, 6}, {3, 6, 8}, {3, 8, 9}, {4, 9, 5},
+                         {2, 4, 11}, {6, 2, 10}, {8, 6, 7}, {9, 8, 1} };
+
+  std::vector<Vector3f> points;
+  std::vector<Vector3i> triangles;
+  for (int i = 0; i < 12; ++i)
+    points.push_back(Vector3f(p[i][0], p[i][1], p[i][2]).normalized());
+  for (int i = 0; i < 20; ++i)
+    triangles.push_back(Vector3i(f[i][0], f[i][1], f[i][2]));
+
+  for (int s = 0; s < subdivisions; ++s) {
+    std::map<std::pair<int, int>, int> middle;
+    std::vector<Vector3i> finer;
+    for (unsigned int i = 0; i < triangles.size(); ++i) {
+      int m[3];
+      for (int j = 0; j < 3; ++j) {
+        int a = triangles[i][j];
+        int b = triangles[i][(j+1)%3];
+        std::pair<int, int> key(qMin(a, b), qMax(a, b));
+        if (!middle.count(key)) {
+          points.push_back((points[a] + points[b]).normalized());
+          middle[key] = points.size() - 1;
+        }
+        m[j] = middle[key];
+      }
+      finer.push_back(Vector3i(triangles[i][0], m[0], m[2]));
+      finer.push_back(Vector3i(triangles[i][1], m[1], m[0]));
+      finer.push_back(Vector3i(triangles[i][2], m[2], m[1]));
+      finer.push_back(Vector3i(m[0], m[1], m[2]));
+    }
+    triangles = finer;
+  }
+
+  std::vector<Vector3f> vertices;
+  std::vector<Color3f> colors;
+  for (unsigned int i = 0; i < triangles.size(); ++i) {
+    float z = 0.0f;
+    for (int j = 0; j < 3; ++j)
+      z += points[triangles[i][j]].z();
+    for (int j = 0; j < 3; ++j) {
+      vertices.push_back(points[triangles[i][j]]);
+      colors.push_back(z > 0.0f ? Color3f(1.0f, 0.0f, 0.0f)
+                                : Color3f(0.0f, 0.0f, 1.0f));
+    }
+  }
+  mesh->setVertices(vertices);
+  mesh->setNormals(vertices);
+  mesh->setColors(colors);
+}
+
+int MeshSimplifierTest::openEdges(const Mesh *mesh)
+{
+  typedef std::pair<qint64, std::pair<qint64, qint64> > Point;
+  std::map<std::pair<Point, Point>, int> edges;
+  const std::vector<Vector3f> &vertices = mesh->vertices();
+  for (unsigned int i = 0; i < vertices.size(); i += 3) {
+    for (int j = 0; j < 3; ++j) {
+      Point a[2];
+      for (int k = 0; k < 2; ++k) {
+        const Vector3f &v = vertices[i + (j + k) % 3];
+        a[k] = Point(qRound64(v.x() * 1.0e5),
+                     std::make_pair(qRound64(v.y() * 1.0e5), qRound64(v.z() * 1.0e5)));
+      }
+      if (a[1] < a[0])
+        qSwap(a[0], a[1]);
+      ++edges[std::make_pair(a[0], a[1])];
+    }
+  }
+
+  int open = 0;
+  for (std::map<std::pair<Point, Point>, int>::const_iterator it = edges.begin();
+       it != edges.end(); ++it) {
+    if (it->second != 2)
+      ++open;
+  }
+  return open;
+}
+
+void MeshSimplifierTest::levels()
+{
+  Mesh mesh;
+  sphere(&mesh, 5);
+  QCOMPARE(mesh.numLevels(), 1);
+
+  MeshSimplifier simplifier(&mesh);
+  simplifier.setMinimumTriangles(500);
+  simplifier.run();
+
+  // 20480 -> 5120 -> 1280
+  QCOMPARE(mesh.numLevels(), 3);
+  unsigned int previous = mesh.numVertices() / 3;
+  for (int i = 1; i < mesh.numLevels(); ++i) {
+    const Mesh *level = mesh.level(i);
+    const unsigned int triangles = level->numVertices() / 3;
+    QVERIFY(triangles <= previous / 4);
+    QVERIFY(triangles > previous / 8);
+    QCOMPARE(level->numNormals(), level->numVertices());
+    QCOMPARE(static_cast<unsigned int>(level->colors().size()), level->numVertices());
+    QCOMPARE(openEdges(level), 0);
+
+    for (unsigned int j = 0; j < level->numVertices(); ++j) {
+      QVERIFY(std::fabs(level->vertices()[j].norm() - 1.0f) < 0.01f);
+      QVERIFY(std::fabs(level->normals()[j].norm() - 1.0f) < 1.0e-4f);
+    }
+    previous = triangles;
+  }
+
+  QVERIFY(mesh.levelForTriangles(0) == &mesh);
+  QVERIFY(mesh.levelForTriangles(100000) == &mesh);
+  QVERIFY(mesh.levelForTriangles(6000) == mesh.level(1));
+  QVERIFY(mesh.levelForTriangles(10) == mesh.level(2));
+  QVERIFY(mesh.radius() > 0.99f && mesh.radius() < 1.8f);
+}
+
+void MeshSimplifierTest::invalidate()
+{
+  Mesh mesh;
+  sphere(&mesh, 5);
+  MeshSimplifier simplifier(&mesh);
+  simplifier.run();
+  QVERIFY(mesh.numLevels() > 1);
+
+  const unsigned int revision = mesh.revision();
+  mesh.setColors(std::vector<Color3f>(1, Color3f(1.0f, 1.0f, 1.0f)));
+  QCOMPARE(mesh.numLevels(), 1);
+  QVERIFY(mesh.revision() != revision);
+
+  // Levels built from an older revision are not stored
+  std::vector<Mesh *> levels(1, new Mesh);
+  QVERIFY(!mesh.setLevels(levels, revision));
+  QCOMPARE(mesh.numLevels(), 1);
+
+  // Assigning another mesh drops them as well
+  simplifier.initialize(&mesh);
+  simplifier.run();
+  QVERIFY(mesh.numLevels() > 1);
+  Mesh other;
+  sphere(&other, 3);
+  mesh = other;
+  QCOMPARE(mesh.numLevels(), 1);
+  QVERIFY(mesh.normals() == other.normals());
+}
+
+void MeshSimplifierTest::background()
+{
+  Mesh mesh;
+  sphere(&mesh, 5);
+  MeshSimplifier simplifier(&mesh);
+  simplifier.start();
+  simplifier.wait();
+  QCoreApplication::processEvents();
+  QVERIFY(mesh.numLevels() > 1);
+
+  Mesh *deleted = new Mesh;
+  sphere(deleted, 5);
+  MeshSimplifier orphan(deleted);
+  orphan.start();
+  delete deleted;
+  orphan.wait();
+  QCoreApplication::processEvents();
+  QVERIFY(!orphan.mesh());
+}
+
+void MeshSimplifierTest::smallMesh()
+{
+  Mesh mesh;
+  sphere(&mesh, 2);
+  MeshSimplifier simplifier(&mesh);
+  simplifier.run();
+  QCOMPARE(mesh.numLevels(), 1);
+}
+
+QTEST_MAIN(MeshSimplifierTest)
+
+#include "moc_meshsimplifiertest.cxx"
@@ -28,12 +28,19 @@
 #include <avogadro/molecule.h>
 #include <avogadro/atom.h>
 #include <avogadro/bond.h>
+#include <avogadro/moleculesnapshot.h>
+#include <avogadro/cube.h>
 
 #include <Eigen/Core>
 
+#include <openbabel/mol.h>
+#include <openbabel/generic.h>
+
 using Avogadro::Molecule;
 using Avogadro::Atom;
 using Avogadro::Bond;
+using Avogadro::MoleculeSnapshot;
+using Avogadro::Cube;
 
 using Eigen::Vector3d;
 
@@ -140,10 +147,45 @@ private slots:
    */
   void translate();
 
+  /**
+   * Tests the cached geometry is kept up to date as atoms are edited.
+   */
+  void geometryUpdates();
+
+  /**
+   * Tests only the positions announced as written are refreshed.
+   */
+  void positionWrites();
+
+  /**
+   * Tests bulk merging of molecules with a rigid transform.
+   */
+  void merge();
+
+  /**
+   * Tests snapshots stay unchanged while the molecule is edited.
+   */
+  void snapshot();
+
   /**
    * Tests conformer support.
    */ 
   void conformers();
+
+  /**
+   * Tests the atom attribute columns follow the atoms.
+   */
+  void atomAttributes();
+
+  /**
+   * Tests the conformer cells are copied and dropped with the conformers.
+   */
+  void conformerCells();
+
+  /**
+   * Tests approximate cubes are left out of the OpenBabel molecule.
+   */
+  void approximateCubes();
 };
 
 void MoleculeTest::prepareMolecule()
@@ -312,6 +354,139 @@ void MoleculeTest::translate()
   QCOMPARE(m_molecule->center().z(), 1.5 / 4.0 + 1.2);
 }
 
+void MoleculeTest::geometryUpdates()
+{
+  Molecule mol;
+  Atom *a1 = mol.addAtom(6, Vector3d(0.0, 0.0, 0.0));
+  Atom *a2 = mol.addAtom(6, Vector3d(2.0, 0.0, 0.0));
+  QCOMPARE(mol.center().x(), 1.0);
+  QCOMPARE(mol.radius(), 1.0);
+
+  // Moving an atom outwards makes it the farthest atom, the atom in the
+  // middle keeps the other end closer to the center
+  Atom *a3 = mol.addAtom(6, Vector3d(1.0, 0.0, 0.0));
+  a2->setPos(Vector3d(5.0, 0.0, 0.0));
+  QCOMPARE(mol.center().x(), 2.0);
+  QVERIFY(mol.radius() >= 3.0);
+  QVERIFY(mol.farthestAtom() == a2);
+  mol.removeAtom(a3);
+
+  // Adding and removing atoms updates the center
+  Atom *a4 = mol.addAtom(6, Vector3d(0.0, 6.0, 0.0));
+  QCOMPARE(mol.center().y(), 2.0);
+  QVERIFY(mol.radius() >= (*a4->pos() - mol.center()).norm());
+  mol.removeAtom(a4);
+  QCOMPARE(mol.center().x(), 2.5);
+  QCOMPARE(mol.center().y(), 0.0);
+
+  // The bounding sphere must contain every atom
+  foreach (Atom *atom, mol.atoms())
+    QVERIFY((*atom->pos() - mol.center()).norm() <= mol.radius() + 1.0e-10);
+
+  // Positions written directly are seen once they are announced
+  std::vector<Vector3d> *positions = mol.conformer(0);
+  (*positions)[a1->id()] = Vector3d(-9.0, 0.0, 0.0);
+  mol.invalidatePositions(a1->index(), a1->index());
+  QCOMPARE(mol.center().x(), -2.0);
+  (*positions)[a1->id()] = Vector3d(0.0, 0.0, 0.0);
+  mol.invalidatePositions();
+  QCOMPARE(mol.center().x(), 2.5);
+}
+
+void MoleculeTest::positionWrites()
+{
+  Molecule mol;
+  const unsigned int size = 2 * MoleculeSnapshot::ChunkSize;
+  for (unsigned int i = 0; i < size; ++i)
+    mol.addAtom(6, Vector3d(i, 0.0, 0.0));
+  MoleculeSnapshot first = mol.snapshot();
+
+  // Neither redrawing nor reading the positions changes anything
+  mol.update();
+  mol.conformer(0);
+  QCOMPARE(mol.snapshot().version(), first.version());
+
+  // Only the chunk holding the atom written is rebuilt
+  const unsigned int last = size - 1;
+  (*mol.conformer(0))[mol.atom(last)->id()] = Vector3d(0.0, 5.0, 0.0);
+  mol.invalidatePositions(last, last);
+  MoleculeSnapshot second = mol.snapshot();
+  QVERIFY(second.version() != first.version());
+  QVERIFY(second.sharesAtom(first, 0));
+  QVERIFY(!second.sharesAtom(first, last));
+  QCOMPARE(second.atomPos(last).y(), 5.0);
+}
+
+void MoleculeTest::merge()
+{
+  Molecule host;
+  host.addAtom(8, Vector3d(0.0, 0.0, 0.0));
+  Molecule fragment;
+  Atom *f1 = fragment.addAtom(6, Vector3d(1.0, 0.0, 0.0));
+  Atom *f2 = fragment.addAtom(1, Vector3d(2.0, 0.0, 0.0));
+  fragment.addBond(f1, f2, 1);
+
+  QSignalSpy bulk(&host, SIGNAL(primitivesAdded(PrimitiveList)));
+  QSignalSpy single(&host, SIGNAL(atomAdded(Atom*)));
+
+  // Rotate 90 degrees about z and shift along z
+  Eigen::Matrix3d rotation;
+  rotation << 0.0, -1.0, 0.0,
+              1.0,  0.0, 0.0,
+              0.0,  0.0, 1.0;
+  host.merge(fragment, rotation, Vector3d(0.0, 0.0, 1.0));
+
+  QCOMPARE(bulk.count(), 1);
+  QCOMPARE(single.count(), 0);
+  QCOMPARE(host.numAtoms(), static_cast<unsigned int>(3));
+  QCOMPARE(host.numBonds(), static_cast<unsigned int>(1));
+  QCOMPARE(host.atom(1)->atomicNumber(), 6);
+  QVERIFY((*host.atom(1)->pos() - Vector3d(0.0, 1.0, 1.0)).norm() < 1.0e-10);
+  QVERIFY((*host.atom(2)->pos() - Vector3d(0.0, 2.0, 1.0)).norm() < 1.0e-10);
+  Bond *bond = host.bond(0);
+  QCOMPARE(bond->beginAtom(), host.atom(1));
+  QCOMPARE(bond->endAtom(), host.atom(2));
+  QCOMPARE(host.atom(1)->valence(), 1.0);
+  QCOMPARE(host.center().y(), 1.0);
+}
+
+void MoleculeTest::snapshot()
+{
+  Molecule mol;
+  Atom *a1 = mol.addAtom(6, Vector3d(0.0, 0.0, 0.0));
+  Atom *a2 = mol.addAtom(8, Vector3d(1.2, 0.0, 0.0));
+  mol.addBond(a1, a2, 2);
+
+  MoleculeSnapshot first = mol.snapshot();
+  QVERIFY(!first.isNull());
+  QCOMPARE(first.numAtoms(), 2u);
+  QCOMPARE(first.numBonds(), 1u);
+  QCOMPARE(first.atomicNumber(1), 8);
+  QCOMPARE(first.bondOrder(0), static_cast<short>(2));
+  // Nothing changed, so the same version is returned
+  QCOMPARE(mol.snapshot().version(), first.version());
+
+  // Editing the molecule does not change the snapshot taken before
+  a2->setPos(Vector3d(1.4, 0.0, 0.0));
+  mol.addAtom(1, Vector3d(-1.0, 0.0, 0.0));
+  QCOMPARE(first.atomPos(1).x(), 1.2);
+  QCOMPARE(first.numAtoms(), 2u);
+
+  MoleculeSnapshot second = mol.snapshot();
+  QVERIFY(second.version() != first.version());
+  QCOMPARE(second.numAtoms(), 3u);
+  QCOMPARE(second.atomPos(1).x(), 1.4);
+  QCOMPARE(second.atomicNumber(2), 1);
+
+  // Removing an atom shifts the indices of the bonds
+  mol.removeAtom(a1);
+  MoleculeSnapshot third = mol.snapshot();
+  QCOMPARE(third.numAtoms(), 2u);
+  QCOMPARE(third.numBonds(), 0u);
+  QCOMPARE(third.atomId(0), a2->id());
+  QCOMPARE(second.numBonds(), 1u);
+}
+
 void MoleculeTest::conformers()
 {
   // note: the molecule has 4 atoms...
@@ -388,6 +563,107 @@ void MoleculeTest::conformers()
 
 }
 
+void MoleculeTest::atomAttributes()
+{
+  Molecule mol;
+  Atom *a1 = mol.addAtom(6, Vector3d(0.0, 0.0, 0.0));
+  mol.addAtom(8, Vector3d(1.2, 0.0, 0.0));
+  mol.addAtom(1, Vector3d(-1.0, 0.0, 0.0));
+
+  std::vector<double> bfactors;
+  bfactors.push_back(10.0);
+  bfactors.push_back(20.0);
+  QVERIFY(!mol.setAtomAttribute("bfactor", bfactors)); // one value short
+  bfactors.push_back(30.0);
+  QVERIFY(mol.setAtomAttribute("bfactor", bfactors));
+  QVERIFY(mol.setAtomAttribute("label", QStringList() << "C1" << "O1" << "H1"));
+  QCOMPARE(mol.atomAttributeType("bfactor"), Molecule::FloatAttribute);
+  QCOMPARE(mol.atomAttributeType("label"), Molecule::StringAttribute);
+  QCOMPARE(mol.atomAttributeType("charge"), Molecule::NoAttribute);
+  QCOMPARE(mol.atomAttributeNames(), QStringList() << "bfactor" << "label");
+  // Asking for the wrong type gives an empty column
+  QVERIFY(mol.atomIntAttribute("bfactor").empty());
+
+  // The columns follow the atom indices as atoms are added and removed
+  unsigned long revision = mol.atomAttributeRevision();
+  mol.addAtom(7, Vector3d(2.0, 0.0, 0.0));
+  QVERIFY(mol.atomAttributeRevision() != revision);
+  QCOMPARE(mol.atomFloatAttribute("bfactor").size(), size_t(4));
+  QCOMPARE(mol.atomFloatAttribute("bfactor")[3], 0.0);
+  mol.removeAtom(a1);
+  QCOMPARE(mol.atomFloatAttribute("bfactor")[0], 20.0);
+  QCOMPARE(mol.atomStringAttribute("label").at(1), QString("H1"));
+
+  // Merged atoms bring their values along
+  Molecule other;
+  other.addAtom(6, Vector3d(5.0, 0.0, 0.0));
+  std::vector<int> counts(1, 7);
+  QVERIFY(other.setAtomAttribute("count", counts));
+  other.setAtomAttribute("bfactor", std::vector<double>(1, 50.0));
+  mol.merge(other);
+  QCOMPARE(mol.atomFloatAttribute("bfactor").size(), size_t(4));
+  QCOMPARE(mol.atomFloatAttribute("bfactor")[3], 50.0);
+  QCOMPARE(mol.atomIntAttribute("count")[0], 0);
+  QCOMPARE(mol.atomIntAttribute("count")[3], 7);
+
+  Molecule copy(mol);
+  QCOMPARE(copy.atomFloatAttribute("bfactor"), mol.atomFloatAttribute("bfactor"));
+
+  mol.removeAtomAttribute("bfactor");
+  QCOMPARE(mol.atomAttributeType("bfactor"), Molecule::NoAttribute);
+  mol.clear();
+  QVERIFY(mol.atomAttributeNames().isEmpty());
+}
+
+void MoleculeTest::conformerCells()
+{
+  Molecule mol;
+  mol.addAtom(6, Vector3d(0.0, 0.0, 0.0));
+  std::vector<std::vector<Vector3d> *> frames;
+  std::vector<Eigen::Matrix3d> cells;
+  for (int i = 0; i < 2; ++i) {
+    frames.push_back(new std::vector<Vector3d>(1, Vector3d(i, 0.0, 0.0)));
+    cells.push_back(Eigen::Matrix3d::Identity() * (4.0 + i));
+  }
+  QVERIFY(mol.setAllConformers(frames));
+  mol.setConformerCells(cells);
+  QCOMPARE(static_cast<int>(mol.conformerCells().size()), 2);
+
+  Molecule copy;
+  copy = mol;
+  QCOMPARE(static_cast<int>(copy.conformerCells().size()), 2);
+  QCOMPARE(copy.conformerCells()[1](0, 0), 5.0);
+
+  // New conformers do not keep the cells of the old ones
+  frames.clear();
+  for (int i = 0; i < 3; ++i)
+    frames.push_back(new std::vector<Vector3d>(1, Vector3d::Zero()));
+  QVERIFY(mol.setAllConformers(frames));
+  QVERIFY(mol.conformerCells().empty());
+}
+
+void MoleculeTest::approximateCubes()
+{
+  Molecule mol;
+  mol.addAtom(6, Vector3d(0.0, 0.0, 0.0));
+  const std::vector<double> values(8, 0.1);
+  Cube *exact = mol.addCube();
+  exact->setName("exact");
+  exact->setLimits(Vector3d(-1.0, -1.0, -1.0), Eigen::Vector3i(2, 2, 2), 2.0);
+  exact->setData(values);
+  Cube *approximate = mol.addCube();
+  approximate->setName("approximate");
+  approximate->setLimits(*exact);
+  approximate->setData(values);
+  approximate->setRefinedIsoValue(0.02);
+
+  OpenBabel::OBMol obmol = mol.OBMol();
+  std::vector<OpenBabel::OBGenericData *> grids =
+    obmol.GetAllData(OpenBabel::OBGenericDataType::GridData);
+  QCOMPARE(static_cast<int>(grids.size()), 1);
+  QCOMPARE(QString(grids[0]->GetAttribute().c_str()), QString("exact"));
+}
+
 QTEST_MAIN(MoleculeTest)
 
 #include "moc_moleculetest.cxx"
@@ -0,0 +1,317 @@
+/**********************************************************************
+  NetworkFetchTest - unit tests for the network fetch extension
+
+  Copyright (C) 2013 Avogadro Developers
+
+  This file is part of the Avogadro molecular editor project.
+  For more information, see <http://avogadro.cc/>
+
+  Avogadro is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  Avogadro is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+  02110-1301, USA.
+ **********************************************************************/
+
+#include "config.h"
+
+#include <QtTest>
+#include <QtGui/QAction>
+#include <QtGui/QApplication>
+#include <QtCore/QDir>
+#include <QtCore/QSettings>
+#include <QtCore/QTimer>
+#include <QtNetwork/QTcpServer>
+#include <QtNetwork/QTcpSocket>
+
+#include <avogadro/molecule.h>
+#include <avogadro/atom.h>
+
+#include "networkfetchextension.h"
+
+using Avogadro::NetworkFetchExtension;
+using Avogadro::Molecule;
+
+static const char pdbEntry[] =
+  "ATOM      1  N   GLY A   1       0.000   0.000   0.000  1.00  0.00           N\n"
+  "ATOM      2  CA  GLY A   1       1.458   0.000   0.000  1.00  0.00           C\n"
+  "ATOM      3  C   GLY A   1       2.009   1.420   0.000  1.00  0.00           C\n"
+  "END\n";
+
+static const char cifEntry[] =
+  "data_TEST\n"
+  "loop_\n"
+  "_atom_site.group_PDB\n"
+  "_atom_site.id\n"
+  "_atom_site.type_symbol\n"
+  "_atom_site.label_atom_id\n"
+  "_atom_site.label_comp_id\n"
+  "_atom_site.label_asym_id\n"
+  "_atom_site.label_seq_id\n"
+  "_atom_site.Cartn_x\n"
+  "_atom_site.Cartn_y\n"
+  "_atom_site.Cartn_z\n"
+  "ATOM 1 N N GLY A 1 0.000 0.000 0.000\n"
+  "ATOM 2 C CA GLY A 1 1.458 0.000 0.000\n";
+
+/**
+ * Serves the files by path over HTTP, one request per connection, and
+ * counts the requests.
+ */
+class FileServer : public QTcpServer
+{
+  Q_OBJECT
+
+  public:
+    FileServer();
+
+    QString baseUrl() const;
+
+    QHash<QString, QByteArray> files;
+    int requests;
+
+  private slots:
+    void acceptConnections();
+    void respond();
+};
+
+FileServer::FileServer() : requests(0)
+{
+  connect(this, SIGNAL(newConnection()), this, SLOT(acceptConnections()));
+}
+
+QString FileServer::baseUrl() const
+{
+  return QString("http://127.0.0.1:%1/").arg(serverPort());
+}
+
+void FileServer::acceptConnections()
+{
+  while (hasPendingConnections()) {
+    QTcpSocket *socket = nextPendingConnection();
+    connect(socket, SIGNAL(readyRead()), this, SLOT(respond()));
+    connect(socket, SIGNAL(disconnected()), socket, SLOT(deleteLater()));
+  }
+}
+
+void FileServer::respond()
+{
+  QTcpSocket *socket = qobject_cast<QTcpSocket *>(sender());
+  // Wait for the end of the request headers
+  const QByteArray request = socket->property("request").toByteArray()
+    + socket->readAll();
+  socket->setProperty("request", request);
+  if (!request.contains("\r\n\r\n"))
+    return;
+
+  ++requests;
+  const QString path = QString(request.left(request.indexOf("\r\n")))
+    .section(' ', 1, 1).mid(1);
+  if (!files.contains(path)) {
+    socket->write("HTTP/1.1 404 Not Found\r\nContent-Length: 0\r\n"
+                  "Connection: close\r\n\r\n");
+  }
+  else {
+    const QByteArray body = files.value(path);
+    // Cacheable for an hour, as the entries of the databases
+    socket->write("HTTP/1.1 200 OK\r\n"
+                  "Content-Type: text/plain\r\n"
+                  "Cache-Control: public, max-age=3600\r\n"
+                  "Content-Length: " + QByteArray::number(body.size()) + "\r\n"
+                  "Connection: close\r\n\r\n" + body);
+  }
+  socket->disconnectFromHost();
+}
+
+class NetworkFetchTest : public QObject
+{
+  Q_OBJECT
+
+  private:
+    /**
+     * Fetch @p name from the server.
+     * @return The molecule read, 0 on timeout or when the download was
+     * rejected with a warning.
+     */
+    Molecule * fetch(const QString &name, const QString &options = QString());
+
+    QAction * action(const QString &data) const;
+
+    FileServer m_server;
+    NetworkFetchExtension *m_extension;
+    QString m_cacheDirectory;
+    Molecule *m_molecule;
+    int m_warnings;
+
+  public slots:
+    void moleculeChanged(Molecule *molecule, int);
+
+    /**
+     * Close the warning shown for a failed download, if any.
+     */
+    void closeWarning();
+
+  private slots:
+    /**
+     * Called before the first test function is executed.
+     */
+    void initTestCase();
+
+    /**
+     * Called after the last test function is executed.
+     */
+    void cleanupTestCase();
+
+    /**
+     * PDB entries are read by OpenBabel and mmCIF entries by CifReader.
+     */
+    void parse();
+
+    /**
+     * An error page served as a normal reply and an entry that cannot be
+     * read are not cached, a second fetch goes to the server.
+     */
+    void rejected();
+
+    /**
+     * A second fetch of an entry does not go to the server, and offline
+     * the cached entries are still read.
+     */
+    void cache();
+};
+
+Molecule * NetworkFetchTest::fetch(const QString &name, const QString &options)
+{
+  m_molecule = 0;
+  const int warnings = m_warnings;
+  m_extension->fetch(QUrl(m_server.baseUrl() + name), name, true, options);
+  for (int i = 0; i < 100 && !m_molecule && m_warnings == warnings; ++i)
+    QTest::qWait(50);
+  return m_molecule;
+}
+
+QAction * NetworkFetchTest::action(const QString &data) const
+{
+  foreach (QAction *action, m_extension->actions()) {
+    if (action->data() == data)
+      return action;
+  }
+  return 0;
+}
+
+void NetworkFetchTest::moleculeChanged(Molecule *molecule, int)
+{
+  m_molecule = molecule;
+}
+
+void NetworkFetchTest::closeWarning()
+{
+  if (QWidget *warning = QApplication::activeModalWidget()) {
+    ++m_warnings;
+    warning->close();
+  }
+}
+
+void NetworkFetchTest::initTestCase()
+{
+  m_server.files.insert("1abc.pdb", pdbEntry);
+  m_server.files.insert("1abc.cif", cifEntry);
+  m_server.files.insert("2err.pdb", "<html><h1>Error report</h1></html>\n");
+  m_server.files.insert("2bad.cif", "data_BAD\nloop_\n");
+  m_warnings = 0;
+  QVERIFY(m_server.listen(QHostAddress::LocalHost));
+
+  // A fresh cache, the base URL pointing to the local server
+  m_cacheDirectory = QDir::tempPath() + "/networkfetchtest";
+  QSettings settings(m_cacheDirectory + ".ini", QSettings::IniFormat);
+  settings.setValue("pdbUrl", m_server.baseUrl());
+  settings.setValue("cacheDirectory", m_cacheDirectory);
+
+  m_extension = new NetworkFetchExtension;
+  m_extension->readSettings(settings);
+  connect(m_extension, SIGNAL(moleculeChanged(Molecule *, int)),
+          this, SLOT(moleculeChanged(Molecule *, int)));
+  QVERIFY(action("ClearCache"));
+  m_extension->performAction(action("ClearCache"), 0);
+}
+
+void NetworkFetchTest::cleanupTestCase()
+{
+  m_extension->performAction(action("ClearCache"), 0);
+  delete m_extension;
+  QFile::remove(m_cacheDirectory + ".ini");
+}
+
+void NetworkFetchTest::parse()
+{
+  Molecule *molecule = fetch("1abc.pdb");
+  QVERIFY(molecule);
+  QCOMPARE(molecule->numAtoms(), 3u);
+  QCOMPARE(molecule->atom(0)->atomicNumber(), 7);
+  QCOMPARE(molecule->fileName(), QString("1abc.pdb"));
+  delete molecule;
+
+  molecule = fetch("1abc.cif");
+  QVERIFY(molecule);
+  QCOMPARE(molecule->numAtoms(), 2u);
+  QCOMPARE(molecule->atom(1)->atomicNumber(), 6);
+  delete molecule;
+}
+
+void NetworkFetchTest::rejected()
+{
+  QTimer closer;
+  connect(&closer, SIGNAL(timeout()), this, SLOT(closeWarning()));
+  closer.start(50);
+
+  const QStringList names = QStringList() << "2err.pdb" << "2bad.cif";
+  foreach (const QString &name, names) {
+    int requests = m_server.requests;
+    int warnings = m_warnings;
+    QVERIFY(!fetch(name));
+    QCOMPARE(m_warnings, warnings + 1);
+    QCOMPARE(m_server.requests, requests + 1);
+
+    // Not read from the cache
+    requests = m_server.requests;
+    warnings = m_warnings;
+    QVERIFY(!fetch(name));
+    QCOMPARE(m_warnings, warnings + 1);
+    QCOMPARE(m_server.requests, requests + 1);
+  }
+}
+
+void NetworkFetchTest::cache()
+{
+  const int requests = m_server.requests;
+  Molecule *molecule = fetch("1abc.pdb");
+  QVERIFY(molecule);
+  QCOMPARE(molecule->numAtoms(), 3u);
+  QCOMPARE(m_server.requests, requests);
+  delete molecule;
+
+  // Offline with the server gone
+  m_server.close();
+  QAction *offline = action("Offline");
+  QVERIFY(offline);
+  offline->setChecked(true);
+  m_extension->performAction(offline, 0);
+  molecule = fetch("1abc.cif");
+  QVERIFY(molecule);
+  QCOMPARE(molecule->numAtoms(), 2u);
+  QCOMPARE(m_server.requests, requests);
+  delete molecule;
+}
+
+QTEST_MAIN(NetworkFetchTest)
+
+#include "moc_networkfetchtest.cxx"
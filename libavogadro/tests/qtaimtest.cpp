@@ -0,0 +1,182 @@
+/**********************************************************************
+  QTAIMTest - unit tests for the QTAIM critical point search
+
+  Copyright (C) 2013 Avogadro Developers
+
+  This file is part of the Avogadro molecular editor project.
+  For more information, see <http://avogadro.cc/>
+
+  Avogadro is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  Avogadro is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+  02110-1301, USA.
+ **********************************************************************/
+
+#include "config.h"
+
+#include <QtTest>
+
+#include "qtaimwavefunction.h"
+#include "qtaimcriticalpointlocator.h"
+#include "qtaimspatialhash.h"
+
+using Avogadro::QTAIMWavefunction;
+using Avogadro::QTAIMCriticalPointLocator;
+using Avogadro::QTAIMSpatialHash;
+
+class QTAIMTest : public QObject
+{
+  Q_OBJECT
+
+  private:
+    /**
+     * @return True if two of @p points are closer than @p distance.
+     */
+    bool hasDuplicates(const QList<QVector3D> &points, qreal distance);
+
+  private slots:
+    /**
+     * The spatial hash finds exactly the points within the radius, also
+     * across cell boundaries and at negative coordinates.
+     */
+    void spatialHash();
+
+    /**
+     * Candidates found twice are kept once, distinct points nearby are not
+     * merged.
+     */
+    void spatialHashDuplicates();
+
+    /**
+     * The critical points of small molecules are all found, once each, and
+     * satisfy the Poincare-Hopf relation checked by verifyTopology().
+     */
+    void topology_data();
+    void topology();
+};
+
+bool QTAIMTest::hasDuplicates(const QList<QVector3D> &points, qreal distance)
+{
+  for (int i = 0; i < points.size(); ++i)
+    for (int j = i + 1; j < points.size(); ++j)
+      if ((points.at(i) - points.at(j)).length() < distance)
+        return true;
+  return false;
+}
+
+void QTAIMTest::spatialHash()
+{
+  const qreal cellSize = 0.5;
+  QTAIMSpatialHash hash(cellSize);
+  QList<QVector3D> points;
+  // A regular lattice straddling the origin, offset from the cell edges
+  for (int i = -4; i < 4; ++i)
+    for (int j = -4; j < 4; ++j)
+      for (int k = -4; k < 4; ++k)
+        points << QVector3D(0.3 * i + 0.01, 0.3 * j - 0.02, 0.3 * k + 0.03);
+  foreach (const QVector3D &point, points)
+    hash.insert(point);
+
+  const QVector3D centres[3] = { QVector3D(0.0, 0.0, 0.0),
+                                 QVector3D(-0.5, 0.49, -1.01),
+                                 QVector3D(1.0, -1.0, 0.25) };
+  const qreal radii[3] = { 0.1, 0.45, 1.2 };
+  for (int c = 0; c < 3; ++c) {
+    for (int r = 0; r < 3; ++r) {
+      QList<qint64> expected;
+      for (int n = 0; n < points.size(); ++n)
+        if ((points.at(n) - centres[c]).length() < radii[r])
+          expected << n;
+      QList<qint64> found = hash.neighbors(centres[c], radii[r]);
+      qSort(found);
+      QCOMPARE(found, expected);
+      QCOMPARE(hash.contains(centres[c], radii[r]), !expected.isEmpty());
+    }
+  }
+}
+
+void QTAIMTest::spatialHashDuplicates()
+{
+  // As in QTAIMCriticalPointLocator::uniqueCriticalPoints()
+  const qreal duplicateDistance = 5.e-2;
+  QTAIMSpatialHash hash(duplicateDistance);
+  hash.insert(QVector3D(1.0, 1.0, 1.0));
+
+  const QVector3D candidates[5] = { QVector3D(1.0, 1.0, 1.03),
+                                    QVector3D(1.0, 1.0, 1.1),
+                                    QVector3D(-0.001, 0.0, 0.0),
+                                    QVector3D(0.001, 0.0, 0.0),
+                                    QVector3D(1.0, 1.0, 1.12) };
+  QList<QVector3D> unique;
+  for (int i = 0; i < 5; ++i) {
+    if (!hash.contains(candidates[i], duplicateDistance)) {
+      hash.insert(candidates[i]);
+      unique << candidates[i];
+    }
+  }
+  QCOMPARE(unique.size(), 2);
+  QCOMPARE(unique.at(0), candidates[1]);
+  QCOMPARE(unique.at(1), candidates[2]);
+}
+
+void QTAIMTest::topology_data()
+{
+  QTest::addColumn<QString>("fileName");
+  QTest::addColumn<int>("nuclei");
+  QTest::addColumn<int>("bonds");
+  QTest::addColumn<int>("rings");
+  QTest::addColumn<int>("cages");
+
+  QTest::newRow("formate") << "hco2.wfn" << 4 << 3 << 0 << 0;
+  QTest::newRow("diborane") << "b2h6.wfn" << 8 << 8 << 1 << 0;
+  QTest::newRow("tetrahedrane") << "c4h4.wfn" << 8 << 10 << 4 << 1;
+}
+
+void QTAIMTest::topology()
+{
+  QFETCH(QString, fileName);
+  QFETCH(int, nuclei);
+  QFETCH(int, bonds);
+  QFETCH(int, rings);
+  QFETCH(int, cages);
+
+  QTAIMWavefunction wfn;
+  QVERIFY(wfn.initializeWithWFNFile(QString(TESTDATADIR) + fileName));
+
+  QTAIMCriticalPointLocator cpl(wfn);
+  cpl.locateNuclearCriticalPoints();
+  cpl.locateBondCriticalPoints();
+  cpl.locateRingCriticalPoints();
+  cpl.locateCageCriticalPoints();
+  QVERIFY(cpl.verifyTopology());
+  QCOMPARE(cpl.poincareHopfSum(), Q_INT64_C(1));
+
+  QCOMPARE(cpl.nuclearCriticalPoints().size(), nuclei);
+  QCOMPARE(cpl.bondCriticalPoints().size(), bonds);
+  QCOMPARE(cpl.ringCriticalPoints().size(), rings);
+  QCOMPARE(cpl.cageCriticalPoints().size(), cages);
+  QCOMPARE(cpl.bondPaths().size(), bonds);
+
+  // Found from several seeds each, but kept once
+  QVERIFY(!hasDuplicates(cpl.bondCriticalPoints(), 5.e-2));
+  QVERIFY(!hasDuplicates(cpl.ringCriticalPoints(), 5.e-2));
+  QVERIFY(!hasDuplicates(cpl.cageCriticalPoints(), 5.e-2));
+
+  // Already consistent, so nothing is searched or added again
+  QVERIFY(cpl.verifyTopology());
+  QCOMPARE(cpl.bondCriticalPoints().size(), bonds);
+}
+
+QTEST_MAIN(QTAIMTest)
+
+#include "moc_qtaimtest.cxx"
@@ -0,0 +1,57 @@
+/**********************************************************************
+  ReaderTest - shared helper for the tests of the file readers
+
+  Copyright (C) 2013 Avogadro Developers
+
+  This file is part of the Avogadro molecular editor project.
+  For more information, see <http://avogadro.cc/>
+
+  Avogadro is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  Avogadro is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+  02110-1301, USA.
+ **********************************************************************/
+
+#ifndef READERTEST_H
+#define READERTEST_H
+
+#include <QBuffer>
+#include <QDebug>
+#include <QString>
+
+#include <avogadro/molecule.h>
+
+/**
+ * Read @p text with a Reader such as Avogadro::CifReader or
+ * Avogadro::TrajectoryReader, set up with @p options.
+ * @return The molecule read, owned by the caller, or 0 after printing
+ * the error of the reader.
+ */
+template <class Reader>
+Avogadro::Molecule * readText(const char *text,
+                              const QString &options = QString())
+{
+  QBuffer buffer;
+  buffer.setData(text);
+  Reader reader;
+  reader.setOptions(options);
+  Avogadro::Molecule *molecule = new Avogadro::Molecule;
+  if (!reader.read(&buffer, molecule)) {
+    qDebug() << reader.errorString();
+    delete molecule;
+    return 0;
+  }
+  return molecule;
+}
+
+#endif
@@ -0,0 +1,189 @@
+/**********************************************************************
+  SelectionQueryTest - unit tests for the atom selection expressions
+
+  Copyright (C) 2013 Avogadro Developers
+
+  This file is part of the Avogadro molecular editor project.
+  For more information, see <http://avogadro.cc/>
+
+  Avogadro is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  Avogadro is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+  02110-1301, USA.
+ **********************************************************************/
+
+#include "config.h"
+
+#include <QtTest>
+#include <avogadro/selectionquery.h>
+#include <avogadro/molecule.h>
+#include <avogadro/atom.h>
+#include <avogadro/residue.h>
+
+#include <Eigen/Core>
+
+using Avogadro::SelectionQuery;
+using Avogadro::Molecule;
+using Avogadro::Atom;
+using Avogadro::Residue;
+
+using Eigen::Vector3d;
+
+class SelectionQueryTest : public QObject
+{
+  Q_OBJECT
+
+  private:
+    Molecule *m_molecule;
+
+    Residue * addResidue(const QString &name, const QString &number, char chain);
+    void addAtom(Residue *residue, int atomicNumber, const QString &name,
+                 const Vector3d &pos);
+
+    /**
+     * @return The indices of the atoms selected by @p expression.
+     */
+    QList<int> select(const QString &expression);
+
+  private slots:
+    /**
+     * Called before the first test function is executed.
+     */
+    void initTestCase();
+
+    /**
+     * Called after the last test function is executed.
+     */
+    void cleanupTestCase();
+
+    void parseErrors();
+    void terms();
+    void booleans();
+    void within();
+    void sameResidue();
+};
+
+Residue * SelectionQueryTest::addResidue(const QString &name,
+                                         const QString &number, char chain)
+{
+  Residue *residue = m_molecule->addResidue();
+  residue->setName(name);
+  residue->setNumber(number);
+  residue->setChainID(chain);
+  return residue;
+}
+
+void SelectionQueryTest::addAtom(Residue *residue, int atomicNumber,
+                                 const QString &name, const Vector3d &pos)
+{
+  Atom *atom = m_molecule->addAtom(atomicNumber, pos);
+  residue->addAtom(atom->id());
+  residue->setAtomId(atom->id(), name);
+}
+
+QList<int> SelectionQueryTest::select(const QString &expression)
+{
+  SelectionQuery query(expression);
+  if (!query.isValid())
+    qDebug() << query.errorString();
+  QList<int> indices;
+  const QBitArray bits = query.evaluate(m_molecule);
+  for (int i = 0; i < bits.size(); ++i)
+    if (bits.testBit(i))
+      indices.append(i);
+  return indices;
+}
+
+void SelectionQueryTest::initTestCase()
+{
+  // A glycine of chain A, a ligand 3 A away and a water far away
+  m_molecule = new Molecule;
+  Residue *glycine = addResidue("GLY", "10", 'A');
+  addAtom(glycine, 7, "N", Vector3d(0.0, 0.0, 0.0));
+  addAtom(glycine, 6, "CA", Vector3d(1.5, 0.0, 0.0));
+  addAtom(glycine, 6, "C", Vector3d(2.0, 1.4, 0.0));
+  addAtom(glycine, 8, "O", Vector3d(1.3, 2.4, 0.0));
+  addAtom(glycine, 1, "HA2", Vector3d(1.8, -0.5, 0.9));
+  Residue *ligand = addResidue("LIG", "101", 'B');
+  addAtom(ligand, 6, "C1", Vector3d(1.5, -3.0, 0.0));
+  addAtom(ligand, 17, "CL1", Vector3d(1.5, -4.8, 0.0));
+  Residue *water = addResidue("HOH", "201", 'B');
+  addAtom(water, 8, "O", Vector3d(20.0, 0.0, 0.0));
+}
+
+void SelectionQueryTest::cleanupTestCase()
+{
+  delete m_molecule;
+}
+
+void SelectionQueryTest::parseErrors()
+{
+  SelectionQuery query;
+  QVERIFY(query.setExpression("element C"));
+  QVERIFY(query.isValid());
+  QVERIFY(!query.setExpression("element"));
+  QVERIFY(!query.isValid());
+  QVERIFY(!query.errorString().isEmpty());
+  QVERIFY(!query.setExpression("(protein and water"));
+  QVERIFY(!query.setExpression("within five of water"));
+  QVERIFY(!query.setExpression("protein water"));
+  QVERIFY(!query.setExpression("element Xx"));
+  QCOMPARE(query.evaluate(m_molecule).count(true), 0);
+}
+
+void SelectionQueryTest::terms()
+{
+  QCOMPARE(select("all").size(), 8);
+  QCOMPARE(select("none").size(), 0);
+  QCOMPARE(select("element C"), QList<int>() << 1 << 2 << 5);
+  QCOMPARE(select("element 8 cl"), QList<int>() << 3 << 6 << 7);
+  QCOMPARE(select("hydrogen"), QList<int>() << 4);
+  QCOMPARE(select("name CA O"), QList<int>() << 1 << 3 << 7);
+  QCOMPARE(select("name H*"), QList<int>() << 4);
+  QCOMPARE(select("resname LIG"), QList<int>() << 5 << 6);
+  QCOMPARE(select("resid 100-300"), QList<int>() << 5 << 6 << 7);
+  QCOMPARE(select("chain A"), QList<int>() << 0 << 1 << 2 << 3 << 4);
+  QCOMPARE(select("index 2:3 7"), QList<int>() << 2 << 3 << 7);
+  QCOMPARE(select("protein").size(), 5);
+  QCOMPARE(select("backbone"), QList<int>() << 0 << 1 << 2 << 3);
+  QCOMPARE(select("water"), QList<int>() << 7);
+}
+
+void SelectionQueryTest::booleans()
+{
+  QCOMPARE(select("protein and not element H"), QList<int>() << 0 << 1 << 2 << 3);
+  QCOMPARE(select("water or resname LIG"), QList<int>() << 5 << 6 << 7);
+  QCOMPARE(select("not (protein or water)"), QList<int>() << 5 << 6);
+  QCOMPARE(select("element C and chain B or element N"), QList<int>() << 0 << 5);
+  QCOMPARE(select("not not water"), QList<int>() << 7);
+}
+
+void SelectionQueryTest::within()
+{
+  // The planner moves "within" after the cheap terms, the result is the same
+  QCOMPARE(select("protein and within 3.2 of resname LIG and not element H"),
+           QList<int>() << 1);
+  QCOMPARE(select("within 3.2 of resname LIG"), QList<int>() << 1 << 4 << 5 << 6);
+  QCOMPARE(select("within 0 of water"), QList<int>() << 7);
+  QCOMPARE(select("within 100 of none").size(), 0);
+}
+
+void SelectionQueryTest::sameResidue()
+{
+  QCOMPARE(select("same residue as element Cl"), QList<int>() << 5 << 6);
+  QCOMPARE(select("same residue as within 2.8 of index 5").size(), 7);
+}
+
+QTEST_MAIN(SelectionQueryTest)
+
+#include "moc_selectionquerytest.cxx"
@@ -0,0 +1,182 @@
+/**********************************************************************
+  SESurfaceTest - unit tests for the solvent excluded surface cubes
+
+  Copyright (C) 2013 Avogadro Developers
+
+  This file is part of the Avogadro molecular editor project.
+  For more information, see <http://avogadro.cc/>
+
+  Avogadro is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  Avogadro is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+  02110-1301, USA.
+ **********************************************************************/
+
+#include "config.h"
+
+#include <QtTest>
+#include <QReadWriteLock>
+#include <avogadro/molecule.h>
+#include <avogadro/atom.h>
+#include <avogadro/cube.h>
+
+#include <openbabel/data.h>
+
+#include "sesurface.h"
+
+#include <cmath>
+#include <limits>
+#include <vector>
+
+using Avogadro::SESurface;
+using Avogadro::Molecule;
+using Avogadro::Atom;
+using Avogadro::Cube;
+
+using Eigen::Vector3d;
+using Eigen::Vector3i;
+
+class SESurfaceTest : public QObject
+{
+  Q_OBJECT
+
+  private:
+    /**
+     * Wait for the calculation of @p cube to complete.
+     * @return False on timeout.
+     */
+    bool waitForCube(Cube *cube);
+
+    /**
+     * Set up @p cube as a 22x19x17 grid with 0.37 A spacing around the
+     * atoms of the test molecule.
+     */
+    void setLimits(Cube *cube);
+
+    Molecule m_molecule;
+
+  private slots:
+    /**
+     * Called before the first test function is executed.
+     */
+    void initTestCase();
+
+    /**
+     * Every point of the cube is the probe radius minus the distance to the
+     * nearest probe centre, found by comparing all pairs of points.
+     */
+    void bruteForce();
+
+    /**
+     * A second calculation started before the first is complete completes
+     * both cubes.
+     */
+    void restart();
+};
+
+bool SESurfaceTest::waitForCube(Cube *cube)
+{
+  for (int i = 0; i < 500; ++i) {
+    if (cube->lock()->tryLockForRead()) {
+      cube->lock()->unlock();
+      return true;
+    }
+    QTest::qWait(10);
+  }
+  return false;
+}
+
+void SESurfaceTest::setLimits(Cube *cube)
+{
+  cube->setLimits(Vector3d(-3.9, -3.4, -3.1), Vector3i(22, 19, 17), 0.37);
+}
+
+void SESurfaceTest::initTestCase()
+{
+  m_molecule.addAtom(6, Vector3d(0.0, 0.0, 0.0));
+  m_molecule.addAtom(8, Vector3d(1.31, 0.23, 0.11));
+  m_molecule.addAtom(1, Vector3d(-0.62, 0.93, -0.17));
+}
+
+void SESurfaceTest::bruteForce()
+{
+  const double probe = 1.4;
+  SESurface surface;
+  surface.setProbeRadius(probe);
+  surface.setAtoms(&m_molecule);
+  Cube cube;
+  setLimits(&cube);
+  surface.calculateCube(&cube);
+  QVERIFY(waitForCube(&cube));
+
+  // The probe centres: the faces of the cube and the points outside of the
+  // spheres grown by the probe radius
+  const std::vector<double> &values = *cube.data();
+  const Vector3i dims = cube.dimensions();
+  QCOMPARE(static_cast<int>(values.size()), dims.x() * dims.y() * dims.z());
+  std::vector<Vector3d> centres;
+  for (unsigned int n = 0; n < values.size(); ++n) {
+    const Vector3d pos = cube.position(n);
+    const int i = n / (dims.y() * dims.z());
+    const int j = (n / dims.z()) % dims.y();
+    const int k = n % dims.z();
+    bool free = i == 0 || j == 0 || k == 0 || i == dims.x() - 1
+      || j == dims.y() - 1 || k == dims.z() - 1;
+    if (!free) {
+      free = true;
+      foreach (Atom *atom, m_molecule.atoms()) {
+        const double radius =
+          OpenBabel::etab.GetVdwRad(atom->atomicNumber()) + probe;
+        if ((pos - *atom->pos()).norm() < radius)
+          free = false;
+      }
+    }
+    if (free)
+      centres.push_back(pos);
+  }
+  QVERIFY(centres.size() < values.size());
+
+  double maxError = 0.0;
+  for (unsigned int n = 0; n < values.size(); ++n) {
+    const Vector3d pos = cube.position(n);
+    double distance2 = std::numeric_limits<double>::max();
+    for (unsigned int c = 0; c < centres.size(); ++c)
+      distance2 = qMin(distance2, (centres[c] - pos).squaredNorm());
+    maxError = qMax(maxError, std::abs(values[n]
+                                       - (probe - std::sqrt(distance2))));
+  }
+  QVERIFY(maxError < 1.0e-9);
+
+  // Inside at the carbon, solvent at the corner
+  QVERIFY(cube.value(Vector3d(0.0, 0.0, 0.0)) < 0.0);
+  QVERIFY(values.front() > 0.0);
+}
+
+void SESurfaceTest::restart()
+{
+  SESurface surface;
+  surface.setAtoms(&m_molecule);
+  Cube first, second;
+  setLimits(&first);
+  setLimits(&second);
+  surface.calculateCube(&first);
+  surface.calculateCube(&second);
+  QVERIFY(waitForCube(&first));
+  QVERIFY(waitForCube(&second));
+  QVERIFY(*first.data() == *second.data());
+  QVERIFY(first.value(Vector3d(0.0, 0.0, 0.0)) < 0.0);
+}
+
+QTEST_MAIN(SESurfaceTest)
+
+#include "moc_sesurfacetest.cxx"
@@ -0,0 +1,163 @@
+/**********************************************************************
+  SurfaceAreaTest - unit tests for the surface area calculation
+
+  Copyright (C) 2013 Avogadro Developers
+
+  This file is part of the Avogadro molecular editor project.
+  For more information, see <http://avogadro.cc/>
+
+  Avogadro is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  Avogadro is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+  02110-1301, USA.
+ **********************************************************************/
+
+#include "config.h"
+
+#include <QtTest>
+#include <avogadro/surfacearea.h>
+#include <avogadro/molecule.h>
+#include <avogadro/atom.h>
+#include <avogadro/residue.h>
+
+#include <Eigen/Core>
+
+#include <cmath>
+#include <vector>
+
+using Avogadro::SurfaceArea;
+using Avogadro::Molecule;
+using Avogadro::Atom;
+using Avogadro::Residue;
+
+using Eigen::Vector3d;
+
+class SurfaceAreaTest : public QObject
+{
+  Q_OBJECT
+
+  private slots:
+    void sphere();
+    void overlap();
+    void buried();
+    void molecule();
+    void conformers();
+};
+
+void SurfaceAreaTest::sphere()
+{
+  std::vector<Vector3d> positions(1, Vector3d(1.0, 2.0, 3.0));
+  std::vector<double> radii(1, 2.0);
+
+  SurfaceArea surface;
+  surface.setProbeRadius(0.0);
+  QVERIFY(surface.calculate(positions, radii));
+  QCOMPARE(surface.atomAreas().size(), size_t(1));
+  QVERIFY(qAbs(surface.totalArea() - 16.0 * M_PI) < 1.0e-8);
+  QVERIFY(qAbs(surface.volume() - 32.0 / 3.0 * M_PI) < 1.0e-2);
+
+  // The probe grows the sphere
+  surface.setProbeRadius(1.0);
+  surface.calculate(positions, radii);
+  QVERIFY(qAbs(surface.totalArea() - 36.0 * M_PI) < 1.0e-8);
+}
+
+void SurfaceAreaTest::overlap()
+{
+  // Two spheres of radius 2 with their centres 2 apart, each loses a cap
+  // of height 1
+  std::vector<Vector3d> positions;
+  positions.push_back(Vector3d(0.0, 0.0, 0.0));
+  positions.push_back(Vector3d(2.0, 0.0, 0.0));
+  std::vector<double> radii(2, 2.0);
+
+  SurfaceArea surface;
+  surface.setProbeRadius(0.0);
+  surface.setPointCount(1000);
+  surface.calculate(positions, radii);
+  const double area = 2.0 * (16.0 * M_PI - 4.0 * M_PI);
+  const double volume = 2.0 * (32.0 / 3.0 * M_PI - 5.0 / 3.0 * M_PI);
+  QVERIFY(qAbs(surface.totalArea() - area) / area < 1.0e-2);
+  QVERIFY(qAbs(surface.volume() - volume) / volume < 1.0e-2);
+  QVERIFY(qAbs(surface.atomAreas()[0] - surface.atomAreas()[1]) < 1.0e-8);
+}
+
+void SurfaceAreaTest::buried()
+{
+  std::vector<Vector3d> positions;
+  positions.push_back(Vector3d(0.0, 0.0, 0.0));
+  positions.push_back(Vector3d(0.5, 0.0, 0.0));
+  std::vector<double> radii;
+  radii.push_back(3.0);
+  radii.push_back(1.0);
+
+  SurfaceArea surface;
+  surface.setProbeRadius(0.0);
+  surface.calculate(positions, radii);
+  QCOMPARE(surface.atomAreas()[1], 0.0);
+  QVERIFY(qAbs(surface.totalArea() - 36.0 * M_PI) < 1.0e-8);
+}
+
+void SurfaceAreaTest::molecule()
+{
+  Molecule molecule;
+  Atom *a1 = molecule.addAtom(6, Vector3d(0.0, 0.0, 0.0));
+  Atom *a2 = molecule.addAtom(6, Vector3d(1.5, 0.0, 0.0));
+  Atom *a3 = molecule.addAtom(8, Vector3d(20.0, 0.0, 0.0));
+  Residue *residue = molecule.addResidue();
+  residue->addAtom(a1->id());
+  residue->addAtom(a2->id());
+  residue = molecule.addResidue();
+  residue->addAtom(a3->id());
+
+  SurfaceArea surface;
+  QVERIFY(surface.calculate(&molecule));
+  QCOMPARE(surface.atomAreas().size(), size_t(3));
+  QCOMPARE(surface.residueAreas().size(), size_t(2));
+  QVERIFY(qAbs(surface.residueAreas()[0] - surface.atomAreas()[0]
+               - surface.atomAreas()[1]) < 1.0e-8);
+  QVERIFY(qAbs(surface.residueAreas()[1] - surface.atomAreas()[2]) < 1.0e-8);
+  QVERIFY(qAbs(surface.totalArea() - surface.residueAreas()[0]
+               - surface.residueAreas()[1]) < 1.0e-8);
+
+  Molecule empty;
+  QVERIFY(!surface.calculate(&empty));
+  QVERIFY(surface.atomAreas().empty());
+  QCOMPARE(surface.totalArea(), 0.0);
+}
+
+void SurfaceAreaTest::conformers()
+{
+  Molecule molecule;
+  Atom *a1 = molecule.addAtom(6, Vector3d(0.0, 0.0, 0.0));
+  Atom *a2 = molecule.addAtom(6, Vector3d(10.0, 0.0, 0.0));
+
+  // In the second conformer the atoms overlap
+  std::vector<Vector3d> conformer(molecule.conformerSize());
+  conformer[a1->id()] = Vector3d(0.0, 0.0, 0.0);
+  conformer[a2->id()] = Vector3d(1.5, 0.0, 0.0);
+  QVERIFY(molecule.addConformer(conformer, 1));
+
+  SurfaceArea surface;
+  surface.calculate(&molecule);
+  const std::vector<double> areas = surface.conformerAreas(&molecule);
+  QCOMPARE(areas.size(), size_t(2));
+  QVERIFY(qAbs(areas[0] - surface.totalArea()) < 1.0e-8);
+  QVERIFY(areas[1] < areas[0]);
+  // The current conformer is unchanged
+  QCOMPARE(*a2->pos(), Vector3d(10.0, 0.0, 0.0));
+}
+
+QTEST_MAIN(SurfaceAreaTest)
+
+#include "moc_surfaceareatest.cxx"
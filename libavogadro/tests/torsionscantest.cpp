@@ -0,0 +1,261 @@
+/**********************************************************************
+  TorsionScanTest - unit tests for the torsion scan of the bond tool
+
+  Copyright (C) 2013 Avogadro Developers
+
+  This file is part of the Avogadro molecular editor project.
+  For more information, see <http://avogadro.cc/>
+
+  Avogadro is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  Avogadro is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+  02110-1301, USA.
+ **********************************************************************/
+
+#include "config.h"
+
+#include <QtTest>
+#include <QTime>
+
+#include <avogadro/molecule.h>
+#include <avogadro/moleculefile.h>
+#include <avogadro/atom.h>
+#include <avogadro/bond.h>
+
+#include "torsionscan.h"
+
+#include <cmath>
+
+using Avogadro::TorsionScan;
+using Avogadro::Molecule;
+using Avogadro::MoleculeFile;
+using Avogadro::Atom;
+using Avogadro::Bond;
+
+class TorsionScanTest : public QObject
+{
+  Q_OBJECT
+
+  private:
+    /**
+     * Wait for @p scan to finish.
+     * @return False on timeout.
+     */
+    bool waitForScan(TorsionScan *scan);
+
+    /**
+     * @return The C-C bond of m_ethane.
+     */
+    Bond * carbonBond();
+
+    /**
+     * @return The distance of @p angle in degrees to the nearest multiple
+     * of 120 degrees plus @p offset.
+     */
+    double threefoldDistance(double angle, double offset);
+
+    Molecule *m_ethane;
+
+  private slots:
+    /**
+     * Called before the first test function is executed.
+     */
+    void initTestCase();
+
+    /**
+     * Called after the last test function is executed.
+     */
+    void cleanupTestCase();
+
+    /**
+     * Bonds without other neighbors cannot be scanned.
+     */
+    void setup();
+
+    /**
+     * The rigid scan of ethane gives a threefold profile with minima at the
+     * staggered and maxima at the eclipsed conformations, found within a
+     * second.
+     */
+    void rigid();
+
+    /**
+     * Relaxing the other coordinates never raises the energy.
+     */
+    void relaxed();
+
+    /**
+     * apply() moves the molecule to the geometry of a point.
+     */
+    void apply();
+};
+
+bool TorsionScanTest::waitForScan(TorsionScan *scan)
+{
+  QTime time;
+  time.start();
+  while (scan->isRunning()) {
+    if (time.elapsed() > 10000)
+      return false;
+    QTest::qWait(1);
+  }
+  return true;
+}
+
+Bond * TorsionScanTest::carbonBond()
+{
+  foreach (Bond *bond, m_ethane->bonds())
+    if (bond->beginAtom()->atomicNumber() == 6
+        && bond->endAtom()->atomicNumber() == 6)
+      return bond;
+  return 0;
+}
+
+double TorsionScanTest::threefoldDistance(double angle, double offset)
+{
+  double distance = std::fmod(std::fabs(angle - offset), 120.0);
+  return qMin(distance, 120.0 - distance);
+}
+
+void TorsionScanTest::initTestCase()
+{
+  m_ethane = MoleculeFile::readMolecule(QString(TESTDATADIR) + "ethane.cml");
+  QVERIFY(m_ethane);
+  QCOMPARE(m_ethane->numAtoms(), 8U);
+  QVERIFY(carbonBond());
+}
+
+void TorsionScanTest::cleanupTestCase()
+{
+  delete m_ethane;
+}
+
+void TorsionScanTest::setup()
+{
+  TorsionScan scan;
+  QVERIFY(!scan.setup(m_ethane, 0));
+  QVERIFY(!scan.errorString().isEmpty());
+
+  foreach (Bond *bond, m_ethane->bonds()) {
+    if (bond == carbonBond())
+      QVERIFY(scan.setup(m_ethane, bond));
+    else
+      QVERIFY(!scan.setup(m_ethane, bond));
+  }
+}
+
+void TorsionScanTest::rigid()
+{
+  TorsionScan scan;
+  QVERIFY(scan.setup(m_ethane, carbonBond()));
+  QCOMPARE(scan.step(), 10.0);
+
+  QTime time;
+  time.start();
+  QVERIFY2(scan.start(), qPrintable(scan.errorString()));
+  QVERIFY(waitForScan(&scan));
+  QVERIFY(time.elapsed() < 1000);
+
+  QCOMPARE(scan.count(), 36);
+  for (int i = 0; i < scan.count(); ++i) {
+    QVERIFY(scan.isDone(i));
+    QVERIFY(scan.angle(i) > -180.0 && scan.angle(i) <= 180.0);
+  }
+
+  // Threefold: the hydrogens are equivalent
+  for (int i = 0; i < 12; ++i) {
+    QVERIFY(std::fabs(scan.energy(i) - scan.energy(i + 12)) < 0.5);
+    QVERIFY(std::fabs(scan.energy(i) - scan.energy(i + 24)) < 0.5);
+  }
+
+  // The file is staggered, H-C-C-H dihedrals of 60 degrees plus multiples
+  // of 120 degrees are minima and those of 0 plus multiples are maxima
+  int lowest = 0, highest = 0;
+  for (int i = 1; i < scan.count(); ++i) {
+    if (scan.energy(i) < scan.energy(lowest))
+      lowest = i;
+    if (scan.energy(i) > scan.energy(highest))
+      highest = i;
+  }
+  QVERIFY(threefoldDistance(scan.angle(lowest), 60.0) < 5.1);
+  QVERIFY(threefoldDistance(scan.angle(highest), 0.0) < 5.1);
+  // UFF has a barrier of about 2 kcal/mol, experiment 12 kJ/mol
+  const double barrier = scan.energy(highest) - scan.energy(lowest);
+  QVERIFY(barrier > 4.0 && barrier < 30.0);
+
+  // Downhill from the eclipsed conformation to a staggered one
+  int minimum = scan.localMinimum(highest);
+  QVERIFY(minimum != highest);
+  QVERIFY(threefoldDistance(scan.angle(minimum), 60.0) < 5.1);
+  QVERIFY(std::fabs(scan.energy(minimum) - scan.energy(lowest)) < 0.5);
+  QCOMPARE(scan.localMinimum(minimum), minimum);
+  QCOMPARE(scan.localMinimum(-1), -1);
+
+  QCOMPARE(scan.nearest(scan.angle(lowest) + 2.0), lowest);
+}
+
+void TorsionScanTest::relaxed()
+{
+  TorsionScan rigid;
+  QVERIFY(rigid.setup(m_ethane, carbonBond()));
+  QVERIFY(rigid.start());
+  QVERIFY(waitForScan(&rigid));
+
+  TorsionScan relaxed;
+  QVERIFY(relaxed.setup(m_ethane, carbonBond()));
+  relaxed.setRelax(true);
+  QTime time;
+  time.start();
+  QVERIFY2(relaxed.start(), qPrintable(relaxed.errorString()));
+  QVERIFY(waitForScan(&relaxed));
+  QVERIFY(time.elapsed() < 1000);
+
+  QCOMPARE(relaxed.count(), rigid.count());
+  for (int i = 0; i < relaxed.count(); ++i) {
+    QVERIFY(relaxed.isDone(i));
+    QCOMPARE(relaxed.angle(i), rigid.angle(i));
+    QVERIFY(relaxed.energy(i) <= rigid.energy(i) + 1.0e-6);
+  }
+}
+
+void TorsionScanTest::apply()
+{
+  Molecule ethane(*m_ethane);
+  Bond *bond = 0;
+  foreach (Bond *b, ethane.bonds())
+    if (b->beginAtom()->atomicNumber() == 6
+        && b->endAtom()->atomicNumber() == 6)
+      bond = b;
+
+  TorsionScan scan;
+  QVERIFY(scan.setup(&ethane, bond));
+  QVERIFY(!scan.apply(0));
+  QVERIFY(scan.start());
+  QVERIFY(waitForScan(&scan));
+
+  // Rotated by 60 degrees, the moving hydrogens move by about an angstrom
+  QVERIFY(scan.apply(6));
+  double moved = 0.0;
+  for (unsigned int i = 0; i < ethane.numAtoms(); ++i)
+    moved = qMax(moved, (*ethane.atom(i)->pos() - *m_ethane->atom(i)->pos()).norm());
+  QVERIFY(moved > 0.9);
+
+  // The first point is the starting geometry
+  QVERIFY(scan.apply(0));
+  for (unsigned int i = 0; i < ethane.numAtoms(); ++i)
+    QVERIFY((*ethane.atom(i)->pos() - *m_ethane->atom(i)->pos()).norm() < 1.0e-6);
+}
+
+QTEST_MAIN(TorsionScanTest)
+
+#include "moc_torsionscantest.cxx"
@@ -0,0 +1,208 @@
+/**********************************************************************
+  TrajectoryReaderTest - unit tests for the periodic trajectory reader
+
+  Copyright (C) 2013 Avogadro Developers
+
+  This file is part of the Avogadro molecular editor project.
+  For more information, see <http://avogadro.cc/>
+
+  Avogadro is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  Avogadro is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+  02110-1301, USA.
+ **********************************************************************/
+
+#include "config.h"
+
+#include <QtTest>
+#include <avogadro/trajectoryreader.h>
+#include <avogadro/molecule.h>
+#include <avogadro/atom.h>
+
+#include <openbabel/generic.h>
+
+#include "readertest.h"
+
+using Avogadro::TrajectoryReader;
+using Avogadro::Molecule;
+using Avogadro::Atom;
+
+// Two frames of a cell growing along a, the oxygen crosses the boundary
+static const char xdatcar[] =
+  "SiO\n"
+  "1.0\n"
+  "4.0 0.0 0.0\n"
+  "0.0 4.0 0.0\n"
+  "0.0 0.0 4.0\n"
+  "Si O\n"
+  "1 1\n"
+  "Direct configuration=     1\n"
+  "0.00 0.00 0.00\n"
+  "0.95 0.50 0.50\n"
+  "SiO\n"
+  "1.0\n"
+  "5.0 0.0 0.0\n"
+  "0.0 4.0 0.0\n"
+  "0.0 0.0 4.0\n"
+  "Si O\n"
+  "1 1\n"
+  "Direct configuration=     2\n"
+  "0.00 0.00 0.00\n"
+  "0.05 0.50 0.50\n"
+  "Direct configuration=     3\n"
+  "0.00 0.00 0.00\n";
+
+static const char extendedXyz[] =
+  "2\n"
+  "Lattice=\"5.0 0.0 0.0 0.0 5.0 0.0 0.0 0.0 5.0\" "
+  "Properties=species:S:1:pos:R:3 energy=-1.0 pbc=\"T T T\"\n"
+  "O 0.0 0.0 0.0\n"
+  "H 0.9 0.0 0.0\n"
+  "2\n"
+  "Lattice=\"6.0 0.0 0.0 0.0 5.0 0.0 0.0 0.0 5.0\" "
+  "Properties=species:S:1:pos:R:3 energy=-2.0 pbc=\"T T T\"\n"
+  "O 0.0 0.0 0.0\n"
+  "H 0.0 0.9 0.0\n";
+
+// A water molecule cut by the face of the cell, one hydrogen is wrapped
+// to the far side at x = 4.75
+static const char wrappedWater[] =
+  "3\n"
+  "Lattice=\"5.0 0.0 0.0 0.0 5.0 0.0 0.0 0.0 5.0\" "
+  "Properties=species:S:1:pos:R:3 pbc=\"T T T\"\n"
+  "O 0.30 2.50 2.50\n"
+  "H 4.75 2.50 1.80\n"
+  "H 0.04 3.40 2.50\n"
+  "3\n"
+  "Lattice=\"5.0 0.0 0.0 0.0 5.0 0.0 0.0 0.0 5.0\" "
+  "Properties=species:S:1:pos:R:3 pbc=\"T T T\"\n"
+  "O 0.30 2.50 2.50\n"
+  "H 4.75 2.50 1.80\n"
+  "H 0.04 3.40 2.50\n";
+
+class TrajectoryReaderTest : public QObject
+{
+  Q_OBJECT
+
+  private:
+    Molecule * read(const char *text, const QString &options = QString())
+    {
+      return readText<TrajectoryReader>(text, options);
+    }
+
+  private slots:
+    /**
+     * Every frame is a conformer with its own cell, the truncated last
+     * frame is dropped.
+     */
+    void xdatcar();
+
+    /**
+     * Atoms crossing the cell boundary are unwrapped unless asked not to.
+     */
+    void unwrap();
+
+    /**
+     * Extended XYZ frames give the lattice and the energy.
+     */
+    void extendedXyz();
+
+    /**
+     * Bonds across the faces of the cell are found and the molecule is
+     * made whole in every frame.
+     */
+    void periodicBonds();
+
+    void stride();
+};
+
+void TrajectoryReaderTest::xdatcar()
+{
+  Molecule *molecule = read(xdatcar);
+  QVERIFY(molecule);
+  QCOMPARE(molecule->numAtoms(), 2u);
+  QCOMPARE(molecule->atom(0)->atomicNumber(), 14);
+  QCOMPARE(molecule->atom(1)->atomicNumber(), 8);
+  QCOMPARE(molecule->numConformers(), 2u);
+  QCOMPARE(static_cast<int>(molecule->conformerCells().size()), 2);
+  QVERIFY(molecule->OBUnitCell());
+  QCOMPARE(molecule->OBUnitCell()->GetA(), 4.0);
+
+  QVERIFY(molecule->setConformer(1));
+  QCOMPARE(molecule->OBUnitCell()->GetA(), 5.0);
+  delete molecule;
+}
+
+void TrajectoryReaderTest::unwrap()
+{
+  Molecule *molecule = read(xdatcar);
+  QVERIFY(molecule);
+  QVERIFY(molecule->setConformer(1));
+  // 0.95 to 1.05 in fractional coordinates, in the larger cell
+  QVERIFY(qAbs(molecule->atom(1)->pos()->x() - 5.25) < 1e-6);
+  delete molecule;
+
+  molecule = read(xdatcar, "wrap");
+  QVERIFY(molecule);
+  QVERIFY(molecule->setConformer(1));
+  QVERIFY(qAbs(molecule->atom(1)->pos()->x() - 0.25) < 1e-6);
+  delete molecule;
+}
+
+void TrajectoryReaderTest::extendedXyz()
+{
+  Molecule *molecule = read(extendedXyz);
+  QVERIFY(molecule);
+  QCOMPARE(molecule->numAtoms(), 2u);
+  QCOMPARE(molecule->numBonds(), 1u);
+  QCOMPARE(molecule->numConformers(), 2u);
+  QCOMPARE(static_cast<int>(molecule->energies().size()), 2);
+  QVERIFY(molecule->energy(1) < molecule->energy(0));
+
+  QVERIFY(molecule->setConformer(1));
+  QCOMPARE(molecule->OBUnitCell()->GetA(), 6.0);
+  QVERIFY(qAbs(molecule->atom(1)->pos()->y() - 0.9) < 1e-6);
+  delete molecule;
+}
+
+void TrajectoryReaderTest::periodicBonds()
+{
+  Molecule *molecule = read(wrappedWater);
+  QVERIFY(molecule);
+  QCOMPARE(molecule->numBonds(), 2u);
+  for (unsigned int i = 0; i < molecule->numConformers(); ++i) {
+    QVERIFY(molecule->setConformer(i));
+    QVERIFY(qAbs(molecule->atom(1)->pos()->x() + 0.25) < 1e-6);
+    QVERIFY((*molecule->atom(1)->pos() - *molecule->atom(0)->pos()).norm() < 1.0);
+  }
+  delete molecule;
+
+  // The bonds are still found if the coordinates are kept as in the file
+  molecule = read(wrappedWater, "wrap");
+  QVERIFY(molecule);
+  QCOMPARE(molecule->numBonds(), 2u);
+  QVERIFY(qAbs(molecule->atom(1)->pos()->x() - 4.75) < 1e-6);
+  delete molecule;
+}
+
+void TrajectoryReaderTest::stride()
+{
+  Molecule *molecule = read(extendedXyz, "stride 2");
+  QVERIFY(molecule);
+  QCOMPARE(molecule->numConformers(), 1u);
+  delete molecule;
+}
+
+QTEST_MAIN(TrajectoryReaderTest)
+
+#include "moc_trajectoryreadertest.cxx"
@@ -0,0 +1,167 @@
+/**********************************************************************
+  TrajectorySpectrumTest - unit tests for spectra from trajectories
+
+  Copyright (C) 2013 Avogadro Developers
+
+  This file is part of the Avogadro molecular editor project.
+  For more information, see <http://avogadro.cc/>
+
+  Avogadro is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  Avogadro is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+  02110-1301, USA.
+ **********************************************************************/
+
+#include "config.h"
+
+#include <QtTest>
+#include <avogadro/trajectoryspectrum.h>
+#include <avogadro/molecule.h>
+#include <avogadro/atom.h>
+
+#include <Eigen/Core>
+
+#include <cmath>
+#include <vector>
+
+using Avogadro::TrajectorySpectrum;
+using Avogadro::Molecule;
+using Avogadro::Atom;
+
+using Eigen::Vector3d;
+
+class TrajectorySpectrumTest : public QObject
+{
+  Q_OBJECT
+
+  private:
+    /**
+     * Fill @a molecule with a carbon monoxide molecule vibrating at
+     * @a wavenumber for @a frames frames 0.5 fs apart.
+     */
+    void vibrate(Molecule &molecule, double wavenumber, int frames);
+
+    /// @return The index of the largest intensity
+    size_t peak(const TrajectorySpectrum &spectrum);
+
+  private slots:
+    void tooShort();
+    void power();
+    void infrared();
+    void corrections();
+};
+
+void TrajectorySpectrumTest::vibrate(Molecule &molecule, double wavenumber,
+                                     int frames)
+{
+  Atom *carbon = molecule.addAtom(6, Vector3d(0.0, 0.0, 0.0));
+  Atom *oxygen = molecule.addAtom(8, Vector3d(1.13, 0.0, 0.0));
+  // Angular frequency in rad/fs
+  const double omega = 2.0 * M_PI * wavenumber * 2.99792458e10 * 1.0e-15;
+  for (int f = 1; f < frames; ++f) {
+    const double stretch = 0.05 * std::sin(omega * 0.5 * f);
+    std::vector<Vector3d> conformer(molecule.conformerSize());
+    conformer[carbon->id()] = Vector3d(-16.0 / 28.0 * stretch, 0.0, 0.0);
+    conformer[oxygen->id()] = Vector3d(1.13 + 12.0 / 28.0 * stretch, 0.0, 0.0);
+    molecule.addConformer(conformer, f);
+  }
+}
+
+size_t TrajectorySpectrumTest::peak(const TrajectorySpectrum &spectrum)
+{
+  size_t best = 0;
+  for (size_t i = 1; i < spectrum.intensities().size(); ++i)
+    if (spectrum.intensities()[i] > spectrum.intensities()[best])
+      best = i;
+  return best;
+}
+
+void TrajectorySpectrumTest::tooShort()
+{
+  Molecule molecule;
+  vibrate(molecule, 2000.0, 3);
+
+  TrajectorySpectrum spectrum;
+  QVERIFY(!spectrum.calculate(&molecule, TrajectorySpectrum::PowerSpectrum));
+  QVERIFY(spectrum.intensities().empty());
+}
+
+void TrajectorySpectrumTest::power()
+{
+  Molecule molecule;
+  vibrate(molecule, 2000.0, 4096);
+
+  TrajectorySpectrum spectrum;
+  spectrum.setTimeStep(0.5);
+  QVERIFY(spectrum.calculate(&molecule, TrajectorySpectrum::PowerSpectrum));
+  QCOMPARE(spectrum.autocorrelation().size(), size_t(2047));
+  QVERIFY(qAbs(spectrum.autocorrelation()[0] - 1.0) < 1.0e-12);
+  QCOMPARE(spectrum.frequencies().size(), spectrum.intensities().size());
+
+  // Up to the Nyquist frequency, 1 / (2 dt c)
+  const double nyquist = 1.0 / (2.0 * 0.5e-15 * 2.99792458e10);
+  QVERIFY(qAbs(spectrum.frequencies().back() - nyquist) < 1.0e-6);
+  const double resolution = spectrum.frequencies()[1];
+  QVERIFY(qAbs(spectrum.frequencies()[peak(spectrum)] - 2000.0) < resolution);
+
+  // The window changes the shape, not the position of the peak
+  spectrum.setWindow(TrajectorySpectrum::NoWindow);
+  spectrum.setCorrelationLength(512);
+  spectrum.calculate(&molecule, TrajectorySpectrum::PowerSpectrum);
+  QCOMPARE(spectrum.autocorrelation().size(), size_t(512));
+  QVERIFY(qAbs(spectrum.frequencies()[peak(spectrum)] - 2000.0)
+          < spectrum.frequencies()[1]);
+}
+
+void TrajectorySpectrumTest::infrared()
+{
+  Molecule molecule;
+  vibrate(molecule, 1500.0, 2048);
+
+  TrajectorySpectrum spectrum;
+  spectrum.setTimeStep(0.5);
+  spectrum.setWindow(TrajectorySpectrum::BlackmanWindow);
+  QVERIFY(spectrum.calculate(&molecule,
+                             TrajectorySpectrum::InfraredSpectrum));
+  QVERIFY(qAbs(spectrum.frequencies()[peak(spectrum)] - 1500.0)
+          < spectrum.frequencies()[1]);
+}
+
+void TrajectorySpectrumTest::corrections()
+{
+  Molecule molecule;
+  vibrate(molecule, 2000.0, 1024);
+
+  TrajectorySpectrum spectrum;
+  spectrum.setTimeStep(0.5);
+  spectrum.calculate(&molecule, TrajectorySpectrum::PowerSpectrum);
+  const std::vector<double> classical = spectrum.intensities();
+  const size_t i = peak(spectrum);
+  const double x = 1.4387769 * spectrum.frequencies()[i] / 300.0;
+
+  spectrum.setCorrection(TrajectorySpectrum::HarmonicCorrection);
+  spectrum.calculate(&molecule, TrajectorySpectrum::PowerSpectrum);
+  QVERIFY(qAbs(spectrum.intensities()[0] - classical[0]) < 1.0e-12);
+  QVERIFY(qAbs(spectrum.intensities()[i] / classical[i]
+               - x / (1.0 - std::exp(-x))) < 1.0e-8);
+
+  spectrum.setCorrection(TrajectorySpectrum::SchofieldCorrection);
+  spectrum.setTemperature(1000.0);
+  spectrum.calculate(&molecule, TrajectorySpectrum::PowerSpectrum);
+  QVERIFY(qAbs(spectrum.intensities()[i] / classical[i]
+               - std::exp(0.15 * x)) < 1.0e-8);
+}
+
+QTEST_MAIN(TrajectorySpectrumTest)
+
+#include "moc_trajectoryspectrumtest.cxx"
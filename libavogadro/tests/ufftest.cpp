@@ -0,0 +1,371 @@
+/**********************************************************************
+  UFFTest - unit tests for the native UFF implementation
+
+  Copyright (C) 2013 Avogadro Developers
+
+  This file is part of the Avogadro molecular editor project.
+  For more information, see <http://avogadro.cc/>
+
+  Avogadro is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  Avogadro is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+  02110-1301, USA.
+ **********************************************************************/
+
+#include "config.h"
+
+#include <QtTest>
+#include <avogadro/uffforcefield.h>
+#include <avogadro/moleculefile.h>
+#include <avogadro/molecule.h>
+#include <avogadro/atom.h>
+
+#include <openbabel/mol.h>
+#include <openbabel/forcefield.h>
+#include <openbabel/generic.h>
+
+#include <Eigen/Core>
+
+#include <cstdlib>
+
+using Avogadro::UFFForceField;
+using Avogadro::MoleculeFile;
+using Avogadro::Molecule;
+using Avogadro::Atom;
+
+class UFFTest : public QObject
+{
+  Q_OBJECT
+
+  private:
+    Molecule * readMolecule(const QString &name);
+    /**
+     * Compare the analytical gradient of @p uff with central differences.
+     */
+    void checkGradient(UFFForceField &uff);
+
+  private slots:
+    /**
+     * Every energy term and the gradient agree with OpenBabel's UFF.
+     */
+    void compareOpenBabel_data();
+    void compareOpenBabel();
+
+    /**
+     * The analytical gradient agrees with finite differences, also inside
+     * the switching region below the cutoff.
+     */
+    void gradient_data();
+    void gradient();
+
+    /**
+     * The cell list gives the same nonbonded energy as all pairs.
+     */
+    void cellList();
+
+    /**
+     * The nonbonded energy and force go to zero at the cutoff.
+     */
+    void switching();
+
+    /**
+     * Bonded terms use the minimum image, moving an atom by a cell vector
+     * does not change the energy.
+     */
+    void periodic();
+
+    /**
+     * Both minimizers lower the energy and respect fixed atoms.
+     */
+    void minimize();
+};
+
+Molecule * UFFTest::readMolecule(const QString &name)
+{
+  return MoleculeFile::readMolecule(QString(TESTDATADIR) + name);
+}
+
+void UFFTest::checkGradient(UFFForceField &uff)
+{
+  Eigen::Matrix3Xd grad;
+  uff.energy(UFFForceField::AllTerms, &grad);
+
+  const double h = 1.0e-5;
+  const Eigen::Matrix3Xd pos = uff.coordinates();
+  for (int i = 0; i < pos.cols(); ++i) {
+    for (int k = 0; k < 3; ++k) {
+      Eigen::Matrix3Xd displaced = pos;
+      displaced(k, i) += h;
+      uff.setCoordinates(displaced);
+      double plus = uff.energy();
+      displaced(k, i) -= 2.0 * h;
+      uff.setCoordinates(displaced);
+      double minus = uff.energy();
+      double numerical = (plus - minus) / (2.0 * h);
+      QVERIFY(qAbs(numerical - grad(k, i)) < 1.0e-4 * qMax(1.0, qAbs(numerical)));
+    }
+  }
+  uff.setCoordinates(pos);
+}
+
+void UFFTest::compareOpenBabel_data()
+{
+  QTest::addColumn<QString>("file");
+
+  QTest::newRow("ethanol") << "ethanol.cml";
+  QTest::newRow("butane") << "butane.cml";
+  QTest::newRow("2-aminoethanol") << "2-aminoethanol.cml";
+}
+
+void UFFTest::compareOpenBabel()
+{
+  QFETCH(QString, file);
+
+  Molecule *molecule = readMolecule(file);
+  QVERIFY(molecule);
+
+  // Move the atoms off the minimum so all terms contribute
+  std::srand(42);
+  foreach (Atom *atom, molecule->atoms())
+    atom->setPos(*atom->pos() + 0.1 * Eigen::Vector3d::Random());
+
+  OpenBabel::OBForceField *obff = OpenBabel::OBForceField::FindForceField("UFF");
+  if (!obff)
+    QSKIP("OpenBabel UFF not available", SkipSingle);
+  OpenBabel::OBMol obmol = molecule->OBMol();
+  QVERIFY(obff->Setup(obmol));
+
+  UFFForceField uff;
+  QVERIFY(uff.setup(molecule));
+  uff.setCutoff(0.0);
+
+  const UFFForceField::Term terms[] = {
+    UFFForceField::BondTerm, UFFForceField::AngleTerm,
+    UFFForceField::TorsionTerm, UFFForceField::InversionTerm,
+    UFFForceField::VdWTerm, UFFForceField::ElectrostaticTerm
+  };
+  const double reference[] = {
+    obff->E_Bond(false), obff->E_Angle(false),
+    obff->E_Torsion(false), obff->E_OOP(false),
+    obff->E_VDW(false), obff->E_Electrostatic(false)
+  };
+  for (int t = 0; t < 6; ++t) {
+    double energy = uff.energy(terms[t]);
+    QVERIFY2(qAbs(energy - reference[t]) < 1.0e-3 * qMax(1.0, qAbs(energy)),
+             qPrintable(QString("term 0x%1: %2, OpenBabel %3")
+                        .arg(int(terms[t]), 0, 16).arg(energy).arg(reference[t])));
+  }
+
+  // OpenBabel stores the negative gradient
+  Eigen::Matrix3Xd grad;
+  uff.energy(UFFForceField::AllTerms, &grad);
+  obff->Energy(true);
+  for (int i = 0; i < grad.cols(); ++i) {
+    OpenBabel::vector3 force = obff->GetGradient(obmol.GetAtom(i + 1));
+    Eigen::Vector3d obGrad(-force.x(), -force.y(), -force.z());
+    QVERIFY((grad.col(i) - obGrad).norm() < 1.0e-3 * qMax(1.0, obGrad.norm()));
+  }
+
+  delete molecule;
+}
+
+void UFFTest::gradient_data()
+{
+  QTest::addColumn<QString>("file");
+  QTest::addColumn<double>("cutoff");
+
+  QTest::newRow("ethanol") << "ethanol.cml" << 0.0;
+  QTest::newRow("butane") << "butane.cml" << 0.0;
+  QTest::newRow("2-aminoethanol") << "2-aminoethanol.cml" << 0.0;
+  // Most 1-4 pairs lie between 2 and 3 Angstrom, inside the switch
+  QTest::newRow("butane, switched") << "butane.cml" << 3.0;
+}
+
+void UFFTest::gradient()
+{
+  QFETCH(QString, file);
+  QFETCH(double, cutoff);
+
+  Molecule *molecule = readMolecule(file);
+  QVERIFY(molecule);
+
+  // Move the atoms off the minimum so all terms contribute
+  std::srand(42);
+  foreach (Atom *atom, molecule->atoms())
+    atom->setPos(*atom->pos() + 0.1 * Eigen::Vector3d::Random());
+
+  UFFForceField uff;
+  QVERIFY(uff.setup(molecule));
+  uff.setCutoff(cutoff);
+  checkGradient(uff);
+
+  delete molecule;
+}
+
+void UFFTest::cellList()
+{
+  // A grid of neon atoms only has nonbonded terms
+  std::srand(42);
+  Molecule molecule;
+  for (int i = 0; i < 8; ++i)
+    for (int j = 0; j < 8; ++j)
+      for (int k = 0; k < 8; ++k) {
+        Atom *atom = molecule.addAtom();
+        atom->setAtomicNumber(10);
+        atom->setPos(Eigen::Vector3d(3.1 * i, 3.1 * j, 3.1 * k)
+                     + 0.2 * Eigen::Vector3d::Random());
+      }
+
+  UFFForceField uff;
+  QVERIFY(uff.setup(&molecule));
+
+  uff.setCutoff(0.0);
+  double allPairs = uff.energy(UFFForceField::VdWTerm);
+
+  // Everything is within 40 Angstrom, the cutoff does not remove pairs
+  uff.setCutoff(40.0);
+  double cells = uff.energy(UFFForceField::VdWTerm);
+  QVERIFY(qAbs(allPairs - cells) < 1.0e-8 * qAbs(allPairs));
+
+  // A short cutoff uses many cells, compare with a brute force sum over
+  // the pairs within the cutoff
+  uff.setCutoff(6.0);
+  double shortCutoff = uff.energy(UFFForceField::VdWTerm);
+
+  Molecule pair;
+  for (int i = 0; i < 2; ++i)
+    pair.addAtom()->setAtomicNumber(10);
+  UFFForceField pairUff;
+  QVERIFY(pairUff.setup(&pair));
+  pairUff.setCutoff(6.0);
+
+  const Eigen::Matrix3Xd pos = uff.coordinates();
+  Eigen::Matrix3Xd pairPos(3, 2);
+  double reference = 0.0;
+  for (int i = 0; i < pos.cols(); ++i) {
+    for (int j = i + 1; j < pos.cols(); ++j) {
+      if ((pos.col(i) - pos.col(j)).norm() > 6.0)
+        continue;
+      pairPos.col(0) = pos.col(i);
+      pairPos.col(1) = pos.col(j);
+      pairUff.setCoordinates(pairPos);
+      reference += pairUff.energy(UFFForceField::VdWTerm);
+    }
+  }
+  QVERIFY(qAbs(shortCutoff - reference) < 1.0e-8 * qAbs(reference));
+}
+
+void UFFTest::switching()
+{
+  Molecule molecule;
+  for (int i = 0; i < 2; ++i)
+    molecule.addAtom()->setAtomicNumber(10);
+
+  UFFForceField uff;
+  QVERIFY(uff.setup(&molecule));
+  uff.setCutoff(6.0);
+
+  Eigen::Matrix3Xd pos = Eigen::Matrix3Xd::Zero(3, 2);
+  Eigen::Matrix3Xd grad;
+
+  // Unchanged below the switching region
+  pos(0, 1) = 4.5;
+  uff.setCoordinates(pos);
+  double inside = uff.energy(UFFForceField::VdWTerm);
+  uff.setCutoff(0.0);
+  QVERIFY(qAbs(inside - uff.energy(UFFForceField::VdWTerm)) < 1.0e-12);
+  uff.setCutoff(6.0);
+
+  // Both vanish continuously at the cutoff
+  pos(0, 1) = 6.0 - 1.0e-6;
+  uff.setCoordinates(pos);
+  double edge = uff.energy(UFFForceField::VdWTerm, &grad);
+  QVERIFY(qAbs(edge) < 1.0e-8 * qAbs(inside));
+  QVERIFY(grad.norm() < 1.0e-6);
+
+  pos(0, 1) = 6.5;
+  uff.setCoordinates(pos);
+  QCOMPARE(uff.energy(UFFForceField::VdWTerm, &grad), 0.0);
+  QCOMPARE(grad.norm(), 0.0);
+}
+
+void UFFTest::periodic()
+{
+  Molecule *molecule = readMolecule("butane.cml");
+  QVERIFY(molecule);
+
+  std::srand(42);
+  foreach (Atom *atom, molecule->atoms())
+    atom->setPos(*atom->pos() + 0.1 * Eigen::Vector3d::Random());
+
+  OpenBabel::OBUnitCell cell;
+  cell.SetData(12.0, 12.0, 12.0, 90.0, 90.0, 90.0);
+  molecule->setOBUnitCell(&cell);
+
+  UFFForceField uff;
+  QVERIFY(uff.setup(molecule));
+  uff.setCutoff(5.0);
+  uff.setPeriodic(true);
+  double energy = uff.energy();
+
+  // Move the first atom into the neighbouring cell
+  Eigen::Matrix3Xd pos = uff.coordinates();
+  pos(0, 0) += 12.0;
+  uff.setCoordinates(pos);
+  QVERIFY(qAbs(uff.energy() - energy) < 1.0e-8 * qMax(1.0, qAbs(energy)));
+  checkGradient(uff);
+
+  molecule->setOBUnitCell(0);
+  delete molecule;
+}
+
+void UFFTest::minimize()
+{
+  Molecule *molecule = readMolecule("butane.cml");
+  QVERIFY(molecule);
+
+  foreach (Atom *atom, molecule->atoms())
+    atom->setPos(*atom->pos() + 0.2 * Eigen::Vector3d::Random());
+
+  UFFForceField uff;
+  QVERIFY(uff.setup(molecule));
+  QVERIFY(!uff.topologyChanged());
+
+  QList<int> fixed;
+  fixed << 0;
+  uff.setFixedAtoms(fixed);
+  const Eigen::Vector3d fixedPos = uff.coordinates().col(0);
+  const Eigen::Matrix3Xd start = uff.coordinates();
+
+  double initial = uff.energy();
+  uff.steepestDescent(50);
+  double sd = uff.energy();
+  QVERIFY(sd < initial);
+
+  uff.setCoordinates(start);
+  uff.lbfgs(200);
+  double lbfgs = uff.energy();
+  QVERIFY(lbfgs < initial);
+  QVERIFY((uff.coordinates().col(0) - fixedPos).norm() < 1.0e-12);
+
+  // The molecule only changes on request
+  QVERIFY((*molecule->atom(1)->pos() - start.col(1)).norm() < 1.0e-12);
+  uff.writeCoordinates();
+  QVERIFY((*molecule->atom(1)->pos() - uff.coordinates().col(1)).norm() < 1.0e-12);
+
+  delete molecule;
+}
+
+QTEST_MAIN(UFFTest)
+
+#include "moc_ufftest.cxx"